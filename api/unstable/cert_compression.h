@@ -0,0 +1,85 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <s2n.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file cert_compression.h
+ *
+ * TLS1.3 certificate compression, as defined in https://www.rfc-editor.org/rfc/rfc8879.
+ *
+ * A client that enables certificate compression offers its supported algorithms
+ * in the "compress_certificate" extension. A server that enables certificate
+ * compression replaces its Certificate message with a CompressedCertificate
+ * message if the client offered a mutually supported algorithm.
+ *
+ * Compression algorithms are only available if s2n-tls was built with the
+ * corresponding library. See the S2N_CERT_COMPRESSION, S2N_CERT_COMPRESSION_BROTLI
+ * and S2N_CERT_COMPRESSION_ZSTD CMake options.
+ */
+
+/**
+ * Certificate compression algorithms, using the IANA code points from
+ * https://www.rfc-editor.org/rfc/rfc8879#section-7.3
+ */
+typedef enum {
+    S2N_CERT_COMPRESSION_ZLIB = 1,
+    S2N_CERT_COMPRESSION_BROTLI = 2,
+    S2N_CERT_COMPRESSION_ZSTD = 3,
+} s2n_cert_compression_algorithm;
+
+/**
+ * Checks whether s2n-tls was built with support for a certificate compression algorithm.
+ *
+ * @param algorithm The algorithm to check.
+ * @returns True if the algorithm can be used, false otherwise.
+ */
+S2N_API bool s2n_cert_compression_is_supported(s2n_cert_compression_algorithm algorithm);
+
+/**
+ * Sets the certificate compression algorithms for a config, in order of preference.
+ *
+ * Clients offer these algorithms to the server. Servers choose the first algorithm
+ * in this list that the client also offered.
+ *
+ * Servers compress each certificate chain once per algorithm when the chain is
+ * added to the config or when this method is called, so that the common case of a
+ * Certificate message without OCSP or SCT extensions costs no compression work per
+ * handshake. Call this method before using the config to create connections.
+ *
+ * Passing a count of zero disables certificate compression.
+ *
+ * @param config The config to update.
+ * @param algorithms The list of algorithms, in preference order.
+ * @param count The number of algorithms in the list.
+ * @returns S2N_SUCCESS on success. S2N_FAILURE if any algorithm is not supported.
+ */
+S2N_API int s2n_config_set_cert_compression_preferences(struct s2n_config *config,
+        const s2n_cert_compression_algorithm *algorithms, uint8_t count);
+
+/**
+ * Retrieves the algorithm used to compress the server's certificate chain.
+ *
+ * @param conn The connection to check.
+ * @param algorithm Set to the algorithm used.
+ * @returns S2N_SUCCESS if the certificate chain was compressed.
+ * S2N_FAILURE if the certificate chain was not compressed.
+ */
+S2N_API int s2n_connection_get_cert_compression_algorithm(struct s2n_connection *conn,
+        s2n_cert_compression_algorithm *algorithm);
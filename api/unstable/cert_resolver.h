@@ -0,0 +1,131 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <s2n.h>
+
+/**
+ * @file cert_resolver.h
+ *
+ * The following APIs let servers load certificates on demand, based on the server name
+ * sent by the client, instead of adding every certificate to the config up front.
+ * This is intended for servers that host a very large number of domains: configs are cheap
+ * to create, and only certificates for recently used domains stay in memory.
+ *
+ * Resolved certificates are stored in a `s2n_cert_cache`, a bounded cache that evicts the
+ * least recently used certificate when full. A certificate is only freed once it is evicted
+ * and no connection is still using it.
+ *
+ * The cert resolver APIs are currently considered unstable, since they have been recently added to s2n-tls.
+ */
+
+struct s2n_cert_cache;
+
+/**
+ * Allocates a new certificate cache.
+ *
+ * A cache can be shared by multiple configs, and used by connections on multiple threads.
+ * The cache must be freed with `s2n_cert_cache_free()` after all configs and connections
+ * using it have been freed.
+ *
+ * @param max_entries The maximum number of certificates to keep in the cache.
+ * @returns A new cache, or NULL on failure.
+ */
+S2N_API struct s2n_cert_cache *s2n_cert_cache_new(uint32_t max_entries);
+
+/**
+ * Frees a certificate cache and every certificate it contains.
+ *
+ * @param cache The cache to free. Set to NULL on success.
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure.
+ */
+S2N_API int s2n_cert_cache_free(struct s2n_cert_cache **cache);
+
+/**
+ * Removes the certificate for a server name from the cache, for example when the
+ * certificate is renewed. The next handshake for that name invokes the resolver callback again.
+ *
+ * Connections already using the removed certificate are unaffected.
+ *
+ * @param cache The cache to update.
+ * @param server_name The server name the certificate was resolved for.
+ * @returns S2N_SUCCESS on success, including if no certificate was cached for the name.
+ */
+S2N_API int s2n_cert_cache_remove(struct s2n_cert_cache *cache, const char *server_name);
+
+/**
+ * A callback which can be implemented to provide s2n-tls with the certificate for a server name.
+ *
+ * The callback is triggered once per handshake, after the client hello callback, when the client sent
+ * a server name and the config's certificate cache doesn't already contain a certificate for it that
+ * the connection's security policy accepts.
+ * To provide a certificate, use `s2n_cert_resolver_set()`. To use the certificates added to the config
+ * instead, use `s2n_cert_resolver_ignore()`.
+ *
+ * This callback can be synchronous or asynchronous. For asynchronous behavior, return success without calling
+ * `s2n_cert_resolver_set()` or `s2n_cert_resolver_ignore()`. `s2n_negotiate()` will return
+ * S2N_BLOCKED_ON_APPLICATION_INPUT until one of these functions is called.
+ *
+ * @param conn The connection being negotiated.
+ * @param server_name The server name sent by the client, in lower case. Only valid until the callback returns.
+ * @param context Context for the callback function.
+ * @returns 0 on success, -1 on failure. Failure will cause the handshake to fail.
+ */
+typedef int (*s2n_cert_resolver_callback)(struct s2n_connection *conn, const char *server_name, void *context);
+
+/**
+ * Set a callback to resolve server certificates by server name.
+ *
+ * Certificates returned by the callback are stored in `cache`, and later handshakes for the same
+ * server name use the cached certificate without invoking the callback.
+ *
+ * @param config A pointer to the config
+ * @param cache The cache to store resolved certificates in.
+ * @param callback The function to be called when a server name isn't found in the cache.
+ * @param context Context to be passed to the callback function.
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_config_set_cert_resolver_cb(struct s2n_config *config, struct s2n_cert_cache *cache,
+        s2n_cert_resolver_callback callback, void *context);
+
+/**
+ * Provide s2n-tls with the certificate for the connection's server name.
+ *
+ * A return function for `s2n_cert_resolver_callback`. It can be called from within the callback,
+ * or later if the callback is asynchronous.
+ *
+ * The certificate is added to the cache, which takes ownership of it: the application must not free
+ * `chain_and_key` or use it with any other config. If another connection already added a certificate
+ * for the same server name that this connection's security policy accepts, that certificate is used
+ * and `chain_and_key` is freed. Otherwise `chain_and_key` replaces the cached certificate.
+ * If this function fails, the application still owns `chain_and_key`.
+ *
+ * @param conn The connection passed to the callback.
+ * @param chain_and_key The certificate chain and private key to use for the server name.
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure.
+ */
+S2N_API int s2n_cert_resolver_set(struct s2n_connection *conn, struct s2n_cert_chain_and_key *chain_and_key);
+
+/**
+ * Skip providing a certificate for the connection's server name.
+ *
+ * A return function for `s2n_cert_resolver_callback`. The handshake continues with the
+ * certificates added to the config.
+ *
+ * @param conn The connection passed to the callback.
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure.
+ */
+S2N_API int s2n_cert_resolver_ignore(struct s2n_connection *conn);
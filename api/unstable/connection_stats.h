@@ -0,0 +1,76 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <s2n.h>
+
+/**
+ * @file connection_stats.h
+ *
+ * Connection statistics count the work s2n-tls does on behalf of a connection: records,
+ * calls to the send and recv I/O callbacks, and copies and allocations of its I/O buffers.
+ * They are useful for diagnosing small records, excessive syscalls, or unexpected buffering.
+ *
+ * The connection statistics APIs are currently considered unstable, since they have been recently added to s2n-tls.
+ */
+
+/**
+ * Counters maintained for a connection.
+ *
+ * Counters start at zero when the connection is created or wiped, and are kept across
+ * renegotiation. Records sent or received with kTLS are not counted.
+ *
+ * New counters are only ever appended to this struct. Callers pass the size of the struct
+ * they were built with to s2n_connection_get_stats(), so an application built against an
+ * older version of this header keeps working with a newer library.
+ */
+struct s2n_connection_stats {
+    /* Records written and read, including handshake records and alerts */
+    uint64_t records_sent;
+    uint64_t records_received;
+    /* Application data passed to s2n_send() and returned by s2n_recv() */
+    uint64_t plaintext_bytes_sent;
+    uint64_t plaintext_bytes_received;
+    /* Calls to the recv and send I/O callbacks, or to read() and write() for socket I/O */
+    uint64_t read_calls;
+    uint64_t write_calls;
+    /* Calls to the recv and send I/O callbacks that failed with EAGAIN or EWOULDBLOCK */
+    uint64_t read_blocked;
+    uint64_t write_blocked;
+    /* Attempts to write all buffered records to the peer */
+    uint64_t flushes;
+    /* Allocations of the buffers used to read and write records */
+    uint64_t buffer_resizes;
+    /* TLS1.3 KeyUpdate messages */
+    uint64_t key_updates_sent;
+    uint64_t key_updates_received;
+    /* Bytes copied between internal buffers or between internal buffers and the application,
+     * not counting encryption and decryption */
+    uint64_t bytes_copied;
+};
+
+/**
+ * Retrieves the statistics for a connection.
+ *
+ * Only the first `stats_size` bytes of `stats` are written. If `stats_size` is larger than
+ * the struct known to the library, the remaining counters are set to zero.
+ *
+ * @param conn A pointer to the connection
+ * @param stats A pointer to the struct to write the statistics to
+ * @param stats_size The size of `stats` in bytes. Should be `sizeof(struct s2n_connection_stats)`.
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_connection_get_stats(struct s2n_connection *conn, struct s2n_connection_stats *stats, uint32_t stats_size);
@@ -0,0 +1,59 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <s2n.h>
+
+/**
+ * @file early_data_replay.h
+ *
+ * Early data can be replayed by an attacker who captures the client's first flight.
+ * s2n-tls can reject replayed early data by recording recent ClientHellos,
+ * as described in https://www.rfc-editor.org/rfc/rfc8446#section-8.2.
+ *
+ * The early data anti-replay APIs are currently considered unstable, since they have been recently added to s2n-tls.
+ */
+
+/**
+ * Enables a built-in anti-replay filter for early data on a server config.
+ *
+ * The server records the PSK binder of every ClientHello whose early data it would accept.
+ * Binders are unique to each ClientHello, so a second ClientHello with a recorded binder
+ * is a replay and its early data is rejected. The handshake then continues without early data.
+ *
+ * Binders are only remembered for between one and two windows. To make older ClientHellos
+ * harmless, early data is also rejected if the client's view of the session ticket age differs
+ * from the server's by more than half a window. Because external PSKs have no ticket age,
+ * early data offered with an external PSK is always rejected while the filter is enabled.
+ *
+ * The filter is a pair of Bloom filters sized for `max_handshakes_per_window` ClientHellos,
+ * using about four bytes per handshake. Once more ClientHellos than that arrive in a window,
+ * fresh early data is increasingly rejected as a false positive, but replays are still rejected.
+ * The filter is shared by all connections using the config and is safe to use from multiple threads.
+ *
+ * The filter only records ClientHellos received by this process. A deployment with multiple
+ * servers must also make sure that a replay reaches the server which saw the original ClientHello,
+ * or use a shared anti-replay mechanism through `s2n_config_set_early_data_cb()` instead.
+ * The early data callback is still called for early data that passes the filter.
+ *
+ * @param config A pointer to the config
+ * @param max_handshakes_per_window The number of early data handshakes expected per window.
+ * Must be between 1 and 2^24.
+ * @param window_in_secs The length of the window. Must be greater than zero.
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_config_enable_early_data_replay_filter(struct s2n_config *config, uint32_t max_handshakes_per_window,
+        uint32_t window_in_secs);
@@ -0,0 +1,96 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <s2n.h>
+
+/**
+ * @file handshake_timings.h
+ *
+ * Handshake timings break the latency of a handshake down by message and by the
+ * operations that commonly dominate it: private key operations, certificate validation,
+ * and application callbacks.
+ *
+ * The handshake timing APIs are currently considered unstable, since they have been recently added to s2n-tls.
+ */
+
+/**
+ * The kind of work measured by a `struct s2n_handshake_timing`.
+ */
+typedef enum {
+    /* A handshake message, from the end of the previous message (or the first call to
+     * s2n_negotiate) until the message was fully sent or received and processed.
+     * This includes any time spent blocked on I/O or on the operations below. */
+    S2N_HANDSHAKE_TIMING_MESSAGE = 0,
+    /* The ClientHello callback set with s2n_config_set_client_hello_cb(),
+     * until s2n_client_hello_cb_done() is called if the callback is nonblocking */
+    S2N_HANDSHAKE_TIMING_CLIENT_HELLO_CB,
+    /* The certificate resolver callback, until a certificate is set for the connection */
+    S2N_HANDSHAKE_TIMING_CERT_RESOLVER_CB,
+    /* Validation of the peer's certificate chain, including the certificate validation callback */
+    S2N_HANDSHAKE_TIMING_CERT_VALIDATION,
+    /* A private key signature or decryption, until the result is applied to the connection
+     * if it is performed by the async private key callback */
+    S2N_HANDSHAKE_TIMING_PKEY,
+    /* An operation offloaded with the async offload callback, until the handshake resumes */
+    S2N_HANDSHAKE_TIMING_ASYNC_OFFLOAD,
+} s2n_handshake_timing_type;
+
+/**
+ * A single timing recorded during the handshake.
+ *
+ * Timestamps are in nanoseconds, read from the monotonic clock of the connection's config.
+ * See s2n_config_set_monotonic_clock().
+ */
+struct s2n_handshake_timing {
+    s2n_handshake_timing_type type;
+    /* The name of the handshake message being sent or received, as returned by
+     * s2n_connection_get_last_message_name(). The string is statically allocated. */
+    const char *message;
+    uint64_t start_ns;
+    /* Zero if the operation has not finished yet */
+    uint64_t end_ns;
+};
+
+/**
+ * Enables recording handshake timings for connections using the config.
+ *
+ * Recording reads the monotonic clock once per handshake message and twice per measured
+ * operation, and allocates space for the timings on the connection's first handshake.
+ * It is disabled by default.
+ *
+ * @param config A pointer to the config
+ * @param enabled Whether to record handshake timings
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_config_set_handshake_timings(struct s2n_config *config, bool enabled);
+
+/**
+ * Retrieves the handshake timings recorded for a connection.
+ *
+ * Timings are listed in the order they were recorded: a message is recorded when it finishes,
+ * while any other operation is recorded when it starts. Only the first 32 timings of a handshake
+ * are recorded. Timings are cleared when the connection is wiped.
+ *
+ * If `timings` is NULL, `timings_len` is set to the number of timings available.
+ *
+ * @param conn A pointer to the connection
+ * @param timings An array to write the timings to, or NULL
+ * @param timings_len The length of the `timings` array as input, and the number of timings written as output
+ * @returns S2N_SUCCESS on success, S2N_FAILURE if `timings` is too small for the recorded timings
+ */
+S2N_API int s2n_connection_get_handshake_timings(struct s2n_connection *conn, struct s2n_handshake_timing *timings,
+        size_t *timings_len);
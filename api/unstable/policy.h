@@ -0,0 +1,53 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <s2n.h>
+
+/**
+ * @file policy.h
+ *
+ * The following APIs let applications resolve a security policy version string once and
+ * reuse the result. Applications that create many configs with the same policy, for example
+ * when reloading per-tenant configs, can avoid repeating the version string lookup for each one.
+ *
+ * The policy APIs are currently considered unstable, since they have been recently added to s2n-tls.
+ */
+
+struct s2n_security_policy;
+
+/**
+ * Retrieves a versioned security policy by its version string.
+ *
+ * The version strings are the same ones accepted by `s2n_config_set_cipher_preferences`.
+ * The returned policy is owned by s2n-tls and remains valid until `s2n_cleanup_final`.
+ *
+ * @param version The version string of the policy, for example "default_tls13".
+ * @returns A static library security policy, or NULL if the version is unknown or deprecated.
+ */
+S2N_API const struct s2n_security_policy *s2n_security_policy_from_version(const char *version);
+
+/**
+ * Sets the security policy on the config.
+ *
+ * "security policies" were previously known as "cipher preferences".
+ * See `s2n_config_set_cipher_preferences`.
+ *
+ * @param config The config object being updated
+ * @param policy The security policy being set, for example one returned by `s2n_security_policy_from_version`
+ * @returns S2N_SUCCESS on success. S2N_FAILURE on failure
+ */
+S2N_API int s2n_config_set_security_policy(struct s2n_config *config, const struct s2n_security_policy *policy);
@@ -0,0 +1,95 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <s2n.h>
+
+/**
+ * @file psk_store.h
+ *
+ * Servers with many external PSKs, such as one per device, can keep them in a store
+ * shared by every connection instead of appending them to each connection with
+ * `s2n_connection_append_psk()`. The store indexes PSKs by identity, so finding the PSK
+ * for an offered identity takes the same time regardless of how many PSKs are stored.
+ *
+ * The PSK store APIs are currently considered unstable, since they have been recently added to s2n-tls.
+ */
+
+/**
+ * An opaque collection of external PSKs indexed by identity.
+ */
+struct s2n_psk_store;
+
+/**
+ * Creates a new, empty PSK store.
+ *
+ * @returns A pointer to the new store, or NULL on failure
+ */
+S2N_API struct s2n_psk_store *s2n_psk_store_new(void);
+
+/**
+ * Frees a PSK store and wipes the PSKs in it.
+ *
+ * The store must not be freed while any config using it is still in use.
+ *
+ * @param store A pointer to a pointer to the store. The pointer is set to NULL.
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_psk_store_free(struct s2n_psk_store **store);
+
+/**
+ * Adds a copy of an external PSK to the store.
+ *
+ * PSKs can be added while handshakes are using the store. Handshakes never wait for
+ * the store to be updated: a handshake either finds the new PSK or does not see it yet.
+ * Calls that update the same store are serialized.
+ *
+ * @param store A pointer to the store
+ * @param psk A pointer to the PSK to copy. The caller is still responsible for freeing `psk`.
+ * @returns S2N_SUCCESS on success, S2N_FAILURE if the store already has a PSK with the same identity
+ */
+S2N_API int s2n_psk_store_add(struct s2n_psk_store *store, struct s2n_psk *psk);
+
+/**
+ * Removes the PSK with the given identity from the store and wipes it.
+ *
+ * Like `s2n_psk_store_add()`, this can be called while handshakes are using the store.
+ * Handshakes that already found the PSK continue to use their own copy of it.
+ *
+ * @param store A pointer to the store
+ * @param identity The identity of the PSK to remove
+ * @param identity_size The size of the identity
+ * @returns S2N_SUCCESS on success, S2N_FAILURE if no PSK in the store has the identity
+ */
+S2N_API int s2n_psk_store_remove(struct s2n_psk_store *store, const uint8_t *identity, uint16_t identity_size);
+
+/**
+ * Configures a server to choose external PSKs from a store.
+ *
+ * When a client offers PSK identities, the server first considers any PSKs appended to the
+ * connection, then chooses the first offered identity found in the store. The chosen PSK
+ * is copied to the connection, so it remains usable if it is removed from the store.
+ * The store is also searched by `s2n_offered_psk_list_choose_psk()` from a PSK selection callback.
+ *
+ * This sets the PSK mode of the config to `S2N_PSK_MODE_EXTERNAL`.
+ * The config does not take ownership of the store, which must outlive the config.
+ * Any number of configs can share a store.
+ *
+ * @param config A pointer to the config
+ * @param store A pointer to the store
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_config_add_psk_store(struct s2n_config *config, struct s2n_psk_store *store);
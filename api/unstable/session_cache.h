@@ -0,0 +1,124 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <s2n.h>
+
+/**
+ * @file session_cache.h
+ *
+ * TLS1.2 session ID resumption requires the server to keep session state in a cache,
+ * supplied by the application through the store, retrieve and delete callbacks.
+ * s2n-tls can instead provide an in-memory cache of a fixed size.
+ *
+ * The built-in session cache APIs are currently considered unstable, since they have been recently added to s2n-tls.
+ */
+
+/**
+ * Enables session ID resumption using a cache owned by the config.
+ *
+ * The cache holds up to `capacity` sessions, spread across `shards` independently locked
+ * partitions so that connections sharing the config on different threads rarely contend.
+ * When a partition is full, the least recently used sessions are replaced first.
+ * Sessions expire after the session state lifetime set with `s2n_config_set_session_state_lifetime()`,
+ * and are wiped from memory when they expire, are replaced or are deleted.
+ *
+ * This replaces any cache callbacks already set on the config. As with application-provided
+ * callbacks, a session ticket key must be added with `s2n_config_add_ticket_crypto_key()`
+ * to encrypt the cached session state.
+ *
+ * The cache is only shared by connections using this config in the same process.
+ *
+ * @param config A pointer to the config
+ * @param capacity The maximum number of sessions to cache
+ * @param shards The number of partitions. Must be between 1 and `capacity`.
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_config_enable_builtin_session_cache(struct s2n_config *config, uint32_t capacity, uint32_t shards);
+
+/**
+ * Reports how effective the built-in session cache has been.
+ *
+ * @param config A pointer to a config with the built-in session cache enabled
+ * @param hits Set to the number of sessions found in the cache
+ * @param misses Set to the number of lookups that found no session, or an expired session
+ * @param evictions Set to the number of unexpired sessions replaced to make room for new sessions
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_config_get_builtin_session_cache_stats(struct s2n_config *config, uint64_t *hits,
+        uint64_t *misses, uint64_t *evictions);
+
+/**
+ * An opaque session cache in memory shared between processes.
+ */
+struct s2n_shm_session_cache;
+
+/**
+ * Creates a session cache in shared memory, so that sessions stored by one server process
+ * can be resumed by any other. This lets servers that fork a worker per core or per connection
+ * resume sessions regardless of which worker accepts the client.
+ *
+ * If `path` is NULL, the cache uses anonymous shared memory, which is shared with any
+ * processes forked after the cache is created. Otherwise the cache is backed by the file
+ * at `path`, which is created with owner-only permissions if it does not exist.
+ * Unrelated processes that open the same file with the same size share the cache.
+ * The file should be on a memory-backed file system such as /dev/shm.
+ *
+ * The cache holds as many sessions as fit in `size` bytes, each of which takes a few hundred bytes.
+ * Cached session state is encrypted with the config's session ticket keys, but the session IDs are not,
+ * so access to the file should be limited to the server.
+ *
+ * @param path The path of the file backing the cache, or NULL for anonymous shared memory
+ * @param size The size of the cache in bytes. Must match the size of an existing file.
+ * @returns A new shared memory session cache, or NULL on failure
+ */
+S2N_API struct s2n_shm_session_cache *s2n_shm_session_cache_new(const char *path, uint64_t size);
+
+/**
+ * Unmaps a shared memory session cache from this process.
+ *
+ * Other processes using the cache are not affected, and a file backing the cache is not removed.
+ * The cache must not be freed while a config using it is in use.
+ *
+ * @param cache A pointer to the cache pointer, which is set to NULL
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_shm_session_cache_free(struct s2n_shm_session_cache **cache);
+
+/**
+ * Enables session ID resumption using a shared memory session cache.
+ *
+ * This replaces any cache callbacks already set on the config, and the same cache can be set
+ * on multiple configs. A session ticket key must be added with `s2n_config_add_ticket_crypto_key()`,
+ * and every process sharing the cache must use the same ticket keys.
+ *
+ * @param config A pointer to the config
+ * @param cache The shared memory session cache, which must outlive the config
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_config_set_shm_session_cache(struct s2n_config *config, struct s2n_shm_session_cache *cache);
+
+/**
+ * Reports how effective a shared memory session cache has been, across all processes using it.
+ *
+ * @param cache A pointer to the cache
+ * @param hits Set to the number of sessions found in the cache
+ * @param misses Set to the number of lookups that found no session, or an expired session
+ * @param evictions Set to the number of unexpired sessions replaced to make room for new sessions
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_shm_session_cache_get_stats(struct s2n_shm_session_cache *cache, uint64_t *hits,
+        uint64_t *misses, uint64_t *evictions);
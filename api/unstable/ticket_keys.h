@@ -0,0 +1,45 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <s2n.h>
+
+/**
+ * @file ticket_keys.h
+ *
+ * By default, s2n-tls derives a unique AES-GCM key for every session ticket it encrypts or decrypts,
+ * so that random nonces never repeat under the same key. Deriving and key scheduling a new key
+ * for every ticket is a significant part of the cost of issuing tickets.
+ *
+ * The ticket key caching APIs are currently considered unstable, since they have been recently added to s2n-tls.
+ */
+
+/**
+ * Enables or disables caching of initialized AES-GCM contexts for session ticket keys.
+ *
+ * When enabled, each process derives one encryption key per ticket key and reuses it,
+ * with a counter instead of a random nonce. A new key is derived after a fork and
+ * after a large number of tickets. Decryption keeps the keys derived for the most recently
+ * seen tickets, so tickets issued by other servers sharing the same ticket key are also cheap to decrypt.
+ *
+ * Tickets have the same format in both modes, so servers with and without caching
+ * can decrypt each other's tickets.
+ *
+ * @param config A pointer to the config
+ * @param enabled Set to true to cache ticket key contexts, false to derive a key per ticket.
+ * @returns S2N_SUCCESS on success, S2N_FAILURE on failure
+ */
+S2N_API int s2n_config_set_ticket_key_caching(struct s2n_config *config, bool enabled);
@@ -33,6 +33,7 @@
 
 #include "api/s2n.h"
 #include "api/unstable/npn.h"
+#include "api/unstable/session_cache.h"
 #include "common.h"
 #include "crypto/s2n_libcrypto.h"
 #include "utils/s2n_safety.h"
@@ -132,9 +133,10 @@ static char default_private_key[] =
         "ggF9KQ0xWz7Km3GXv5+bwM5bcgt1A/s6sZCimXuj3Fle3RqOTF0="
         "-----END RSA PRIVATE KEY-----";
 
-#define OPT_BUFFERED_SEND  1000
-#define OPT_SERIALIZE_OUT  1001
-#define OPT_DESERIALIZE_IN 1002
+#define OPT_BUFFERED_SEND     1000
+#define OPT_SERIALIZE_OUT     1001
+#define OPT_DESERIALIZE_IN    1002
+#define OPT_SHM_SESSION_CACHE 1003
 
 void usage()
 {
@@ -166,7 +168,10 @@ void usage()
     fprintf(stderr, "    Only perform tls handshake and then shutdown the connection\n");
     fprintf(stderr, "  --parallelize\n");
     fprintf(stderr, "    Create a new Connection handler thread for each new connection. Useful for tests with lots of connections.\n");
-    fprintf(stderr, "    Warning: this option isn't compatible with TLS Resumption, since each thread gets its own Session cache.\n");
+    fprintf(stderr, "    Warning: this option isn't compatible with TLS Resumption, since each thread gets its own Session cache,\n");
+    fprintf(stderr, "    unless --shm-session-cache is also set.\n");
+    fprintf(stderr, "  --shm-session-cache <size>\n");
+    fprintf(stderr, "    Cache sessions for session ID resumption in <size> bytes of memory shared by all connection handlers.\n");
     fprintf(stderr, "  --prefer-low-latency\n");
     fprintf(stderr, "    Prefer low latency by clamping maximum outgoing record size at 1500.\n");
     fprintf(stderr, "  --prefer-throughput\n");
@@ -297,6 +302,7 @@ int main(int argc, char *const *argv)
     conn_settings.psk_list_len = 0;
     int max_early_data = 0;
     uint32_t send_buffer_size = 0;
+    uint64_t shm_session_cache_size = 0;
     bool npn = false;
 
     struct option long_options[] = {
@@ -332,6 +338,7 @@ int main(int argc, char *const *argv)
         { "psk", required_argument, 0, 'P' },
         { "max-early-data", required_argument, 0, 'E' },
         { "buffered-send", required_argument, 0, OPT_BUFFERED_SEND },
+        { "shm-session-cache", required_argument, 0, OPT_SHM_SESSION_CACHE },
         /* Per getopt(3) the last element of the array has to be filled with all zeros */
         { 0 },
     };
@@ -438,6 +445,18 @@ int main(int argc, char *const *argv)
                 send_buffer_size = (uint32_t) send_buffer_size_scanned_value;
                 break;
             }
+            case OPT_SHM_SESSION_CACHE: {
+                char *end = NULL;
+                errno = 0;
+                intmax_t shm_session_cache_size_scanned_value = strtoimax(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' || shm_session_cache_size_scanned_value > UINT32_MAX
+                        || shm_session_cache_size_scanned_value <= 0) {
+                    fprintf(stderr, "<size> must be a positive 32 bit value\n");
+                    usage();
+                }
+                shm_session_cache_size = (uint64_t) shm_session_cache_size_scanned_value;
+                break;
+            }
             /* The serialize_out and deserialize_in options are not documented
              * in the usage section as they are not intended to work correctly
              * using s2nd by itself. s2nc and s2nd are processes which close
@@ -614,6 +633,16 @@ int main(int argc, char *const *argv)
 
     s2n_set_common_server_config(max_early_data, config, conn_settings, cipher_prefs, session_ticket_key_file_path);
 
+    if (shm_session_cache_size) {
+        /* Created before any connection handlers are forked, so that they all share it */
+        struct s2n_shm_session_cache *shm_session_cache = s2n_shm_session_cache_new(NULL, shm_session_cache_size);
+        if (!shm_session_cache) {
+            print_s2n_error("Error creating shared memory session cache");
+            exit(1);
+        }
+        GUARD_EXIT(s2n_config_set_shm_session_cache(config, shm_session_cache), "Error setting shared memory session cache");
+    }
+
     if (parallelize) {
         struct sigaction sa;
 
@@ -0,0 +1,335 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Measures how full handshakes per second scale with the number of cores.
+//!
+//! Unlike the criterion benchmarks, this uses real loopback sockets and a single
+//! server config shared by every server thread, so contention on the config's
+//! locks and reference counts, the ticket keys, and the allocator shows up in the
+//! results. Each thread count runs one server thread and one client thread per
+//! core, so the reported rate includes the client's work as well as the server's.
+//!
+//! Run with `cargo bench --bench handshake_scaling`. The maximum number of threads
+//! and the number of handshakes per client thread can be set with the
+//! `S2N_SCALING_THREADS` and `S2N_SCALING_HANDSHAKES` environment variables.
+
+use s2n_tls::{
+    callbacks::{SessionTicket, SessionTicketCallback},
+    config::Config,
+    connection::Connection,
+    security::Policy,
+};
+use std::{
+    error::Error,
+    ffi::c_void,
+    net::{SocketAddr, TcpListener, TcpStream},
+    pin::Pin,
+    sync::{
+        atomic::{AtomicUsize, Ordering},
+        Arc, Barrier, Mutex,
+    },
+    task::Poll,
+    thread,
+    time::{Duration, Instant, SystemTime},
+};
+use tls_harness::{
+    cohort::s2n_tls::{
+        generic_recv_cb, generic_send_cb, KEY_NAME, KEY_VALUE, LOCALHOST_VERIFY_CALLBACK,
+    },
+    harness::read_to_bytes,
+    PemType::*,
+    SigType,
+};
+
+const DEFAULT_HANDSHAKES_PER_THREAD: usize = 500;
+
+#[derive(Clone, Copy, Debug)]
+enum Scenario {
+    Rsa,
+    Ecdsa,
+    PqHybrid,
+    Resumption,
+}
+
+impl Scenario {
+    const ALL: [Scenario; 4] = [
+        Scenario::Rsa,
+        Scenario::Ecdsa,
+        Scenario::PqHybrid,
+        Scenario::Resumption,
+    ];
+
+    fn sig_type(&self) -> SigType {
+        match self {
+            Scenario::Rsa => SigType::Rsa2048,
+            _ => SigType::Ecdsa256,
+        }
+    }
+
+    fn security_policy(&self) -> &'static str {
+        match self {
+            // ML-KEM hybrid key exchange
+            Scenario::PqHybrid => "default_pq",
+            // TLS_AES_128_GCM_SHA256 with x25519
+            _ => "20240417",
+        }
+    }
+
+    fn resumption(&self) -> bool {
+        matches!(self, Scenario::Resumption)
+    }
+
+    fn server_config(&self) -> Result<Config, Box<dyn Error>> {
+        let mut builder = s2n_tls::config::Builder::new();
+        builder
+            .set_security_policy(&Policy::from_version(self.security_policy())?)?
+            .with_system_certs(false)?
+            .load_pem(
+                read_to_bytes(ServerCertChain, self.sig_type()).as_slice(),
+                read_to_bytes(ServerKey, self.sig_type()).as_slice(),
+            )?;
+        if self.resumption() {
+            builder
+                .enable_session_tickets(true)?
+                .add_session_ticket_key(
+                    KEY_NAME.as_bytes(),
+                    KEY_VALUE.as_slice(),
+                    // use a time that we are sure is in the past to
+                    // make the key immediately available
+                    SystemTime::UNIX_EPOCH,
+                )?;
+        }
+        Ok(builder.build()?)
+    }
+
+    fn client_config(&self, tickets: &TicketSlot) -> Result<Config, Box<dyn Error>> {
+        let mut builder = s2n_tls::config::Builder::new();
+        builder
+            .set_security_policy(&Policy::from_version(self.security_policy())?)?
+            .with_system_certs(false)?
+            .trust_pem(read_to_bytes(CACert, self.sig_type()).as_slice())?
+            .set_verify_host_callback(LOCALHOST_VERIFY_CALLBACK)?;
+        if self.resumption() {
+            builder
+                .enable_session_tickets(true)?
+                .set_session_ticket_callback(tickets.clone())?;
+        }
+        Ok(builder.build()?)
+    }
+}
+
+/// Holds the most recent session ticket received by a client thread.
+///
+/// Each client thread has its own config and slot, so that clients never compete
+/// for tickets and the only shared state is on the server.
+#[derive(Clone, Default)]
+struct TicketSlot(Arc<Mutex<Option<Vec<u8>>>>);
+
+impl SessionTicketCallback for TicketSlot {
+    fn on_session_ticket(&self, _connection: &mut Connection, session_ticket: &SessionTicket) {
+        let mut ticket = vec![0; session_ticket.len().unwrap()];
+        session_ticket.data(&mut ticket).unwrap();
+        let _ = self.0.lock().unwrap().insert(ticket);
+    }
+}
+
+/// A connection using blocking socket IO.
+struct SocketConnection {
+    connection: Connection,
+    // The connection holds a pointer to the stream, so it must not move
+    _stream: Pin<Box<TcpStream>>,
+}
+
+impl SocketConnection {
+    fn new(
+        mut connection: Connection,
+        stream: TcpStream,
+    ) -> Result<SocketConnection, Box<dyn Error>> {
+        stream.set_nodelay(true)?;
+        let mut stream = Box::pin(stream);
+        connection
+            .set_send_callback(Some(generic_send_cb::<TcpStream>))?
+            .set_receive_callback(Some(generic_recv_cb::<TcpStream>))?;
+        unsafe {
+            let context = &mut *stream as *mut TcpStream as *mut c_void;
+            connection
+                .set_send_context(context)?
+                .set_receive_context(context)?;
+        }
+        Ok(SocketConnection {
+            connection,
+            _stream: stream,
+        })
+    }
+
+    fn negotiate(&mut self) -> Result<(), Box<dyn Error>> {
+        loop {
+            if let Poll::Ready(result) = self.connection.poll_negotiate() {
+                result?;
+                return Ok(());
+            }
+        }
+    }
+
+    fn send_byte(&mut self) -> Result<(), Box<dyn Error>> {
+        while self.connection.poll_send(&[0])?.is_pending() {}
+        while self.connection.poll_flush()?.is_pending() {}
+        Ok(())
+    }
+
+    fn recv_byte(&mut self) -> Result<(), Box<dyn Error>> {
+        let mut byte = [0];
+        loop {
+            if let Poll::Ready(read) = self.connection.poll_recv(&mut byte) {
+                if read? == 1 {
+                    return Ok(());
+                }
+            }
+        }
+    }
+}
+
+fn serve(
+    listener: &TcpListener,
+    config: &Config,
+    remaining: &AtomicUsize,
+) -> Result<(), Box<dyn Error>> {
+    // Reserve a connection before accepting it, so that no thread waits
+    // for a connection that will never arrive
+    while remaining
+        .fetch_update(Ordering::Relaxed, Ordering::Relaxed, |n| n.checked_sub(1))
+        .is_ok()
+    {
+        let (stream, _) = listener.accept()?;
+        let mut connection = Connection::new_server();
+        connection.set_config(config.clone())?;
+        let mut conn = SocketConnection::new(connection, stream)?;
+        conn.negotiate()?;
+        // Lets the client read any session tickets before the connection closes
+        conn.send_byte()?;
+    }
+    Ok(())
+}
+
+fn connect(
+    addr: SocketAddr,
+    config: &Config,
+    tickets: &TicketSlot,
+) -> Result<Duration, Box<dyn Error>> {
+    // Only resumption clients receive tickets. The first handshake of each
+    // resumption client is a full handshake that provides the first ticket.
+    let ticket = tickets.0.lock().unwrap().take();
+
+    let start = Instant::now();
+    let stream = TcpStream::connect(addr)?;
+    let mut connection = Connection::new_client();
+    connection.set_config(config.clone())?;
+    if let Some(ticket) = &ticket {
+        connection.set_session_ticket(ticket)?;
+    }
+    let mut conn = SocketConnection::new(connection, stream)?;
+    conn.negotiate()?;
+    let elapsed = start.elapsed();
+
+    assert_eq!(conn.connection.resumed(), ticket.is_some());
+    conn.recv_byte()?;
+    Ok(elapsed)
+}
+
+struct Measurement {
+    handshakes_per_sec: f64,
+    p50: Duration,
+    p99: Duration,
+}
+
+fn measure(
+    scenario: Scenario,
+    threads: usize,
+    handshakes_per_thread: usize,
+) -> Result<Measurement, Box<dyn Error>> {
+    let listener = TcpListener::bind("127.0.0.1:0")?;
+    let addr = listener.local_addr()?;
+    let server_config = scenario.server_config()?;
+    let remaining = AtomicUsize::new(threads * handshakes_per_thread);
+    // Clients start together, once every thread has finished its setup
+    let start = Barrier::new(threads + 1);
+
+    let (elapsed, mut latencies) = thread::scope(|s| -> Result<_, Box<dyn Error>> {
+        for _ in 0..threads {
+            s.spawn(|| serve(&listener, &server_config, &remaining).unwrap());
+        }
+
+        let clients: Vec<_> = (0..threads)
+            .map(|_| {
+                s.spawn(|| {
+                    let tickets = TicketSlot::default();
+                    let config = scenario.client_config(&tickets).unwrap();
+                    let mut latencies = Vec::with_capacity(handshakes_per_thread);
+                    start.wait();
+                    for _ in 0..handshakes_per_thread {
+                        latencies.push(connect(addr, &config, &tickets).unwrap());
+                    }
+                    latencies
+                })
+            })
+            .collect();
+
+        start.wait();
+        let began = Instant::now();
+        let mut latencies = Vec::with_capacity(threads * handshakes_per_thread);
+        for client in clients {
+            latencies.extend(client.join().unwrap());
+        }
+        Ok((began.elapsed(), latencies))
+    })?;
+
+    latencies.sort_unstable();
+    Ok(Measurement {
+        handshakes_per_sec: latencies.len() as f64 / elapsed.as_secs_f64(),
+        p50: latencies[latencies.len() / 2],
+        p99: latencies[latencies.len() * 99 / 100],
+    })
+}
+
+fn env_usize(name: &str) -> Option<usize> {
+    std::env::var(name).ok().map(|value| {
+        value
+            .parse()
+            .unwrap_or_else(|_| panic!("{name} must be a number"))
+    })
+}
+
+/// 1, 2, 4, ... up to and including `max`
+fn thread_counts(max: usize) -> Vec<usize> {
+    let mut counts: Vec<usize> = std::iter::successors(Some(1), |n| Some(n * 2))
+        .take_while(|n| *n < max)
+        .collect();
+    counts.push(max);
+    counts
+}
+
+fn main() -> Result<(), Box<dyn Error>> {
+    let max_threads = env_usize("S2N_SCALING_THREADS")
+        .unwrap_or_else(|| thread::available_parallelism().map_or(1, |n| n.get()));
+    let handshakes_per_thread =
+        env_usize("S2N_SCALING_HANDSHAKES").unwrap_or(DEFAULT_HANDSHAKES_PER_THREAD);
+
+    println!(
+        "{:<12} {:>8} {:>14} {:>10} {:>10}",
+        "scenario", "threads", "handshakes/s", "p50 (us)", "p99 (us)"
+    );
+    for scenario in Scenario::ALL {
+        for threads in thread_counts(max_threads) {
+            let result = measure(scenario, threads, handshakes_per_thread)?;
+            println!(
+                "{:<12} {:>8} {:>14.0} {:>10} {:>10}",
+                format!("{scenario:?}"),
+                threads,
+                result.handshakes_per_sec,
+                result.p50.as_micros(),
+                result.p99.as_micros()
+            );
+        }
+    }
+    Ok(())
+}
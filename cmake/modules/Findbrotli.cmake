@@ -0,0 +1,83 @@
+# - Try to find the brotli encoder and decoder include dirs and libraries
+#
+# Usage of this module as follows:
+#
+#     find_package(brotli)
+#
+# Variables defined by this module:
+#
+#  brotli_FOUND             System has brotli, include and library dirs found
+#  brotli_INCLUDE_DIR       The brotli include directories.
+#  brotli_ENC_LIBRARY       The path to libbrotlienc
+#  brotli_DEC_LIBRARY       The path to libbrotlidec
+#  brotli_COMMON_LIBRARY    The path to libbrotlicommon, which both of the above depend on
+#
+# Imported targets defined by this module:
+#
+#  brotli::brotlienc
+#  brotli::brotlidec
+#  brotli::brotlicommon
+
+find_path(brotli_INCLUDE_DIR
+    NAMES brotli/encode.h brotli/decode.h
+    HINTS
+    "${CMAKE_PREFIX_PATH}"
+    "${CMAKE_INSTALL_PREFIX}"
+    PATH_SUFFIXES include
+)
+
+foreach(component ENC DEC COMMON)
+    string(TOLOWER ${component} lib_suffix)
+    find_library(brotli_${component}_LIBRARY
+        NAMES brotli${lib_suffix}
+        HINTS
+        "${CMAKE_PREFIX_PATH}"
+        "${CMAKE_INSTALL_PREFIX}"
+        PATH_SUFFIXES lib64 lib
+    )
+endforeach()
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(brotli DEFAULT_MSG
+    brotli_ENC_LIBRARY
+    brotli_DEC_LIBRARY
+    brotli_COMMON_LIBRARY
+    brotli_INCLUDE_DIR
+)
+
+mark_as_advanced(
+    brotli_INCLUDE_DIR
+    brotli_ENC_LIBRARY
+    brotli_DEC_LIBRARY
+    brotli_COMMON_LIBRARY
+)
+
+if(brotli_FOUND OR BROTLI_FOUND)
+    set(BROTLI_FOUND true)
+    set(brotli_FOUND true)
+
+    message(STATUS "brotli Include Dir: ${brotli_INCLUDE_DIR}")
+    message(STATUS "brotli Libraries:   ${brotli_ENC_LIBRARY} ${brotli_DEC_LIBRARY} ${brotli_COMMON_LIBRARY}")
+
+    if (NOT TARGET brotli::brotlicommon)
+        add_library(brotli::brotlicommon UNKNOWN IMPORTED)
+        set_target_properties(brotli::brotlicommon PROPERTIES
+                INTERFACE_INCLUDE_DIRECTORIES "${brotli_INCLUDE_DIR}"
+                IMPORTED_LINK_INTERFACE_LANGUAGES "C"
+                IMPORTED_LOCATION "${brotli_COMMON_LIBRARY}")
+    endif()
+
+    # The static encoder and decoder don't carry their dependency on brotlicommon,
+    # so it is added to their link interface explicitly.
+    foreach(component ENC DEC)
+        string(TOLOWER ${component} lib_suffix)
+        if (NOT TARGET brotli::brotli${lib_suffix})
+            add_library(brotli::brotli${lib_suffix} UNKNOWN IMPORTED)
+            set_target_properties(brotli::brotli${lib_suffix} PROPERTIES
+                    INTERFACE_INCLUDE_DIRECTORIES "${brotli_INCLUDE_DIR}"
+                    INTERFACE_LINK_LIBRARIES brotli::brotlicommon
+                    IMPORTED_LINK_INTERFACE_LANGUAGES "C"
+                    IMPORTED_LOCATION "${brotli_${component}_LIBRARY}")
+        endif()
+    endforeach()
+endif()
@@ -0,0 +1,58 @@
+# - Try to find the zstd include dirs and library
+#
+# Usage of this module as follows:
+#
+#     find_package(zstd)
+#
+# Variables defined by this module:
+#
+#  zstd_FOUND               System has zstd, include and library dirs found
+#  zstd_INCLUDE_DIR         The zstd include directories.
+#  zstd_LIBRARY             The path to libzstd
+#
+# Imported targets defined by this module:
+#
+#  zstd::zstd
+
+find_path(zstd_INCLUDE_DIR
+    NAMES zstd.h
+    HINTS
+    "${CMAKE_PREFIX_PATH}"
+    "${CMAKE_INSTALL_PREFIX}"
+    PATH_SUFFIXES include
+)
+
+find_library(zstd_LIBRARY
+    NAMES zstd
+    HINTS
+    "${CMAKE_PREFIX_PATH}"
+    "${CMAKE_INSTALL_PREFIX}"
+    PATH_SUFFIXES lib64 lib
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(zstd DEFAULT_MSG
+    zstd_LIBRARY
+    zstd_INCLUDE_DIR
+)
+
+mark_as_advanced(
+    zstd_INCLUDE_DIR
+    zstd_LIBRARY
+)
+
+if(zstd_FOUND OR ZSTD_FOUND)
+    set(ZSTD_FOUND true)
+    set(zstd_FOUND true)
+
+    message(STATUS "zstd Include Dir: ${zstd_INCLUDE_DIR}")
+    message(STATUS "zstd Library:     ${zstd_LIBRARY}")
+
+    if (NOT TARGET zstd::zstd)
+        add_library(zstd::zstd UNKNOWN IMPORTED)
+        set_target_properties(zstd::zstd PROPERTIES
+                INTERFACE_INCLUDE_DIRECTORIES "${zstd_INCLUDE_DIR}"
+                IMPORTED_LINK_INTERFACE_LANGUAGES "C"
+                IMPORTED_LOCATION "${zstd_LIBRARY}")
+    endif()
+endif()
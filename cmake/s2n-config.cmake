@@ -8,6 +8,16 @@ endif()
 list(APPEND CMAKE_MODULE_PATH "${CMAKE_CURRENT_LIST_DIR}/modules")
 find_dependency(crypto)
 
+if (@S2N_CERT_COMPRESSION@)
+    find_dependency(ZLIB)
+    if (@S2N_CERT_COMPRESSION_BROTLI@)
+        find_dependency(brotli)
+    endif()
+    if (@S2N_CERT_COMPRESSION_ZSTD@)
+        find_dependency(zstd)
+    endif()
+endif()
+
 # Allow static or shared lib to be used.
 # If both are installed, choose based on BUILD_SHARED_LIBS.
 if (BUILD_SHARED_LIBS)
@@ -147,9 +147,29 @@ int s2n_cert_chain_and_key_set_private_key(struct s2n_cert_chain_and_key *cert_a
     return S2N_SUCCESS;
 }
 
+/* Frees the compressed Certificate messages of every variant from first_variant on.
+ * Variant 0 carries no extensions, so it does not depend on the OCSP status or SCT list.
+ */
+static int s2n_cert_chain_and_key_free_compressed_certs(struct s2n_cert_chain_and_key *chain_and_key, size_t first_variant)
+{
+    POSIX_ENSURE_REF(chain_and_key);
+    for (size_t i = 0; i < S2N_CERT_COMPRESSION_ALGORITHMS_COUNT; i++) {
+        for (size_t j = first_variant; j < S2N_CERT_COMPRESSION_VARIANTS_COUNT; j++) {
+            struct s2n_compressed_cert *compressed = chain_and_key->compressed_certs[i][j];
+            if (compressed) {
+                POSIX_GUARD(s2n_free(&compressed->data));
+                POSIX_GUARD(s2n_free_object((uint8_t **) &chain_and_key->compressed_certs[i][j],
+                        sizeof(struct s2n_compressed_cert)));
+            }
+        }
+    }
+    return S2N_SUCCESS;
+}
+
 int s2n_cert_chain_and_key_set_ocsp_data(struct s2n_cert_chain_and_key *chain_and_key, const uint8_t *data, uint32_t length)
 {
     POSIX_ENSURE_REF(chain_and_key);
+    POSIX_GUARD(s2n_cert_chain_and_key_free_compressed_certs(chain_and_key, 1));
     POSIX_GUARD(s2n_free(&chain_and_key->ocsp_status));
     if (data && length) {
         POSIX_GUARD(s2n_alloc(&chain_and_key->ocsp_status, length));
@@ -161,6 +181,7 @@ int s2n_cert_chain_and_key_set_ocsp_data(struct s2n_cert_chain_and_key *chain_an
 int s2n_cert_chain_and_key_set_sct_list(struct s2n_cert_chain_and_key *chain_and_key, const uint8_t *data, uint32_t length)
 {
     POSIX_ENSURE_REF(chain_and_key);
+    POSIX_GUARD(s2n_cert_chain_and_key_free_compressed_certs(chain_and_key, 1));
     POSIX_GUARD(s2n_free(&chain_and_key->sct_list));
     if (data && length) {
         POSIX_GUARD(s2n_alloc(&chain_and_key->sct_list, length));
@@ -468,6 +489,8 @@ int s2n_cert_chain_and_key_free(struct s2n_cert_chain_and_key *cert_and_key)
     POSIX_GUARD(s2n_free(&cert_and_key->ocsp_status));
     POSIX_GUARD(s2n_free(&cert_and_key->sct_list));
 
+    POSIX_GUARD(s2n_cert_chain_and_key_free_compressed_certs(cert_and_key, 0));
+
     POSIX_GUARD(s2n_free_object((uint8_t **) &cert_and_key, sizeof(struct s2n_cert_chain_and_key)));
     return 0;
 }
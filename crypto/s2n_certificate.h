@@ -15,6 +15,7 @@
 
 #pragma once
 
+#include <openssl/sha.h>
 #include <openssl/x509.h>
 #include <stdint.h>
 
@@ -24,6 +25,14 @@
 
 #define S2N_CERT_TYPE_COUNT S2N_PKEY_TYPE_SENTINEL
 
+/* One compressed Certificate message per s2n_cert_compression_algorithm */
+#define S2N_CERT_COMPRESSION_ALGORITHMS_COUNT 3
+/* ... and per combination of the per-certificate extensions that the message carries.
+ * Each bit is one entry of S2N_EXTENSION_LIST_CERTIFICATE: the OCSP status and SCT list.
+ */
+#define S2N_CERT_COMPRESSION_EXTENSIONS_COUNT 2
+#define S2N_CERT_COMPRESSION_VARIANTS_COUNT   (1 << S2N_CERT_COMPRESSION_EXTENSIONS_COUNT)
+
 struct s2n_cert_info {
     int signature_nid;
     /* This field is not populated for RSA_PSS or ML-DSA signatures */
@@ -49,6 +58,11 @@ struct s2n_cert_chain {
     struct s2n_cert *head;
 };
 
+struct s2n_compressed_cert {
+    struct s2n_blob data;
+    uint32_t uncompressed_length;
+};
+
 struct s2n_cert_chain_and_key {
     struct s2n_cert_chain *cert_chain;
     s2n_cert_private_key *private_key;
@@ -63,6 +77,15 @@ struct s2n_cert_chain_and_key {
      * server_name extension. Decoded as UTF8.
      */
     struct s2n_array *cn_names;
+    /* TLS1.3 Certificate messages compressed for the certificate compression algorithms
+     * configured by the server. Indexed by s2n_cert_compression_algorithm - 1, then by
+     * which per-certificate extensions the message carries (see s2n_cert_compression_get_variant).
+     * Messages without extensions are compressed ahead of time, the others on first use.
+     * A chain can be shared by many configs and connections, so each entry is
+     * published once with s2n_atomic_ptr_compare_exchange and never modified afterwards.
+     * Entries with extensions are dropped when the OCSP status or SCT list is replaced.
+     */
+    struct s2n_compressed_cert *compressed_certs[S2N_CERT_COMPRESSION_ALGORITHMS_COUNT][S2N_CERT_COMPRESSION_VARIANTS_COUNT];
     /* Application defined data related to this cert. */
     void *context;
 };
@@ -58,8 +58,9 @@ static int s2n_custom_hkdf_extract(struct s2n_hmac_state *hmac, s2n_hmac_algorit
     return S2N_SUCCESS;
 }
 
-static int s2n_custom_hkdf_expand(struct s2n_hmac_state *hmac, s2n_hmac_algorithm alg,
-        const struct s2n_blob *pseudo_rand_key, const struct s2n_blob *info, struct s2n_blob *output)
+/* Expects the hmac to already be keyed with the pseudorandom key */
+static int s2n_custom_hkdf_expand_with_keyed_hmac(struct s2n_hmac_state *hmac, s2n_hmac_algorithm alg,
+        const struct s2n_blob *info, struct s2n_blob *output)
 {
     uint8_t prev[MAX_DIGEST_SIZE] = { 0 };
 
@@ -67,6 +68,7 @@ static int s2n_custom_hkdf_expand(struct s2n_hmac_state *hmac, s2n_hmac_algorith
     uint8_t hash_len = 0;
     POSIX_GUARD(s2n_hmac_digest_size(alg, &hash_len));
     POSIX_ENSURE_GT(hash_len, 0);
+    POSIX_ENSURE_EQ(hmac->alg, alg);
     uint32_t total_rounds = output->size / hash_len;
     if (output->size % hash_len) {
         total_rounds++;
@@ -77,7 +79,6 @@ static int s2n_custom_hkdf_expand(struct s2n_hmac_state *hmac, s2n_hmac_algorith
 
     for (uint32_t curr_round = 1; curr_round <= total_rounds; curr_round++) {
         uint32_t cat_len = 0;
-        POSIX_GUARD(s2n_hmac_init(hmac, alg, pseudo_rand_key->data, pseudo_rand_key->size));
         if (curr_round != 1) {
             POSIX_GUARD(s2n_hmac_update(hmac, prev, hash_len));
         }
@@ -95,12 +96,21 @@ static int s2n_custom_hkdf_expand(struct s2n_hmac_state *hmac, s2n_hmac_algorith
 
         done_len += cat_len;
 
+        /* Every round uses the same key, so restore the keyed state rather than re-keying */
         POSIX_GUARD(s2n_hmac_reset(hmac));
     }
 
     return S2N_SUCCESS;
 }
 
+static int s2n_custom_hkdf_expand(struct s2n_hmac_state *hmac, s2n_hmac_algorithm alg,
+        const struct s2n_blob *pseudo_rand_key, const struct s2n_blob *info, struct s2n_blob *output)
+{
+    POSIX_GUARD(s2n_hmac_init(hmac, alg, pseudo_rand_key->data, pseudo_rand_key->size));
+    POSIX_GUARD(s2n_custom_hkdf_expand_with_keyed_hmac(hmac, alg, info, output));
+    return S2N_SUCCESS;
+}
+
 static int s2n_custom_hkdf(struct s2n_hmac_state *hmac, s2n_hmac_algorithm alg, const struct s2n_blob *salt,
         const struct s2n_blob *key, const struct s2n_blob *info, struct s2n_blob *output)
 {
@@ -347,35 +357,66 @@ static int s2n_hkdf_expand(struct s2n_hmac_state *hmac, s2n_hmac_algorithm alg,
     return S2N_SUCCESS;
 }
 
-int s2n_hkdf_expand_label(struct s2n_hmac_state *hmac, s2n_hmac_algorithm alg, const struct s2n_blob *secret, const struct s2n_blob *label,
-        const struct s2n_blob *context, struct s2n_blob *output)
+static int s2n_hkdf_label_init(const struct s2n_blob *label, const struct s2n_blob *context, uint32_t output_size,
+        struct s2n_blob *hkdf_label_blob)
 {
     POSIX_ENSURE_REF(label);
     POSIX_ENSURE_REF(context);
-    POSIX_ENSURE_REF(output);
 
-    /* Per RFC8446: 7.1, a HKDF label is a 2 byte length field, and two 1...255 byte arrays with a one byte length field each. */
-    uint8_t hkdf_label_buf[2 + 256 + 256];
-    struct s2n_blob hkdf_label_blob = { 0 };
     struct s2n_stuffer hkdf_label = { 0 };
 
     POSIX_ENSURE_LTE(label->size, S2N_MAX_HKDF_EXPAND_LABEL_LENGTH);
 
-    POSIX_GUARD(s2n_blob_init(&hkdf_label_blob, hkdf_label_buf, sizeof(hkdf_label_buf)));
-    POSIX_GUARD(s2n_stuffer_init(&hkdf_label, &hkdf_label_blob));
-    POSIX_GUARD(s2n_stuffer_write_uint16(&hkdf_label, output->size));
+    POSIX_GUARD(s2n_stuffer_init(&hkdf_label, hkdf_label_blob));
+    POSIX_GUARD(s2n_stuffer_write_uint16(&hkdf_label, output_size));
     POSIX_GUARD(s2n_stuffer_write_uint8(&hkdf_label, label->size + sizeof("tls13 ") - 1));
     POSIX_GUARD(s2n_stuffer_write_str(&hkdf_label, "tls13 "));
     POSIX_GUARD(s2n_stuffer_write(&hkdf_label, label));
     POSIX_GUARD(s2n_stuffer_write_uint8(&hkdf_label, context->size));
     POSIX_GUARD(s2n_stuffer_write(&hkdf_label, context));
 
-    hkdf_label_blob.size = s2n_stuffer_data_available(&hkdf_label);
+    hkdf_label_blob->size = s2n_stuffer_data_available(&hkdf_label);
+    return S2N_SUCCESS;
+}
+
+int s2n_hkdf_expand_label(struct s2n_hmac_state *hmac, s2n_hmac_algorithm alg, const struct s2n_blob *secret, const struct s2n_blob *label,
+        const struct s2n_blob *context, struct s2n_blob *output)
+{
+    POSIX_ENSURE_REF(output);
+
+    /* Per RFC8446: 7.1, a HKDF label is a 2 byte length field, and two 1...255 byte arrays with a one byte length field each. */
+    uint8_t hkdf_label_buf[2 + 256 + 256];
+    struct s2n_blob hkdf_label_blob = { 0 };
+    POSIX_GUARD(s2n_blob_init(&hkdf_label_blob, hkdf_label_buf, sizeof(hkdf_label_buf)));
+    POSIX_GUARD(s2n_hkdf_label_init(label, context, output->size, &hkdf_label_blob));
+
     POSIX_GUARD(s2n_hkdf_expand(hmac, alg, secret, &hkdf_label_blob, output));
 
     return S2N_SUCCESS;
 }
 
+bool s2n_hkdf_supports_keyed_hmac()
+{
+    return s2n_get_hkdf_implementation() == &s2n_custom_hkdf_impl;
+}
+
+int s2n_hkdf_expand_label_with_keyed_hmac(struct s2n_hmac_state *keyed_hmac, s2n_hmac_algorithm alg,
+        const struct s2n_blob *label, const struct s2n_blob *context, struct s2n_blob *output)
+{
+    POSIX_ENSURE_REF(keyed_hmac);
+    POSIX_ENSURE_REF(output);
+    POSIX_ENSURE(s2n_hkdf_supports_keyed_hmac(), S2N_ERR_UNIMPLEMENTED);
+
+    uint8_t hkdf_label_buf[2 + 256 + 256];
+    struct s2n_blob hkdf_label_blob = { 0 };
+    POSIX_GUARD(s2n_blob_init(&hkdf_label_blob, hkdf_label_buf, sizeof(hkdf_label_buf)));
+    POSIX_GUARD(s2n_hkdf_label_init(label, context, output->size, &hkdf_label_blob));
+
+    POSIX_GUARD(s2n_custom_hkdf_expand_with_keyed_hmac(keyed_hmac, alg, &hkdf_label_blob, output));
+
+    return S2N_SUCCESS;
+}
+
 int s2n_hkdf(struct s2n_hmac_state *hmac, s2n_hmac_algorithm alg, const struct s2n_blob *salt,
         const struct s2n_blob *key, const struct s2n_blob *info, struct s2n_blob *output)
 {
@@ -39,4 +39,12 @@ int s2n_hkdf_extract(struct s2n_hmac_state *hmac, s2n_hmac_algorithm alg, const
 int s2n_hkdf_expand_label(struct s2n_hmac_state *hmac, s2n_hmac_algorithm alg, const struct s2n_blob *secret, const struct s2n_blob *label,
         const struct s2n_blob *context, struct s2n_blob *output);
 
+/* HKDF-Expand-Label with an hmac that the caller has already keyed with the secret,
+ * so that several labels expanded from the same secret only pay for one hmac key schedule.
+ * Only the custom HKDF implementation accepts a keyed hmac: check s2n_hkdf_supports_keyed_hmac first.
+ */
+bool s2n_hkdf_supports_keyed_hmac();
+int s2n_hkdf_expand_label_with_keyed_hmac(struct s2n_hmac_state *keyed_hmac, s2n_hmac_algorithm alg,
+        const struct s2n_blob *label, const struct s2n_blob *context, struct s2n_blob *output);
+
 bool s2n_libcrypto_supports_hkdf();
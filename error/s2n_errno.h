@@ -149,6 +149,7 @@ typedef enum {
     S2N_ERR_EARLY_DATA_TRIAL_DECRYPT,
     S2N_ERR_NO_RENEGOTIATION,
     S2N_ERR_KTLS_KEYUPDATE,
+    S2N_ERR_CERT_DECOMPRESSION,
     S2N_ERR_T_PROTO_END,
 
     /* S2N_ERR_T_INTERNAL */
@@ -242,6 +243,7 @@ typedef enum {
     S2N_ERR_TEST_ASSERTION,
     S2N_ERR_CONFIG_NULL_BEFORE_CH_CALLBACK,
     S2N_ERR_ZERO_LIFETIME_TICKET,
+    S2N_ERR_CERT_COMPRESSION,
     S2N_ERR_T_INTERNAL_END,
 
     /* S2N_ERR_T_USAGE */
@@ -336,6 +338,7 @@ typedef enum {
     S2N_ERR_TOO_MANY_CAS,
     S2N_ERR_API_UNSUPPORTED_BY_LIBCRYPTO,
     S2N_ERR_FIPS_MODE_UNSUPPORTED,
+    S2N_ERR_SESSION_ID_NOT_FOUND,
     S2N_ERR_T_USAGE_END,
 } s2n_error;
 
@@ -0,0 +1,300 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "benchmark/harness/s2n_benchmark.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define S2N_BENCHMARK_HAS_CYCLES 1
+#endif
+
+#include "api/s2n.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+static bool s2n_benchmark_json = false;
+
+/* Only allocations made through s2n_alloc / s2n_realloc are counted.
+ * Allocations made directly by the libcrypto are not visible to s2n-tls.
+ */
+static uint64_t s2n_benchmark_allocations = 0;
+static s2n_mem_malloc_callback s2n_benchmark_malloc_cb_backup = NULL;
+static s2n_mem_free_callback s2n_benchmark_free_cb_backup = NULL;
+
+/* Memory allocated before the callbacks were wrapped may be freed later,
+ * so only differences between two points in time are meaningful.
+ */
+static int64_t s2n_benchmark_heap_bytes = 0;
+static int64_t s2n_benchmark_heap_peak_bytes = 0;
+
+static int s2n_benchmark_malloc_cb(void **ptr, uint32_t requested, uint32_t *allocated)
+{
+    s2n_benchmark_allocations++;
+    POSIX_GUARD(s2n_benchmark_malloc_cb_backup(ptr, requested, allocated));
+
+    s2n_benchmark_heap_bytes += *allocated;
+    if (s2n_benchmark_heap_bytes > s2n_benchmark_heap_peak_bytes) {
+        s2n_benchmark_heap_peak_bytes = s2n_benchmark_heap_bytes;
+    }
+    return S2N_SUCCESS;
+}
+
+static int s2n_benchmark_free_cb(void *ptr, uint32_t size)
+{
+    s2n_benchmark_heap_bytes -= size;
+    return s2n_benchmark_free_cb_backup(ptr, size);
+}
+
+static S2N_RESULT s2n_benchmark_count_allocations(void)
+{
+    s2n_mem_init_callback mem_init_cb = NULL;
+    s2n_mem_cleanup_callback mem_cleanup_cb = NULL;
+    s2n_mem_malloc_callback mem_malloc_cb = NULL;
+    s2n_mem_free_callback mem_free_cb = NULL;
+    RESULT_GUARD(s2n_mem_get_callbacks(&mem_init_cb, &mem_cleanup_cb, &mem_malloc_cb, &mem_free_cb));
+
+    /* Wrap whichever allocator s2n_init chose, so mlock behavior is unchanged */
+    s2n_benchmark_malloc_cb_backup = mem_malloc_cb;
+    s2n_benchmark_free_cb_backup = mem_free_cb;
+    RESULT_GUARD(s2n_mem_override_callbacks(mem_init_cb, mem_cleanup_cb, s2n_benchmark_malloc_cb, s2n_benchmark_free_cb));
+    return S2N_RESULT_OK;
+}
+
+static uint64_t s2n_benchmark_now_ns(void)
+{
+    struct timespec now = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000000000) + (uint64_t) now.tv_nsec;
+}
+
+/* The timestamp counter ticks at a constant reference rate rather than the
+ * current core frequency, so disable frequency scaling for stable results.
+ */
+static uint64_t s2n_benchmark_now_cycles(void)
+{
+#if S2N_BENCHMARK_HAS_CYCLES
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+bool s2n_benchmark_has_cycles(void)
+{
+#if S2N_BENCHMARK_HAS_CYCLES
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool s2n_benchmark_has_rss(void)
+{
+#if defined(__linux__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+static int64_t s2n_benchmark_rss_bytes(void)
+{
+#if defined(__linux__)
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL) {
+        return 0;
+    }
+    long size = 0;
+    long resident = 0;
+    int fields = fscanf(statm, "%ld %ld", &size, &resident);
+    fclose(statm);
+    if (fields != 2) {
+        return 0;
+    }
+    return (int64_t) resident * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+int s2n_benchmark_init(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            s2n_benchmark_json = true;
+        } else {
+            fprintf(stderr, "usage: %s [--json]\n", argv[0]);
+            POSIX_BAIL(S2N_ERR_INVALID_ARGUMENT);
+        }
+    }
+
+    POSIX_GUARD(s2n_init());
+    POSIX_GUARD_RESULT(s2n_benchmark_count_allocations());
+    return S2N_SUCCESS;
+}
+
+int s2n_benchmark_cleanup(void)
+{
+    POSIX_GUARD(s2n_cleanup_final());
+    return S2N_SUCCESS;
+}
+
+int s2n_benchmark_set_params(struct s2n_benchmark *bench, const char *format, ...)
+{
+    POSIX_ENSURE_REF(bench);
+    POSIX_ENSURE_REF(format);
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(bench->params, sizeof(bench->params), format, args);
+    va_end(args);
+
+    POSIX_ENSURE(written >= 0 && (size_t) written < sizeof(bench->params), S2N_ERR_SAFETY);
+    return S2N_SUCCESS;
+}
+
+void s2n_benchmark_start(struct s2n_benchmark *bench)
+{
+    bench->start_rss_bytes = s2n_benchmark_rss_bytes();
+    bench->start_allocations = s2n_benchmark_allocations;
+    bench->start_heap_bytes = s2n_benchmark_heap_bytes;
+    s2n_benchmark_heap_peak_bytes = s2n_benchmark_heap_bytes;
+    bench->start_ns = s2n_benchmark_now_ns();
+    bench->start_cycles = s2n_benchmark_now_cycles();
+}
+
+void s2n_benchmark_stop(struct s2n_benchmark *bench, uint64_t ops)
+{
+    uint64_t end_cycles = s2n_benchmark_now_cycles();
+    uint64_t end_ns = s2n_benchmark_now_ns();
+
+    bench->ops = ops;
+    bench->cycles = end_cycles - bench->start_cycles;
+    bench->elapsed_ns = end_ns - bench->start_ns;
+    bench->allocations = s2n_benchmark_allocations - bench->start_allocations;
+    bench->heap_bytes = s2n_benchmark_heap_bytes - bench->start_heap_bytes;
+    bench->heap_peak_bytes = s2n_benchmark_heap_peak_bytes - bench->start_heap_bytes;
+    bench->rss_bytes = s2n_benchmark_rss_bytes() - bench->start_rss_bytes;
+}
+
+void s2n_benchmark_sample_start(struct s2n_benchmark *bench)
+{
+    bench->start_allocations = s2n_benchmark_allocations;
+    bench->start_ns = s2n_benchmark_now_ns();
+    bench->start_cycles = s2n_benchmark_now_cycles();
+}
+
+void s2n_benchmark_sample_stop(struct s2n_benchmark *bench)
+{
+    uint64_t end_cycles = s2n_benchmark_now_cycles();
+    uint64_t end_ns = s2n_benchmark_now_ns();
+
+    uint64_t elapsed_ns = end_ns - bench->start_ns;
+    bench->ops++;
+    bench->cycles += end_cycles - bench->start_cycles;
+    bench->elapsed_ns += elapsed_ns;
+    bench->allocations += s2n_benchmark_allocations - bench->start_allocations;
+    if (bench->samples_len < bench->samples_capacity) {
+        bench->samples_ns[bench->samples_len] = elapsed_ns;
+        bench->samples_len++;
+    }
+}
+
+static int s2n_benchmark_compare_samples(const void *a, const void *b)
+{
+    uint64_t left = *(const uint64_t *) a;
+    uint64_t right = *(const uint64_t *) b;
+    return (left > right) - (left < right);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static uint64_t s2n_benchmark_percentile(const struct s2n_benchmark *bench, size_t percentile)
+{
+    return bench->samples_ns[(bench->samples_len - 1) * percentile / 100];
+}
+
+int s2n_benchmark_report(const struct s2n_benchmark *bench)
+{
+    POSIX_ENSURE_REF(bench);
+    POSIX_ENSURE_REF(bench->name);
+    POSIX_ENSURE_GT(bench->ops, 0);
+
+    const double ops = (double) bench->ops;
+    const double ns_per_op = bench->elapsed_ns / ops;
+    const double cycles_per_op = bench->cycles / ops;
+    const double allocs_per_op = bench->allocations / ops;
+    const double heap_bytes_per_op = bench->heap_bytes / ops;
+    const double heap_peak_bytes_per_op = bench->heap_peak_bytes / ops;
+    const bool has_cycles = s2n_benchmark_has_cycles();
+    const bool has_rss = s2n_benchmark_has_rss();
+    const bool has_bytes = bench->bytes_per_op > 0;
+    const bool has_samples = bench->samples_len > 0;
+    if (has_samples) {
+        POSIX_ENSURE_REF(bench->samples_ns);
+        qsort(bench->samples_ns, bench->samples_len, sizeof(bench->samples_ns[0]), s2n_benchmark_compare_samples);
+    }
+
+    /* Names and params are internal constants, so never need escaping */
+    if (s2n_benchmark_json) {
+        printf("{\"name\":\"%s\",\"params\":\"%s\",\"ops\":%" PRIu64 ",\"bytes_per_op\":%" PRIu64
+               ",\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"heap_bytes_per_op\":%.1f,\"heap_peak_bytes_per_op\":%.1f",
+                bench->name, bench->params, bench->ops, bench->bytes_per_op, ns_per_op, allocs_per_op,
+                heap_bytes_per_op, heap_peak_bytes_per_op);
+        if (has_cycles) {
+            printf(",\"cycles_per_op\":%.1f", cycles_per_op);
+        }
+        if (has_cycles && has_bytes) {
+            printf(",\"cycles_per_byte\":%.3f", cycles_per_op / bench->bytes_per_op);
+        }
+        if (has_rss) {
+            printf(",\"rss_bytes_per_op\":%.1f", bench->rss_bytes / ops);
+        }
+        if (has_samples) {
+            printf(",\"p50_ns\":%" PRIu64 ",\"p90_ns\":%" PRIu64 ",\"p99_ns\":%" PRIu64 ",\"max_ns\":%" PRIu64,
+                    s2n_benchmark_percentile(bench, 50), s2n_benchmark_percentile(bench, 90),
+                    s2n_benchmark_percentile(bench, 99), s2n_benchmark_percentile(bench, 100));
+        }
+        printf("}\n");
+    } else {
+        printf("%s %s ns_per_op=%.1f allocs_per_op=%.2f heap_bytes_per_op=%.1f heap_peak_bytes_per_op=%.1f",
+                bench->name, bench->params, ns_per_op, allocs_per_op, heap_bytes_per_op, heap_peak_bytes_per_op);
+        if (has_cycles) {
+            printf(" cycles_per_op=%.1f", cycles_per_op);
+        }
+        if (has_cycles && has_bytes) {
+            printf(" cycles_per_byte=%.2f", cycles_per_op / bench->bytes_per_op);
+        }
+        if (has_rss) {
+            printf(" rss_bytes_per_op=%.1f", bench->rss_bytes / ops);
+        }
+        if (has_samples) {
+            printf(" p50_ns=%" PRIu64 " p90_ns=%" PRIu64 " p99_ns=%" PRIu64 " max_ns=%" PRIu64,
+                    s2n_benchmark_percentile(bench, 50), s2n_benchmark_percentile(bench, 90),
+                    s2n_benchmark_percentile(bench, 99), s2n_benchmark_percentile(bench, 100));
+        }
+        printf("\n");
+    }
+
+    fflush(stdout);
+    return S2N_SUCCESS;
+}
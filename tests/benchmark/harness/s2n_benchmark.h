@@ -0,0 +1,82 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define S2N_BENCHMARK_PARAMS_LEN 128
+
+/* A single measurement of a benchmarked operation.
+ *
+ * `name` identifies the operation and `params` the variant being measured, as space
+ * separated key=value pairs. Together they should be stable between runs so that
+ * results from two builds can be matched up and compared.
+ */
+struct s2n_benchmark {
+    const char *name;
+    char params[S2N_BENCHMARK_PARAMS_LEN];
+    /* Payload bytes processed by each operation, or 0 if the operation has no payload */
+    uint64_t bytes_per_op;
+
+    uint64_t ops;
+    uint64_t elapsed_ns;
+    uint64_t cycles;
+    uint64_t allocations;
+    /* Change in live s2n-tls heap memory, and the most that was live at once, relative to the start */
+    int64_t heap_bytes;
+    int64_t heap_peak_bytes;
+    /* Change in resident set size, which includes memory allocated by the libcrypto */
+    int64_t rss_bytes;
+
+    /* Optional storage for the latency of each sample, so that the report includes percentiles */
+    uint64_t *samples_ns;
+    size_t samples_capacity;
+    size_t samples_len;
+
+    uint64_t start_ns;
+    uint64_t start_cycles;
+    uint64_t start_allocations;
+    int64_t start_heap_bytes;
+    int64_t start_rss_bytes;
+};
+
+/* Parses the harness arguments, initializes s2n-tls and starts counting allocations.
+ *
+ * Supported arguments:
+ *   --json    Report one JSON object per line instead of human readable text
+ */
+int s2n_benchmark_init(int argc, char **argv);
+int s2n_benchmark_cleanup(void);
+
+int s2n_benchmark_set_params(struct s2n_benchmark *bench, const char *format, ...);
+/* Starting a benchmark resets the peak heap usage, so benchmarks that overlap must start together */
+void s2n_benchmark_start(struct s2n_benchmark *bench);
+void s2n_benchmark_stop(struct s2n_benchmark *bench, uint64_t ops);
+/* Times a single operation and adds it to the benchmark, for operations that can't be run
+ * in a tight loop. A sample that is started but never stopped is discarded. Heap and
+ * resident set sizes are not measured for samples.
+ */
+void s2n_benchmark_sample_start(struct s2n_benchmark *bench);
+void s2n_benchmark_sample_stop(struct s2n_benchmark *bench);
+/* Sorts any recorded samples in place */
+int s2n_benchmark_report(const struct s2n_benchmark *bench);
+
+/* Whether cycle counts are available on this platform */
+bool s2n_benchmark_has_cycles(void);
+/* Whether resident set sizes are available on this platform */
+bool s2n_benchmark_has_rss(void);
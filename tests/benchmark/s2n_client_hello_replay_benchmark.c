@@ -0,0 +1,336 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Replays a corpus of ClientHellos through a server connection.
+ *
+ * Each ClientHello is measured in phases, and each phase reports the distribution of
+ * its per-ClientHello cost:
+ *   parse    Parsing the message and its extension list, up to the ClientHello callback
+ *   process  Resolving the certificate, processing the extensions, and choosing the
+ *            protocol version, cipher suite, groups, signature scheme and certificate
+ *   ja3/ja4  Calculating the fingerprint hash
+ * The ServerHello is never sent, so no key shares are generated and nothing is signed.
+ * Parsing the client's key shares is still included in the process phase. ClientHellos
+ * that the server rejects are included in the parse and process phases, and counted.
+ *
+ * The corpus is a text file with one hex encoded ClientHello handshake message, including
+ * its 4-byte header, per line. Lines starting with '#' are ignored. The client_hello_corpus
+ * tool in tests/pcap exports the ClientHellos from the test packet captures in this format.
+ * Without a corpus, ClientHellos are generated by s2n-tls clients using every security policy.
+ *
+ * Environment variables:
+ *   S2N_CLIENT_HELLO_CORPUS        Corpus file to replay
+ *   S2N_CLIENT_HELLO_REPLAY_ROUNDS Times to replay the corpus (default 10)
+ *
+ * Build with -DS2N_BENCHMARKS=ON and run from tests/unit, so the test certificates are found:
+ *   S2N_DONT_MLOCK=1 ../../build/bin/s2n_client_hello_replay_benchmark [--json]
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "api/s2n.h"
+#include "api/unstable/fingerprint.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_security_policies.h"
+#include "tls/s2n_tls.h"
+#include "utils/s2n_array.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_REPLAY_DEFAULT_ROUNDS       10
+#define S2N_REPLAY_HANDSHAKE_HEADER_LEN 4
+#define S2N_REPLAY_CLIENT_HELLO         1
+#define S2N_REPLAY_MAX_HASH_LEN         128
+
+static const char *s2n_replay_server_policies[] = { "default_tls13", "default_pq" };
+
+/* The phases of one ClientHello, timed separately */
+struct s2n_replay_phases {
+    struct s2n_benchmark parse;
+    struct s2n_benchmark process;
+    struct s2n_benchmark ja3;
+    struct s2n_benchmark ja4;
+};
+
+static S2N_CLEANUP_RESULT s2n_replay_corpus_free(struct s2n_array **corpus)
+{
+    RESULT_ENSURE_REF(corpus);
+    if (*corpus == NULL) {
+        return S2N_RESULT_OK;
+    }
+    uint32_t len = 0;
+    RESULT_GUARD(s2n_array_num_elements(*corpus, &len));
+    for (uint32_t i = 0; i < len; i++) {
+        struct s2n_stuffer *message = NULL;
+        RESULT_GUARD(s2n_array_get(*corpus, i, (void **) &message));
+        RESULT_GUARD_POSIX(s2n_stuffer_free(message));
+    }
+    RESULT_GUARD(s2n_array_free_p(corpus));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_replay_validate_message(struct s2n_stuffer *message)
+{
+    uint8_t message_type = 0;
+    uint32_t message_len = 0;
+    RESULT_GUARD_POSIX(s2n_stuffer_read_uint8(message, &message_type));
+    RESULT_GUARD_POSIX(s2n_stuffer_read_uint24(message, &message_len));
+    RESULT_ENSURE(message_type == S2N_REPLAY_CLIENT_HELLO, S2N_ERR_BAD_MESSAGE);
+    RESULT_ENSURE(message_len == s2n_stuffer_data_available(message), S2N_ERR_BAD_MESSAGE);
+    RESULT_GUARD_POSIX(s2n_stuffer_reread(message));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_replay_corpus_read(const char *path, struct s2n_array *corpus)
+{
+    FILE *file = fopen(path, "r");
+    RESULT_ENSURE(file != NULL, S2N_ERR_IO);
+
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t line_len = 0;
+    uint32_t line_number = 0;
+    s2n_result result = S2N_RESULT_OK;
+    while ((line_len = getline(&line, &line_capacity, file)) >= 0) {
+        line_number++;
+        while (line_len > 0 && (line[line_len - 1] == '\n' || line[line_len - 1] == '\r')) {
+            line[--line_len] = '\0';
+        }
+        if (line_len == 0 || line[0] == '#') {
+            continue;
+        }
+
+        struct s2n_stuffer *message = NULL;
+        result = s2n_array_pushback(corpus, (void **) &message);
+        if (s2n_result_is_ok(result)) {
+            result = s2n_stuffer_alloc_from_hex(message, line);
+        }
+        if (s2n_result_is_ok(result)) {
+            result = s2n_replay_validate_message(message);
+        }
+        if (s2n_result_is_error(result)) {
+            fprintf(stderr, "%s:%" PRIu32 " is not a hex encoded ClientHello\n", path, line_number);
+            break;
+        }
+    }
+
+    free(line);
+    fclose(file);
+    return result;
+}
+
+static S2N_RESULT s2n_replay_corpus_add_policy(const char *policy, struct s2n_array *corpus)
+{
+    DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+    RESULT_ENSURE_REF(client);
+    RESULT_GUARD_POSIX(s2n_connection_set_cipher_preferences(client, policy));
+    RESULT_GUARD_POSIX(s2n_set_server_name(client, "localhost"));
+    RESULT_GUARD_POSIX(s2n_client_hello_send(client));
+
+    uint32_t body_len = s2n_stuffer_data_available(&client->handshake.io);
+    struct s2n_stuffer *message = NULL;
+    RESULT_GUARD(s2n_array_pushback(corpus, (void **) &message));
+    RESULT_GUARD_POSIX(s2n_stuffer_alloc(message, S2N_REPLAY_HANDSHAKE_HEADER_LEN + body_len));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_uint8(message, S2N_REPLAY_CLIENT_HELLO));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_uint24(message, body_len));
+    RESULT_GUARD_POSIX(s2n_stuffer_copy(&client->handshake.io, message, body_len));
+    return S2N_RESULT_OK;
+}
+
+/* One ClientHello for every security policy that a client can use */
+static S2N_RESULT s2n_replay_corpus_generate(struct s2n_array *corpus)
+{
+    for (size_t i = 0; security_policy_selection[i].version != NULL; i++) {
+        if (s2n_result_is_error(s2n_replay_corpus_add_policy(security_policy_selection[i].version, corpus))) {
+            /* Some policies can't be used by a client, or by this libcrypto */
+            continue;
+        }
+    }
+    return S2N_RESULT_OK;
+}
+
+/* Ends the parse phase and starts the process phase */
+static int s2n_replay_client_hello_cb(struct s2n_connection *conn, void *ctx)
+{
+    struct s2n_replay_phases *phases = ctx;
+    s2n_benchmark_sample_stop(&phases->parse);
+    s2n_benchmark_sample_start(&phases->process);
+    return S2N_SUCCESS;
+}
+
+static S2N_RESULT s2n_replay_fingerprint(struct s2n_benchmark *bench, struct s2n_fingerprint *fingerprint,
+        struct s2n_client_hello *client_hello)
+{
+    uint8_t hash[S2N_REPLAY_MAX_HASH_LEN] = { 0 };
+    uint32_t hash_len = 0;
+
+    s2n_benchmark_sample_start(bench);
+    RESULT_GUARD_POSIX(s2n_fingerprint_set_client_hello(fingerprint, client_hello));
+    RESULT_GUARD_POSIX(s2n_fingerprint_get_hash(fingerprint, sizeof(hash), hash, &hash_len));
+    s2n_benchmark_sample_stop(bench);
+
+    RESULT_GUARD_POSIX(s2n_fingerprint_wipe(fingerprint));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_replay_set_samples(struct s2n_benchmark *bench, struct s2n_blob *samples, uint32_t len)
+{
+    RESULT_GUARD_POSIX(s2n_alloc(samples, len * sizeof(uint64_t)));
+    bench->samples_ns = (uint64_t *) (void *) samples->data;
+    bench->samples_capacity = len;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_replay_run(const char *policy, struct s2n_cert_chain_and_key *rsa_chain,
+        struct s2n_cert_chain_and_key *ecdsa_chain, struct s2n_array *corpus, uint64_t rounds)
+{
+    uint32_t corpus_len = 0;
+    RESULT_GUARD(s2n_array_num_elements(corpus, &corpus_len));
+    const uint64_t hellos = corpus_len * rounds;
+    RESULT_ENSURE(hellos <= UINT32_MAX / sizeof(uint64_t), S2N_ERR_INVALID_ARGUMENT);
+
+    struct s2n_replay_phases phases = {
+        .parse = { .name = "s2n_client_hello_parse" },
+        .process = { .name = "s2n_client_hello_process" },
+        .ja3 = { .name = "s2n_client_hello_fingerprint" },
+        .ja4 = { .name = "s2n_client_hello_fingerprint" },
+    };
+    RESULT_GUARD_POSIX(s2n_benchmark_set_params(&phases.parse, "policy=%s", policy));
+    RESULT_GUARD_POSIX(s2n_benchmark_set_params(&phases.process, "policy=%s", policy));
+    RESULT_GUARD_POSIX(s2n_benchmark_set_params(&phases.ja3, "type=ja3 policy=%s", policy));
+    RESULT_GUARD_POSIX(s2n_benchmark_set_params(&phases.ja4, "type=ja4 policy=%s", policy));
+
+    DEFER_CLEANUP(struct s2n_blob parse_samples = { 0 }, s2n_free);
+    DEFER_CLEANUP(struct s2n_blob process_samples = { 0 }, s2n_free);
+    DEFER_CLEANUP(struct s2n_blob ja3_samples = { 0 }, s2n_free);
+    DEFER_CLEANUP(struct s2n_blob ja4_samples = { 0 }, s2n_free);
+    RESULT_GUARD(s2n_replay_set_samples(&phases.parse, &parse_samples, hellos));
+    RESULT_GUARD(s2n_replay_set_samples(&phases.process, &process_samples, hellos));
+    RESULT_GUARD(s2n_replay_set_samples(&phases.ja3, &ja3_samples, hellos));
+    RESULT_GUARD(s2n_replay_set_samples(&phases.ja4, &ja4_samples, hellos));
+
+    DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+    RESULT_ENSURE_REF(config);
+    RESULT_GUARD_POSIX(s2n_config_set_cipher_preferences(config, policy));
+    RESULT_GUARD_POSIX(s2n_config_add_cert_chain_and_key_to_store(config, rsa_chain));
+    RESULT_GUARD_POSIX(s2n_config_add_cert_chain_and_key_to_store(config, ecdsa_chain));
+    RESULT_GUARD_POSIX(s2n_config_set_client_hello_cb(config, s2n_replay_client_hello_cb, &phases));
+
+    DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+    RESULT_ENSURE_REF(conn);
+    RESULT_GUARD_POSIX(s2n_connection_set_config(conn, config));
+
+    DEFER_CLEANUP(struct s2n_fingerprint *ja3 = s2n_fingerprint_new(S2N_FINGERPRINT_JA3), s2n_fingerprint_free);
+    RESULT_ENSURE_REF(ja3);
+    DEFER_CLEANUP(struct s2n_fingerprint *ja4 = s2n_fingerprint_new(S2N_FINGERPRINT_JA4), s2n_fingerprint_free);
+    RESULT_ENSURE_REF(ja4);
+
+    uint64_t rejected = 0;
+    for (uint64_t round = 0; round < rounds; round++) {
+        for (uint32_t i = 0; i < corpus_len; i++) {
+            struct s2n_stuffer *message = NULL;
+            RESULT_GUARD(s2n_array_get(corpus, i, (void **) &message));
+
+            /* Wiping keeps the config, so only the ClientHello changes between replays */
+            RESULT_GUARD_POSIX(s2n_connection_wipe(conn));
+            RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(&conn->handshake.io,
+                    message->blob.data + S2N_REPLAY_HANDSHAKE_HEADER_LEN,
+                    message->blob.size - S2N_REPLAY_HANDSHAKE_HEADER_LEN));
+
+            s2n_benchmark_sample_start(&phases.parse);
+            int result = s2n_client_hello_recv(conn);
+            if (conn->client_hello.callback_invoked) {
+                s2n_benchmark_sample_stop(&phases.process);
+            }
+            if (result != S2N_SUCCESS) {
+                rejected++;
+            }
+            if (!conn->client_hello.parsed) {
+                continue;
+            }
+
+            struct s2n_client_hello *client_hello = s2n_connection_get_client_hello(conn);
+            RESULT_ENSURE_REF(client_hello);
+            RESULT_GUARD(s2n_replay_fingerprint(&phases.ja3, ja3, client_hello));
+            RESULT_GUARD(s2n_replay_fingerprint(&phases.ja4, ja4, client_hello));
+        }
+    }
+
+    /* Every ClientHello is parsed, or the corpus is unsuitable for comparing runs */
+    RESULT_ENSURE_EQ(phases.parse.ops, hellos);
+    fprintf(stderr, "policy=%s client_hellos=%" PRIu32 " rejected=%" PRIu64 "\n", policy, corpus_len,
+            rejected / rounds);
+
+    RESULT_GUARD_POSIX(s2n_benchmark_report(&phases.parse));
+    RESULT_GUARD_POSIX(s2n_benchmark_report(&phases.process));
+    RESULT_GUARD_POSIX(s2n_benchmark_report(&phases.ja3));
+    RESULT_GUARD_POSIX(s2n_benchmark_report(&phases.ja4));
+    return S2N_RESULT_OK;
+}
+
+static int s2n_replay_benchmark(void)
+{
+    uint64_t rounds = S2N_REPLAY_DEFAULT_ROUNDS;
+    const char *rounds_str = getenv("S2N_CLIENT_HELLO_REPLAY_ROUNDS");
+    if (rounds_str != NULL) {
+        char *end = NULL;
+        rounds = strtoull(rounds_str, &end, 10);
+        POSIX_ENSURE(*rounds_str != '\0' && *end == '\0' && rounds > 0, S2N_ERR_INVALID_ARGUMENT);
+    }
+
+    DEFER_CLEANUP(struct s2n_array *corpus = s2n_array_new(sizeof(struct s2n_stuffer)), s2n_replay_corpus_free);
+    POSIX_ENSURE_REF(corpus);
+    const char *corpus_path = getenv("S2N_CLIENT_HELLO_CORPUS");
+    if (corpus_path != NULL) {
+        POSIX_GUARD_RESULT(s2n_replay_corpus_read(corpus_path, corpus));
+    } else {
+        POSIX_GUARD_RESULT(s2n_replay_corpus_generate(corpus));
+    }
+    uint32_t corpus_len = 0;
+    POSIX_GUARD_RESULT(s2n_array_num_elements(corpus, &corpus_len));
+    POSIX_ENSURE(corpus_len > 0, S2N_ERR_INVALID_ARGUMENT);
+
+    DEFER_CLEANUP(struct s2n_cert_chain_and_key *rsa_chain = NULL, s2n_cert_chain_and_key_ptr_free);
+    POSIX_GUARD(s2n_test_cert_chain_and_key_new(&rsa_chain, S2N_DEFAULT_TEST_CERT_CHAIN, S2N_DEFAULT_TEST_PRIVATE_KEY));
+    DEFER_CLEANUP(struct s2n_cert_chain_and_key *ecdsa_chain = NULL, s2n_cert_chain_and_key_ptr_free);
+    POSIX_GUARD(s2n_test_cert_chain_and_key_new(&ecdsa_chain, S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN,
+            S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+
+    for (size_t i = 0; i < s2n_array_len(s2n_replay_server_policies); i++) {
+        POSIX_GUARD_RESULT(s2n_replay_run(s2n_replay_server_policies[i], rsa_chain, ecdsa_chain, corpus, rounds));
+    }
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    if (s2n_replay_benchmark() != S2N_SUCCESS) {
+        fprintf(stderr, "ClientHello replay benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    s2n_benchmark_cleanup();
+    return 0;
+}
@@ -0,0 +1,369 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Measures the memory held by many simultaneously open connections.
+ *
+ * Opens pairs of client and server connections and completes a handshake on each
+ * pair, keeping every connection open. The "handshake" phase reports the memory per
+ * connection once every handshake is complete, and the "idle" phase reports the memory
+ * per connection after s2n_connection_release_buffers, which is what a server holding
+ * many idle connections pays. Heap peaks cover the handshakes themselves.
+ *
+ * Connections use the default static I/O buffers, dynamic buffers, or kTLS. kTLS
+ * requires TCP sockets and kernel support, so that mode uses loopback TCP connections
+ * and is skipped if kTLS can't be enabled. Memory used by the kernel for kTLS is not
+ * included.
+ *
+ * Environment variables:
+ *   S2N_MEMORY_BENCHMARK_PAIRS          Connection pairs to open (default 10000)
+ *   S2N_MEMORY_BENCHMARK_MAX_IDLE_BYTES Fail if any mode's idle heap bytes per connection exceed this
+ *
+ * Unlike the other benchmarks, this one is built with the unit tests, and ctest runs it with a
+ * small number of pairs and an idle memory budget. Run it from tests/unit, so the test
+ * certificates are found:
+ *   S2N_DONT_MLOCK=1 ../../build/bin/s2n_connection_memory_benchmark [--json]
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "api/s2n.h"
+#include "api/unstable/ktls.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_connection.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_MEMORY_BENCHMARK_DEFAULT_PAIRS 10000
+/* Descriptors for stdio, the kTLS listener and the certificates */
+#define S2N_MEMORY_BENCHMARK_SPARE_FDS 16
+
+typedef enum {
+    S2N_MEMORY_BENCHMARK_STATIC,
+    S2N_MEMORY_BENCHMARK_DYNAMIC,
+    S2N_MEMORY_BENCHMARK_KTLS,
+} s2n_memory_benchmark_mode;
+
+static const char *s2n_memory_benchmark_mode_names[] = {
+    [S2N_MEMORY_BENCHMARK_STATIC] = "static",
+    [S2N_MEMORY_BENCHMARK_DYNAMIC] = "dynamic",
+    [S2N_MEMORY_BENCHMARK_KTLS] = "ktls",
+};
+
+struct s2n_memory_benchmark_pair {
+    struct s2n_connection *client;
+    struct s2n_connection *server;
+    int client_fd;
+    int server_fd;
+};
+
+struct s2n_memory_benchmark_ctx {
+    s2n_memory_benchmark_mode mode;
+    struct s2n_config *client_config;
+    struct s2n_config *server_config;
+    int listener;
+    struct sockaddr_in listener_addr;
+};
+
+static int s2n_memory_benchmark_env(const char *name, uint64_t *value)
+{
+    const char *str = getenv(name);
+    if (str == NULL) {
+        return S2N_SUCCESS;
+    }
+    char *end = NULL;
+    errno = 0;
+    unsigned long long parsed = strtoull(str, &end, 10);
+    POSIX_ENSURE(errno == 0 && end != str && *end == '\0', S2N_ERR_INVALID_ARGUMENT);
+    *value = parsed;
+    return S2N_SUCCESS;
+}
+
+/* Each pair needs two descriptors, which is more than the default soft limit allows */
+static int s2n_memory_benchmark_reserve_fds(uint64_t pairs)
+{
+    struct rlimit limit = { 0 };
+    POSIX_ENSURE(getrlimit(RLIMIT_NOFILE, &limit) == 0, S2N_ERR_SAFETY);
+    limit.rlim_cur = limit.rlim_max;
+    POSIX_ENSURE(setrlimit(RLIMIT_NOFILE, &limit) == 0, S2N_ERR_SAFETY);
+
+    uint64_t required = (pairs * 2) + S2N_MEMORY_BENCHMARK_SPARE_FDS;
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < required) {
+        fprintf(stderr, "%" PRIu64 " connection pairs need %" PRIu64 " file descriptors, but the limit is %" PRIu64 "\n",
+                pairs, required, (uint64_t) limit.rlim_cur);
+        POSIX_BAIL(S2N_ERR_INVALID_ARGUMENT);
+    }
+    return S2N_SUCCESS;
+}
+
+static int s2n_memory_benchmark_set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    POSIX_ENSURE(flags >= 0, S2N_ERR_SAFETY);
+    POSIX_ENSURE(fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0, S2N_ERR_SAFETY);
+    return S2N_SUCCESS;
+}
+
+static int s2n_memory_benchmark_listen(struct s2n_memory_benchmark_ctx *ctx)
+{
+    ctx->listener = socket(AF_INET, SOCK_STREAM, 0);
+    POSIX_ENSURE(ctx->listener >= 0, S2N_ERR_SAFETY);
+
+    ctx->listener_addr.sin_family = AF_INET;
+    ctx->listener_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ctx->listener_addr.sin_port = 0;
+    POSIX_ENSURE(bind(ctx->listener, (struct sockaddr *) &ctx->listener_addr, sizeof(ctx->listener_addr)) == 0,
+            S2N_ERR_SAFETY);
+
+    socklen_t addr_len = sizeof(ctx->listener_addr);
+    POSIX_ENSURE(getsockname(ctx->listener, (struct sockaddr *) &ctx->listener_addr, &addr_len) == 0, S2N_ERR_SAFETY);
+    POSIX_ENSURE(listen(ctx->listener, 1) == 0, S2N_ERR_SAFETY);
+    return S2N_SUCCESS;
+}
+
+/* kTLS can only be enabled on TCP sockets, so kTLS pairs are connected over loopback */
+static int s2n_memory_benchmark_sockets(struct s2n_memory_benchmark_ctx *ctx, struct s2n_memory_benchmark_pair *pair)
+{
+    if (ctx->mode != S2N_MEMORY_BENCHMARK_KTLS) {
+        int fds[2] = { 0 };
+        POSIX_ENSURE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0, S2N_ERR_SAFETY);
+        pair->client_fd = fds[0];
+        pair->server_fd = fds[1];
+    } else {
+        pair->client_fd = socket(AF_INET, SOCK_STREAM, 0);
+        POSIX_ENSURE(pair->client_fd >= 0, S2N_ERR_SAFETY);
+        POSIX_ENSURE(connect(pair->client_fd, (struct sockaddr *) &ctx->listener_addr, sizeof(ctx->listener_addr)) == 0,
+                S2N_ERR_SAFETY);
+        pair->server_fd = accept(ctx->listener, NULL, NULL);
+        POSIX_ENSURE(pair->server_fd >= 0, S2N_ERR_SAFETY);
+    }
+
+    /* Both ends of the handshake are driven from one thread */
+    POSIX_GUARD(s2n_memory_benchmark_set_nonblocking(pair->client_fd));
+    POSIX_GUARD(s2n_memory_benchmark_set_nonblocking(pair->server_fd));
+    return S2N_SUCCESS;
+}
+
+/* Unlike s2n_negotiate_test_server_and_client, keeps retrying while a peer's last
+ * flight is still in transit, which can happen with TCP
+ */
+static int s2n_memory_benchmark_negotiate(struct s2n_memory_benchmark_pair *pair)
+{
+    struct s2n_connection *conns[] = { pair->client, pair->server };
+    bool done[] = { false, false };
+    s2n_blocked_status blocked = S2N_NOT_BLOCKED;
+    while (!done[0] || !done[1]) {
+        for (size_t i = 0; i < s2n_array_len(conns); i++) {
+            if (done[i]) {
+                continue;
+            }
+            if (s2n_negotiate(conns[i], &blocked) == S2N_SUCCESS) {
+                done[i] = true;
+            } else if (s2n_error_get_type(s2n_errno) != S2N_ERR_T_BLOCKED) {
+                return S2N_FAILURE;
+            }
+        }
+    }
+    return S2N_SUCCESS;
+}
+
+static int s2n_memory_benchmark_connect(struct s2n_memory_benchmark_ctx *ctx, struct s2n_memory_benchmark_pair *pair)
+{
+    POSIX_GUARD(s2n_memory_benchmark_sockets(ctx, pair));
+
+    pair->client = s2n_connection_new(S2N_CLIENT);
+    POSIX_ENSURE_REF(pair->client);
+    pair->server = s2n_connection_new(S2N_SERVER);
+    POSIX_ENSURE_REF(pair->server);
+
+    POSIX_GUARD(s2n_connection_set_config(pair->client, ctx->client_config));
+    POSIX_GUARD(s2n_connection_set_config(pair->server, ctx->server_config));
+    POSIX_GUARD(s2n_connection_set_fd(pair->client, pair->client_fd));
+    POSIX_GUARD(s2n_connection_set_fd(pair->server, pair->server_fd));
+
+    if (ctx->mode == S2N_MEMORY_BENCHMARK_DYNAMIC) {
+        POSIX_GUARD(s2n_connection_set_dynamic_buffers(pair->client, true));
+        POSIX_GUARD(s2n_connection_set_dynamic_buffers(pair->server, true));
+    }
+
+    POSIX_GUARD(s2n_memory_benchmark_negotiate(pair));
+    return S2N_SUCCESS;
+}
+
+static int s2n_memory_benchmark_idle(struct s2n_memory_benchmark_ctx *ctx, struct s2n_memory_benchmark_pair *pair)
+{
+    struct s2n_connection *conns[] = { pair->client, pair->server };
+    for (size_t i = 0; i < s2n_array_len(conns); i++) {
+        if (ctx->mode == S2N_MEMORY_BENCHMARK_KTLS) {
+            POSIX_GUARD(s2n_connection_ktls_enable_send(conns[i]));
+            POSIX_GUARD(s2n_connection_ktls_enable_recv(conns[i]));
+        }
+        POSIX_GUARD(s2n_connection_release_buffers(conns[i]));
+    }
+    return S2N_SUCCESS;
+}
+
+static void s2n_memory_benchmark_close(struct s2n_memory_benchmark_pair *pair)
+{
+    s2n_connection_free(pair->client);
+    s2n_connection_free(pair->server);
+    if (pair->client_fd > 0) {
+        close(pair->client_fd);
+    }
+    if (pair->server_fd > 0) {
+        close(pair->server_fd);
+    }
+    *pair = (struct s2n_memory_benchmark_pair){ 0 };
+}
+
+/* Enabling kTLS fails if the platform, kernel or socket doesn't support it */
+static bool s2n_memory_benchmark_ktls_available(struct s2n_memory_benchmark_ctx *ctx)
+{
+    struct s2n_memory_benchmark_pair pair = { 0 };
+    bool available = s2n_memory_benchmark_connect(ctx, &pair) == S2N_SUCCESS
+            && s2n_memory_benchmark_idle(ctx, &pair) == S2N_SUCCESS;
+    s2n_memory_benchmark_close(&pair);
+    return available;
+}
+
+static int s2n_memory_benchmark_run(struct s2n_cert_chain_and_key *chain_and_key, s2n_memory_benchmark_mode mode,
+        uint64_t pairs, uint64_t max_idle_bytes)
+{
+    DEFER_CLEANUP(struct s2n_config *client_config = s2n_config_new(), s2n_config_ptr_free);
+    POSIX_ENSURE_REF(client_config);
+    POSIX_GUARD(s2n_config_set_cipher_preferences(client_config, "20240417"));
+    POSIX_GUARD(s2n_config_disable_x509_verification(client_config));
+
+    DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+    POSIX_ENSURE_REF(server_config);
+    POSIX_GUARD(s2n_config_set_cipher_preferences(server_config, "20240417"));
+    POSIX_GUARD(s2n_config_add_cert_chain_and_key_to_store(server_config, chain_and_key));
+
+    struct s2n_memory_benchmark_ctx ctx = {
+        .mode = mode,
+        .client_config = client_config,
+        .server_config = server_config,
+        .listener = -1,
+    };
+
+    const char *mode_name = s2n_memory_benchmark_mode_names[mode];
+    if (mode == S2N_MEMORY_BENCHMARK_KTLS) {
+        /* The policy negotiates TLS1.3 */
+        POSIX_GUARD(s2n_config_ktls_enable_unsafe_tls13(client_config));
+        POSIX_GUARD(s2n_config_ktls_enable_unsafe_tls13(server_config));
+        POSIX_GUARD(s2n_memory_benchmark_listen(&ctx));
+        if (!s2n_memory_benchmark_ktls_available(&ctx)) {
+            fprintf(stderr, "s2n_connection_memory mode=%s skipped: %s\n", mode_name, s2n_strerror(s2n_errno, "EN"));
+            close(ctx.listener);
+            return S2N_SUCCESS;
+        }
+    }
+
+    /* Allocated before the benchmarks start, so not included in the results */
+    DEFER_CLEANUP(struct s2n_blob pairs_mem = { 0 }, s2n_free);
+    POSIX_GUARD(s2n_alloc(&pairs_mem, pairs * sizeof(struct s2n_memory_benchmark_pair)));
+    POSIX_GUARD(s2n_blob_zero(&pairs_mem));
+    struct s2n_memory_benchmark_pair *conn_pairs = (struct s2n_memory_benchmark_pair *) (void *) pairs_mem.data;
+
+    struct s2n_benchmark handshake = { .name = "s2n_connection_memory" };
+    POSIX_GUARD(s2n_benchmark_set_params(&handshake, "mode=%s phase=handshake pairs=%" PRIu64, mode_name, pairs));
+    struct s2n_benchmark idle = { .name = "s2n_connection_memory" };
+    POSIX_GUARD(s2n_benchmark_set_params(&idle, "mode=%s phase=idle pairs=%" PRIu64, mode_name, pairs));
+
+    /* Results are per connection, not per pair */
+    const uint64_t conns = pairs * 2;
+
+    int result = S2N_SUCCESS;
+    s2n_benchmark_start(&handshake);
+    s2n_benchmark_start(&idle);
+    for (uint64_t i = 0; i < pairs && result == S2N_SUCCESS; i++) {
+        result = s2n_memory_benchmark_connect(&ctx, &conn_pairs[i]);
+    }
+    s2n_benchmark_stop(&handshake, conns);
+    for (uint64_t i = 0; i < pairs && result == S2N_SUCCESS; i++) {
+        result = s2n_memory_benchmark_idle(&ctx, &conn_pairs[i]);
+    }
+    s2n_benchmark_stop(&idle, conns);
+
+    for (uint64_t i = 0; i < pairs; i++) {
+        s2n_memory_benchmark_close(&conn_pairs[i]);
+    }
+    if (ctx.listener >= 0) {
+        close(ctx.listener);
+    }
+    POSIX_GUARD(result);
+
+    POSIX_GUARD(s2n_benchmark_report(&handshake));
+    POSIX_GUARD(s2n_benchmark_report(&idle));
+
+    if (max_idle_bytes > 0 && idle.heap_bytes > (int64_t) (max_idle_bytes * conns)) {
+        fprintf(stderr, "s2n_connection_memory mode=%s: %" PRId64 " idle heap bytes per connection exceeds the limit of %" PRIu64 "\n",
+                mode_name, idle.heap_bytes / (int64_t) conns, max_idle_bytes);
+        POSIX_BAIL(S2N_ERR_SAFETY);
+    }
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    uint64_t pairs = S2N_MEMORY_BENCHMARK_DEFAULT_PAIRS;
+    uint64_t max_idle_bytes = 0;
+    if (s2n_memory_benchmark_env("S2N_MEMORY_BENCHMARK_PAIRS", &pairs) != S2N_SUCCESS
+            || s2n_memory_benchmark_env("S2N_MEMORY_BENCHMARK_MAX_IDLE_BYTES", &max_idle_bytes) != S2N_SUCCESS
+            || pairs == 0) {
+        fprintf(stderr, "S2N_MEMORY_BENCHMARK_PAIRS and S2N_MEMORY_BENCHMARK_MAX_IDLE_BYTES must be positive numbers\n");
+        return 1;
+    }
+    if (s2n_memory_benchmark_reserve_fds(pairs) != S2N_SUCCESS) {
+        return 1;
+    }
+
+    struct s2n_cert_chain_and_key *chain_and_key = NULL;
+    if (s2n_test_cert_chain_and_key_new(&chain_and_key, S2N_ECDSA_P256_PKCS1_CERT_CHAIN, S2N_ECDSA_P256_PKCS1_KEY)
+            != S2N_SUCCESS) {
+        fprintf(stderr, "failed to load the test certificate, run from tests/unit: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    const s2n_memory_benchmark_mode modes[] = {
+        S2N_MEMORY_BENCHMARK_STATIC,
+        S2N_MEMORY_BENCHMARK_DYNAMIC,
+        S2N_MEMORY_BENCHMARK_KTLS,
+    };
+    for (size_t i = 0; i < s2n_array_len(modes); i++) {
+        if (s2n_memory_benchmark_run(chain_and_key, modes[i], pairs, max_idle_bytes) != S2N_SUCCESS) {
+            fprintf(stderr, "s2n_connection_memory benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+            return 1;
+        }
+    }
+
+    s2n_cert_chain_and_key_free(chain_and_key);
+    s2n_benchmark_cleanup();
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Measures fork detection with many threads checking the fork generation number at once.
+ *
+ * Every random number request checks the fork generation number, so each thread calls
+ * s2n_get_fork_generation_number in a tight loop. This is compared with the read lock,
+ * sentinel check and unlock that the check previously required, which contends on the
+ * lock's reader count. ns_per_op is the time for every thread to make one call, so it
+ * stays flat as threads are added if the check scales.
+ *
+ * Threads are doubled up to the number of cores, or to S2N_FORK_BENCHMARK_THREADS if set.
+ *
+ * Build with -DS2N_BENCHMARKS=ON and run from any directory:
+ *   S2N_DONT_MLOCK=1 ./bin/s2n_fork_detection_benchmark [--json]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/param.h>
+#include <unistd.h>
+
+#include "api/s2n.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "utils/s2n_fork_detection.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_FORK_BENCHMARK_CALLS       1000000
+#define S2N_FORK_BENCHMARK_MAX_THREADS 64
+
+typedef enum {
+    S2N_FORK_BENCHMARK_ATOMIC,
+    S2N_FORK_BENCHMARK_RWLOCK,
+} s2n_fork_benchmark_impl;
+
+static const char *s2n_fork_benchmark_impl_names[] = {
+    [S2N_FORK_BENCHMARK_ATOMIC] = "atomic",
+    [S2N_FORK_BENCHMARK_RWLOCK] = "rwlock",
+};
+
+static pthread_rwlock_t s2n_fork_benchmark_lock = PTHREAD_RWLOCK_INITIALIZER;
+static volatile char s2n_fork_benchmark_sentinel = 1;
+static uint64_t s2n_fork_benchmark_generation = 0;
+
+struct s2n_fork_benchmark_thread {
+    pthread_t thread;
+    s2n_fork_benchmark_impl impl;
+    pthread_barrier_t *start;
+    int result;
+};
+
+static S2N_RESULT s2n_fork_benchmark_rwlock_get(uint64_t *generation)
+{
+    RESULT_ENSURE(pthread_rwlock_rdlock(&s2n_fork_benchmark_lock) == 0, S2N_ERR_RETRIEVE_FORK_GENERATION_NUMBER);
+    *generation = s2n_fork_benchmark_generation;
+    bool fork_event = (s2n_fork_benchmark_sentinel == 0);
+    RESULT_ENSURE(pthread_rwlock_unlock(&s2n_fork_benchmark_lock) == 0, S2N_ERR_RETRIEVE_FORK_GENERATION_NUMBER);
+    RESULT_ENSURE(!fork_event, S2N_ERR_SAFETY);
+    return S2N_RESULT_OK;
+}
+
+static void *s2n_fork_benchmark_thread_run(void *arg)
+{
+    struct s2n_fork_benchmark_thread *thread = arg;
+    thread->result = S2N_FAILURE;
+    pthread_barrier_wait(thread->start);
+
+    uint64_t generation = 0;
+    for (size_t i = 0; i < S2N_FORK_BENCHMARK_CALLS; i++) {
+        s2n_result result = S2N_RESULT_OK;
+        if (thread->impl == S2N_FORK_BENCHMARK_ATOMIC) {
+            result = s2n_get_fork_generation_number(&generation);
+        } else {
+            result = s2n_fork_benchmark_rwlock_get(&generation);
+        }
+        if (s2n_result_is_error(result)) {
+            return NULL;
+        }
+    }
+
+    thread->result = S2N_SUCCESS;
+    return NULL;
+}
+
+static int s2n_fork_benchmark_run(s2n_fork_benchmark_impl impl, size_t thread_count)
+{
+    struct s2n_benchmark bench = { .name = "s2n_get_fork_generation_number" };
+    POSIX_GUARD(s2n_benchmark_set_params(&bench, "impl=%s threads=%zu", s2n_fork_benchmark_impl_names[impl],
+            thread_count));
+
+    /* Threads start together once they have all been created, so creating them isn't timed */
+    pthread_barrier_t start = { 0 };
+    POSIX_ENSURE(pthread_barrier_init(&start, NULL, thread_count + 1) == 0, S2N_ERR_SAFETY);
+
+    struct s2n_fork_benchmark_thread threads[S2N_FORK_BENCHMARK_MAX_THREADS] = { 0 };
+    size_t started = 0;
+    for (; started < thread_count; started++) {
+        threads[started].impl = impl;
+        threads[started].start = &start;
+        if (pthread_create(&threads[started].thread, NULL, s2n_fork_benchmark_thread_run, &threads[started]) != 0) {
+            break;
+        }
+    }
+    /* A thread that failed to start would leave the others waiting forever */
+    POSIX_ENSURE(started == thread_count, S2N_ERR_SAFETY);
+
+    pthread_barrier_wait(&start);
+    s2n_benchmark_start(&bench);
+    bool success = true;
+    for (size_t i = 0; i < thread_count; i++) {
+        pthread_join(threads[i].thread, NULL);
+        success = success && (threads[i].result == S2N_SUCCESS);
+    }
+    s2n_benchmark_stop(&bench, S2N_FORK_BENCHMARK_CALLS);
+
+    pthread_barrier_destroy(&start);
+    POSIX_ENSURE(success, S2N_ERR_RETRIEVE_FORK_GENERATION_NUMBER);
+    POSIX_GUARD(s2n_benchmark_report(&bench));
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    long max_threads_env = 0;
+    const char *max_threads_str = getenv("S2N_FORK_BENCHMARK_THREADS");
+    if (max_threads_str != NULL) {
+        max_threads_env = strtol(max_threads_str, NULL, 10);
+    }
+    long cores = (max_threads_env > 0) ? max_threads_env : sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = MIN(MAX(cores, 1), S2N_FORK_BENCHMARK_MAX_THREADS);
+
+    /* 1, 2, 4, ... up to and including the maximum */
+    for (size_t threads = 1;; threads = MIN(threads * 2, max_threads)) {
+        for (size_t impl = 0; impl < s2n_array_len(s2n_fork_benchmark_impl_names); impl++) {
+            if (s2n_fork_benchmark_run(impl, threads) != S2N_SUCCESS) {
+                fprintf(stderr, "fork detection benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+                return 1;
+            }
+        }
+        if (threads == max_threads) {
+            break;
+        }
+    }
+
+    s2n_benchmark_cleanup();
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Measures s2n_hash_update for each transcript hash, and s2n_conn_update_handshake_hashes
+ * both before the required hashes are known, when the transcript is only buffered,
+ * and after the TLS1.3 hash is negotiated.
+ *
+ * Build with -DS2N_BENCHMARKS=ON and run from any directory:
+ *   S2N_DONT_MLOCK=1 ./bin/s2n_hash_benchmark [--json]
+ */
+
+#include <stdio.h>
+
+#include "api/s2n.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "crypto/s2n_hash.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_cipher_suites.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_handshake.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+/* Every measurement hashes roughly this much data */
+#define S2N_HASH_BENCHMARK_BYTES (16 * 1024 * 1024)
+/* Real transcripts are only buffered for the first few messages, so keep the
+ * buffered transcript at a realistic size instead of letting it grow to 16MB.
+ */
+#define S2N_HASH_BENCHMARK_MAX_TRANSCRIPT (16 * 1024)
+
+static int s2n_hash_benchmark_update(s2n_hash_algorithm alg, const char *alg_name, struct s2n_blob *data)
+{
+    DEFER_CLEANUP(struct s2n_hash_state hash = { 0 }, s2n_hash_free);
+    POSIX_GUARD(s2n_hash_new(&hash));
+    POSIX_GUARD(s2n_hash_init(&hash, alg));
+
+    const uint32_t ops = S2N_HASH_BENCHMARK_BYTES / data->size;
+    struct s2n_benchmark bench = { .name = "s2n_hash_update", .bytes_per_op = data->size };
+    POSIX_GUARD(s2n_benchmark_set_params(&bench, "alg=%s size=%u", alg_name, data->size));
+    s2n_benchmark_start(&bench);
+    for (uint32_t i = 0; i < ops; i++) {
+        POSIX_GUARD(s2n_hash_update(&hash, data->data, data->size));
+    }
+    s2n_benchmark_stop(&bench, ops);
+
+    POSIX_GUARD(s2n_benchmark_report(&bench));
+    return S2N_SUCCESS;
+}
+
+static int s2n_hash_benchmark_transcript(message_type_t message_type, const char *state, struct s2n_blob *message)
+{
+    DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+    POSIX_ENSURE_REF(conn);
+    conn->actual_protocol_version = S2N_TLS13;
+    conn->handshake.state_machine = S2N_STATE_MACHINE_TLS13;
+    conn->secure->cipher_suite = &s2n_tls13_aes_128_gcm_sha256;
+    POSIX_GUARD_RESULT(s2n_connection_set_test_message_type(conn, message_type));
+    POSIX_GUARD(s2n_conn_update_required_handshake_hashes(conn));
+
+    const uint32_t ops = S2N_HASH_BENCHMARK_BYTES / message->size;
+    struct s2n_benchmark bench = { .name = "s2n_conn_update_handshake_hashes", .bytes_per_op = message->size };
+    POSIX_GUARD(s2n_benchmark_set_params(&bench, "state=%s size=%u", state, message->size));
+    s2n_benchmark_start(&bench);
+    struct s2n_stuffer *transcript = &conn->handshake.hashes->transcript;
+    for (uint32_t i = 0; i < ops; i++) {
+        if (s2n_stuffer_data_available(transcript) >= S2N_HASH_BENCHMARK_MAX_TRANSCRIPT) {
+            POSIX_GUARD(s2n_stuffer_rewrite(transcript));
+        }
+        POSIX_GUARD(s2n_conn_update_handshake_hashes(conn, message));
+    }
+    s2n_benchmark_stop(&bench, ops);
+
+    POSIX_GUARD(s2n_benchmark_report(&bench));
+    return S2N_SUCCESS;
+}
+
+static int s2n_hash_benchmark_run(uint32_t size)
+{
+    DEFER_CLEANUP(struct s2n_blob data = { 0 }, s2n_free);
+    POSIX_GUARD(s2n_alloc(&data, size));
+    POSIX_GUARD(s2n_blob_zero(&data));
+
+    const struct {
+        s2n_hash_algorithm alg;
+        const char *name;
+    } algs[] = {
+        { S2N_HASH_MD5, "md5" },
+        { S2N_HASH_SHA1, "sha1" },
+        { S2N_HASH_SHA256, "sha256" },
+        { S2N_HASH_SHA384, "sha384" },
+    };
+    for (size_t i = 0; i < s2n_array_len(algs); i++) {
+        /* MD5 is not available in FIPS mode */
+        if (!s2n_hash_is_available(algs[i].alg)) {
+            continue;
+        }
+        POSIX_GUARD(s2n_hash_benchmark_update(algs[i].alg, algs[i].name, &data));
+    }
+
+    POSIX_GUARD(s2n_hash_benchmark_transcript(CLIENT_HELLO, "buffered", &data));
+    POSIX_GUARD(s2n_hash_benchmark_transcript(ENCRYPTED_EXTENSIONS, "tls13_sha256", &data));
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    const uint32_t sizes[] = { 64, 256, 1024, 4096, 16384 };
+    for (size_t i = 0; i < s2n_array_len(sizes); i++) {
+        if (s2n_hash_benchmark_run(sizes[i]) != S2N_SUCCESS) {
+            fprintf(stderr, "s2n_hash benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+            return 1;
+        }
+    }
+
+    s2n_benchmark_cleanup();
+    return 0;
+}
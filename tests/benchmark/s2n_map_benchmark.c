@@ -0,0 +1,113 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Measures s2n_map lookup cost for small, medium and large maps.
+ *
+ * Build with -DS2N_BENCHMARKS=ON and run from any directory:
+ *   S2N_DONT_MLOCK=1 ./bin/s2n_map_benchmark [--json]
+ */
+
+#include <stdio.h>
+
+#include "api/s2n.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "utils/s2n_map.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_MAP_BENCHMARK_LOOKUPS 1000000
+
+/* Keys look like hostnames, which is what the SNI lookup path stores */
+static int s2n_map_benchmark_key(char *buffer, size_t buffer_size, uint32_t i, struct s2n_blob *key)
+{
+    int written = snprintf(buffer, buffer_size, "host-%08u.example.com", i);
+    POSIX_ENSURE(written > 0 && (size_t) written < buffer_size, S2N_ERR_SAFETY);
+    POSIX_GUARD(s2n_blob_init(key, (uint8_t *) buffer, written));
+    return S2N_SUCCESS;
+}
+
+static int s2n_map_benchmark_run(uint32_t entries)
+{
+    char key_str[64] = { 0 };
+    uint8_t value_data[8] = { 0 };
+    struct s2n_blob key = { 0 };
+    struct s2n_blob value = { 0 };
+    POSIX_GUARD(s2n_blob_init(&value, value_data, sizeof(value_data)));
+
+    DEFER_CLEANUP(struct s2n_map *map = s2n_map_new(), s2n_map_free_pointer);
+    POSIX_ENSURE_REF(map);
+
+    struct s2n_benchmark insert = { .name = "s2n_map_add" };
+    POSIX_GUARD(s2n_benchmark_set_params(&insert, "entries=%u", entries));
+    s2n_benchmark_start(&insert);
+    for (uint32_t i = 0; i < entries; i++) {
+        POSIX_GUARD(s2n_map_benchmark_key(key_str, sizeof(key_str), i, &key));
+        POSIX_GUARD_RESULT(s2n_map_add(map, &key, &value));
+    }
+    POSIX_GUARD_RESULT(s2n_map_complete(map));
+    s2n_benchmark_stop(&insert, entries);
+
+    /* Format the lookup keys up front so that only s2n_map_lookup is timed.
+     * Alternate hits and misses.
+     */
+    const size_t key_stride = sizeof(key_str);
+    DEFER_CLEANUP(struct s2n_blob lookup_keys = { 0 }, s2n_free);
+    POSIX_GUARD(s2n_alloc(&lookup_keys, S2N_MAP_BENCHMARK_LOOKUPS * key_stride));
+    static uint8_t lookup_key_sizes[S2N_MAP_BENCHMARK_LOOKUPS] = { 0 };
+    for (uint32_t i = 0; i < S2N_MAP_BENCHMARK_LOOKUPS; i++) {
+        uint32_t id = (i % 2) ? (i % entries) : (entries + i);
+        char *lookup_key_str = (char *) lookup_keys.data + (i * key_stride);
+        POSIX_GUARD(s2n_map_benchmark_key(lookup_key_str, key_stride, id, &key));
+        lookup_key_sizes[i] = key.size;
+    }
+
+    bool key_found = false;
+    uint32_t found = 0;
+    struct s2n_benchmark lookup = { .name = "s2n_map_lookup" };
+    POSIX_GUARD(s2n_benchmark_set_params(&lookup, "entries=%u", entries));
+    s2n_benchmark_start(&lookup);
+    for (uint32_t i = 0; i < S2N_MAP_BENCHMARK_LOOKUPS; i++) {
+        key.data = lookup_keys.data + (i * key_stride);
+        key.size = lookup_key_sizes[i];
+        POSIX_GUARD_RESULT(s2n_map_lookup(map, &key, &value, &key_found));
+        found += key_found;
+    }
+    s2n_benchmark_stop(&lookup, S2N_MAP_BENCHMARK_LOOKUPS);
+    POSIX_ENSURE_EQ(found, S2N_MAP_BENCHMARK_LOOKUPS / 2);
+
+    POSIX_GUARD(s2n_benchmark_report(&insert));
+    POSIX_GUARD(s2n_benchmark_report(&lookup));
+
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    const uint32_t sizes[] = { 10, 10000, 1000000 };
+    for (size_t i = 0; i < s2n_array_len(sizes); i++) {
+        if (s2n_map_benchmark_run(sizes[i]) != S2N_SUCCESS) {
+            fprintf(stderr, "s2n_map benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+            return 1;
+        }
+    }
+
+    s2n_benchmark_cleanup();
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Measures the TLS1.2 PRF calls made by one side of a full handshake: the master secret,
+ * the key expansion, and both finished messages.
+ *
+ * The key expansion and finished messages are all keyed with the master secret. With reuse,
+ * the PRF keeps the hmac keyed with the master secret between calls. Without reuse, every
+ * call re-keys the hmac, which is what the PRF did before keyed states were remembered.
+ *
+ * Build with -DS2N_BENCHMARKS=ON and run from any directory:
+ *   S2N_DONT_MLOCK=1 ./bin/s2n_prf_benchmark [--json]
+ */
+
+#include <stdio.h>
+
+#include "api/s2n.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "crypto/s2n_fips.h"
+#include "tls/s2n_cipher_suites.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_prf.h"
+#include "tls/s2n_tls.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_PRF_BENCHMARK_HANDSHAKES 20000
+
+int s2n_prf(struct s2n_connection *conn, struct s2n_blob *secret, struct s2n_blob *label, struct s2n_blob *seed_a,
+        struct s2n_blob *seed_b, struct s2n_blob *seed_c, struct s2n_blob *out);
+
+static int s2n_prf_benchmark_call(struct s2n_connection *conn, bool reuse_keyed_hmac, struct s2n_blob *secret,
+        struct s2n_blob *label, struct s2n_blob *seed_a, struct s2n_blob *seed_b, struct s2n_blob *out)
+{
+    if (!reuse_keyed_hmac) {
+        conn->prf_space->keyed_secret_size = 0;
+    }
+    return s2n_prf(conn, secret, label, seed_a, seed_b, NULL, out);
+}
+
+static int s2n_prf_benchmark_run(bool reuse_keyed_hmac)
+{
+    DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+    POSIX_ENSURE_REF(conn);
+    conn->actual_protocol_version = S2N_TLS12;
+    conn->secure->cipher_suite = &s2n_ecdhe_rsa_with_aes_128_gcm_sha256;
+
+    uint8_t premaster_secret_bytes[32] = "premaster secret";
+    uint8_t master_secret_bytes[S2N_TLS_SECRET_LEN] = { 0 };
+    uint8_t client_random[S2N_TLS_RANDOM_DATA_LEN] = "client random";
+    uint8_t server_random[S2N_TLS_RANDOM_DATA_LEN] = "server random";
+    uint8_t transcript_hash[SHA256_DIGEST_LENGTH] = "transcript hash";
+    uint8_t key_block[S2N_MAX_KEY_BLOCK_LEN] = { 0 };
+    uint8_t finished[S2N_TLS_FINISHED_LEN] = { 0 };
+
+    struct s2n_blob premaster_secret = { 0 }, master_secret = { 0 };
+    POSIX_GUARD(s2n_blob_init(&premaster_secret, premaster_secret_bytes, sizeof(premaster_secret_bytes)));
+    POSIX_GUARD(s2n_blob_init(&master_secret, master_secret_bytes, sizeof(master_secret_bytes)));
+    struct s2n_blob client_random_blob = { 0 }, server_random_blob = { 0 }, transcript_hash_blob = { 0 };
+    POSIX_GUARD(s2n_blob_init(&client_random_blob, client_random, sizeof(client_random)));
+    POSIX_GUARD(s2n_blob_init(&server_random_blob, server_random, sizeof(server_random)));
+    POSIX_GUARD(s2n_blob_init(&transcript_hash_blob, transcript_hash, sizeof(transcript_hash)));
+    struct s2n_blob key_block_blob = { 0 }, finished_blob = { 0 };
+    /* AES128-GCM: two 16 byte keys and two 4 byte implicit IVs */
+    POSIX_GUARD(s2n_blob_init(&key_block_blob, key_block, 40));
+    POSIX_GUARD(s2n_blob_init(&finished_blob, finished, sizeof(finished)));
+
+    uint8_t master_secret_label_bytes[] = "master secret";
+    uint8_t key_expansion_label_bytes[] = "key expansion";
+    uint8_t client_finished_label_bytes[] = "client finished";
+    uint8_t server_finished_label_bytes[] = "server finished";
+    struct s2n_blob master_secret_label = { 0 }, key_expansion_label = { 0 };
+    struct s2n_blob client_finished_label = { 0 }, server_finished_label = { 0 };
+    POSIX_GUARD(s2n_blob_init(&master_secret_label, master_secret_label_bytes, sizeof(master_secret_label_bytes) - 1));
+    POSIX_GUARD(s2n_blob_init(&key_expansion_label, key_expansion_label_bytes, sizeof(key_expansion_label_bytes) - 1));
+    POSIX_GUARD(s2n_blob_init(&client_finished_label, client_finished_label_bytes, sizeof(client_finished_label_bytes) - 1));
+    POSIX_GUARD(s2n_blob_init(&server_finished_label, server_finished_label_bytes, sizeof(server_finished_label_bytes) - 1));
+
+    struct s2n_benchmark bench = { .name = "s2n_prf_tls12_handshake" };
+    POSIX_GUARD(s2n_benchmark_set_params(&bench, "reuse_keyed_hmac=%d", reuse_keyed_hmac));
+    s2n_benchmark_start(&bench);
+    for (uint32_t i = 0; i < S2N_PRF_BENCHMARK_HANDSHAKES; i++) {
+        /* Every handshake has a new premaster secret, and so a new master secret */
+        premaster_secret_bytes[0] = i;
+        premaster_secret_bytes[1] = i >> 8;
+        POSIX_GUARD(s2n_prf_benchmark_call(conn, reuse_keyed_hmac, &premaster_secret, &master_secret_label,
+                &client_random_blob, &server_random_blob, &master_secret));
+        POSIX_GUARD(s2n_prf_benchmark_call(conn, reuse_keyed_hmac, &master_secret, &key_expansion_label,
+                &server_random_blob, &client_random_blob, &key_block_blob));
+        POSIX_GUARD(s2n_prf_benchmark_call(conn, reuse_keyed_hmac, &master_secret, &client_finished_label,
+                &transcript_hash_blob, NULL, &finished_blob));
+        POSIX_GUARD(s2n_prf_benchmark_call(conn, reuse_keyed_hmac, &master_secret, &server_finished_label,
+                &transcript_hash_blob, NULL, &finished_blob));
+    }
+    s2n_benchmark_stop(&bench, S2N_PRF_BENCHMARK_HANDSHAKES);
+
+    POSIX_GUARD(s2n_benchmark_report(&bench));
+
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    /* In FIPS mode the PRF is provided by the libcrypto instead */
+    if (s2n_is_in_fips_mode()) {
+        fprintf(stderr, "s2n_prf_tls12 skipped: the custom PRF is not used in FIPS mode\n");
+        s2n_benchmark_cleanup();
+        return 0;
+    }
+
+    const bool modes[] = { false, true };
+    for (size_t i = 0; i < s2n_array_len(modes); i++) {
+        if (s2n_prf_benchmark_run(modes[i]) != S2N_SUCCESS) {
+            fprintf(stderr, "s2n_prf benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+            return 1;
+        }
+    }
+
+    s2n_benchmark_cleanup();
+    return 0;
+}
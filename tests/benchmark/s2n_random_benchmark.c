@@ -0,0 +1,75 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Measures random data requests of the sizes made on the record and handshake paths.
+ *
+ * Small public requests, like explicit IVs and session IDs, are served from a per-thread
+ * pool of DRBG output. Private requests and larger public requests call the DRBG directly,
+ * which mixes in new entropy on every call.
+ *
+ * Build with -DS2N_BENCHMARKS=ON and run from any directory:
+ *   S2N_DONT_MLOCK=1 ./bin/s2n_random_benchmark [--json]
+ */
+
+#include <stdio.h>
+
+#include "api/s2n.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "utils/s2n_random.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_RANDOM_BENCHMARK_CALLS    100000
+#define S2N_RANDOM_BENCHMARK_MAX_SIZE 256
+
+static const uint32_t s2n_random_benchmark_sizes[] = { 8, 16, 32, 64, 256 };
+
+static int s2n_random_benchmark_run(const char *visibility, S2N_RESULT (*get_random_data)(struct s2n_blob *blob),
+        uint32_t size)
+{
+    uint8_t data[S2N_RANDOM_BENCHMARK_MAX_SIZE] = { 0 };
+    struct s2n_blob blob = { 0 };
+    POSIX_GUARD(s2n_blob_init(&blob, data, size));
+
+    struct s2n_benchmark bench = { .name = "s2n_get_random_data", .bytes_per_op = size };
+    POSIX_GUARD(s2n_benchmark_set_params(&bench, "visibility=%s bytes=%u", visibility, size));
+    s2n_benchmark_start(&bench);
+    for (size_t i = 0; i < S2N_RANDOM_BENCHMARK_CALLS; i++) {
+        POSIX_GUARD_RESULT(get_random_data(&blob));
+    }
+    s2n_benchmark_stop(&bench, S2N_RANDOM_BENCHMARK_CALLS);
+
+    POSIX_GUARD(s2n_benchmark_report(&bench));
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    for (size_t i = 0; i < s2n_array_len(s2n_random_benchmark_sizes); i++) {
+        uint32_t size = s2n_random_benchmark_sizes[i];
+        if (s2n_random_benchmark_run("public", s2n_get_public_random_data, size) != S2N_SUCCESS
+                || s2n_random_benchmark_run("private", s2n_get_private_random_data, size) != S2N_SUCCESS) {
+            fprintf(stderr, "random benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+            return 1;
+        }
+    }
+
+    s2n_benchmark_cleanup();
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Measures record protection with s2n_record_write and record decryption with
+ * s2n_record_parse for each record cipher and record sizes from 64B to 16KB.
+ *
+ * Records are written by a client connection and parsed by a server connection
+ * that share keys, so no handshake or I/O is included in the measurement.
+ *
+ * Build with -DS2N_BENCHMARKS=ON and run from any directory:
+ *   S2N_DONT_MLOCK=1 ./bin/s2n_record_benchmark [--json]
+ */
+
+#include <stdio.h>
+
+#include "api/s2n.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "stuffer/s2n_stuffer.h"
+#include "tls/s2n_cipher_suites.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_prf.h"
+#include "tls/s2n_record.h"
+#include "tls/s2n_tls13_key_schedule.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+/* Every measurement processes roughly this much plaintext */
+#define S2N_RECORD_BENCHMARK_BYTES (16 * 1024 * 1024)
+/* More than the header and expansion of any benchmarked cipher */
+#define S2N_RECORD_BENCHMARK_OVERHEAD 128
+
+struct s2n_record_benchmark_suite {
+    struct s2n_cipher_suite *cipher_suite;
+    uint8_t protocol_version;
+};
+
+static S2N_RESULT s2n_record_benchmark_set_keys(struct s2n_connection *conn,
+        const struct s2n_record_benchmark_suite *suite)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(suite);
+    conn->actual_protocol_version = suite->protocol_version;
+    conn->secure->cipher_suite = suite->cipher_suite;
+
+    /* Both connections start from the same all-zero secrets, so derive the same keys */
+    if (suite->protocol_version >= S2N_TLS13) {
+        const struct s2n_cipher *cipher = suite->cipher_suite->record_alg->cipher;
+        RESULT_GUARD(cipher->init(&conn->secure->client_key));
+        conn->secrets.extract_secret_type = S2N_MASTER_SECRET;
+        RESULT_GUARD(s2n_tls13_key_schedule_set_key(conn, S2N_MASTER_SECRET, S2N_CLIENT));
+    } else {
+        RESULT_GUARD_POSIX(s2n_prf_key_expansion(conn));
+        conn->client = conn->secure;
+        conn->server = conn->secure;
+    }
+    return S2N_RESULT_OK;
+}
+
+static int s2n_record_benchmark_run(const struct s2n_record_benchmark_suite *suite, uint32_t record_size)
+{
+    DEFER_CLEANUP(struct s2n_connection *writer = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+    POSIX_ENSURE_REF(writer);
+    DEFER_CLEANUP(struct s2n_connection *reader = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+    POSIX_ENSURE_REF(reader);
+    POSIX_GUARD_RESULT(s2n_record_benchmark_set_keys(writer, suite));
+    POSIX_GUARD_RESULT(s2n_record_benchmark_set_keys(reader, suite));
+    writer->max_outgoing_fragment_length = S2N_TLS_MAXIMUM_FRAGMENT_LENGTH;
+
+    DEFER_CLEANUP(struct s2n_blob plaintext = { 0 }, s2n_free);
+    POSIX_GUARD(s2n_alloc(&plaintext, record_size));
+    POSIX_GUARD(s2n_blob_zero(&plaintext));
+
+    const uint32_t records = S2N_RECORD_BENCHMARK_BYTES / record_size;
+    const char *cipher_name = suite->cipher_suite->iana_name;
+
+    /* Encrypt the records to parse up front, so that only s2n_record_parse is timed */
+    DEFER_CLEANUP(struct s2n_stuffer ciphertext = { 0 }, s2n_stuffer_free);
+    POSIX_GUARD(s2n_stuffer_growable_alloc(&ciphertext, records * (record_size + S2N_RECORD_BENCHMARK_OVERHEAD)));
+    for (uint32_t i = 0; i < records; i++) {
+        POSIX_GUARD_RESULT(s2n_record_write(writer, TLS_APPLICATION_DATA, &plaintext));
+        POSIX_GUARD(s2n_stuffer_copy(&writer->out, &ciphertext, s2n_stuffer_data_available(&writer->out)));
+        POSIX_GUARD(s2n_stuffer_rewrite(&writer->out));
+    }
+
+    struct s2n_benchmark parse = { .name = "s2n_record_parse", .bytes_per_op = record_size };
+    POSIX_GUARD(s2n_benchmark_set_params(&parse, "cipher=%s record_size=%u", cipher_name, record_size));
+    s2n_benchmark_start(&parse);
+    for (uint32_t i = 0; i < records; i++) {
+        /* The length is the last two bytes of the record header */
+        uint8_t *header = s2n_stuffer_raw_read(&ciphertext, 0);
+        POSIX_ENSURE_REF(header);
+        uint16_t encrypted_length = (header[3] << 8) | header[4];
+
+        POSIX_GUARD(s2n_stuffer_copy(&ciphertext, &reader->header_in, S2N_TLS_RECORD_HEADER_LENGTH));
+        POSIX_GUARD(s2n_stuffer_copy(&ciphertext, &reader->in, encrypted_length));
+        POSIX_GUARD(s2n_record_parse(reader));
+        POSIX_GUARD(s2n_stuffer_rewrite(&reader->header_in));
+        POSIX_GUARD(s2n_stuffer_rewrite(&reader->in));
+    }
+    s2n_benchmark_stop(&parse, records);
+
+    struct s2n_benchmark write = { .name = "s2n_record_write", .bytes_per_op = record_size };
+    POSIX_GUARD(s2n_benchmark_set_params(&write, "cipher=%s record_size=%u", cipher_name, record_size));
+    s2n_benchmark_start(&write);
+    for (uint32_t i = 0; i < records; i++) {
+        POSIX_GUARD_RESULT(s2n_record_write(writer, TLS_APPLICATION_DATA, &plaintext));
+        POSIX_GUARD(s2n_stuffer_rewrite(&writer->out));
+    }
+    s2n_benchmark_stop(&write, records);
+
+    POSIX_GUARD(s2n_benchmark_report(&write));
+    POSIX_GUARD(s2n_benchmark_report(&parse));
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    const struct s2n_record_benchmark_suite suites[] = {
+        { &s2n_tls13_aes_128_gcm_sha256, S2N_TLS13 },
+        { &s2n_tls13_aes_256_gcm_sha384, S2N_TLS13 },
+        { &s2n_tls13_chacha20_poly1305_sha256, S2N_TLS13 },
+        { &s2n_ecdhe_rsa_with_aes_128_gcm_sha256, S2N_TLS12 },
+        { &s2n_ecdhe_rsa_with_chacha20_poly1305_sha256, S2N_TLS12 },
+        { &s2n_ecdhe_rsa_with_aes_128_cbc_sha, S2N_TLS12 },
+    };
+    const uint32_t record_sizes[] = { 64, 256, 1024, 4096, S2N_TLS_MAXIMUM_FRAGMENT_LENGTH };
+
+    for (size_t i = 0; i < s2n_array_len(suites); i++) {
+        /* Not every libcrypto supports every record cipher */
+        if (!suites[i].cipher_suite->available) {
+            fprintf(stderr, "%s skipped: not supported by the libcrypto\n", suites[i].cipher_suite->iana_name);
+            continue;
+        }
+        for (size_t j = 0; j < s2n_array_len(record_sizes); j++) {
+            if (s2n_record_benchmark_run(&suites[i], record_sizes[j]) != S2N_SUCCESS) {
+                fprintf(stderr, "s2n_record benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+                return 1;
+            }
+        }
+    }
+
+    s2n_benchmark_cleanup();
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Measures server name to certificate matching with 100k SAN entries.
+ *
+ * Compares the single trie walk used by s2n_conn_find_name_matching_certs with the
+ * exact s2n_map lookup, wildcard name construction and second s2n_map lookup it replaced.
+ *
+ * Build with -DS2N_BENCHMARKS=ON and run from any directory:
+ *   S2N_DONT_MLOCK=1 ./bin/s2n_sni_benchmark [--json]
+ */
+
+#include <stdio.h>
+
+#include "api/s2n.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "stuffer/s2n_stuffer.h"
+#include "tls/s2n_handshake.h"
+#include "tls/s2n_sni_trie.h"
+#include "utils/s2n_map.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_SNI_BENCHMARK_SAN_ENTRIES 100000
+#define S2N_SNI_BENCHMARK_LOOKUPS     1000000
+#define S2N_SNI_BENCHMARK_NAME_LEN    64
+
+/* Every tenant has an exact name and a wildcard name, spread over a few parent domains */
+static int s2n_sni_benchmark_san(char *buffer, uint32_t i, struct s2n_blob *name)
+{
+    const char *format = (i % 2) ? "*.tenant%06u.example%u.com" : "www.tenant%06u.example%u.com";
+    int written = snprintf(buffer, S2N_SNI_BENCHMARK_NAME_LEN, format, i / 2, i % 7);
+    POSIX_ENSURE(written > 0 && written < S2N_SNI_BENCHMARK_NAME_LEN, S2N_ERR_SAFETY);
+    POSIX_GUARD(s2n_blob_init(name, (uint8_t *) buffer, written));
+    return S2N_SUCCESS;
+}
+
+/* A third of lookups match exactly, a third only match a wildcard and a third miss */
+static int s2n_sni_benchmark_server_name(char *buffer, uint32_t i, struct s2n_blob *name)
+{
+    uint32_t tenant = (i / 3) % (S2N_SNI_BENCHMARK_SAN_ENTRIES / 2);
+    const char *format = NULL;
+    switch (i % 3) {
+        case 0:
+            format = "www.tenant%06u.example%u.com";
+            break;
+        case 1:
+            format = "api.tenant%06u.example%u.com";
+            break;
+        default:
+            format = "www.tenant%06u.missing%u.com";
+            break;
+    }
+    int written = snprintf(buffer, S2N_SNI_BENCHMARK_NAME_LEN, format, tenant, (tenant * 2 + (i % 3 == 1)) % 7);
+    POSIX_ENSURE(written > 0 && written < S2N_SNI_BENCHMARK_NAME_LEN, S2N_ERR_SAFETY);
+    POSIX_GUARD(s2n_blob_init(name, (uint8_t *) buffer, written));
+    return S2N_SUCCESS;
+}
+
+static int s2n_sni_benchmark_map_lookup(struct s2n_map *map, struct s2n_blob *name, uint32_t *matches)
+{
+    struct s2n_blob value = { 0 };
+    bool found = false;
+    POSIX_GUARD_RESULT(s2n_map_lookup(map, name, &value, &found));
+    if (found) {
+        (*matches)++;
+        return S2N_SUCCESS;
+    }
+
+    struct s2n_stuffer name_stuffer = { 0 };
+    POSIX_GUARD(s2n_stuffer_init_written(&name_stuffer, name));
+    char wildcard[S2N_MAX_SERVER_NAME + 1] = { 0 };
+    struct s2n_blob wildcard_blob = { 0 };
+    POSIX_GUARD(s2n_blob_init(&wildcard_blob, (uint8_t *) wildcard, sizeof(wildcard)));
+    struct s2n_stuffer wildcard_stuffer = { 0 };
+    POSIX_GUARD(s2n_stuffer_init(&wildcard_stuffer, &wildcard_blob));
+    POSIX_GUARD(s2n_create_wildcard_hostname(&name_stuffer, &wildcard_stuffer));
+
+    wildcard_blob.size = s2n_stuffer_data_available(&wildcard_stuffer);
+    if (wildcard_blob.size == 0) {
+        return S2N_SUCCESS;
+    }
+    POSIX_GUARD_RESULT(s2n_map_lookup(map, &wildcard_blob, &value, &found));
+    *matches += found;
+    return S2N_SUCCESS;
+}
+
+static int s2n_sni_benchmark_run(void)
+{
+    struct certs_by_type certs = { 0 };
+    certs.certs[S2N_PKEY_TYPE_RSA] = (struct s2n_cert_chain_and_key *) (uintptr_t) 1;
+    struct s2n_blob value = { 0 };
+    POSIX_GUARD(s2n_blob_init(&value, (uint8_t *) &certs, sizeof(certs)));
+
+    DEFER_CLEANUP(struct s2n_sni_trie *trie = NULL, s2n_sni_trie_ptr_free);
+    POSIX_GUARD_RESULT(s2n_sni_trie_new(&trie));
+    DEFER_CLEANUP(struct s2n_map *map = s2n_map_new(), s2n_map_free_pointer);
+    POSIX_ENSURE_REF(map);
+
+    char buffer[S2N_SNI_BENCHMARK_NAME_LEN] = { 0 };
+    struct s2n_blob name = { 0 };
+
+    struct s2n_benchmark trie_insert = { .name = "s2n_sni_insert" };
+    POSIX_GUARD(s2n_benchmark_set_params(&trie_insert, "impl=trie san_entries=%u", S2N_SNI_BENCHMARK_SAN_ENTRIES));
+    s2n_benchmark_start(&trie_insert);
+    for (uint32_t i = 0; i < S2N_SNI_BENCHMARK_SAN_ENTRIES; i++) {
+        POSIX_GUARD(s2n_sni_benchmark_san(buffer, i, &name));
+        POSIX_GUARD_RESULT(s2n_sni_trie_set(trie, &name, &certs));
+    }
+    s2n_benchmark_stop(&trie_insert, S2N_SNI_BENCHMARK_SAN_ENTRIES);
+
+    struct s2n_benchmark map_insert = { .name = "s2n_sni_insert" };
+    POSIX_GUARD(s2n_benchmark_set_params(&map_insert, "impl=map+wildcard san_entries=%u", S2N_SNI_BENCHMARK_SAN_ENTRIES));
+    s2n_benchmark_start(&map_insert);
+    for (uint32_t i = 0; i < S2N_SNI_BENCHMARK_SAN_ENTRIES; i++) {
+        POSIX_GUARD(s2n_sni_benchmark_san(buffer, i, &name));
+        POSIX_GUARD_RESULT(s2n_map_add(map, &name, &value));
+    }
+    POSIX_GUARD_RESULT(s2n_map_complete(map));
+    s2n_benchmark_stop(&map_insert, S2N_SNI_BENCHMARK_SAN_ENTRIES);
+
+    /* Format the server names up front so that only matching is timed */
+    DEFER_CLEANUP(struct s2n_blob server_names = { 0 }, s2n_free);
+    POSIX_GUARD(s2n_alloc(&server_names, S2N_SNI_BENCHMARK_LOOKUPS * S2N_SNI_BENCHMARK_NAME_LEN));
+    static uint8_t server_name_sizes[S2N_SNI_BENCHMARK_LOOKUPS] = { 0 };
+    for (uint32_t i = 0; i < S2N_SNI_BENCHMARK_LOOKUPS; i++) {
+        char *server_name = (char *) server_names.data + (i * S2N_SNI_BENCHMARK_NAME_LEN);
+        POSIX_GUARD(s2n_sni_benchmark_server_name(server_name, i, &name));
+        server_name_sizes[i] = name.size;
+    }
+
+    uint32_t trie_matches = 0;
+    struct s2n_benchmark trie_lookup = { .name = "s2n_sni_lookup" };
+    POSIX_GUARD(s2n_benchmark_set_params(&trie_lookup, "impl=trie san_entries=%u", S2N_SNI_BENCHMARK_SAN_ENTRIES));
+    s2n_benchmark_start(&trie_lookup);
+    for (uint32_t i = 0; i < S2N_SNI_BENCHMARK_LOOKUPS; i++) {
+        name.data = server_names.data + (i * S2N_SNI_BENCHMARK_NAME_LEN);
+        name.size = server_name_sizes[i];
+        struct s2n_sni_trie_match match = { 0 };
+        POSIX_GUARD_RESULT(s2n_sni_trie_lookup(trie, &name, &match));
+        trie_matches += (match.exact_match_exists || match.wildcard_match_exists);
+    }
+    s2n_benchmark_stop(&trie_lookup, S2N_SNI_BENCHMARK_LOOKUPS);
+
+    uint32_t map_matches = 0;
+    struct s2n_benchmark map_lookup = { .name = "s2n_sni_lookup" };
+    POSIX_GUARD(s2n_benchmark_set_params(&map_lookup, "impl=map+wildcard san_entries=%u", S2N_SNI_BENCHMARK_SAN_ENTRIES));
+    s2n_benchmark_start(&map_lookup);
+    for (uint32_t i = 0; i < S2N_SNI_BENCHMARK_LOOKUPS; i++) {
+        name.data = server_names.data + (i * S2N_SNI_BENCHMARK_NAME_LEN);
+        name.size = server_name_sizes[i];
+        POSIX_GUARD(s2n_sni_benchmark_map_lookup(map, &name, &map_matches));
+    }
+    s2n_benchmark_stop(&map_lookup, S2N_SNI_BENCHMARK_LOOKUPS);
+
+    /* Both approaches must agree on which server names match */
+    POSIX_ENSURE_EQ(trie_matches, map_matches);
+
+    POSIX_GUARD(s2n_benchmark_report(&trie_insert));
+    POSIX_GUARD(s2n_benchmark_report(&map_insert));
+    POSIX_GUARD(s2n_benchmark_report(&trie_lookup));
+    POSIX_GUARD(s2n_benchmark_report(&map_lookup));
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    if (s2n_sni_benchmark_run() != S2N_SUCCESS) {
+        fprintf(stderr, "SNI benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    s2n_benchmark_cleanup();
+    return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Measures the stuffer operations used to serialize and parse every handshake
+ * message and record: fixed width integers, byte copies, and growable stuffers.
+ *
+ * Build with -DS2N_BENCHMARKS=ON and run from any directory:
+ *   S2N_DONT_MLOCK=1 ./bin/s2n_stuffer_benchmark [--json]
+ */
+
+#include <stdio.h>
+
+#include "api/s2n.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "stuffer/s2n_stuffer.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_STUFFER_BENCHMARK_INT_OPS  (4 * 1024 * 1024)
+#define S2N_STUFFER_BENCHMARK_BYTES    (16 * 1024 * 1024)
+#define S2N_STUFFER_BENCHMARK_BUF_SIZE 16384
+/* The size of a large handshake message, like a certificate chain */
+#define S2N_STUFFER_BENCHMARK_GROWABLE_SIZE 16384
+
+static int s2n_stuffer_benchmark_write_uint(struct s2n_stuffer *stuffer, uint8_t width, uint32_t value)
+{
+    switch (width) {
+        case 1:
+            return s2n_stuffer_write_uint8(stuffer, value);
+        case 2:
+            return s2n_stuffer_write_uint16(stuffer, value);
+        case 3:
+            return s2n_stuffer_write_uint24(stuffer, value);
+        case 4:
+            return s2n_stuffer_write_uint32(stuffer, value);
+        default:
+            POSIX_BAIL(S2N_ERR_SAFETY);
+    }
+}
+
+static int s2n_stuffer_benchmark_read_uint(struct s2n_stuffer *stuffer, uint8_t width, uint32_t *value)
+{
+    uint8_t u8 = 0;
+    uint16_t u16 = 0;
+    switch (width) {
+        case 1:
+            POSIX_GUARD(s2n_stuffer_read_uint8(stuffer, &u8));
+            *value = u8;
+            return S2N_SUCCESS;
+        case 2:
+            POSIX_GUARD(s2n_stuffer_read_uint16(stuffer, &u16));
+            *value = u16;
+            return S2N_SUCCESS;
+        case 3:
+            return s2n_stuffer_read_uint24(stuffer, value);
+        case 4:
+            return s2n_stuffer_read_uint32(stuffer, value);
+        default:
+            POSIX_BAIL(S2N_ERR_SAFETY);
+    }
+}
+
+static int s2n_stuffer_benchmark_uint(uint8_t width)
+{
+    uint8_t buffer[S2N_STUFFER_BENCHMARK_BUF_SIZE] = { 0 };
+    struct s2n_blob blob = { 0 };
+    POSIX_GUARD(s2n_blob_init(&blob, buffer, sizeof(buffer)));
+    struct s2n_stuffer stuffer = { 0 };
+    POSIX_GUARD(s2n_stuffer_init(&stuffer, &blob));
+
+    struct s2n_benchmark write = { .name = "s2n_stuffer_write_uint", .bytes_per_op = width };
+    POSIX_GUARD(s2n_benchmark_set_params(&write, "bits=%u", width * 8));
+    s2n_benchmark_start(&write);
+    for (uint32_t i = 0; i < S2N_STUFFER_BENCHMARK_INT_OPS; i++) {
+        if (s2n_stuffer_space_remaining(&stuffer) < width) {
+            POSIX_GUARD(s2n_stuffer_rewrite(&stuffer));
+        }
+        POSIX_GUARD(s2n_stuffer_benchmark_write_uint(&stuffer, width, i));
+    }
+    s2n_benchmark_stop(&write, S2N_STUFFER_BENCHMARK_INT_OPS);
+
+    uint32_t value = 0, checksum = 0;
+    struct s2n_benchmark read = { .name = "s2n_stuffer_read_uint", .bytes_per_op = width };
+    POSIX_GUARD(s2n_benchmark_set_params(&read, "bits=%u", width * 8));
+    s2n_benchmark_start(&read);
+    for (uint32_t i = 0; i < S2N_STUFFER_BENCHMARK_INT_OPS; i++) {
+        if (s2n_stuffer_data_available(&stuffer) < width) {
+            POSIX_GUARD(s2n_stuffer_reread(&stuffer));
+        }
+        POSIX_GUARD(s2n_stuffer_benchmark_read_uint(&stuffer, width, &value));
+        checksum += value;
+    }
+    s2n_benchmark_stop(&read, S2N_STUFFER_BENCHMARK_INT_OPS);
+
+    /* Keep the reads from being optimized away */
+    if (checksum == 1) {
+        fprintf(stderr, "unlikely checksum\n");
+    }
+
+    POSIX_GUARD(s2n_benchmark_report(&write));
+    POSIX_GUARD(s2n_benchmark_report(&read));
+    return S2N_SUCCESS;
+}
+
+static int s2n_stuffer_benchmark_bytes(uint32_t size)
+{
+    uint8_t buffer[S2N_STUFFER_BENCHMARK_BUF_SIZE] = { 0 };
+    struct s2n_blob blob = { 0 };
+    POSIX_GUARD(s2n_blob_init(&blob, buffer, sizeof(buffer)));
+    struct s2n_stuffer stuffer = { 0 };
+    POSIX_GUARD(s2n_stuffer_init(&stuffer, &blob));
+
+    uint8_t data[S2N_STUFFER_BENCHMARK_BUF_SIZE] = { 0 };
+    POSIX_ENSURE_LTE(size, sizeof(data));
+    const uint32_t ops = S2N_STUFFER_BENCHMARK_BYTES / size;
+
+    struct s2n_benchmark write = { .name = "s2n_stuffer_write_bytes", .bytes_per_op = size };
+    POSIX_GUARD(s2n_benchmark_set_params(&write, "size=%u", size));
+    s2n_benchmark_start(&write);
+    for (uint32_t i = 0; i < ops; i++) {
+        if (s2n_stuffer_space_remaining(&stuffer) < size) {
+            POSIX_GUARD(s2n_stuffer_rewrite(&stuffer));
+        }
+        POSIX_GUARD(s2n_stuffer_write_bytes(&stuffer, data, size));
+    }
+    s2n_benchmark_stop(&write, ops);
+
+    struct s2n_benchmark read = { .name = "s2n_stuffer_read_bytes", .bytes_per_op = size };
+    POSIX_GUARD(s2n_benchmark_set_params(&read, "size=%u", size));
+    s2n_benchmark_start(&read);
+    for (uint32_t i = 0; i < ops; i++) {
+        if (s2n_stuffer_data_available(&stuffer) < size) {
+            POSIX_GUARD(s2n_stuffer_reread(&stuffer));
+        }
+        POSIX_GUARD(s2n_stuffer_read_bytes(&stuffer, data, size));
+    }
+    s2n_benchmark_stop(&read, ops);
+
+    POSIX_GUARD(s2n_benchmark_report(&write));
+    POSIX_GUARD(s2n_benchmark_report(&read));
+    return S2N_SUCCESS;
+}
+
+/* Builds a large message in small pieces, the way handshake messages are written */
+static int s2n_stuffer_benchmark_growable(uint32_t chunk_size)
+{
+    uint8_t chunk[S2N_STUFFER_BENCHMARK_GROWABLE_SIZE] = { 0 };
+    POSIX_ENSURE_LTE(chunk_size, sizeof(chunk));
+    const uint32_t ops = S2N_STUFFER_BENCHMARK_BYTES / S2N_STUFFER_BENCHMARK_GROWABLE_SIZE;
+
+    struct s2n_benchmark bench = { .name = "s2n_stuffer_growable_write",
+        .bytes_per_op = S2N_STUFFER_BENCHMARK_GROWABLE_SIZE };
+    POSIX_GUARD(s2n_benchmark_set_params(&bench, "chunk_size=%u total_size=%u", chunk_size,
+            S2N_STUFFER_BENCHMARK_GROWABLE_SIZE));
+    s2n_benchmark_start(&bench);
+    for (uint32_t i = 0; i < ops; i++) {
+        DEFER_CLEANUP(struct s2n_stuffer stuffer = { 0 }, s2n_stuffer_free);
+        POSIX_GUARD(s2n_stuffer_growable_alloc(&stuffer, 0));
+        for (uint32_t written = 0; written < S2N_STUFFER_BENCHMARK_GROWABLE_SIZE; written += chunk_size) {
+            POSIX_GUARD(s2n_stuffer_write_bytes(&stuffer, chunk, chunk_size));
+        }
+    }
+    s2n_benchmark_stop(&bench, ops);
+
+    POSIX_GUARD(s2n_benchmark_report(&bench));
+    return S2N_SUCCESS;
+}
+
+static int s2n_stuffer_benchmark_run(void)
+{
+    const uint8_t widths[] = { 1, 2, 3, 4 };
+    for (size_t i = 0; i < s2n_array_len(widths); i++) {
+        POSIX_GUARD(s2n_stuffer_benchmark_uint(widths[i]));
+    }
+
+    const uint32_t sizes[] = { 64, 256, 1024, 4096, 16384 };
+    for (size_t i = 0; i < s2n_array_len(sizes); i++) {
+        POSIX_GUARD(s2n_stuffer_benchmark_bytes(sizes[i]));
+    }
+
+    const uint32_t chunk_sizes[] = { 64, 1024 };
+    for (size_t i = 0; i < s2n_array_len(chunk_sizes); i++) {
+        POSIX_GUARD(s2n_stuffer_benchmark_growable(chunk_sizes[i]));
+    }
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    if (s2n_stuffer_benchmark_run() != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_stuffer benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    s2n_benchmark_cleanup();
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Measures session ticket encryption and decryption with and without ticket key caching,
+ * and ticket key selection and lookup with the maximum number of ticket keys.
+ *
+ * Without caching, every ticket derives a unique key with HKDF and key schedules a new
+ * AES-GCM context. With caching, the initialized contexts are reused.
+ *
+ * Build with -DS2N_BENCHMARKS=ON and run from any directory:
+ *   S2N_DONT_MLOCK=1 ./bin/s2n_ticket_benchmark [--json]
+ */
+
+#include <stdio.h>
+
+#include "api/s2n.h"
+#include "api/unstable/ticket_keys.h"
+#include "benchmark/harness/s2n_benchmark.h"
+#include "stuffer/s2n_stuffer.h"
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_resume.h"
+#include "tls/s2n_tls.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_TICKET_BENCHMARK_TICKETS 20000
+#define S2N_TICKET_BENCHMARK_LOOKUPS 1000000
+
+static int s2n_ticket_benchmark_run(bool cache_ticket_keys)
+{
+    DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+    POSIX_ENSURE_REF(config);
+    POSIX_GUARD(s2n_config_set_session_tickets_onoff(config, true));
+    POSIX_GUARD(s2n_config_set_ticket_key_caching(config, cache_ticket_keys));
+
+    uint8_t key_name[] = "benchmark";
+    uint8_t key[32] = "0123456789abcdef0123456789abcdef";
+    POSIX_GUARD(s2n_config_add_ticket_crypto_key(config, key_name, sizeof(key_name), key, sizeof(key), 0));
+
+    DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+    POSIX_ENSURE_REF(conn);
+    POSIX_GUARD(s2n_connection_set_config(conn, config));
+    conn->actual_protocol_version = S2N_TLS12;
+    conn->handshake.handshake_type = NEGOTIATED;
+    conn->secure->cipher_suite = &s2n_ecdhe_ecdsa_with_aes_128_gcm_sha256;
+
+    DEFER_CLEANUP(struct s2n_blob tickets_mem = { 0 }, s2n_free);
+    POSIX_GUARD(s2n_alloc(&tickets_mem, S2N_TICKET_BENCHMARK_TICKETS * S2N_TLS12_TICKET_SIZE_IN_BYTES));
+
+    struct s2n_ticket_key *ticket_key = s2n_get_ticket_encrypt_decrypt_key(config);
+    POSIX_ENSURE_REF(ticket_key);
+
+    struct s2n_blob ticket_blob = { 0 };
+    struct s2n_stuffer ticket = { 0 };
+
+    struct s2n_benchmark encrypt = { .name = "s2n_ticket_encrypt" };
+    POSIX_GUARD(s2n_benchmark_set_params(&encrypt, "cache_ticket_keys=%d", cache_ticket_keys));
+    s2n_benchmark_start(&encrypt);
+    for (uint32_t i = 0; i < S2N_TICKET_BENCHMARK_TICKETS; i++) {
+        POSIX_GUARD(s2n_blob_slice(&tickets_mem, &ticket_blob, i * S2N_TLS12_TICKET_SIZE_IN_BYTES,
+                S2N_TLS12_TICKET_SIZE_IN_BYTES));
+        POSIX_GUARD(s2n_stuffer_init(&ticket, &ticket_blob));
+        POSIX_GUARD_RESULT(s2n_resume_encrypt_session_ticket(conn, ticket_key->key_name, &ticket));
+    }
+    s2n_benchmark_stop(&encrypt, S2N_TICKET_BENCHMARK_TICKETS);
+
+    struct s2n_benchmark decrypt = { .name = "s2n_ticket_decrypt" };
+    POSIX_GUARD(s2n_benchmark_set_params(&decrypt, "cache_ticket_keys=%d", cache_ticket_keys));
+    s2n_benchmark_start(&decrypt);
+    for (uint32_t i = 0; i < S2N_TICKET_BENCHMARK_TICKETS; i++) {
+        POSIX_GUARD(s2n_blob_slice(&tickets_mem, &ticket_blob, i * S2N_TLS12_TICKET_SIZE_IN_BYTES,
+                S2N_TLS12_TICKET_SIZE_IN_BYTES));
+        POSIX_GUARD(s2n_stuffer_init_written(&ticket, &ticket_blob));
+        POSIX_GUARD_RESULT(s2n_resume_decrypt_session(conn, &ticket));
+    }
+    s2n_benchmark_stop(&decrypt, S2N_TICKET_BENCHMARK_TICKETS);
+
+    POSIX_GUARD(s2n_benchmark_report(&encrypt));
+    POSIX_GUARD(s2n_benchmark_report(&decrypt));
+
+    return S2N_SUCCESS;
+}
+
+/* Keys are introduced every 30 minutes, so most keys are only in the decrypt state */
+static int s2n_ticket_benchmark_run_key_lookup(void)
+{
+    DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+    POSIX_ENSURE_REF(config);
+    POSIX_GUARD(s2n_config_set_session_tickets_onoff(config, true));
+    POSIX_GUARD(s2n_config_set_ticket_decrypt_key_lifetime(config, S2N_MAX_TICKET_KEYS * 1800));
+
+    uint64_t now = 0;
+    POSIX_GUARD_RESULT(s2n_config_wall_clock(config, &now));
+    uint64_t first_intro_secs = (now / ONE_SEC_IN_NANOS) - ((S2N_MAX_TICKET_KEYS - 1) * 1800);
+
+    uint8_t key_name[S2N_TICKET_KEY_NAME_LEN] = "benchmark";
+    uint8_t key[32] = "0123456789abcdef0123456789abcdef";
+    for (uint32_t i = 0; i < S2N_MAX_TICKET_KEYS; i++) {
+        key_name[sizeof(key_name) - 1] = i;
+        key[sizeof(key) - 1] = i;
+        POSIX_GUARD(s2n_config_add_ticket_crypto_key(config, key_name, sizeof(key_name), key, sizeof(key),
+                first_intro_secs + (i * 1800)));
+    }
+
+    struct s2n_benchmark select = { .name = "s2n_ticket_key_select" };
+    POSIX_GUARD(s2n_benchmark_set_params(&select, "keys=%u", S2N_MAX_TICKET_KEYS));
+    s2n_benchmark_start(&select);
+    for (uint32_t i = 0; i < S2N_TICKET_BENCHMARK_LOOKUPS; i++) {
+        POSIX_ENSURE_REF(s2n_get_ticket_encrypt_decrypt_key(config));
+    }
+    s2n_benchmark_stop(&select, S2N_TICKET_BENCHMARK_LOOKUPS);
+
+    struct s2n_benchmark find = { .name = "s2n_ticket_key_find" };
+    POSIX_GUARD(s2n_benchmark_set_params(&find, "keys=%u", S2N_MAX_TICKET_KEYS));
+    s2n_benchmark_start(&find);
+    for (uint32_t i = 0; i < S2N_TICKET_BENCHMARK_LOOKUPS; i++) {
+        key_name[sizeof(key_name) - 1] = i % S2N_MAX_TICKET_KEYS;
+        POSIX_ENSURE_REF(s2n_find_ticket_key(config, key_name));
+    }
+    s2n_benchmark_stop(&find, S2N_TICKET_BENCHMARK_LOOKUPS);
+
+    POSIX_GUARD(s2n_benchmark_report(&select));
+    POSIX_GUARD(s2n_benchmark_report(&find));
+
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (s2n_benchmark_init(argc, argv) != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_benchmark_init failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    const bool modes[] = { false, true };
+    for (size_t i = 0; i < s2n_array_len(modes); i++) {
+        if (s2n_ticket_benchmark_run(modes[i]) != S2N_SUCCESS) {
+            fprintf(stderr, "s2n_ticket benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+            return 1;
+        }
+    }
+
+    if (s2n_ticket_benchmark_run_key_lookup() != S2N_SUCCESS) {
+        fprintf(stderr, "s2n_ticket_key benchmark failed: %s\n", s2n_strerror(s2n_errno, "EN"));
+        return 1;
+    }
+
+    s2n_benchmark_cleanup();
+    return 0;
+}
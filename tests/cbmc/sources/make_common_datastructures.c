@@ -349,8 +349,7 @@ struct s2n_config *cbmc_allocate_s2n_config()
     struct s2n_config *s2n_config = malloc(sizeof(*s2n_config));
     PTR_ENSURE_REF(s2n_config);
     s2n_config->dhparams                = cbmc_allocate_dh_params();
-    s2n_config->domain_name_to_cert_map = cbmc_allocate_s2n_map();
-    /* `s2n_config->default_certs_by_type` is never allocated.
+    /* `s2n_config->domain_name_to_cert_trie` and `s2n_config->default_certs_by_type` are never allocated.
      * If required, this initialization should be done in the proof harness.
      */
     cbmc_populate_s2n_blob(&s2n_config->application_protocols);
@@ -674,13 +673,9 @@ void cbmc_populate_s2n_handshake(struct s2n_handshake *s2n_handshake)
 {
     CBMC_ENSURE_REF(s2n_handshake);
     cbmc_populate_s2n_stuffer(&(s2n_handshake->io));
-    cbmc_populate_s2n_hash_state(&(s2n_handshake->hashes->md5));
-    cbmc_populate_s2n_hash_state(&(s2n_handshake->hashes->sha1));
-    cbmc_populate_s2n_hash_state(&(s2n_handshake->hashes->sha224));
-    cbmc_populate_s2n_hash_state(&(s2n_handshake->hashes->sha256));
-    cbmc_populate_s2n_hash_state(&(s2n_handshake->hashes->sha384));
-    cbmc_populate_s2n_hash_state(&(s2n_handshake->hashes->sha512));
-    cbmc_populate_s2n_hash_state(&(s2n_handshake->hashes->md5_sha1));
+    for (s2n_hash_algorithm alg = S2N_HASH_MD5; alg <= S2N_HASH_MD5_SHA1; alg++) {
+        s2n_handshake->hashes->transcript_hashes[alg] = cbmc_allocate_s2n_hash_state();
+    }
     cbmc_populate_s2n_hash_state(&(s2n_handshake->hashes->hash_workspace));
     /* `s2n_handshake->early_data_async_state.conn` is never allocated.
      * If required, this initialization should be done in the validation function.
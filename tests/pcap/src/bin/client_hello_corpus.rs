@@ -0,0 +1,43 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Exports every ClientHello in the test pcaps as a corpus for
+//! tests/benchmark/s2n_client_hello_replay_benchmark.c.
+//!
+//! Each ClientHello is written as one line of hex: the complete handshake message,
+//! including its header. Comment lines starting with '#' name the pcap that the
+//! following ClientHellos came from.
+//!
+//! Run with `cargo run --bin client_hello_corpus -- <output file>`. Enable the
+//! `download` feature to include the real-world captures downloaded by build.rs.
+
+use anyhow::*;
+use pcap::{all_pcaps, handshake_message::Builder};
+use std::{
+    fs::File,
+    io::{BufWriter, Write},
+};
+
+fn main() -> Result<()> {
+    let path = std::env::args()
+        .nth(1)
+        .context("usage: client_hello_corpus <output file>")?;
+    let mut output = BufWriter::new(File::create(&path)?);
+
+    let mut count = 0;
+    for pcap in all_pcaps() {
+        let mut builder = Builder::default();
+        builder.set_capture_file(&pcap);
+        let hellos = builder.build_client_hellos()?;
+
+        writeln!(output, "# {pcap}")?;
+        for hello in hellos {
+            writeln!(output, "{}", hex::encode(hello.message().bytes()))?;
+            count += 1;
+        }
+    }
+    output.flush()?;
+
+    println!("Wrote {count} ClientHellos to {path}");
+    Ok(())
+}
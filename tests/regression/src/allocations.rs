@@ -0,0 +1,142 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+//! Counts the heap allocations made while a test runs.
+//!
+//! The s2n-tls bindings install memory callbacks that route every `s2n_alloc`,
+//! `s2n_realloc` and `s2n_free` through the Rust global allocator, so a counting
+//! global allocator sees all of the memory s2n-tls manages. `s2n_realloc` allocates
+//! a new buffer and frees the old one, so it is counted as an allocation and a free.
+//! Memory allocated directly by the libcrypto is not counted.
+//!
+//! Only allocations made by the measuring thread while it is measuring are counted,
+//! so tests running in parallel don't affect each other.
+
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    cell::Cell,
+    fmt,
+    str::FromStr,
+};
+
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct AllocationCounts {
+    pub allocations: u64,
+    pub reallocations: u64,
+    pub frees: u64,
+    /// Bytes requested by allocations and reallocations
+    pub bytes: u64,
+}
+
+impl AllocationCounts {
+    const ZERO: AllocationCounts = AllocationCounts {
+        allocations: 0,
+        reallocations: 0,
+        frees: 0,
+        bytes: 0,
+    };
+
+    /// Every call that may have requested new memory
+    pub fn total_allocations(&self) -> u64 {
+        self.allocations + self.reallocations
+    }
+}
+
+/// The format stored in the regression artifacts, one `name value` pair per line
+impl fmt::Display for AllocationCounts {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        writeln!(f, "allocations {}", self.allocations)?;
+        writeln!(f, "reallocations {}", self.reallocations)?;
+        writeln!(f, "frees {}", self.frees)?;
+        writeln!(f, "bytes {}", self.bytes)
+    }
+}
+
+impl FromStr for AllocationCounts {
+    type Err = String;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        let mut counts = AllocationCounts::ZERO;
+        for line in s.lines() {
+            let (name, value) = line
+                .split_once(' ')
+                .ok_or_else(|| format!("Invalid allocation count: {line}"))?;
+            let value: u64 = value
+                .parse()
+                .map_err(|e| format!("Invalid allocation count {line}: {e}"))?;
+            match name {
+                "allocations" => counts.allocations = value,
+                "reallocations" => counts.reallocations = value,
+                "frees" => counts.frees = value,
+                "bytes" => counts.bytes = value,
+                _ => return Err(format!("Unknown allocation count: {name}")),
+            }
+        }
+        Ok(counts)
+    }
+}
+
+thread_local! {
+    // const initialized without destructors, so safe to access from the allocator
+    static MEASURING: Cell<bool> = const { Cell::new(false) };
+    static COUNTS: Cell<AllocationCounts> = const { Cell::new(AllocationCounts::ZERO) };
+}
+
+pub struct CountingAllocator;
+
+impl CountingAllocator {
+    fn record(update: impl FnOnce(&mut AllocationCounts)) {
+        // try_with, since the allocator may be called while the thread is exiting
+        let measuring = MEASURING.try_with(Cell::get).unwrap_or(false);
+        if measuring {
+            let _ = COUNTS.try_with(|counts| {
+                let mut current = counts.get();
+                update(&mut current);
+                counts.set(current);
+            });
+        }
+    }
+}
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        Self::record(|counts| {
+            counts.allocations += 1;
+            counts.bytes += layout.size() as u64;
+        });
+        System.alloc(layout)
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        Self::record(|counts| {
+            counts.allocations += 1;
+            counts.bytes += layout.size() as u64;
+        });
+        System.alloc_zeroed(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        Self::record(|counts| counts.frees += 1);
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        Self::record(|counts| {
+            counts.reallocations += 1;
+            counts.bytes += new_size as u64;
+        });
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+/// Runs `f` and returns the allocations it made on the current thread.
+pub fn count_allocations<T>(f: impl FnOnce() -> T) -> (T, AllocationCounts) {
+    COUNTS.with(|counts| counts.set(AllocationCounts::ZERO));
+    MEASURING.with(|measuring| measuring.set(true));
+    let result = f();
+    MEASURING.with(|measuring| measuring.set(false));
+    (result, COUNTS.with(Cell::get))
+}
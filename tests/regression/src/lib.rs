@@ -1,6 +1,8 @@
 // Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
 // SPDX-License-Identifier: Apache-2.0
 
+pub mod allocations;
+
 pub mod git {
     use std::process::Command;
 
@@ -65,11 +67,13 @@ mod tests {
     use futures_test::task::noop_waker;
     use s2n_tls::{
         config::Builder,
+        enums::ClientAuthType,
         security,
         testing::{CertKeyPair, InsecureAcceptAllCertificatesHandler},
     };
     type Error = s2n_tls::error::Error;
     use super::*;
+    use crate::allocations::{count_allocations, AllocationCounts};
     use crabgrind as cg;
     use s2n_tls::testing::TestPair;
     use std::{
@@ -77,6 +81,7 @@ mod tests {
         fs::{create_dir_all, write},
         io::{self, BufRead},
         process::{Command, Output},
+        task::Poll,
         time::{Duration, SystemTime},
     };
 
@@ -134,6 +139,134 @@ mod tests {
         Ok(())
     }
 
+    /// Runs an allocation harness. `test_body` returns the allocations made by the measured part
+    /// of the test, which must not make more than `budget` allocations and reallocations.
+    ///
+    /// Allocation counts don't need valgrind, but are recorded and compared alongside the
+    /// instruction counts: `PERF_MODE=valgrind` records the counts for the current commit and
+    /// `PERF_MODE=diff` fails if they grew by more than `max_diff` since the previous commit.
+    fn allocation_test<F>(
+        test_name: &str,
+        budget: u64,
+        max_diff: f64,
+        test_body: F,
+    ) -> Result<(), s2n_tls::error::Error>
+    where
+        F: FnOnce() -> Result<AllocationCounts, s2n_tls::error::Error>,
+    {
+        match RegressionTestMode::from_env() {
+            RegressionTestMode::Valgrind => {
+                AllocationProfile::new(test_name, test_body()?).write();
+            }
+            RegressionTestMode::Diff => {
+                let (prev_commit, curr_commit) = query_commits(test_name, "allocations");
+                let prev = AllocationProfile::read(test_name, &prev_commit);
+                let curr = AllocationProfile::read(test_name, &curr_commit);
+                curr.assert_performance(&prev, max_diff);
+            }
+            RegressionTestMode::Default => {
+                let counts = test_body()?;
+                println!("Allocations for {test_name}:\n{counts}");
+                assert!(
+                    counts.total_allocations() <= budget,
+                    "{test_name} made {} allocations, exceeding the budget of {budget}",
+                    counts.total_allocations()
+                );
+            }
+        };
+        Ok(())
+    }
+
+    struct AllocationProfile {
+        test_name: String,
+        commit_hash: String,
+        counts: AllocationCounts,
+    }
+
+    impl AllocationProfile {
+        fn new(test_name: &str, counts: AllocationCounts) -> Self {
+            Self {
+                test_name: test_name.to_owned(),
+                commit_hash: git::get_current_commit_hash(),
+                counts,
+            }
+        }
+
+        fn read(test_name: &str, commit_hash: &str) -> Self {
+            let mut profile = Self {
+                test_name: test_name.to_owned(),
+                commit_hash: commit_hash.to_owned(),
+                counts: AllocationCounts::default(),
+            };
+            profile.counts = std::fs::read_to_string(profile.path())
+                .unwrap()
+                .parse()
+                .expect("Failed to parse allocation counts");
+            profile
+        }
+
+        fn write(&self) {
+            create_dir_all(format!("target/regression_artifacts/{}", self.commit_hash)).unwrap();
+            write(self.path(), self.counts.to_string()).expect("Failed to write to file");
+        }
+
+        fn path(&self) -> String {
+            format!(
+                "target/regression_artifacts/{}/{}.allocations",
+                self.commit_hash, self.test_name
+            )
+        }
+
+        fn diff_path(&self) -> String {
+            format!(
+                "target/regression_artifacts/diff/{}.allocations.diff",
+                self.test_name
+            )
+        }
+
+        /// Writes the change since `prev` to disk, and fails if the number of allocations or
+        /// the bytes allocated grew by more than `max_diff`. Growth from zero always fails.
+        fn assert_performance(&self, prev: &AllocationProfile, max_diff: f64) {
+            let rows = [
+                (
+                    "allocations",
+                    prev.counts.total_allocations(),
+                    self.counts.total_allocations(),
+                ),
+                ("frees", prev.counts.frees, self.counts.frees),
+                ("bytes", prev.counts.bytes, self.counts.bytes),
+            ];
+
+            let mut diff_content = format!(
+                "previous: {}\ncurrent:  {}\n\n{:<12} {:>12} {:>12} {:>12}\n",
+                prev.commit_hash, self.commit_hash, "", "previous", "current", "difference"
+            );
+            for (name, prev_count, curr_count) in rows {
+                let diff = curr_count as i64 - prev_count as i64;
+                diff_content +=
+                    &format!("{name:<12} {prev_count:>12} {curr_count:>12} {diff:>12}\n");
+            }
+            create_dir_all("target/regression_artifacts/diff").unwrap();
+            write(self.diff_path(), &diff_content).expect("Failed to write to file");
+
+            // frees are reported, but only growth in the memory requested is a regression
+            for (name, prev_count, curr_count) in rows.into_iter().filter(|row| row.0 != "frees") {
+                let diff = curr_count as i64 - prev_count as i64;
+                let regressed = if prev_count == 0 {
+                    diff > 0
+                } else {
+                    diff as f64 / prev_count as f64 > max_diff
+                };
+                assert!(
+                    !regressed,
+                    "Allocation {name} for {} grew from {prev_count} to {curr_count}, check {} for the difference",
+                    self.test_name,
+                    self.diff_path()
+                );
+            }
+        }
+    }
+
     struct RawProfile {
         test_name: String,
         commit_hash: String,
@@ -184,40 +317,51 @@ mod tests {
         /// This method will panic if there are not two profiles.
         /// This method will also panic if both commits are on different logs (not mainline).
         fn query(test_name: &str) -> (RawProfile, RawProfile) {
-            let pattern = format!("target/regression_artifacts/**/*{}.raw", test_name);
-            let raw_files: Vec<String> = glob::glob(&pattern)
-                .expect("Failed to read glob pattern")
-                .filter_map(Result::ok)
-                .map(|path| path.to_string_lossy().into_owned())
-                .collect();
-            assert_eq!(raw_files.len(), 2);
-
-            let profile1 = RawProfile {
-                test_name: test_name.to_string(),
-                commit_hash: git::extract_commit_hash(&raw_files[0]),
-            };
-            let profile2 = RawProfile {
+            let (prev_commit, curr_commit) = query_commits(test_name, "raw");
+            let profile = |commit_hash| RawProfile {
                 test_name: test_name.to_string(),
-                commit_hash: git::extract_commit_hash(&raw_files[1]),
+                commit_hash,
             };
+            (profile(prev_commit), profile(curr_commit))
+        }
+    }
 
-            // xor returns true if exactly one commit is mainline
-            if git::is_mainline(&profile1.commit_hash) ^ git::is_mainline(&profile2.commit_hash) {
-                // Return the mainline as first commit
-                if git::is_mainline(&profile1.commit_hash) {
-                    (profile1, profile2)
-                } else {
-                    (profile2, profile1)
-                }
+    /// Return the commits of the two artifacts for `test_name` with `extension` in "git" order.
+    /// `tuple.0` is older than `tuple.1`
+    ///
+    /// This method will panic if there are not two artifacts.
+    /// This method will also panic if both commits are on different logs (not mainline).
+    fn query_commits(test_name: &str, extension: &str) -> (String, String) {
+        let pattern = format!(
+            "target/regression_artifacts/**/*{}.{}",
+            test_name, extension
+        );
+        let files: Vec<String> = glob::glob(&pattern)
+            .expect("Failed to read glob pattern")
+            .filter_map(Result::ok)
+            .map(|path| path.to_string_lossy().into_owned())
+            .collect();
+        assert_eq!(files.len(), 2);
+
+        let commit1 = git::extract_commit_hash(&files[0]);
+        let commit2 = git::extract_commit_hash(&files[1]);
+
+        // xor returns true if exactly one commit is mainline
+        if git::is_mainline(&commit1) ^ git::is_mainline(&commit2) {
+            // Return the mainline as first commit
+            if git::is_mainline(&commit1) {
+                (commit1, commit2)
             } else {
-                // Neither or both profiles are on the mainline, so return the older one first
-                if git::is_older_commit(&profile1.commit_hash, &profile2.commit_hash) {
-                    (profile1, profile2)
-                } else if git::is_older_commit(&profile2.commit_hash, &profile1.commit_hash) {
-                    (profile2, profile1)
-                } else {
-                    panic!("The commits are not in the same log, are identical, or there are not two commits available");
-                }
+                (commit2, commit1)
+            }
+        } else {
+            // Neither or both commits are on the mainline, so return the older one first
+            if git::is_older_commit(&commit1, &commit2) {
+                (commit1, commit2)
+            } else if git::is_older_commit(&commit2, &commit1) {
+                (commit2, commit1)
+            } else {
+                panic!("The commits are not in the same log, are identical, or there are not two commits available");
             }
         }
     }
@@ -391,6 +535,102 @@ mod tests {
         .unwrap();
     }
 
+    /// Test which performs a TLS1.2 handshake. Transcript hashing cost is dominated by the
+    /// number of hash algorithms kept up to date, so this harness catches regressions
+    /// in how many transcript hashes the TLS1.2 handshake maintains.
+    #[test]
+    fn test_tls12_handshake() {
+        valgrind_test("test_tls12_handshake", 0.01, |ctrl| {
+            ctrl.stop_instrumentation();
+            let keypair_rsa = CertKeyPair::default();
+            let config = set_config(&security::DEFAULT, keypair_rsa)?;
+            let mut pair = TestPair::from_config(&config);
+            ctrl.start_instrumentation();
+            assert!(pair.handshake().is_ok());
+            ctrl.stop_instrumentation();
+            Ok(())
+        })
+        .unwrap();
+    }
+
+    /// Test to measure TLS1.2 session resumption. The abbreviated handshake skips the certificate
+    /// and key exchange, so its instruction count is dominated by the TLS1.2 PRF: the master secret
+    /// keys the key expansion and both finished calculations.
+    #[test]
+    fn test_tls12_session_resumption() {
+        const KEY_NAME: &str = "InsecureTestKey";
+        const KEY_VALUE: [u8; 16] = [3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9, 3];
+        valgrind_test("test_tls12_session_resumption", 0.01, |ctrl| {
+            ctrl.stop_instrumentation();
+            let keypair_rsa = CertKeyPair::default();
+
+            let mut server_config_builder = Builder::new();
+            server_config_builder
+                .add_session_ticket_key(
+                    KEY_NAME.as_bytes(),
+                    KEY_VALUE.as_slice(),
+                    SystemTime::now() - Duration::from_secs(10),
+                )?
+                .load_pem(keypair_rsa.cert(), keypair_rsa.key())?
+                .set_security_policy(&security::DEFAULT)?;
+            let server_config = server_config_builder.build()?;
+
+            let mut client_config_builder = Builder::new();
+            client_config_builder
+                .enable_session_tickets(true)?
+                .trust_pem(keypair_rsa.cert())?
+                .set_verify_host_callback(InsecureAcceptAllCertificatesHandler {})?
+                .set_security_policy(&security::DEFAULT)?;
+            let client_config = client_config_builder.build()?;
+
+            // TLS1.2 delivers the session ticket during the full handshake,
+            // so only the resumed handshake is measured
+            let session_ticket = {
+                let mut pair = TestPair::from_configs(&client_config, &server_config);
+                pair.handshake()?;
+
+                let mut ticket: Vec<u8> = vec![0; pair.client.session_ticket_length().unwrap()];
+                pair.client.session_ticket(&mut ticket).unwrap();
+
+                assert!(!pair.client.resumed());
+                ticket
+            };
+
+            let mut pair = TestPair::from_configs(&client_config, &server_config);
+            pair.client.set_session_ticket(&session_ticket).unwrap();
+            ctrl.start_instrumentation();
+            pair.handshake()?;
+            ctrl.stop_instrumentation();
+            assert!(pair.client.resumed());
+
+            Ok(())
+        })
+        .unwrap();
+    }
+
+    /// Test which performs a TLS1.3 handshake with mutual authentication.
+    #[test]
+    fn test_mutual_auth_handshake() {
+        valgrind_test("test_mutual_auth_handshake", 0.01, |ctrl| {
+            ctrl.stop_instrumentation();
+            let keypair_rsa = CertKeyPair::default();
+            let mut builder = Builder::new();
+            builder
+                .set_security_policy(&security::DEFAULT_TLS13)?
+                .set_verify_host_callback(InsecureAcceptAllCertificatesHandler {})?
+                .set_client_auth_type(ClientAuthType::Required)?
+                .load_pem(keypair_rsa.cert(), keypair_rsa.key())?
+                .trust_pem(keypair_rsa.cert())?;
+            let config = builder.build()?;
+            let mut pair = TestPair::from_config(&config);
+            ctrl.start_instrumentation();
+            assert!(pair.handshake().is_ok());
+            ctrl.stop_instrumentation();
+            Ok(())
+        })
+        .unwrap();
+    }
+
     /// Test to measure session resumption by performing a handshake and resuming the handshake with a session ticket
     #[test]
     fn test_session_resumption() {
@@ -458,4 +698,127 @@ mod tests {
         })
         .unwrap();
     }
+
+    /// Test which counts the allocations made by a full TLS1.3 handshake. Creating the
+    /// connections is not measured.
+    #[test]
+    fn test_handshake_allocations() {
+        allocation_test("test_handshake_allocations", 64, 0.01, || {
+            let keypair_rsa = CertKeyPair::default();
+            let config = set_config(&security::DEFAULT_TLS13, keypair_rsa)?;
+            let mut pair = TestPair::from_config(&config);
+            let (result, counts) = count_allocations(|| pair.handshake());
+            result?;
+            Ok(counts)
+        })
+        .unwrap();
+    }
+
+    /// Test which counts the allocations made by a TLS1.3 handshake that resumes a session
+    /// with a session ticket. Only the resumed handshake is measured.
+    #[test]
+    fn test_resumption_allocations() {
+        const KEY_NAME: &str = "InsecureTestKey";
+        const KEY_VALUE: [u8; 16] = [3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9, 3];
+        allocation_test("test_resumption_allocations", 64, 0.01, || {
+            let keypair_rsa = CertKeyPair::default();
+
+            let mut server_config_builder = Builder::new();
+            server_config_builder
+                .add_session_ticket_key(
+                    KEY_NAME.as_bytes(),
+                    KEY_VALUE.as_slice(),
+                    SystemTime::now() - Duration::from_secs(10),
+                )?
+                .load_pem(keypair_rsa.cert(), keypair_rsa.key())?
+                .set_security_policy(&security::DEFAULT_TLS13)?;
+            let server_config = server_config_builder.build()?;
+
+            let mut client_config_builder = Builder::new();
+            client_config_builder
+                .enable_session_tickets(true)?
+                .trust_pem(keypair_rsa.cert())?
+                .set_verify_host_callback(InsecureAcceptAllCertificatesHandler {})?
+                .set_security_policy(&security::DEFAULT_TLS13)?;
+            let client_config = client_config_builder.build()?;
+
+            // TLS1.3 delivers the session ticket after the handshake, so the client
+            // must read it before the ticket is available
+            let session_ticket = {
+                let mut pair = TestPair::from_configs(&client_config, &server_config);
+                pair.client.set_waker(Some(&noop_waker()))?;
+                pair.handshake()?;
+                assert!(pair.client.poll_recv(&mut [0]).is_pending());
+
+                let mut ticket: Vec<u8> = vec![0; pair.client.session_ticket_length().unwrap()];
+                pair.client.session_ticket(&mut ticket).unwrap();
+                ticket
+            };
+
+            let mut pair = TestPair::from_configs(&client_config, &server_config);
+            pair.client.set_session_ticket(&session_ticket).unwrap();
+            let (result, counts) = count_allocations(|| pair.handshake());
+            result?;
+            assert!(pair.client.resumed());
+            Ok(counts)
+        })
+        .unwrap();
+    }
+
+    /// Sends all of `send_data` from the client to the server, and reads it into `recv_data`.
+    fn send_and_recv(
+        pair: &mut TestPair,
+        send_data: &[u8],
+        recv_data: &mut [u8],
+    ) -> Result<(), Error> {
+        let mut sent = 0;
+        while sent < send_data.len() {
+            match pair.client.poll_send(&send_data[sent..]) {
+                Poll::Ready(result) => sent += result?,
+                Poll::Pending => panic!("Sending to the TestPair IO should never block"),
+            }
+        }
+
+        let mut received = 0;
+        while received < recv_data.len() {
+            match pair.server.poll_recv(&mut recv_data[received..]) {
+                Poll::Ready(result) => {
+                    let read = result?;
+                    assert!(read > 0, "The client closed the connection");
+                    received += read;
+                }
+                Poll::Pending => panic!("The server should have received all of the data"),
+            }
+        }
+        Ok(())
+    }
+
+    /// Test which counts the allocations made sending and receiving 1MB of application data.
+    /// Once a connection has allocated its I/O buffers, the record path must not allocate.
+    #[test]
+    fn test_record_allocations() {
+        const RECORD_SIZE: usize = 16 * 1024;
+        const ROUNDS: usize = 64;
+        allocation_test("test_record_allocations", 0, 0.0, || {
+            let keypair_rsa = CertKeyPair::default();
+            let config = set_config(&security::DEFAULT_TLS13, keypair_rsa)?;
+            let mut pair = TestPair::from_config(&config);
+            pair.handshake()?;
+
+            let send_data = vec![0; RECORD_SIZE];
+            let mut recv_data = vec![0; RECORD_SIZE];
+            // The first round allocates the I/O buffers of the connections and the harness
+            send_and_recv(&mut pair, &send_data, &mut recv_data)?;
+
+            let (result, counts) = count_allocations(|| -> Result<(), Error> {
+                for _ in 0..ROUNDS {
+                    send_and_recv(&mut pair, &send_data, &mut recv_data)?;
+                }
+                Ok(())
+            });
+            result?;
+            Ok(counts)
+        })
+        .unwrap();
+    }
 }
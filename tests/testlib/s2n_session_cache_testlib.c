@@ -0,0 +1,60 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_session_cache.h"
+
+#define S2N_TEST_SESSION_ID_FILL    0xC3
+#define S2N_TEST_SESSION_VALUE_FILL 0xA5
+
+/* Session IDs and values are filled with a pattern that can't be mistaken for other cache memory */
+S2N_RESULT s2n_session_cache_test_id(uint32_t n, uint8_t id[S2N_TLS_SESSION_ID_MAX_LEN])
+{
+    RESULT_CHECKED_MEMSET(id, S2N_TEST_SESSION_ID_FILL, S2N_TLS_SESSION_ID_MAX_LEN);
+    RESULT_CHECKED_MEMCPY(id, &n, sizeof(n));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_session_cache_test_value(uint32_t n, uint8_t value[S2N_TLS12_TICKET_SIZE_IN_BYTES])
+{
+    RESULT_CHECKED_MEMSET(value, S2N_TEST_SESSION_VALUE_FILL, S2N_TLS12_TICKET_SIZE_IN_BYTES);
+    RESULT_CHECKED_MEMCPY(value, &n, sizeof(n));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_session_cache_test_store(struct s2n_session_cache *cache, uint64_t now, uint64_t ttl_in_nanos, uint32_t n)
+{
+    uint8_t id[S2N_TLS_SESSION_ID_MAX_LEN] = { 0 };
+    uint8_t value[S2N_TLS12_TICKET_SIZE_IN_BYTES] = { 0 };
+    RESULT_GUARD(s2n_session_cache_test_id(n, id));
+    RESULT_GUARD(s2n_session_cache_test_value(n, value));
+    RESULT_GUARD(s2n_session_cache_store(cache, now, ttl_in_nanos, id, sizeof(id), value, sizeof(value)));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_session_cache_test_retrieve(struct s2n_session_cache *cache, uint64_t now, uint32_t n)
+{
+    uint8_t id[S2N_TLS_SESSION_ID_MAX_LEN] = { 0 };
+    uint8_t expected[S2N_TLS12_TICKET_SIZE_IN_BYTES] = { 0 };
+    RESULT_GUARD(s2n_session_cache_test_id(n, id));
+    RESULT_GUARD(s2n_session_cache_test_value(n, expected));
+
+    uint8_t value[S2N_TLS12_TICKET_SIZE_IN_BYTES] = { 0 };
+    uint64_t value_size = sizeof(value);
+    RESULT_GUARD(s2n_session_cache_retrieve(cache, now, id, sizeof(id), value, &value_size));
+    RESULT_ENSURE_EQ(value_size, sizeof(expected));
+    RESULT_ENSURE(memcmp(value, expected, sizeof(expected)) == 0, S2N_ERR_SAFETY);
+    return S2N_RESULT_OK;
+}
@@ -304,6 +304,13 @@ int s2n_kem_recv_ciphertext_fuzz_test_init(const char *kat_file_path, struct s2n
 
 S2N_RESULT s2n_resumption_test_ticket_key_setup(struct s2n_config *config);
 
+struct s2n_session_cache;
+S2N_RESULT s2n_session_cache_test_id(uint32_t n, uint8_t id[S2N_TLS_SESSION_ID_MAX_LEN]);
+S2N_RESULT s2n_session_cache_test_value(uint32_t n, uint8_t value[S2N_TLS12_TICKET_SIZE_IN_BYTES]);
+S2N_RESULT s2n_session_cache_test_store(struct s2n_session_cache *cache, uint64_t now, uint64_t ttl_in_nanos, uint32_t n);
+/* Fails unless the value stored for n is found */
+S2N_RESULT s2n_session_cache_test_retrieve(struct s2n_session_cache *cache, uint64_t now, uint32_t n);
+
 #define S2N_BLOB_FROM_HEX(name, hex) S2N_CHECKED_BLOB_FROM_HEX(name, POSIX_GUARD_RESULT, hex)
 #define S2N_CHECKED_BLOB_FROM_HEX(name, check, hex)        \
     DEFER_CLEANUP(struct s2n_blob name = { 0 }, s2n_free); \
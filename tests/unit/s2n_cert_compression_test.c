@@ -0,0 +1,531 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_cert_compression.h"
+
+#include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/extensions/s2n_client_cert_compression.h"
+#include "tls/s2n_tls.h"
+#include "utils/s2n_bitmap.h"
+
+static S2N_RESULT s2n_test_write_compressed_cert(struct s2n_stuffer *out, uint16_t algorithm,
+        uint32_t uncompressed_len, const uint8_t *compressed, uint32_t compressed_len)
+{
+    RESULT_GUARD_POSIX(s2n_stuffer_write_uint16(out, algorithm));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_uint24(out, uncompressed_len));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_uint24(out, compressed_len));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(out, compressed, compressed_len));
+    return S2N_RESULT_OK;
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    const s2n_cert_compression_algorithm all_algorithms[] = {
+        S2N_CERT_COMPRESSION_ZLIB,
+        S2N_CERT_COMPRESSION_BROTLI,
+        S2N_CERT_COMPRESSION_ZSTD,
+    };
+
+    DEFER_CLEANUP(struct s2n_cert_chain_and_key *chain_and_key = NULL, s2n_cert_chain_and_key_ptr_free);
+    EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&chain_and_key,
+            S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN, S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+
+    /* s2n_config_set_cert_compression_preferences */
+    {
+        /* Disabled by default */
+        {
+            DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+            EXPECT_NOT_NULL(config);
+            EXPECT_EQUAL(config->cert_compression_algorithms_count, 0);
+        };
+
+        /* Safety */
+        {
+            DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+            EXPECT_NOT_NULL(config);
+            EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_cert_compression_preferences(NULL, all_algorithms, 1),
+                    S2N_ERR_NULL);
+            EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_cert_compression_preferences(config, NULL, 1),
+                    S2N_ERR_NULL);
+            EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_cert_compression_preferences(config, all_algorithms,
+                                              S2N_CERT_COMPRESSION_ALGORITHMS_COUNT + 1),
+                    S2N_ERR_INVALID_ARGUMENT);
+            EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(config, NULL, 0));
+        };
+
+        /* Only supported algorithms are accepted */
+        for (size_t i = 0; i < s2n_array_len(all_algorithms); i++) {
+            DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+            EXPECT_NOT_NULL(config);
+            if (s2n_cert_compression_is_supported(all_algorithms[i])) {
+                EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(config, &all_algorithms[i], 1));
+                EXPECT_EQUAL(config->cert_compression_algorithms_count, 1);
+            } else {
+                EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_cert_compression_preferences(config, &all_algorithms[i], 1),
+                        S2N_ERR_INVALID_ARGUMENT);
+                EXPECT_EQUAL(config->cert_compression_algorithms_count, 0);
+            }
+        };
+
+        /* Unknown algorithms are rejected */
+        {
+            DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+            EXPECT_NOT_NULL(config);
+            const s2n_cert_compression_algorithm unknown = 0;
+            EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_cert_compression_preferences(config, &unknown, 1),
+                    S2N_ERR_INVALID_ARGUMENT);
+        };
+    };
+
+    /* s2n_client_cert_compression_extension.should_send */
+    {
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+        EXPECT_FALSE(s2n_client_cert_compression_extension.should_send(conn));
+        EXPECT_EQUAL(s2n_client_cert_compression_extension.minimum_version, S2N_TLS13);
+    };
+
+    if (!s2n_cert_compression_is_supported(S2N_CERT_COMPRESSION_ZLIB)) {
+        END_TEST();
+    }
+
+    s2n_cert_compression_algorithm supported[S2N_CERT_COMPRESSION_ALGORITHMS_COUNT] = { 0 };
+    uint8_t supported_count = 0;
+    for (size_t i = 0; i < s2n_array_len(all_algorithms); i++) {
+        if (s2n_cert_compression_is_supported(all_algorithms[i])) {
+            supported[supported_count++] = all_algorithms[i];
+        }
+    }
+
+    /* Duplicate algorithms are rejected */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        const s2n_cert_compression_algorithm duplicates[] = { S2N_CERT_COMPRESSION_ZLIB, S2N_CERT_COMPRESSION_ZLIB };
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_cert_compression_preferences(config, duplicates, 2),
+                S2N_ERR_INVALID_ARGUMENT);
+    };
+
+    /* Chains are precompressed, whether added before or after the preferences are set */
+    {
+        DEFER_CLEANUP(struct s2n_cert_chain_and_key *other_chain = NULL, s2n_cert_chain_and_key_ptr_free);
+        EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&other_chain,
+                S2N_DEFAULT_TEST_CERT_CHAIN, S2N_DEFAULT_TEST_PRIVATE_KEY));
+
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, other_chain));
+        EXPECT_NULL(other_chain->compressed_certs[S2N_CERT_COMPRESSION_ZLIB - 1][0]);
+
+        EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(config, supported, supported_count));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, chain_and_key));
+
+        struct s2n_cert_chain_and_key *chains[] = { chain_and_key, other_chain };
+        for (size_t i = 0; i < s2n_array_len(chains); i++) {
+            DEFER_CLEANUP(struct s2n_stuffer certificate = { 0 }, s2n_stuffer_free);
+            EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&certificate, 0));
+            EXPECT_OK(s2n_cert_compression_write_certificate(chains[i], &certificate));
+
+            for (size_t j = 0; j < supported_count; j++) {
+                struct s2n_compressed_cert *cached = chains[i]->compressed_certs[supported[j] - 1][0];
+                EXPECT_NOT_NULL(cached);
+                EXPECT_TRUE(cached->data.size > 0);
+                EXPECT_TRUE(cached->data.size < s2n_stuffer_data_available(&certificate));
+                EXPECT_EQUAL(cached->uncompressed_length, s2n_stuffer_data_available(&certificate));
+            }
+        }
+    };
+
+    /* The precompressed message matches the Certificate message that would be sent */
+    {
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+        conn->actual_protocol_version = S2N_TLS13;
+
+        DEFER_CLEANUP(struct s2n_stuffer expected = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&expected, 0));
+        EXPECT_SUCCESS(s2n_stuffer_write_uint8(&expected, 0));
+        EXPECT_SUCCESS(s2n_send_cert_chain(conn, &expected, chain_and_key));
+
+        DEFER_CLEANUP(struct s2n_stuffer actual = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&actual, 0));
+        EXPECT_OK(s2n_cert_compression_write_certificate(chain_and_key, &actual));
+
+        EXPECT_EQUAL(s2n_stuffer_data_available(&actual), s2n_stuffer_data_available(&expected));
+        EXPECT_BYTEARRAY_EQUAL(actual.blob.data, expected.blob.data, s2n_stuffer_data_available(&actual));
+    };
+
+    /* Extension negotiates the first server preference offered by the client */
+    {
+        const s2n_cert_compression_algorithm client_prefs[] = { S2N_CERT_COMPRESSION_ZLIB };
+        DEFER_CLEANUP(struct s2n_config *client_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(client_config);
+        EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(client_config, client_prefs, 1));
+
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(server_config, supported, supported_count));
+
+        DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(client);
+        EXPECT_SUCCESS(s2n_connection_set_config(client, client_config));
+        DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(server);
+        EXPECT_SUCCESS(s2n_connection_set_config(server, server_config));
+
+        EXPECT_TRUE(s2n_client_cert_compression_extension.should_send(client));
+
+        DEFER_CLEANUP(struct s2n_stuffer stuffer = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&stuffer, 0));
+        EXPECT_SUCCESS(s2n_client_cert_compression_extension.send(client, &stuffer));
+        EXPECT_SUCCESS(s2n_client_cert_compression_extension.recv(server, &stuffer));
+        EXPECT_EQUAL(server->cert_compression_algorithm, S2N_CERT_COMPRESSION_ZLIB);
+        EXPECT_EQUAL(s2n_stuffer_data_available(&stuffer), 0);
+    };
+
+    /* Extension ignores unknown and malformed algorithm lists */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(config, supported, supported_count));
+
+        DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(server);
+        EXPECT_SUCCESS(s2n_connection_set_config(server, config));
+
+        /* Unknown algorithm */
+        {
+            DEFER_CLEANUP(struct s2n_stuffer stuffer = { 0 }, s2n_stuffer_free);
+            EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&stuffer, 0));
+            EXPECT_SUCCESS(s2n_stuffer_write_uint8(&stuffer, 2));
+            EXPECT_SUCCESS(s2n_stuffer_write_uint16(&stuffer, UINT16_MAX));
+            EXPECT_SUCCESS(s2n_client_cert_compression_extension.recv(server, &stuffer));
+            EXPECT_EQUAL(server->cert_compression_algorithm, 0);
+        };
+
+        /* Odd length */
+        {
+            DEFER_CLEANUP(struct s2n_stuffer stuffer = { 0 }, s2n_stuffer_free);
+            EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&stuffer, 0));
+            EXPECT_SUCCESS(s2n_stuffer_write_uint8(&stuffer, 3));
+            EXPECT_SUCCESS(s2n_stuffer_write_uint16(&stuffer, S2N_CERT_COMPRESSION_ZLIB));
+            EXPECT_SUCCESS(s2n_stuffer_write_uint8(&stuffer, 0));
+            EXPECT_SUCCESS(s2n_client_cert_compression_extension.recv(server, &stuffer));
+            EXPECT_EQUAL(server->cert_compression_algorithm, 0);
+        };
+
+        /* Length longer than the extension */
+        {
+            DEFER_CLEANUP(struct s2n_stuffer stuffer = { 0 }, s2n_stuffer_free);
+            EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&stuffer, 0));
+            EXPECT_SUCCESS(s2n_stuffer_write_uint8(&stuffer, 4));
+            EXPECT_SUCCESS(s2n_stuffer_write_uint16(&stuffer, S2N_CERT_COMPRESSION_ZLIB));
+            EXPECT_SUCCESS(s2n_client_cert_compression_extension.recv(server, &stuffer));
+            EXPECT_EQUAL(server->cert_compression_algorithm, 0);
+        };
+    };
+
+    /* s2n_compressed_cert_recv */
+    {
+        const s2n_cert_compression_algorithm zlib = S2N_CERT_COMPRESSION_ZLIB;
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(config, &zlib, 1));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, chain_and_key));
+        struct s2n_compressed_cert *cached = chain_and_key->compressed_certs[S2N_CERT_COMPRESSION_ZLIB - 1][0];
+        EXPECT_NOT_NULL(cached);
+
+        DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(client);
+        EXPECT_SUCCESS(s2n_connection_set_config(client, config));
+        client->actual_protocol_version = S2N_TLS13;
+
+        /* Valid message */
+        {
+            DEFER_CLEANUP(struct s2n_stuffer in = { 0 }, s2n_stuffer_free);
+            EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&in, 0));
+            EXPECT_OK(s2n_test_write_compressed_cert(&in, zlib, cached->uncompressed_length,
+                    cached->data.data, cached->data.size));
+
+            DEFER_CLEANUP(struct s2n_stuffer out = { 0 }, s2n_stuffer_free);
+            EXPECT_OK(s2n_compressed_cert_recv(client, &in, &out));
+            EXPECT_EQUAL(s2n_stuffer_data_available(&out), cached->uncompressed_length);
+            EXPECT_EQUAL(client->cert_compression_algorithm, zlib);
+            client->cert_compression_algorithm = 0;
+        };
+
+        /* Servers do not accept compressed certificates */
+        {
+            DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server);
+            EXPECT_SUCCESS(s2n_connection_set_config(server, config));
+            server->actual_protocol_version = S2N_TLS13;
+            EXPECT_ERROR_WITH_ERRNO(s2n_cert_compression_validate_recv(server), S2N_ERR_BAD_MESSAGE);
+        };
+
+        /**
+         *= https://www.rfc-editor.org/rfc/rfc8879#section-4
+         *= type=test
+         *# If the received CompressedCertificate message cannot be decompressed,
+         *# the connection MUST be terminated with the "bad_certificate" alert.
+         */
+        {
+            /* Algorithm not offered */
+            {
+                DEFER_CLEANUP(struct s2n_stuffer in = { 0 }, s2n_stuffer_free);
+                EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&in, 0));
+                EXPECT_OK(s2n_test_write_compressed_cert(&in, S2N_CERT_COMPRESSION_ZSTD, cached->uncompressed_length,
+                        cached->data.data, cached->data.size));
+                DEFER_CLEANUP(struct s2n_stuffer out = { 0 }, s2n_stuffer_free);
+                EXPECT_ERROR_WITH_ERRNO(s2n_compressed_cert_recv(client, &in, &out), S2N_ERR_CERT_DECOMPRESSION);
+            };
+
+            /* Uncompressed length larger than the maximum handshake message */
+            {
+                DEFER_CLEANUP(struct s2n_stuffer in = { 0 }, s2n_stuffer_free);
+                EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&in, 0));
+                EXPECT_OK(s2n_test_write_compressed_cert(&in, zlib, S2N_MAXIMUM_HANDSHAKE_MESSAGE_LENGTH + 1,
+                        cached->data.data, cached->data.size));
+                DEFER_CLEANUP(struct s2n_stuffer out = { 0 }, s2n_stuffer_free);
+                EXPECT_ERROR_WITH_ERRNO(s2n_compressed_cert_recv(client, &in, &out), S2N_ERR_CERT_DECOMPRESSION);
+            };
+
+            /* Uncompressed length does not match the decompressed data */
+            for (int32_t offset = -1; offset <= 1; offset += 2) {
+                DEFER_CLEANUP(struct s2n_stuffer in = { 0 }, s2n_stuffer_free);
+                EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&in, 0));
+                EXPECT_OK(s2n_test_write_compressed_cert(&in, zlib, cached->uncompressed_length + offset,
+                        cached->data.data, cached->data.size));
+                DEFER_CLEANUP(struct s2n_stuffer out = { 0 }, s2n_stuffer_free);
+                EXPECT_ERROR_WITH_ERRNO(s2n_compressed_cert_recv(client, &in, &out), S2N_ERR_CERT_DECOMPRESSION);
+            };
+
+            /* Corrupted data */
+            {
+                DEFER_CLEANUP(struct s2n_blob corrupted = { 0 }, s2n_free);
+                EXPECT_SUCCESS(s2n_dup(&cached->data, &corrupted));
+                corrupted.data[corrupted.size / 2] ^= 0xFF;
+
+                DEFER_CLEANUP(struct s2n_stuffer in = { 0 }, s2n_stuffer_free);
+                EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&in, 0));
+                EXPECT_OK(s2n_test_write_compressed_cert(&in, zlib, cached->uncompressed_length,
+                        corrupted.data, corrupted.size));
+                DEFER_CLEANUP(struct s2n_stuffer out = { 0 }, s2n_stuffer_free);
+                EXPECT_ERROR_WITH_ERRNO(s2n_compressed_cert_recv(client, &in, &out), S2N_ERR_CERT_DECOMPRESSION);
+            };
+        };
+
+        /* Compressed length must match the remaining message */
+        {
+            DEFER_CLEANUP(struct s2n_stuffer in = { 0 }, s2n_stuffer_free);
+            EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&in, 0));
+            EXPECT_OK(s2n_test_write_compressed_cert(&in, zlib, cached->uncompressed_length,
+                    cached->data.data, cached->data.size));
+            EXPECT_SUCCESS(s2n_stuffer_write_uint8(&in, 0));
+            DEFER_CLEANUP(struct s2n_stuffer out = { 0 }, s2n_stuffer_free);
+            EXPECT_ERROR_WITH_ERRNO(s2n_compressed_cert_recv(client, &in, &out), S2N_ERR_BAD_MESSAGE);
+        };
+
+        EXPECT_EQUAL(client->cert_compression_algorithm, 0);
+    };
+
+    /* s2n_compressed_cert_send caches one message per set of per-certificate extensions */
+    {
+        DEFER_CLEANUP(struct s2n_cert_chain_and_key *ext_chain = NULL, s2n_cert_chain_and_key_ptr_free);
+        EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&ext_chain,
+                S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN, S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+        const uint8_t ocsp_data[] = "OCSP DATA";
+        EXPECT_SUCCESS(s2n_cert_chain_and_key_set_ocsp_data(ext_chain, ocsp_data, sizeof(ocsp_data)));
+        const uint8_t sct_data[] = "SCT LIST DATA";
+        EXPECT_SUCCESS(s2n_cert_chain_and_key_set_sct_list(ext_chain, sct_data, sizeof(sct_data)));
+
+        const s2n_cert_compression_algorithm zlib = S2N_CERT_COMPRESSION_ZLIB;
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(config, &zlib, 1));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, ext_chain));
+        struct s2n_compressed_cert **cached = ext_chain->compressed_certs[S2N_CERT_COMPRESSION_ZLIB - 1];
+        EXPECT_NOT_NULL(cached[0]);
+        for (size_t variant = 1; variant < S2N_CERT_COMPRESSION_VARIANTS_COUNT; variant++) {
+            EXPECT_NULL(cached[variant]);
+        }
+
+        DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(client);
+        EXPECT_SUCCESS(s2n_connection_set_config(client, config));
+        client->actual_protocol_version = S2N_TLS13;
+
+        s2n_extension_type_id ocsp_id = 0, sct_id = 0;
+        EXPECT_SUCCESS(s2n_extension_supported_iana_value_to_id(TLS_EXTENSION_STATUS_REQUEST, &ocsp_id));
+        EXPECT_SUCCESS(s2n_extension_supported_iana_value_to_id(TLS_EXTENSION_SCT_LIST, &sct_id));
+
+        const uint32_t header_len = sizeof(uint16_t) + 2 * SIZEOF_UINT24;
+        for (size_t variant = 0; variant < S2N_CERT_COMPRESSION_VARIANTS_COUNT; variant++) {
+            DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server);
+            EXPECT_SUCCESS(s2n_connection_set_config(server, config));
+            server->actual_protocol_version = S2N_TLS13;
+            server->cert_compression_algorithm = zlib;
+            server->handshake_params.our_chain_and_key = ext_chain;
+            if (variant & 1) {
+                S2N_CBIT_SET(server->extension_requests_received, ocsp_id);
+            }
+            if (variant & 2) {
+                S2N_CBIT_SET(server->extension_requests_received, sct_id);
+                server->ct_level_requested = S2N_CT_SUPPORT_REQUEST;
+            }
+
+            DEFER_CLEANUP(struct s2n_stuffer expected = { 0 }, s2n_stuffer_free);
+            EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&expected, 0));
+            EXPECT_SUCCESS(s2n_stuffer_write_uint8(&expected, 0));
+            EXPECT_SUCCESS(s2n_send_cert_chain(server, &expected, ext_chain));
+
+            /* The first send compresses the message, later sends reuse it */
+            struct s2n_compressed_cert *first = NULL;
+            for (size_t i = 0; i < 2; i++) {
+                DEFER_CLEANUP(struct s2n_stuffer out = { 0 }, s2n_stuffer_free);
+                EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&out, 0));
+                EXPECT_OK(s2n_compressed_cert_send(server, &out));
+                EXPECT_NOT_NULL(cached[variant]);
+                if (first) {
+                    EXPECT_EQUAL(cached[variant], first);
+                }
+                first = cached[variant];
+                EXPECT_EQUAL(s2n_stuffer_data_available(&out), header_len + first->data.size);
+
+                /* The compressed message decompresses to the Certificate message for this connection */
+                DEFER_CLEANUP(struct s2n_stuffer decompressed = { 0 }, s2n_stuffer_free);
+                EXPECT_OK(s2n_compressed_cert_recv(client, &out, &decompressed));
+                client->cert_compression_algorithm = 0;
+                EXPECT_EQUAL(s2n_stuffer_data_available(&decompressed), s2n_stuffer_data_available(&expected));
+                EXPECT_BYTEARRAY_EQUAL(decompressed.blob.data, expected.blob.data, s2n_stuffer_data_available(&expected));
+            }
+        }
+
+        /* Replacing the OCSP or SCT data drops every message that carried extensions */
+        struct s2n_compressed_cert *no_extensions = cached[0];
+        EXPECT_SUCCESS(s2n_cert_chain_and_key_set_ocsp_data(ext_chain, sct_data, sizeof(sct_data)));
+        EXPECT_EQUAL(cached[0], no_extensions);
+        for (size_t variant = 1; variant < S2N_CERT_COMPRESSION_VARIANTS_COUNT; variant++) {
+            EXPECT_NULL(cached[variant]);
+        }
+    };
+
+    /* Self-talk */
+    if (s2n_is_tls13_fully_supported()) {
+        for (size_t i = 0; i < supported_count; i++) {
+            DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+            EXPECT_NOT_NULL(server_config);
+            EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+            EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(server_config, &supported[i], 1));
+            EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, chain_and_key));
+
+            DEFER_CLEANUP(struct s2n_config *client_config = s2n_config_new(), s2n_config_ptr_free);
+            EXPECT_NOT_NULL(client_config);
+            EXPECT_SUCCESS(s2n_config_set_cipher_preferences(client_config, "default_tls13"));
+            EXPECT_SUCCESS(s2n_config_set_unsafe_for_testing(client_config));
+            EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(client_config, supported, supported_count));
+
+            /* Certificate compressed with the precompressed chain */
+            {
+                DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+                EXPECT_NOT_NULL(server);
+                EXPECT_SUCCESS(s2n_connection_set_config(server, server_config));
+                DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+                EXPECT_NOT_NULL(client);
+                EXPECT_SUCCESS(s2n_connection_set_config(client, client_config));
+
+                DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+                EXPECT_SUCCESS(s2n_io_pair_init_non_blocking(&io_pair));
+                EXPECT_SUCCESS(s2n_connections_set_io_pair(client, server, &io_pair));
+                EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+                EXPECT_EQUAL(client->actual_protocol_version, S2N_TLS13);
+
+                s2n_cert_compression_algorithm algorithm = 0;
+                EXPECT_SUCCESS(s2n_connection_get_cert_compression_algorithm(client, &algorithm));
+                EXPECT_EQUAL(algorithm, supported[i]);
+                EXPECT_SUCCESS(s2n_connection_get_cert_compression_algorithm(server, &algorithm));
+                EXPECT_EQUAL(algorithm, supported[i]);
+                EXPECT_NOT_NULL(client->handshake_params.server_public_key.pkey);
+            };
+
+            /* Certificate compressed when it includes extensions */
+            if (s2n_x509_ocsp_stapling_supported()) {
+                DEFER_CLEANUP(struct s2n_cert_chain_and_key *ocsp_chain = NULL, s2n_cert_chain_and_key_ptr_free);
+                EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&ocsp_chain,
+                        S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN, S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+                const uint8_t ocsp_data[] = "OCSP DATA";
+                EXPECT_SUCCESS(s2n_cert_chain_and_key_set_ocsp_data(ocsp_chain, ocsp_data, sizeof(ocsp_data)));
+
+                DEFER_CLEANUP(struct s2n_config *ocsp_config = s2n_config_new(), s2n_config_ptr_free);
+                EXPECT_NOT_NULL(ocsp_config);
+                EXPECT_SUCCESS(s2n_config_set_cipher_preferences(ocsp_config, "default_tls13"));
+                EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(ocsp_config, &supported[i], 1));
+                EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(ocsp_config, ocsp_chain));
+                EXPECT_SUCCESS(s2n_config_set_status_request_type(client_config, S2N_STATUS_REQUEST_OCSP));
+
+                DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+                EXPECT_NOT_NULL(server);
+                EXPECT_SUCCESS(s2n_connection_set_config(server, ocsp_config));
+                DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+                EXPECT_NOT_NULL(client);
+                EXPECT_SUCCESS(s2n_connection_set_config(client, client_config));
+
+                DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+                EXPECT_SUCCESS(s2n_io_pair_init_non_blocking(&io_pair));
+                EXPECT_SUCCESS(s2n_connections_set_io_pair(client, server, &io_pair));
+                EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+
+                s2n_cert_compression_algorithm algorithm = 0;
+                EXPECT_SUCCESS(s2n_connection_get_cert_compression_algorithm(client, &algorithm));
+                EXPECT_EQUAL(algorithm, supported[i]);
+
+                uint32_t ocsp_len = 0;
+                const uint8_t *received = s2n_connection_get_ocsp_response(client, &ocsp_len);
+                EXPECT_NOT_NULL(received);
+                EXPECT_EQUAL(ocsp_len, sizeof(ocsp_data));
+                EXPECT_BYTEARRAY_EQUAL(received, ocsp_data, sizeof(ocsp_data));
+
+                EXPECT_SUCCESS(s2n_config_set_status_request_type(client_config, S2N_STATUS_REQUEST_NONE));
+            }
+
+            /* Certificate not compressed if TLS1.2 is negotiated */
+            {
+                DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+                EXPECT_NOT_NULL(server);
+                EXPECT_SUCCESS(s2n_connection_set_config(server, server_config));
+                EXPECT_SUCCESS(s2n_connection_set_cipher_preferences(server, "20240501"));
+                DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+                EXPECT_NOT_NULL(client);
+                EXPECT_SUCCESS(s2n_connection_set_config(client, client_config));
+
+                DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+                EXPECT_SUCCESS(s2n_io_pair_init_non_blocking(&io_pair));
+                EXPECT_SUCCESS(s2n_connections_set_io_pair(client, server, &io_pair));
+                EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+                EXPECT_EQUAL(client->actual_protocol_version, S2N_TLS12);
+
+                s2n_cert_compression_algorithm algorithm = 0;
+                EXPECT_FAILURE_WITH_ERRNO(s2n_connection_get_cert_compression_algorithm(client, &algorithm),
+                        S2N_ERR_INVALID_STATE);
+            };
+        }
+    }
+
+    END_TEST();
+}
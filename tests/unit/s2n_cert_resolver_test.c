@@ -0,0 +1,395 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "api/unstable/cert_resolver.h"
+
+#include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_cert_resolver.h"
+#include "tls/s2n_connection.h"
+
+#define S2N_TEST_ALLIGATOR_NAME "www.alligator.com"
+#define S2N_TEST_BEAVER_NAME    "www.beaver.com"
+
+struct s2n_cert_resolver_test_ctx {
+    uint32_t invoked;
+    bool async;
+    bool ignore;
+    bool fail;
+    char last_name[S2N_MAX_SERVER_NAME + 1];
+    struct s2n_cert_chain_and_key *last_chain;
+};
+
+static int s2n_test_cert_resolver_cb(struct s2n_connection *conn, const char *server_name, void *context)
+{
+    struct s2n_cert_resolver_test_ctx *ctx = (struct s2n_cert_resolver_test_ctx *) context;
+    ctx->invoked++;
+    strncpy(ctx->last_name, server_name, S2N_MAX_SERVER_NAME);
+
+    if (ctx->fail) {
+        return S2N_FAILURE;
+    }
+    if (ctx->async) {
+        return S2N_SUCCESS;
+    }
+    if (ctx->ignore) {
+        return s2n_cert_resolver_ignore(conn);
+    }
+
+    const char *cert = S2N_ALLIGATOR_SAN_CERT;
+    const char *key = S2N_ALLIGATOR_SAN_KEY;
+    if (strcmp(server_name, S2N_TEST_BEAVER_NAME) == 0) {
+        cert = "../pems/sni/beaver_cert.pem";
+        key = "../pems/sni/beaver_key.pem";
+    }
+
+    struct s2n_cert_chain_and_key *chain = NULL;
+    POSIX_GUARD(s2n_test_cert_chain_and_key_new(&chain, cert, key));
+    ctx->last_chain = chain;
+    return s2n_cert_resolver_set(conn, chain);
+}
+
+static S2N_RESULT s2n_test_resolver_handshake(struct s2n_config *server_config, struct s2n_config *client_config,
+        const char *server_name, struct s2n_connection **server_conn_out)
+{
+    DEFER_CLEANUP(struct s2n_connection *client_conn = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+    RESULT_ENSURE_REF(client_conn);
+    RESULT_GUARD_POSIX(s2n_connection_set_config(client_conn, client_config));
+    if (server_name[0] != '\0') {
+        RESULT_GUARD_POSIX(s2n_set_server_name(client_conn, server_name));
+    }
+
+    struct s2n_connection *server_conn = *server_conn_out;
+    RESULT_GUARD_POSIX(s2n_connection_set_config(server_conn, server_config));
+
+    DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+    RESULT_GUARD_POSIX(s2n_io_pair_init_non_blocking(&io_pair));
+    RESULT_GUARD_POSIX(s2n_connections_set_io_pair(client_conn, server_conn, &io_pair));
+
+    RESULT_GUARD_POSIX(s2n_negotiate_test_server_and_client(server_conn, client_conn));
+    return S2N_RESULT_OK;
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    DEFER_CLEANUP(struct s2n_cert_chain_and_key *default_chain = NULL, s2n_cert_chain_and_key_ptr_free);
+    EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&default_chain,
+            S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN, S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+
+    DEFER_CLEANUP(struct s2n_config *client_config = s2n_config_new(), s2n_config_ptr_free);
+    EXPECT_NOT_NULL(client_config);
+    EXPECT_SUCCESS(s2n_config_set_cipher_preferences(client_config, "default_tls13"));
+    EXPECT_SUCCESS(s2n_config_disable_x509_verification(client_config));
+
+    /* Test: s2n_cert_cache_new / s2n_cert_cache_free */
+    {
+        EXPECT_NULL_WITH_ERRNO(s2n_cert_cache_new(0), S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_NULL_WITH_ERRNO(s2n_cert_cache_new(UINT32_MAX), S2N_ERR_INVALID_ARGUMENT);
+
+        struct s2n_cert_cache *cache = s2n_cert_cache_new(3);
+        EXPECT_NOT_NULL(cache);
+        EXPECT_EQUAL(cache->bucket_count, 4);
+        EXPECT_SUCCESS(s2n_cert_cache_remove(cache, S2N_TEST_ALLIGATOR_NAME));
+        EXPECT_SUCCESS(s2n_cert_cache_free(&cache));
+        EXPECT_NULL(cache);
+        EXPECT_SUCCESS(s2n_cert_cache_free(&cache));
+        EXPECT_FAILURE_WITH_ERRNO(s2n_cert_cache_free(NULL), S2N_ERR_NULL);
+    };
+
+    /* Test: s2n_config_set_cert_resolver_cb requires both a cache and a callback */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        struct s2n_cert_cache *cache = s2n_cert_cache_new(1);
+        EXPECT_NOT_NULL(cache);
+
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_cert_resolver_cb(config, NULL, s2n_test_cert_resolver_cb, NULL),
+                S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_cert_resolver_cb(config, cache, NULL, NULL),
+                S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(config, cache, s2n_test_cert_resolver_cb, NULL));
+        EXPECT_EQUAL(config->cert_cache, cache);
+        EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(config, NULL, NULL, NULL));
+        EXPECT_NULL(config->cert_cache);
+
+        EXPECT_SUCCESS(s2n_cert_cache_free(&cache));
+    };
+
+    /* Test: return functions can only be called while the callback is pending */
+    {
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_cert_resolver_ignore(conn), S2N_ERR_INVALID_STATE);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_cert_resolver_set(conn, default_chain), S2N_ERR_INVALID_STATE);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_cert_resolver_set(NULL, default_chain), S2N_ERR_NULL);
+    };
+
+    /* Test: resolved certificates are cached and reused */
+    {
+        struct s2n_cert_resolver_test_ctx ctx = { 0 };
+        struct s2n_cert_cache *cache = s2n_cert_cache_new(10);
+        EXPECT_NOT_NULL(cache);
+
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, default_chain));
+        EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(server_config, cache, s2n_test_cert_resolver_cb, &ctx));
+
+        for (size_t i = 0; i < 3; i++) {
+            /* Server names are case insensitive */
+            const char *server_name = (i % 2) ? "WWW.Alligator.com" : S2N_TEST_ALLIGATOR_NAME;
+
+            DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server_conn);
+            EXPECT_OK(s2n_test_resolver_handshake(server_config, client_config, server_name, &server_conn));
+
+            EXPECT_EQUAL(ctx.invoked, 1);
+            EXPECT_STRING_EQUAL(ctx.last_name, S2N_TEST_ALLIGATOR_NAME);
+            EXPECT_EQUAL(s2n_connection_get_selected_cert(server_conn), ctx.last_chain);
+            EXPECT_EQUAL(cache->size, 1);
+
+            s2n_cert_sni_match sni_match = 0;
+            EXPECT_SUCCESS(s2n_connection_get_certificate_match(server_conn, &sni_match));
+            EXPECT_EQUAL(sni_match, S2N_SNI_EXACT_MATCH);
+        }
+
+        /* Removing the certificate causes the callback to be invoked again */
+        EXPECT_SUCCESS(s2n_cert_cache_remove(cache, "WWW.ALLIGATOR.COM"));
+        EXPECT_EQUAL(cache->size, 0);
+        {
+            DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server_conn);
+            EXPECT_OK(s2n_test_resolver_handshake(server_config, client_config, S2N_TEST_ALLIGATOR_NAME, &server_conn));
+            EXPECT_EQUAL(ctx.invoked, 2);
+            EXPECT_EQUAL(s2n_connection_get_selected_cert(server_conn), ctx.last_chain);
+        };
+
+        /* Without a server name, the callback isn't invoked */
+        {
+            DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server_conn);
+            EXPECT_OK(s2n_test_resolver_handshake(server_config, client_config, "", &server_conn));
+            EXPECT_EQUAL(ctx.invoked, 2);
+            EXPECT_EQUAL(s2n_connection_get_selected_cert(server_conn), default_chain);
+        };
+
+        EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(server_config, NULL, NULL, NULL));
+        EXPECT_SUCCESS(s2n_cert_cache_free(&cache));
+    };
+
+    /* Test: cached certificates are only used by connections whose security policy accepts them */
+    {
+        struct s2n_cert_resolver_test_ctx ctx = { 0 };
+        struct s2n_cert_cache *cache = s2n_cert_cache_new(10);
+        EXPECT_NOT_NULL(cache);
+
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, default_chain));
+        EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(server_config, cache, s2n_test_cert_resolver_cb, &ctx));
+
+        struct s2n_cert_chain_and_key *cached_chain = NULL;
+        {
+            DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server_conn);
+            EXPECT_OK(s2n_test_resolver_handshake(server_config, client_config, S2N_TEST_ALLIGATOR_NAME, &server_conn));
+            EXPECT_EQUAL(ctx.invoked, 1);
+            cached_chain = ctx.last_chain;
+        };
+
+        /* A config sharing the cache with the rfc9151 policy doesn't allow the cached 2048 bit RSA
+         * certificate, so the callback is invoked again instead of using the cached chain.
+         */
+        {
+            DEFER_CLEANUP(struct s2n_config *strict_config = s2n_config_new(), s2n_config_ptr_free);
+            EXPECT_NOT_NULL(strict_config);
+            EXPECT_SUCCESS(s2n_config_set_cipher_preferences(strict_config, "20250429"));
+            EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(strict_config, cache, s2n_test_cert_resolver_cb, &ctx));
+
+            DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server_conn);
+            EXPECT_ERROR(s2n_test_resolver_handshake(strict_config, client_config, S2N_TEST_ALLIGATOR_NAME, &server_conn));
+            EXPECT_EQUAL(ctx.invoked, 2);
+            EXPECT_NULL(s2n_cert_resolver_get_chain(server_conn));
+
+            /* s2n_cert_resolver_set rejected the new chain too, so the application still owns it */
+            EXPECT_NOT_EQUAL(ctx.last_chain, cached_chain);
+            EXPECT_SUCCESS(s2n_cert_chain_and_key_free(ctx.last_chain));
+        };
+
+        /* Connections with the original policy still use the cached chain */
+        {
+            DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server_conn);
+            EXPECT_OK(s2n_test_resolver_handshake(server_config, client_config, S2N_TEST_ALLIGATOR_NAME, &server_conn));
+            EXPECT_EQUAL(ctx.invoked, 2);
+            EXPECT_EQUAL(s2n_connection_get_selected_cert(server_conn), cached_chain);
+            EXPECT_EQUAL(cache->size, 1);
+        };
+
+        EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(server_config, NULL, NULL, NULL));
+        EXPECT_SUCCESS(s2n_cert_cache_free(&cache));
+    };
+
+    /* Test: ignoring the callback falls back to the config's certificates */
+    {
+        struct s2n_cert_resolver_test_ctx ctx = { .ignore = true };
+        struct s2n_cert_cache *cache = s2n_cert_cache_new(10);
+        EXPECT_NOT_NULL(cache);
+
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, default_chain));
+        EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(server_config, cache, s2n_test_cert_resolver_cb, &ctx));
+
+        DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(server_conn);
+        EXPECT_OK(s2n_test_resolver_handshake(server_config, client_config, S2N_TEST_ALLIGATOR_NAME, &server_conn));
+        EXPECT_EQUAL(ctx.invoked, 1);
+        EXPECT_EQUAL(s2n_connection_get_selected_cert(server_conn), default_chain);
+        EXPECT_EQUAL(cache->size, 0);
+
+        EXPECT_SUCCESS(s2n_connection_wipe(server_conn));
+        EXPECT_SUCCESS(s2n_cert_cache_free(&cache));
+    };
+
+    /* Test: callback failure fails the handshake */
+    {
+        struct s2n_cert_resolver_test_ctx ctx = { .fail = true };
+        struct s2n_cert_cache *cache = s2n_cert_cache_new(10);
+        EXPECT_NOT_NULL(cache);
+
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, default_chain));
+        EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(server_config, cache, s2n_test_cert_resolver_cb, &ctx));
+
+        DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(server_conn);
+        EXPECT_ERROR_WITH_ERRNO(s2n_test_resolver_handshake(server_config, client_config, S2N_TEST_ALLIGATOR_NAME, &server_conn),
+                S2N_ERR_CANCELLED);
+        EXPECT_EQUAL(ctx.invoked, 1);
+
+        EXPECT_SUCCESS(s2n_connection_wipe(server_conn));
+        EXPECT_SUCCESS(s2n_cert_cache_free(&cache));
+    };
+
+    /* Test: asynchronous callback */
+    {
+        struct s2n_cert_resolver_test_ctx ctx = { .async = true };
+        struct s2n_cert_cache *cache = s2n_cert_cache_new(10);
+        EXPECT_NOT_NULL(cache);
+
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, default_chain));
+        EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(server_config, cache, s2n_test_cert_resolver_cb, &ctx));
+
+        DEFER_CLEANUP(struct s2n_connection *client_conn = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(client_conn);
+        EXPECT_SUCCESS(s2n_connection_set_config(client_conn, client_config));
+        EXPECT_SUCCESS(s2n_set_server_name(client_conn, S2N_TEST_ALLIGATOR_NAME));
+
+        DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(server_conn);
+        EXPECT_SUCCESS(s2n_connection_set_config(server_conn, server_config));
+
+        DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+        EXPECT_SUCCESS(s2n_io_pair_init_non_blocking(&io_pair));
+        EXPECT_SUCCESS(s2n_connections_set_io_pair(client_conn, server_conn, &io_pair));
+
+        s2n_blocked_status blocked = S2N_NOT_BLOCKED;
+        EXPECT_FAILURE_WITH_ERRNO(s2n_negotiate(client_conn, &blocked), S2N_ERR_IO_BLOCKED);
+        for (size_t i = 0; i < 3; i++) {
+            EXPECT_FAILURE_WITH_ERRNO(s2n_negotiate(server_conn, &blocked), S2N_ERR_ASYNC_BLOCKED);
+            EXPECT_EQUAL(blocked, S2N_BLOCKED_ON_APPLICATION_INPUT);
+            EXPECT_EQUAL(ctx.invoked, 1);
+        }
+
+        struct s2n_cert_chain_and_key *chain = NULL;
+        EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&chain, S2N_ALLIGATOR_SAN_CERT, S2N_ALLIGATOR_SAN_KEY));
+        EXPECT_SUCCESS(s2n_cert_resolver_set(server_conn, chain));
+        EXPECT_FAILURE_WITH_ERRNO(s2n_cert_resolver_ignore(server_conn), S2N_ERR_INVALID_STATE);
+
+        EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server_conn, client_conn));
+        EXPECT_EQUAL(ctx.invoked, 1);
+        EXPECT_EQUAL(s2n_connection_get_selected_cert(server_conn), chain);
+
+        /* The cache can't be freed while a connection is using one of its certificates */
+        EXPECT_FAILURE_WITH_ERRNO(s2n_cert_cache_free(&cache), S2N_ERR_INVALID_STATE);
+        EXPECT_NOT_NULL(cache);
+
+        EXPECT_SUCCESS(s2n_connection_wipe(server_conn));
+        EXPECT_SUCCESS(s2n_cert_cache_free(&cache));
+    };
+
+    /* Test: least recently used certificates are evicted */
+    {
+        struct s2n_cert_resolver_test_ctx ctx = { 0 };
+        struct s2n_cert_cache *cache = s2n_cert_cache_new(1);
+        EXPECT_NOT_NULL(cache);
+
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, default_chain));
+        EXPECT_SUCCESS(s2n_config_set_cert_resolver_cb(server_config, cache, s2n_test_cert_resolver_cb, &ctx));
+
+        /* Keep a connection using the alligator certificate */
+        DEFER_CLEANUP(struct s2n_connection *alligator_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(alligator_conn);
+        EXPECT_OK(s2n_test_resolver_handshake(server_config, client_config, S2N_TEST_ALLIGATOR_NAME, &alligator_conn));
+        struct s2n_cert_chain_and_key *alligator_chain = ctx.last_chain;
+        EXPECT_EQUAL(s2n_connection_get_selected_cert(alligator_conn), alligator_chain);
+        EXPECT_EQUAL(alligator_conn->cert_resolver.entry->refcount, 2);
+
+        /* Resolving another name evicts the alligator certificate from the cache */
+        {
+            DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server_conn);
+            EXPECT_OK(s2n_test_resolver_handshake(server_config, client_config, S2N_TEST_BEAVER_NAME, &server_conn));
+            EXPECT_EQUAL(ctx.invoked, 2);
+            EXPECT_EQUAL(s2n_connection_get_selected_cert(server_conn), ctx.last_chain);
+            EXPECT_EQUAL(cache->size, 1);
+            EXPECT_EQUAL(cache->lru_head, server_conn->cert_resolver.entry);
+        };
+
+        /* The evicted certificate is still valid for the connection using it */
+        EXPECT_EQUAL(alligator_conn->cert_resolver.entry->refcount, 1);
+        EXPECT_EQUAL(s2n_connection_get_selected_cert(alligator_conn), alligator_chain);
+        EXPECT_SUCCESS(s2n_connection_wipe(alligator_conn));
+        EXPECT_NULL(alligator_conn->cert_resolver.entry);
+
+        /* The alligator certificate needs to be resolved again */
+        {
+            DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server_conn);
+            EXPECT_OK(s2n_test_resolver_handshake(server_config, client_config, S2N_TEST_ALLIGATOR_NAME, &server_conn));
+            EXPECT_EQUAL(ctx.invoked, 3);
+            EXPECT_STRING_EQUAL(ctx.last_name, S2N_TEST_ALLIGATOR_NAME);
+        };
+
+        EXPECT_SUCCESS(s2n_cert_cache_free(&cache));
+    };
+
+    END_TEST();
+}
@@ -814,6 +814,71 @@ int main(int argc, char **argv)
             EXPECT_EQUAL(server->secure->cipher_suite, &s2n_dhe_rsa_with_aes_128_gcm_sha256);
         };
 
+        /* Client offers cipher suites that s2n-tls doesn't recognize */
+        {
+            DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(),
+                    s2n_config_ptr_free);
+            EXPECT_SUCCESS(s2n_config_set_cipher_preferences(config, "test_all"));
+            EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, rsa_cert));
+
+            DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER),
+                    s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server);
+            EXPECT_SUCCESS(s2n_connection_set_config(server, config));
+            server->actual_protocol_version = S2N_TLS12;
+            server->kex_params.server_ecc_evp_params.negotiated_curve = s2n_all_supported_curves_list[0];
+
+            /* Unknown cipher suites, like GREASE values, are ignored */
+            uint8_t wire[] = {
+                0x0A, 0x0A,
+                0xFF, 0xFF,
+                TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+                0x00, 0x00,
+            };
+            EXPECT_SUCCESS(s2n_set_cipher_as_tls_server(server, wire, sizeof(wire) / S2N_TLS_CIPHER_SUITE_LEN));
+            EXPECT_EQUAL(server->secure->cipher_suite, &s2n_ecdhe_rsa_with_aes_128_gcm_sha256);
+
+            /* Only unknown cipher suites */
+            uint8_t unknown_wire[] = { 0x0A, 0x0A, 0xFF, 0xFF, 0x00, 0x00 };
+            EXPECT_FAILURE_WITH_ERRNO(s2n_set_cipher_as_tls_server(server, unknown_wire,
+                                              sizeof(unknown_wire) / S2N_TLS_CIPHER_SUITE_LEN),
+                    S2N_ERR_CIPHER_NOT_SUPPORTED);
+        };
+
+        /* Server prefers a cipher suite that is not in the list of all cipher suites */
+        {
+            DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(),
+                    s2n_config_ptr_free);
+            EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, rsa_cert));
+
+            struct s2n_cipher_suite custom_cipher_suite = s2n_ecdhe_rsa_with_aes_256_gcm_sha384;
+            struct s2n_cipher_suite *cipher_suites[] = {
+                &custom_cipher_suite,
+                &s2n_ecdhe_rsa_with_aes_128_gcm_sha256,
+            };
+            struct s2n_cipher_preferences cipher_preferences = {
+                .suites = cipher_suites,
+                .count = s2n_array_len(cipher_suites),
+            };
+            struct s2n_security_policy security_policy = security_policy_test_all;
+            security_policy.cipher_preferences = &cipher_preferences;
+
+            DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER),
+                    s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server);
+            EXPECT_SUCCESS(s2n_connection_set_config(server, config));
+            server->security_policy_override = &security_policy;
+            server->actual_protocol_version = S2N_TLS12;
+            server->kex_params.server_ecc_evp_params.negotiated_curve = s2n_all_supported_curves_list[0];
+
+            uint8_t wire[] = {
+                TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+                TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+            };
+            EXPECT_SUCCESS(s2n_set_cipher_as_tls_server(server, wire, sizeof(wire) / S2N_TLS_CIPHER_SUITE_LEN));
+            EXPECT_EQUAL(server->secure->cipher_suite, &custom_cipher_suite);
+        };
+
         EXPECT_SUCCESS(s2n_config_free(server_config));
         EXPECT_SUCCESS(s2n_cert_chain_and_key_free(rsa_cert));
         EXPECT_SUCCESS(s2n_cert_chain_and_key_free(ecdsa_cert));
@@ -991,6 +1056,40 @@ int main(int argc, char **argv)
                 EXPECT_EQUAL(connection->secure->cipher_suite, &s2n_ecdhe_ecdsa_with_aes_128_gcm_sha256);
             };
 
+            /* Only the client's first entry signals chacha20 boosting, even if it isn't a cipher suite */
+            {
+                DEFER_CLEANUP(struct s2n_connection *connection = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+                EXPECT_NOT_NULL(connection);
+                connection->security_policy_override = &security_policy;
+                connection->kex_params.server_ecc_evp_params.negotiated_curve = s2n_all_supported_curves_list[0];
+                EXPECT_SUCCESS(s2n_connection_set_all_protocol_versions(connection, S2N_TLS12));
+                EXPECT_SUCCESS(s2n_connection_set_config(connection, server_config));
+
+                static struct s2n_cipher_suite *test_cipher_suite_list[] = {
+                    /* Negotiated because chacha20 boosting is not signalled */
+                    &s2n_ecdhe_rsa_with_aes_256_cbc_sha384,
+                    /* Would be negotiated if the client signalled chacha20 boosting */
+                    &s2n_ecdhe_rsa_with_chacha20_poly1305_sha256,
+                };
+
+                cipher_preferences = (struct s2n_cipher_preferences){
+                    .count = s2n_array_len(test_cipher_suite_list),
+                    .suites = test_cipher_suite_list,
+                    .allow_chacha20_boosting = true,
+                };
+
+                uint8_t wire[] = {
+                    /* Not a cipher suite */
+                    TLS_EMPTY_RENEGOTIATION_INFO_SCSV,
+                    TLS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256,
+                    TLS_ECDHE_RSA_WITH_AES_256_CBC_SHA384,
+                };
+                uint8_t count = sizeof(wire) / S2N_TLS_CIPHER_SUITE_LEN;
+
+                EXPECT_SUCCESS(s2n_set_cipher_as_tls_server(connection, wire, count));
+                EXPECT_EQUAL(connection->secure->cipher_suite, &s2n_ecdhe_rsa_with_aes_256_cbc_sha384);
+            };
+
             /* Server does not negotiate the client's most preferred chacha20 ciphersuite */
             {
                 DEFER_CLEANUP(struct s2n_connection *connection = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
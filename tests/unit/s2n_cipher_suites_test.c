@@ -42,6 +42,17 @@ int main()
             EXPECT_SUCCESS(s2n_connection_free(conn));
         };
 
+        /* Test: each cipher suite's index is its position in s2n_all_cipher_suites */
+        {
+            for (size_t i = 0; i < cipher_preferences_test_all.count; i++) {
+                struct s2n_cipher_suite *cipher_suite = cipher_preferences_test_all.suites[i];
+                EXPECT_EQUAL(cipher_suite->index, i);
+                if (cipher_suite->sslv3_cipher_suite) {
+                    EXPECT_EQUAL(cipher_suite->sslv3_cipher_suite->index, i);
+                }
+            }
+        };
+
         /* Test: all possible cipher suites are in s2n_all_cipher_suites */
         {
             const struct s2n_security_policy *security_policy = NULL;
@@ -13,6 +13,7 @@
  * permissions and limitations under the License.
  */
 
+#include "api/unstable/cert_compression.h"
 #include "crypto/s2n_pq.h"
 #include "s2n.h"
 #include "s2n_test.h"
@@ -1322,6 +1323,10 @@ int main(int argc, char **argv)
             EXPECT_SUCCESS(s2n_config_set_ct_support_level(client_config, S2N_CT_SUPPORT_REQUEST));
             EXPECT_SUCCESS(s2n_config_send_max_fragment_length(client_config, S2N_TLS_MAX_FRAG_LEN_4096));
             EXPECT_SUCCESS(s2n_config_set_session_tickets_onoff(client_config, 1));
+            const s2n_cert_compression_algorithm cert_compression = S2N_CERT_COMPRESSION_ZLIB;
+            if (s2n_cert_compression_is_supported(cert_compression)) {
+                EXPECT_SUCCESS(s2n_config_set_cert_compression_preferences(client_config, &cert_compression, 1));
+            }
             EXPECT_SUCCESS(s2n_connection_set_config(client_conn, client_config));
             EXPECT_SUCCESS(s2n_set_server_name(client_conn, "localhost"));
             EXPECT_SUCCESS(s2n_connection_append_protocol_preference(client_conn, apn, sizeof(apn)));
@@ -1372,6 +1377,11 @@ int main(int argc, char **argv)
                     continue;
                 }
 
+                /* Certificate compression requires optional build dependencies */
+                if (iana == TLS_EXTENSION_COMPRESS_CERTIFICATE && !s2n_cert_compression_is_supported(cert_compression)) {
+                    continue;
+                }
+
                 bool extension_exists = false;
                 EXPECT_SUCCESS(s2n_client_hello_has_extension(&server_conn->client_hello,
                         iana, &extension_exists));
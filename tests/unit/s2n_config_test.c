@@ -1116,7 +1116,7 @@ int main(int argc, char **argv)
             EXPECT_OK(s2n_config_validate_loaded_certificates(config, &non_local_rfc9151));
         };
 
-        /* Certs in an s2n_config are stored in default_certs_by_type, domain_name_to_cert_map, or
+        /* Certs in an s2n_config are stored in default_certs_by_type, domain_name_to_cert_trie, or
          * both. We want to ensure that the s2n_config_validate_loaded_certificates method will
          * validate certs in both locations.
          */
@@ -1124,14 +1124,14 @@ int main(int argc, char **argv)
         /* certs in default_certs_by_type are validated */
         {
             /* s2n_config_set_cert_chain_and_key_defaults populates default_certs_by_type 
-             * but doesn't populate domain_name_to_cert_map 
+             * but doesn't populate domain_name_to_cert_trie 
              */
             DEFER_CLEANUP(struct s2n_config *config = s2n_config_new_minimal(), s2n_config_ptr_free);
             EXPECT_SUCCESS(s2n_config_set_cert_chain_and_key_defaults(config, &invalid_cert, 1));
 
             /* domain certs is empty */
             uint32_t domain_certs_count = 0;
-            EXPECT_OK(s2n_map_size(config->domain_name_to_cert_map, &domain_certs_count));
+            EXPECT_OK(s2n_sni_trie_size(config->domain_name_to_cert_trie, &domain_certs_count));
             EXPECT_EQUAL(domain_certs_count, 0);
 
             /* certs in default_certs_by_type are validated */
@@ -1139,7 +1139,7 @@ int main(int argc, char **argv)
                     S2N_ERR_SECURITY_POLICY_INCOMPATIBLE_CERT);
         };
 
-        /* certs in the domain map are validated */
+        /* certs in the domain trie are validated */
         {
             DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
             EXPECT_SUCCESS(s2n_config_build_domain_name_to_cert_map(config, invalid_cert));
@@ -1147,12 +1147,12 @@ int main(int argc, char **argv)
             /* default_certs_by_type is empty. */
             EXPECT_EQUAL(s2n_config_get_num_default_certs(config), 0);
 
-            /* certs in domain_map are validated */
+            /* certs in domain_name_to_cert_trie are validated */
             EXPECT_ERROR_WITH_ERRNO(s2n_config_validate_loaded_certificates(config, &rfc9151_applied_locally),
                     S2N_ERR_SECURITY_POLICY_INCOMPATIBLE_CERT);
         };
 
-        /* when cert preferences don't apply locally, certs in domain map are not iterated over
+        /* when cert preferences don't apply locally, certs in domain trie are not iterated over
          *
          * Some customers load large numbers of certificates, so even iterating
          * over every certificate without performing any validation is expensive.
@@ -1172,21 +1172,24 @@ int main(int argc, char **argv)
             EXPECT_NOT_NULL(config);
             EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, valid_cert));
 
-            /* Invalidate the domain map so that attempting to use it will trigger
+            /* Invalidate the domain trie so that attempting to use it will trigger
              * an error. We want to ensure that we DON'T use it.
-             * Iterating over a map requires that map to be immutable / complete.
+             * Iterating over a trie requires its root node.
              */
-            EXPECT_OK(s2n_map_unlock(config->domain_name_to_cert_map));
+            struct s2n_sni_trie_node *root = config->domain_name_to_cert_trie->root;
+            config->domain_name_to_cert_trie->root = NULL;
 
-            /* Control case: if local validation needed, attempt to use invalid domain map */
+            /* Control case: if local validation needed, attempt to use invalid domain trie */
             non_local_rfc9151.certificate_preferences_apply_locally = true;
             EXPECT_ERROR_WITH_ERRNO(
                     s2n_config_validate_loaded_certificates(config, &non_local_rfc9151),
-                    S2N_ERR_MAP_MUTABLE);
+                    S2N_ERR_NULL);
 
-            /* Test case: if no local validation needed, do not use invalid domain map */
+            /* Test case: if no local validation needed, do not use invalid domain trie */
             non_local_rfc9151.certificate_preferences_apply_locally = false;
             EXPECT_OK(s2n_config_validate_loaded_certificates(config, &non_local_rfc9151));
+
+            config->domain_name_to_cert_trie->root = root;
         };
     };
 
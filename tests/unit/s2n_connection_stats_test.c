@@ -0,0 +1,183 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "api/unstable/connection_stats.h"
+
+#include <errno.h>
+
+#include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_connection.h"
+
+#define S2N_TEST_DATA_SIZE 100
+
+static int s2n_test_blocked_send(void *io_context, const uint8_t *buf, uint32_t len)
+{
+    errno = EAGAIN;
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    DEFER_CLEANUP(struct s2n_cert_chain_and_key *chain_and_key = NULL, s2n_cert_chain_and_key_ptr_free);
+    EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&chain_and_key,
+            S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN, S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+
+    DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+    EXPECT_NOT_NULL(config);
+    EXPECT_SUCCESS(s2n_config_set_cipher_preferences(config, "default_tls13"));
+    EXPECT_SUCCESS(s2n_config_set_unsafe_for_testing(config));
+    EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, chain_and_key));
+
+    uint8_t data[S2N_TEST_DATA_SIZE] = { 0 };
+    s2n_blocked_status blocked = S2N_NOT_BLOCKED;
+
+    /* Safety */
+    {
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+        struct s2n_connection_stats stats = { 0 };
+
+        EXPECT_FAILURE_WITH_ERRNO(s2n_connection_get_stats(NULL, &stats, sizeof(stats)), S2N_ERR_NULL);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_connection_get_stats(conn, NULL, sizeof(stats)), S2N_ERR_NULL);
+    };
+
+    /* Stats start at zero */
+    {
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+
+        struct s2n_connection_stats stats = { 0 };
+        memset(&stats, 1, sizeof(stats));
+        EXPECT_SUCCESS(s2n_connection_get_stats(conn, &stats, sizeof(stats)));
+
+        struct s2n_connection_stats zero = { 0 };
+        EXPECT_BYTEARRAY_EQUAL(&stats, &zero, sizeof(stats));
+    };
+
+    /* Callers built with a different version of the struct */
+    {
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+        conn->stats.records_sent = 1;
+        conn->stats.records_received = 2;
+        conn->stats.bytes_copied = 3;
+
+        /* An older, shorter struct only receives the counters it knows about */
+        {
+            struct s2n_connection_stats stats = { 0 };
+            EXPECT_SUCCESS(s2n_connection_get_stats(conn, &stats, sizeof(uint64_t)));
+            EXPECT_EQUAL(stats.records_sent, 1);
+            EXPECT_EQUAL(stats.records_received, 0);
+        };
+
+        /* A newer, longer struct receives zero for the counters it adds */
+        {
+            const size_t known_count = sizeof(struct s2n_connection_stats) / sizeof(uint64_t);
+            uint64_t longer[sizeof(struct s2n_connection_stats) / sizeof(uint64_t) + 1] = { 0 };
+            memset(longer, 1, sizeof(longer));
+            EXPECT_SUCCESS(s2n_connection_get_stats(conn, (struct s2n_connection_stats *) (void *) longer, sizeof(longer)));
+
+            struct s2n_connection_stats stats = { 0 };
+            EXPECT_MEMCPY_SUCCESS(&stats, longer, sizeof(stats));
+            EXPECT_EQUAL(stats.records_sent, 1);
+            EXPECT_EQUAL(stats.records_received, 2);
+            EXPECT_EQUAL(stats.bytes_copied, 3);
+            EXPECT_EQUAL(longer[known_count], 0);
+        };
+    };
+
+    /* Stats count the handshake and application data */
+    {
+        DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_SUCCESS(s2n_connection_set_config(client, config));
+        DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_SUCCESS(s2n_connection_set_config(server, config));
+
+        DEFER_CLEANUP(struct s2n_test_io_stuffer_pair io_pair = { 0 }, s2n_io_stuffer_pair_free);
+        EXPECT_OK(s2n_io_stuffer_pair_init(&io_pair));
+        EXPECT_OK(s2n_connections_set_io_stuffer_pair(client, server, &io_pair));
+        EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+
+        struct s2n_connection_stats client_stats = { 0 }, server_stats = { 0 };
+        EXPECT_SUCCESS(s2n_connection_get_stats(client, &client_stats, sizeof(client_stats)));
+        EXPECT_SUCCESS(s2n_connection_get_stats(server, &server_stats, sizeof(server_stats)));
+
+        /* Both peers sent and received handshake records */
+        EXPECT_TRUE(client_stats.records_sent > 0);
+        EXPECT_TRUE(client_stats.records_received > 0);
+        EXPECT_EQUAL(client_stats.records_sent, server_stats.records_received);
+        EXPECT_EQUAL(server_stats.records_sent, client_stats.records_received);
+        EXPECT_TRUE(client_stats.write_calls > 0);
+        EXPECT_TRUE(client_stats.read_calls > 0);
+        EXPECT_TRUE(client_stats.flushes > 0);
+        EXPECT_TRUE(client_stats.buffer_resizes > 0);
+        EXPECT_TRUE(client_stats.bytes_copied > 0);
+
+        /* No application data yet */
+        EXPECT_EQUAL(client_stats.plaintext_bytes_sent, 0);
+        EXPECT_EQUAL(server_stats.plaintext_bytes_received, 0);
+        EXPECT_EQUAL(client_stats.key_updates_sent, 0);
+
+        /* Application data is counted once per record */
+        EXPECT_EQUAL(s2n_send(client, data, sizeof(data), &blocked), sizeof(data));
+        EXPECT_EQUAL(s2n_recv(server, data, sizeof(data), &blocked), sizeof(data));
+
+        struct s2n_connection_stats client_after = { 0 }, server_after = { 0 };
+        EXPECT_SUCCESS(s2n_connection_get_stats(client, &client_after, sizeof(client_after)));
+        EXPECT_SUCCESS(s2n_connection_get_stats(server, &server_after, sizeof(server_after)));
+        EXPECT_EQUAL(client_after.records_sent, client_stats.records_sent + 1);
+        EXPECT_EQUAL(client_after.plaintext_bytes_sent, sizeof(data));
+        EXPECT_EQUAL(client_after.write_calls, client_stats.write_calls + 1);
+        EXPECT_TRUE(client_after.flushes > client_stats.flushes);
+        EXPECT_EQUAL(server_after.records_received, server_stats.records_received + 1);
+        EXPECT_EQUAL(server_after.plaintext_bytes_received, sizeof(data));
+        EXPECT_TRUE(server_after.bytes_copied >= server_stats.bytes_copied + sizeof(data));
+
+        /* A read with no data available blocks */
+        EXPECT_FAILURE_WITH_ERRNO(s2n_recv(server, data, sizeof(data), &blocked), S2N_ERR_IO_BLOCKED);
+        EXPECT_SUCCESS(s2n_connection_get_stats(server, &server_stats, sizeof(server_stats)));
+        EXPECT_EQUAL(server_stats.read_blocked, server_after.read_blocked + 1);
+        EXPECT_EQUAL(server_stats.read_calls, server_after.read_calls + 1);
+
+        /* KeyUpdates are counted by both peers */
+        EXPECT_SUCCESS(s2n_connection_request_key_update(client, S2N_KEY_UPDATE_NOT_REQUESTED));
+        EXPECT_EQUAL(s2n_send(client, data, sizeof(data), &blocked), sizeof(data));
+        EXPECT_EQUAL(s2n_recv(server, data, sizeof(data), &blocked), sizeof(data));
+        EXPECT_SUCCESS(s2n_connection_get_stats(client, &client_stats, sizeof(client_stats)));
+        EXPECT_SUCCESS(s2n_connection_get_stats(server, &server_stats, sizeof(server_stats)));
+        EXPECT_EQUAL(client_stats.key_updates_sent, 1);
+        EXPECT_EQUAL(server_stats.key_updates_received, 1);
+        EXPECT_EQUAL(client_stats.plaintext_bytes_sent, sizeof(data) * 2);
+        EXPECT_EQUAL(server_stats.plaintext_bytes_received, sizeof(data) * 2);
+
+        /* A write that would block is counted */
+        EXPECT_SUCCESS(s2n_connection_set_send_cb(client, s2n_test_blocked_send));
+        EXPECT_FAILURE_WITH_ERRNO(s2n_send(client, data, sizeof(data), &blocked), S2N_ERR_IO_BLOCKED);
+        EXPECT_SUCCESS(s2n_connection_get_stats(client, &client_after, sizeof(client_after)));
+        EXPECT_EQUAL(client_after.write_blocked, client_stats.write_blocked + 1);
+        EXPECT_EQUAL(client_after.write_calls, client_stats.write_calls + 1);
+
+        /* Wiping the connection resets the stats */
+        EXPECT_SUCCESS(s2n_connection_wipe(server));
+        EXPECT_SUCCESS(s2n_connection_get_stats(server, &server_stats, sizeof(server_stats)));
+        struct s2n_connection_stats zero = { 0 };
+        EXPECT_BYTEARRAY_EQUAL(&server_stats, &zero, sizeof(server_stats));
+    };
+
+    END_TEST();
+}
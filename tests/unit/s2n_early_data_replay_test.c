@@ -0,0 +1,475 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_early_data_replay.h"
+
+#include <pthread.h>
+
+#include "api/unstable/early_data_replay.h"
+#include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_early_data.h"
+#include "tls/s2n_resume.h"
+#include "tls/s2n_tls13.h"
+
+#define TEST_WINDOW_IN_SECS    10
+#define TEST_WINDOW_IN_NANOS   ((uint64_t) TEST_WINDOW_IN_SECS * ONE_SEC_IN_NANOS)
+#define TEST_START_TIME        ((uint64_t) 1000 * ONE_SEC_IN_NANOS)
+#define TEST_THREAD_COUNT      4
+#define TEST_THREAD_HASH_COUNT 1000
+
+struct s2n_test_thread_args {
+    struct s2n_early_data_replay_filter *filter;
+    const uint64_t *hashes;
+    uint32_t accepted;
+};
+
+static uint64_t s2n_test_hash(struct s2n_early_data_replay_filter *filter, uint32_t n)
+{
+    uint64_t hash = 0;
+    struct s2n_blob binder = { 0 };
+    EXPECT_SUCCESS(s2n_blob_init(&binder, (uint8_t *) &n, sizeof(n)));
+    EXPECT_OK(s2n_early_data_replay_filter_hash(filter, &binder, &hash));
+    return hash;
+}
+
+static bool s2n_test_is_replay(struct s2n_early_data_replay_filter *filter, uint64_t hash, uint64_t now)
+{
+    bool is_replay = false;
+    EXPECT_OK(s2n_early_data_replay_filter_check(filter, hash, now, &is_replay));
+    return is_replay;
+}
+
+static void *s2n_test_thread(void *arg)
+{
+    struct s2n_test_thread_args *args = (struct s2n_test_thread_args *) arg;
+    for (size_t i = 0; i < TEST_THREAD_HASH_COUNT; i++) {
+        if (!s2n_test_is_replay(args->filter, args->hashes[i], TEST_START_TIME)) {
+            args->accepted++;
+        }
+    }
+    return NULL;
+}
+
+static uint64_t test_clock_offset = 0;
+
+static int s2n_test_wall_clock(void *ctx, uint64_t *nanoseconds)
+{
+    struct timespec now = { 0 };
+    POSIX_ENSURE(clock_gettime(CLOCK_REALTIME, &now) == 0, S2N_ERR_SAFETY);
+    *nanoseconds = (uint64_t) now.tv_sec * ONE_SEC_IN_NANOS + now.tv_nsec + test_clock_offset;
+    return S2N_SUCCESS;
+}
+
+static int s2n_test_session_ticket_cb(struct s2n_connection *conn, void *ctx, struct s2n_session_ticket *ticket)
+{
+    struct s2n_stuffer *stuffer = (struct s2n_stuffer *) ctx;
+    size_t data_len = 0;
+    POSIX_GUARD(s2n_session_ticket_get_data_len(ticket, &data_len));
+    POSIX_GUARD(s2n_stuffer_wipe(stuffer));
+    POSIX_GUARD(s2n_stuffer_resize(stuffer, data_len));
+    POSIX_GUARD(s2n_session_ticket_get_data(ticket, data_len, stuffer->blob.data));
+    POSIX_GUARD(s2n_stuffer_skip_write(stuffer, data_len));
+    return S2N_SUCCESS;
+}
+
+static uint8_t test_early_data[] = "replayable hello";
+
+/* Writes the client's first flight, including early data, using a saved session ticket */
+static S2N_RESULT s2n_test_client_first_flight(struct s2n_config *config, struct s2n_stuffer *ticket,
+        struct s2n_stuffer *flight)
+{
+    DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+    RESULT_ENSURE_REF(client);
+    RESULT_GUARD_POSIX(s2n_connection_set_config(client, config));
+    RESULT_GUARD_POSIX(s2n_connection_set_session(client, ticket->blob.data, s2n_stuffer_data_available(ticket)));
+
+    DEFER_CLEANUP(struct s2n_stuffer input = { 0 }, s2n_stuffer_free);
+    RESULT_GUARD_POSIX(s2n_stuffer_growable_alloc(&input, 0));
+    RESULT_GUARD_POSIX(s2n_connection_set_io_stuffers(&input, flight, client));
+
+    ssize_t sent = 0;
+    s2n_blocked_status blocked = S2N_NOT_BLOCKED;
+    RESULT_ENSURE_LT(s2n_send_early_data(client, test_early_data, sizeof(test_early_data), &sent, &blocked), 0);
+    RESULT_ENSURE_EQ(s2n_errno, S2N_ERR_IO_BLOCKED);
+    RESULT_ENSURE_EQ(sent, sizeof(test_early_data));
+    RESULT_ENSURE_EQ(client->early_data_state, S2N_EARLY_DATA_REQUESTED);
+    return S2N_RESULT_OK;
+}
+
+/* Delivers a copy of the client's first flight to a new server connection */
+static S2N_RESULT s2n_test_server_receive(struct s2n_config *config, struct s2n_stuffer *flight,
+        s2n_early_data_state *state, ssize_t *early_data_received)
+{
+    DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+    RESULT_ENSURE_REF(server);
+    RESULT_GUARD_POSIX(s2n_connection_set_config(server, config));
+
+    DEFER_CLEANUP(struct s2n_stuffer input = { 0 }, s2n_stuffer_free);
+    DEFER_CLEANUP(struct s2n_stuffer output = { 0 }, s2n_stuffer_free);
+    RESULT_GUARD_POSIX(s2n_stuffer_growable_alloc(&input, 0));
+    RESULT_GUARD_POSIX(s2n_stuffer_growable_alloc(&output, 0));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(&input, flight->blob.data, s2n_stuffer_data_available(flight)));
+    RESULT_GUARD_POSIX(s2n_connection_set_io_stuffers(&input, &output, server));
+
+    uint8_t received[sizeof(test_early_data)] = { 0 };
+    s2n_blocked_status blocked = S2N_NOT_BLOCKED;
+    *early_data_received = 0;
+    s2n_recv_early_data(server, received, sizeof(received), early_data_received, &blocked);
+    RESULT_ENSURE_EQ(server->psk_params.type, S2N_PSK_TYPE_RESUMPTION);
+    RESULT_ENSURE_REF(server->psk_params.chosen_psk);
+    *state = server->early_data_state;
+    return S2N_RESULT_OK;
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    /* Test: s2n_early_data_replay_filter_new */
+    {
+        DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter = NULL, s2n_early_data_replay_filter_ptr_free);
+
+        EXPECT_ERROR_WITH_ERRNO(s2n_early_data_replay_filter_new(0, TEST_WINDOW_IN_SECS, &filter),
+                S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_ERROR_WITH_ERRNO(s2n_early_data_replay_filter_new(S2N_EARLY_DATA_REPLAY_MAX_HANDSHAKES + 1,
+                                        TEST_WINDOW_IN_SECS, &filter),
+                S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_ERROR_WITH_ERRNO(s2n_early_data_replay_filter_new(1, 0, &filter), S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_NULL(filter);
+
+        /* Small filters still fill at least a few cache lines */
+        EXPECT_OK(s2n_early_data_replay_filter_new(1, TEST_WINDOW_IN_SECS, &filter));
+        EXPECT_EQUAL(filter->word_mask + 1, 64);
+        EXPECT_EQUAL(filter->window_in_nanos, TEST_WINDOW_IN_NANOS);
+        EXPECT_OK(s2n_early_data_replay_filter_free(&filter));
+        EXPECT_NULL(filter);
+
+        /* Filters are sized to a power of two words, with at most four handshakes per word */
+        EXPECT_OK(s2n_early_data_replay_filter_new(1000, TEST_WINDOW_IN_SECS, &filter));
+        EXPECT_EQUAL(filter->word_mask + 1, 256);
+        EXPECT_EQUAL(filter->words_mem.size, 256 * sizeof(uint64_t) * 2);
+        EXPECT_OK(s2n_early_data_replay_filter_free(&filter));
+
+        EXPECT_OK(s2n_early_data_replay_filter_new(S2N_EARLY_DATA_REPLAY_MAX_HANDSHAKES, TEST_WINDOW_IN_SECS, &filter));
+        EXPECT_EQUAL(filter->word_mask + 1, S2N_EARLY_DATA_REPLAY_MAX_HANDSHAKES / 4);
+        EXPECT_OK(s2n_early_data_replay_filter_free(&filter));
+
+        /* Safe to free twice */
+        EXPECT_OK(s2n_early_data_replay_filter_free(&filter));
+    };
+
+    /* Test: s2n_early_data_replay_filter_hash */
+    {
+        DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter_a = NULL, s2n_early_data_replay_filter_ptr_free);
+        DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter_b = NULL, s2n_early_data_replay_filter_ptr_free);
+        EXPECT_OK(s2n_early_data_replay_filter_new(1, TEST_WINDOW_IN_SECS, &filter_a));
+        EXPECT_OK(s2n_early_data_replay_filter_new(1, TEST_WINDOW_IN_SECS, &filter_b));
+
+        EXPECT_EQUAL(s2n_test_hash(filter_a, 1), s2n_test_hash(filter_a, 1));
+        EXPECT_NOT_EQUAL(s2n_test_hash(filter_a, 1), s2n_test_hash(filter_a, 2));
+
+        /* Each filter uses its own random key */
+        EXPECT_NOT_EQUAL(s2n_test_hash(filter_a, 1), s2n_test_hash(filter_b, 1));
+    };
+
+    /* Test: s2n_early_data_replay_filter_check */
+    {
+        /* Safety */
+        {
+            DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter = NULL, s2n_early_data_replay_filter_ptr_free);
+            EXPECT_OK(s2n_early_data_replay_filter_new(1, TEST_WINDOW_IN_SECS, &filter));
+            bool is_replay = false;
+            EXPECT_ERROR_WITH_ERRNO(s2n_early_data_replay_filter_check(NULL, 0, 0, &is_replay), S2N_ERR_NULL);
+            EXPECT_ERROR_WITH_ERRNO(s2n_early_data_replay_filter_check(filter, 0, 0, NULL), S2N_ERR_NULL);
+        };
+
+        /* A binder is only accepted once */
+        {
+            DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter = NULL, s2n_early_data_replay_filter_ptr_free);
+            EXPECT_OK(s2n_early_data_replay_filter_new(100, TEST_WINDOW_IN_SECS, &filter));
+
+            uint64_t hash_a = s2n_test_hash(filter, 1);
+            uint64_t hash_b = s2n_test_hash(filter, 2);
+            EXPECT_FALSE(s2n_test_is_replay(filter, hash_a, TEST_START_TIME));
+            EXPECT_TRUE(s2n_test_is_replay(filter, hash_a, TEST_START_TIME));
+            EXPECT_TRUE(s2n_test_is_replay(filter, hash_a, TEST_START_TIME + 1));
+            EXPECT_FALSE(s2n_test_is_replay(filter, hash_b, TEST_START_TIME + 1));
+            EXPECT_TRUE(s2n_test_is_replay(filter, hash_b, TEST_START_TIME + 1));
+        };
+
+        /* A binder is remembered in the window after it was recorded */
+        {
+            DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter = NULL, s2n_early_data_replay_filter_ptr_free);
+            EXPECT_OK(s2n_early_data_replay_filter_new(100, TEST_WINDOW_IN_SECS, &filter));
+
+            uint64_t hash = s2n_test_hash(filter, 1);
+            EXPECT_FALSE(s2n_test_is_replay(filter, hash, TEST_START_TIME));
+            EXPECT_TRUE(s2n_test_is_replay(filter, hash, TEST_START_TIME + TEST_WINDOW_IN_NANOS - 1));
+            EXPECT_EQUAL(filter->window_start, TEST_START_TIME);
+
+            /* The filter rotates, but the binder is found in the previous filter */
+            EXPECT_TRUE(s2n_test_is_replay(filter, hash, TEST_START_TIME + TEST_WINDOW_IN_NANOS));
+            EXPECT_EQUAL(filter->window_start, TEST_START_TIME + TEST_WINDOW_IN_NANOS);
+        };
+
+        /* A binder is forgotten two windows after it was recorded */
+        {
+            DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter = NULL, s2n_early_data_replay_filter_ptr_free);
+            EXPECT_OK(s2n_early_data_replay_filter_new(100, TEST_WINDOW_IN_SECS, &filter));
+
+            uint64_t hash = s2n_test_hash(filter, 1);
+            uint64_t other_hash = s2n_test_hash(filter, 2);
+            EXPECT_FALSE(s2n_test_is_replay(filter, hash, TEST_START_TIME));
+
+            /* Other handshakes rotate the filters */
+            EXPECT_FALSE(s2n_test_is_replay(filter, other_hash, TEST_START_TIME + TEST_WINDOW_IN_NANOS));
+            EXPECT_EQUAL(filter->window_start, TEST_START_TIME + TEST_WINDOW_IN_NANOS);
+            EXPECT_TRUE(s2n_test_is_replay(filter, other_hash, TEST_START_TIME + TEST_WINDOW_IN_NANOS * 2));
+            EXPECT_EQUAL(filter->window_start, TEST_START_TIME + TEST_WINDOW_IN_NANOS * 2);
+
+            EXPECT_FALSE(s2n_test_is_replay(filter, hash, TEST_START_TIME + TEST_WINDOW_IN_NANOS * 2));
+        };
+
+        /* Both filters are cleared if no handshakes happen for two windows */
+        {
+            DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter = NULL, s2n_early_data_replay_filter_ptr_free);
+            EXPECT_OK(s2n_early_data_replay_filter_new(100, TEST_WINDOW_IN_SECS, &filter));
+
+            uint64_t hash = s2n_test_hash(filter, 1);
+            EXPECT_FALSE(s2n_test_is_replay(filter, hash, TEST_START_TIME));
+            EXPECT_FALSE(s2n_test_is_replay(filter, hash, TEST_START_TIME + TEST_WINDOW_IN_NANOS * 2));
+            EXPECT_TRUE(s2n_test_is_replay(filter, hash, TEST_START_TIME + TEST_WINDOW_IN_NANOS * 2));
+        };
+
+        /* A clock that moves backwards does not rotate the filters */
+        {
+            DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter = NULL, s2n_early_data_replay_filter_ptr_free);
+            EXPECT_OK(s2n_early_data_replay_filter_new(100, TEST_WINDOW_IN_SECS, &filter));
+
+            uint64_t hash = s2n_test_hash(filter, 1);
+            EXPECT_FALSE(s2n_test_is_replay(filter, hash, TEST_START_TIME));
+            EXPECT_TRUE(s2n_test_is_replay(filter, hash, TEST_START_TIME - TEST_WINDOW_IN_NANOS * 2));
+            EXPECT_EQUAL(filter->window_start, TEST_START_TIME);
+        };
+
+        /* Few unique binders are mistaken for replays while the filter is within its expected load */
+        {
+            const uint32_t max_handshakes = 4096;
+            DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter = NULL, s2n_early_data_replay_filter_ptr_free);
+            EXPECT_OK(s2n_early_data_replay_filter_new(max_handshakes, TEST_WINDOW_IN_SECS, &filter));
+
+            uint32_t false_positives = 0;
+            for (uint32_t i = 0; i < max_handshakes; i++) {
+                if (s2n_test_is_replay(filter, s2n_test_hash(filter, i), TEST_START_TIME)) {
+                    false_positives++;
+                }
+            }
+            /* Expect roughly 0.1%, so allow 1% */
+            EXPECT_TRUE(false_positives < max_handshakes / 100);
+
+            /* Every recorded binder is still detected */
+            for (uint32_t i = 0; i < max_handshakes; i++) {
+                EXPECT_TRUE(s2n_test_is_replay(filter, s2n_test_hash(filter, i), TEST_START_TIME));
+            }
+        };
+
+        /* Concurrent checks of the same binders only accept each binder once */
+        {
+            DEFER_CLEANUP(struct s2n_early_data_replay_filter *filter = NULL, s2n_early_data_replay_filter_ptr_free);
+            EXPECT_OK(s2n_early_data_replay_filter_new(S2N_EARLY_DATA_REPLAY_MAX_HANDSHAKES, TEST_WINDOW_IN_SECS, &filter));
+
+            uint64_t hashes[TEST_THREAD_HASH_COUNT] = { 0 };
+            for (uint32_t i = 0; i < TEST_THREAD_HASH_COUNT; i++) {
+                hashes[i] = s2n_test_hash(filter, i);
+            }
+
+            /* Start the first window before the threads race */
+            EXPECT_FALSE(s2n_test_is_replay(filter, s2n_test_hash(filter, UINT32_MAX), TEST_START_TIME));
+
+            pthread_t threads[TEST_THREAD_COUNT] = { 0 };
+            struct s2n_test_thread_args args[TEST_THREAD_COUNT] = { 0 };
+            for (size_t i = 0; i < TEST_THREAD_COUNT; i++) {
+                args[i] = (struct s2n_test_thread_args){ .filter = filter, .hashes = hashes };
+                EXPECT_EQUAL(pthread_create(&threads[i], NULL, s2n_test_thread, &args[i]), 0);
+            }
+
+            uint32_t accepted = 0;
+            for (size_t i = 0; i < TEST_THREAD_COUNT; i++) {
+                EXPECT_EQUAL(pthread_join(threads[i], NULL), 0);
+                accepted += args[i].accepted;
+            }
+            EXPECT_EQUAL(accepted, TEST_THREAD_HASH_COUNT);
+        };
+    };
+
+    /* Test: s2n_config_enable_early_data_replay_filter */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_enable_early_data_replay_filter(NULL, 1, 1), S2N_ERR_NULL);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_enable_early_data_replay_filter(config, 0, 1), S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_enable_early_data_replay_filter(config, 1, 0), S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_NULL(config->early_data_replay_filter);
+
+        EXPECT_SUCCESS(s2n_config_enable_early_data_replay_filter(config, 1000, TEST_WINDOW_IN_SECS));
+        EXPECT_NOT_NULL(config->early_data_replay_filter);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_enable_early_data_replay_filter(config, 1000, TEST_WINDOW_IN_SECS),
+                S2N_ERR_INVALID_STATE);
+    };
+
+    if (!s2n_is_tls13_fully_supported()) {
+        END_TEST();
+    }
+
+    DEFER_CLEANUP(struct s2n_cert_chain_and_key *chain_and_key = NULL, s2n_cert_chain_and_key_ptr_free);
+    EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&chain_and_key,
+            S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN, S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+
+    /* Test: replayed early data is rejected */
+    {
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, chain_and_key));
+        EXPECT_SUCCESS(s2n_config_set_wall_clock(server_config, s2n_test_wall_clock, NULL));
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(server_config));
+        EXPECT_SUCCESS(s2n_config_set_server_max_early_data_size(server_config, UINT16_MAX));
+        EXPECT_SUCCESS(s2n_config_enable_early_data_replay_filter(server_config, 1000, TEST_WINDOW_IN_SECS));
+
+        DEFER_CLEANUP(struct s2n_stuffer ticket = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&ticket, 0));
+
+        DEFER_CLEANUP(struct s2n_config *client_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(client_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(client_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_set_unsafe_for_testing(client_config));
+        EXPECT_SUCCESS(s2n_config_set_session_tickets_onoff(client_config, true));
+        EXPECT_SUCCESS(s2n_config_set_session_ticket_cb(client_config, s2n_test_session_ticket_cb, &ticket));
+
+        /* Get a session ticket that allows early data */
+        {
+            DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+            DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(client);
+            EXPECT_NOT_NULL(server);
+            EXPECT_SUCCESS(s2n_connection_set_config(client, client_config));
+            EXPECT_SUCCESS(s2n_connection_set_config(server, server_config));
+
+            DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+            EXPECT_SUCCESS(s2n_io_pair_init_non_blocking(&io_pair));
+            EXPECT_SUCCESS(s2n_connections_set_io_pair(client, server, &io_pair));
+            EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+
+            uint8_t data = 0;
+            s2n_blocked_status blocked = S2N_NOT_BLOCKED;
+            EXPECT_SUCCESS(s2n_connection_add_new_tickets_to_send(server, 1));
+            EXPECT_EQUAL(s2n_send(server, &data, 1, &blocked), 1);
+            EXPECT_EQUAL(s2n_recv(client, &data, 1, &blocked), 1);
+            EXPECT_TRUE(s2n_stuffer_data_available(&ticket) > 0);
+        };
+
+        DEFER_CLEANUP(struct s2n_stuffer flight = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&flight, 0));
+        EXPECT_OK(s2n_test_client_first_flight(client_config, &ticket, &flight));
+
+        /* The original ClientHello is accepted */
+        s2n_early_data_state state = S2N_UNKNOWN_EARLY_DATA_STATE;
+        ssize_t early_data_received = 0;
+        EXPECT_OK(s2n_test_server_receive(server_config, &flight, &state, &early_data_received));
+        EXPECT_EQUAL(state, S2N_EARLY_DATA_ACCEPTED);
+        EXPECT_EQUAL(early_data_received, sizeof(test_early_data));
+
+        /* The replayed ClientHello is rejected and its early data is never delivered */
+        for (size_t i = 0; i < 3; i++) {
+            EXPECT_OK(s2n_test_server_receive(server_config, &flight, &state, &early_data_received));
+            EXPECT_EQUAL(state, S2N_EARLY_DATA_REJECTED);
+            EXPECT_EQUAL(early_data_received, 0);
+        }
+
+        /* A new ClientHello with the same ticket has a different binder, so is accepted */
+        {
+            DEFER_CLEANUP(struct s2n_stuffer new_flight = { 0 }, s2n_stuffer_free);
+            EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&new_flight, 0));
+            EXPECT_OK(s2n_test_client_first_flight(client_config, &ticket, &new_flight));
+
+            EXPECT_OK(s2n_test_server_receive(server_config, &new_flight, &state, &early_data_received));
+            EXPECT_EQUAL(state, S2N_EARLY_DATA_ACCEPTED);
+            EXPECT_EQUAL(early_data_received, sizeof(test_early_data));
+        };
+
+        /* A ClientHello that arrives too long after the client sent it is rejected,
+         * because the filter may already have forgotten it.
+         */
+        {
+            DEFER_CLEANUP(struct s2n_stuffer late_flight = { 0 }, s2n_stuffer_free);
+            EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&late_flight, 0));
+            EXPECT_OK(s2n_test_client_first_flight(client_config, &ticket, &late_flight));
+
+            test_clock_offset = TEST_WINDOW_IN_NANOS;
+            EXPECT_OK(s2n_test_server_receive(server_config, &late_flight, &state, &early_data_received));
+            test_clock_offset = 0;
+            EXPECT_EQUAL(state, S2N_EARLY_DATA_REJECTED);
+            EXPECT_EQUAL(early_data_received, 0);
+
+            /* The same ClientHello is accepted within the allowed clock skew */
+            test_clock_offset = TEST_WINDOW_IN_NANOS / 4;
+            EXPECT_OK(s2n_test_server_receive(server_config, &late_flight, &state, &early_data_received));
+            test_clock_offset = 0;
+            EXPECT_EQUAL(state, S2N_EARLY_DATA_ACCEPTED);
+        };
+
+        /* Without the filter, the replayed ClientHello is accepted again */
+        EXPECT_OK(s2n_early_data_replay_filter_free(&server_config->early_data_replay_filter));
+        EXPECT_OK(s2n_test_server_receive(server_config, &flight, &state, &early_data_received));
+        EXPECT_EQUAL(state, S2N_EARLY_DATA_ACCEPTED);
+    };
+
+    /* Test: early data with external PSKs is rejected, since its age is unknown */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, chain_and_key));
+        EXPECT_SUCCESS(s2n_config_enable_early_data_replay_filter(config, 1000, TEST_WINDOW_IN_SECS));
+
+        DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(client);
+        EXPECT_NOT_NULL(server);
+        EXPECT_SUCCESS(s2n_connection_set_config(client, config));
+        EXPECT_SUCCESS(s2n_connection_set_config(server, config));
+        EXPECT_OK(s2n_append_test_psk_with_early_data(client, UINT16_MAX, &s2n_tls13_aes_128_gcm_sha256));
+        EXPECT_OK(s2n_append_test_psk_with_early_data(server, UINT16_MAX, &s2n_tls13_aes_128_gcm_sha256));
+
+        DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+        EXPECT_SUCCESS(s2n_io_pair_init_non_blocking(&io_pair));
+        EXPECT_SUCCESS(s2n_connections_set_io_pair(client, server, &io_pair));
+
+        uint8_t received_data[sizeof(test_early_data)] = { 0 };
+        struct s2n_blob send = { 0 }, received = { 0 };
+        EXPECT_SUCCESS(s2n_blob_init(&send, test_early_data, sizeof(test_early_data)));
+        EXPECT_SUCCESS(s2n_blob_init(&received, received_data, sizeof(received_data)));
+        EXPECT_OK(s2n_negotiate_test_server_and_client_with_early_data(server, client, &send, &received));
+
+        EXPECT_EQUAL(server->early_data_state, S2N_EARLY_DATA_REJECTED);
+        EXPECT_EQUAL(received.size, 0);
+    };
+
+    END_TEST();
+}
@@ -53,7 +53,7 @@ int main(int argc, char **argv)
             EXPECT_NOT_NULL(key);
 
             /* Encrypt the ticket with EMS data */
-            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key, &ticket));
+            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key->key_name, &ticket));
 
             EXPECT_SUCCESS(s2n_connection_wipe(conn));
             EXPECT_SUCCESS(s2n_connection_set_config(conn, config));
@@ -95,7 +95,7 @@ int main(int argc, char **argv)
             EXPECT_NOT_NULL(key);
 
             /* Encrypt the ticket without EMS data */
-            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key, &ticket));
+            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key->key_name, &ticket));
 
             EXPECT_SUCCESS(s2n_connection_wipe(conn));
             EXPECT_SUCCESS(s2n_connection_set_config(conn, config));
@@ -135,7 +135,7 @@ int main(int argc, char **argv)
             EXPECT_NOT_NULL(key);
 
             /* Encrypt the ticket with EMS data */
-            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key, &ticket));
+            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key->key_name, &ticket));
 
             EXPECT_SUCCESS(s2n_connection_wipe(conn));
             EXPECT_SUCCESS(s2n_connection_set_config(conn, config));
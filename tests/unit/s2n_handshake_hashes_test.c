@@ -16,6 +16,7 @@
 #include "tls/s2n_handshake_hashes.h"
 
 #include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
 #include "tls/s2n_connection.h"
 
 /* Needed for s2n_handshake_get_hash_state_ptr */
@@ -121,6 +122,231 @@ int main(int argc, char **argv)
         };
     };
 
+    /* Test deferred transcript hashing */
+    {
+        uint8_t message[] = "a handshake message";
+        struct s2n_blob message_blob = { 0 };
+        EXPECT_SUCCESS(s2n_blob_init(&message_blob, message, sizeof(message)));
+
+        uint8_t expected[SHA384_DIGEST_LENGTH] = { 0 };
+        uint8_t actual[SHA384_DIGEST_LENGTH] = { 0 };
+        DEFER_CLEANUP(struct s2n_hash_state expected_hash = { 0 }, s2n_hash_free);
+        EXPECT_SUCCESS(s2n_hash_new(&expected_hash));
+        EXPECT_SUCCESS(s2n_hash_init(&expected_hash, S2N_HASH_SHA384));
+        EXPECT_SUCCESS(s2n_hash_update(&expected_hash, message, sizeof(message)));
+        EXPECT_SUCCESS(s2n_hash_update(&expected_hash, message, sizeof(message)));
+        EXPECT_SUCCESS(s2n_hash_digest(&expected_hash, expected, sizeof(expected)));
+
+        /* Safety */
+        {
+            struct s2n_hash_state *hash_state = NULL;
+            EXPECT_ERROR_WITH_ERRNO(s2n_handshake_hashes_activate(NULL, S2N_HASH_SHA256), S2N_ERR_NULL);
+            EXPECT_ERROR_WITH_ERRNO(s2n_handshake_hashes_buffer(NULL, &message_blob), S2N_ERR_NULL);
+            EXPECT_ERROR_WITH_ERRNO(s2n_handshake_hashes_release_transcript(NULL), S2N_ERR_NULL);
+            EXPECT_ERROR_WITH_ERRNO(s2n_handshake_hashes_get_state(NULL, S2N_HASH_SHA256, &hash_state), S2N_ERR_NULL);
+        };
+
+        /* No hash states are set up for a new s2n_handshake_hashes struct */
+        {
+            DEFER_CLEANUP(struct s2n_handshake_hashes *hashes = NULL, s2n_handshake_hashes_free);
+            EXPECT_OK(s2n_handshake_hashes_new(&hashes));
+            EXPECT_NOT_NULL(hashes);
+
+            for (s2n_hash_algorithm alg = 0; alg < S2N_HASH_ALGS_COUNT; alg++) {
+                EXPECT_FALSE(hashes->active_hash_algs[alg]);
+                EXPECT_NULL(hashes->transcript_hashes[alg]);
+                if (skip_handshake_hash[alg]) {
+                    continue;
+                }
+                struct s2n_hash_state *hash_state = NULL;
+                EXPECT_ERROR_WITH_ERRNO(s2n_handshake_hashes_get_state(hashes, alg, &hash_state), S2N_ERR_HASH_NOT_READY);
+            }
+            EXPECT_TRUE(hashes->transcript_buffered);
+        };
+
+        /* A hash activated after messages are buffered catches up on the transcript */
+        {
+            struct s2n_connection *conn = s2n_connection_new(S2N_SERVER);
+            EXPECT_NOT_NULL(conn);
+            struct s2n_handshake_hashes *hashes = conn->handshake.hashes;
+
+            EXPECT_SUCCESS(s2n_conn_update_handshake_hashes(conn, &message_blob));
+            EXPECT_FALSE(hashes->active_hash_algs[S2N_HASH_SHA384]);
+
+            EXPECT_OK(s2n_handshake_hashes_activate(hashes, S2N_HASH_SHA384));
+            EXPECT_TRUE(hashes->active_hash_algs[S2N_HASH_SHA384]);
+            EXPECT_SUCCESS(s2n_conn_update_handshake_hashes(conn, &message_blob));
+
+            EXPECT_OK(s2n_handshake_copy_hash_state(conn, S2N_HASH_SHA384, &hashes->hash_workspace));
+            EXPECT_SUCCESS(s2n_hash_digest(&hashes->hash_workspace, actual, sizeof(actual)));
+            EXPECT_BYTEARRAY_EQUAL(actual, expected, sizeof(expected));
+
+            /* A hash activated later sees the same transcript */
+            struct s2n_hash_state *hash_state = NULL;
+            EXPECT_SUCCESS(s2n_handshake_get_hash_state_ptr(conn, S2N_HASH_SHA256, &hash_state));
+            uint64_t bytes_in_hash = 0;
+            EXPECT_SUCCESS(s2n_hash_get_currently_in_hash_total(hash_state, &bytes_in_hash));
+            EXPECT_EQUAL(bytes_in_hash, sizeof(message) * 2);
+
+            EXPECT_SUCCESS(s2n_connection_free(conn));
+        };
+
+        /* Inactive hashes can't be set up once the transcript is released */
+        {
+            DEFER_CLEANUP(struct s2n_handshake_hashes *hashes = NULL, s2n_handshake_hashes_free);
+            EXPECT_OK(s2n_handshake_hashes_new(&hashes));
+
+            EXPECT_OK(s2n_handshake_hashes_buffer(hashes, &message_blob));
+            EXPECT_OK(s2n_handshake_hashes_activate(hashes, S2N_HASH_SHA256));
+            EXPECT_OK(s2n_handshake_hashes_release_transcript(hashes));
+            EXPECT_FALSE(hashes->transcript_buffered);
+            EXPECT_EQUAL(hashes->transcript.blob.size, 0);
+
+            /* Buffering is a no-op */
+            EXPECT_OK(s2n_handshake_hashes_buffer(hashes, &message_blob));
+            EXPECT_EQUAL(s2n_stuffer_data_available(&hashes->transcript), 0);
+
+            /* Active hashes are still available */
+            EXPECT_OK(s2n_handshake_hashes_activate(hashes, S2N_HASH_SHA256));
+            EXPECT_ERROR_WITH_ERRNO(s2n_handshake_hashes_activate(hashes, S2N_HASH_SHA384), S2N_ERR_HASH_NOT_READY);
+
+            /* Wiping restores the transcript */
+            EXPECT_OK(s2n_handshake_hashes_wipe(hashes));
+            EXPECT_TRUE(hashes->transcript_buffered);
+            EXPECT_FALSE(hashes->active_hash_algs[S2N_HASH_SHA256]);
+            EXPECT_OK(s2n_handshake_hashes_activate(hashes, S2N_HASH_SHA384));
+        };
+
+        /* Only the PRF hash is set up for a handshake */
+        {
+            DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+            EXPECT_NOT_NULL(config);
+            DEFER_CLEANUP(struct s2n_cert_chain_and_key *chain_and_key = NULL, s2n_cert_chain_and_key_ptr_free);
+            EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&chain_and_key,
+                    S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN, S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+            EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, chain_and_key));
+            EXPECT_SUCCESS(s2n_config_set_unsafe_for_testing(config));
+
+            const char *policies[] = { "test_all_tls12", "default_tls13" };
+            for (size_t i = 0; i < s2n_array_len(policies); i++) {
+                if (i == 1 && !s2n_is_tls13_fully_supported()) {
+                    continue;
+                }
+                EXPECT_SUCCESS(s2n_config_set_cipher_preferences(config, policies[i]));
+
+                DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+                EXPECT_NOT_NULL(client);
+                EXPECT_SUCCESS(s2n_connection_set_config(client, config));
+
+                DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+                EXPECT_NOT_NULL(server);
+                EXPECT_SUCCESS(s2n_connection_set_config(server, config));
+
+                DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+                EXPECT_SUCCESS(s2n_io_pair_init_non_blocking(&io_pair));
+                EXPECT_SUCCESS(s2n_connections_set_io_pair(client, server, &io_pair));
+                EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+
+                struct s2n_connection *conns[] = { client, server };
+                for (size_t j = 0; j < s2n_array_len(conns); j++) {
+                    struct s2n_connection *conn = conns[j];
+                    EXPECT_FALSE(conn->handshake.hashes->transcript_buffered);
+
+                    s2n_hash_algorithm prf_hash_alg = S2N_HASH_NONE;
+                    EXPECT_SUCCESS(s2n_hmac_hash_alg(conn->secure->cipher_suite->prf_alg, &prf_hash_alg));
+
+                    /* A TLS1.2 client allows client auth by default, but the server never asked for it */
+                    for (s2n_hash_algorithm alg = 0; alg < S2N_HASH_ALGS_COUNT; alg++) {
+                        EXPECT_EQUAL(conn->handshake.hashes->active_hash_algs[alg], alg == prf_hash_alg);
+                        EXPECT_EQUAL(conn->handshake.hashes->transcript_hashes[alg] != NULL, alg == prf_hash_alg);
+                    }
+                }
+            }
+        };
+
+        /* With TLS1.2 client auth, only the PRF hash and the CertificateVerify hash are set up */
+        {
+            struct s2n_cipher_suite *cipher_suites[] = { &s2n_ecdhe_ecdsa_with_aes_256_gcm_sha384 };
+            struct s2n_cipher_preferences cipher_preferences = {
+                .count = s2n_array_len(cipher_suites),
+                .suites = cipher_suites,
+            };
+            const struct s2n_signature_scheme *sig_schemes[] = { &s2n_ecdsa_sha256 };
+            struct s2n_signature_preferences signature_preferences = {
+                .count = s2n_array_len(sig_schemes),
+                .signature_schemes = sig_schemes,
+            };
+            struct s2n_security_policy security_policy = {
+                .minimum_protocol_version = S2N_TLS12,
+                .cipher_preferences = &cipher_preferences,
+                .kem_preferences = &kem_preferences_null,
+                .signature_preferences = &signature_preferences,
+                .ecc_preferences = &s2n_ecc_preferences_20200310,
+            };
+
+            DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+            EXPECT_NOT_NULL(config);
+            DEFER_CLEANUP(struct s2n_cert_chain_and_key *chain_and_key = NULL, s2n_cert_chain_and_key_ptr_free);
+            EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&chain_and_key,
+                    S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN, S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+            EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(config, chain_and_key));
+            EXPECT_SUCCESS(s2n_config_set_unsafe_for_testing(config));
+            EXPECT_SUCCESS(s2n_config_set_client_auth_type(config, S2N_CERT_AUTH_REQUIRED));
+
+            DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(client);
+            EXPECT_SUCCESS(s2n_connection_set_config(client, config));
+            client->security_policy_override = &security_policy;
+
+            DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server);
+            EXPECT_SUCCESS(s2n_connection_set_config(server, config));
+            server->security_policy_override = &security_policy;
+
+            DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+            EXPECT_SUCCESS(s2n_io_pair_init_non_blocking(&io_pair));
+            EXPECT_SUCCESS(s2n_connections_set_io_pair(client, server, &io_pair));
+
+            /* Until the CertificateVerify hash is known, the transcript stays buffered
+             * and only the PRF hash is set up.
+             */
+            EXPECT_OK(s2n_negotiate_test_server_and_client_until_message(server, client, CLIENT_CERT));
+            struct s2n_connection *conns[] = { client, server };
+            for (size_t i = 0; i < s2n_array_len(conns); i++) {
+                struct s2n_handshake_hashes *hashes = conns[i]->handshake.hashes;
+                if (conns[i]->mode == S2N_SERVER) {
+                    EXPECT_TRUE(hashes->transcript_buffered);
+                } else {
+                    /* The client chose its signature scheme when it received the CertificateRequest */
+                    EXPECT_FALSE(hashes->transcript_buffered);
+                }
+                EXPECT_TRUE(hashes->active_hash_algs[S2N_HASH_SHA384]);
+                EXPECT_EQUAL(hashes->active_hash_algs[S2N_HASH_SHA256], conns[i]->mode == S2N_CLIENT);
+                for (s2n_hash_algorithm alg = 0; alg < S2N_HASH_ALGS_COUNT; alg++) {
+                    if (alg != S2N_HASH_SHA256 && alg != S2N_HASH_SHA384) {
+                        EXPECT_FALSE(hashes->active_hash_algs[alg]);
+                        EXPECT_FALSE(s2n_handshake_is_hash_required(&conns[i]->handshake, alg));
+                    }
+                }
+            }
+
+            EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+            EXPECT_TRUE(IS_CLIENT_AUTH_HANDSHAKE(server));
+            EXPECT_EQUAL(server->handshake_params.client_cert_sig_scheme, &s2n_ecdsa_sha256);
+            EXPECT_EQUAL(server->secure->cipher_suite, &s2n_ecdhe_ecdsa_with_aes_256_gcm_sha384);
+
+            for (size_t i = 0; i < s2n_array_len(conns); i++) {
+                struct s2n_handshake_hashes *hashes = conns[i]->handshake.hashes;
+                EXPECT_FALSE(hashes->transcript_buffered);
+                for (s2n_hash_algorithm alg = 0; alg < S2N_HASH_ALGS_COUNT; alg++) {
+                    bool is_active = (alg == S2N_HASH_SHA256 || alg == S2N_HASH_SHA384);
+                    EXPECT_EQUAL(hashes->active_hash_algs[alg], is_active);
+                    EXPECT_EQUAL(hashes->transcript_hashes[alg] != NULL, is_active);
+                }
+            }
+        };
+    };
+
     /* Test s2n_handshake_hashes connection lifecycle */
     {
         uint8_t digest[SHA256_DIGEST_LENGTH] = { 0 };
@@ -0,0 +1,274 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_handshake_timings.h"
+
+#include "api/unstable/handshake_timings.h"
+#include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_connection.h"
+
+/* Every read of the clock returns a later time */
+static uint64_t test_clock = 0;
+
+static int s2n_test_monotonic_clock(void *ctx, uint64_t *nanoseconds)
+{
+    test_clock += 10;
+    *nanoseconds = test_clock;
+    return S2N_SUCCESS;
+}
+
+static struct s2n_async_pkey_op *test_pkey_op = NULL;
+
+static int s2n_test_async_pkey_cb(struct s2n_connection *conn, struct s2n_async_pkey_op *op)
+{
+    test_pkey_op = op;
+    return S2N_SUCCESS;
+}
+
+static int s2n_test_client_hello_cb(struct s2n_connection *conn, void *ctx)
+{
+    return S2N_SUCCESS;
+}
+
+static S2N_RESULT s2n_test_get_timings(struct s2n_connection *conn, struct s2n_handshake_timing *timings,
+        size_t *timings_len)
+{
+    *timings_len = S2N_HANDSHAKE_TIMINGS_MAX;
+    RESULT_GUARD_POSIX(s2n_connection_get_handshake_timings(conn, timings, timings_len));
+    return S2N_RESULT_OK;
+}
+
+static const struct s2n_handshake_timing *s2n_test_find_timing(const struct s2n_handshake_timing *timings,
+        size_t timings_len, s2n_handshake_timing_type type)
+{
+    for (size_t i = 0; i < timings_len; i++) {
+        if (timings[i].type == type) {
+            return &timings[i];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    DEFER_CLEANUP(struct s2n_cert_chain_and_key *chain_and_key = NULL, s2n_cert_chain_and_key_ptr_free);
+    EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&chain_and_key,
+            S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN, S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+
+    DEFER_CLEANUP(struct s2n_config *client_config = s2n_config_new(), s2n_config_ptr_free);
+    EXPECT_NOT_NULL(client_config);
+    EXPECT_SUCCESS(s2n_config_set_cipher_preferences(client_config, "default_tls13"));
+    EXPECT_SUCCESS(s2n_config_set_unsafe_for_testing(client_config));
+    EXPECT_SUCCESS(s2n_config_set_monotonic_clock(client_config, s2n_test_monotonic_clock, NULL));
+
+    /* Safety */
+    {
+        struct s2n_connection *conn = s2n_connection_new(S2N_SERVER);
+        EXPECT_NOT_NULL(conn);
+        size_t timings_len = 0;
+        struct s2n_handshake_timing timings[1] = { 0 };
+
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_handshake_timings(NULL, true), S2N_ERR_NULL);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_connection_get_handshake_timings(NULL, timings, &timings_len), S2N_ERR_NULL);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_connection_get_handshake_timings(conn, timings, NULL), S2N_ERR_NULL);
+
+        /* No timings before the handshake */
+        timings_len = 1;
+        EXPECT_SUCCESS(s2n_connection_get_handshake_timings(conn, timings, &timings_len));
+        EXPECT_EQUAL(timings_len, 0);
+
+        EXPECT_SUCCESS(s2n_connection_free(conn));
+    };
+
+    /* Timings are not recorded by default */
+    {
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, chain_and_key));
+
+        DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_SUCCESS(s2n_connection_set_config(client, client_config));
+        DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_SUCCESS(s2n_connection_set_config(server, server_config));
+
+        DEFER_CLEANUP(struct s2n_test_io_stuffer_pair io_pair = { 0 }, s2n_io_stuffer_pair_free);
+        EXPECT_OK(s2n_io_stuffer_pair_init(&io_pair));
+        EXPECT_OK(s2n_connections_set_io_stuffer_pair(client, server, &io_pair));
+        EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+
+        size_t timings_len = 0;
+        EXPECT_SUCCESS(s2n_connection_get_handshake_timings(server, NULL, &timings_len));
+        EXPECT_EQUAL(timings_len, 0);
+        EXPECT_NULL(server->handshake_timings);
+    };
+
+    /* Timings are recorded for every message and operation */
+    {
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, chain_and_key));
+        EXPECT_SUCCESS(s2n_config_set_monotonic_clock(server_config, s2n_test_monotonic_clock, NULL));
+        EXPECT_SUCCESS(s2n_config_set_handshake_timings(server_config, true));
+        EXPECT_SUCCESS(s2n_config_set_handshake_timings(client_config, true));
+
+        DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_SUCCESS(s2n_connection_set_config(client, client_config));
+        DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_SUCCESS(s2n_connection_set_config(server, server_config));
+
+        DEFER_CLEANUP(struct s2n_test_io_stuffer_pair io_pair = { 0 }, s2n_io_stuffer_pair_free);
+        EXPECT_OK(s2n_io_stuffer_pair_init(&io_pair));
+        EXPECT_OK(s2n_connections_set_io_stuffer_pair(client, server, &io_pair));
+        EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+
+        struct s2n_handshake_timing timings[S2N_HANDSHAKE_TIMINGS_MAX] = { 0 };
+        size_t timings_len = 0;
+
+        /* Server */
+        {
+            EXPECT_OK(s2n_test_get_timings(server, timings, &timings_len));
+            EXPECT_TRUE(timings_len > 0);
+
+            /* Each message starts when the previous message ends */
+            const struct s2n_handshake_timing *previous = NULL;
+            for (size_t i = 0; i < timings_len; i++) {
+                EXPECT_NOT_NULL(timings[i].message);
+                EXPECT_TRUE(timings[i].start_ns > 0);
+                EXPECT_TRUE(timings[i].end_ns > timings[i].start_ns);
+                if (timings[i].type != S2N_HANDSHAKE_TIMING_MESSAGE) {
+                    continue;
+                }
+                if (previous) {
+                    EXPECT_EQUAL(timings[i].start_ns, previous->end_ns);
+                }
+                previous = &timings[i];
+            }
+            EXPECT_STRING_EQUAL(timings[0].message, "CLIENT_HELLO");
+            EXPECT_STRING_EQUAL(previous->message, "CLIENT_FINISHED");
+
+            /* The server signs the CertificateVerify message */
+            const struct s2n_handshake_timing *pkey = s2n_test_find_timing(timings, timings_len,
+                    S2N_HANDSHAKE_TIMING_PKEY);
+            EXPECT_NOT_NULL(pkey);
+            EXPECT_STRING_EQUAL(pkey->message, "SERVER_CERT_VERIFY");
+            EXPECT_NULL(s2n_test_find_timing(timings, timings_len, S2N_HANDSHAKE_TIMING_CERT_VALIDATION));
+        };
+
+        /* Client */
+        {
+            EXPECT_OK(s2n_test_get_timings(client, timings, &timings_len));
+            EXPECT_STRING_EQUAL(timings[0].message, "CLIENT_HELLO");
+
+            /* The client validates the server's certificate */
+            const struct s2n_handshake_timing *validation = s2n_test_find_timing(timings, timings_len,
+                    S2N_HANDSHAKE_TIMING_CERT_VALIDATION);
+            EXPECT_NOT_NULL(validation);
+            EXPECT_STRING_EQUAL(validation->message, "SERVER_CERT");
+            EXPECT_TRUE(validation->end_ns > validation->start_ns);
+            EXPECT_NULL(s2n_test_find_timing(timings, timings_len, S2N_HANDSHAKE_TIMING_PKEY));
+        };
+
+        /* Query the number of timings */
+        {
+            size_t expected_len = server->handshake_timings->count;
+            EXPECT_SUCCESS(s2n_connection_get_handshake_timings(server, NULL, &timings_len));
+            EXPECT_EQUAL(timings_len, expected_len);
+
+            timings_len = expected_len - 1;
+            EXPECT_FAILURE_WITH_ERRNO(s2n_connection_get_handshake_timings(server, timings, &timings_len),
+                    S2N_ERR_INSUFFICIENT_MEM_SIZE);
+        };
+
+        /* Wiping the connection clears the timings */
+        {
+            EXPECT_SUCCESS(s2n_connection_wipe(server));
+            EXPECT_SUCCESS(s2n_connection_get_handshake_timings(server, NULL, &timings_len));
+            EXPECT_EQUAL(timings_len, 0);
+        };
+
+        EXPECT_SUCCESS(s2n_config_set_handshake_timings(client_config, false));
+    };
+
+    /* Async operations are timed until the handshake can continue */
+    {
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, chain_and_key));
+        EXPECT_SUCCESS(s2n_config_set_monotonic_clock(server_config, s2n_test_monotonic_clock, NULL));
+        EXPECT_SUCCESS(s2n_config_set_handshake_timings(server_config, true));
+        EXPECT_SUCCESS(s2n_config_set_async_pkey_callback(server_config, s2n_test_async_pkey_cb));
+        EXPECT_SUCCESS(s2n_config_set_client_hello_cb(server_config, s2n_test_client_hello_cb, NULL));
+        EXPECT_SUCCESS(s2n_config_set_client_hello_cb_mode(server_config, S2N_CLIENT_HELLO_CB_NONBLOCKING));
+
+        DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+        EXPECT_SUCCESS(s2n_connection_set_config(client, client_config));
+        DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_SUCCESS(s2n_connection_set_config(server, server_config));
+
+        DEFER_CLEANUP(struct s2n_test_io_stuffer_pair io_pair = { 0 }, s2n_io_stuffer_pair_free);
+        EXPECT_OK(s2n_io_stuffer_pair_init(&io_pair));
+        EXPECT_OK(s2n_connections_set_io_stuffer_pair(client, server, &io_pair));
+
+        struct s2n_handshake_timing timings[S2N_HANDSHAKE_TIMINGS_MAX] = { 0 };
+        size_t timings_len = 0;
+        const struct s2n_handshake_timing *timing = NULL;
+
+        /* The ClientHello callback is timed until it is marked done */
+        EXPECT_FAILURE_WITH_ERRNO(s2n_negotiate_test_server_and_client(server, client), S2N_ERR_ASYNC_BLOCKED);
+        EXPECT_OK(s2n_test_get_timings(server, timings, &timings_len));
+        timing = s2n_test_find_timing(timings, timings_len, S2N_HANDSHAKE_TIMING_CLIENT_HELLO_CB);
+        EXPECT_NOT_NULL(timing);
+        EXPECT_STRING_EQUAL(timing->message, "CLIENT_HELLO");
+        EXPECT_EQUAL(timing->end_ns, 0);
+
+        /* Retrying the handshake does not restart the timing */
+        EXPECT_FAILURE_WITH_ERRNO(s2n_negotiate_test_server_and_client(server, client), S2N_ERR_ASYNC_BLOCKED);
+        size_t blocked_timings_len = 0;
+        EXPECT_OK(s2n_test_get_timings(server, timings, &blocked_timings_len));
+        EXPECT_EQUAL(blocked_timings_len, timings_len);
+
+        EXPECT_SUCCESS(s2n_client_hello_cb_done(server));
+
+        /* The private key operation is timed until it is applied */
+        EXPECT_FAILURE_WITH_ERRNO(s2n_negotiate_test_server_and_client(server, client), S2N_ERR_ASYNC_BLOCKED);
+        EXPECT_NOT_NULL(test_pkey_op);
+        EXPECT_OK(s2n_test_get_timings(server, timings, &timings_len));
+        timing = s2n_test_find_timing(timings, timings_len, S2N_HANDSHAKE_TIMING_CLIENT_HELLO_CB);
+        EXPECT_NOT_NULL(timing);
+        EXPECT_TRUE(timing->end_ns > timing->start_ns);
+        timing = s2n_test_find_timing(timings, timings_len, S2N_HANDSHAKE_TIMING_PKEY);
+        EXPECT_NOT_NULL(timing);
+        EXPECT_EQUAL(timing->end_ns, 0);
+
+        EXPECT_SUCCESS(s2n_async_pkey_op_perform(test_pkey_op, s2n_cert_chain_and_key_get_private_key(chain_and_key)));
+        EXPECT_SUCCESS(s2n_async_pkey_op_apply(test_pkey_op, server));
+        EXPECT_SUCCESS(s2n_async_pkey_op_free(test_pkey_op));
+        test_pkey_op = NULL;
+
+        EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+        EXPECT_OK(s2n_test_get_timings(server, timings, &timings_len));
+        timing = s2n_test_find_timing(timings, timings_len, S2N_HANDSHAKE_TIMING_PKEY);
+        EXPECT_NOT_NULL(timing);
+        EXPECT_TRUE(timing->end_ns > timing->start_ns);
+    };
+
+    END_TEST();
+}
@@ -478,6 +478,64 @@ int main(int argc, char **argv)
     EXPECT_FAILURE(s2n_hkdf(&hmac, alg, &salt_blob, &in_key_blob, &info_blob, &error_out));
     EXPECT_FAILURE(s2n_hkdf(&hmac, alg, &salt_blob, &in_key_blob, &info_blob, &zero_out));
 
+    /* s2n_hkdf_expand_label_with_keyed_hmac matches s2n_hkdf_expand_label */
+    {
+        uint8_t secret_bytes[SHA384_DIGEST_LENGTH] = "secret";
+        struct s2n_blob secret = { 0 };
+        EXPECT_SUCCESS(s2n_blob_init(&secret, secret_bytes, sizeof(secret_bytes)));
+        uint8_t context_bytes[] = "context";
+        struct s2n_blob context = { 0 };
+        EXPECT_SUCCESS(s2n_blob_init(&context, context_bytes, sizeof(context_bytes)));
+        uint8_t label_bytes[][16] = { "c hs traffic", "s hs traffic", "finished" };
+
+        DEFER_CLEANUP(struct s2n_hmac_state keyed_hmac = { 0 }, s2n_hmac_free);
+        EXPECT_SUCCESS(s2n_hmac_new(&keyed_hmac));
+
+        const s2n_hmac_algorithm algs[] = { S2N_HMAC_SHA256, S2N_HMAC_SHA384 };
+        /* Include outputs that need more than one round */
+        const uint32_t output_sizes[] = { 1, SHA256_DIGEST_LENGTH, SHA384_DIGEST_LENGTH, 100 };
+        for (size_t alg_i = 0; alg_i < s2n_array_len(algs); alg_i++) {
+            if (!s2n_hkdf_supports_keyed_hmac()) {
+                struct s2n_blob label = { 0 };
+                EXPECT_SUCCESS(s2n_blob_init(&label, label_bytes[0], strlen((char *) label_bytes[0])));
+                s2n_stack_blob(output, SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH);
+                EXPECT_FAILURE_WITH_ERRNO(s2n_hkdf_expand_label_with_keyed_hmac(&keyed_hmac, algs[alg_i],
+                                                  &label, &context, &output),
+                        S2N_ERR_UNIMPLEMENTED);
+                continue;
+            }
+
+            /* The hmac is only keyed once for every label and output size */
+            EXPECT_SUCCESS(s2n_hmac_init(&keyed_hmac, algs[alg_i], secret.data, secret.size));
+            for (size_t label_i = 0; label_i < s2n_array_len(label_bytes); label_i++) {
+                struct s2n_blob label = { 0 };
+                EXPECT_SUCCESS(s2n_blob_init(&label, label_bytes[label_i], strlen((char *) label_bytes[label_i])));
+
+                for (size_t size_i = 0; size_i < s2n_array_len(output_sizes); size_i++) {
+                    uint8_t expected_bytes[100] = { 0 };
+                    struct s2n_blob expected = { 0 };
+                    EXPECT_SUCCESS(s2n_blob_init(&expected, expected_bytes, output_sizes[size_i]));
+                    EXPECT_SUCCESS(s2n_hkdf_expand_label(&hmac, algs[alg_i], &secret, &label, &context, &expected));
+
+                    uint8_t actual_bytes[100] = { 0 };
+                    struct s2n_blob actual = { 0 };
+                    EXPECT_SUCCESS(s2n_blob_init(&actual, actual_bytes, output_sizes[size_i]));
+                    EXPECT_SUCCESS(s2n_hkdf_expand_label_with_keyed_hmac(&keyed_hmac, algs[alg_i],
+                            &label, &context, &actual));
+                    EXPECT_BYTEARRAY_EQUAL(actual.data, expected.data, expected.size);
+                }
+            }
+
+            /* The hmac must be keyed for the requested algorithm */
+            struct s2n_blob label = { 0 };
+            EXPECT_SUCCESS(s2n_blob_init(&label, label_bytes[0], strlen((char *) label_bytes[0])));
+            s2n_stack_blob(output, SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH);
+            EXPECT_FAILURE_WITH_ERRNO(s2n_hkdf_expand_label_with_keyed_hmac(&keyed_hmac, S2N_HMAC_SHA1,
+                                              &label, &context, &output),
+                    S2N_ERR_SAFETY);
+        }
+    }
+
     EXPECT_SUCCESS(s2n_hmac_free(&hmac));
 
     END_TEST();
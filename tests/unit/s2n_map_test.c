@@ -19,6 +19,8 @@
 
 #include "api/s2n.h"
 #include "s2n_test.h"
+#include "utils/s2n_map_internal.h"
+#include "utils/s2n_random.h"
 
 #define TEST_VALUE_COUNT 8192
 
@@ -182,5 +184,66 @@ int main(int argc, char **argv)
 
     EXPECT_OK(s2n_map_free(map));
 
+    /* The load factor never exceeds 1/2 */
+    {
+        DEFER_CLEANUP(struct s2n_map *small = s2n_map_new_with_initial_capacity(1), s2n_map_free_pointer);
+        EXPECT_NOT_NULL(small);
+        val.data = (void *) valstr;
+        val.size = strlen(valstr) + 1;
+        for (int i = 0; i < 100; i++) {
+            EXPECT_SUCCESS(snprintf(keystr, sizeof(keystr), "%04x", i));
+            key.data = (void *) keystr;
+            key.size = strlen(keystr) + 1;
+            EXPECT_OK(s2n_map_add(small, &key, &val));
+            EXPECT_TRUE(small->size * 2 <= small->capacity);
+        }
+        EXPECT_OK(s2n_map_complete(small));
+
+        /* Lookup a missing key */
+        EXPECT_SUCCESS(snprintf(keystr, sizeof(keystr), "%04x", 100));
+        key.size = strlen(keystr) + 1;
+        key_found = true;
+        EXPECT_OK(s2n_map_lookup(small, &key, &val, &key_found));
+        EXPECT_FALSE(key_found);
+    };
+
+    /* s2n_map_free_pointer */
+    {
+        struct s2n_map *to_free = s2n_map_new();
+        EXPECT_NOT_NULL(to_free);
+        EXPECT_OK(s2n_map_free_pointer(&to_free));
+        EXPECT_NULL(to_free);
+        EXPECT_OK(s2n_map_free_pointer(&to_free));
+        EXPECT_ERROR_WITH_ERRNO(s2n_map_free_pointer(NULL), S2N_ERR_NULL);
+    };
+
+    /* Each map uses its own random hash key */
+    {
+        DEFER_CLEANUP(struct s2n_map *map_a = s2n_map_new(), s2n_map_free_pointer);
+        EXPECT_NOT_NULL(map_a);
+        DEFER_CLEANUP(struct s2n_map *map_b = s2n_map_new(), s2n_map_free_pointer);
+        EXPECT_NOT_NULL(map_b);
+
+        /* Empty maps don't need a key, so they don't use the private DRBG */
+        uint64_t bytes_used = 0;
+        EXPECT_OK(s2n_get_private_random_bytes_used(&bytes_used));
+        struct s2n_siphash_key empty_key = { 0 };
+        EXPECT_BYTEARRAY_EQUAL(&map_a->hash_key, &empty_key, sizeof(empty_key));
+        EXPECT_OK(s2n_map_complete(map_a));
+        EXPECT_OK(s2n_map_lookup(map_a, &key, &val, &key_found));
+        EXPECT_FALSE(key_found);
+        EXPECT_OK(s2n_map_unlock(map_a));
+        uint64_t bytes_used_after = 0;
+        EXPECT_OK(s2n_get_private_random_bytes_used(&bytes_used_after));
+        EXPECT_EQUAL(bytes_used, bytes_used_after);
+
+        EXPECT_OK(s2n_map_add(map_a, &key, &val));
+        EXPECT_OK(s2n_map_add(map_b, &key, &val));
+        EXPECT_BYTEARRAY_NOT_EQUAL(&map_a->hash_key, &map_b->hash_key, sizeof(map_a->hash_key));
+
+        EXPECT_OK(s2n_get_private_random_bytes_used(&bytes_used_after));
+        EXPECT_TRUE(bytes_used_after > bytes_used);
+    };
+
     END_TEST();
 }
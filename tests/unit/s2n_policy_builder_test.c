@@ -110,6 +110,34 @@ int main(int argc, char **argv)
 {
     BEGIN_TEST();
 
+    /* Test: s2n_security_policy_from_version */
+    {
+        /* Test: safety */
+        EXPECT_NULL_WITH_ERRNO(s2n_security_policy_from_version(NULL), S2N_ERR_INVALID_ARGUMENT);
+
+        /* Test: invalid and deprecated policy versions */
+        EXPECT_NULL_WITH_ERRNO(s2n_security_policy_from_version("not_a_real_policy_version"),
+                S2N_ERR_INVALID_SECURITY_POLICY);
+        EXPECT_NULL_WITH_ERRNO(s2n_security_policy_from_version(deprecated_security_policies[0]),
+                S2N_ERR_DEPRECATED_SECURITY_POLICY);
+
+        /* Test: a resolved policy can be reused for many configs */
+        {
+            const struct s2n_security_policy *expected = NULL;
+            EXPECT_SUCCESS(s2n_find_security_policy_from_version("20250721", &expected));
+
+            const struct s2n_security_policy *policy = s2n_security_policy_from_version("20250721");
+            EXPECT_EQUAL(policy, expected);
+
+            for (size_t i = 0; i < 10; i++) {
+                DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+                EXPECT_NOT_NULL(config);
+                EXPECT_SUCCESS(s2n_config_set_security_policy(config, policy));
+                EXPECT_EQUAL(config->security_policy, expected);
+            }
+        };
+    };
+
     /* Test: s2n_security_policy_builder_from_version / s2n_security_policy_builder_free */
     {
         /* Test: safety */
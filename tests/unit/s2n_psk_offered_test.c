@@ -33,7 +33,7 @@ static S2N_RESULT s2n_setup_encrypted_ticket(struct s2n_connection *conn, struct
     RESULT_ENSURE(key != NULL, S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
 
     /* Create a valid resumption psk identity */
-    RESULT_GUARD(s2n_resume_encrypt_session_ticket(conn, key, output));
+    RESULT_GUARD(s2n_resume_encrypt_session_ticket(conn, key->key_name, output));
     output->blob.size = s2n_stuffer_data_available(output);
 
     return S2N_RESULT_OK;
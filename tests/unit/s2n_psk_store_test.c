@@ -0,0 +1,404 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_psk_store.h"
+
+#include <pthread.h>
+
+#include "api/unstable/psk_store.h"
+#include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_tls13.h"
+
+#define TEST_PSK_COUNT       5000
+#define TEST_THREAD_COUNT    4
+#define TEST_THREAD_LOOKUPS  2000
+#define TEST_STABLE_PSKS     100
+#define TEST_IDENTITY_FORMAT "device-%08u"
+
+static S2N_RESULT s2n_test_identity(uint32_t n, uint8_t identity[20], uint16_t *identity_size)
+{
+    int written = snprintf((char *) identity, 20, TEST_IDENTITY_FORMAT, n);
+    RESULT_ENSURE_GT(written, 0);
+    *identity_size = written;
+    return S2N_RESULT_OK;
+}
+
+/* Every PSK has a different secret, so matches can be verified */
+static S2N_RESULT s2n_test_psk_set(struct s2n_psk *psk, uint32_t n)
+{
+    uint8_t identity[20] = { 0 };
+    uint16_t identity_size = 0;
+    RESULT_GUARD(s2n_test_identity(n, identity, &identity_size));
+
+    uint8_t secret[32] = { 0 };
+    memset(secret, 0xAB, sizeof(secret));
+    memcpy(secret, &n, sizeof(n));
+
+    RESULT_GUARD_POSIX(s2n_psk_set_identity(psk, identity, identity_size));
+    RESULT_GUARD_POSIX(s2n_psk_set_secret(psk, secret, sizeof(secret)));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_test_store_add(struct s2n_psk_store *store, uint32_t n)
+{
+    DEFER_CLEANUP(struct s2n_psk *psk = s2n_external_psk_new(), s2n_psk_free);
+    RESULT_ENSURE_REF(psk);
+    RESULT_GUARD(s2n_test_psk_set(psk, n));
+    RESULT_GUARD_POSIX(s2n_psk_store_add(store, psk));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_test_store_remove(struct s2n_psk_store *store, uint32_t n)
+{
+    uint8_t identity[20] = { 0 };
+    uint16_t identity_size = 0;
+    RESULT_GUARD(s2n_test_identity(n, identity, &identity_size));
+    RESULT_GUARD_POSIX(s2n_psk_store_remove(store, identity, identity_size));
+    return S2N_RESULT_OK;
+}
+
+/* Looks up a PSK with a new server connection, and reports whether it was found */
+static S2N_RESULT s2n_test_store_find(struct s2n_psk_store *store, uint32_t n, bool *found)
+{
+    DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+    RESULT_ENSURE_REF(conn);
+    RESULT_GUARD_POSIX(s2n_connection_set_psk_mode(conn, S2N_PSK_MODE_EXTERNAL));
+
+    uint8_t identity_data[20] = { 0 };
+    struct s2n_blob identity = { 0 };
+    uint16_t identity_size = 0;
+    RESULT_GUARD(s2n_test_identity(n, identity_data, &identity_size));
+    RESULT_GUARD_POSIX(s2n_blob_init(&identity, identity_data, identity_size));
+
+    struct s2n_psk *match = NULL;
+    RESULT_GUARD(s2n_psk_store_append_match(store, conn, &identity, &match));
+    *found = (match != NULL);
+    if (match == NULL) {
+        RESULT_ENSURE_EQ(conn->psk_params.psk_list.len, 0);
+        return S2N_RESULT_OK;
+    }
+
+    /* The connection gets its own copy of the PSK */
+    RESULT_ENSURE_EQ(conn->psk_params.psk_list.len, 1);
+    RESULT_ENSURE_EQ(match->type, S2N_PSK_TYPE_EXTERNAL);
+    RESULT_ENSURE_EQ(match->identity.size, identity_size);
+    RESULT_ENSURE(memcmp(match->identity.data, identity_data, identity_size) == 0, S2N_ERR_SAFETY);
+    RESULT_ENSURE_EQ(match->secret.size, 32);
+    RESULT_ENSURE(memcmp(match->secret.data, &n, sizeof(n)) == 0, S2N_ERR_SAFETY);
+    return S2N_RESULT_OK;
+}
+
+static bool s2n_test_is_stored(struct s2n_psk_store *store, uint32_t n)
+{
+    bool found = false;
+    EXPECT_OK(s2n_test_store_find(store, n, &found));
+    return found;
+}
+
+struct s2n_test_reader_args {
+    struct s2n_psk_store *store;
+    uint32_t found;
+};
+
+static void *s2n_test_reader(void *arg)
+{
+    struct s2n_test_reader_args *args = (struct s2n_test_reader_args *) arg;
+    for (uint32_t i = 0; i < TEST_THREAD_LOOKUPS; i++) {
+        if (s2n_test_is_stored(args->store, i % TEST_STABLE_PSKS)) {
+            args->found++;
+        }
+    }
+    return NULL;
+}
+
+static int s2n_test_select_cb(struct s2n_connection *conn, void *context, struct s2n_offered_psk_list *psk_list)
+{
+    struct s2n_offered_psk offered = { 0 };
+    while (s2n_offered_psk_list_has_next(psk_list)) {
+        POSIX_GUARD(s2n_offered_psk_list_next(psk_list, &offered));
+        if (s2n_offered_psk_list_choose_psk(psk_list, &offered) == S2N_SUCCESS) {
+            return S2N_SUCCESS;
+        }
+    }
+    return S2N_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    /* Test: s2n_psk_store_new / s2n_psk_store_free */
+    {
+        struct s2n_psk_store *store = s2n_psk_store_new();
+        EXPECT_NOT_NULL(store);
+        EXPECT_NOT_NULL(store->table);
+        EXPECT_EQUAL(store->psk_count, 0);
+        EXPECT_OK(s2n_test_store_add(store, 1));
+        EXPECT_SUCCESS(s2n_psk_store_free(&store));
+        EXPECT_NULL(store);
+
+        /* Safe to free twice */
+        EXPECT_SUCCESS(s2n_psk_store_free(&store));
+        EXPECT_FAILURE_WITH_ERRNO(s2n_psk_store_free(NULL), S2N_ERR_NULL);
+    };
+
+    /* Test: s2n_psk_store_add */
+    {
+        DEFER_CLEANUP(struct s2n_psk_store *store = s2n_psk_store_new(), s2n_psk_store_free);
+        EXPECT_NOT_NULL(store);
+        DEFER_CLEANUP(struct s2n_psk *psk = s2n_external_psk_new(), s2n_psk_free);
+        EXPECT_NOT_NULL(psk);
+
+        EXPECT_FAILURE_WITH_ERRNO(s2n_psk_store_add(NULL, psk), S2N_ERR_NULL);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_psk_store_add(store, NULL), S2N_ERR_NULL);
+
+        /* The PSK must be complete */
+        uint8_t identity[] = "identity";
+        uint8_t secret[] = "secret";
+        EXPECT_FAILURE_WITH_ERRNO(s2n_psk_store_add(store, psk), S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_SUCCESS(s2n_psk_set_identity(psk, identity, sizeof(identity)));
+        EXPECT_FAILURE_WITH_ERRNO(s2n_psk_store_add(store, psk), S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_SUCCESS(s2n_psk_set_secret(psk, secret, sizeof(secret)));
+
+        /* Only external PSKs can be stored */
+        psk->type = S2N_PSK_TYPE_RESUMPTION;
+        EXPECT_FAILURE_WITH_ERRNO(s2n_psk_store_add(store, psk), S2N_ERR_INVALID_ARGUMENT);
+        psk->type = S2N_PSK_TYPE_EXTERNAL;
+
+        EXPECT_SUCCESS(s2n_psk_store_add(store, psk));
+        EXPECT_EQUAL(store->psk_count, 1);
+
+        /* Identities must be unique */
+        EXPECT_FAILURE_WITH_ERRNO(s2n_psk_store_add(store, psk), S2N_ERR_DUPLICATE_PSK_IDENTITIES);
+        EXPECT_EQUAL(store->psk_count, 1);
+
+        /* The store keeps its own copy */
+        EXPECT_SUCCESS(s2n_psk_free(&psk));
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+        EXPECT_SUCCESS(s2n_connection_set_psk_mode(conn, S2N_PSK_MODE_EXTERNAL));
+        struct s2n_blob identity_blob = { 0 };
+        EXPECT_SUCCESS(s2n_blob_init(&identity_blob, identity, sizeof(identity)));
+        struct s2n_psk *match = NULL;
+        EXPECT_OK(s2n_psk_store_append_match(store, conn, &identity_blob, &match));
+        EXPECT_NOT_NULL(match);
+        EXPECT_BYTEARRAY_EQUAL(match->secret.data, secret, sizeof(secret));
+    };
+
+    /* Test: s2n_psk_store_remove */
+    {
+        DEFER_CLEANUP(struct s2n_psk_store *store = s2n_psk_store_new(), s2n_psk_store_free);
+        EXPECT_NOT_NULL(store);
+
+        uint8_t identity[] = "identity";
+        EXPECT_FAILURE_WITH_ERRNO(s2n_psk_store_remove(NULL, identity, sizeof(identity)), S2N_ERR_NULL);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_psk_store_remove(store, NULL, sizeof(identity)), S2N_ERR_NULL);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_psk_store_remove(store, identity, sizeof(identity)), S2N_ERR_INVALID_ARGUMENT);
+
+        /* Fewer PSKs than buckets, so some share buckets without the table growing */
+        const uint32_t count = 12;
+        for (uint32_t i = 0; i < count; i++) {
+            EXPECT_OK(s2n_test_store_add(store, i));
+        }
+        EXPECT_EQUAL(store->table->bucket_mask + 1, 16);
+
+        /* Remove PSKs from every position in their buckets */
+        for (uint32_t removed = 0; removed < count; removed++) {
+            EXPECT_OK(s2n_test_store_remove(store, removed));
+            EXPECT_EQUAL(store->psk_count, count - removed - 1);
+            EXPECT_ERROR_WITH_ERRNO(s2n_test_store_remove(store, removed), S2N_ERR_INVALID_ARGUMENT);
+            for (uint32_t i = 0; i < count; i++) {
+                EXPECT_EQUAL(s2n_test_is_stored(store, i), i > removed);
+            }
+        }
+
+        /* A removed identity can be added again */
+        EXPECT_OK(s2n_test_store_add(store, 0));
+        EXPECT_TRUE(s2n_test_is_stored(store, 0));
+    };
+
+    /* Test: the store grows to keep lookups constant time */
+    {
+        DEFER_CLEANUP(struct s2n_psk_store *store = s2n_psk_store_new(), s2n_psk_store_free);
+        EXPECT_NOT_NULL(store);
+
+        for (uint32_t i = 0; i < TEST_PSK_COUNT; i++) {
+            EXPECT_OK(s2n_test_store_add(store, i));
+            EXPECT_TRUE(store->psk_count <= store->table->bucket_mask + 1);
+        }
+        EXPECT_EQUAL(store->psk_count, TEST_PSK_COUNT);
+        EXPECT_EQUAL(store->table->bucket_mask + 1, 8192);
+
+        /* Chains stay short */
+        uint32_t longest_chain = 0;
+        uint32_t total = 0;
+        for (size_t i = 0; i <= store->table->bucket_mask; i++) {
+            uint32_t chain = 0;
+            for (struct s2n_psk_store_entry *entry = store->table->buckets[i]; entry; entry = entry->next) {
+                chain++;
+            }
+            longest_chain = MAX(longest_chain, chain);
+            total += chain;
+        }
+        EXPECT_EQUAL(total, TEST_PSK_COUNT);
+        EXPECT_TRUE(longest_chain < 16);
+
+        for (uint32_t i = 0; i < TEST_PSK_COUNT; i++) {
+            EXPECT_TRUE(s2n_test_is_stored(store, i));
+        }
+        EXPECT_FALSE(s2n_test_is_stored(store, TEST_PSK_COUNT));
+
+        for (uint32_t i = 0; i < TEST_PSK_COUNT; i += 2) {
+            EXPECT_OK(s2n_test_store_remove(store, i));
+        }
+        for (uint32_t i = 0; i < TEST_PSK_COUNT; i++) {
+            EXPECT_EQUAL(s2n_test_is_stored(store, i), i % 2 == 1);
+        }
+    };
+
+    /* Test: lookups are consistent while the store is updated */
+    {
+        DEFER_CLEANUP(struct s2n_psk_store *store = s2n_psk_store_new(), s2n_psk_store_free);
+        EXPECT_NOT_NULL(store);
+        for (uint32_t i = 0; i < TEST_STABLE_PSKS; i++) {
+            EXPECT_OK(s2n_test_store_add(store, i));
+        }
+
+        pthread_t threads[TEST_THREAD_COUNT] = { 0 };
+        struct s2n_test_reader_args args[TEST_THREAD_COUNT] = { 0 };
+        for (size_t i = 0; i < TEST_THREAD_COUNT; i++) {
+            args[i].store = store;
+            EXPECT_EQUAL(pthread_create(&threads[i], NULL, s2n_test_reader, &args[i]), 0);
+        }
+
+        /* Grow the table and churn the buckets shared with the stable PSKs */
+        for (uint32_t i = TEST_STABLE_PSKS; i < TEST_STABLE_PSKS + TEST_PSK_COUNT; i++) {
+            EXPECT_OK(s2n_test_store_add(store, i));
+            if (i % 3 == 0) {
+                EXPECT_OK(s2n_test_store_remove(store, i));
+            }
+        }
+
+        for (size_t i = 0; i < TEST_THREAD_COUNT; i++) {
+            EXPECT_EQUAL(pthread_join(threads[i], NULL), 0);
+            EXPECT_EQUAL(args[i].found, TEST_THREAD_LOOKUPS);
+        }
+    };
+
+    /* Test: s2n_config_add_psk_store */
+    {
+        DEFER_CLEANUP(struct s2n_psk_store *store = s2n_psk_store_new(), s2n_psk_store_free);
+        EXPECT_NOT_NULL(store);
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_add_psk_store(NULL, store), S2N_ERR_NULL);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_add_psk_store(config, NULL), S2N_ERR_NULL);
+
+        EXPECT_EQUAL(config->psk_mode, S2N_PSK_MODE_RESUMPTION);
+        EXPECT_SUCCESS(s2n_config_add_psk_store(config, store));
+        EXPECT_EQUAL(config->psk_store, store);
+        EXPECT_EQUAL(config->psk_mode, S2N_PSK_MODE_EXTERNAL);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_add_psk_store(config, store), S2N_ERR_INVALID_STATE);
+    };
+
+    if (!s2n_is_tls13_fully_supported()) {
+        END_TEST();
+    }
+
+    /* Test: handshakes choose PSKs from the store */
+    {
+        DEFER_CLEANUP(struct s2n_psk_store *store = s2n_psk_store_new(), s2n_psk_store_free);
+        EXPECT_NOT_NULL(store);
+        for (uint32_t i = 0; i < TEST_PSK_COUNT; i++) {
+            EXPECT_OK(s2n_test_store_add(store, i));
+        }
+
+        DEFER_CLEANUP(struct s2n_cert_chain_and_key *chain_and_key = NULL, s2n_cert_chain_and_key_ptr_free);
+        EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&chain_and_key,
+                S2N_DEFAULT_ECDSA_TEST_CERT_CHAIN, S2N_DEFAULT_ECDSA_TEST_PRIVATE_KEY));
+
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, chain_and_key));
+        EXPECT_SUCCESS(s2n_config_add_psk_store(server_config, store));
+
+        DEFER_CLEANUP(struct s2n_config *callback_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(callback_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(callback_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(callback_config, chain_and_key));
+        EXPECT_SUCCESS(s2n_config_add_psk_store(callback_config, store));
+        EXPECT_SUCCESS(s2n_config_set_psk_selection_callback(callback_config, s2n_test_select_cb, NULL));
+
+        DEFER_CLEANUP(struct s2n_config *client_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(client_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(client_config, "default_tls13"));
+        EXPECT_SUCCESS(s2n_config_disable_x509_verification(client_config));
+
+        struct {
+            uint32_t offered[2];
+            uint8_t offered_count;
+            bool expect_psk;
+            uint16_t expected_wire_index;
+        } test_cases[] = {
+            { .offered = { 42 }, .offered_count = 1, .expect_psk = true, .expected_wire_index = 0 },
+            { .offered = { TEST_PSK_COUNT + 1, 4999 }, .offered_count = 2, .expect_psk = true, .expected_wire_index = 1 },
+            { .offered = { 7, 8 }, .offered_count = 2, .expect_psk = true, .expected_wire_index = 0 },
+            { .offered = { TEST_PSK_COUNT + 1 }, .offered_count = 1, .expect_psk = false },
+        };
+
+        struct s2n_config *server_configs[] = { server_config, callback_config };
+        for (size_t config_i = 0; config_i < s2n_array_len(server_configs); config_i++) {
+            for (size_t i = 0; i < s2n_array_len(test_cases); i++) {
+                DEFER_CLEANUP(struct s2n_connection *client = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+                DEFER_CLEANUP(struct s2n_connection *server = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+                EXPECT_NOT_NULL(client);
+                EXPECT_NOT_NULL(server);
+                EXPECT_SUCCESS(s2n_connection_set_config(client, client_config));
+                EXPECT_SUCCESS(s2n_connection_set_config(server, server_configs[config_i]));
+
+                /* Offer PSKs with the same identities and secrets as the stored PSKs */
+                for (size_t j = 0; j < test_cases[i].offered_count; j++) {
+                    DEFER_CLEANUP(struct s2n_psk *psk = s2n_external_psk_new(), s2n_psk_free);
+                    EXPECT_NOT_NULL(psk);
+                    EXPECT_OK(s2n_test_psk_set(psk, test_cases[i].offered[j]));
+                    EXPECT_SUCCESS(s2n_connection_append_psk(client, psk));
+                }
+
+                DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+                EXPECT_SUCCESS(s2n_io_pair_init_non_blocking(&io_pair));
+                EXPECT_SUCCESS(s2n_connections_set_io_pair(client, server, &io_pair));
+                EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server, client));
+
+                if (test_cases[i].expect_psk) {
+                    EXPECT_NOT_NULL(server->psk_params.chosen_psk);
+                    EXPECT_EQUAL(server->psk_params.chosen_psk_wire_index, test_cases[i].expected_wire_index);
+                    EXPECT_EQUAL(server->psk_params.psk_list.len, 1);
+                    EXPECT_TRUE(IS_NEGOTIATED(server));
+                    EXPECT_FALSE(server->handshake.handshake_type & FULL_HANDSHAKE);
+                } else {
+                    EXPECT_NULL(server->psk_params.chosen_psk);
+                    EXPECT_TRUE(server->handshake.handshake_type & FULL_HANDSHAKE);
+                }
+            }
+        }
+    };
+
+    END_TEST();
+}
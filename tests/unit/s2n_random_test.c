@@ -44,6 +44,8 @@
 
 #define RANDOM_GENERATE_DATA_SIZE     100
 #define MAX_RANDOM_GENERATE_DATA_SIZE 5120
+/* The size of an explicit IV, a typical request served from the public pool */
+#define SMALL_RANDOM_REQUEST_SIZE 16
 
 #define NUMBER_OF_BOUNDS               10
 #define NUMBER_OF_RANGE_FUNCTION_CALLS 200
@@ -563,6 +565,62 @@ static S2N_RESULT s2n_random_implementation_test(void)
     return S2N_RESULT_OK;
 }
 
+/* Fills the blob with requests small enough to be served from the public pool */
+static S2N_RESULT s2n_get_public_random_data_in_small_requests(struct s2n_blob *blob)
+{
+    for (uint32_t offset = 0; offset < blob->size; offset += SMALL_RANDOM_REQUEST_SIZE) {
+        struct s2n_blob slice = { 0 };
+        RESULT_GUARD_POSIX(s2n_blob_slice(blob, &slice, offset, MIN(SMALL_RANDOM_REQUEST_SIZE, blob->size - offset)));
+        RESULT_GUARD(s2n_get_public_random_data(&slice));
+    }
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_public_random_pool_test(void)
+{
+    /* The libcrypto random implementation is used in FIPS mode, without the pool */
+    if (s2n_is_in_fips_mode()) {
+        return S2N_RESULT_OK;
+    }
+
+    uint8_t data[S2N_PUBLIC_RANDOM_POOL_MAX_REQUEST + 1] = { 0 };
+    struct s2n_blob blob = { 0 };
+    EXPECT_SUCCESS(s2n_blob_init(&blob, data, 1));
+
+    /* Start with an empty pool */
+    EXPECT_OK(s2n_rand_cleanup_thread());
+
+    /* The first small request fills the pool */
+    EXPECT_OK(s2n_get_public_random_data(&blob));
+    uint64_t filled_bytes_used = 0;
+    EXPECT_OK(s2n_get_public_random_bytes_used(&filled_bytes_used));
+    EXPECT_TRUE(filled_bytes_used >= S2N_PUBLIC_RANDOM_POOL_SIZE);
+
+    /* Small requests are served from the pool until it runs out */
+    blob.size = S2N_PUBLIC_RANDOM_POOL_MAX_REQUEST;
+    for (size_t i = 0; i < (S2N_PUBLIC_RANDOM_POOL_SIZE / S2N_PUBLIC_RANDOM_POOL_MAX_REQUEST) - 1; i++) {
+        EXPECT_OK(s2n_get_public_random_data(&blob));
+        uint64_t bytes_used = 0;
+        EXPECT_OK(s2n_get_public_random_bytes_used(&bytes_used));
+        EXPECT_EQUAL(bytes_used, filled_bytes_used);
+    }
+
+    /* The pool is refilled when it can't serve a request */
+    EXPECT_OK(s2n_get_public_random_data(&blob));
+    uint64_t refilled_bytes_used = 0;
+    EXPECT_OK(s2n_get_public_random_bytes_used(&refilled_bytes_used));
+    EXPECT_TRUE(refilled_bytes_used > filled_bytes_used);
+
+    /* Larger requests use the DRBG directly */
+    blob.size = S2N_PUBLIC_RANDOM_POOL_MAX_REQUEST + 1;
+    EXPECT_OK(s2n_get_public_random_data(&blob));
+    uint64_t bytes_used = 0;
+    EXPECT_OK(s2n_get_public_random_bytes_used(&bytes_used));
+    EXPECT_TRUE(bytes_used > refilled_bytes_used);
+
+    return S2N_RESULT_OK;
+}
+
 /* A collection of tests executed for each test dimension */
 static int s2n_common_tests(struct random_test_case *test_case)
 {
@@ -593,6 +651,10 @@ static int s2n_common_tests(struct random_test_case *test_case)
     EXPECT_OK(s2n_fork_test(s2n_get_public_random_data, s2n_get_private_random_data));
     EXPECT_OK(s2n_fork_test(s2n_get_private_random_data, s2n_get_public_random_data));
 
+    /* Verify that data buffered in the public pool is not reused across threads or forks */
+    EXPECT_OK(s2n_thread_test(s2n_get_public_random_data_in_small_requests, s2n_get_public_random_data_in_small_requests));
+    EXPECT_OK(s2n_fork_test(s2n_get_public_random_data_in_small_requests, s2n_get_public_random_data_in_small_requests));
+
     /* Some fork detection mechanisms can also detect forks through clone().
      * s2n_is_X_supported() only determines whether the system runtime
      * environment supports fork detection method X. The function is not aware
@@ -615,6 +677,9 @@ static int s2n_common_tests(struct random_test_case *test_case)
     /* Test that the correct random implementation is used */
     EXPECT_OK(s2n_random_implementation_test());
 
+    /* Test that small public requests are served from the pool */
+    EXPECT_OK(s2n_public_random_pool_test());
+
     /* Verify that there are no trivially observable patterns in the output */
     EXPECT_OK(s2n_basic_pattern_tests(s2n_get_public_random_data));
     EXPECT_OK(s2n_basic_pattern_tests(s2n_get_private_random_data));
@@ -1318,7 +1318,7 @@ int main(int argc, char **argv)
             EXPECT_NOT_NULL(key);
 
             struct s2n_stuffer output = { 0 };
-            EXPECT_ERROR_WITH_ERRNO(s2n_resume_encrypt_session_ticket(conn, key, &output), S2N_ERR_STUFFER_IS_FULL);
+            EXPECT_ERROR_WITH_ERRNO(s2n_resume_encrypt_session_ticket(conn, key->key_name, &output), S2N_ERR_STUFFER_IS_FULL);
         }
 
         /* Check encrypted data can be decrypted correctly for TLS12 */
@@ -1343,7 +1343,7 @@ int main(int argc, char **argv)
             struct s2n_ticket_key *key = s2n_get_ticket_encrypt_decrypt_key(conn->config);
             EXPECT_NOT_NULL(key);
 
-            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key, &conn->client_ticket_to_decrypt));
+            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key->key_name, &conn->client_ticket_to_decrypt));
             EXPECT_NOT_EQUAL(s2n_stuffer_data_available(&conn->client_ticket_to_decrypt), 0);
 
             /* Wiping the master secret to prove that the decryption function actually writes the master secret */
@@ -1383,7 +1383,7 @@ int main(int argc, char **argv)
             struct s2n_ticket_key *key = s2n_get_ticket_encrypt_decrypt_key(conn->config);
             EXPECT_NOT_NULL(key);
 
-            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key, &output));
+            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key->key_name, &output));
             EXPECT_OK(s2n_resume_decrypt_session(conn, &output));
 
             EXPECT_EQUAL(s2n_stuffer_data_available(&output), 0);
@@ -1422,7 +1422,7 @@ int main(int argc, char **argv)
             struct s2n_ticket_key *key = s2n_get_ticket_encrypt_decrypt_key(conn->config);
             EXPECT_NOT_NULL(key);
 
-            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key, &output));
+            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key->key_name, &output));
             EXPECT_OK(s2n_resume_decrypt_session(conn, &output));
 
             EXPECT_EQUAL(s2n_stuffer_data_available(&output), 0);
@@ -1453,7 +1453,7 @@ int main(int argc, char **argv)
             struct s2n_ticket_key *key = s2n_get_ticket_encrypt_decrypt_key(conn->config);
             EXPECT_NOT_NULL(key);
 
-            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key, &conn->client_ticket_to_decrypt));
+            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key->key_name, &conn->client_ticket_to_decrypt));
             EXPECT_NOT_EQUAL(s2n_stuffer_data_available(&conn->client_ticket_to_decrypt), 0);
 
             /* Modify the version number of the ticket */
@@ -1488,7 +1488,7 @@ int main(int argc, char **argv)
 
             DEFER_CLEANUP(struct s2n_stuffer valid_ticket = { 0 }, s2n_stuffer_free);
             EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&valid_ticket, 0));
-            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key, &valid_ticket));
+            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key->key_name, &valid_ticket));
             uint32_t ticket_size = s2n_stuffer_data_available(&valid_ticket);
 
             /* Copy ticket so that we don't modify the original ticket */
@@ -1539,7 +1539,7 @@ int main(int argc, char **argv)
             DEFER_CLEANUP(struct s2n_stuffer output = { 0 }, s2n_stuffer_free);
             EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&output, 0));
 
-            EXPECT_ERROR_WITH_ERRNO(s2n_resume_encrypt_session_ticket(conn, key, &output), S2N_ERR_KEY_CHECK);
+            EXPECT_ERROR_WITH_ERRNO(s2n_resume_encrypt_session_ticket(conn, key->key_name, &output), S2N_ERR_KEY_CHECK);
         };
 
         /* Check session ticket is correct when using early data with TLS1.3. */
@@ -1569,7 +1569,7 @@ int main(int argc, char **argv)
             struct s2n_ticket_key *key = s2n_get_ticket_encrypt_decrypt_key(conn->config);
             EXPECT_NOT_NULL(key);
 
-            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key, &output));
+            EXPECT_OK(s2n_resume_encrypt_session_ticket(conn, key->key_name, &output));
             EXPECT_OK(s2n_resume_decrypt_session(conn, &output));
 
             EXPECT_EQUAL(s2n_stuffer_data_available(&output), 0);
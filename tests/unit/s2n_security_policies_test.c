@@ -15,6 +15,9 @@
 
 #include "tls/s2n_security_policies.h"
 
+#include <ctype.h>
+#include <strings.h>
+
 #include "crypto/s2n_pq.h"
 #include "crypto/s2n_rsa_pss.h"
 #include "s2n_test.h"
@@ -210,6 +213,46 @@ int main(int argc, char **argv)
         EXPECT_FAILURE_WITH_ERRNO(s2n_find_security_policy_from_version("PQ-SIKE-TEST-TLS-1-0-2020-02", &security_policy), S2N_ERR_DEPRECATED_SECURITY_POLICY);
     }
 
+    /* Test security policy lookup by version string */
+    {
+        /* Every policy can be found, regardless of case */
+        for (size_t i = 0; security_policy_selection[i].version != NULL; i++) {
+            const char *version = security_policy_selection[i].version;
+
+            /* If multiple policies share a name, the first one is used */
+            const struct s2n_security_policy *expected = NULL;
+            for (size_t j = 0; j <= i; j++) {
+                if (strcasecmp(version, security_policy_selection[j].version) == 0) {
+                    expected = security_policy_selection[j].security_policy;
+                    break;
+                }
+            }
+            EXPECT_NOT_NULL(expected);
+
+            char upper[100] = { 0 };
+            char lower[100] = { 0 };
+            EXPECT_TRUE(strlen(version) < sizeof(upper));
+            for (size_t j = 0; version[j] != '\0'; j++) {
+                upper[j] = toupper((unsigned char) version[j]);
+                lower[j] = tolower((unsigned char) version[j]);
+            }
+
+            const char *versions[] = { version, upper, lower };
+            for (size_t j = 0; j < s2n_array_len(versions); j++) {
+                security_policy = NULL;
+                EXPECT_SUCCESS(s2n_find_security_policy_from_version(versions[j], &security_policy));
+                EXPECT_EQUAL(security_policy, expected);
+            }
+        }
+
+        /* Unknown policies can't be found */
+        const char *unknown_versions[] = { "", "defaul", "default_", "default ", "not_a_real_policy" };
+        for (size_t i = 0; i < s2n_array_len(unknown_versions); i++) {
+            EXPECT_FAILURE_WITH_ERRNO(s2n_find_security_policy_from_version(unknown_versions[i], &security_policy),
+                    S2N_ERR_INVALID_SECURITY_POLICY);
+        }
+    };
+
     /* Test common known good cipher suites for expected configuration */
     {
         EXPECT_SUCCESS(s2n_find_security_policy_from_version("default", &security_policy));
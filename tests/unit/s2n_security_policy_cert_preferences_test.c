@@ -284,7 +284,7 @@ int main(int argc, char **argv)
             /* assert that no certs were loaded */
             uint32_t domain_certs = 0;
             EXPECT_EQUAL(s2n_config_get_num_default_certs(config), 0);
-            EXPECT_OK(s2n_map_size(config->domain_name_to_cert_map, &domain_certs));
+            EXPECT_OK(s2n_sni_trie_size(config->domain_name_to_cert_trie, &domain_certs));
             EXPECT_EQUAL(domain_certs, 0);
             EXPECT_EQUAL(s2n_config_get_num_default_certs(config), 0);
         };
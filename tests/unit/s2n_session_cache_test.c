@@ -0,0 +1,347 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_session_cache.h"
+
+#include <pthread.h>
+
+#include "api/unstable/session_cache.h"
+#include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+
+#define S2N_TEST_NOW           ((uint64_t) 1000 * ONE_SEC_IN_NANOS)
+#define S2N_TEST_TTL           ((uint64_t) 60 * ONE_SEC_IN_NANOS)
+#define S2N_TEST_THREADS       4
+#define S2N_TEST_THREAD_STORES 1000
+
+/* Checks that no copy of a session ID is left anywhere in the cache's memory */
+static bool s2n_test_cache_contains_id(struct s2n_session_cache *cache, uint32_t n)
+{
+    uint8_t id[S2N_TLS_SESSION_ID_MAX_LEN] = { 0 };
+    EXPECT_OK(s2n_session_cache_test_id(n, id));
+    struct s2n_blob *mem = &cache->region_mem;
+    for (uint32_t offset = 0; offset + sizeof(id) <= mem->size; offset++) {
+        if (memcmp(mem->data + offset, id, sizeof(id)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int s2n_test_wall_clock(void *ctx, uint64_t *nanoseconds)
+{
+    *nanoseconds = *(uint64_t *) ctx;
+    return S2N_SUCCESS;
+}
+
+static void *s2n_test_cache_thread(void *arg)
+{
+    struct s2n_session_cache *cache = (struct s2n_session_cache *) arg;
+    static uint32_t next_thread = 0;
+    uint32_t base = __atomic_fetch_add(&next_thread, 1, __ATOMIC_RELAXED) * S2N_TEST_THREAD_STORES;
+
+    for (uint32_t i = base; i < base + S2N_TEST_THREAD_STORES; i++) {
+        if (s2n_result_is_error(s2n_session_cache_test_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, i))
+                || s2n_result_is_error(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, i))) {
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    /* s2n_config_enable_builtin_session_cache */
+    {
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_enable_builtin_session_cache(NULL, 1, 1), S2N_ERR_NULL);
+
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+
+        uint64_t hits = 0, misses = 0, evictions = 0;
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_get_builtin_session_cache_stats(config, &hits, &misses, &evictions),
+                S2N_ERR_INVALID_STATE);
+
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_enable_builtin_session_cache(config, 0, 1), S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_enable_builtin_session_cache(config, 1, 0), S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_enable_builtin_session_cache(config, 4, 5), S2N_ERR_INVALID_ARGUMENT);
+        EXPECT_NULL(config->builtin_session_cache);
+        EXPECT_FALSE(config->use_session_cache);
+
+        EXPECT_SUCCESS(s2n_config_enable_builtin_session_cache(config, 100, 8));
+        EXPECT_NOT_NULL(config->builtin_session_cache);
+        EXPECT_TRUE(config->use_session_cache);
+        EXPECT_EQUAL(config->cache_store, s2n_session_cache_store_cb);
+        EXPECT_EQUAL(config->cache_retrieve, s2n_session_cache_retrieve_cb);
+        EXPECT_EQUAL(config->cache_delete, s2n_session_cache_delete_cb);
+        EXPECT_EQUAL(config->cache_store_data, config->builtin_session_cache);
+
+        /* The capacity is spread evenly across the shards */
+        struct s2n_session_cache *cache = config->builtin_session_cache;
+        EXPECT_EQUAL(cache->shard_count, 8);
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < cache->shard_count; i++) {
+            EXPECT_TRUE(cache->shards[i].capacity == 12 || cache->shards[i].capacity == 13);
+            total += cache->shards[i].capacity;
+        }
+        EXPECT_EQUAL(total, 100);
+
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_enable_builtin_session_cache(config, 100, 8), S2N_ERR_INVALID_STATE);
+
+        EXPECT_SUCCESS(s2n_config_get_builtin_session_cache_stats(config, &hits, &misses, &evictions));
+        EXPECT_EQUAL(hits, 0);
+        EXPECT_EQUAL(misses, 0);
+        EXPECT_EQUAL(evictions, 0);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_get_builtin_session_cache_stats(config, NULL, &misses, &evictions),
+                S2N_ERR_NULL);
+    };
+
+    /* Store, retrieve and delete */
+    {
+        DEFER_CLEANUP(struct s2n_session_cache *cache = NULL, s2n_session_cache_ptr_free);
+        EXPECT_OK(s2n_session_cache_new(16, 2, &cache));
+
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 1), S2N_ERR_SESSION_ID_NOT_FOUND);
+        EXPECT_OK(s2n_session_cache_test_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, 1));
+        EXPECT_OK(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 1));
+        EXPECT_OK(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 1));
+
+        /* Storing the same ID again replaces the session */
+        uint8_t id[S2N_TLS_SESSION_ID_MAX_LEN] = { 0 };
+        EXPECT_OK(s2n_session_cache_test_id(1, id));
+        uint8_t value[S2N_TLS12_TICKET_SIZE_IN_BYTES] = { 0 };
+        EXPECT_OK(s2n_session_cache_test_value(2, value));
+        EXPECT_OK(s2n_session_cache_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, id, sizeof(id), value, sizeof(value)));
+        uint8_t retrieved[S2N_TLS12_TICKET_SIZE_IN_BYTES] = { 0 };
+        uint64_t retrieved_size = sizeof(retrieved);
+        EXPECT_OK(s2n_session_cache_retrieve(cache, S2N_TEST_NOW, id, sizeof(id), retrieved, &retrieved_size));
+        EXPECT_BYTEARRAY_EQUAL(retrieved, value, sizeof(value));
+
+        /* The output buffer must fit the session */
+        retrieved_size = sizeof(retrieved) - 1;
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_retrieve(cache, S2N_TEST_NOW, id, sizeof(id), retrieved, &retrieved_size),
+                S2N_ERR_SIZE_MISMATCH);
+
+        /* Session IDs of different lengths are different sessions */
+        retrieved_size = sizeof(retrieved);
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_retrieve(cache, S2N_TEST_NOW, id, sizeof(id) - 1, retrieved, &retrieved_size),
+                S2N_ERR_SESSION_ID_NOT_FOUND);
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, id, 0, value, sizeof(value)),
+                S2N_ERR_SESSION_ID_TOO_SHORT);
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, id, sizeof(id), value,
+                                        S2N_TLS12_TICKET_SIZE_IN_BYTES + 1),
+                S2N_ERR_SIZE_MISMATCH);
+
+        EXPECT_TRUE(s2n_test_cache_contains_id(cache, 1));
+        EXPECT_OK(s2n_session_cache_delete(cache, id, sizeof(id)));
+        EXPECT_FALSE(s2n_test_cache_contains_id(cache, 1));
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 1), S2N_ERR_SESSION_ID_NOT_FOUND);
+
+        /* Deleting a missing session is not an error */
+        EXPECT_OK(s2n_session_cache_delete(cache, id, sizeof(id)));
+
+        uint32_t hits = 0, misses = 0;
+        for (uint32_t i = 0; i < cache->shard_count; i++) {
+            hits += cache->shards[i].state->hits;
+            misses += cache->shards[i].state->misses;
+        }
+        EXPECT_EQUAL(hits, 3);
+        EXPECT_EQUAL(misses, 3);
+    };
+
+    /* Sessions expire after their TTL and are wiped */
+    {
+        DEFER_CLEANUP(struct s2n_session_cache *cache = NULL, s2n_session_cache_ptr_free);
+        EXPECT_OK(s2n_session_cache_new(1, 1, &cache));
+
+        EXPECT_OK(s2n_session_cache_test_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, 1));
+        EXPECT_OK(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW + S2N_TEST_TTL - 1, 1));
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW + S2N_TEST_TTL, 1), S2N_ERR_SESSION_ID_NOT_FOUND);
+        EXPECT_FALSE(s2n_test_cache_contains_id(cache, 1));
+
+        /* Replacing an expired session is not an eviction */
+        EXPECT_OK(s2n_session_cache_test_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, 2));
+        EXPECT_OK(s2n_session_cache_test_store(cache, S2N_TEST_NOW + S2N_TEST_TTL, S2N_TEST_TTL, 3));
+        EXPECT_FALSE(s2n_test_cache_contains_id(cache, 2));
+        EXPECT_OK(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW + S2N_TEST_TTL, 3));
+        EXPECT_EQUAL(cache->shards[0].state->evictions, 0);
+
+        /* The TTL saturates instead of overflowing */
+        uint8_t id[S2N_TLS_SESSION_ID_MAX_LEN] = { 0 };
+        uint8_t value[S2N_TLS12_TICKET_SIZE_IN_BYTES] = { 0 };
+        EXPECT_OK(s2n_session_cache_store(cache, S2N_TEST_NOW, UINT64_MAX, id, sizeof(id), value, sizeof(value)));
+        EXPECT_EQUAL(cache->shards[0].entries[0].expiration, UINT64_MAX);
+    };
+
+    /* CLOCK eviction replaces sessions that have not been retrieved first */
+    {
+        DEFER_CLEANUP(struct s2n_session_cache *cache = NULL, s2n_session_cache_ptr_free);
+        EXPECT_OK(s2n_session_cache_new(4, 1, &cache));
+
+        for (uint32_t i = 0; i < 4; i++) {
+            EXPECT_OK(s2n_session_cache_test_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, i));
+        }
+        EXPECT_OK(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 0));
+        EXPECT_OK(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 1));
+
+        /* The hand passes over the retrieved sessions and evicts session 2 */
+        EXPECT_OK(s2n_session_cache_test_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, 4));
+        EXPECT_EQUAL(cache->shards[0].state->evictions, 1);
+        EXPECT_FALSE(s2n_test_cache_contains_id(cache, 2));
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 2), S2N_ERR_SESSION_ID_NOT_FOUND);
+
+        /* The retrieved sessions lost their second chance, so session 3 and then session 0 go next */
+        EXPECT_OK(s2n_session_cache_test_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, 5));
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 3), S2N_ERR_SESSION_ID_NOT_FOUND);
+        EXPECT_OK(s2n_session_cache_test_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, 6));
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 0), S2N_ERR_SESSION_ID_NOT_FOUND);
+        EXPECT_EQUAL(cache->shards[0].state->evictions, 3);
+
+        EXPECT_OK(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 1));
+        EXPECT_OK(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 4));
+        EXPECT_OK(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 5));
+        EXPECT_OK(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, 6));
+    };
+
+    /* A full cache keeps exactly its capacity */
+    {
+        const uint32_t capacity = 64;
+        const uint32_t stored = 1000;
+
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_SUCCESS(s2n_config_enable_builtin_session_cache(config, capacity, 8));
+        struct s2n_session_cache *cache = config->builtin_session_cache;
+
+        for (uint32_t i = 0; i < stored; i++) {
+            EXPECT_OK(s2n_session_cache_test_store(cache, S2N_TEST_NOW, S2N_TEST_TTL, i));
+        }
+
+        uint32_t found = 0;
+        for (uint32_t i = 0; i < stored; i++) {
+            if (s2n_result_is_ok(s2n_session_cache_test_retrieve(cache, S2N_TEST_NOW, i))) {
+                found++;
+            }
+        }
+        EXPECT_EQUAL(found, capacity);
+
+        uint64_t hits = 0, misses = 0, evictions = 0;
+        EXPECT_SUCCESS(s2n_config_get_builtin_session_cache_stats(config, &hits, &misses, &evictions));
+        EXPECT_EQUAL(hits, capacity);
+        EXPECT_EQUAL(misses, stored - capacity);
+        EXPECT_EQUAL(evictions, stored - capacity);
+    };
+
+    /* Concurrent use across threads */
+    {
+        /* Each shard holds a fixed share of the capacity, and session IDs don't spread
+         * evenly across shards. Leave enough room that no session is evicted before
+         * its thread retrieves it.
+         */
+        DEFER_CLEANUP(struct s2n_session_cache *cache = NULL, s2n_session_cache_ptr_free);
+        EXPECT_OK(s2n_session_cache_new(S2N_TEST_THREADS * S2N_TEST_THREAD_STORES * 2, 16, &cache));
+
+        pthread_t threads[S2N_TEST_THREADS] = { 0 };
+        for (size_t i = 0; i < S2N_TEST_THREADS; i++) {
+            EXPECT_EQUAL(pthread_create(&threads[i], NULL, s2n_test_cache_thread, cache), 0);
+        }
+        for (size_t i = 0; i < S2N_TEST_THREADS; i++) {
+            void *result = NULL;
+            EXPECT_EQUAL(pthread_join(threads[i], &result), 0);
+            EXPECT_EQUAL(result, cache);
+        }
+
+        uint64_t hits = 0;
+        for (uint32_t i = 0; i < cache->shard_count; i++) {
+            hits += cache->shards[i].state->hits;
+        }
+        EXPECT_EQUAL(hits, S2N_TEST_THREADS * S2N_TEST_THREAD_STORES);
+    };
+
+    /* TLS1.2 session ID resumption with the built-in cache */
+    {
+        DEFER_CLEANUP(struct s2n_cert_chain_and_key *chain_and_key = NULL, s2n_cert_chain_and_key_ptr_free);
+        EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&chain_and_key,
+                S2N_DEFAULT_TEST_CERT_CHAIN, S2N_DEFAULT_TEST_PRIVATE_KEY));
+
+        uint64_t now = 0;
+
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "20170210"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, chain_and_key));
+        EXPECT_SUCCESS(s2n_config_set_wall_clock(server_config, s2n_test_wall_clock, &now));
+        EXPECT_SUCCESS(s2n_config_set_session_state_lifetime(server_config, 10));
+        now = S2N_TEST_NOW;
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(server_config));
+        EXPECT_SUCCESS(s2n_config_enable_builtin_session_cache(server_config, 10, 2));
+
+        DEFER_CLEANUP(struct s2n_config *client_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(client_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(client_config, "20170210"));
+        EXPECT_SUCCESS(s2n_config_disable_x509_verification(client_config));
+
+        uint8_t session[S2N_TLS12_SESSION_SIZE] = { 0 };
+        int session_size = 0;
+
+        const struct {
+            uint64_t now;
+            bool resumed;
+        } handshakes[] = {
+            { S2N_TEST_NOW, false },
+            { S2N_TEST_NOW + ONE_SEC_IN_NANOS, true },
+            /* The session state lifetime bounds the cache TTL */
+            { S2N_TEST_NOW + (uint64_t) 10 * ONE_SEC_IN_NANOS, false },
+        };
+
+        for (size_t i = 0; i < s2n_array_len(handshakes); i++) {
+            now = handshakes[i].now;
+
+            DEFER_CLEANUP(struct s2n_connection *client_conn = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(client_conn);
+            EXPECT_SUCCESS(s2n_connection_set_config(client_conn, client_config));
+            DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(server_conn);
+            EXPECT_SUCCESS(s2n_connection_set_config(server_conn, server_config));
+
+            if (session_size > 0) {
+                EXPECT_SUCCESS(s2n_connection_set_session(client_conn, session, session_size));
+            }
+
+            DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+            EXPECT_SUCCESS(s2n_io_pair_init_non_blocking(&io_pair));
+            EXPECT_SUCCESS(s2n_connections_set_io_pair(client_conn, server_conn, &io_pair));
+            EXPECT_SUCCESS(s2n_negotiate_test_server_and_client(server_conn, client_conn));
+
+            EXPECT_EQUAL(IS_RESUMPTION_HANDSHAKE(server_conn), handshakes[i].resumed);
+            EXPECT_EQUAL(IS_RESUMPTION_HANDSHAKE(client_conn), handshakes[i].resumed);
+
+            session_size = s2n_connection_get_session(client_conn, session, sizeof(session));
+            EXPECT_TRUE(session_size > 0);
+        }
+
+        uint64_t hits = 0, misses = 0, evictions = 0;
+        EXPECT_SUCCESS(s2n_config_get_builtin_session_cache_stats(server_config, &hits, &misses, &evictions));
+        EXPECT_EQUAL(hits, 1);
+        EXPECT_EQUAL(misses, 1);
+        EXPECT_EQUAL(evictions, 0);
+    };
+
+    END_TEST();
+}
@@ -0,0 +1,307 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "api/unstable/session_cache.h"
+#include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_session_cache.h"
+
+#define S2N_TEST_CACHE_SIZE (1024 * 1024)
+#define S2N_TEST_NOW        ((uint64_t) 1000 * ONE_SEC_IN_NANOS)
+#define S2N_TEST_TTL        ((uint64_t) 60 * ONE_SEC_IN_NANOS)
+
+static struct s2n_session_cache_shard *s2n_test_shard_for(struct s2n_shm_session_cache *shm_cache, uint32_t n)
+{
+    uint8_t id[S2N_TLS_SESSION_ID_MAX_LEN] = { 0 };
+    EXPECT_OK(s2n_session_cache_test_id(n, id));
+    uint64_t hash = s2n_siphash(&shm_cache->cache->header->hash_key, id, sizeof(id));
+    return &shm_cache->cache->shards[(hash >> 32) % shm_cache->cache->shard_count];
+}
+
+static S2N_RESULT s2n_test_handshake(struct s2n_config *server_config, struct s2n_config *client_config,
+        uint8_t *session, int *session_size, bool expect_resumed)
+{
+    DEFER_CLEANUP(struct s2n_connection *client_conn = s2n_connection_new(S2N_CLIENT), s2n_connection_ptr_free);
+    RESULT_ENSURE_REF(client_conn);
+    RESULT_GUARD_POSIX(s2n_connection_set_config(client_conn, client_config));
+    DEFER_CLEANUP(struct s2n_connection *server_conn = s2n_connection_new(S2N_SERVER), s2n_connection_ptr_free);
+    RESULT_ENSURE_REF(server_conn);
+    RESULT_GUARD_POSIX(s2n_connection_set_config(server_conn, server_config));
+
+    if (*session_size > 0) {
+        RESULT_GUARD_POSIX(s2n_connection_set_session(client_conn, session, *session_size));
+    }
+
+    DEFER_CLEANUP(struct s2n_test_io_pair io_pair = { 0 }, s2n_io_pair_close);
+    RESULT_GUARD_POSIX(s2n_io_pair_init_non_blocking(&io_pair));
+    RESULT_GUARD_POSIX(s2n_connections_set_io_pair(client_conn, server_conn, &io_pair));
+    RESULT_GUARD_POSIX(s2n_negotiate_test_server_and_client(server_conn, client_conn));
+    RESULT_ENSURE_EQ(IS_RESUMPTION_HANDSHAKE(server_conn), expect_resumed);
+
+    *session_size = s2n_connection_get_session(client_conn, session, S2N_TLS12_SESSION_SIZE);
+    RESULT_ENSURE_GT(*session_size, 0);
+    return S2N_RESULT_OK;
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    /* Invalid sizes */
+    {
+        EXPECT_NULL(s2n_shm_session_cache_new(NULL, 0));
+        EXPECT_NULL(s2n_shm_session_cache_new(NULL, 1024));
+
+        /* Freeing is idempotent */
+        struct s2n_shm_session_cache *shm_cache = NULL;
+        EXPECT_SUCCESS(s2n_shm_session_cache_free(&shm_cache));
+        EXPECT_FAILURE_WITH_ERRNO(s2n_shm_session_cache_free(NULL), S2N_ERR_NULL);
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_shm_session_cache(NULL, shm_cache), S2N_ERR_NULL);
+    };
+
+    /* The capacity fills the requested size */
+    {
+        DEFER_CLEANUP(struct s2n_shm_session_cache *shm_cache = s2n_shm_session_cache_new(NULL, S2N_TEST_CACHE_SIZE),
+                s2n_shm_session_cache_free);
+        EXPECT_NOT_NULL(shm_cache);
+
+        struct s2n_session_cache_header *header = shm_cache->cache->header;
+        EXPECT_EQUAL(header->magic, S2N_SESSION_CACHE_MAGIC);
+        EXPECT_EQUAL(header->size, S2N_TEST_CACHE_SIZE);
+        EXPECT_EQUAL(header->shard_count, S2N_SHM_SESSION_CACHE_SHARDS);
+        uint64_t entries_size = (uint64_t) header->capacity * sizeof(struct s2n_session_cache_entry);
+        EXPECT_TRUE(entries_size <= S2N_TEST_CACHE_SIZE);
+        EXPECT_TRUE(entries_size > S2N_TEST_CACHE_SIZE * 9 / 10);
+    };
+
+    /* Anonymous shared memory is shared with forked children */
+    {
+        DEFER_CLEANUP(struct s2n_shm_session_cache *shm_cache = s2n_shm_session_cache_new(NULL, S2N_TEST_CACHE_SIZE),
+                s2n_shm_session_cache_free);
+        EXPECT_NOT_NULL(shm_cache);
+        EXPECT_OK(s2n_session_cache_test_store(shm_cache->cache, S2N_TEST_NOW, S2N_TEST_TTL, 1));
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            /* The child sees the parent's session and stores its own */
+            EXPECT_OK(s2n_session_cache_test_retrieve(shm_cache->cache, S2N_TEST_NOW, 1));
+            EXPECT_OK(s2n_session_cache_test_store(shm_cache->cache, S2N_TEST_NOW, S2N_TEST_TTL, 2));
+            exit(0);
+        }
+        int status = 0;
+        EXPECT_EQUAL(waitpid(pid, &status, 0), pid);
+        EXPECT_EQUAL(status, 0);
+
+        EXPECT_OK(s2n_session_cache_test_retrieve(shm_cache->cache, S2N_TEST_NOW, 2));
+
+        uint64_t hits = 0, misses = 0, evictions = 0;
+        EXPECT_SUCCESS(s2n_shm_session_cache_get_stats(shm_cache, &hits, &misses, &evictions));
+        EXPECT_EQUAL(hits, 2);
+        EXPECT_EQUAL(misses, 0);
+        EXPECT_EQUAL(evictions, 0);
+    };
+
+    /* File-backed caches are shared by every process that opens the file */
+    {
+        char path[] = "/tmp/s2n_shm_session_cache_test_XXXXXX";
+        int fd = mkstemp(path);
+        EXPECT_TRUE(fd >= 0);
+        EXPECT_SUCCESS(close(fd));
+
+        DEFER_CLEANUP(struct s2n_shm_session_cache *first = s2n_shm_session_cache_new(path, S2N_TEST_CACHE_SIZE),
+                s2n_shm_session_cache_free);
+        EXPECT_NOT_NULL(first);
+        EXPECT_OK(s2n_session_cache_test_store(first->cache, S2N_TEST_NOW, S2N_TEST_TTL, 1));
+
+        /* A second mapping of the same file, as an unrelated process would open it */
+        DEFER_CLEANUP(struct s2n_shm_session_cache *second = s2n_shm_session_cache_new(path, S2N_TEST_CACHE_SIZE),
+                s2n_shm_session_cache_free);
+        EXPECT_NOT_NULL(second);
+        EXPECT_NOT_EQUAL(first->cache->header, second->cache->header);
+        EXPECT_BYTEARRAY_EQUAL(&first->cache->header->hash_key, &second->cache->header->hash_key,
+                sizeof(struct s2n_siphash_key));
+        EXPECT_OK(s2n_session_cache_test_retrieve(second->cache, S2N_TEST_NOW, 1));
+        EXPECT_OK(s2n_session_cache_test_store(second->cache, S2N_TEST_NOW, S2N_TEST_TTL, 2));
+        EXPECT_OK(s2n_session_cache_test_retrieve(first->cache, S2N_TEST_NOW, 2));
+
+        /* The size must match the existing cache */
+        EXPECT_NULL(s2n_shm_session_cache_new(path, S2N_TEST_CACHE_SIZE * 2));
+
+        /* The sessions outlive the processes that stored them */
+        EXPECT_SUCCESS(s2n_shm_session_cache_free(&first));
+        EXPECT_SUCCESS(s2n_shm_session_cache_free(&second));
+        DEFER_CLEANUP(struct s2n_shm_session_cache *third = s2n_shm_session_cache_new(path, S2N_TEST_CACHE_SIZE),
+                s2n_shm_session_cache_free);
+        EXPECT_NOT_NULL(third);
+        EXPECT_OK(s2n_session_cache_test_retrieve(third->cache, S2N_TEST_NOW, 1));
+        EXPECT_SUCCESS(s2n_shm_session_cache_free(&third));
+
+        /* A file that was never fully initialized is initialized again */
+        fd = open(path, O_WRONLY);
+        EXPECT_TRUE(fd >= 0);
+        uint64_t zero = 0;
+        EXPECT_EQUAL(pwrite(fd, &zero, sizeof(zero), 0), sizeof(zero));
+        EXPECT_SUCCESS(close(fd));
+        third = s2n_shm_session_cache_new(path, S2N_TEST_CACHE_SIZE);
+        EXPECT_NOT_NULL(third);
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_test_retrieve(third->cache, S2N_TEST_NOW, 1), S2N_ERR_SESSION_ID_NOT_FOUND);
+
+        EXPECT_SUCCESS(unlink(path));
+    };
+
+    /* A file written by a different build of s2n is rejected */
+    {
+        char path[] = "/tmp/s2n_shm_session_cache_test_XXXXXX";
+        int fd = mkstemp(path);
+        EXPECT_TRUE(fd >= 0);
+        EXPECT_SUCCESS(close(fd));
+
+        DEFER_CLEANUP(struct s2n_shm_session_cache *shm_cache = s2n_shm_session_cache_new(path, S2N_TEST_CACHE_SIZE),
+                s2n_shm_session_cache_free);
+        EXPECT_NOT_NULL(shm_cache);
+        struct s2n_session_cache_header *header = shm_cache->cache->header;
+
+        const struct s2n_session_cache_header original = *header;
+        header->version++;
+        EXPECT_NULL(s2n_shm_session_cache_new(path, S2N_TEST_CACHE_SIZE));
+        *header = original;
+        header->entry_size++;
+        EXPECT_NULL(s2n_shm_session_cache_new(path, S2N_TEST_CACHE_SIZE));
+        *header = original;
+        header->lock_size++;
+        EXPECT_NULL(s2n_shm_session_cache_new(path, S2N_TEST_CACHE_SIZE));
+        *header = original;
+
+        DEFER_CLEANUP(struct s2n_shm_session_cache *second = s2n_shm_session_cache_new(path, S2N_TEST_CACHE_SIZE),
+                s2n_shm_session_cache_free);
+        EXPECT_NOT_NULL(second);
+
+        EXPECT_SUCCESS(unlink(path));
+    };
+
+    /* Entries with impossible sizes are never copied out */
+    {
+        DEFER_CLEANUP(struct s2n_shm_session_cache *shm_cache = s2n_shm_session_cache_new(NULL, S2N_TEST_CACHE_SIZE),
+                s2n_shm_session_cache_free);
+        EXPECT_NOT_NULL(shm_cache);
+        EXPECT_OK(s2n_session_cache_test_store(shm_cache->cache, S2N_TEST_NOW, S2N_TEST_TTL, 1));
+
+        struct s2n_session_cache_shard *shard = s2n_test_shard_for(shm_cache, 1);
+        struct s2n_session_cache_entry *entry = NULL;
+        for (uint32_t i = 0; i < shard->capacity; i++) {
+            if (shard->entries[i].in_use) {
+                entry = &shard->entries[i];
+            }
+        }
+        EXPECT_NOT_NULL(entry);
+
+        entry->value_size = sizeof(entry->value) + 1;
+        uint8_t id[S2N_TLS_SESSION_ID_MAX_LEN] = { 0 };
+        EXPECT_OK(s2n_session_cache_test_id(1, id));
+        uint8_t value[UINT16_MAX] = { 0 };
+        uint64_t value_size = sizeof(value);
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_retrieve(shm_cache->cache, S2N_TEST_NOW, id, sizeof(id),
+                                        value, &value_size),
+                S2N_ERR_SAFETY);
+    };
+
+#if defined(S2N_ROBUST_MUTEX_SUPPORTED)
+    /* A process that dies while holding a shard lock doesn't block other processes */
+    {
+        DEFER_CLEANUP(struct s2n_shm_session_cache *shm_cache = s2n_shm_session_cache_new(NULL, S2N_TEST_CACHE_SIZE),
+                s2n_shm_session_cache_free);
+        EXPECT_NOT_NULL(shm_cache);
+        EXPECT_OK(s2n_session_cache_test_store(shm_cache->cache, S2N_TEST_NOW, S2N_TEST_TTL, 1));
+        struct s2n_session_cache_shard *shard = s2n_test_shard_for(shm_cache, 1);
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            EXPECT_EQUAL(pthread_mutex_lock(&shard->state->lock), 0);
+            exit(0);
+        }
+        int status = 0;
+        EXPECT_EQUAL(waitpid(pid, &status, 0), pid);
+        EXPECT_EQUAL(status, 0);
+
+        /* The shard's sessions may have been half written, so they are dropped */
+        EXPECT_ERROR_WITH_ERRNO(s2n_session_cache_test_retrieve(shm_cache->cache, S2N_TEST_NOW, 1), S2N_ERR_SESSION_ID_NOT_FOUND);
+        EXPECT_OK(s2n_session_cache_test_store(shm_cache->cache, S2N_TEST_NOW, S2N_TEST_TTL, 1));
+        EXPECT_OK(s2n_session_cache_test_retrieve(shm_cache->cache, S2N_TEST_NOW, 1));
+    };
+#endif
+
+    /* TLS1.2 session ID resumption across server processes */
+    {
+        DEFER_CLEANUP(struct s2n_cert_chain_and_key *chain_and_key = NULL, s2n_cert_chain_and_key_ptr_free);
+        EXPECT_SUCCESS(s2n_test_cert_chain_and_key_new(&chain_and_key,
+                S2N_DEFAULT_TEST_CERT_CHAIN, S2N_DEFAULT_TEST_PRIVATE_KEY));
+
+        DEFER_CLEANUP(struct s2n_shm_session_cache *shm_cache = s2n_shm_session_cache_new(NULL, S2N_TEST_CACHE_SIZE),
+                s2n_shm_session_cache_free);
+        EXPECT_NOT_NULL(shm_cache);
+
+        DEFER_CLEANUP(struct s2n_config *server_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(server_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(server_config, "20170210"));
+        EXPECT_SUCCESS(s2n_config_add_cert_chain_and_key_to_store(server_config, chain_and_key));
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(server_config));
+        EXPECT_SUCCESS(s2n_config_set_shm_session_cache(server_config, shm_cache));
+        EXPECT_TRUE(server_config->use_session_cache);
+        EXPECT_EQUAL(server_config->cache_retrieve_data, shm_cache->cache);
+
+        DEFER_CLEANUP(struct s2n_config *client_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(client_config);
+        EXPECT_SUCCESS(s2n_config_set_cipher_preferences(client_config, "20170210"));
+        EXPECT_SUCCESS(s2n_config_disable_x509_verification(client_config));
+
+        uint8_t session[S2N_TLS12_SESSION_SIZE] = { 0 };
+        int session_size = 0;
+
+        /* A forked worker performs the full handshake and caches the session */
+        int pipe_fds[2] = { 0 };
+        EXPECT_SUCCESS(pipe(pipe_fds));
+        pid_t pid = fork();
+        if (pid == 0) {
+            EXPECT_SUCCESS(close(pipe_fds[0]));
+            EXPECT_OK(s2n_test_handshake(server_config, client_config, session, &session_size, false));
+            EXPECT_EQUAL(write(pipe_fds[1], &session_size, sizeof(session_size)), sizeof(session_size));
+            EXPECT_EQUAL(write(pipe_fds[1], session, session_size), session_size);
+            exit(0);
+        }
+        EXPECT_SUCCESS(close(pipe_fds[1]));
+        EXPECT_EQUAL(read(pipe_fds[0], &session_size, sizeof(session_size)), sizeof(session_size));
+        EXPECT_EQUAL(read(pipe_fds[0], session, session_size), session_size);
+        EXPECT_SUCCESS(close(pipe_fds[0]));
+        int status = 0;
+        EXPECT_EQUAL(waitpid(pid, &status, 0), pid);
+        EXPECT_EQUAL(status, 0);
+
+        /* A different process resumes it */
+        EXPECT_OK(s2n_test_handshake(server_config, client_config, session, &session_size, true));
+
+        uint64_t hits = 0, misses = 0, evictions = 0;
+        EXPECT_SUCCESS(s2n_shm_session_cache_get_stats(shm_cache, &hits, &misses, &evictions));
+        EXPECT_EQUAL(hits, 1);
+    };
+
+    END_TEST();
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "utils/s2n_siphash.h"
+
+#include "s2n_test.h"
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    /* Reference outputs from the SipHash paper's test vectors:
+     * key = 00 01 02 ... 0f, message = 00 01 02 ... (size - 1)
+     */
+    {
+        const struct s2n_siphash_key key = {
+            .k0 = 0x0706050403020100ULL,
+            .k1 = 0x0f0e0d0c0b0a0908ULL,
+        };
+
+        uint8_t message[64] = { 0 };
+        for (size_t i = 0; i < sizeof(message); i++) {
+            message[i] = i;
+        }
+
+        const struct {
+            uint32_t size;
+            uint64_t expected;
+        } test_cases[] = {
+            { .size = 0, .expected = 0x726fdb47dd0e0e31ULL },
+            { .size = 1, .expected = 0x74f839c593dc67fdULL },
+            { .size = 2, .expected = 0x0d6c8009d9a94f5aULL },
+            { .size = 3, .expected = 0x85676696d7fb7e2dULL },
+            { .size = 7, .expected = 0xab0200f58b01d137ULL },
+            { .size = 8, .expected = 0x93f5f5799a932462ULL },
+            { .size = 15, .expected = 0xa129ca6149be45e5ULL },
+            { .size = 16, .expected = 0x3f2acc7f57c29bdbULL },
+            { .size = 63, .expected = 0x958a324ceb064572ULL },
+        };
+
+        for (size_t i = 0; i < s2n_array_len(test_cases); i++) {
+            EXPECT_EQUAL(s2n_siphash(&key, message, test_cases[i].size), test_cases[i].expected);
+        }
+    };
+
+    /* Generated keys are random */
+    {
+        struct s2n_siphash_key key_a = { 0 };
+        struct s2n_siphash_key key_b = { 0 };
+        EXPECT_ERROR_WITH_ERRNO(s2n_siphash_key_generate(NULL), S2N_ERR_NULL);
+        EXPECT_OK(s2n_siphash_key_generate(&key_a));
+        EXPECT_OK(s2n_siphash_key_generate(&key_b));
+        EXPECT_BYTEARRAY_NOT_EQUAL(&key_a, &key_b, sizeof(key_a));
+
+        /* The same input hashes differently under different keys */
+        const uint8_t input[] = "www.example.com";
+        EXPECT_NOT_EQUAL(s2n_siphash(&key_a, input, sizeof(input)), s2n_siphash(&key_b, input, sizeof(input)));
+        EXPECT_EQUAL(s2n_siphash(&key_a, input, sizeof(input)), s2n_siphash(&key_a, input, sizeof(input)));
+    };
+
+    END_TEST();
+}
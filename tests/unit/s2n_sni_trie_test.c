@@ -0,0 +1,450 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_sni_trie.h"
+
+#include <pthread.h>
+
+#include "s2n_test.h"
+#include "stuffer/s2n_stuffer.h"
+#include "tls/s2n_handshake.h"
+#include "utils/s2n_atomic.h"
+#include "utils/s2n_map.h"
+#include "utils/s2n_random.h"
+
+/* Fake chains: the trie only stores the pointers */
+static struct s2n_cert_chain_and_key *s2n_test_chain(uintptr_t id)
+{
+    return (struct s2n_cert_chain_and_key *) id;
+}
+
+static S2N_RESULT s2n_test_trie_set(struct s2n_sni_trie *trie, const char *name, uintptr_t id)
+{
+    struct certs_by_type certs = { 0 };
+    certs.certs[S2N_PKEY_TYPE_RSA] = s2n_test_chain(id);
+    struct s2n_blob blob = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&blob, (uint8_t *) (uintptr_t) name, strlen(name)));
+    RESULT_GUARD(s2n_sni_trie_set(trie, &blob, &certs));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_test_trie_get(struct s2n_sni_trie *trie, const char *name, const struct certs_by_type **certs)
+{
+    struct s2n_blob blob = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&blob, (uint8_t *) (uintptr_t) name, strlen(name)));
+    RESULT_GUARD(s2n_sni_trie_get(trie, &blob, certs));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_test_count_certs(const struct certs_by_type *certs, void *ctx)
+{
+    RESULT_ENSURE_REF(certs->certs[S2N_PKEY_TYPE_RSA]);
+    (*(uint32_t *) ctx)++;
+    return S2N_RESULT_OK;
+}
+
+#define S2N_TEST_CONCURRENT_NAMES 20000
+
+struct s2n_test_reader {
+    struct s2n_sni_trie *trie;
+    s2n_atomic_flag done;
+    bool failed;
+};
+
+/* Looks up a name that the writer keeps replacing. Every set of certificates
+ * the writer installs has the same chain for both key types.
+ */
+static void *s2n_test_reader_thread(void *arg)
+{
+    struct s2n_test_reader *reader = arg;
+    const char name[] = "www.example.com";
+    struct s2n_blob blob = { 0 };
+    if (s2n_blob_init(&blob, (uint8_t *) (uintptr_t) name, strlen(name)) != S2N_SUCCESS) {
+        reader->failed = true;
+        return NULL;
+    }
+
+    while (!s2n_atomic_flag_test(&reader->done)) {
+        struct s2n_sni_trie_match match = { 0 };
+        if (s2n_result_is_error(s2n_sni_trie_lookup(reader->trie, &blob, &match))) {
+            reader->failed = true;
+            return NULL;
+        }
+        if (match.exact.certs[S2N_PKEY_TYPE_RSA] != match.exact.certs[S2N_PKEY_TYPE_ECDSA]) {
+            reader->failed = true;
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+static S2N_RESULT s2n_test_trie_lookup(struct s2n_sni_trie *trie, const char *name, struct s2n_sni_trie_match *match)
+{
+    struct s2n_blob blob = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&blob, (uint8_t *) (uintptr_t) name, strlen(name)));
+    RESULT_GUARD(s2n_sni_trie_lookup(trie, &blob, match));
+    return S2N_RESULT_OK;
+}
+
+/* The matching rules the trie replaced: an exact map lookup,
+ * then a map lookup of the name built by s2n_create_wildcard_hostname.
+ */
+static S2N_RESULT s2n_test_map_lookup(struct s2n_map *map, const char *name, struct s2n_sni_trie_match *match)
+{
+    *match = (struct s2n_sni_trie_match){ 0 };
+
+    struct s2n_blob value = { 0 };
+    bool found = false;
+    struct s2n_blob name_blob = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&name_blob, (uint8_t *) (uintptr_t) name, strlen(name)));
+    RESULT_GUARD(s2n_map_lookup(map, &name_blob, &value, &found));
+    if (found) {
+        match->exact_match_exists = true;
+        match->exact = *(struct certs_by_type *) (void *) value.data;
+    }
+
+    char wildcard[S2N_MAX_SERVER_NAME + 1] = { 0 };
+    struct s2n_blob wildcard_blob = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&wildcard_blob, (uint8_t *) wildcard, sizeof(wildcard)));
+    struct s2n_stuffer wildcard_stuffer = { 0 };
+    RESULT_GUARD_POSIX(s2n_stuffer_init(&wildcard_stuffer, &wildcard_blob));
+    char name_copy[S2N_MAX_SERVER_NAME + 1] = { 0 };
+    RESULT_CHECKED_MEMCPY(name_copy, name, strlen(name));
+    struct s2n_blob name_copy_blob = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&name_copy_blob, (uint8_t *) name_copy, strlen(name)));
+    struct s2n_stuffer name_stuffer = { 0 };
+    RESULT_GUARD_POSIX(s2n_stuffer_init_written(&name_stuffer, &name_copy_blob));
+    RESULT_GUARD_POSIX(s2n_create_wildcard_hostname(&name_stuffer, &wildcard_stuffer));
+
+    wildcard_blob.size = s2n_stuffer_data_available(&wildcard_stuffer);
+    if (wildcard_blob.size > 0) {
+        RESULT_GUARD(s2n_map_lookup(map, &wildcard_blob, &value, &found));
+        if (found) {
+            match->wildcard_match_exists = true;
+            match->wildcard = *(struct certs_by_type *) (void *) value.data;
+        }
+    }
+    return S2N_RESULT_OK;
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    /* Safety */
+    {
+        struct s2n_sni_trie_match match = { 0 };
+        struct certs_by_type certs = { 0 };
+        struct s2n_blob name = { 0 };
+
+        EXPECT_ERROR_WITH_ERRNO(s2n_sni_trie_new(NULL), S2N_ERR_NULL);
+        EXPECT_ERROR_WITH_ERRNO(s2n_sni_trie_lookup(NULL, &name, &match), S2N_ERR_NULL);
+        EXPECT_ERROR_WITH_ERRNO(s2n_sni_trie_set(NULL, &name, &certs), S2N_ERR_NULL);
+
+        DEFER_CLEANUP(struct s2n_sni_trie *trie = NULL, s2n_sni_trie_ptr_free);
+        EXPECT_OK(s2n_sni_trie_new(&trie));
+        EXPECT_ERROR_WITH_ERRNO(s2n_sni_trie_set(trie, &name, &certs), S2N_ERR_INVALID_ARGUMENT);
+
+        /* Empty names never match */
+        EXPECT_OK(s2n_sni_trie_lookup(trie, &name, &match));
+        EXPECT_FALSE(match.exact_match_exists);
+        EXPECT_FALSE(match.wildcard_match_exists);
+
+        struct s2n_sni_trie *null_trie = NULL;
+        EXPECT_OK(s2n_sni_trie_free(&null_trie));
+    };
+
+    /* Exact and wildcard matches */
+    {
+        DEFER_CLEANUP(struct s2n_sni_trie *trie = NULL, s2n_sni_trie_ptr_free);
+        EXPECT_OK(s2n_sni_trie_new(&trie));
+
+        EXPECT_OK(s2n_test_trie_set(trie, "www.example.com", 1));
+        EXPECT_OK(s2n_test_trie_set(trie, "*.example.com", 2));
+        EXPECT_OK(s2n_test_trie_set(trie, "example.com", 3));
+
+        struct s2n_sni_trie_match match = { 0 };
+        EXPECT_OK(s2n_test_trie_lookup(trie, "www.example.com", &match));
+        EXPECT_TRUE(match.exact_match_exists);
+        EXPECT_EQUAL(match.exact.certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(1));
+        EXPECT_TRUE(match.wildcard_match_exists);
+        EXPECT_EQUAL(match.wildcard.certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(2));
+
+        EXPECT_OK(s2n_test_trie_lookup(trie, "mail.example.com", &match));
+        EXPECT_FALSE(match.exact_match_exists);
+        EXPECT_TRUE(match.wildcard_match_exists);
+        EXPECT_EQUAL(match.wildcard.certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(2));
+
+        EXPECT_OK(s2n_test_trie_lookup(trie, "example.com", &match));
+        EXPECT_TRUE(match.exact_match_exists);
+        EXPECT_EQUAL(match.exact.certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(3));
+        EXPECT_FALSE(match.wildcard_match_exists);
+
+        /* Wildcards only match a single label */
+        EXPECT_OK(s2n_test_trie_lookup(trie, "a.www.example.com", &match));
+        EXPECT_FALSE(match.exact_match_exists);
+        EXPECT_FALSE(match.wildcard_match_exists);
+
+        /* Setting a name again replaces its certificates */
+        EXPECT_OK(s2n_test_trie_set(trie, "*.example.com", 4));
+        EXPECT_OK(s2n_test_trie_lookup(trie, "mail.example.com", &match));
+        EXPECT_EQUAL(match.wildcard.certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(4));
+    };
+
+    /* The hash key is only generated once the trie has nodes */
+    {
+        uint64_t bytes_used = 0;
+        EXPECT_OK(s2n_get_private_random_bytes_used(&bytes_used));
+
+        DEFER_CLEANUP(struct s2n_sni_trie *trie = NULL, s2n_sni_trie_ptr_free);
+        EXPECT_OK(s2n_sni_trie_new(&trie));
+        struct s2n_sni_trie_match match = { 0 };
+        EXPECT_OK(s2n_test_trie_lookup(trie, "www.example.com", &match));
+        EXPECT_FALSE(match.exact_match_exists);
+
+        uint64_t bytes_used_after = 0;
+        EXPECT_OK(s2n_get_private_random_bytes_used(&bytes_used_after));
+        EXPECT_EQUAL(bytes_used, bytes_used_after);
+
+        EXPECT_OK(s2n_test_trie_set(trie, "www.example.com", 1));
+        EXPECT_OK(s2n_get_private_random_bytes_used(&bytes_used_after));
+        EXPECT_TRUE(bytes_used_after > bytes_used);
+
+        EXPECT_OK(s2n_test_trie_lookup(trie, "www.example.com", &match));
+        EXPECT_TRUE(match.exact_match_exists);
+        EXPECT_EQUAL(match.exact.certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(1));
+    };
+
+    /* s2n_sni_trie_get only finds the name as stored */
+    {
+        DEFER_CLEANUP(struct s2n_sni_trie *trie = NULL, s2n_sni_trie_ptr_free);
+        EXPECT_OK(s2n_sni_trie_new(&trie));
+        EXPECT_OK(s2n_test_trie_set(trie, "*.example.com", 1));
+        EXPECT_OK(s2n_test_trie_set(trie, "www.example.com", 2));
+
+        const struct certs_by_type *certs = NULL;
+        EXPECT_OK(s2n_test_trie_get(trie, "*.example.com", &certs));
+        EXPECT_NOT_NULL(certs);
+        EXPECT_EQUAL(certs->certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(1));
+
+        EXPECT_OK(s2n_test_trie_get(trie, "www.example.com", &certs));
+        EXPECT_NOT_NULL(certs);
+        EXPECT_EQUAL(certs->certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(2));
+
+        /* Wildcards are not expanded */
+        EXPECT_OK(s2n_test_trie_get(trie, "mail.example.com", &certs));
+        EXPECT_NULL(certs);
+
+        /* Intermediate nodes have no certificates */
+        EXPECT_OK(s2n_test_trie_get(trie, "example.com", &certs));
+        EXPECT_NULL(certs);
+        EXPECT_OK(s2n_test_trie_get(trie, "com", &certs));
+        EXPECT_NULL(certs);
+        EXPECT_OK(s2n_test_trie_get(trie, "www.example.org", &certs));
+        EXPECT_NULL(certs);
+    };
+
+    /* Replacing certificates never modifies the published set */
+    {
+        DEFER_CLEANUP(struct s2n_sni_trie *trie = NULL, s2n_sni_trie_ptr_free);
+        EXPECT_OK(s2n_sni_trie_new(&trie));
+        EXPECT_OK(s2n_test_trie_set(trie, "www.example.com", 1));
+        EXPECT_NULL(trie->retired_certs);
+
+        const struct certs_by_type *original = NULL;
+        EXPECT_OK(s2n_test_trie_get(trie, "www.example.com", &original));
+        EXPECT_NOT_NULL(original);
+
+        EXPECT_OK(s2n_test_trie_set(trie, "www.example.com", 2));
+        EXPECT_EQUAL(original->certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(1));
+        EXPECT_NOT_NULL(trie->retired_certs);
+
+        const struct certs_by_type *replaced = NULL;
+        EXPECT_OK(s2n_test_trie_get(trie, "www.example.com", &replaced));
+        EXPECT_NOT_NULL(replaced);
+        EXPECT_NOT_EQUAL(replaced, original);
+        EXPECT_EQUAL(replaced->certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(2));
+    };
+
+    /* s2n_sni_trie_visit and s2n_sni_trie_size */
+    {
+        DEFER_CLEANUP(struct s2n_sni_trie *trie = NULL, s2n_sni_trie_ptr_free);
+        EXPECT_OK(s2n_sni_trie_new(&trie));
+
+        uint32_t size = 0, visited = 0;
+        EXPECT_OK(s2n_sni_trie_size(trie, &size));
+        EXPECT_EQUAL(size, 0);
+        EXPECT_OK(s2n_sni_trie_visit(trie, s2n_test_count_certs, &visited));
+        EXPECT_EQUAL(visited, 0);
+
+        const char *names[] = { "www.example.com", "*.example.com", "example.com", "*", "a.b.c.d" };
+        for (size_t i = 0; i < s2n_array_len(names); i++) {
+            EXPECT_OK(s2n_test_trie_set(trie, names[i], i + 1));
+        }
+        /* Replacing certificates doesn't add a name */
+        EXPECT_OK(s2n_test_trie_set(trie, "example.com", 10));
+
+        EXPECT_OK(s2n_sni_trie_size(trie, &size));
+        EXPECT_EQUAL(size, s2n_array_len(names));
+        EXPECT_OK(s2n_sni_trie_visit(trie, s2n_test_count_certs, &visited));
+        EXPECT_EQUAL(visited, s2n_array_len(names));
+
+        EXPECT_ERROR_WITH_ERRNO(s2n_sni_trie_visit(NULL, s2n_test_count_certs, &visited), S2N_ERR_NULL);
+        EXPECT_ERROR_WITH_ERRNO(s2n_sni_trie_visit(trie, NULL, &visited), S2N_ERR_NULL);
+        EXPECT_ERROR_WITH_ERRNO(s2n_sni_trie_size(trie, NULL), S2N_ERR_NULL);
+    };
+
+    /* Lookups are safe while the writer adds names and replaces certificates */
+    {
+        DEFER_CLEANUP(struct s2n_sni_trie *trie = NULL, s2n_sni_trie_ptr_free);
+        EXPECT_OK(s2n_sni_trie_new(&trie));
+
+        struct s2n_test_reader reader = { .trie = trie };
+        pthread_t reader_thread = { 0 };
+        EXPECT_EQUAL(pthread_create(&reader_thread, NULL, s2n_test_reader_thread, &reader), 0);
+
+        char name[64] = { 0 };
+        struct s2n_blob blob = { 0 };
+        for (uintptr_t i = 1; i <= S2N_TEST_CONCURRENT_NAMES; i++) {
+            struct certs_by_type certs = { 0 };
+            certs.certs[S2N_PKEY_TYPE_RSA] = s2n_test_chain(i);
+            certs.certs[S2N_PKEY_TYPE_ECDSA] = s2n_test_chain(i);
+
+            /* Grow the child tables that the reader walks through */
+            EXPECT_SUCCESS(snprintf(name, sizeof(name), "host%lu.example.com", (unsigned long) i));
+            EXPECT_SUCCESS(s2n_blob_init(&blob, (uint8_t *) name, strlen(name)));
+            EXPECT_OK(s2n_sni_trie_set(trie, &blob, &certs));
+
+            /* Replace the certificates that the reader looks up */
+            EXPECT_SUCCESS(snprintf(name, sizeof(name), "www.example.com"));
+            EXPECT_SUCCESS(s2n_blob_init(&blob, (uint8_t *) name, strlen(name)));
+            EXPECT_OK(s2n_sni_trie_set(trie, &blob, &certs));
+        }
+
+        s2n_atomic_flag_set(&reader.done);
+        EXPECT_EQUAL(pthread_join(reader_thread, NULL), 0);
+        EXPECT_FALSE(reader.failed);
+    };
+
+    /* Matches are the same as the exact map lookup followed by the wildcard map lookup */
+    {
+        const char *cert_names[] = {
+            "www.example.com",
+            "*.example.com",
+            "example.com",
+            "*.com",
+            "*",
+            "localhost",
+            "*.a..b",
+            ".b",
+            "*.b.",
+            "m*.example.org",
+            "www.*.example.org",
+            "*.*.example.org",
+            "xn--bcher-kva.example",
+        };
+        const char *server_names[] = {
+            "www.example.com",
+            "api.example.com",
+            "example.com",
+            "com",
+            "foo.com",
+            "a.b.example.com",
+            "*",
+            "*.example.com",
+            "localhost",
+            "localhost.",
+            "x.a..b",
+            ".b",
+            "a.b",
+            "x.b.",
+            "b.",
+            "m*.example.org",
+            "mail.example.org",
+            "www.*.example.org",
+            "www.foo.example.org",
+            "*.*.example.org",
+            "x.*.example.org",
+            "xn--bcher-kva.example",
+            ".",
+            "..",
+            "a.",
+        };
+
+        DEFER_CLEANUP(struct s2n_sni_trie *trie = NULL, s2n_sni_trie_ptr_free);
+        EXPECT_OK(s2n_sni_trie_new(&trie));
+        struct s2n_map *map = s2n_map_new();
+        EXPECT_NOT_NULL(map);
+
+        for (size_t i = 0; i < s2n_array_len(cert_names); i++) {
+            EXPECT_OK(s2n_test_trie_set(trie, cert_names[i], i + 1));
+
+            struct certs_by_type certs = { 0 };
+            certs.certs[S2N_PKEY_TYPE_RSA] = s2n_test_chain(i + 1);
+            struct s2n_blob key = { 0 }, value = { 0 };
+            EXPECT_SUCCESS(s2n_blob_init(&key, (uint8_t *) (uintptr_t) cert_names[i], strlen(cert_names[i])));
+            EXPECT_SUCCESS(s2n_blob_init(&value, (uint8_t *) &certs, sizeof(certs)));
+            EXPECT_OK(s2n_map_add(map, &key, &value));
+        }
+        EXPECT_OK(s2n_map_complete(map));
+
+        for (size_t i = 0; i < s2n_array_len(server_names); i++) {
+            struct s2n_sni_trie_match expected = { 0 };
+            EXPECT_OK(s2n_test_map_lookup(map, server_names[i], &expected));
+
+            struct s2n_sni_trie_match actual = { 0 };
+            EXPECT_OK(s2n_test_trie_lookup(trie, server_names[i], &actual));
+
+            EXPECT_EQUAL(actual.exact_match_exists, expected.exact_match_exists);
+            EXPECT_EQUAL(actual.exact.certs[S2N_PKEY_TYPE_RSA], expected.exact.certs[S2N_PKEY_TYPE_RSA]);
+            /* The wildcard match only matters if there is no exact match */
+            if (!expected.exact_match_exists) {
+                EXPECT_EQUAL(actual.wildcard_match_exists, expected.wildcard_match_exists);
+                EXPECT_EQUAL(actual.wildcard.certs[S2N_PKEY_TYPE_RSA], expected.wildcard.certs[S2N_PKEY_TYPE_RSA]);
+            }
+        }
+
+        EXPECT_OK(s2n_map_free(map));
+    };
+
+    /* Many children of a single node */
+    {
+        DEFER_CLEANUP(struct s2n_sni_trie *trie = NULL, s2n_sni_trie_ptr_free);
+        EXPECT_OK(s2n_sni_trie_new(&trie));
+
+        const uint32_t count = 5000;
+        char name[64] = { 0 };
+        for (uint32_t i = 1; i <= count; i++) {
+            EXPECT_SUCCESS(snprintf(name, sizeof(name), "host%u.example.com", i));
+            EXPECT_OK(s2n_test_trie_set(trie, name, i));
+        }
+        /* "com", "example", and one node per host */
+        EXPECT_EQUAL(trie->node_count, count + 2);
+        EXPECT_NOT_NULL(trie->retired_children);
+
+        struct s2n_sni_trie_match match = { 0 };
+        for (uint32_t i = 1; i <= count; i++) {
+            EXPECT_SUCCESS(snprintf(name, sizeof(name), "host%u.example.com", i));
+            EXPECT_OK(s2n_test_trie_lookup(trie, name, &match));
+            EXPECT_TRUE(match.exact_match_exists);
+            EXPECT_EQUAL(match.exact.certs[S2N_PKEY_TYPE_RSA], s2n_test_chain(i));
+        }
+
+        EXPECT_OK(s2n_test_trie_lookup(trie, "host0.example.com", &match));
+        EXPECT_FALSE(match.exact_match_exists);
+    };
+
+    END_TEST();
+}
@@ -0,0 +1,420 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_ticket_key_cache.h"
+
+#include <pthread.h>
+
+#include "api/unstable/ticket_keys.h"
+#include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_tls.h"
+
+#define S2N_TEST_INFO_OFFSET (S2N_TICKET_VERSION_SIZE + S2N_TICKET_KEY_NAME_LEN)
+#define S2N_TEST_IV_OFFSET   (S2N_TEST_INFO_OFFSET + S2N_TICKET_INFO_SIZE)
+#define S2N_TEST_THREADS     4
+#define S2N_TEST_TICKETS     100
+
+static struct s2n_connection *s2n_test_conn_new(struct s2n_config *config)
+{
+    struct s2n_connection *conn = s2n_connection_new(S2N_SERVER);
+    PTR_ENSURE_REF(conn);
+    PTR_GUARD_POSIX(s2n_connection_set_config(conn, config));
+    conn->actual_protocol_version = S2N_TLS12;
+    conn->handshake.handshake_type = NEGOTIATED;
+    conn->secure->cipher_suite = &s2n_ecdhe_ecdsa_with_aes_128_gcm_sha256;
+    memset(conn->secrets.version.tls12.master_secret, 'm', S2N_TLS_SECRET_LEN);
+    return conn;
+}
+
+static S2N_RESULT s2n_test_issue_ticket(struct s2n_connection *conn, struct s2n_stuffer *ticket)
+{
+    RESULT_GUARD_POSIX(s2n_stuffer_wipe(ticket));
+    uint8_t key_name[S2N_TICKET_KEY_NAME_LEN] = { 0 };
+    uint64_t key_intro_timestamp = 0;
+    RESULT_GUARD(s2n_config_select_ticket_encrypt_key(conn->config, key_name, &key_intro_timestamp));
+    RESULT_GUARD(s2n_resume_encrypt_session_ticket(conn, key_name, ticket));
+    return S2N_RESULT_OK;
+}
+
+/* Decryption is in place, so decrypt a copy to allow redeeming the same ticket again */
+static S2N_RESULT s2n_test_redeem_ticket(struct s2n_connection *conn, struct s2n_stuffer *ticket)
+{
+    RESULT_GUARD_POSIX(s2n_stuffer_reread(ticket));
+    DEFER_CLEANUP(struct s2n_stuffer copy = { 0 }, s2n_stuffer_free);
+    RESULT_GUARD_POSIX(s2n_stuffer_growable_alloc(&copy, 0));
+    RESULT_GUARD_POSIX(s2n_stuffer_copy(ticket, &copy, s2n_stuffer_data_available(ticket)));
+
+    memset(conn->secrets.version.tls12.master_secret, 0, S2N_TLS_SECRET_LEN);
+    RESULT_GUARD(s2n_resume_decrypt_session(conn, &copy));
+
+    uint8_t expected[S2N_TLS_SECRET_LEN] = { 0 };
+    memset(expected, 'm', sizeof(expected));
+    RESULT_ENSURE(memcmp(conn->secrets.version.tls12.master_secret, expected, sizeof(expected)) == 0, S2N_ERR_SAFETY);
+    return S2N_RESULT_OK;
+}
+
+/* Checks every byte of a cached ticket's nonce: the prefix of the current encryption key, then the counter */
+static S2N_RESULT s2n_test_ticket_nonce(struct s2n_stuffer *ticket, struct s2n_ticket_key_cache *cache,
+        uint64_t *counter)
+{
+    const uint8_t *iv = ticket->blob.data + S2N_TEST_IV_OFFSET;
+    RESULT_ENSURE(memcmp(iv, cache->encrypt.nonce_prefix, S2N_TICKET_KEY_CACHE_NONCE_PREFIX_LEN) == 0, S2N_ERR_SAFETY);
+
+    *counter = 0;
+    for (size_t i = S2N_TICKET_KEY_CACHE_NONCE_PREFIX_LEN; i < S2N_TLS_GCM_IV_LEN; i++) {
+        *counter = (*counter << 8) | iv[i];
+    }
+    return S2N_RESULT_OK;
+}
+
+struct s2n_test_thread_args {
+    struct s2n_config *config;
+    uint8_t ivs[S2N_TEST_TICKETS][S2N_TLS_GCM_IV_LEN];
+};
+
+static void *s2n_test_issue_tickets_thread(void *arg)
+{
+    struct s2n_test_thread_args *args = (struct s2n_test_thread_args *) arg;
+
+    DEFER_CLEANUP(struct s2n_connection *conn = s2n_test_conn_new(args->config), s2n_connection_ptr_free);
+    DEFER_CLEANUP(struct s2n_stuffer ticket = { 0 }, s2n_stuffer_free);
+    if (conn == NULL || s2n_stuffer_growable_alloc(&ticket, 0) != S2N_SUCCESS) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < S2N_TEST_TICKETS; i++) {
+        if (s2n_result_is_error(s2n_test_issue_ticket(conn, &ticket))
+                || s2n_result_is_error(s2n_test_redeem_ticket(conn, &ticket))) {
+            return NULL;
+        }
+        memcpy(args->ivs[i], ticket.blob.data + S2N_TEST_IV_OFFSET, S2N_TLS_GCM_IV_LEN);
+    }
+    return args;
+}
+
+/* The key chosen for a ticket may be removed before the ticket is issued or redeemed */
+static bool s2n_test_removed_key_error(s2n_result result)
+{
+    return s2n_result_is_ok(result)
+            || s2n_errno == S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY
+            || s2n_errno == S2N_ERR_KEY_USED_IN_SESSION_TICKET_NOT_FOUND;
+}
+
+static void *s2n_test_issue_tickets_during_rotation_thread(void *arg)
+{
+    struct s2n_test_thread_args *args = (struct s2n_test_thread_args *) arg;
+
+    DEFER_CLEANUP(struct s2n_connection *conn = s2n_test_conn_new(args->config), s2n_connection_ptr_free);
+    DEFER_CLEANUP(struct s2n_stuffer ticket = { 0 }, s2n_stuffer_free);
+    if (conn == NULL || s2n_stuffer_growable_alloc(&ticket, 0) != S2N_SUCCESS) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < S2N_TEST_TICKETS; i++) {
+        /* A failed redemption leaves the master secret wiped */
+        memset(conn->secrets.version.tls12.master_secret, 'm', S2N_TLS_SECRET_LEN);
+        s2n_result result = s2n_test_issue_ticket(conn, &ticket);
+        if (!s2n_test_removed_key_error(result)) {
+            return NULL;
+        }
+        if (s2n_result_is_ok(result) && !s2n_test_removed_key_error(s2n_test_redeem_ticket(conn, &ticket))) {
+            return NULL;
+        }
+    }
+    return args;
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    /* s2n_config_set_ticket_key_caching */
+    {
+        EXPECT_FAILURE_WITH_ERRNO(s2n_config_set_ticket_key_caching(NULL, true), S2N_ERR_NULL);
+
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_FALSE(config->cache_ticket_keys);
+
+        EXPECT_SUCCESS(s2n_config_set_ticket_key_caching(config, true));
+        EXPECT_TRUE(config->cache_ticket_keys);
+        EXPECT_SUCCESS(s2n_config_set_ticket_key_caching(config, false));
+        EXPECT_FALSE(config->cache_ticket_keys);
+    };
+
+    /* Cached tickets use one derived key and increasing nonces */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(config));
+        EXPECT_SUCCESS(s2n_config_set_ticket_key_caching(config, true));
+
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_test_conn_new(config), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+
+        DEFER_CLEANUP(struct s2n_stuffer first = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&first, 0));
+        DEFER_CLEANUP(struct s2n_stuffer second = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&second, 0));
+
+        EXPECT_OK(s2n_test_issue_ticket(conn, &first));
+        EXPECT_OK(s2n_test_issue_ticket(conn, &second));
+        EXPECT_EQUAL(s2n_stuffer_data_available(&first), S2N_TLS12_TICKET_SIZE_IN_BYTES);
+
+        EXPECT_BYTEARRAY_EQUAL(first.blob.data + S2N_TEST_INFO_OFFSET,
+                second.blob.data + S2N_TEST_INFO_OFFSET, S2N_TICKET_INFO_SIZE);
+
+        struct s2n_ticket_key *key = NULL;
+        EXPECT_OK(s2n_array_get(config->ticket_keys, 0, (void **) &key));
+        EXPECT_NOT_NULL(key->cache);
+
+        uint64_t first_counter = 0;
+        EXPECT_OK(s2n_test_ticket_nonce(&first, key->cache, &first_counter));
+        uint64_t second_counter = 0;
+        EXPECT_OK(s2n_test_ticket_nonce(&second, key->cache, &second_counter));
+        EXPECT_EQUAL(first_counter + 1, second_counter);
+
+        EXPECT_OK(s2n_test_redeem_ticket(conn, &first));
+        EXPECT_OK(s2n_test_redeem_ticket(conn, &second));
+
+        /* Both tickets were decrypted with a single cached context */
+        EXPECT_EQUAL(key->cache->encrypt_count, 2);
+        EXPECT_EQUAL(key->cache->next_decrypt_slot, 1);
+        EXPECT_TRUE(key->cache->decrypt[0].ready);
+        EXPECT_FALSE(key->cache->decrypt[1].ready);
+    };
+
+    /* Tickets are compatible with servers that don't cache ticket keys */
+    {
+        DEFER_CLEANUP(struct s2n_config *cached_config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(cached_config);
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(cached_config));
+        EXPECT_SUCCESS(s2n_config_set_ticket_key_caching(cached_config, true));
+
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(config));
+
+        DEFER_CLEANUP(struct s2n_connection *cached_conn = s2n_test_conn_new(cached_config), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(cached_conn);
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_test_conn_new(config), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+
+        DEFER_CLEANUP(struct s2n_stuffer ticket = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&ticket, 0));
+
+        EXPECT_OK(s2n_test_issue_ticket(cached_conn, &ticket));
+        EXPECT_OK(s2n_test_redeem_ticket(conn, &ticket));
+
+        EXPECT_OK(s2n_test_issue_ticket(conn, &ticket));
+        EXPECT_OK(s2n_test_redeem_ticket(cached_conn, &ticket));
+    };
+
+    /* Modified tickets are rejected */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(config));
+        EXPECT_SUCCESS(s2n_config_set_ticket_key_caching(config, true));
+
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_test_conn_new(config), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+
+        DEFER_CLEANUP(struct s2n_stuffer ticket = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&ticket, 0));
+        EXPECT_OK(s2n_test_issue_ticket(conn, &ticket));
+
+        const uint32_t offsets[] = { S2N_TEST_INFO_OFFSET, S2N_TEST_IV_OFFSET, S2N_TLS12_TICKET_SIZE_IN_BYTES - 1 };
+        for (size_t i = 0; i < s2n_array_len(offsets); i++) {
+            ticket.blob.data[offsets[i]] ^= 1;
+            EXPECT_ERROR_WITH_ERRNO(s2n_test_redeem_ticket(conn, &ticket), S2N_ERR_DECRYPT);
+            ticket.blob.data[offsets[i]] ^= 1;
+        }
+        EXPECT_OK(s2n_test_redeem_ticket(conn, &ticket));
+    };
+
+    /* A new encryption key is derived after a fork or after too many tickets */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(config));
+        EXPECT_SUCCESS(s2n_config_set_ticket_key_caching(config, true));
+
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_test_conn_new(config), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+
+        DEFER_CLEANUP(struct s2n_stuffer ticket = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&ticket, 0));
+        EXPECT_OK(s2n_test_issue_ticket(conn, &ticket));
+
+        struct s2n_ticket_key *key = NULL;
+        EXPECT_OK(s2n_array_get(config->ticket_keys, 0, (void **) &key));
+        EXPECT_NOT_NULL(key->cache);
+
+        uint8_t info[S2N_TICKET_INFO_SIZE] = { 0 };
+        EXPECT_MEMCPY_SUCCESS(info, key->cache->encrypt.info, sizeof(info));
+
+        /* Simulate a fork */
+        key->cache->encrypt_fork_generation++;
+        EXPECT_OK(s2n_test_issue_ticket(conn, &ticket));
+        EXPECT_BYTEARRAY_NOT_EQUAL(info, key->cache->encrypt.info, sizeof(info));
+        EXPECT_BYTEARRAY_EQUAL(ticket.blob.data + S2N_TEST_INFO_OFFSET, key->cache->encrypt.info, sizeof(info));
+        EXPECT_EQUAL(key->cache->encrypt_count, 1);
+        uint64_t counter = 0;
+        EXPECT_OK(s2n_test_ticket_nonce(&ticket, key->cache, &counter));
+        EXPECT_OK(s2n_test_redeem_ticket(conn, &ticket));
+
+        /* Simulate the encryption limit */
+        EXPECT_MEMCPY_SUCCESS(info, key->cache->encrypt.info, sizeof(info));
+        key->cache->encrypt_count = S2N_TICKET_KEY_CACHE_MAX_ENCRYPTIONS;
+        EXPECT_OK(s2n_test_issue_ticket(conn, &ticket));
+        EXPECT_BYTEARRAY_NOT_EQUAL(info, key->cache->encrypt.info, sizeof(info));
+        EXPECT_EQUAL(key->cache->encrypt_count, 1);
+        EXPECT_OK(s2n_test_redeem_ticket(conn, &ticket));
+    };
+
+    /* Decryption contexts are reused, and the oldest is replaced when all slots are in use */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(config));
+
+        /* Tickets from servers that don't cache ticket keys each have a unique info */
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_test_conn_new(config), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+
+        struct s2n_stuffer tickets[S2N_TICKET_KEY_CACHE_DECRYPT_SLOTS + 1] = { 0 };
+        for (size_t i = 0; i < s2n_array_len(tickets); i++) {
+            EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&tickets[i], 0));
+            EXPECT_OK(s2n_test_issue_ticket(conn, &tickets[i]));
+        }
+
+        EXPECT_SUCCESS(s2n_config_set_ticket_key_caching(config, true));
+        struct s2n_ticket_key *key = NULL;
+        EXPECT_OK(s2n_array_get(config->ticket_keys, 0, (void **) &key));
+
+        for (size_t i = 0; i < S2N_TICKET_KEY_CACHE_DECRYPT_SLOTS; i++) {
+            EXPECT_OK(s2n_test_redeem_ticket(conn, &tickets[i]));
+            EXPECT_OK(s2n_test_redeem_ticket(conn, &tickets[i]));
+        }
+        EXPECT_NOT_NULL(key->cache);
+        EXPECT_EQUAL(key->cache->next_decrypt_slot, 0);
+        for (size_t i = 0; i < S2N_TICKET_KEY_CACHE_DECRYPT_SLOTS; i++) {
+            EXPECT_BYTEARRAY_EQUAL(key->cache->decrypt[i].info,
+                    tickets[i].blob.data + S2N_TEST_INFO_OFFSET, S2N_TICKET_INFO_SIZE);
+        }
+
+        const size_t last = S2N_TICKET_KEY_CACHE_DECRYPT_SLOTS;
+        EXPECT_OK(s2n_test_redeem_ticket(conn, &tickets[last]));
+        EXPECT_EQUAL(key->cache->next_decrypt_slot, 1);
+        EXPECT_BYTEARRAY_EQUAL(key->cache->decrypt[0].info,
+                tickets[last].blob.data + S2N_TEST_INFO_OFFSET, S2N_TICKET_INFO_SIZE);
+
+        /* Evicted tickets can still be decrypted */
+        EXPECT_OK(s2n_test_redeem_ticket(conn, &tickets[0]));
+
+        for (size_t i = 0; i < s2n_array_len(tickets); i++) {
+            EXPECT_SUCCESS(s2n_stuffer_free(&tickets[i]));
+        }
+    };
+
+    /* Caches are freed with expired keys */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(config));
+        EXPECT_SUCCESS(s2n_config_set_ticket_key_caching(config, true));
+
+        DEFER_CLEANUP(struct s2n_connection *conn = s2n_test_conn_new(config), s2n_connection_ptr_free);
+        EXPECT_NOT_NULL(conn);
+        DEFER_CLEANUP(struct s2n_stuffer ticket = { 0 }, s2n_stuffer_free);
+        EXPECT_SUCCESS(s2n_stuffer_growable_alloc(&ticket, 0));
+        EXPECT_OK(s2n_test_issue_ticket(conn, &ticket));
+        EXPECT_OK(s2n_test_redeem_ticket(conn, &ticket));
+
+        EXPECT_SUCCESS(s2n_config_wipe_expired_ticket_crypto_keys(config, 0));
+        uint32_t keys_len = 1;
+        EXPECT_OK(s2n_array_num_elements(config->ticket_keys, &keys_len));
+        EXPECT_EQUAL(keys_len, 0);
+    };
+
+    /* Concurrent connections never reuse a nonce */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(config));
+        EXPECT_SUCCESS(s2n_config_set_ticket_key_caching(config, true));
+
+        static struct s2n_test_thread_args args[S2N_TEST_THREADS] = { 0 };
+        pthread_t threads[S2N_TEST_THREADS] = { 0 };
+        for (size_t i = 0; i < S2N_TEST_THREADS; i++) {
+            args[i].config = config;
+            EXPECT_EQUAL(pthread_create(&threads[i], NULL, s2n_test_issue_tickets_thread, &args[i]), 0);
+        }
+        for (size_t i = 0; i < S2N_TEST_THREADS; i++) {
+            void *result = NULL;
+            EXPECT_EQUAL(pthread_join(threads[i], &result), 0);
+            EXPECT_EQUAL(result, &args[i]);
+        }
+
+        struct s2n_ticket_key *key = NULL;
+        EXPECT_OK(s2n_array_get(config->ticket_keys, 0, (void **) &key));
+        EXPECT_EQUAL(key->cache->encrypt_count, S2N_TEST_THREADS * S2N_TEST_TICKETS);
+
+        const size_t total = S2N_TEST_THREADS * S2N_TEST_TICKETS;
+        for (size_t i = 0; i < total; i++) {
+            for (size_t j = i + 1; j < total; j++) {
+                const uint8_t *iv_i = args[i / S2N_TEST_TICKETS].ivs[i % S2N_TEST_TICKETS];
+                const uint8_t *iv_j = args[j / S2N_TEST_TICKETS].ivs[j % S2N_TEST_TICKETS];
+                EXPECT_BYTEARRAY_NOT_EQUAL(iv_i, iv_j, S2N_TLS_GCM_IV_LEN);
+            }
+        }
+    };
+
+    /* Keys can be added and removed while other threads are using them */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_OK(s2n_resumption_test_ticket_key_setup(config));
+        EXPECT_SUCCESS(s2n_config_set_ticket_key_caching(config, true));
+
+        static struct s2n_test_thread_args args[S2N_TEST_THREADS] = { 0 };
+        pthread_t threads[S2N_TEST_THREADS] = { 0 };
+        for (size_t i = 0; i < S2N_TEST_THREADS; i++) {
+            args[i].config = config;
+            EXPECT_EQUAL(pthread_create(&threads[i], NULL, s2n_test_issue_tickets_during_rotation_thread, &args[i]), 0);
+        }
+
+        uint8_t name[S2N_TICKET_KEY_NAME_LEN] = "rotated";
+        uint8_t secret[32] = "rotated secret";
+        for (uint8_t i = 0; i < UINT8_MAX; i++) {
+            name[sizeof(name) - 1] = i;
+            secret[sizeof(secret) - 1] = i;
+            EXPECT_SUCCESS(s2n_config_add_ticket_crypto_key(config, name, sizeof(name), secret, sizeof(secret), 0));
+            EXPECT_SUCCESS(s2n_config_wipe_expired_ticket_crypto_keys(config, 0));
+        }
+
+        for (size_t i = 0; i < S2N_TEST_THREADS; i++) {
+            void *result = NULL;
+            EXPECT_EQUAL(pthread_join(threads[i], &result), 0);
+            EXPECT_EQUAL(result, &args[i]);
+        }
+    };
+
+    END_TEST();
+}
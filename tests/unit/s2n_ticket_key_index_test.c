@@ -0,0 +1,239 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "api/s2n.h"
+#include "s2n_test.h"
+#include "testlib/s2n_testlib.h"
+#include "tls/s2n_config.h"
+#include "tls/s2n_resume.h"
+
+#define S2N_TEST_LIFETIME ((uint64_t) ONE_SEC_IN_NANOS * 3600)
+
+static uint64_t s2n_test_now = 0;
+
+static int s2n_test_wall_clock(void *data, uint64_t *nanoseconds)
+{
+    *nanoseconds = s2n_test_now;
+    return S2N_SUCCESS;
+}
+
+static int s2n_test_add_key(struct s2n_config *config, uint8_t id, uint64_t intro_time_in_secs)
+{
+    uint8_t name[S2N_TICKET_KEY_NAME_LEN] = "key";
+    name[sizeof(name) - 1] = id;
+    uint8_t key[32] = "secret";
+    key[sizeof(key) - 1] = id;
+    POSIX_GUARD(s2n_config_add_ticket_crypto_key(config, name, sizeof(name), key, sizeof(key), intro_time_in_secs));
+    return S2N_SUCCESS;
+}
+
+static struct s2n_ticket_key *s2n_test_find_key(struct s2n_config *config, uint8_t id)
+{
+    uint8_t name[S2N_TICKET_KEY_NAME_LEN] = "key";
+    name[sizeof(name) - 1] = id;
+    return s2n_find_ticket_key(config, name);
+}
+
+int main(int argc, char **argv)
+{
+    BEGIN_TEST();
+
+    /* Key names are indexed */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_SUCCESS(s2n_config_set_session_tickets_onoff(config, true));
+        EXPECT_NOT_NULL(config->ticket_key_index);
+
+        /* No keys */
+        EXPECT_NULL(s2n_test_find_key(config, 0));
+
+        for (size_t i = 0; i < S2N_MAX_TICKET_KEYS; i++) {
+            EXPECT_SUCCESS(s2n_test_add_key(config, i, 0));
+        }
+        EXPECT_FAILURE_WITH_ERRNO(s2n_test_add_key(config, S2N_MAX_TICKET_KEYS, 0), S2N_ERR_TICKET_KEY_LIMIT);
+
+        for (size_t i = 0; i < S2N_MAX_TICKET_KEYS; i++) {
+            struct s2n_ticket_key *key = s2n_test_find_key(config, i);
+            EXPECT_NOT_NULL(key);
+            EXPECT_EQUAL(key->key_name[S2N_TICKET_KEY_NAME_LEN - 1], i);
+        }
+        EXPECT_NULL(s2n_test_find_key(config, S2N_MAX_TICKET_KEYS));
+
+        /* The index is updated when keys are removed */
+        EXPECT_SUCCESS(s2n_config_wipe_expired_ticket_crypto_keys(config, 0));
+        EXPECT_NULL(s2n_test_find_key(config, 0));
+        for (size_t i = 1; i < S2N_MAX_TICKET_KEYS; i++) {
+            struct s2n_ticket_key *key = s2n_test_find_key(config, i);
+            EXPECT_NOT_NULL(key);
+            EXPECT_EQUAL(key->key_name[S2N_TICKET_KEY_NAME_LEN - 1], i);
+        }
+
+        /* Duplicate names are still rejected */
+        EXPECT_FAILURE_WITH_ERRNO(s2n_test_add_key(config, 1, 0), S2N_ERR_INVALID_TICKET_KEY_NAME_OR_NAME_LENGTH);
+    };
+
+    /* Expired keys are not found */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_SUCCESS(s2n_config_set_wall_clock(config, s2n_test_wall_clock, NULL));
+        EXPECT_SUCCESS(s2n_config_set_session_tickets_onoff(config, true));
+
+        s2n_test_now = 0;
+        EXPECT_SUCCESS(s2n_test_add_key(config, 1, 1));
+        EXPECT_NOT_NULL(s2n_test_find_key(config, 1));
+
+        s2n_test_now = ONE_SEC_IN_NANOS + config->encrypt_decrypt_key_lifetime_in_nanos
+                + config->decrypt_key_lifetime_in_nanos;
+        EXPECT_NULL(s2n_test_find_key(config, 1));
+    };
+
+    /* The encrypt-decrypt keys are only recomputed when a key changes state */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_SUCCESS(s2n_config_set_wall_clock(config, s2n_test_wall_clock, NULL));
+        EXPECT_SUCCESS(s2n_config_set_session_tickets_onoff(config, true));
+        EXPECT_SUCCESS(s2n_config_set_ticket_encrypt_decrypt_key_lifetime(config, S2N_TEST_LIFETIME / ONE_SEC_IN_NANOS));
+        struct s2n_ticket_key_index *index = config->ticket_key_index;
+
+        /* Keys introduced every half lifetime, so at most two can encrypt at once */
+        const uint64_t half_lifetime_secs = S2N_TEST_LIFETIME / ONE_SEC_IN_NANOS / 2;
+        const uint64_t base_secs = 1000000;
+        for (uint8_t i = 0; i < 6; i++) {
+            EXPECT_SUCCESS(s2n_test_add_key(config, i, base_secs + (i * half_lifetime_secs)));
+        }
+
+        /* Before any key can encrypt */
+        s2n_test_now = 0;
+        EXPECT_NULL(s2n_get_ticket_encrypt_decrypt_key(config));
+        EXPECT_ERROR_WITH_ERRNO(s2n_config_is_encrypt_key_available(config), S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
+        EXPECT_TRUE(index->schedule_ready);
+        EXPECT_EQUAL(index->encrypt_keys_len, 0);
+        EXPECT_EQUAL(index->schedule_start, 0);
+        EXPECT_EQUAL(index->schedule_end, base_secs * ONE_SEC_IN_NANOS);
+
+        /* Only key 0 can encrypt */
+        s2n_test_now = base_secs * ONE_SEC_IN_NANOS;
+        struct s2n_ticket_key *key = s2n_get_ticket_encrypt_decrypt_key(config);
+        EXPECT_NOT_NULL(key);
+        EXPECT_EQUAL(key->key_name[S2N_TICKET_KEY_NAME_LEN - 1], 0);
+        EXPECT_EQUAL(index->encrypt_keys_len, 1);
+        EXPECT_EQUAL(index->schedule_start, s2n_test_now);
+        EXPECT_EQUAL(index->schedule_end, s2n_test_now + (S2N_TEST_LIFETIME / 2));
+
+        /* Keys 1 and 2 can encrypt */
+        s2n_test_now = (base_secs + 2 * half_lifetime_secs) * ONE_SEC_IN_NANOS + 1;
+        const uint64_t start = s2n_test_now - 1;
+        const uint64_t end = start + (S2N_TEST_LIFETIME / 2);
+        bool selected[6] = { 0 };
+        for (size_t i = 0; i < 1000; i++) {
+            s2n_test_now = start + 1 + (i * ((end - start - 1) / 1000));
+            key = s2n_get_ticket_encrypt_decrypt_key(config);
+            EXPECT_NOT_NULL(key);
+            selected[key->key_name[S2N_TICKET_KEY_NAME_LEN - 1]] = true;
+            EXPECT_EQUAL(index->schedule_start, start);
+            EXPECT_EQUAL(index->schedule_end, end);
+        }
+        EXPECT_FALSE(selected[0]);
+        EXPECT_TRUE(selected[1]);
+        EXPECT_TRUE(selected[2]);
+        EXPECT_FALSE(selected[3]);
+
+        /* Within the interval, the cached keys are used without recomputing them */
+        index->encrypt_keys[0] = 5;
+        index->encrypt_keys_len = 1;
+        key = s2n_get_ticket_encrypt_decrypt_key(config);
+        EXPECT_NOT_NULL(key);
+        EXPECT_EQUAL(key->key_name[S2N_TICKET_KEY_NAME_LEN - 1], 5);
+
+        /* Leaving the interval recomputes the keys */
+        s2n_test_now = end;
+        key = s2n_get_ticket_encrypt_decrypt_key(config);
+        EXPECT_NOT_NULL(key);
+        EXPECT_NOT_EQUAL(key->key_name[S2N_TICKET_KEY_NAME_LEN - 1], 5);
+        EXPECT_EQUAL(index->schedule_start, end);
+        EXPECT_EQUAL(index->encrypt_keys_len, 2);
+
+        /* So does a clock moving backwards */
+        s2n_test_now = start;
+        EXPECT_NOT_NULL(s2n_get_ticket_encrypt_decrypt_key(config));
+        EXPECT_EQUAL(index->schedule_start, start);
+        EXPECT_EQUAL(index->schedule_end, end);
+
+        /* So does changing the key lifetime */
+        config->encrypt_decrypt_key_lifetime_in_nanos = S2N_TEST_LIFETIME * 10;
+        EXPECT_NOT_NULL(s2n_get_ticket_encrypt_decrypt_key(config));
+        EXPECT_EQUAL(index->schedule_lifetime, S2N_TEST_LIFETIME * 10);
+        EXPECT_EQUAL(index->encrypt_keys_len, 3);
+
+        /* So does adding a key */
+        EXPECT_SUCCESS(s2n_test_add_key(config, 10, 0));
+        EXPECT_FALSE(index->schedule_ready);
+        EXPECT_NOT_NULL(s2n_get_ticket_encrypt_decrypt_key(config));
+        EXPECT_EQUAL(index->encrypt_keys_len, 4);
+    };
+
+    /* The cached cumulative weights match each key's weight at the current time */
+    {
+        DEFER_CLEANUP(struct s2n_config *config = s2n_config_new(), s2n_config_ptr_free);
+        EXPECT_NOT_NULL(config);
+        EXPECT_SUCCESS(s2n_config_set_wall_clock(config, s2n_test_wall_clock, NULL));
+        EXPECT_SUCCESS(s2n_config_set_session_tickets_onoff(config, true));
+        EXPECT_SUCCESS(s2n_config_set_ticket_encrypt_decrypt_key_lifetime(config, S2N_TEST_LIFETIME / ONE_SEC_IN_NANOS));
+        struct s2n_ticket_key_index *index = config->ticket_key_index;
+
+        const uint64_t base_secs = 1000000;
+        const uint64_t third_lifetime_secs = S2N_TEST_LIFETIME / ONE_SEC_IN_NANOS / 3;
+        EXPECT_SUCCESS(s2n_test_add_key(config, 0, base_secs));
+        EXPECT_SUCCESS(s2n_test_add_key(config, 1, base_secs + third_lifetime_secs));
+        const uint64_t base = base_secs * ONE_SEC_IN_NANOS;
+        const uint64_t third = third_lifetime_secs * ONE_SEC_IN_NANOS;
+        const uint64_t half = S2N_TEST_LIFETIME / 2;
+
+        /* Both keys are rising, and key 0 peaks before either key expires */
+        s2n_test_now = base + third + (third / 4);
+        size_t selected[2] = { 0 };
+        for (size_t i = 0; i < 1000; i++) {
+            struct s2n_ticket_key *key = s2n_get_ticket_encrypt_decrypt_key(config);
+            EXPECT_NOT_NULL(key);
+            selected[key->key_name[S2N_TICKET_KEY_NAME_LEN - 1]]++;
+        }
+        EXPECT_EQUAL(index->encrypt_keys_len, 2);
+        EXPECT_EQUAL(index->schedule_start, base + third);
+        EXPECT_EQUAL(index->schedule_end, base + half);
+        uint64_t key_0_weight = s2n_test_now - base;
+        uint64_t key_1_weight = s2n_test_now - (base + third);
+        uint64_t elapsed = s2n_test_now - index->schedule_start;
+        EXPECT_EQUAL(index->cumulative_weights[1] + index->cumulative_slopes[1] * elapsed, key_0_weight + key_1_weight);
+        /* Key 0 has five times the weight of key 1 */
+        EXPECT_TRUE(selected[0] > selected[1]);
+        EXPECT_TRUE(selected[1] > 0);
+
+        /* Key 0 is falling after its peak */
+        s2n_test_now = base + half + (third / 2);
+        EXPECT_NOT_NULL(s2n_get_ticket_encrypt_decrypt_key(config));
+        EXPECT_EQUAL(index->schedule_start, base + half);
+        EXPECT_EQUAL(index->schedule_end, base + third + half);
+        key_0_weight = half - (s2n_test_now - (base + half));
+        key_1_weight = s2n_test_now - (base + third);
+        elapsed = s2n_test_now - index->schedule_start;
+        EXPECT_EQUAL(index->cumulative_slopes[1], 0);
+        EXPECT_EQUAL(index->cumulative_weights[1] + index->cumulative_slopes[1] * elapsed, key_0_weight + key_1_weight);
+    };
+
+    END_TEST();
+}
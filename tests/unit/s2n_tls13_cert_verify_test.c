@@ -77,10 +77,12 @@ S2N_RESULT s2n_cert_verify_connection_setup_and_send(
     }
 
     /* Hash initialization */
-    EXPECT_SUCCESS(s2n_hash_init(&sending_conn->handshake.hashes->sha256, S2N_HASH_SHA256));
-    EXPECT_SUCCESS(s2n_hash_update(&sending_conn->handshake.hashes->sha256, hello, sizeof(hello)));
-    EXPECT_SUCCESS(s2n_hash_init(&verifying_conn->handshake.hashes->sha256, S2N_HASH_SHA256));
-    EXPECT_SUCCESS(s2n_hash_update(&verifying_conn->handshake.hashes->sha256, hello, sizeof(hello)));
+    EXPECT_OK(s2n_handshake_hashes_activate(sending_conn->handshake.hashes, S2N_HASH_SHA256));
+    EXPECT_OK(s2n_handshake_hashes_activate(verifying_conn->handshake.hashes, S2N_HASH_SHA256));
+    EXPECT_SUCCESS(s2n_hash_init(sending_conn->handshake.hashes->transcript_hashes[S2N_HASH_SHA256], S2N_HASH_SHA256));
+    EXPECT_SUCCESS(s2n_hash_update(sending_conn->handshake.hashes->transcript_hashes[S2N_HASH_SHA256], hello, sizeof(hello)));
+    EXPECT_SUCCESS(s2n_hash_init(verifying_conn->handshake.hashes->transcript_hashes[S2N_HASH_SHA256], S2N_HASH_SHA256));
+    EXPECT_SUCCESS(s2n_hash_update(verifying_conn->handshake.hashes->transcript_hashes[S2N_HASH_SHA256], hello, sizeof(hello)));
 
     /* Send cert verify */
     EXPECT_SUCCESS(s2n_tls13_cert_verify_send(sending_conn));
@@ -166,12 +168,12 @@ int run_tests(const struct s2n_tls13_cert_verify_test *test_case, s2n_mode verif
         EXPECT_OK(s2n_cert_verify_connection_setup_and_send(sending_conn, verifying_conn, config, cert_chain, &sig_scheme, &cert));
 
         /* Update receive hash with goodbye */
-        EXPECT_SUCCESS(s2n_hash_update(&verifying_conn->handshake.hashes->sha256, goodbye, sizeof(goodbye)));
+        EXPECT_SUCCESS(s2n_hash_update(verifying_conn->handshake.hashes->transcript_hashes[S2N_HASH_SHA256], goodbye, sizeof(goodbye)));
 
         uint64_t verifying_bytes = 0;
         uint64_t sending_bytes = 0;
-        EXPECT_SUCCESS(s2n_hash_get_currently_in_hash_total(&verifying_conn->handshake.hashes->sha256, &verifying_bytes));
-        EXPECT_SUCCESS(s2n_hash_get_currently_in_hash_total(&sending_conn->handshake.hashes->sha256, &sending_bytes));
+        EXPECT_SUCCESS(s2n_hash_get_currently_in_hash_total(verifying_conn->handshake.hashes->transcript_hashes[S2N_HASH_SHA256], &verifying_bytes));
+        EXPECT_SUCCESS(s2n_hash_get_currently_in_hash_total(sending_conn->handshake.hashes->transcript_hashes[S2N_HASH_SHA256], &sending_bytes));
         EXPECT_NOT_EQUAL(sending_bytes, verifying_bytes);
 
         EXPECT_FAILURE_WITH_ERRNO(s2n_tls13_cert_verify_recv(verifying_conn), S2N_ERR_VERIFY_SIGNATURE);
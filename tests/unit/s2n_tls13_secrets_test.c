@@ -293,8 +293,27 @@ int main(int argc, char **argv)
             EXPECT_BYTEARRAY_NOT_EQUAL(conn->secrets.version.tls13.exporter_master_secret, empty_secret, sizeof(empty_secret));
             EXPECT_BYTEARRAY_NOT_EQUAL(conn->secrets.version.tls13.resumption_master_secret, empty_secret, sizeof(empty_secret));
 
+            /* The key schedule leaves the hmac keyed with the last extract secret */
+            struct s2n_hmac_state *hmac = NULL;
+            EXPECT_OK(s2n_prf_get_keyed_hmac(conn->prf_space, S2N_HMAC_SHA256, &test_secret, &hmac));
+            EXPECT_NOT_EQUAL(conn->prf_space->keyed_secret_size, 0);
+
             EXPECT_OK(s2n_tls13_secrets_clean(conn));
 
+            EXPECT_EQUAL(conn->prf_space->keyed_secret_size, 0);
+            EXPECT_BYTEARRAY_EQUAL(conn->prf_space->keyed_secret, empty_secret, sizeof(empty_secret));
+
+            /* The hmac no longer holds pad states derived from the secret */
+            uint8_t digest[SHA256_DIGEST_LENGTH] = { 0 };
+            EXPECT_SUCCESS(s2n_hmac_reset(hmac));
+            EXPECT_SUCCESS(s2n_hmac_digest(hmac, digest, sizeof(digest)));
+            DEFER_CLEANUP(struct s2n_hmac_state empty_key_hmac = { 0 }, s2n_hmac_free);
+            uint8_t expected[SHA256_DIGEST_LENGTH] = { 0 };
+            EXPECT_SUCCESS(s2n_hmac_new(&empty_key_hmac));
+            EXPECT_SUCCESS(s2n_hmac_init(&empty_key_hmac, S2N_HMAC_SHA256, empty_secret, 0));
+            EXPECT_SUCCESS(s2n_hmac_digest(&empty_key_hmac, expected, sizeof(expected)));
+            EXPECT_BYTEARRAY_EQUAL(digest, expected, sizeof(expected));
+
             EXPECT_BYTEARRAY_EQUAL(conn->secrets.version.tls13.extract_secret, empty_secret, sizeof(empty_secret));
             EXPECT_BYTEARRAY_EQUAL(conn->secrets.version.tls13.client_early_secret, empty_secret, sizeof(empty_secret));
             EXPECT_BYTEARRAY_EQUAL(conn->secrets.version.tls13.client_handshake_secret, empty_secret, sizeof(empty_secret));
@@ -444,6 +463,53 @@ int main(int argc, char **argv)
                     empty_secret, sizeof(empty_secret));
         };
 
+        /* Batched handshake secrets match secrets derived one at a time */
+        {
+            struct s2n_cipher_suite *suites[] = {
+                &s2n_tls13_aes_128_gcm_sha256,
+                &s2n_tls13_aes_256_gcm_sha384,
+            };
+            for (size_t i = 0; i < s2n_array_len(suites); i++) {
+                DEFER_CLEANUP(struct s2n_connection *batched = s2n_connection_new(S2N_SERVER),
+                        s2n_connection_ptr_free);
+                batched->secure->cipher_suite = suites[i];
+                batched->actual_protocol_version = S2N_TLS13;
+                EXPECT_OK(s2n_connection_set_test_handshake_secret(batched, &test_secret));
+                EXPECT_OK(s2n_connection_set_test_message_type(batched, SERVER_HELLO));
+                EXPECT_OK(s2n_tls13_secrets_update(batched));
+
+                DEFER_CLEANUP(struct s2n_connection *single = s2n_connection_new(S2N_SERVER),
+                        s2n_connection_ptr_free);
+                single->secure->cipher_suite = suites[i];
+                single->actual_protocol_version = S2N_TLS13;
+                EXPECT_OK(s2n_connection_set_test_handshake_secret(single, &test_secret));
+                EXPECT_OK(s2n_connection_set_test_message_type(single, SERVER_HELLO));
+                EXPECT_MEMCPY_SUCCESS(single->handshake.hashes->transcript_hash_digest,
+                        batched->handshake.hashes->transcript_hash_digest, S2N_TLS13_SECRET_MAX_LEN);
+
+                uint8_t size = 0;
+                EXPECT_SUCCESS(s2n_hmac_digest_size(suites[i]->prf_alg, &size));
+
+                uint8_t client_bytes[S2N_TLS13_SECRET_MAX_LEN] = { 0 };
+                struct s2n_blob client_secret = { 0 };
+                EXPECT_SUCCESS(s2n_blob_init(&client_secret, client_bytes, size));
+                EXPECT_OK(s2n_tls13_derive_secret(single, S2N_HANDSHAKE_SECRET, S2N_CLIENT, &client_secret));
+                EXPECT_BYTEARRAY_EQUAL(batched->secrets.version.tls13.client_handshake_secret, client_bytes, size);
+
+                uint8_t server_bytes[S2N_TLS13_SECRET_MAX_LEN] = { 0 };
+                struct s2n_blob server_secret = { 0 };
+                EXPECT_SUCCESS(s2n_blob_init(&server_secret, server_bytes, size));
+                EXPECT_OK(s2n_tls13_derive_secret(single, S2N_HANDSHAKE_SECRET, S2N_SERVER, &server_secret));
+                EXPECT_BYTEARRAY_EQUAL(batched->secrets.version.tls13.server_handshake_secret, server_bytes, size);
+
+                EXPECT_EQUAL(batched->handshake.finished_len, single->handshake.finished_len);
+                EXPECT_BYTEARRAY_EQUAL(batched->handshake.client_finished,
+                        single->handshake.client_finished, size);
+                EXPECT_BYTEARRAY_EQUAL(batched->handshake.server_finished,
+                        single->handshake.server_finished, size);
+            }
+        };
+
         /* Derives application secrets on SERVER_FINISHED */
         {
             DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER),
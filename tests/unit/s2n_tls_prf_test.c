@@ -35,6 +35,18 @@ S2N_RESULT s2n_prf_tls_extended_master_secret(struct s2n_connection *conn,
         struct s2n_blob *premaster_secret, struct s2n_blob *session_hash, struct s2n_blob *sha1_hash);
 int s2n_prf_tls_master_secret(struct s2n_connection *conn, struct s2n_blob *premaster_secret);
 
+static S2N_RESULT s2n_test_prf_with_new_connection(uint8_t protocol_version, struct s2n_blob *secret,
+        struct s2n_blob *label, struct s2n_blob *seed, struct s2n_blob *out)
+{
+    DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER),
+            s2n_connection_ptr_free);
+    RESULT_ENSURE_REF(conn);
+    conn->actual_protocol_version = protocol_version;
+    conn->secure->cipher_suite = &s2n_ecdhe_rsa_with_aes_128_gcm_sha256;
+    RESULT_GUARD_POSIX(s2n_prf(conn, secret, label, seed, NULL, NULL, out));
+    return S2N_RESULT_OK;
+}
+
 /*
  * Grabbed from gnutls-cli --insecure -d 9 www.example.com --ciphers AES --macs SHA --protocols TLS1.0
  *
@@ -259,6 +271,79 @@ int main(int argc, char **argv)
             /* The libcrypto PRF implementation will not modify the digest fields in the prf_space */
             EXPECT_EQUAL(memcmp(connection->prf_space->digest0, zeros, S2N_MAX_DIGEST_LEN), 0);
         }
+
+        /* The custom PRF implementation reuses the hmac keyed by a previous call with the same secret */
+        if (!s2n_is_in_fips_mode()) {
+            DEFER_CLEANUP(struct s2n_connection *conn = s2n_connection_new(S2N_SERVER),
+                    s2n_connection_ptr_free);
+            EXPECT_NOT_NULL(conn);
+            conn->actual_protocol_version = S2N_TLS12;
+            conn->secure->cipher_suite = &s2n_ecdhe_rsa_with_aes_128_gcm_sha256;
+            struct s2n_prf_working_space *ws = conn->prf_space;
+            EXPECT_EQUAL(ws->keyed_secret_size, 0);
+
+            uint8_t master_secret_bytes[S2N_TLS_SECRET_LEN] = { 0 };
+            EXPECT_MEMCPY_SUCCESS(master_secret_bytes, master_secret_in.data, sizeof(master_secret_bytes));
+            struct s2n_blob master_secret = { 0 };
+            EXPECT_SUCCESS(s2n_blob_init(&master_secret, master_secret_bytes, sizeof(master_secret_bytes)));
+
+            s2n_stack_blob(out, TEST_BLOB_SIZE, TEST_BLOB_SIZE);
+            s2n_stack_blob(expected, TEST_BLOB_SIZE, TEST_BLOB_SIZE);
+
+            /* The first call keys the hmac and remembers the secret */
+            EXPECT_SUCCESS(s2n_prf(conn, &master_secret, &label, &seed_a, NULL, NULL, &out));
+            EXPECT_OK(s2n_test_prf_with_new_connection(S2N_TLS12, &master_secret, &label, &seed_a, &expected));
+            EXPECT_BYTEARRAY_EQUAL(out.data, expected.data, expected.size);
+            EXPECT_EQUAL(ws->keyed_secret_size, master_secret.size);
+            EXPECT_BYTEARRAY_EQUAL(ws->keyed_secret, master_secret.data, master_secret.size);
+
+            /* Later calls with the same secret produce the same output as a freshly keyed hmac */
+            for (size_t i = 0; i < 3; i++) {
+                EXPECT_SUCCESS(s2n_prf(conn, &master_secret, &seed_b, &seed_a, NULL, NULL, &out));
+                EXPECT_OK(s2n_test_prf_with_new_connection(S2N_TLS12, &master_secret, &seed_b, &seed_a, &expected));
+                EXPECT_BYTEARRAY_EQUAL(out.data, expected.data, expected.size);
+                EXPECT_EQUAL(ws->keyed_secret_size, master_secret.size);
+                EXPECT_EQUAL(ws->keyed_alg, S2N_HMAC_SHA256);
+            }
+
+            /* Changing the secret in place re-keys the hmac */
+            master_secret_bytes[0] ^= 1;
+            EXPECT_SUCCESS(s2n_prf(conn, &master_secret, &label, &seed_a, NULL, NULL, &out));
+            EXPECT_OK(s2n_test_prf_with_new_connection(S2N_TLS12, &master_secret, &label, &seed_a, &expected));
+            EXPECT_BYTEARRAY_EQUAL(out.data, expected.data, expected.size);
+            EXPECT_BYTEARRAY_EQUAL(ws->keyed_secret, master_secret.data, master_secret.size);
+
+            /* A shorter prefix of the same secret is a different key */
+            struct s2n_blob short_secret = { 0 };
+            EXPECT_SUCCESS(s2n_blob_init(&short_secret, master_secret_bytes, sizeof(master_secret_bytes) - 1));
+            EXPECT_SUCCESS(s2n_prf(conn, &short_secret, &label, &seed_a, NULL, NULL, &out));
+            EXPECT_OK(s2n_test_prf_with_new_connection(S2N_TLS12, &short_secret, &label, &seed_a, &expected));
+            EXPECT_BYTEARRAY_EQUAL(out.data, expected.data, expected.size);
+            EXPECT_EQUAL(ws->keyed_secret_size, short_secret.size);
+
+            /* Secrets larger than a master secret are not remembered */
+            EXPECT_SUCCESS(s2n_prf(conn, &secret, &label, &seed_a, NULL, NULL, &out));
+            EXPECT_OK(s2n_test_prf_with_new_connection(S2N_TLS12, &secret, &label, &seed_a, &expected));
+            EXPECT_BYTEARRAY_EQUAL(out.data, expected.data, expected.size);
+            EXPECT_EQUAL(ws->keyed_secret_size, 0);
+
+            /* TLS1.0 and TLS1.1 alternate between MD5 and SHA1 halves of the secret */
+            conn->actual_protocol_version = S2N_TLS11;
+            for (size_t i = 0; i < 2; i++) {
+                EXPECT_SUCCESS(s2n_prf(conn, &master_secret, &label, &seed_a, NULL, NULL, &out));
+                EXPECT_OK(s2n_test_prf_with_new_connection(S2N_TLS11, &master_secret, &label, &seed_a, &expected));
+                EXPECT_BYTEARRAY_EQUAL(out.data, expected.data, expected.size);
+                EXPECT_EQUAL(ws->keyed_alg, S2N_HMAC_SHA1);
+            }
+
+            /* Wiping forgets the secret */
+            EXPECT_NOT_EQUAL(ws->keyed_secret_size, 0);
+            EXPECT_OK(s2n_prf_wipe(conn));
+            EXPECT_EQUAL(ws->keyed_secret_size, 0);
+            EXPECT_EQUAL(ws->keyed_alg, S2N_HMAC_NONE);
+            uint8_t zeros[S2N_TLS_SECRET_LEN] = { 0 };
+            EXPECT_BYTEARRAY_EQUAL(ws->keyed_secret, zeros, sizeof(zeros));
+        }
     }
 
     /* s2n_tls_prf_master_secret */
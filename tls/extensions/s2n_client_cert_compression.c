@@ -0,0 +1,102 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+
+#include "tls/extensions/s2n_client_cert_compression.h"
+
+#include <stdint.h>
+
+#include "tls/s2n_cert_compression.h"
+#include "tls/s2n_tls.h"
+#include "tls/s2n_tls_parameters.h"
+#include "utils/s2n_safety.h"
+
+static bool s2n_client_cert_compression_should_send(struct s2n_connection *conn);
+static int s2n_client_cert_compression_send(struct s2n_connection *conn, struct s2n_stuffer *out);
+static int s2n_client_cert_compression_recv(struct s2n_connection *conn, struct s2n_stuffer *extension);
+
+/**
+ *= https://www.rfc-editor.org/rfc/rfc8879#section-3
+ *# This extension is only supported with TLS 1.3 [RFC8446] and newer;
+ *# if TLS 1.2 [RFC5246] or earlier is negotiated, the peers MUST ignore
+ *# this extension.
+ */
+const s2n_extension_type s2n_client_cert_compression_extension = {
+    .iana_value = TLS_EXTENSION_COMPRESS_CERTIFICATE,
+    .minimum_version = S2N_TLS13,
+    .is_response = false,
+    .send = s2n_client_cert_compression_send,
+    .recv = s2n_client_cert_compression_recv,
+    .should_send = s2n_client_cert_compression_should_send,
+    .if_missing = s2n_extension_noop_if_missing,
+};
+
+static bool s2n_client_cert_compression_should_send(struct s2n_connection *conn)
+{
+    return conn->config->cert_compression_algorithms_count > 0;
+}
+
+/**
+ *= https://www.rfc-editor.org/rfc/rfc8879#section-3
+ *# struct {
+ *#     CertificateCompressionAlgorithm algorithms<2..2^8-2>;
+ *# } CertificateCompressionAlgorithms;
+ */
+static int s2n_client_cert_compression_send(struct s2n_connection *conn, struct s2n_stuffer *out)
+{
+    struct s2n_stuffer_reservation algorithms_size = { 0 };
+    POSIX_GUARD(s2n_stuffer_reserve_uint8(out, &algorithms_size));
+    for (size_t i = 0; i < conn->config->cert_compression_algorithms_count; i++) {
+        POSIX_GUARD(s2n_stuffer_write_uint16(out, conn->config->cert_compression_algorithms[i]));
+    }
+    POSIX_GUARD(s2n_stuffer_write_vector_size(&algorithms_size));
+    return S2N_SUCCESS;
+}
+
+static int s2n_client_cert_compression_recv(struct s2n_connection *conn, struct s2n_stuffer *extension)
+{
+    if (conn->config->cert_compression_algorithms_count == 0) {
+        return S2N_SUCCESS;
+    }
+
+    uint8_t algorithms_size = 0;
+    POSIX_GUARD(s2n_stuffer_read_uint8(extension, &algorithms_size));
+
+    /* For compatibility, we choose to ignore malformed extensions if they are optional */
+    if (algorithms_size < S2N_CERT_COMPRESSION_ALGORITHM_LEN
+            || algorithms_size % S2N_CERT_COMPRESSION_ALGORITHM_LEN != 0
+            || algorithms_size > s2n_stuffer_data_available(extension)) {
+        return S2N_SUCCESS;
+    }
+
+    uint8_t offered = 0;
+    for (size_t i = 0; i < algorithms_size / S2N_CERT_COMPRESSION_ALGORITHM_LEN; i++) {
+        uint16_t algorithm = 0;
+        POSIX_GUARD(s2n_stuffer_read_uint16(extension, &algorithm));
+        if (algorithm > 0 && algorithm <= S2N_CERT_COMPRESSION_ALGORITHMS_COUNT) {
+            offered |= (1 << algorithm);
+        }
+    }
+
+    /* Choose the first algorithm in the server's preference order that the client offered */
+    for (size_t i = 0; i < conn->config->cert_compression_algorithms_count; i++) {
+        uint8_t algorithm = conn->config->cert_compression_algorithms[i];
+        if (offered & (1 << algorithm)) {
+            conn->cert_compression_algorithm = algorithm;
+            return S2N_SUCCESS;
+        }
+    }
+    return S2N_SUCCESS;
+}
@@ -19,7 +19,9 @@
 #include <sys/param.h>
 
 #include "crypto/s2n_hash.h"
+#include "tls/s2n_early_data_replay.h"
 #include "tls/s2n_psk.h"
+#include "tls/s2n_psk_store.h"
 #include "tls/s2n_tls.h"
 #include "tls/s2n_tls_parameters.h"
 #include "utils/s2n_bitmap.h"
@@ -203,6 +205,7 @@ static int s2n_client_psk_send(struct s2n_connection *conn, struct s2n_stuffer *
 static S2N_RESULT s2n_select_external_psk(struct s2n_connection *conn, struct s2n_offered_psk_list *client_identity_list)
 {
     RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(conn->config);
     RESULT_ENSURE_REF(client_identity_list);
 
     struct s2n_array *server_psks = &conn->psk_params.psk_list;
@@ -229,6 +232,24 @@ static S2N_RESULT s2n_select_external_psk(struct s2n_connection *conn, struct s2
             wire_index++;
         };
     }
+
+    /* Otherwise, choose the first offered identity found in the config's PSK store */
+    struct s2n_psk_store *store = conn->config->psk_store;
+    if (conn->psk_params.chosen_psk == NULL && store) {
+        struct s2n_offered_psk client_psk = { 0 };
+        RESULT_GUARD_POSIX(s2n_offered_psk_list_reread(client_identity_list));
+        while (s2n_offered_psk_list_has_next(client_identity_list)) {
+            RESULT_GUARD_POSIX(s2n_offered_psk_list_next(client_identity_list, &client_psk));
+            struct s2n_psk *match = NULL;
+            RESULT_GUARD(s2n_psk_store_append_match(store, conn, &client_psk.identity, &match));
+            if (match) {
+                conn->psk_params.chosen_psk = match;
+                conn->psk_params.chosen_psk_wire_index = client_psk.wire_index;
+                break;
+            }
+        }
+    }
+
     RESULT_ENSURE_REF(conn->psk_params.chosen_psk);
     return S2N_RESULT_OK;
 }
@@ -281,6 +302,7 @@ static S2N_RESULT s2n_client_psk_recv_binder_list(struct s2n_connection *conn, s
         struct s2n_stuffer *wire_binders_in)
 {
     RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(conn->config);
     RESULT_ENSURE_REF(wire_binders_in);
 
     uint16_t wire_index = 0;
@@ -297,6 +319,11 @@ static S2N_RESULT s2n_client_psk_recv_binder_list(struct s2n_connection *conn, s
         if (wire_index == conn->psk_params.chosen_psk_wire_index) {
             RESULT_GUARD_POSIX(s2n_psk_verify_binder(conn, conn->psk_params.chosen_psk,
                     partial_client_hello, &wire_binder));
+            /* Binders are unique to each ClientHello, so identify replayed ClientHellos */
+            if (conn->config->early_data_replay_filter) {
+                RESULT_GUARD(s2n_early_data_replay_filter_hash(conn->config->early_data_replay_filter,
+                        &wire_binder, &conn->psk_params.chosen_psk_binder_hash));
+            }
             return S2N_RESULT_OK;
         }
         wire_index++;
@@ -79,28 +79,40 @@ int s2n_extension_supported_iana_value_to_id(const uint16_t iana_value, s2n_exte
     return S2N_SUCCESS;
 }
 
-int s2n_extension_send(const s2n_extension_type *extension_type, struct s2n_connection *conn, struct s2n_stuffer *out)
+S2N_RESULT s2n_extension_will_send(const s2n_extension_type *extension_type, struct s2n_connection *conn, bool *will_send)
 {
-    POSIX_ENSURE_REF(extension_type);
-    POSIX_ENSURE_REF(extension_type->should_send);
-    POSIX_ENSURE_REF(extension_type->send);
-    POSIX_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(extension_type);
+    RESULT_ENSURE_REF(extension_type->should_send);
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(will_send);
+    *will_send = false;
 
     s2n_extension_type_id extension_id = 0;
-    POSIX_GUARD(s2n_extension_supported_iana_value_to_id(extension_type->iana_value, &extension_id));
+    RESULT_GUARD_POSIX(s2n_extension_supported_iana_value_to_id(extension_type->iana_value, &extension_id));
 
     /* Do not send response if request not received. */
     if (extension_type->is_response && !S2N_CBIT_TEST(conn->extension_requests_received, extension_id)) {
-        return S2N_SUCCESS;
+        return S2N_RESULT_OK;
     }
 
     /* Do not send an extension that is not valid for the protocol version */
     if (extension_type->minimum_version > conn->actual_protocol_version) {
-        return S2N_SUCCESS;
+        return S2N_RESULT_OK;
     }
 
     /* Check if we need to send. Some extensions are only sent if specific conditions are met. */
-    if (!extension_type->should_send(conn)) {
+    *will_send = extension_type->should_send(conn);
+    return S2N_RESULT_OK;
+}
+
+int s2n_extension_send(const s2n_extension_type *extension_type, struct s2n_connection *conn, struct s2n_stuffer *out)
+{
+    POSIX_ENSURE_REF(extension_type);
+    POSIX_ENSURE_REF(extension_type->send);
+
+    bool will_send = false;
+    POSIX_GUARD_RESULT(s2n_extension_will_send(extension_type, conn, &will_send));
+    if (!will_send) {
         return S2N_SUCCESS;
     }
 
@@ -132,6 +144,8 @@ int s2n_extension_send(const s2n_extension_type *extension_type, struct s2n_conn
 
     /* Set request bit flag */
     if (!extension_type->is_response) {
+        s2n_extension_type_id extension_id = 0;
+        POSIX_GUARD(s2n_extension_supported_iana_value_to_id(extension_type->iana_value, &extension_id));
         S2N_CBIT_SET(conn->extension_requests_sent, extension_id);
     }
 
@@ -69,6 +69,7 @@ static const uint16_t s2n_supported_extensions[] = {
     TLS_EXTENSION_EMS,
     TLS_EXTENSION_NPN,
     TLS_EXTENSION_CERT_AUTHORITIES,
+    TLS_EXTENSION_COMPRESS_CERTIFICATE,
 };
 
 typedef char s2n_extension_bitfield[S2N_SUPPORTED_EXTENSIONS_BITFIELD_LEN];
@@ -76,6 +77,8 @@ typedef char s2n_extension_bitfield[S2N_SUPPORTED_EXTENSIONS_BITFIELD_LEN];
 typedef uint8_t s2n_extension_type_id;
 extern const s2n_extension_type_id s2n_unsupported_extension;
 
+/* Whether s2n_extension_send would write the extension for this connection */
+S2N_RESULT s2n_extension_will_send(const s2n_extension_type *extension_type, struct s2n_connection *conn, bool *will_send);
 int s2n_extension_send(const s2n_extension_type *extension_type, struct s2n_connection *conn, struct s2n_stuffer *out);
 int s2n_extension_recv(const s2n_extension_type *extension_type, struct s2n_connection *conn, struct s2n_stuffer *in);
 int s2n_extension_is_missing(const s2n_extension_type *extension_type, struct s2n_connection *conn);
@@ -20,6 +20,7 @@
 #include "tls/extensions/s2n_cert_status.h"
 #include "tls/extensions/s2n_cert_status_response.h"
 #include "tls/extensions/s2n_client_alpn.h"
+#include "tls/extensions/s2n_client_cert_compression.h"
 #include "tls/extensions/s2n_client_cert_status_request.h"
 #include "tls/extensions/s2n_client_key_share.h"
 #include "tls/extensions/s2n_client_max_frag_len.h"
@@ -81,6 +82,7 @@ static const s2n_extension_type *const client_hello_extensions[] = {
     &s2n_psk_key_exchange_modes_extension,
     &s2n_client_early_data_indication_extension,
     &s2n_client_ems_extension,
+    &s2n_client_cert_compression_extension,
     &s2n_client_psk_extension /* MUST be last */
 };
 
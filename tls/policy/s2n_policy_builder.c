@@ -150,6 +150,15 @@ int s2n_security_policy_free(struct s2n_security_policy **policy_ptr)
     return S2N_SUCCESS;
 }
 
+const struct s2n_security_policy *s2n_security_policy_from_version(const char *version)
+{
+    PTR_ENSURE(version, S2N_ERR_INVALID_ARGUMENT);
+    const struct s2n_security_policy *policy = NULL;
+    PTR_GUARD_POSIX(s2n_find_security_policy_from_version(version, &policy));
+    PTR_ENSURE_REF(policy);
+    return policy;
+}
+
 struct s2n_security_policy_builder *s2n_security_policy_builder_from_version(const char *version)
 {
     PTR_ENSURE(version, S2N_ERR_INVALID_ARGUMENT);
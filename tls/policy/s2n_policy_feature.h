@@ -17,6 +17,8 @@
 
 #include <s2n.h>
 
+#include "api/unstable/policy.h"
+
 struct s2n_security_policy;
 
 /**
@@ -87,18 +89,6 @@ typedef enum {
  */
 const struct s2n_security_policy *s2n_security_policy_get(s2n_policy_name policy, uint64_t version);
 
-/**
- * Sets the security policy on the config.
- *
- * "security policies" were previously known as "cipher preferences".
- * See `s2n_config_set_cipher_preferences`.
- *
- * @param config The config object being updated
- * @param policy The security policy being set
- * @returns S2N_SUCCESS on success. S2N_FAILURE on failure
- */
-int s2n_config_set_security_policy(struct s2n_config *config, const struct s2n_security_policy *policy);
-
 /**
  * Sets an override security policy on the connection.
  *
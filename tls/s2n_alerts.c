@@ -75,6 +75,13 @@ static S2N_RESULT s2n_translate_protocol_error_to_alert(int error_code, uint8_t
         S2N_ALERT_CASE(S2N_ERR_CERT_UNTRUSTED, S2N_TLS_ALERT_CERTIFICATE_UNKNOWN);
         S2N_ALERT_CASE(S2N_ERR_CERT_UNHANDLED_CRITICAL_EXTENSION, S2N_TLS_ALERT_CERTIFICATE_UNKNOWN);
 
+        /*
+         *= https://www.rfc-editor.org/rfc/rfc8879#section-4
+         *# If the received CompressedCertificate message cannot be decompressed,
+         *# the connection MUST be terminated with the "bad_certificate" alert.
+         */
+        S2N_ALERT_CASE(S2N_ERR_CERT_DECOMPRESSION, S2N_TLS_ALERT_BAD_CERTIFICATE);
+
         /*
          *= https://www.rfc-editor.org/rfc/rfc8446#section-6.2
          *# certificate_revoked:  A certificate was revoked by its signer.
@@ -24,6 +24,7 @@
 #include "utils/s2n_mem.h"
 #include "utils/s2n_result.h"
 #include "utils/s2n_safety.h"
+#include "utils/s2n_usdt.h"
 
 S2N_RESULT s2n_async_offload_cb_invoke(struct s2n_connection *conn, struct s2n_async_offload_op *op)
 {
@@ -37,6 +38,8 @@ S2N_RESULT s2n_async_offload_cb_invoke(struct s2n_connection *conn, struct s2n_a
     RESULT_ENSURE(op->async_state == S2N_ASYNC_NOT_INVOKED, S2N_ERR_ASYNC_MORE_THAN_ONE);
 
     op->async_state = S2N_ASYNC_INVOKED;
+    RESULT_GUARD(s2n_handshake_timings_begin(conn, S2N_HANDSHAKE_TIMING_ASYNC_OFFLOAD));
+    S2N_USDT_PROBE2(async_start, conn, S2N_HANDSHAKE_TIMING_ASYNC_OFFLOAD);
     RESULT_ENSURE(conn->config->async_offload_cb(conn, op, conn->config->async_offload_ctx) == S2N_SUCCESS,
             S2N_ERR_CANCELLED);
 
@@ -89,6 +92,11 @@ S2N_RESULT s2n_async_offload_op_reset(struct s2n_async_offload_op *op)
     }
 
     RESULT_ENSURE(op->async_state == S2N_ASYNC_COMPLETE, S2N_ERR_INVALID_STATE);
+    /* s2n_async_offload_op_perform may run on another thread, so the operation is only
+     * considered finished once the handshake observes the result.
+     */
+    RESULT_GUARD(s2n_handshake_timings_end(op->conn, S2N_HANDSHAKE_TIMING_ASYNC_OFFLOAD));
+    S2N_USDT_PROBE2(async_done, op->conn, S2N_HANDSHAKE_TIMING_ASYNC_OFFLOAD);
     RESULT_GUARD(s2n_async_offload_op_wipe(op));
     return S2N_RESULT_OK;
 }
@@ -25,6 +25,7 @@
 #include "utils/s2n_mem.h"
 #include "utils/s2n_result.h"
 #include "utils/s2n_safety.h"
+#include "utils/s2n_usdt.h"
 
 struct s2n_async_pkey_decrypt_data {
     s2n_async_pkey_decrypt_complete on_complete;
@@ -151,10 +152,14 @@ S2N_RESULT s2n_async_pkey_decrypt(struct s2n_connection *conn, struct s2n_blob *
     RESULT_ENSURE_REF(init_decrypted);
     RESULT_ENSURE_REF(on_complete);
 
+    RESULT_GUARD(s2n_handshake_timings_begin(conn, S2N_HANDSHAKE_TIMING_PKEY));
+    S2N_USDT_PROBE2(async_start, conn, S2N_HANDSHAKE_TIMING_PKEY);
     if (conn->config->async_pkey_cb) {
         RESULT_GUARD(s2n_async_pkey_decrypt_async(conn, encrypted, init_decrypted, on_complete));
     } else {
         RESULT_GUARD(s2n_async_pkey_decrypt_sync(conn, encrypted, init_decrypted, on_complete));
+        RESULT_GUARD(s2n_handshake_timings_end(conn, S2N_HANDSHAKE_TIMING_PKEY));
+        S2N_USDT_PROBE2(async_done, conn, S2N_HANDSHAKE_TIMING_PKEY);
     }
 
     return S2N_RESULT_OK;
@@ -233,10 +238,14 @@ S2N_RESULT s2n_async_pkey_sign(struct s2n_connection *conn, s2n_signature_algori
     RESULT_ENSURE_REF(digest);
     RESULT_ENSURE_REF(on_complete);
 
+    RESULT_GUARD(s2n_handshake_timings_begin(conn, S2N_HANDSHAKE_TIMING_PKEY));
+    S2N_USDT_PROBE2(async_start, conn, S2N_HANDSHAKE_TIMING_PKEY);
     if (conn->config->async_pkey_cb) {
         RESULT_GUARD(s2n_async_pkey_sign_async(conn, sig_alg, digest, on_complete));
     } else {
         RESULT_GUARD(s2n_async_pkey_sign_sync(conn, sig_alg, digest, on_complete));
+        RESULT_GUARD(s2n_handshake_timings_end(conn, S2N_HANDSHAKE_TIMING_PKEY));
+        S2N_USDT_PROBE2(async_done, conn, S2N_HANDSHAKE_TIMING_PKEY);
     }
 
     return S2N_RESULT_OK;
@@ -338,6 +347,8 @@ int s2n_async_pkey_op_apply(struct s2n_async_pkey_op *op, struct s2n_connection
 
     op->applied = true;
     conn->handshake.async_state = S2N_ASYNC_COMPLETE;
+    POSIX_GUARD_RESULT(s2n_handshake_timings_end(conn, S2N_HANDSHAKE_TIMING_PKEY));
+    S2N_USDT_PROBE2(async_done, conn, S2N_HANDSHAKE_TIMING_PKEY);
 
     /* Free up the decrypt/sign structs to avoid storing secrets for too long */
     POSIX_GUARD_RESULT(actions->free(op));
@@ -0,0 +1,480 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_cert_compression.h"
+
+#if S2N_ZLIB_SUPPORTED
+    #include <zlib.h>
+#endif
+#if S2N_BROTLI_SUPPORTED
+    #include <brotli/decode.h>
+    #include <brotli/encode.h>
+#endif
+#if S2N_ZSTD_SUPPORTED
+    #include <zstd.h>
+#endif
+
+#include "tls/extensions/s2n_extension_type_lists.h"
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_tls.h"
+#include "utils/s2n_atomic.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+/* Each implementation compresses `in` into `out`, which is allocated with enough
+ * space for the worst case, and shrinks `out->size` to the compressed size.
+ * Decompression must exactly fill `out`, which is allocated with the size the
+ * peer claimed for the uncompressed message.
+ */
+struct s2n_cert_compression_impl {
+    uint32_t (*compress_bound)(uint32_t size);
+    S2N_RESULT (*compress)(const struct s2n_blob *in, struct s2n_blob *out);
+    S2N_RESULT (*decompress)(const struct s2n_blob *in, struct s2n_blob *out);
+};
+
+#if S2N_ZLIB_SUPPORTED
+static uint32_t s2n_zlib_compress_bound(uint32_t size)
+{
+    return compressBound(size);
+}
+
+static S2N_RESULT s2n_zlib_compress(const struct s2n_blob *in, struct s2n_blob *out)
+{
+    uLongf out_size = out->size;
+    RESULT_ENSURE(compress2(out->data, &out_size, in->data, in->size, Z_BEST_COMPRESSION) == Z_OK,
+            S2N_ERR_CERT_COMPRESSION);
+    RESULT_ENSURE_LTE(out_size, out->size);
+    out->size = out_size;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_zlib_decompress(const struct s2n_blob *in, struct s2n_blob *out)
+{
+    uLongf out_size = out->size;
+    RESULT_ENSURE(uncompress(out->data, &out_size, in->data, in->size) == Z_OK, S2N_ERR_CERT_DECOMPRESSION);
+    RESULT_ENSURE(out_size == out->size, S2N_ERR_CERT_DECOMPRESSION);
+    return S2N_RESULT_OK;
+}
+
+static const struct s2n_cert_compression_impl s2n_zlib_impl = {
+    .compress_bound = s2n_zlib_compress_bound,
+    .compress = s2n_zlib_compress,
+    .decompress = s2n_zlib_decompress,
+};
+#endif
+
+#if S2N_BROTLI_SUPPORTED
+static uint32_t s2n_brotli_compress_bound(uint32_t size)
+{
+    return BrotliEncoderMaxCompressedSize(size);
+}
+
+static S2N_RESULT s2n_brotli_compress(const struct s2n_blob *in, struct s2n_blob *out)
+{
+    size_t out_size = out->size;
+    RESULT_ENSURE(BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC,
+                          in->size, in->data, &out_size, out->data)
+                    == BROTLI_TRUE,
+            S2N_ERR_CERT_COMPRESSION);
+    RESULT_ENSURE_LTE(out_size, out->size);
+    out->size = out_size;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_brotli_decompress(const struct s2n_blob *in, struct s2n_blob *out)
+{
+    size_t out_size = out->size;
+    RESULT_ENSURE(BrotliDecoderDecompress(in->size, in->data, &out_size, out->data) == BROTLI_DECODER_RESULT_SUCCESS,
+            S2N_ERR_CERT_DECOMPRESSION);
+    RESULT_ENSURE(out_size == out->size, S2N_ERR_CERT_DECOMPRESSION);
+    return S2N_RESULT_OK;
+}
+
+static const struct s2n_cert_compression_impl s2n_brotli_impl = {
+    .compress_bound = s2n_brotli_compress_bound,
+    .compress = s2n_brotli_compress,
+    .decompress = s2n_brotli_decompress,
+};
+#endif
+
+#if S2N_ZSTD_SUPPORTED
+static uint32_t s2n_zstd_compress_bound(uint32_t size)
+{
+    return ZSTD_compressBound(size);
+}
+
+static S2N_RESULT s2n_zstd_compress(const struct s2n_blob *in, struct s2n_blob *out)
+{
+    size_t out_size = ZSTD_compress(out->data, out->size, in->data, in->size, ZSTD_maxCLevel());
+    RESULT_ENSURE(!ZSTD_isError(out_size), S2N_ERR_CERT_COMPRESSION);
+    RESULT_ENSURE_LTE(out_size, out->size);
+    out->size = out_size;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_zstd_decompress(const struct s2n_blob *in, struct s2n_blob *out)
+{
+    size_t out_size = ZSTD_decompress(out->data, out->size, in->data, in->size);
+    RESULT_ENSURE(!ZSTD_isError(out_size), S2N_ERR_CERT_DECOMPRESSION);
+    RESULT_ENSURE(out_size == out->size, S2N_ERR_CERT_DECOMPRESSION);
+    return S2N_RESULT_OK;
+}
+
+static const struct s2n_cert_compression_impl s2n_zstd_impl = {
+    .compress_bound = s2n_zstd_compress_bound,
+    .compress = s2n_zstd_compress,
+    .decompress = s2n_zstd_decompress,
+};
+#endif
+
+static const struct s2n_cert_compression_impl *s2n_cert_compression_get_impl(uint16_t algorithm)
+{
+    switch (algorithm) {
+#if S2N_ZLIB_SUPPORTED
+        case S2N_CERT_COMPRESSION_ZLIB:
+            return &s2n_zlib_impl;
+#endif
+#if S2N_BROTLI_SUPPORTED
+        case S2N_CERT_COMPRESSION_BROTLI:
+            return &s2n_brotli_impl;
+#endif
+#if S2N_ZSTD_SUPPORTED
+        case S2N_CERT_COMPRESSION_ZSTD:
+            return &s2n_zstd_impl;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+bool s2n_cert_compression_is_supported(s2n_cert_compression_algorithm algorithm)
+{
+    return s2n_cert_compression_get_impl(algorithm) != NULL;
+}
+
+static bool s2n_cert_compression_is_offered(const struct s2n_config *config, uint16_t algorithm)
+{
+    for (size_t i = 0; i < config->cert_compression_algorithms_count; i++) {
+        if (config->cert_compression_algorithms[i] == algorithm) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool s2n_cert_compression_is_negotiated(struct s2n_connection *conn)
+{
+    return conn && conn->mode == S2N_SERVER
+            && conn->actual_protocol_version >= S2N_TLS13
+            && conn->cert_compression_algorithm != 0;
+}
+
+S2N_RESULT s2n_cert_compression_validate_recv(struct s2n_connection *conn)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(conn->config);
+
+    /**
+     *= https://www.rfc-editor.org/rfc/rfc8879#section-4
+     *# If the peer has indicated that it supports compression, server and
+     *# client MAY compress their corresponding Certificate messages
+     *
+     * We only offer compression as a client, so only the server may compress.
+     */
+    RESULT_ENSURE(conn->mode == S2N_CLIENT, S2N_ERR_BAD_MESSAGE);
+    RESULT_ENSURE(conn->actual_protocol_version >= S2N_TLS13, S2N_ERR_BAD_MESSAGE);
+    RESULT_ENSURE(conn->config->cert_compression_algorithms_count > 0, S2N_ERR_BAD_MESSAGE);
+    return S2N_RESULT_OK;
+}
+
+/* Writes the TLS1.3 Certificate message that a server sends when no
+ * per-certificate extensions apply. This matches s2n_send_cert_chain,
+ * preceded by the empty certificate_request_context.
+ */
+S2N_RESULT s2n_cert_compression_write_certificate(struct s2n_cert_chain_and_key *chain_and_key, struct s2n_stuffer *out)
+{
+    RESULT_ENSURE_REF(chain_and_key);
+    RESULT_ENSURE_REF(chain_and_key->cert_chain);
+
+    RESULT_GUARD_POSIX(s2n_stuffer_write_uint8(out, 0));
+
+    struct s2n_stuffer_reservation cert_chain_size = { 0 };
+    RESULT_GUARD_POSIX(s2n_stuffer_reserve_uint24(out, &cert_chain_size));
+    for (struct s2n_cert *cert = chain_and_key->cert_chain->head; cert; cert = cert->next) {
+        RESULT_GUARD_POSIX(s2n_stuffer_write_uint24(out, cert->raw.size));
+        RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(out, cert->raw.data, cert->raw.size));
+        RESULT_GUARD_POSIX(s2n_stuffer_write_uint16(out, 0));
+    }
+    RESULT_GUARD_POSIX(s2n_stuffer_write_vector_size(&cert_chain_size));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_cert_compression_compress(const struct s2n_cert_compression_impl *impl,
+        const struct s2n_blob *in, struct s2n_blob *out)
+{
+    RESULT_ENSURE_REF(impl);
+    RESULT_GUARD_POSIX(s2n_alloc(out, impl->compress_bound(in->size)));
+    RESULT_GUARD(impl->compress(in, out));
+    return S2N_RESULT_OK;
+}
+
+static int s2n_compressed_cert_free(struct s2n_compressed_cert **compressed)
+{
+    if (compressed && *compressed) {
+        POSIX_GUARD(s2n_free(&(*compressed)->data));
+        POSIX_GUARD(s2n_free_object((uint8_t **) compressed, sizeof(struct s2n_compressed_cert)));
+    }
+    return S2N_SUCCESS;
+}
+
+/* Compresses an uncompressed Certificate message and publishes it to `slot`,
+ * unless another thread published the same message first.
+ */
+static S2N_RESULT s2n_cert_compression_publish(const struct s2n_cert_compression_impl *impl,
+        const struct s2n_blob *uncompressed, struct s2n_compressed_cert **slot)
+{
+    RESULT_ENSURE_REF(slot);
+
+    DEFER_CLEANUP(struct s2n_compressed_cert *compressed = NULL, s2n_compressed_cert_free);
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_compressed_cert)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+    compressed = (struct s2n_compressed_cert *) (void *) mem.data;
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+
+    RESULT_GUARD(s2n_cert_compression_compress(impl, uncompressed, &compressed->data));
+    compressed->uncompressed_length = uncompressed->size;
+
+    if (s2n_atomic_ptr_compare_exchange((void **) slot, NULL, compressed)) {
+        compressed = NULL;
+    }
+    return S2N_RESULT_OK;
+}
+
+/* Identifies which of the per-certificate extensions the connection's Certificate
+ * message carries, so that connections sending identical messages share one
+ * compressed copy. Bit i is set if the i-th S2N_EXTENSION_LIST_CERTIFICATE entry is sent.
+ */
+static S2N_RESULT s2n_cert_compression_get_variant(struct s2n_connection *conn, uint8_t *variant)
+{
+    RESULT_ENSURE_REF(variant);
+    *variant = 0;
+
+    s2n_extension_type_list *extensions = NULL;
+    RESULT_GUARD_POSIX(s2n_extension_type_list_get(S2N_EXTENSION_LIST_CERTIFICATE, &extensions));
+    RESULT_ENSURE_REF(extensions);
+    RESULT_ENSURE_EQ(extensions->count, S2N_CERT_COMPRESSION_EXTENSIONS_COUNT);
+
+    for (size_t i = 0; i < extensions->count; i++) {
+        bool will_send = false;
+        RESULT_GUARD(s2n_extension_will_send(extensions->extension_types[i], conn, &will_send));
+        if (will_send) {
+            *variant |= (1 << i);
+        }
+    }
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_cert_compression_precompress_chain(const struct s2n_config *config,
+        struct s2n_cert_chain_and_key *chain_and_key)
+{
+    RESULT_ENSURE_REF(config);
+    RESULT_ENSURE_REF(chain_and_key);
+
+    if (config->cert_compression_algorithms_count == 0) {
+        return S2N_RESULT_OK;
+    }
+
+    DEFER_CLEANUP(struct s2n_stuffer certificate = { 0 }, s2n_stuffer_free);
+    RESULT_GUARD_POSIX(s2n_stuffer_growable_alloc(&certificate, 0));
+    RESULT_GUARD(s2n_cert_compression_write_certificate(chain_and_key, &certificate));
+
+    struct s2n_blob uncompressed = { 0 };
+    uint32_t uncompressed_len = s2n_stuffer_data_available(&certificate);
+    RESULT_GUARD_POSIX(s2n_blob_init(&uncompressed, s2n_stuffer_raw_read(&certificate, uncompressed_len), uncompressed_len));
+    RESULT_ENSURE_REF(uncompressed.data);
+
+    for (size_t i = 0; i < config->cert_compression_algorithms_count; i++) {
+        uint8_t algorithm = config->cert_compression_algorithms[i];
+        RESULT_ENSURE_GT(algorithm, 0);
+        RESULT_ENSURE_LTE(algorithm, S2N_CERT_COMPRESSION_ALGORITHMS_COUNT);
+
+        struct s2n_compressed_cert **slot = &chain_and_key->compressed_certs[algorithm - 1][0];
+        if (s2n_atomic_ptr_load((void **) slot)) {
+            continue;
+        }
+        RESULT_GUARD(s2n_cert_compression_publish(s2n_cert_compression_get_impl(algorithm), &uncompressed, slot));
+    }
+
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_cert_compression_precompress_certs_by_type(const struct certs_by_type *certs, void *ctx)
+{
+    const struct s2n_config *config = ctx;
+    for (size_t i = 0; i < S2N_CERT_TYPE_COUNT; i++) {
+        if (certs->certs[i]) {
+            RESULT_GUARD(s2n_cert_compression_precompress_chain(config, certs->certs[i]));
+        }
+    }
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_cert_compression_precompress_config(struct s2n_config *config)
+{
+    RESULT_GUARD(s2n_cert_compression_precompress_certs_by_type(&config->default_certs_by_type, config));
+
+    if (config->domain_name_to_cert_trie == NULL) {
+        return S2N_RESULT_OK;
+    }
+    RESULT_GUARD(s2n_sni_trie_visit(config->domain_name_to_cert_trie,
+            s2n_cert_compression_precompress_certs_by_type, config));
+    return S2N_RESULT_OK;
+}
+
+int s2n_config_set_cert_compression_preferences(struct s2n_config *config,
+        const s2n_cert_compression_algorithm *algorithms, uint8_t count)
+{
+    POSIX_ENSURE_REF(config);
+    POSIX_ENSURE(count <= S2N_CERT_COMPRESSION_ALGORITHMS_COUNT, S2N_ERR_INVALID_ARGUMENT);
+    if (count > 0) {
+        POSIX_ENSURE_REF(algorithms);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        POSIX_ENSURE(s2n_cert_compression_is_supported(algorithms[i]), S2N_ERR_INVALID_ARGUMENT);
+        for (size_t j = 0; j < i; j++) {
+            POSIX_ENSURE(algorithms[i] != algorithms[j], S2N_ERR_INVALID_ARGUMENT);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        config->cert_compression_algorithms[i] = algorithms[i];
+    }
+    config->cert_compression_algorithms_count = count;
+
+    POSIX_GUARD_RESULT(s2n_cert_compression_precompress_config(config));
+    return S2N_SUCCESS;
+}
+
+int s2n_connection_get_cert_compression_algorithm(struct s2n_connection *conn,
+        s2n_cert_compression_algorithm *algorithm)
+{
+    POSIX_ENSURE_REF(conn);
+    POSIX_ENSURE_REF(algorithm);
+    POSIX_ENSURE(conn->cert_compression_algorithm != 0, S2N_ERR_INVALID_STATE);
+    *algorithm = conn->cert_compression_algorithm;
+    return S2N_SUCCESS;
+}
+
+/**
+ *= https://www.rfc-editor.org/rfc/rfc8879#section-4
+ *# struct {
+ *#      CertificateCompressionAlgorithm algorithm;
+ *#      uint24 uncompressed_length;
+ *#      opaque compressed_certificate_message<1..2^24-1>;
+ *# } CompressedCertificate;
+ */
+S2N_RESULT s2n_compressed_cert_send(struct s2n_connection *conn, struct s2n_stuffer *out)
+{
+    RESULT_ENSURE_REF(conn);
+    struct s2n_cert_chain_and_key *chain_and_key = conn->handshake_params.our_chain_and_key;
+    RESULT_ENSURE_REF(chain_and_key);
+
+    uint8_t algorithm = conn->cert_compression_algorithm;
+    const struct s2n_cert_compression_impl *impl = s2n_cert_compression_get_impl(algorithm);
+    RESULT_ENSURE_REF(impl);
+
+    uint8_t variant = 0;
+    RESULT_GUARD(s2n_cert_compression_get_variant(conn, &variant));
+    RESULT_ENSURE_LT(variant, S2N_CERT_COMPRESSION_VARIANTS_COUNT);
+    struct s2n_compressed_cert **slot = &chain_and_key->compressed_certs[algorithm - 1][variant];
+
+    /* The first connection to send a message with this chain, algorithm, and set of
+     * extensions compresses it. Every later connection only copies the result.
+     * The server's certificate_request_context is always empty.
+     */
+    const struct s2n_compressed_cert *compressed = s2n_atomic_ptr_load((void **) slot);
+    if (compressed == NULL) {
+        DEFER_CLEANUP(struct s2n_stuffer certificate = { 0 }, s2n_stuffer_free);
+        RESULT_GUARD_POSIX(s2n_stuffer_growable_alloc(&certificate, 0));
+        RESULT_GUARD_POSIX(s2n_stuffer_write_uint8(&certificate, 0));
+        RESULT_GUARD_POSIX(s2n_send_cert_chain(conn, &certificate, chain_and_key));
+
+        struct s2n_blob uncompressed = { 0 };
+        uint32_t uncompressed_len = s2n_stuffer_data_available(&certificate);
+        RESULT_GUARD_POSIX(s2n_blob_init(&uncompressed, s2n_stuffer_raw_read(&certificate, uncompressed_len), uncompressed_len));
+        RESULT_ENSURE_REF(uncompressed.data);
+
+        RESULT_GUARD(s2n_cert_compression_publish(impl, &uncompressed, slot));
+        compressed = s2n_atomic_ptr_load((void **) slot);
+        RESULT_ENSURE_REF(compressed);
+    }
+
+    RESULT_GUARD_POSIX(s2n_stuffer_write_uint16(out, algorithm));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_uint24(out, compressed->uncompressed_length));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_uint24(out, compressed->data.size));
+    RESULT_GUARD_POSIX(s2n_stuffer_write(out, &compressed->data));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_compressed_cert_recv(struct s2n_connection *conn, struct s2n_stuffer *in,
+        struct s2n_stuffer *certificate)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(conn->config);
+    RESULT_GUARD(s2n_cert_compression_validate_recv(conn));
+
+    uint16_t algorithm = 0;
+    RESULT_GUARD_POSIX(s2n_stuffer_read_uint16(in, &algorithm));
+
+    /**
+     *= https://www.rfc-editor.org/rfc/rfc8879#section-4
+     *# If the received CompressedCertificate message cannot be decompressed,
+     *# the connection MUST be terminated with the "bad_certificate" alert.
+     *
+     * That includes algorithms that we never offered.
+     */
+    RESULT_ENSURE(s2n_cert_compression_is_offered(conn->config, algorithm), S2N_ERR_CERT_DECOMPRESSION);
+    const struct s2n_cert_compression_impl *impl = s2n_cert_compression_get_impl(algorithm);
+    RESULT_ENSURE(impl, S2N_ERR_CERT_DECOMPRESSION);
+
+    /* Bound the decompressed size by the size we would accept for an
+     * uncompressed Certificate message.
+     */
+    uint32_t uncompressed_len = 0;
+    RESULT_GUARD_POSIX(s2n_stuffer_read_uint24(in, &uncompressed_len));
+    RESULT_ENSURE(uncompressed_len > 0, S2N_ERR_BAD_MESSAGE);
+    RESULT_ENSURE(uncompressed_len <= S2N_MAXIMUM_HANDSHAKE_MESSAGE_LENGTH, S2N_ERR_CERT_DECOMPRESSION);
+
+    uint32_t compressed_len = 0;
+    RESULT_GUARD_POSIX(s2n_stuffer_read_uint24(in, &compressed_len));
+    RESULT_ENSURE(compressed_len > 0, S2N_ERR_BAD_MESSAGE);
+    RESULT_ENSURE(compressed_len == s2n_stuffer_data_available(in), S2N_ERR_BAD_MESSAGE);
+
+    struct s2n_blob compressed = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&compressed, s2n_stuffer_raw_read(in, compressed_len), compressed_len));
+    RESULT_ENSURE_REF(compressed.data);
+
+    RESULT_GUARD_POSIX(s2n_stuffer_alloc(certificate, uncompressed_len));
+    struct s2n_blob uncompressed = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&uncompressed, s2n_stuffer_raw_write(certificate, uncompressed_len), uncompressed_len));
+    RESULT_ENSURE_REF(uncompressed.data);
+    RESULT_GUARD(impl->decompress(&compressed, &uncompressed));
+
+    conn->cert_compression_algorithm = algorithm;
+    return S2N_RESULT_OK;
+}
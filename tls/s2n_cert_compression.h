@@ -0,0 +1,36 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include "api/unstable/cert_compression.h"
+#include "crypto/s2n_certificate.h"
+#include "stuffer/s2n_stuffer.h"
+#include "utils/s2n_result.h"
+
+struct s2n_config;
+struct s2n_connection;
+
+/* https://www.rfc-editor.org/rfc/rfc8879#section-4 */
+#define S2N_CERT_COMPRESSION_ALGORITHM_LEN 2
+
+bool s2n_cert_compression_is_negotiated(struct s2n_connection *conn);
+S2N_RESULT s2n_cert_compression_validate_recv(struct s2n_connection *conn);
+
+S2N_RESULT s2n_cert_compression_precompress_chain(const struct s2n_config *config, struct s2n_cert_chain_and_key *chain_and_key);
+S2N_RESULT s2n_cert_compression_write_certificate(struct s2n_cert_chain_and_key *chain_and_key, struct s2n_stuffer *out);
+
+S2N_RESULT s2n_compressed_cert_send(struct s2n_connection *conn, struct s2n_stuffer *out);
+S2N_RESULT s2n_compressed_cert_recv(struct s2n_connection *conn, struct s2n_stuffer *in, struct s2n_stuffer *certificate);
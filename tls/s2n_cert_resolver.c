@@ -0,0 +1,435 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_cert_resolver.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include "tls/s2n_alerts.h"
+#include "tls/s2n_cert_compression.h"
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_security_policies.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+/* Keep the bucket array size well within uint32_t */
+#define S2N_CERT_CACHE_MAX_ENTRIES (1 << 24)
+
+static S2N_RESULT s2n_cert_resolver_normalize_name(const char *server_name, char *normalized, uint32_t *normalized_len)
+{
+    RESULT_ENSURE_REF(server_name);
+    RESULT_ENSURE_REF(normalized);
+    RESULT_ENSURE_REF(normalized_len);
+
+    size_t len = strlen(server_name);
+    RESULT_ENSURE(len > 0, S2N_ERR_INVALID_ARGUMENT);
+    RESULT_ENSURE(len <= S2N_MAX_SERVER_NAME, S2N_ERR_SERVER_NAME_TOO_LONG);
+    for (size_t i = 0; i < len; i++) {
+        normalized[i] = tolower((unsigned char) server_name[i]);
+    }
+    normalized[len] = '\0';
+    *normalized_len = len;
+    return S2N_RESULT_OK;
+}
+
+static struct s2n_cert_cache_entry **s2n_cert_cache_bucket(struct s2n_cert_cache *cache, uint64_t hash)
+{
+    return &cache->buckets[hash & (cache->bucket_count - 1)];
+}
+
+static void s2n_cert_cache_lru_unlink(struct s2n_cert_cache *cache, struct s2n_cert_cache_entry *entry)
+{
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void s2n_cert_cache_lru_push_front(struct s2n_cert_cache *cache, struct s2n_cert_cache_entry *entry)
+{
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    } else {
+        cache->lru_tail = entry;
+    }
+    cache->lru_head = entry;
+}
+
+static struct s2n_cert_cache_entry *s2n_cert_cache_find_locked(struct s2n_cert_cache *cache,
+        const char *name, uint32_t name_len, uint64_t hash)
+{
+    struct s2n_cert_cache_entry *entry = *s2n_cert_cache_bucket(cache, hash);
+    while (entry) {
+        if (entry->hash == hash && entry->server_name_len == name_len
+                && memcmp(entry->server_name, name, name_len) == 0) {
+            return entry;
+        }
+        entry = entry->bucket_next;
+    }
+    return NULL;
+}
+
+static S2N_RESULT s2n_cert_cache_entry_release_locked(struct s2n_cert_cache_entry *entry)
+{
+    RESULT_ENSURE_REF(entry);
+    RESULT_ENSURE(entry->refcount > 0, S2N_ERR_SAFETY);
+    entry->refcount--;
+    if (entry->refcount == 0) {
+        RESULT_GUARD_POSIX(s2n_cert_chain_and_key_free(entry->chain_and_key));
+        RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) &entry, sizeof(struct s2n_cert_cache_entry)));
+    }
+    return S2N_RESULT_OK;
+}
+
+/* Removes an entry from the cache and drops the cache's reference.
+ * Connections still using the entry keep it alive.
+ */
+static S2N_RESULT s2n_cert_cache_remove_locked(struct s2n_cert_cache *cache, struct s2n_cert_cache_entry *entry)
+{
+    struct s2n_cert_cache_entry **link = s2n_cert_cache_bucket(cache, entry->hash);
+    while (*link && *link != entry) {
+        link = &(*link)->bucket_next;
+    }
+    RESULT_ENSURE(*link == entry, S2N_ERR_SAFETY);
+    *link = entry->bucket_next;
+    entry->bucket_next = NULL;
+
+    s2n_cert_cache_lru_unlink(cache, entry);
+    cache->size--;
+
+    RESULT_GUARD(s2n_cert_cache_entry_release_locked(entry));
+    return S2N_RESULT_OK;
+}
+
+static void s2n_cert_cache_entry_add_validated_policy(struct s2n_cert_cache_entry *entry,
+        const struct s2n_security_policy *security_policy)
+{
+    entry->validated_policies[entry->next_validated_policy] = security_policy;
+    entry->next_validated_policy = (entry->next_validated_policy + 1) % S2N_CERT_CACHE_VALIDATED_POLICIES;
+}
+
+static bool s2n_cert_cache_entry_allows_locked(struct s2n_cert_cache_entry *entry,
+        const struct s2n_security_policy *security_policy)
+{
+    for (size_t i = 0; i < S2N_CERT_CACHE_VALIDATED_POLICIES; i++) {
+        if (entry->validated_policies[i] == security_policy) {
+            return true;
+        }
+    }
+
+    /* Apply the same checks as s2n_cert_resolver_set */
+    if (s2n_result_is_error(s2n_security_policy_validate_certificate_chain(security_policy, entry->chain_and_key))) {
+        return false;
+    }
+    s2n_cert_cache_entry_add_validated_policy(entry, security_policy);
+    return true;
+}
+
+/* Finds a cached chain that the security policy accepts, and takes a reference to it */
+static S2N_RESULT s2n_cert_cache_lookup_locked(struct s2n_cert_cache *cache, const char *name, uint32_t name_len,
+        const struct s2n_security_policy *security_policy, struct s2n_cert_cache_entry **entry)
+{
+    uint64_t hash = s2n_siphash(&cache->hash_key, (const uint8_t *) name, name_len);
+    struct s2n_cert_cache_entry *found = s2n_cert_cache_find_locked(cache, name, name_len, hash);
+    if (found && !s2n_cert_cache_entry_allows_locked(found, security_policy)) {
+        found = NULL;
+    }
+    if (found) {
+        RESULT_ENSURE(found->refcount < UINT32_MAX, S2N_ERR_SAFETY);
+        found->refcount++;
+        s2n_cert_cache_lru_unlink(cache, found);
+        s2n_cert_cache_lru_push_front(cache, found);
+    }
+    *entry = found;
+    return S2N_RESULT_OK;
+}
+
+/* The chain must have already been validated against the security policy */
+static S2N_RESULT s2n_cert_cache_insert_locked(struct s2n_cert_cache *cache, const char *name, uint32_t name_len,
+        const struct s2n_security_policy *security_policy, struct s2n_cert_chain_and_key *chain_and_key,
+        struct s2n_cert_cache_entry **entry)
+{
+    /* Another connection may have resolved the same name first. Prefer the cached chain. */
+    RESULT_GUARD(s2n_cert_cache_lookup_locked(cache, name, name_len, security_policy, entry));
+    if (*entry) {
+        RESULT_GUARD_POSIX(s2n_cert_chain_and_key_free(chain_and_key));
+        return S2N_RESULT_OK;
+    }
+
+    /* A cached chain that this policy doesn't accept is replaced */
+    uint64_t hash = s2n_siphash(&cache->hash_key, (const uint8_t *) name, name_len);
+    struct s2n_cert_cache_entry *rejected = s2n_cert_cache_find_locked(cache, name, name_len, hash);
+    if (rejected) {
+        RESULT_GUARD(s2n_cert_cache_remove_locked(cache, rejected));
+    }
+
+    struct s2n_blob mem = { 0 };
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_cert_cache_entry)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+    struct s2n_cert_cache_entry *new_entry = (struct s2n_cert_cache_entry *) (void *) mem.data;
+
+    new_entry->cache = cache;
+    new_entry->chain_and_key = chain_and_key;
+    RESULT_CHECKED_MEMCPY(new_entry->server_name, name, name_len);
+    new_entry->server_name_len = name_len;
+    new_entry->hash = hash;
+    s2n_cert_cache_entry_add_validated_policy(new_entry, security_policy);
+    /* One reference for the cache and one for the connection */
+    new_entry->refcount = 2;
+
+    struct s2n_cert_cache_entry **bucket = s2n_cert_cache_bucket(cache, new_entry->hash);
+    new_entry->bucket_next = *bucket;
+    *bucket = new_entry;
+    s2n_cert_cache_lru_push_front(cache, new_entry);
+    cache->size++;
+
+    if (cache->size > cache->max_entries) {
+        RESULT_GUARD(s2n_cert_cache_remove_locked(cache, cache->lru_tail));
+    }
+
+    *entry = new_entry;
+    return S2N_RESULT_OK;
+}
+
+struct s2n_cert_cache *s2n_cert_cache_new(uint32_t max_entries)
+{
+    PTR_ENSURE(max_entries > 0, S2N_ERR_INVALID_ARGUMENT);
+    PTR_ENSURE(max_entries <= S2N_CERT_CACHE_MAX_ENTRIES, S2N_ERR_INVALID_ARGUMENT);
+
+    uint32_t bucket_count = 1;
+    while (bucket_count < max_entries) {
+        bucket_count <<= 1;
+    }
+
+    DEFER_CLEANUP(struct s2n_blob buckets_mem = { 0 }, s2n_free);
+    PTR_GUARD_POSIX(s2n_alloc(&buckets_mem, bucket_count * sizeof(struct s2n_cert_cache_entry *)));
+    PTR_GUARD_POSIX(s2n_blob_zero(&buckets_mem));
+
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    PTR_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_cert_cache)));
+    PTR_GUARD_POSIX(s2n_blob_zero(&mem));
+    struct s2n_cert_cache *cache = (struct s2n_cert_cache *) (void *) mem.data;
+
+    PTR_GUARD_RESULT(s2n_siphash_key_generate(&cache->hash_key));
+    PTR_ENSURE_EQ(pthread_mutex_init(&cache->lock, NULL), 0);
+
+    cache->buckets = (struct s2n_cert_cache_entry **) (void *) buckets_mem.data;
+    cache->bucket_count = bucket_count;
+    cache->max_entries = max_entries;
+
+    ZERO_TO_DISABLE_DEFER_CLEANUP(buckets_mem);
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+    return cache;
+}
+
+int s2n_cert_cache_free(struct s2n_cert_cache **cache_ptr)
+{
+    POSIX_ENSURE_REF(cache_ptr);
+    struct s2n_cert_cache *cache = *cache_ptr;
+    if (cache == NULL) {
+        return S2N_SUCCESS;
+    }
+
+    /* Connections reference entries, so all connections must be freed or wiped first */
+    for (struct s2n_cert_cache_entry *entry = cache->lru_head; entry; entry = entry->lru_next) {
+        POSIX_ENSURE(entry->refcount == 1, S2N_ERR_INVALID_STATE);
+    }
+
+    while (cache->lru_head) {
+        POSIX_GUARD_RESULT(s2n_cert_cache_remove_locked(cache, cache->lru_head));
+    }
+
+    POSIX_ENSURE_EQ(pthread_mutex_destroy(&cache->lock), 0);
+    POSIX_GUARD(s2n_free_object((uint8_t **) &cache->buckets,
+            cache->bucket_count * sizeof(struct s2n_cert_cache_entry *)));
+    POSIX_GUARD(s2n_free_object((uint8_t **) cache_ptr, sizeof(struct s2n_cert_cache)));
+    return S2N_SUCCESS;
+}
+
+int s2n_cert_cache_remove(struct s2n_cert_cache *cache, const char *server_name)
+{
+    POSIX_ENSURE_REF(cache);
+    POSIX_ENSURE_REF(server_name);
+
+    char name[S2N_MAX_SERVER_NAME + 1] = { 0 };
+    uint32_t name_len = 0;
+    POSIX_GUARD_RESULT(s2n_cert_resolver_normalize_name(server_name, name, &name_len));
+    uint64_t hash = s2n_siphash(&cache->hash_key, (const uint8_t *) name, name_len);
+
+    POSIX_ENSURE_EQ(pthread_mutex_lock(&cache->lock), 0);
+    s2n_result result = S2N_RESULT_OK;
+    struct s2n_cert_cache_entry *entry = s2n_cert_cache_find_locked(cache, name, name_len, hash);
+    if (entry) {
+        result = s2n_cert_cache_remove_locked(cache, entry);
+    }
+    POSIX_ENSURE_EQ(pthread_mutex_unlock(&cache->lock), 0);
+
+    POSIX_GUARD_RESULT(result);
+    return S2N_SUCCESS;
+}
+
+int s2n_config_set_cert_resolver_cb(struct s2n_config *config, struct s2n_cert_cache *cache,
+        s2n_cert_resolver_callback callback, void *context)
+{
+    POSIX_ENSURE_REF(config);
+    POSIX_ENSURE((cache == NULL) == (callback == NULL), S2N_ERR_INVALID_ARGUMENT);
+
+    config->cert_cache = cache;
+    config->cert_resolver_cb = callback;
+    config->cert_resolver_ctx = context;
+    return S2N_SUCCESS;
+}
+
+S2N_RESULT s2n_cert_resolver_resolve(struct s2n_connection *conn)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(conn->config);
+    struct s2n_cert_resolver *resolver = &conn->cert_resolver;
+
+    switch (resolver->state) {
+        case S2N_CERT_RESOLVER_FINISHED:
+            /* The certificate may have been set asynchronously */
+            RESULT_GUARD(s2n_handshake_timings_end(conn, S2N_HANDSHAKE_TIMING_CERT_RESOLVER_CB));
+            return S2N_RESULT_OK;
+        case S2N_CERT_RESOLVER_AWAITING_RESPONSE:
+            RESULT_BAIL(S2N_ERR_ASYNC_BLOCKED);
+        case S2N_CERT_RESOLVER_NOT_INVOKED:
+            break;
+    }
+
+    struct s2n_config *config = conn->config;
+    if (config->cert_resolver_cb == NULL) {
+        resolver->state = S2N_CERT_RESOLVER_FINISHED;
+        return S2N_RESULT_OK;
+    }
+    RESULT_ENSURE_REF(config->cert_cache);
+
+    /* Without a server name, the config's default certificates are used */
+    const char *server_name = s2n_get_server_name(conn);
+    if (server_name == NULL || server_name[0] == '\0') {
+        resolver->state = S2N_CERT_RESOLVER_FINISHED;
+        return S2N_RESULT_OK;
+    }
+
+    char name[S2N_MAX_SERVER_NAME + 1] = { 0 };
+    uint32_t name_len = 0;
+    RESULT_GUARD(s2n_cert_resolver_normalize_name(server_name, name, &name_len));
+
+    const struct s2n_security_policy *security_policy = NULL;
+    RESULT_GUARD_POSIX(s2n_connection_get_security_policy(conn, &security_policy));
+
+    struct s2n_cert_cache *cache = config->cert_cache;
+    RESULT_ENSURE_EQ(pthread_mutex_lock(&cache->lock), 0);
+    s2n_result result = s2n_cert_cache_lookup_locked(cache, name, name_len, security_policy, &resolver->entry);
+    RESULT_ENSURE_EQ(pthread_mutex_unlock(&cache->lock), 0);
+    RESULT_GUARD(result);
+
+    if (resolver->entry) {
+        resolver->state = S2N_CERT_RESOLVER_FINISHED;
+        return S2N_RESULT_OK;
+    }
+
+    resolver->state = S2N_CERT_RESOLVER_AWAITING_RESPONSE;
+    RESULT_GUARD(s2n_handshake_timings_begin(conn, S2N_HANDSHAKE_TIMING_CERT_RESOLVER_CB));
+    if (config->cert_resolver_cb(conn, name, config->cert_resolver_ctx) != S2N_SUCCESS) {
+        RESULT_GUARD_POSIX(s2n_queue_reader_handshake_failure_alert(conn));
+        RESULT_BAIL(S2N_ERR_CANCELLED);
+    }
+    RESULT_ENSURE(resolver->state == S2N_CERT_RESOLVER_FINISHED, S2N_ERR_ASYNC_BLOCKED);
+    RESULT_GUARD(s2n_handshake_timings_end(conn, S2N_HANDSHAKE_TIMING_CERT_RESOLVER_CB));
+
+    return S2N_RESULT_OK;
+}
+
+int s2n_cert_resolver_set(struct s2n_connection *conn, struct s2n_cert_chain_and_key *chain_and_key)
+{
+    POSIX_ENSURE_REF(conn);
+    POSIX_ENSURE_REF(conn->config);
+    POSIX_ENSURE_REF(chain_and_key);
+    POSIX_ENSURE(conn->cert_resolver.state == S2N_CERT_RESOLVER_AWAITING_RESPONSE, S2N_ERR_INVALID_STATE);
+
+    struct s2n_cert_cache *cache = conn->config->cert_cache;
+    POSIX_ENSURE_REF(cache);
+
+    /* Apply the same checks as s2n_config_add_cert_chain_and_key_to_store */
+    const struct s2n_security_policy *security_policy = NULL;
+    POSIX_GUARD(s2n_connection_get_security_policy(conn, &security_policy));
+    POSIX_GUARD_RESULT(s2n_security_policy_validate_certificate_chain(security_policy, chain_and_key));
+    s2n_pkey_type cert_type = s2n_cert_chain_and_key_get_pkey_type(chain_and_key);
+    POSIX_ENSURE(cert_type >= 0, S2N_ERR_CERT_TYPE_UNSUPPORTED);
+    POSIX_ENSURE(cert_type < S2N_CERT_TYPE_COUNT, S2N_ERR_CERT_TYPE_UNSUPPORTED);
+
+    /* Compress once here rather than on every handshake that uses the cached chain */
+    POSIX_GUARD_RESULT(s2n_cert_compression_precompress_chain(conn->config, chain_and_key));
+
+    char name[S2N_MAX_SERVER_NAME + 1] = { 0 };
+    uint32_t name_len = 0;
+    POSIX_GUARD_RESULT(s2n_cert_resolver_normalize_name(conn->server_name, name, &name_len));
+
+    POSIX_ENSURE_EQ(pthread_mutex_lock(&cache->lock), 0);
+    s2n_result result = s2n_cert_cache_insert_locked(cache, name, name_len, security_policy, chain_and_key,
+            &conn->cert_resolver.entry);
+    POSIX_ENSURE_EQ(pthread_mutex_unlock(&cache->lock), 0);
+    POSIX_GUARD_RESULT(result);
+
+    conn->cert_resolver.state = S2N_CERT_RESOLVER_FINISHED;
+    return S2N_SUCCESS;
+}
+
+int s2n_cert_resolver_ignore(struct s2n_connection *conn)
+{
+    POSIX_ENSURE_REF(conn);
+    POSIX_ENSURE(conn->cert_resolver.state == S2N_CERT_RESOLVER_AWAITING_RESPONSE, S2N_ERR_INVALID_STATE);
+    conn->cert_resolver.state = S2N_CERT_RESOLVER_FINISHED;
+    return S2N_SUCCESS;
+}
+
+struct s2n_cert_chain_and_key *s2n_cert_resolver_get_chain(struct s2n_connection *conn)
+{
+    if (conn == NULL || conn->cert_resolver.entry == NULL) {
+        return NULL;
+    }
+    return conn->cert_resolver.entry->chain_and_key;
+}
+
+S2N_RESULT s2n_cert_resolver_wipe(struct s2n_cert_resolver *resolver)
+{
+    RESULT_ENSURE_REF(resolver);
+
+    struct s2n_cert_cache_entry *entry = resolver->entry;
+    if (entry) {
+        struct s2n_cert_cache *cache = entry->cache;
+        RESULT_ENSURE_REF(cache);
+        RESULT_ENSURE_EQ(pthread_mutex_lock(&cache->lock), 0);
+        s2n_result result = s2n_cert_cache_entry_release_locked(entry);
+        RESULT_ENSURE_EQ(pthread_mutex_unlock(&cache->lock), 0);
+        RESULT_GUARD(result);
+    }
+
+    *resolver = (struct s2n_cert_resolver){ 0 };
+    return S2N_RESULT_OK;
+}
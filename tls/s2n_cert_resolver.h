@@ -0,0 +1,85 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+#include "api/unstable/cert_resolver.h"
+#include "crypto/s2n_certificate.h"
+#include "tls/s2n_tls_parameters.h"
+#include "utils/s2n_result.h"
+#include "utils/s2n_siphash.h"
+
+#define S2N_CERT_CACHE_VALIDATED_POLICIES 4
+
+struct s2n_security_policy;
+
+struct s2n_cert_cache_entry {
+    struct s2n_cert_cache *cache;
+    struct s2n_cert_chain_and_key *chain_and_key;
+
+    /* The cache can be shared by configs and connections with different security policies,
+     * so the chain is checked against each connection's policy. The most recent policies
+     * that accepted the chain are remembered to skip repeated checks.
+     */
+    const struct s2n_security_policy *validated_policies[S2N_CERT_CACHE_VALIDATED_POLICIES];
+    uint8_t next_validated_policy;
+
+    char server_name[S2N_MAX_SERVER_NAME + 1];
+    uint32_t server_name_len;
+    uint64_t hash;
+
+    /* Connections using the entry, plus one while the entry is in the cache.
+     * The chain is freed when the count drops to zero.
+     */
+    uint32_t refcount;
+
+    struct s2n_cert_cache_entry *bucket_next;
+    /* Least recently used list. The head is the most recently used entry. */
+    struct s2n_cert_cache_entry *lru_prev;
+    struct s2n_cert_cache_entry *lru_next;
+};
+
+struct s2n_cert_cache {
+    pthread_mutex_t lock;
+    struct s2n_siphash_key hash_key;
+
+    /* Chained hash table, sized to a power of two at least as large as max_entries */
+    struct s2n_cert_cache_entry **buckets;
+    uint32_t bucket_count;
+
+    uint32_t max_entries;
+    uint32_t size;
+
+    struct s2n_cert_cache_entry *lru_head;
+    struct s2n_cert_cache_entry *lru_tail;
+};
+
+typedef enum {
+    S2N_CERT_RESOLVER_NOT_INVOKED = 0,
+    S2N_CERT_RESOLVER_AWAITING_RESPONSE,
+    S2N_CERT_RESOLVER_FINISHED,
+} s2n_cert_resolver_state;
+
+struct s2n_cert_resolver {
+    s2n_cert_resolver_state state;
+    /* The cache entry referenced by the connection, if a certificate was resolved */
+    struct s2n_cert_cache_entry *entry;
+};
+
+S2N_RESULT s2n_cert_resolver_resolve(struct s2n_connection *conn);
+struct s2n_cert_chain_and_key *s2n_cert_resolver_get_chain(struct s2n_connection *conn);
+S2N_RESULT s2n_cert_resolver_wipe(struct s2n_cert_resolver *resolver);
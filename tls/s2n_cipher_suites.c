@@ -13,6 +13,7 @@
  * permissions and limitations under the License.
  */
 
+#include <limits.h>
 #include <openssl/crypto.h>
 #include <string.h>
 
@@ -988,14 +989,21 @@ int s2n_crypto_disable_init(void)
     return S2N_SUCCESS;
 }
 
+/* Cipher suites are represented in masks by their position in s2n_all_cipher_suites */
+typedef uint64_t s2n_cipher_suite_mask;
+#define S2N_CIPHER_SUITE_MASK_BIT(index) (((s2n_cipher_suite_mask) 1) << (index))
+
 /* Determines cipher suite availability and selects record algorithms */
 int s2n_cipher_suites_init(void)
 {
     const int num_cipher_suites = s2n_array_len(s2n_all_cipher_suites);
+    POSIX_ENSURE_LTE(s2n_array_len(s2n_all_cipher_suites), sizeof(s2n_cipher_suite_mask) * CHAR_BIT);
+
     for (int i = 0; i < num_cipher_suites; i++) {
         struct s2n_cipher_suite *cur_suite = s2n_all_cipher_suites[i];
         cur_suite->available = 0;
         cur_suite->record_alg = NULL;
+        cur_suite->index = i;
 
         /* Find the highest priority supported record algorithm */
         for (int j = 0; j < cur_suite->num_record_algs; j++) {
@@ -1074,12 +1082,13 @@ S2N_RESULT s2n_cipher_suites_cleanup(void)
     return S2N_RESULT_OK;
 }
 
-S2N_RESULT s2n_cipher_suite_from_iana(const uint8_t *iana, size_t iana_len, struct s2n_cipher_suite **cipher_suite)
+/* Finds a cipher suite's position in s2n_all_cipher_suites.
+ * Unlike s2n_cipher_suite_from_iana, an unknown cipher suite is not an error,
+ * since clients routinely offer cipher suites we don't support.
+ */
+static bool s2n_cipher_suite_index_from_iana(const uint8_t *iana, uint8_t *index)
 {
-    RESULT_ENSURE_REF(cipher_suite);
-    *cipher_suite = NULL;
-    RESULT_ENSURE_REF(iana);
-    RESULT_ENSURE_EQ(iana_len, S2N_TLS_CIPHER_SUITE_LEN);
+    const uint16_t value = (iana[0] << 8) | iana[1];
 
     int low = 0;
     int top = s2n_array_len(s2n_all_cipher_suites) - 1;
@@ -1088,18 +1097,32 @@ S2N_RESULT s2n_cipher_suite_from_iana(const uint8_t *iana, size_t iana_len, stru
     while (low <= top) {
         /* Check in the middle */
         size_t mid = low + ((top - low) / 2);
-        int m = memcmp(s2n_all_cipher_suites[mid]->iana_value, iana, S2N_TLS_CIPHER_SUITE_LEN);
+        const uint8_t *mid_iana = s2n_all_cipher_suites[mid]->iana_value;
+        const uint16_t mid_value = (mid_iana[0] << 8) | mid_iana[1];
 
-        if (m == 0) {
-            *cipher_suite = s2n_all_cipher_suites[mid];
-            return S2N_RESULT_OK;
-        } else if (m > 0) {
+        if (mid_value == value) {
+            *index = mid;
+            return true;
+        } else if (mid_value > value) {
             top = mid - 1;
-        } else if (m < 0) {
+        } else {
             low = mid + 1;
         }
     }
-    RESULT_BAIL(S2N_ERR_CIPHER_NOT_SUPPORTED);
+    return false;
+}
+
+S2N_RESULT s2n_cipher_suite_from_iana(const uint8_t *iana, size_t iana_len, struct s2n_cipher_suite **cipher_suite)
+{
+    RESULT_ENSURE_REF(cipher_suite);
+    *cipher_suite = NULL;
+    RESULT_ENSURE_REF(iana);
+    RESULT_ENSURE_EQ(iana_len, S2N_TLS_CIPHER_SUITE_LEN);
+
+    uint8_t index = 0;
+    RESULT_ENSURE(s2n_cipher_suite_index_from_iana(iana, &index), S2N_ERR_CIPHER_NOT_SUPPORTED);
+    *cipher_suite = s2n_all_cipher_suites[index];
+    return S2N_RESULT_OK;
 }
 
 int s2n_set_cipher_as_client(struct s2n_connection *conn, uint8_t wire[S2N_TLS_CIPHER_SUITE_LEN])
@@ -1192,25 +1215,49 @@ bool s2n_cipher_suite_uses_chacha20_alg(struct s2n_cipher_suite *cipher_suite)
     return cipher_suite && cipher_suite->record_alg && cipher_suite->record_alg->cipher == &s2n_chacha20_poly1305;
 }
 
-/* Iff the server has enabled allow_chacha20_boosting and the client has a chacha20 cipher suite as its most
- * preferred cipher suite, then we have mutual chacha20 boosting support.
+struct s2n_wire_ciphers_summary {
+    s2n_cipher_suite_mask suites;
+    bool fallback_scsv;
+    bool renegotiation_info_scsv;
+    /* The client's most preferred cipher suite uses chacha20 */
+    bool chacha20_first;
+};
+
+/* Summarizes the client's cipher suite list in a single pass, so that checking
+ * whether the client offered a cipher suite is a single bit test.
  */
-static S2N_RESULT s2n_validate_chacha20_boosting(const struct s2n_cipher_preferences *cipher_preferences, const uint8_t *wire,
-        uint32_t cipher_suite_len)
+static void s2n_wire_ciphers_summarize(const uint8_t *wire, uint32_t count, uint32_t cipher_suite_len,
+        struct s2n_wire_ciphers_summary *summary)
 {
-    RESULT_ENSURE_REF(cipher_preferences);
-    RESULT_ENSURE_REF(wire);
+    const uint8_t fallback_scsv[S2N_TLS_CIPHER_SUITE_LEN] = { TLS_FALLBACK_SCSV };
+    const uint8_t renegotiation_info_scsv[S2N_TLS_CIPHER_SUITE_LEN] = { TLS_EMPTY_RENEGOTIATION_INFO_SCSV };
 
-    RESULT_ENSURE_EQ(cipher_preferences->allow_chacha20_boosting, true);
-
-    const uint8_t *clients_first_cipher_iana = wire + cipher_suite_len - S2N_TLS_CIPHER_SUITE_LEN;
+    *summary = (struct s2n_wire_ciphers_summary){ 0 };
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *theirs = wire + (i * cipher_suite_len) + (cipher_suite_len - S2N_TLS_CIPHER_SUITE_LEN);
 
-    struct s2n_cipher_suite *client_first_cipher_suite = NULL;
-    RESULT_GUARD(s2n_cipher_suite_from_iana(clients_first_cipher_iana, S2N_TLS_CIPHER_SUITE_LEN, &client_first_cipher_suite));
-    RESULT_ENSURE_REF(client_first_cipher_suite);
+        uint8_t index = 0;
+        if (s2n_cipher_suite_index_from_iana(theirs, &index)) {
+            summary->suites |= S2N_CIPHER_SUITE_MASK_BIT(index);
+            if (i == 0) {
+                summary->chacha20_first = s2n_cipher_suite_uses_chacha20_alg(s2n_all_cipher_suites[index]);
+            }
+        } else if (memcmp(theirs, fallback_scsv, S2N_TLS_CIPHER_SUITE_LEN) == 0) {
+            summary->fallback_scsv = true;
+        } else if (memcmp(theirs, renegotiation_info_scsv, S2N_TLS_CIPHER_SUITE_LEN) == 0) {
+            summary->renegotiation_info_scsv = true;
+        }
+    }
+}
 
-    RESULT_ENSURE_EQ(s2n_cipher_suite_uses_chacha20_alg(client_first_cipher_suite), true);
-    return S2N_RESULT_OK;
+static bool s2n_wire_ciphers_contain_suite(s2n_cipher_suite_mask wire_suites, struct s2n_cipher_suite *suite,
+        const uint8_t *wire, uint32_t count, uint32_t cipher_suite_len)
+{
+    /* Cipher suites that aren't part of s2n_all_cipher_suites can't be represented in a mask */
+    if (suite->index >= s2n_array_len(s2n_all_cipher_suites) || s2n_all_cipher_suites[suite->index] != suite) {
+        return s2n_wire_ciphers_contain(suite->iana_value, wire, count, cipher_suite_len);
+    }
+    return wire_suites & S2N_CIPHER_SUITE_MASK_BIT(suite->index);
 }
 
 static int s2n_set_cipher_as_server(struct s2n_connection *conn, uint8_t *wire, uint32_t count, uint32_t cipher_suite_len)
@@ -1218,22 +1265,23 @@ static int s2n_set_cipher_as_server(struct s2n_connection *conn, uint8_t *wire,
     POSIX_ENSURE_REF(conn);
     POSIX_ENSURE_REF(conn->secure);
 
-    uint8_t renegotiation_info_scsv[S2N_TLS_CIPHER_SUITE_LEN] = { TLS_EMPTY_RENEGOTIATION_INFO_SCSV };
     struct s2n_cipher_suite *higher_vers_match = NULL;
     struct s2n_cipher_suite *non_chacha20_match = NULL;
 
+    struct s2n_wire_ciphers_summary wire_ciphers = { 0 };
+    s2n_wire_ciphers_summarize(wire, count, cipher_suite_len, &wire_ciphers);
+
     /* RFC 7507 - If client is attempting to negotiate a TLS Version that is lower than the highest supported server
      * version, and the client cipher list contains TLS_FALLBACK_SCSV, then the server must abort the connection since
      * TLS_FALLBACK_SCSV should only be present when the client previously failed to negotiate a higher TLS version.
      */
     if (conn->client_protocol_version < conn->server_protocol_version) {
-        uint8_t fallback_scsv[S2N_TLS_CIPHER_SUITE_LEN] = { TLS_FALLBACK_SCSV };
-        if (s2n_wire_ciphers_contain(fallback_scsv, wire, count, cipher_suite_len)) {
+        if (wire_ciphers.fallback_scsv) {
             POSIX_BAIL(S2N_ERR_FALLBACK_DETECTED);
         }
     }
 
-    if (s2n_wire_ciphers_contain(renegotiation_info_scsv, wire, count, cipher_suite_len)) {
+    if (wire_ciphers.renegotiation_info_scsv) {
         /** For renegotiation handshakes:
          *= https://www.rfc-editor.org/rfc/rfc5746#3.7
          *# o  When a ClientHello is received, the server MUST verify that it
@@ -1257,7 +1305,10 @@ static int s2n_set_cipher_as_server(struct s2n_connection *conn, uint8_t *wire,
     const struct s2n_cipher_preferences *cipher_preferences = security_policy->cipher_preferences;
     POSIX_ENSURE_REF(cipher_preferences);
 
-    bool try_chacha20_boosting = s2n_result_is_ok(s2n_validate_chacha20_boosting(cipher_preferences, wire, cipher_suite_len));
+    /* Iff the server has enabled allow_chacha20_boosting and the client has a chacha20 cipher suite as its most
+     * preferred cipher suite, then we have mutual chacha20 boosting support.
+     */
+    bool try_chacha20_boosting = cipher_preferences->allow_chacha20_boosting && wire_ciphers.chacha20_first;
 
     /*
      * s2n only respects server preference order and chooses the server's
@@ -1270,9 +1321,9 @@ static int s2n_set_cipher_as_server(struct s2n_connection *conn, uint8_t *wire,
      * too high for the current connection (higher_vers_match).
      */
     for (size_t i = 0; i < cipher_preferences->count; i++) {
-        const uint8_t *ours = cipher_preferences->suites[i]->iana_value;
+        struct s2n_cipher_suite *ours = cipher_preferences->suites[i];
 
-        if (s2n_wire_ciphers_contain(ours, wire, count, cipher_suite_len)) {
+        if (s2n_wire_ciphers_contain_suite(wire_ciphers.suites, ours, wire, count, cipher_suite_len)) {
             /* We have a match */
             struct s2n_cipher_suite *match = cipher_preferences->suites[i];
 
@@ -119,6 +119,11 @@ struct s2n_cipher_suite {
     const s2n_hmac_algorithm prf_alg;
 
     const uint8_t minimum_required_tls_version;
+
+    /* Position in the list of all cipher suites, used to build cipher suite masks.
+     * Set in s2n_cipher_suites_init()
+     */
+    uint8_t index;
 };
 
 /* Never negotiated */
@@ -682,11 +682,18 @@ int s2n_client_hello_recv(struct s2n_connection *conn)
 
         /* Call client_hello_cb if exists, letting application to modify s2n_connection or swap s2n_config */
         if (conn->config->client_hello_cb) {
+            POSIX_GUARD_RESULT(s2n_handshake_timings_begin(conn, S2N_HANDSHAKE_TIMING_CLIENT_HELLO_CB));
             int rc = conn->config->client_hello_cb(conn, conn->config->client_hello_cb_ctx);
             POSIX_GUARD_RESULT(s2n_client_hello_process_cb_response(conn, rc));
         }
     }
 
+    /* A nonblocking callback is only done once the handshake gets past it */
+    POSIX_GUARD_RESULT(s2n_handshake_timings_end(conn, S2N_HANDSHAKE_TIMING_CLIENT_HELLO_CB));
+
+    /* Resolve the certificate for the ServerName after the ClientHello callback, which may swap the config */
+    POSIX_GUARD_RESULT(s2n_cert_resolver_resolve(conn));
+
     POSIX_GUARD(s2n_process_client_hello(conn));
 
     return 0;
@@ -23,19 +23,23 @@
 
 #include "api/unstable/custom_x509_extensions.h"
 #include "api/unstable/npn.h"
+#include "api/unstable/ticket_keys.h"
 #include "crypto/s2n_certificate.h"
 #include "crypto/s2n_fips.h"
 #include "crypto/s2n_hkdf.h"
 #include "crypto/s2n_libcrypto.h"
 #include "crypto/s2n_pq.h"
 #include "error/s2n_errno.h"
+#include "tls/s2n_cert_compression.h"
 #include "tls/s2n_cipher_preferences.h"
+#include "tls/s2n_early_data_replay.h"
 #include "tls/s2n_internal.h"
 #include "tls/s2n_ktls.h"
 #include "tls/s2n_security_policies.h"
+#include "tls/s2n_session_cache.h"
+#include "tls/s2n_ticket_key_cache.h"
 #include "tls/s2n_tls13.h"
 #include "utils/s2n_blob.h"
-#include "utils/s2n_map.h"
 #include "utils/s2n_safety.h"
 
 #if defined(CLOCK_MONOTONIC_RAW)
@@ -114,8 +118,7 @@ static int s2n_config_init(struct s2n_config *config)
         POSIX_GUARD(s2n_config_setup_fips(config));
     }
 
-    POSIX_GUARD_PTR(config->domain_name_to_cert_map = s2n_map_new_with_initial_capacity(1));
-    POSIX_GUARD_RESULT(s2n_map_complete(config->domain_name_to_cert_map));
+    POSIX_GUARD_RESULT(s2n_sni_trie_new(&config->domain_name_to_cert_trie));
 
     s2n_x509_trust_store_init_empty(&config->trust_store);
 
@@ -133,11 +136,13 @@ static int s2n_config_cleanup(struct s2n_config *config)
     }
 
     POSIX_GUARD(s2n_config_free_session_ticket_keys(config));
+    POSIX_GUARD_RESULT(s2n_session_cache_free(&config->builtin_session_cache));
+    POSIX_GUARD_RESULT(s2n_early_data_replay_filter_free(&config->early_data_replay_filter));
     POSIX_GUARD(s2n_config_free_cert_chain_and_key(config));
     POSIX_GUARD(s2n_config_free_dhparams(config));
     POSIX_GUARD(s2n_free(&config->application_protocols));
     POSIX_GUARD(s2n_free(&config->cert_authorities));
-    POSIX_GUARD_RESULT(s2n_map_free(config->domain_name_to_cert_map));
+    POSIX_GUARD_RESULT(s2n_sni_trie_free(&config->domain_name_to_cert_trie));
 
     POSIX_CHECKED_MEMSET(config, 0, sizeof(struct s2n_config));
 
@@ -151,45 +156,47 @@ static int s2n_config_update_domain_name_to_cert_map(struct s2n_config *config,
     POSIX_ENSURE_REF(config);
     POSIX_ENSURE_REF(name);
 
-    struct s2n_map *domain_name_to_cert_map = config->domain_name_to_cert_map;
-    /* s2n_map does not allow zero-size key */
+    struct s2n_sni_trie *domain_name_to_cert_trie = config->domain_name_to_cert_trie;
+    POSIX_ENSURE_REF(domain_name_to_cert_trie);
+    /* Empty names can never match a server name */
     if (name->size == 0) {
         return 0;
     }
     s2n_pkey_type cert_type = s2n_cert_chain_and_key_get_pkey_type(cert_key_pair);
-    struct s2n_blob s2n_map_value = { 0 };
-    bool key_found = false;
-    POSIX_GUARD_RESULT(s2n_map_lookup(domain_name_to_cert_map, name, &s2n_map_value, &key_found));
-    if (!key_found) {
-        struct certs_by_type value = { { 0 } };
-        value.certs[cert_type] = cert_key_pair;
-        s2n_map_value.data = (uint8_t *) &value;
-        s2n_map_value.size = sizeof(struct certs_by_type);
+    POSIX_ENSURE(cert_type >= 0 && cert_type < S2N_CERT_TYPE_COUNT, S2N_ERR_CERT_TYPE_UNSUPPORTED);
 
-        POSIX_GUARD_RESULT(s2n_map_unlock(domain_name_to_cert_map));
-        POSIX_GUARD_RESULT(s2n_map_add(domain_name_to_cert_map, name, &s2n_map_value));
-        POSIX_GUARD_RESULT(s2n_map_complete(domain_name_to_cert_map));
-    } else {
-        struct certs_by_type *value = (void *) s2n_map_value.data;
-        if (value->certs[cert_type] == NULL) {
-            value->certs[cert_type] = cert_key_pair;
-        } else if (config->cert_tiebreak_cb) {
-            /* There's an existing certificate for this (domain_name, auth_method).
-             * Run the application's tiebreaking callback to decide which cert should be used.
-             * An application may have some context specific logic to resolve ties that are based
-             * on factors like trust, expiry, etc.
-             */
-            struct s2n_cert_chain_and_key *winner = config->cert_tiebreak_cb(
-                    value->certs[cert_type],
-                    cert_key_pair,
-                    name->data,
-                    name->size);
-            if (winner) {
-                value->certs[cert_type] = winner;
-            }
+    /* Certificates in the trie may be in use by concurrent lookups, so build the
+     * updated set of certificates for the name and replace the existing set.
+     */
+    const struct certs_by_type *existing = NULL;
+    POSIX_GUARD_RESULT(s2n_sni_trie_get(domain_name_to_cert_trie, name, &existing));
+    struct certs_by_type value = { { 0 } };
+    if (existing) {
+        value = *existing;
+    }
+
+    if (value.certs[cert_type] == NULL) {
+        value.certs[cert_type] = cert_key_pair;
+    } else if (config->cert_tiebreak_cb) {
+        /* There's an existing certificate for this (domain_name, auth_method).
+         * Run the application's tiebreaking callback to decide which cert should be used.
+         * An application may have some context specific logic to resolve ties that are based
+         * on factors like trust, expiry, etc.
+         */
+        struct s2n_cert_chain_and_key *winner = config->cert_tiebreak_cb(
+                value.certs[cert_type],
+                cert_key_pair,
+                name->data,
+                name->size);
+        if (winner == NULL || winner == value.certs[cert_type]) {
+            return 0;
         }
+        value.certs[cert_type] = winner;
+    } else {
+        return 0;
     }
 
+    POSIX_GUARD_RESULT(s2n_sni_trie_set(domain_name_to_cert_trie, name, &value));
     return 0;
 }
 
@@ -320,6 +327,9 @@ int s2n_config_init_session_ticket_keys(struct s2n_config *config)
     if (config->ticket_keys == NULL) {
         POSIX_ENSURE_REF(config->ticket_keys = s2n_array_new_with_capacity(sizeof(struct s2n_ticket_key), S2N_MAX_TICKET_KEYS));
     }
+    if (config->ticket_key_index == NULL) {
+        POSIX_GUARD_RESULT(s2n_ticket_key_index_new(&config->ticket_key_index));
+    }
 
     return 0;
 }
@@ -327,8 +337,16 @@ int s2n_config_init_session_ticket_keys(struct s2n_config *config)
 int s2n_config_free_session_ticket_keys(struct s2n_config *config)
 {
     if (config->ticket_keys != NULL) {
+        uint32_t ticket_keys_len = 0;
+        POSIX_GUARD_RESULT(s2n_array_num_elements(config->ticket_keys, &ticket_keys_len));
+        for (uint32_t i = 0; i < ticket_keys_len; i++) {
+            struct s2n_ticket_key *ticket_key = NULL;
+            POSIX_GUARD_RESULT(s2n_array_get(config->ticket_keys, i, (void **) &ticket_key));
+            POSIX_GUARD_RESULT(s2n_ticket_key_cache_free(ticket_key));
+        }
         POSIX_GUARD_RESULT(s2n_array_free_p(&config->ticket_keys));
     }
+    POSIX_GUARD_RESULT(s2n_ticket_key_index_free(&config->ticket_key_index));
 
     return 0;
 }
@@ -513,10 +531,11 @@ int s2n_config_set_verification_ca_location(struct s2n_config *config, const cha
 
 static int s2n_config_add_cert_chain_and_key_impl(struct s2n_config *config, struct s2n_cert_chain_and_key *cert_key_pair)
 {
-    POSIX_ENSURE_REF(config->domain_name_to_cert_map);
+    POSIX_ENSURE_REF(config->domain_name_to_cert_trie);
     POSIX_ENSURE_REF(cert_key_pair);
 
     POSIX_GUARD_RESULT(s2n_security_policy_validate_certificate_chain(config->security_policy, cert_key_pair));
+    POSIX_GUARD_RESULT(s2n_cert_compression_precompress_chain(config, cert_key_pair));
 
     s2n_pkey_type cert_type = s2n_cert_chain_and_key_get_pkey_type(cert_key_pair);
     config->is_rsa_cert_configured |= (cert_type == S2N_PKEY_TYPE_RSA);
@@ -547,6 +566,19 @@ static int s2n_config_add_cert_chain_and_key_impl(struct s2n_config *config, str
     return S2N_SUCCESS;
 }
 
+static S2N_RESULT s2n_config_validate_domain_certs(const struct certs_by_type *domain_certs, void *ctx)
+{
+    const struct s2n_security_policy *security_policy = ctx;
+    for (int i = 0; i < S2N_CERT_TYPE_COUNT; i++) {
+        struct s2n_cert_chain_and_key *cert = domain_certs->certs[i];
+        if (cert == NULL) {
+            continue;
+        }
+        RESULT_GUARD(s2n_security_policy_validate_certificate_chain(security_policy, cert));
+    }
+    return S2N_RESULT_OK;
+}
+
 S2N_RESULT s2n_config_validate_loaded_certificates(const struct s2n_config *config,
         const struct s2n_security_policy *security_policy)
 {
@@ -576,27 +608,12 @@ S2N_RESULT s2n_config_validate_loaded_certificates(const struct s2n_config *conf
         RESULT_GUARD(s2n_security_policy_validate_certificate_chain(security_policy, cert));
     }
 
-    /* validate the certs in the domain map */
-    if (config->domain_name_to_cert_map == NULL) {
+    /* validate the certs in the domain trie */
+    if (config->domain_name_to_cert_trie == NULL) {
         return S2N_RESULT_OK;
     }
-
-    struct s2n_map_iterator iter = { 0 };
-    RESULT_GUARD(s2n_map_iterator_init(&iter, config->domain_name_to_cert_map));
-
-    while (s2n_map_iterator_has_next(&iter)) {
-        struct s2n_blob value = { 0 };
-        RESULT_GUARD(s2n_map_iterator_next(&iter, &value));
-
-        struct certs_by_type *domain_certs = (void *) value.data;
-        for (int i = 0; i < S2N_CERT_TYPE_COUNT; i++) {
-            struct s2n_cert_chain_and_key *cert = domain_certs->certs[i];
-            if (cert == NULL) {
-                continue;
-            }
-            RESULT_GUARD(s2n_security_policy_validate_certificate_chain(security_policy, cert));
-        }
-    }
+    RESULT_GUARD(s2n_sni_trie_visit(config->domain_name_to_cert_trie, s2n_config_validate_domain_certs,
+            (void *) (uintptr_t) security_policy));
     return S2N_RESULT_OK;
 }
 
@@ -1051,6 +1068,15 @@ int s2n_config_require_ticket_forward_secrecy(struct s2n_config *config, bool en
     return S2N_SUCCESS;
 }
 
+int s2n_config_set_ticket_key_caching(struct s2n_config *config, bool enabled)
+{
+    POSIX_ENSURE_REF(config);
+
+    config->cache_ticket_keys = enabled;
+
+    return S2N_SUCCESS;
+}
+
 int s2n_config_set_cert_tiebreak_callback(struct s2n_config *config, s2n_cert_tiebreak_callback cert_tiebreak_cb)
 {
     config->cert_tiebreak_cb = cert_tiebreak_cb;
@@ -15,11 +15,13 @@
 
 #pragma once
 
+#include <pthread.h>
 #include <sys/param.h>
 
 #include "api/s2n.h"
 #include "api/unstable/async_offload.h"
 #include "api/unstable/cert_authorities.h"
+#include "api/unstable/cert_resolver.h"
 #include "crypto/s2n_certificate.h"
 #include "crypto/s2n_dhe.h"
 #include "tls/s2n_crl.h"
@@ -28,11 +30,38 @@
 #include "tls/s2n_record.h"
 #include "tls/s2n_renegotiate.h"
 #include "tls/s2n_resume.h"
+#include "tls/s2n_sni_trie.h"
 #include "tls/s2n_tls_parameters.h"
 #include "tls/s2n_x509_validator.h"
 #include "utils/s2n_blob.h"
+#include "utils/s2n_map.h"
 
-#define S2N_MAX_TICKET_KEYS 48
+#define S2N_MAX_TICKET_KEYS 128
+
+/* Lookup structures for config->ticket_keys, rebuilt whenever keys are added or removed */
+struct s2n_ticket_key_index {
+    pthread_rwlock_t lock;
+
+    /* Maps each key name to the key's index in config->ticket_keys */
+    struct s2n_map *names;
+
+    /* The keys in the encrypt-decrypt state between schedule_start and schedule_end.
+     * No key enters or leaves that state or passes its peak weight in between, so the
+     * schedule only needs to be recomputed when the wall clock leaves that interval or
+     * the key lifetime changes.
+     */
+    uint8_t encrypt_keys[S2N_MAX_TICKET_KEYS];
+    uint8_t encrypt_keys_len;
+    /* The cumulative weight of encrypt_keys[0..i] at schedule_start, and how much it
+     * changes per nanosecond. Every weight is linear within the interval.
+     */
+    double cumulative_weights[S2N_MAX_TICKET_KEYS];
+    int16_t cumulative_slopes[S2N_MAX_TICKET_KEYS];
+    uint64_t schedule_start;
+    uint64_t schedule_end;
+    uint64_t schedule_lifetime;
+    bool schedule_ready;
+};
 
 /*
  * TLS1.3 does not allow alert messages to be fragmented, and some TLS
@@ -47,6 +76,9 @@
 #define S2N_MIN_SEND_BUFFER_SIZE          S2N_TLS_MAX_RECORD_LEN_FOR(S2N_MIN_SEND_BUFFER_FRAGMENT_SIZE)
 
 struct s2n_cipher_preferences;
+struct s2n_early_data_replay_filter;
+struct s2n_psk_store;
+struct s2n_session_cache;
 
 typedef enum {
     S2N_NOT_OWNED = 0,
@@ -109,11 +141,19 @@ struct s2n_config {
 
     unsigned ticket_forward_secrecy : 1;
 
+    /* Reuse initialized AES-GCM contexts for each ticket key instead of
+     * deriving a new key for every ticket.
+     */
+    unsigned cache_ticket_keys : 1;
+
+    /* Record handshake timings on each connection. See s2n_config_set_handshake_timings. */
+    unsigned handshake_timings_enabled : 1;
+
     struct s2n_dh_params *dhparams;
     /* Needed until we can deprecate s2n_config_add_cert_chain_and_key. This is
      * used to release memory allocated only in the deprecated API that the application 
      * does not have a reference to. */
-    struct s2n_map *domain_name_to_cert_map;
+    struct s2n_sni_trie *domain_name_to_cert_trie;
     struct certs_by_type default_certs_by_type;
     struct s2n_blob application_protocols;
     s2n_clock_time_nanoseconds wall_clock;
@@ -134,6 +174,7 @@ struct s2n_config {
     uint64_t session_state_lifetime_in_nanos;
 
     struct s2n_array *ticket_keys;
+    struct s2n_ticket_key_index *ticket_key_index;
     uint64_t encrypt_decrypt_key_lifetime_in_nanos;
     uint64_t decrypt_key_lifetime_in_nanos;
 
@@ -147,6 +188,9 @@ struct s2n_config {
     s2n_cache_delete_callback cache_delete;
     void *cache_delete_data;
 
+    /* Set by s2n_config_enable_builtin_session_cache */
+    struct s2n_session_cache *builtin_session_cache;
+
     s2n_ct_support_level ct_type;
 
     /* Track whether the application has overriden the default client auth type.
@@ -171,6 +215,10 @@ struct s2n_config {
     s2n_crl_lookup_callback crl_lookup_cb;
     void *crl_lookup_ctx;
 
+    struct s2n_cert_cache *cert_cache;
+    s2n_cert_resolver_callback cert_resolver_cb;
+    void *cert_resolver_ctx;
+
     s2n_cert_validation_callback cert_validation_cb;
     void *cert_validation_ctx;
 
@@ -205,10 +253,14 @@ struct s2n_config {
     void *cert_request_cb_ctx;
 
     s2n_early_data_cb early_data_cb;
+    /* Set by s2n_config_enable_early_data_replay_filter */
+    struct s2n_early_data_replay_filter *early_data_replay_filter;
 
     uint32_t server_max_early_data_size;
 
     s2n_psk_mode psk_mode;
+    /* Set by s2n_config_add_psk_store. Not owned by the config. */
+    struct s2n_psk_store *psk_store;
 
     s2n_async_pkey_validation_mode async_pkey_validation_mode;
 
@@ -242,6 +294,11 @@ struct s2n_config {
 
     /* List of certificate authorities supported */
     struct s2n_blob cert_authorities;
+
+    /* Certificate compression algorithms, in order of preference.
+     * See s2n_config_set_cert_compression_preferences. */
+    uint8_t cert_compression_algorithms[S2N_CERT_COMPRESSION_ALGORITHMS_COUNT];
+    uint8_t cert_compression_algorithms_count;
 };
 
 S2N_CLEANUP_RESULT s2n_config_ptr_free(struct s2n_config **config);
@@ -56,6 +56,7 @@
 #include "utils/s2n_safety.h"
 #include "utils/s2n_socket.h"
 #include "utils/s2n_timer.h"
+#include "utils/s2n_usdt.h"
 
 #define S2N_SET_KEY_SHARE_LIST_EMPTY(keyshares) (keyshares |= 1)
 #define S2N_SET_KEY_SHARE_REQUEST(keyshares, i) (keyshares |= (1 << (i + 1)))
@@ -256,6 +257,8 @@ int s2n_connection_free(struct s2n_connection *conn)
 {
     POSIX_GUARD(s2n_connection_wipe_keys(conn));
     POSIX_GUARD_RESULT(s2n_psk_parameters_wipe(&conn->psk_params));
+    POSIX_GUARD_RESULT(s2n_cert_resolver_wipe(&conn->cert_resolver));
+    POSIX_GUARD_RESULT(s2n_handshake_timings_free(&conn->handshake_timings));
 
     POSIX_GUARD_RESULT(s2n_prf_free(conn));
     POSIX_GUARD_RESULT(s2n_handshake_hashes_free(&conn->handshake.hashes));
@@ -470,6 +473,7 @@ int s2n_connection_free_handshake(struct s2n_connection *conn)
 int s2n_connection_wipe(struct s2n_connection *conn)
 {
     POSIX_ENSURE_REF(conn);
+    S2N_USDT_PROBE3(connection_wipe, conn, conn->wire_bytes_in, conn->wire_bytes_out);
 
     /* First make a copy of everything we'd like to save, which isn't very much. */
     int mode = conn->mode;
@@ -523,7 +527,9 @@ int s2n_connection_wipe(struct s2n_connection *conn)
     POSIX_GUARD(s2n_stuffer_free(&conn->in));
 
     POSIX_GUARD_RESULT(s2n_psk_parameters_wipe(&conn->psk_params));
+    POSIX_GUARD_RESULT(s2n_cert_resolver_wipe(&conn->cert_resolver));
     POSIX_GUARD_RESULT(s2n_async_offload_op_wipe(&conn->async_offload_op));
+    POSIX_GUARD_RESULT(s2n_handshake_timings_free(&conn->handshake_timings));
 
     /* Wipe the I/O-related info and restore the original socket if necessary */
     POSIX_GUARD(s2n_connection_wipe_io(conn));
@@ -943,6 +949,18 @@ uint64_t s2n_connection_get_wire_bytes_out(struct s2n_connection *conn)
     return conn->wire_bytes_out;
 }
 
+int s2n_connection_get_stats(struct s2n_connection *conn, struct s2n_connection_stats *stats, uint32_t stats_size)
+{
+    POSIX_ENSURE_REF(conn);
+    POSIX_ENSURE_REF(stats);
+
+    /* The caller may have been built with a shorter or longer version of the struct */
+    uint32_t known_size = MIN(stats_size, sizeof(conn->stats));
+    POSIX_CHECKED_MEMSET(stats, 0, stats_size);
+    POSIX_CHECKED_MEMCPY(stats, &conn->stats, known_size);
+    return S2N_SUCCESS;
+}
+
 const char *s2n_connection_get_cipher(struct s2n_connection *conn)
 {
     PTR_ENSURE_REF(conn);
@@ -20,16 +20,19 @@
 #include <stdint.h>
 
 #include "api/s2n.h"
+#include "api/unstable/connection_stats.h"
 #include "crypto/s2n_hash.h"
 #include "crypto/s2n_hmac.h"
 #include "stuffer/s2n_stuffer.h"
 #include "tls/s2n_async_offload.h"
+#include "tls/s2n_cert_resolver.h"
 #include "tls/s2n_client_hello.h"
 #include "tls/s2n_config.h"
 #include "tls/s2n_crypto.h"
 #include "tls/s2n_early_data.h"
 #include "tls/s2n_ecc_preferences.h"
 #include "tls/s2n_handshake.h"
+#include "tls/s2n_handshake_timings.h"
 #include "tls/s2n_kem_preferences.h"
 #include "tls/s2n_key_update.h"
 #include "tls/s2n_post_handshake.h"
@@ -317,10 +320,15 @@ struct s2n_connection {
      * If set, the client and server have both agreed to fragment their records to the given length. */
     uint8_t negotiated_mfl_code;
 
+    /* Certificate compression algorithm applied to the server's Certificate message.
+     * Zero if the Certificate message is not compressed. */
+    uint8_t cert_compression_algorithm;
+
     /* Keep some accounting on each connection */
     uint64_t wire_bytes_in;
     uint64_t wire_bytes_out;
     uint64_t early_data_bytes;
+    struct s2n_connection_stats stats;
 
     /* Either the reader or the writer can trigger both sides of the connection
      * to close in response to a fatal error.
@@ -352,10 +360,14 @@ struct s2n_connection {
 
     struct s2n_client_hello client_hello;
 
+    struct s2n_cert_resolver cert_resolver;
+
     struct s2n_x509_validator x509_validator;
 
     struct s2n_async_offload_op async_offload_op;
 
+    struct s2n_handshake_timings *handshake_timings;
+
     /* After a connection is created this is the verification function that should always be used. At init time,
      * the config should be checked for a verify callback and each connection should default to that. However,
      * from the user's perspective, it's sometimes simpler to manage state by attaching each validation function/data
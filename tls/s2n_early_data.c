@@ -19,6 +19,7 @@
 
 #include "tls/s2n_cipher_suites.h"
 #include "tls/s2n_connection.h"
+#include "tls/s2n_early_data_replay.h"
 #include "tls/s2n_psk.h"
 #include "utils/s2n_mem.h"
 #include "utils/s2n_safety.h"
@@ -140,13 +141,23 @@ S2N_RESULT s2n_early_data_accept_or_reject(struct s2n_connection *conn)
         return S2N_RESULT_OK;
     }
 
+    /* Reject early data that may have been replayed. The handshake continues without early data. */
+    RESULT_ENSURE_REF(conn->config);
+    if (conn->config->early_data_replay_filter) {
+        bool is_replay = true;
+        RESULT_GUARD(s2n_early_data_replay_check(conn, &is_replay));
+        if (is_replay) {
+            RESULT_GUARD(s2n_connection_set_early_data_state(conn, S2N_EARLY_DATA_REJECTED));
+            return S2N_RESULT_OK;
+        }
+    }
+
     /* If early data would otherwise be accepted, let the application apply any additional restrictions.
      * For example, an application could use this callback to implement anti-replay protections.
      *
      * This callback can be either synchronous or asynchronous. The handshake will not proceed until
      * the application either accepts or rejects early data.
      */
-    RESULT_ENSURE_REF(conn->config);
     if (conn->config->early_data_cb) {
         conn->handshake.early_data_async_state.conn = conn;
         RESULT_ENSURE(conn->config->early_data_cb(conn, &conn->handshake.early_data_async_state) >= S2N_SUCCESS,
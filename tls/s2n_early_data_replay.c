@@ -0,0 +1,244 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_early_data_replay.h"
+
+#include <string.h>
+
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "tls/s2n_psk.h"
+#include "tls/s2n_resume.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+/* About 16 bits per expected handshake, with 6 bits set per binder,
+ * gives a false positive rate of roughly 0.1% when the filter is full.
+ */
+#define S2N_EARLY_DATA_REPLAY_HANDSHAKES_PER_WORD 4
+#define S2N_EARLY_DATA_REPLAY_MIN_WORDS           64
+#define S2N_EARLY_DATA_REPLAY_BITS_PER_BINDER     6
+/* The word index uses at most the low 22 bits of the hash */
+#define S2N_EARLY_DATA_REPLAY_BIT_POSITIONS_SHIFT 28
+
+static S2N_RESULT s2n_early_data_replay_filter_alloc(struct s2n_early_data_replay_filter **filter)
+{
+    RESULT_ENSURE_REF(filter);
+    RESULT_ENSURE(*filter == NULL, S2N_ERR_SAFETY);
+
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_early_data_replay_filter)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+
+    *filter = (struct s2n_early_data_replay_filter *) (void *) mem.data;
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_early_data_replay_filter_new(uint32_t max_handshakes_per_window, uint32_t window_in_secs,
+        struct s2n_early_data_replay_filter **filter)
+{
+    RESULT_ENSURE_REF(filter);
+    RESULT_ENSURE(max_handshakes_per_window > 0, S2N_ERR_INVALID_ARGUMENT);
+    RESULT_ENSURE(max_handshakes_per_window <= S2N_EARLY_DATA_REPLAY_MAX_HANDSHAKES, S2N_ERR_INVALID_ARGUMENT);
+    RESULT_ENSURE(window_in_secs > 0, S2N_ERR_INVALID_ARGUMENT);
+
+    uint64_t word_count = S2N_EARLY_DATA_REPLAY_MIN_WORDS;
+    while (word_count * S2N_EARLY_DATA_REPLAY_HANDSHAKES_PER_WORD < max_handshakes_per_window) {
+        word_count *= 2;
+    }
+
+    DEFER_CLEANUP(struct s2n_early_data_replay_filter *new_filter = NULL, s2n_early_data_replay_filter_ptr_free);
+    RESULT_GUARD(s2n_early_data_replay_filter_alloc(&new_filter));
+
+    /* Both filters share one allocation */
+    RESULT_GUARD_POSIX(s2n_alloc(&new_filter->words_mem, word_count * sizeof(uint64_t) * 2));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&new_filter->words_mem));
+    new_filter->current = (uint64_t *) (void *) new_filter->words_mem.data;
+    new_filter->previous = new_filter->current + word_count;
+    new_filter->word_mask = word_count - 1;
+    new_filter->window_in_nanos = (uint64_t) window_in_secs * ONE_SEC_IN_NANOS;
+
+    RESULT_GUARD(s2n_siphash_key_generate(&new_filter->hash_key));
+    RESULT_ENSURE_EQ(pthread_rwlock_init(&new_filter->lock, NULL), 0);
+
+    *filter = new_filter;
+    new_filter = NULL;
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_early_data_replay_filter_free(struct s2n_early_data_replay_filter **filter)
+{
+    RESULT_ENSURE_REF(filter);
+    struct s2n_early_data_replay_filter *to_free = *filter;
+    if (to_free == NULL) {
+        return S2N_RESULT_OK;
+    }
+
+    if (to_free->current) {
+        RESULT_ENSURE_EQ(pthread_rwlock_destroy(&to_free->lock), 0);
+    }
+    RESULT_GUARD_POSIX(s2n_free(&to_free->words_mem));
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) filter, sizeof(struct s2n_early_data_replay_filter)));
+    return S2N_RESULT_OK;
+}
+
+S2N_CLEANUP_RESULT s2n_early_data_replay_filter_ptr_free(struct s2n_early_data_replay_filter **filter)
+{
+    RESULT_GUARD(s2n_early_data_replay_filter_free(filter));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_early_data_replay_filter_hash(struct s2n_early_data_replay_filter *filter, const struct s2n_blob *binder,
+        uint64_t *hash)
+{
+    RESULT_ENSURE_REF(filter);
+    RESULT_ENSURE_REF(binder);
+    RESULT_ENSURE_REF(hash);
+    *hash = s2n_siphash(&filter->hash_key, binder->data, binder->size);
+    return S2N_RESULT_OK;
+}
+
+static uint64_t s2n_early_data_replay_bits(uint64_t hash)
+{
+    uint64_t bits = 0;
+    uint64_t positions = hash >> S2N_EARLY_DATA_REPLAY_BIT_POSITIONS_SHIFT;
+    for (size_t i = 0; i < S2N_EARLY_DATA_REPLAY_BITS_PER_BINDER; i++) {
+        bits |= UINT64_C(1) << (positions & 63);
+        positions >>= 6;
+    }
+    return bits;
+}
+
+static bool s2n_early_data_replay_window_ended(struct s2n_early_data_replay_filter *filter, uint64_t now)
+{
+    return now >= filter->window_start && now - filter->window_start >= filter->window_in_nanos;
+}
+
+/* A binder recorded during a window is remembered until the end of the following window,
+ * so every binder is remembered for at least one full window.
+ */
+static void s2n_early_data_replay_rotate_locked(struct s2n_early_data_replay_filter *filter, uint64_t now)
+{
+    size_t filter_size = (filter->word_mask + 1) * sizeof(uint64_t);
+
+    /* If a whole window passed without any checks, the current filter is also too old to keep */
+    if (now - filter->window_start >= filter->window_in_nanos * 2) {
+        memset(filter->current, 0, filter_size);
+    }
+
+    uint64_t *expired = filter->previous;
+    filter->previous = filter->current;
+    filter->current = expired;
+    memset(filter->current, 0, filter_size);
+    filter->window_start = now;
+}
+
+S2N_RESULT s2n_early_data_replay_filter_check(struct s2n_early_data_replay_filter *filter, uint64_t hash, uint64_t now,
+        bool *is_replay)
+{
+    RESULT_ENSURE_REF(filter);
+    RESULT_ENSURE_REF(is_replay);
+
+    uint64_t index = hash & filter->word_mask;
+    uint64_t bits = s2n_early_data_replay_bits(hash);
+
+    /* Setting bits only needs the read lock if the bits can be set atomically */
+#if S2N_ATOMIC_SUPPORTED
+    bool exclusive = false;
+#else
+    bool exclusive = true;
+#endif
+    RESULT_ENSURE_EQ(pthread_rwlock_rdlock(&filter->lock), 0);
+    if (exclusive || s2n_early_data_replay_window_ended(filter, now)) {
+        RESULT_ENSURE_EQ(pthread_rwlock_unlock(&filter->lock), 0);
+        RESULT_ENSURE_EQ(pthread_rwlock_wrlock(&filter->lock), 0);
+        exclusive = true;
+        /* Another thread may have already started the new window */
+        if (s2n_early_data_replay_window_ended(filter, now)) {
+            s2n_early_data_replay_rotate_locked(filter, now);
+        }
+    }
+
+    bool seen_previously = (filter->previous[index] & bits) == bits;
+    uint64_t old_bits = 0;
+    if (exclusive) {
+        old_bits = filter->current[index];
+        filter->current[index] |= bits;
+    } else {
+#if S2N_ATOMIC_SUPPORTED
+        old_bits = __atomic_fetch_or(&filter->current[index], bits, __ATOMIC_RELAXED);
+#endif
+    }
+    RESULT_ENSURE_EQ(pthread_rwlock_unlock(&filter->lock), 0);
+
+    *is_replay = seen_previously || (old_bits & bits) == bits;
+    return S2N_RESULT_OK;
+}
+
+/* Recording ClientHellos only detects replays within the recording window, so early data
+ * must also be rejected if the ClientHello could be older than the window.
+ * See https://www.rfc-editor.org/rfc/rfc8446#section-8.3
+ */
+static bool s2n_early_data_replay_is_fresh(struct s2n_connection *conn, uint64_t now)
+{
+    struct s2n_psk *psk = conn->psk_params.chosen_psk;
+
+    /* Only tickets tell the server when the client thinks the ClientHello was sent */
+    if (psk->type != S2N_PSK_TYPE_RESUMPTION) {
+        return false;
+    }
+
+    /* The ClientHello should arrive when the ticket was issued plus the client's view of the ticket age.
+     * Allowing half a window of skew either way means that a ClientHello accepted at the start
+     * of the allowed skew is still remembered when it is replayed at the end of the allowed skew.
+     */
+    uint64_t client_ticket_age = (uint64_t) conn->psk_params.chosen_psk_ticket_age_in_millis * ONE_MILLISEC_IN_NANOS;
+    uint64_t expected_arrival_time = psk->ticket_issue_time + client_ticket_age;
+    uint64_t skew = (now > expected_arrival_time) ? now - expected_arrival_time : expected_arrival_time - now;
+    return skew <= conn->config->early_data_replay_filter->window_in_nanos / 2;
+}
+
+S2N_RESULT s2n_early_data_replay_check(struct s2n_connection *conn, bool *is_replay)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(conn->config);
+    RESULT_ENSURE_REF(conn->psk_params.chosen_psk);
+    RESULT_ENSURE_REF(is_replay);
+
+    struct s2n_early_data_replay_filter *filter = conn->config->early_data_replay_filter;
+    RESULT_ENSURE_REF(filter);
+
+    uint64_t now = 0;
+    RESULT_GUARD(s2n_config_wall_clock(conn->config, &now));
+
+    if (!s2n_early_data_replay_is_fresh(conn, now)) {
+        *is_replay = true;
+        return S2N_RESULT_OK;
+    }
+
+    RESULT_GUARD(s2n_early_data_replay_filter_check(filter, conn->psk_params.chosen_psk_binder_hash, now, is_replay));
+    return S2N_RESULT_OK;
+}
+
+int s2n_config_enable_early_data_replay_filter(struct s2n_config *config, uint32_t max_handshakes_per_window,
+        uint32_t window_in_secs)
+{
+    POSIX_ENSURE_REF(config);
+    POSIX_ENSURE(config->early_data_replay_filter == NULL, S2N_ERR_INVALID_STATE);
+    POSIX_GUARD_RESULT(s2n_early_data_replay_filter_new(max_handshakes_per_window, window_in_secs,
+            &config->early_data_replay_filter));
+    return S2N_SUCCESS;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+#include "api/unstable/early_data_replay.h"
+#include "utils/s2n_blob.h"
+#include "utils/s2n_result.h"
+#include "utils/s2n_siphash.h"
+
+/* A time-windowed filter that detects replayed ClientHellos.
+ *
+ * Two register-blocked Bloom filters take turns recording the PSK binders seen in a window.
+ * All of the bits for a binder live in a single 64 bit word, so each check touches
+ * one cache line per filter. When a window ends, the current filter becomes the previous one
+ * and the old previous filter is cleared for the new window.
+ *
+ * Checks only take the read lock and set bits with an atomic OR,
+ * so concurrent handshakes only serialize when the window rotates.
+ */
+
+struct s2n_connection;
+
+#define S2N_EARLY_DATA_REPLAY_MAX_HANDSHAKES (1 << 24)
+
+struct s2n_early_data_replay_filter {
+    pthread_rwlock_t lock;
+    struct s2n_siphash_key hash_key;
+    struct s2n_blob words_mem;
+    uint64_t *current;
+    uint64_t *previous;
+    uint64_t word_mask;
+    uint64_t window_in_nanos;
+    uint64_t window_start;
+};
+
+S2N_RESULT s2n_early_data_replay_filter_new(uint32_t max_handshakes_per_window, uint32_t window_in_secs,
+        struct s2n_early_data_replay_filter **filter);
+S2N_RESULT s2n_early_data_replay_filter_free(struct s2n_early_data_replay_filter **filter);
+S2N_CLEANUP_RESULT s2n_early_data_replay_filter_ptr_free(struct s2n_early_data_replay_filter **filter);
+S2N_RESULT s2n_early_data_replay_filter_hash(struct s2n_early_data_replay_filter *filter, const struct s2n_blob *binder,
+        uint64_t *hash);
+S2N_RESULT s2n_early_data_replay_filter_check(struct s2n_early_data_replay_filter *filter, uint64_t hash, uint64_t now,
+        bool *is_replay);
+
+S2N_RESULT s2n_early_data_replay_check(struct s2n_connection *conn, bool *is_replay);
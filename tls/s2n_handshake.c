@@ -20,8 +20,8 @@
 #include "tls/s2n_cipher_suites.h"
 #include "tls/s2n_connection.h"
 #include "tls/s2n_record.h"
+#include "tls/s2n_sni_trie.h"
 #include "tls/s2n_tls.h"
-#include "utils/s2n_map.h"
 #include "utils/s2n_safety.h"
 
 int s2n_handshake_write_header(struct s2n_stuffer *out, uint8_t message_type)
@@ -70,32 +70,9 @@ static int s2n_handshake_get_hash_state_ptr(struct s2n_connection *conn, s2n_has
     POSIX_ENSURE_REF(conn);
     POSIX_ENSURE_REF(conn->handshake.hashes);
 
-    switch (hash_alg) {
-        case S2N_HASH_MD5:
-            *hash_state = &conn->handshake.hashes->md5;
-            break;
-        case S2N_HASH_SHA1:
-            *hash_state = &conn->handshake.hashes->sha1;
-            break;
-        case S2N_HASH_SHA224:
-            *hash_state = &conn->handshake.hashes->sha224;
-            break;
-        case S2N_HASH_SHA256:
-            *hash_state = &conn->handshake.hashes->sha256;
-            break;
-        case S2N_HASH_SHA384:
-            *hash_state = &conn->handshake.hashes->sha384;
-            break;
-        case S2N_HASH_SHA512:
-            *hash_state = &conn->handshake.hashes->sha512;
-            break;
-        case S2N_HASH_MD5_SHA1:
-            *hash_state = &conn->handshake.hashes->md5_sha1;
-            break;
-        default:
-            POSIX_BAIL(S2N_ERR_HASH_INVALID_ALGORITHM);
-            break;
-    }
+    /* Hash states are set up on first use */
+    POSIX_GUARD_RESULT(s2n_handshake_hashes_activate(conn->handshake.hashes, hash_alg));
+    POSIX_GUARD_RESULT(s2n_handshake_hashes_get_state(conn->handshake.hashes, hash_alg, hash_state));
 
     return S2N_SUCCESS;
 }
@@ -133,31 +110,91 @@ uint8_t s2n_handshake_is_hash_required(struct s2n_handshake *handshake, s2n_hash
     return handshake->required_hash_algs[hash_alg];
 }
 
-/* Update the required handshake hash algs depending on current handshake session state.
- * This function must called at the end of a handshake message handler. Additionally it must be called after the
- * ClientHello or ServerHello is processed in client and server mode respectively. The relevant handshake parameters
- * are not available until those messages are processed.
+/* Whether the hash for a TLS1.2 or earlier client CertificateVerify may still be needed, but isn't known yet.
+ *
+ * The client chooses its signature scheme when it receives the CertificateRequest,
+ * but the server only learns it from the CertificateVerify message itself.
  */
-int s2n_conn_update_required_handshake_hashes(struct s2n_connection *conn)
+static bool s2n_handshake_is_client_cert_verify_hash_pending(struct s2n_connection *conn)
 {
-    POSIX_ENSURE_REF(conn);
-    POSIX_ENSURE_REF(conn->secure);
+    if (conn->actual_protocol_version >= S2N_TLS13) {
+        /* The TLS1.3 CertificateVerify signs the transcript hash, which always uses the PRF hash */
+        return false;
+    }
 
-    /* Clear all of the required hashes */
-    memset(conn->handshake.required_hash_algs, 0, sizeof(conn->handshake.required_hash_algs));
+    s2n_cert_auth_type client_cert_auth_type = S2N_CERT_AUTH_NONE;
+    if (s2n_connection_get_client_auth_type(conn, &client_cert_auth_type) != S2N_SUCCESS
+            || client_cert_auth_type == S2N_CERT_AUTH_NONE) {
+        return false;
+    }
 
     message_type_t handshake_message = s2n_conn_get_current_message_type(conn);
-    const uint8_t client_cert_verify_done = (handshake_message >= CLIENT_CERT_VERIFY) ? 1 : 0;
-    s2n_cert_auth_type client_cert_auth_type;
-    POSIX_GUARD(s2n_connection_get_client_auth_type(conn, &client_cert_auth_type));
+    if (handshake_message >= CLIENT_CERT_VERIFY) {
+        return false;
+    }
+    if (conn->mode == S2N_CLIENT && handshake_message >= SERVER_CERT_REQ) {
+        return false;
+    }
+    return true;
+}
 
-    /* If client authentication is possible, all hashes are needed until we're past CLIENT_CERT_VERIFY. */
-    if ((client_cert_auth_type != S2N_CERT_AUTH_NONE) && !client_cert_verify_done) {
-        POSIX_GUARD(s2n_handshake_require_all_hashes(&conn->handshake));
-        return S2N_SUCCESS;
+/* Whether a hash that isn't active yet may still need to catch up on the transcript.
+ *
+ * The cipher suite, and so the PRF hash, isn't final until the ServerHello is sent.
+ * If client authentication is possible, the hash for the client CertificateVerify
+ * isn't known until its signature scheme is chosen.
+ */
+static bool s2n_handshake_is_transcript_needed(struct s2n_connection *conn)
+{
+    if (s2n_conn_get_current_message_type(conn) < SERVER_HELLO) {
+        return true;
+    }
+    return s2n_handshake_is_client_cert_verify_hash_pending(conn);
+}
+
+/* Now that we know which hashes are required, catch them up on the buffered transcript. */
+static S2N_RESULT s2n_handshake_activate_required_hashes(struct s2n_connection *conn)
+{
+    RESULT_ENSURE_REF(conn);
+    struct s2n_handshake_hashes *hashes = conn->handshake.hashes;
+    RESULT_ENSURE_REF(hashes);
+
+    const s2n_hash_algorithm transcript_hash_algs[] = {
+        S2N_HASH_MD5, S2N_HASH_SHA1, S2N_HASH_SHA224, S2N_HASH_SHA256, S2N_HASH_SHA384, S2N_HASH_SHA512
+    };
+    for (size_t i = 0; i < s2n_array_len(transcript_hash_algs); i++) {
+        if (s2n_handshake_is_hash_required(&conn->handshake, transcript_hash_algs[i])) {
+            RESULT_GUARD(s2n_handshake_hashes_activate(hashes, transcript_hash_algs[i]));
+        }
+    }
+
+    /* The combined MD5_SHA1 hash is used by TLS1.0 and TLS1.1 signatures */
+    if (s2n_handshake_is_hash_required(&conn->handshake, S2N_HASH_MD5)
+            && s2n_handshake_is_hash_required(&conn->handshake, S2N_HASH_SHA1)) {
+        RESULT_GUARD(s2n_handshake_hashes_activate(hashes, S2N_HASH_MD5_SHA1));
+    }
+
+    return S2N_RESULT_OK;
+}
+
+/* Later messages are only fed to the active required hashes, so once no other
+ * hash can be needed the buffered transcript can be released.
+ */
+S2N_RESULT s2n_handshake_release_unneeded_transcript(struct s2n_connection *conn)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(conn->handshake.hashes);
+    if (!conn->handshake.hashes->transcript_buffered || s2n_handshake_is_transcript_needed(conn)) {
+        return S2N_RESULT_OK;
     }
 
-    /* We don't need all of the hashes. Set the hash alg(s) required for the PRF */
+    RESULT_GUARD(s2n_handshake_activate_required_hashes(conn));
+    RESULT_GUARD(s2n_handshake_hashes_release_transcript(conn->handshake.hashes));
+    return S2N_RESULT_OK;
+}
+
+static int s2n_handshake_require_prf_hashes(struct s2n_connection *conn)
+{
     switch (conn->actual_protocol_version) {
         case S2N_SSLv3:
         case S2N_TLS10:
@@ -176,7 +213,43 @@ int s2n_conn_update_required_handshake_hashes(struct s2n_connection *conn)
             break;
         }
     }
+    return S2N_SUCCESS;
+}
+
+/* Update the required handshake hash algs depending on current handshake session state.
+ * This function must called at the end of a handshake message handler. Additionally it must be called after the
+ * ClientHello or ServerHello is processed in client and server mode respectively. The relevant handshake parameters
+ * are not available until those messages are processed.
+ */
+int s2n_conn_update_required_handshake_hashes(struct s2n_connection *conn)
+{
+    POSIX_ENSURE_REF(conn);
+    POSIX_ENSURE_REF(conn->secure);
+
+    /* Clear all of the required hashes */
+    memset(conn->handshake.required_hash_algs, 0, sizeof(conn->handshake.required_hash_algs));
+
+    POSIX_GUARD(s2n_handshake_require_prf_hashes(conn));
 
+    /* If client authentication is possible, the hash for the client CertificateVerify is needed
+     * until we're past CLIENT_CERT_VERIFY. The client knows that hash once it chooses its signature scheme.
+     * Until the hash is known, the transcript stays buffered so that the hash can catch up once it is.
+     */
+    message_type_t handshake_message = s2n_conn_get_current_message_type(conn);
+    const uint8_t client_cert_verify_done = (handshake_message >= CLIENT_CERT_VERIFY) ? 1 : 0;
+    const struct s2n_signature_scheme *client_cert_sig_scheme = conn->handshake_params.client_cert_sig_scheme;
+    if (conn->actual_protocol_version < S2N_TLS13 && !client_cert_verify_done
+            && client_cert_sig_scheme && client_cert_sig_scheme->hash_alg != S2N_HASH_NONE) {
+        if (client_cert_sig_scheme->hash_alg == S2N_HASH_MD5_SHA1) {
+            POSIX_GUARD(s2n_handshake_require_hash(&conn->handshake, S2N_HASH_MD5));
+            POSIX_GUARD(s2n_handshake_require_hash(&conn->handshake, S2N_HASH_SHA1));
+        } else {
+            POSIX_GUARD(s2n_handshake_require_hash(&conn->handshake, client_cert_sig_scheme->hash_alg));
+        }
+    }
+
+    POSIX_GUARD_RESULT(s2n_handshake_activate_required_hashes(conn));
+    POSIX_GUARD_RESULT(s2n_handshake_release_unneeded_transcript(conn));
     return S2N_SUCCESS;
 }
 
@@ -219,30 +292,12 @@ int s2n_create_wildcard_hostname(struct s2n_stuffer *hostname_stuffer, struct s2
     return S2N_SUCCESS;
 }
 
-static int s2n_find_cert_matches(struct s2n_map *domain_name_to_cert_map,
-        struct s2n_blob *dns_name,
-        struct s2n_cert_chain_and_key *matches[S2N_CERT_TYPE_COUNT],
-        uint8_t *match_exists)
-{
-    struct s2n_blob map_value = { 0 };
-    bool key_found = false;
-    POSIX_GUARD_RESULT(s2n_map_lookup(domain_name_to_cert_map, dns_name, &map_value, &key_found));
-    if (key_found) {
-        struct certs_by_type *value = (void *) map_value.data;
-        for (int i = 0; i < S2N_CERT_TYPE_COUNT; i++) {
-            matches[i] = value->certs[i];
-        }
-        *match_exists = 1;
-    }
-
-    return S2N_SUCCESS;
-}
-
 /* Find certificates that match the ServerName TLS extension sent by the client.
  * For a given ServerName there can be multiple matching certificates based on the
  * type of key in the certificate.
  *
- * A match is determined using s2n_map lookup by DNS name.
+ * A match is determined by walking the config's trie of DNS names, which finds both
+ * the exact match and the wildcard match in a single pass.
  * Wildcards that have a single * in the left most label are supported.
  */
 int s2n_conn_find_name_matching_certs(struct s2n_connection *conn)
@@ -250,6 +305,22 @@ int s2n_conn_find_name_matching_certs(struct s2n_connection *conn)
     if (!s2n_server_received_server_name(conn)) {
         return S2N_SUCCESS;
     }
+
+    /* A certificate provided by the cert resolver callback is the only exact match */
+    struct s2n_cert_chain_and_key *resolved_chain = s2n_cert_resolver_get_chain(conn);
+    if (resolved_chain) {
+        s2n_pkey_type cert_type = s2n_cert_chain_and_key_get_pkey_type(resolved_chain);
+        POSIX_ENSURE(cert_type >= 0 && cert_type < S2N_CERT_TYPE_COUNT, S2N_ERR_CERT_TYPE_UNSUPPORTED);
+        conn->handshake_params.exact_sni_matches[cert_type] = resolved_chain;
+        conn->handshake_params.exact_sni_match_exists = 1;
+        conn->server_name_used = 1;
+        return S2N_SUCCESS;
+    }
+
+    if (conn->config->domain_name_to_cert_trie == NULL) {
+        return S2N_SUCCESS;
+    }
+
     const char *name = conn->server_name;
     struct s2n_blob hostname_blob = { 0 };
     POSIX_GUARD(s2n_blob_init(&hostname_blob, (uint8_t *) (uintptr_t) name, strlen(name)));
@@ -258,39 +329,22 @@ int s2n_conn_find_name_matching_certs(struct s2n_connection *conn)
     POSIX_CHECKED_MEMCPY(normalized_hostname, hostname_blob.data, hostname_blob.size);
     struct s2n_blob normalized_name = { 0 };
     POSIX_GUARD(s2n_blob_init(&normalized_name, (uint8_t *) normalized_hostname, hostname_blob.size));
-
     POSIX_GUARD(s2n_blob_char_to_lower(&normalized_name));
-    struct s2n_stuffer normalized_hostname_stuffer = { 0 };
-    POSIX_GUARD(s2n_stuffer_init(&normalized_hostname_stuffer, &normalized_name));
-    POSIX_GUARD(s2n_stuffer_skip_write(&normalized_hostname_stuffer, normalized_name.size));
-
-    /* Find the exact matches for the ServerName */
-    POSIX_GUARD(s2n_find_cert_matches(conn->config->domain_name_to_cert_map,
-            &normalized_name,
-            conn->handshake_params.exact_sni_matches,
-            &(conn->handshake_params.exact_sni_match_exists)));
-
-    if (!conn->handshake_params.exact_sni_match_exists) {
-        /* We have not yet found an exact domain match. Try to find wildcard matches. */
-        char wildcard_hostname[S2N_MAX_SERVER_NAME + 1] = { 0 };
-        struct s2n_blob wildcard_blob = { 0 };
-        POSIX_GUARD(s2n_blob_init(&wildcard_blob, (uint8_t *) wildcard_hostname, sizeof(wildcard_hostname)));
-        struct s2n_stuffer wildcard_stuffer = { 0 };
-        POSIX_GUARD(s2n_stuffer_init(&wildcard_stuffer, &wildcard_blob));
-        POSIX_GUARD(s2n_create_wildcard_hostname(&normalized_hostname_stuffer, &wildcard_stuffer));
-        const uint32_t wildcard_len = s2n_stuffer_data_available(&wildcard_stuffer);
-
-        /* Couldn't create a valid wildcard from the input */
-        if (wildcard_len == 0) {
-            return S2N_SUCCESS;
-        }
 
-        /* The client's SNI is wildcardified, do an exact match against the set of server certs. */
-        wildcard_blob.size = wildcard_len;
-        POSIX_GUARD(s2n_find_cert_matches(conn->config->domain_name_to_cert_map,
-                &wildcard_blob,
-                conn->handshake_params.wc_sni_matches,
-                &(conn->handshake_params.wc_sni_match_exists)));
+    struct s2n_sni_trie_match match = { 0 };
+    POSIX_GUARD_RESULT(s2n_sni_trie_lookup(conn->config->domain_name_to_cert_trie, &normalized_name, &match));
+
+    if (match.exact_match_exists) {
+        for (int i = 0; i < S2N_CERT_TYPE_COUNT; i++) {
+            conn->handshake_params.exact_sni_matches[i] = match.exact.certs[i];
+        }
+        conn->handshake_params.exact_sni_match_exists = 1;
+    } else if (match.wildcard_match_exists) {
+        /* We have not found an exact domain match, so use the wildcard matches */
+        for (int i = 0; i < S2N_CERT_TYPE_COUNT; i++) {
+            conn->handshake_params.wc_sni_matches[i] = match.wildcard.certs[i];
+        }
+        conn->handshake_params.wc_sni_match_exists = 1;
     }
 
     /* If we found a suitable cert, we should send back the ServerName extension.
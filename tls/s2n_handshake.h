@@ -44,6 +44,7 @@
 #define TLS_SERVER_CERT_STATUS        22
 #define TLS_SERVER_SESSION_LOOKUP     23
 #define TLS_KEY_UPDATE                24
+#define TLS_COMPRESSED_CERTIFICATE    25
 #define TLS_NPN                       67
 #define TLS_MESSAGE_HASH              254
 
@@ -202,6 +203,9 @@ struct s2n_handshake {
     /* Indicates that this is a renegotiation handshake */
     unsigned renegotiation : 1;
 
+    /* Indicates the server sent a CompressedCertificate message instead of a Certificate message */
+    unsigned compressed_certificate : 1;
+
     s2n_state_machine state_machine;
 };
 
@@ -212,6 +216,7 @@ message_type_t s2n_conn_get_current_message_type(const struct s2n_connection *co
 int s2n_handshake_require_all_hashes(struct s2n_handshake *handshake);
 uint8_t s2n_handshake_is_hash_required(struct s2n_handshake *handshake, s2n_hash_algorithm hash_alg);
 int s2n_conn_update_required_handshake_hashes(struct s2n_connection *conn);
+S2N_RESULT s2n_handshake_release_unneeded_transcript(struct s2n_connection *conn);
 S2N_RESULT s2n_handshake_copy_hash_state(struct s2n_connection *conn, s2n_hash_algorithm hash_alg, struct s2n_hash_state *hash_state);
 S2N_RESULT s2n_handshake_reset_hash_state(struct s2n_connection *conn, s2n_hash_algorithm hash_alg);
 int s2n_conn_find_name_matching_certs(struct s2n_connection *conn);
@@ -21,61 +21,120 @@
 #include "utils/s2n_mem.h"
 #include "utils/s2n_safety.h"
 
-static S2N_RESULT s2n_handshake_hashes_new_hashes(struct s2n_handshake_hashes *hashes)
+/* The hash algorithms that can be used for the handshake transcript */
+static const s2n_hash_algorithm s2n_handshake_hash_algs[] = {
+    S2N_HASH_MD5,
+    S2N_HASH_SHA1,
+    S2N_HASH_SHA224,
+    S2N_HASH_SHA256,
+    S2N_HASH_SHA384,
+    S2N_HASH_SHA512,
+    S2N_HASH_MD5_SHA1,
+};
+
+S2N_RESULT s2n_handshake_hashes_get_state(struct s2n_handshake_hashes *hashes, s2n_hash_algorithm hash_alg,
+        struct s2n_hash_state **hash_state)
 {
     RESULT_ENSURE_REF(hashes);
-    RESULT_GUARD_POSIX(s2n_hash_new(&hashes->md5));
-    RESULT_GUARD_POSIX(s2n_hash_new(&hashes->sha1));
-    RESULT_GUARD_POSIX(s2n_hash_new(&hashes->sha224));
-    RESULT_GUARD_POSIX(s2n_hash_new(&hashes->sha256));
-    RESULT_GUARD_POSIX(s2n_hash_new(&hashes->sha384));
-    RESULT_GUARD_POSIX(s2n_hash_new(&hashes->sha512));
-    RESULT_GUARD_POSIX(s2n_hash_new(&hashes->md5_sha1));
-    RESULT_GUARD_POSIX(s2n_hash_new(&hashes->hash_workspace));
+    RESULT_ENSURE_REF(hash_state);
+    RESULT_ENSURE(hash_alg > S2N_HASH_NONE && hash_alg < S2N_HASH_ALGS_COUNT, S2N_ERR_HASH_INVALID_ALGORITHM);
+
+    /* Only hash states that have been activated exist */
+    *hash_state = hashes->transcript_hashes[hash_alg];
+    RESULT_ENSURE(*hash_state, S2N_ERR_HASH_NOT_READY);
+    return S2N_RESULT_OK;
+}
+
+/* Hash states are allocated lazily, so may never have been set up */
+static S2N_RESULT s2n_handshake_hashes_free_hash(struct s2n_hash_state **hash_state)
+{
+    RESULT_ENSURE_REF(hash_state);
+    if (*hash_state == NULL) {
+        return S2N_RESULT_OK;
+    }
+    RESULT_GUARD_POSIX(s2n_hash_free(*hash_state));
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) hash_state, sizeof(struct s2n_hash_state)));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_handshake_hashes_alloc_hash(struct s2n_hash_state **hash_state)
+{
+    RESULT_ENSURE_REF(hash_state);
+    if (*hash_state) {
+        return S2N_RESULT_OK;
+    }
+
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_hash_state)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+    struct s2n_hash_state *new_state = (struct s2n_hash_state *) (void *) mem.data;
+    RESULT_GUARD_POSIX(s2n_hash_new(new_state));
+
+    *hash_state = new_state;
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
     return S2N_RESULT_OK;
 }
 
-static S2N_RESULT s2n_handshake_hashes_reset_hashes(struct s2n_handshake_hashes *hashes)
+/* Allocates and initializes the hash state for an algorithm, if necessary,
+ * and brings it up to date with the buffered transcript.
+ */
+S2N_RESULT s2n_handshake_hashes_activate(struct s2n_handshake_hashes *hashes, s2n_hash_algorithm hash_alg)
 {
     RESULT_ENSURE_REF(hashes);
-    RESULT_GUARD_POSIX(s2n_hash_reset(&hashes->md5));
-    RESULT_GUARD_POSIX(s2n_hash_reset(&hashes->sha1));
-    RESULT_GUARD_POSIX(s2n_hash_reset(&hashes->sha224));
-    RESULT_GUARD_POSIX(s2n_hash_reset(&hashes->sha256));
-    RESULT_GUARD_POSIX(s2n_hash_reset(&hashes->sha384));
-    RESULT_GUARD_POSIX(s2n_hash_reset(&hashes->sha512));
-    RESULT_GUARD_POSIX(s2n_hash_reset(&hashes->md5_sha1));
-    RESULT_GUARD_POSIX(s2n_hash_reset(&hashes->hash_workspace));
+    RESULT_ENSURE(hash_alg > S2N_HASH_NONE && hash_alg < S2N_HASH_ALGS_COUNT, S2N_ERR_HASH_INVALID_ALGORITHM);
+    if (hashes->active_hash_algs[hash_alg]) {
+        return S2N_RESULT_OK;
+    }
+
+    /* Once the transcript is released, an inactive hash can no longer be
+     * brought up to date. Only hashes required when the transcript was
+     * released are valid.
+     */
+    RESULT_ENSURE(hashes->transcript_buffered, S2N_ERR_HASH_NOT_READY);
+
+    /* A state allocated for an earlier handshake on this connection is reused */
+    struct s2n_hash_state **hash_state = &hashes->transcript_hashes[hash_alg];
+    RESULT_GUARD(s2n_handshake_hashes_alloc_hash(hash_state));
+    RESULT_GUARD_POSIX(s2n_hash_init(*hash_state, hash_alg));
+
+    uint32_t transcript_len = s2n_stuffer_data_available(&hashes->transcript);
+    if (transcript_len > 0) {
+        RESULT_GUARD_POSIX(s2n_hash_update(*hash_state, hashes->transcript.blob.data, transcript_len));
+    }
+
+    hashes->active_hash_algs[hash_alg] = 1;
     return S2N_RESULT_OK;
 }
 
-static S2N_RESULT s2n_handshake_hashes_free_hashes(struct s2n_handshake_hashes *hashes)
+S2N_RESULT s2n_handshake_hashes_buffer(struct s2n_handshake_hashes *hashes, const struct s2n_blob *data)
 {
-    if (!hashes) {
+    RESULT_ENSURE_REF(hashes);
+    RESULT_ENSURE_REF(data);
+    if (!hashes->transcript_buffered) {
         return S2N_RESULT_OK;
     }
-    RESULT_GUARD_POSIX(s2n_hash_free(&hashes->md5));
-    RESULT_GUARD_POSIX(s2n_hash_free(&hashes->sha1));
-    RESULT_GUARD_POSIX(s2n_hash_free(&hashes->sha224));
-    RESULT_GUARD_POSIX(s2n_hash_free(&hashes->sha256));
-    RESULT_GUARD_POSIX(s2n_hash_free(&hashes->sha384));
-    RESULT_GUARD_POSIX(s2n_hash_free(&hashes->sha512));
-    RESULT_GUARD_POSIX(s2n_hash_free(&hashes->md5_sha1));
-    RESULT_GUARD_POSIX(s2n_hash_free(&hashes->hash_workspace));
+    RESULT_GUARD_POSIX(s2n_stuffer_write(&hashes->transcript, data));
     return S2N_RESULT_OK;
 }
 
-static S2N_RESULT s2n_handshake_hashes_init_hashes(struct s2n_handshake_hashes *hashes)
+/* Once the required hashes are known and active, the buffered transcript is no longer needed */
+S2N_RESULT s2n_handshake_hashes_release_transcript(struct s2n_handshake_hashes *hashes)
 {
-    RESULT_GUARD_POSIX(s2n_hash_init(&hashes->md5, S2N_HASH_MD5));
-    RESULT_GUARD_POSIX(s2n_hash_init(&hashes->sha1, S2N_HASH_SHA1));
-    RESULT_GUARD_POSIX(s2n_hash_init(&hashes->sha224, S2N_HASH_SHA224));
-    RESULT_GUARD_POSIX(s2n_hash_init(&hashes->sha256, S2N_HASH_SHA256));
-    RESULT_GUARD_POSIX(s2n_hash_init(&hashes->sha384, S2N_HASH_SHA384));
-    RESULT_GUARD_POSIX(s2n_hash_init(&hashes->sha512, S2N_HASH_SHA512));
-    RESULT_GUARD_POSIX(s2n_hash_init(&hashes->md5_sha1, S2N_HASH_MD5_SHA1));
-    RESULT_GUARD_POSIX(s2n_hash_init(&hashes->hash_workspace, S2N_HASH_NONE));
+    RESULT_ENSURE_REF(hashes);
+    RESULT_GUARD_POSIX(s2n_stuffer_free(&hashes->transcript));
+    hashes->transcript_buffered = false;
+    return S2N_RESULT_OK;
+}
 
+static S2N_RESULT s2n_handshake_hashes_init_transcript(struct s2n_handshake_hashes *hashes)
+{
+    RESULT_ENSURE_REF(hashes);
+    if (hashes->transcript.alloced) {
+        RESULT_GUARD_POSIX(s2n_stuffer_wipe(&hashes->transcript));
+    } else {
+        RESULT_GUARD_POSIX(s2n_stuffer_growable_alloc(&hashes->transcript, 0));
+    }
+    hashes->transcript_buffered = true;
     return S2N_RESULT_OK;
 }
 
@@ -90,22 +149,42 @@ S2N_RESULT s2n_handshake_hashes_new(struct s2n_handshake_hashes **hashes)
     *hashes = (struct s2n_handshake_hashes *) (void *) data.data;
     ZERO_TO_DISABLE_DEFER_CLEANUP(data);
 
-    RESULT_GUARD(s2n_handshake_hashes_new_hashes(*hashes));
-    RESULT_GUARD(s2n_handshake_hashes_init_hashes(*hashes));
+    /* The workspace is always needed, but the transcript hashes are allocated on demand */
+    RESULT_GUARD_POSIX(s2n_hash_new(&(*hashes)->hash_workspace));
+    RESULT_GUARD_POSIX(s2n_hash_init(&(*hashes)->hash_workspace, S2N_HASH_NONE));
+    RESULT_GUARD(s2n_handshake_hashes_init_transcript(*hashes));
 
     return S2N_RESULT_OK;
 }
 
 S2N_RESULT s2n_handshake_hashes_wipe(struct s2n_handshake_hashes *hashes)
 {
-    RESULT_GUARD(s2n_handshake_hashes_reset_hashes(hashes));
+    RESULT_ENSURE_REF(hashes);
+    for (size_t i = 0; i < s2n_array_len(s2n_handshake_hash_algs); i++) {
+        s2n_hash_algorithm hash_alg = s2n_handshake_hash_algs[i];
+        if (!hashes->active_hash_algs[hash_alg]) {
+            continue;
+        }
+        struct s2n_hash_state *hash_state = NULL;
+        RESULT_GUARD(s2n_handshake_hashes_get_state(hashes, hash_alg, &hash_state));
+        RESULT_GUARD_POSIX(s2n_hash_reset(hash_state));
+        hashes->active_hash_algs[hash_alg] = 0;
+    }
+    RESULT_GUARD_POSIX(s2n_hash_reset(&hashes->hash_workspace));
+    RESULT_GUARD(s2n_handshake_hashes_init_transcript(hashes));
     return S2N_RESULT_OK;
 }
 
 S2N_CLEANUP_RESULT s2n_handshake_hashes_free(struct s2n_handshake_hashes **hashes)
 {
     RESULT_ENSURE_REF(hashes);
-    RESULT_GUARD(s2n_handshake_hashes_free_hashes(*hashes));
+    if (*hashes) {
+        for (size_t i = 0; i < s2n_array_len(s2n_handshake_hash_algs); i++) {
+            RESULT_GUARD(s2n_handshake_hashes_free_hash(&(*hashes)->transcript_hashes[s2n_handshake_hash_algs[i]]));
+        }
+        RESULT_GUARD_POSIX(s2n_hash_free(&(*hashes)->hash_workspace));
+        RESULT_GUARD_POSIX(s2n_stuffer_free(&(*hashes)->transcript));
+    }
     RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) hashes, sizeof(struct s2n_handshake_hashes)));
     return S2N_RESULT_OK;
 }
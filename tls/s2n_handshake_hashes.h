@@ -18,15 +18,14 @@
 #include "api/s2n.h"
 #include "crypto/s2n_hash.h"
 #include "crypto/s2n_tls13_keys.h"
+#include "stuffer/s2n_stuffer.h"
 
 struct s2n_handshake_hashes {
-    struct s2n_hash_state md5;
-    struct s2n_hash_state sha1;
-    struct s2n_hash_state sha224;
-    struct s2n_hash_state sha256;
-    struct s2n_hash_state sha384;
-    struct s2n_hash_state sha512;
-    struct s2n_hash_state md5_sha1;
+    /* Transcript hash states, indexed by hash algorithm.
+     * A state is only allocated once its algorithm is first activated,
+     * so most connections only ever allocate the state for their PRF hash.
+     */
+    struct s2n_hash_state *transcript_hashes[S2N_HASH_ALGS_COUNT];
 
     /* TLS1.3 requires transcript hash digests to calculate secrets.
      */
@@ -36,8 +35,24 @@ struct s2n_handshake_hashes {
      * Do NOT rely on this hash state maintaining its value outside of the current context.
      */
     struct s2n_hash_state hash_workspace;
+
+    /* Hash states are only activated when they are first needed,
+     * which is usually once the cipher suite determines the PRF hash.
+     * Until every hash the handshake can need is known, handshake messages are
+     * buffered in `transcript` so that a newly activated hash state can catch up
+     * on the messages it missed.
+     */
+    uint8_t active_hash_algs[S2N_HASH_ALGS_COUNT];
+    struct s2n_stuffer transcript;
+    bool transcript_buffered;
 };
 
 S2N_RESULT s2n_handshake_hashes_new(struct s2n_handshake_hashes **hashes);
 S2N_RESULT s2n_handshake_hashes_wipe(struct s2n_handshake_hashes *hashes);
 S2N_CLEANUP_RESULT s2n_handshake_hashes_free(struct s2n_handshake_hashes **hashes);
+
+S2N_RESULT s2n_handshake_hashes_get_state(struct s2n_handshake_hashes *hashes, s2n_hash_algorithm hash_alg,
+        struct s2n_hash_state **hash_state);
+S2N_RESULT s2n_handshake_hashes_activate(struct s2n_handshake_hashes *hashes, s2n_hash_algorithm hash_alg);
+S2N_RESULT s2n_handshake_hashes_buffer(struct s2n_handshake_hashes *hashes, const struct s2n_blob *data);
+S2N_RESULT s2n_handshake_hashes_release_transcript(struct s2n_handshake_hashes *hashes);
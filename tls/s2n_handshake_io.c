@@ -22,6 +22,7 @@
 #include "stuffer/s2n_stuffer.h"
 #include "tls/s2n_alerts.h"
 #include "tls/s2n_async_pkey.h"
+#include "tls/s2n_cert_compression.h"
 #include "tls/s2n_cipher_suites.h"
 #include "tls/s2n_connection.h"
 #include "tls/s2n_kex.h"
@@ -36,6 +37,7 @@
 #include "utils/s2n_random.h"
 #include "utils/s2n_safety.h"
 #include "utils/s2n_socket.h"
+#include "utils/s2n_usdt.h"
 
 /* clang-format off */
 struct s2n_handshake_action {
@@ -852,6 +854,8 @@ static int s2n_advance_message(struct s2n_connection *conn)
     char previous_writer = ACTIVE_STATE(conn).writer;
     char this_mode = CONNECTION_WRITER(conn);
 
+    POSIX_GUARD_RESULT(s2n_handshake_timings_message_done(conn));
+
     /* Actually advance the message number */
     conn->handshake.message_number++;
 
@@ -1240,7 +1244,12 @@ static int s2n_handshake_write_io(struct s2n_connection *conn)
      */
     if (s2n_stuffer_is_wiped(&conn->handshake.io)) {
         if (record_type == TLS_HANDSHAKE) {
-            POSIX_GUARD(s2n_handshake_write_header(&conn->handshake.io, ACTIVE_STATE(conn).message_type));
+            uint8_t message_type = ACTIVE_STATE(conn).message_type;
+            /* A negotiated CompressedCertificate message replaces the server's Certificate message */
+            if (ACTIVE_MESSAGE(conn) == SERVER_CERT && s2n_cert_compression_is_negotiated(conn)) {
+                message_type = TLS_COMPRESSED_CERTIFICATE;
+            }
+            POSIX_GUARD(s2n_handshake_write_header(&conn->handshake.io, message_type));
         }
         POSIX_GUARD(ACTIVE_STATE(conn).handler[conn->mode](conn));
         if (record_type == TLS_HANDSHAKE) {
@@ -1252,6 +1261,8 @@ static int s2n_handshake_write_io(struct s2n_connection *conn)
     if (record_type == TLS_HANDSHAKE) {
         POSIX_GUARD_RESULT(s2n_handshake_transcript_update(conn));
     }
+    S2N_USDT_PROBE4(handshake_write, conn, record_type, ACTIVE_STATE(conn).message_type,
+            conn->handshake.io.write_cursor);
 
     /* We're done sending the last record, reset everything */
     POSIX_GUARD(s2n_stuffer_wipe(&conn->out));
@@ -1493,6 +1504,7 @@ static int s2n_handshake_read_io(struct s2n_connection *conn)
             POSIX_GUARD_RESULT(s2n_record_wipe(conn));
             return S2N_SUCCESS;
         }
+        S2N_USDT_PROBE3(handshake_read, conn, message_type, s2n_stuffer_data_available(&conn->handshake.io));
 
         if (conn->mode == S2N_CLIENT) {
             s2n_cert_auth_type client_cert_auth_type = { 0 };
@@ -1533,6 +1545,18 @@ static int s2n_handshake_read_io(struct s2n_connection *conn)
                     S2N_ERR_MISSING_CERT_REQUEST);
         }
 
+        /**
+         *= https://www.rfc-editor.org/rfc/rfc8879#section-4
+         *# The CompressedCertificate message is formed as follows:
+         *
+         * It takes the place of the Certificate message, so is handled by the Certificate handler.
+         */
+        if (message_type == TLS_COMPRESSED_CERTIFICATE && ACTIVE_MESSAGE(conn) == SERVER_CERT) {
+            POSIX_GUARD_RESULT(s2n_cert_compression_validate_recv(conn));
+            conn->handshake.compressed_certificate = 1;
+            message_type = TLS_CERTIFICATE;
+        }
+
         POSIX_ENSURE(record_type == EXPECTED_RECORD_TYPE(conn), S2N_ERR_BAD_MESSAGE);
         POSIX_ENSURE(message_type == EXPECTED_MESSAGE_TYPE(conn), S2N_ERR_BAD_MESSAGE);
         POSIX_ENSURE(!CONNECTION_IS_WRITER(conn), S2N_ERR_BAD_MESSAGE);
@@ -1605,6 +1629,8 @@ int s2n_negotiate_impl(struct s2n_connection *conn, s2n_blocked_status *blocked)
     POSIX_ENSURE_REF(conn);
     POSIX_ENSURE_REF(blocked);
 
+    POSIX_GUARD_RESULT(s2n_handshake_timings_start(conn));
+
     while (!s2n_handshake_is_complete(conn) && ACTIVE_MESSAGE(conn) != conn->handshake.end_of_messages) {
         errno = 0;
         s2n_errno = S2N_ERR_OK;
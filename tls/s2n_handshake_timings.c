@@ -0,0 +1,180 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_handshake_timings.h"
+
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+static bool s2n_handshake_timings_enabled(struct s2n_connection *conn)
+{
+    return conn->config && conn->config->handshake_timings_enabled;
+}
+
+static S2N_RESULT s2n_handshake_timings_now(struct s2n_connection *conn, uint64_t *now)
+{
+    RESULT_ENSURE(conn->config->monotonic_clock(conn->config->monotonic_clock_ctx, now) >= S2N_SUCCESS,
+            S2N_ERR_CANCELLED);
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_handshake_timings_get(struct s2n_connection *conn, struct s2n_handshake_timings **timings)
+{
+    if (conn->handshake_timings == NULL) {
+        DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+        RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_handshake_timings)));
+        RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+        conn->handshake_timings = (void *) mem.data;
+        ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+    }
+    *timings = conn->handshake_timings;
+    return S2N_RESULT_OK;
+}
+
+/* Sets entry to NULL once the handshake has recorded the maximum number of timings */
+static S2N_RESULT s2n_handshake_timings_add(struct s2n_connection *conn, s2n_handshake_timing_type type,
+        struct s2n_handshake_timing **entry)
+{
+    struct s2n_handshake_timings *timings = NULL;
+    RESULT_GUARD(s2n_handshake_timings_get(conn, &timings));
+
+    *entry = NULL;
+    if (timings->count >= S2N_HANDSHAKE_TIMINGS_MAX) {
+        return S2N_RESULT_OK;
+    }
+    *entry = &timings->entries[timings->count];
+    timings->count++;
+
+    (*entry)->type = type;
+    (*entry)->message = s2n_connection_get_last_message_name(conn);
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_handshake_timings_start(struct s2n_connection *conn)
+{
+    RESULT_ENSURE_REF(conn);
+    if (!s2n_handshake_timings_enabled(conn)) {
+        return S2N_RESULT_OK;
+    }
+
+    struct s2n_handshake_timings *timings = NULL;
+    RESULT_GUARD(s2n_handshake_timings_get(conn, &timings));
+    if (timings->message_start_ns == 0) {
+        RESULT_GUARD(s2n_handshake_timings_now(conn, &timings->message_start_ns));
+    }
+    return S2N_RESULT_OK;
+}
+
+/* Must be called before the connection moves on to the next message */
+S2N_RESULT s2n_handshake_timings_message_done(struct s2n_connection *conn)
+{
+    RESULT_ENSURE_REF(conn);
+    if (!s2n_handshake_timings_enabled(conn)) {
+        return S2N_RESULT_OK;
+    }
+
+    uint64_t now = 0;
+    RESULT_GUARD(s2n_handshake_timings_now(conn, &now));
+
+    struct s2n_handshake_timing *entry = NULL;
+    RESULT_GUARD(s2n_handshake_timings_add(conn, S2N_HANDSHAKE_TIMING_MESSAGE, &entry));
+    if (entry) {
+        entry->start_ns = conn->handshake_timings->message_start_ns;
+        entry->end_ns = now;
+    }
+    conn->handshake_timings->message_start_ns = now;
+    return S2N_RESULT_OK;
+}
+
+/* Operations that block the handshake may begin again when the handshake is retried,
+ * so only the first attempt starts a new timing.
+ */
+S2N_RESULT s2n_handshake_timings_begin(struct s2n_connection *conn, s2n_handshake_timing_type type)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_LT(type, S2N_HANDSHAKE_TIMING_TYPES);
+    if (!s2n_handshake_timings_enabled(conn)) {
+        return S2N_RESULT_OK;
+    }
+    if (conn->handshake_timings && conn->handshake_timings->open[type]) {
+        return S2N_RESULT_OK;
+    }
+
+    uint64_t now = 0;
+    RESULT_GUARD(s2n_handshake_timings_now(conn, &now));
+
+    struct s2n_handshake_timing *entry = NULL;
+    RESULT_GUARD(s2n_handshake_timings_add(conn, type, &entry));
+    if (entry) {
+        entry->start_ns = now;
+        conn->handshake_timings->open[type] = conn->handshake_timings->count;
+    }
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_handshake_timings_end(struct s2n_connection *conn, s2n_handshake_timing_type type)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_LT(type, S2N_HANDSHAKE_TIMING_TYPES);
+
+    /* The config may have changed since the timing began, so don't check whether timings are enabled */
+    struct s2n_handshake_timings *timings = conn->handshake_timings;
+    if (timings == NULL || timings->open[type] == 0) {
+        return S2N_RESULT_OK;
+    }
+    uint8_t index = timings->open[type] - 1;
+    timings->open[type] = 0;
+
+    RESULT_ENSURE_REF(conn->config);
+    RESULT_ENSURE_LT(index, timings->count);
+    RESULT_GUARD(s2n_handshake_timings_now(conn, &timings->entries[index].end_ns));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_handshake_timings_free(struct s2n_handshake_timings **timings)
+{
+    RESULT_ENSURE_REF(timings);
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) timings, sizeof(struct s2n_handshake_timings)));
+    return S2N_RESULT_OK;
+}
+
+int s2n_config_set_handshake_timings(struct s2n_config *config, bool enabled)
+{
+    POSIX_ENSURE_REF(config);
+    config->handshake_timings_enabled = enabled;
+    return S2N_SUCCESS;
+}
+
+int s2n_connection_get_handshake_timings(struct s2n_connection *conn, struct s2n_handshake_timing *timings,
+        size_t *timings_len)
+{
+    POSIX_ENSURE_REF(conn);
+    POSIX_ENSURE_REF(timings_len);
+
+    const uint8_t count = conn->handshake_timings ? conn->handshake_timings->count : 0;
+    if (timings == NULL) {
+        *timings_len = count;
+        return S2N_SUCCESS;
+    }
+
+    POSIX_ENSURE(*timings_len >= count, S2N_ERR_INSUFFICIENT_MEM_SIZE);
+    if (count > 0) {
+        POSIX_CHECKED_MEMCPY(timings, conn->handshake_timings->entries, count * sizeof(struct s2n_handshake_timing));
+    }
+    *timings_len = count;
+    return S2N_SUCCESS;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include "api/unstable/handshake_timings.h"
+#include "utils/s2n_result.h"
+
+#define S2N_HANDSHAKE_TIMINGS_MAX  32
+#define S2N_HANDSHAKE_TIMING_TYPES (S2N_HANDSHAKE_TIMING_ASYNC_OFFLOAD + 1)
+
+/* Allocated for a connection on its first handshake with timings enabled */
+struct s2n_handshake_timings {
+    struct s2n_handshake_timing entries[S2N_HANDSHAKE_TIMINGS_MAX];
+    uint8_t count;
+    /* For each type, the index plus one of the entry still waiting for its end time */
+    uint8_t open[S2N_HANDSHAKE_TIMING_TYPES];
+    /* When the current message started: the end of the previous message */
+    uint64_t message_start_ns;
+};
+
+S2N_RESULT s2n_handshake_timings_start(struct s2n_connection *conn);
+S2N_RESULT s2n_handshake_timings_message_done(struct s2n_connection *conn);
+S2N_RESULT s2n_handshake_timings_begin(struct s2n_connection *conn, s2n_handshake_timing_type type);
+S2N_RESULT s2n_handshake_timings_end(struct s2n_connection *conn, s2n_handshake_timing_type type);
+S2N_RESULT s2n_handshake_timings_free(struct s2n_handshake_timings **timings);
@@ -53,37 +53,31 @@ int s2n_conn_update_handshake_hashes(struct s2n_connection *conn, struct s2n_blo
      * and section 3.3.2)
      */
 
-    if (s2n_handshake_is_hash_required(&conn->handshake, S2N_HASH_MD5)) {
-        POSIX_GUARD(s2n_hash_update(&hashes->md5, data->data, data->size));
-    }
-
-    if (s2n_handshake_is_hash_required(&conn->handshake, S2N_HASH_SHA1)) {
-        POSIX_GUARD(s2n_hash_update(&hashes->sha1, data->data, data->size));
-    }
+    /* Stop buffering as soon as no hash can still need to catch up on the transcript */
+    POSIX_GUARD_RESULT(s2n_handshake_release_unneeded_transcript(conn));
 
     const uint8_t md5_sha1_required =
             (s2n_handshake_is_hash_required(&conn->handshake, S2N_HASH_MD5)
                     && s2n_handshake_is_hash_required(&conn->handshake, S2N_HASH_SHA1));
 
-    if (md5_sha1_required) {
-        POSIX_GUARD(s2n_hash_update(&hashes->md5_sha1, data->data, data->size));
-    }
-
-    if (s2n_handshake_is_hash_required(&conn->handshake, S2N_HASH_SHA224)) {
-        POSIX_GUARD(s2n_hash_update(&hashes->sha224, data->data, data->size));
-    }
-
-    if (s2n_handshake_is_hash_required(&conn->handshake, S2N_HASH_SHA256)) {
-        POSIX_GUARD(s2n_hash_update(&hashes->sha256, data->data, data->size));
-    }
-
-    if (s2n_handshake_is_hash_required(&conn->handshake, S2N_HASH_SHA384)) {
-        POSIX_GUARD(s2n_hash_update(&hashes->sha384, data->data, data->size));
+    /* Only hashes that have already been set up need to be updated here.
+     * Any other hash will catch up from the buffered transcript if it is needed later.
+     */
+    for (s2n_hash_algorithm hash_alg = S2N_HASH_MD5; hash_alg <= S2N_HASH_MD5_SHA1; hash_alg++) {
+        if (!hashes->active_hash_algs[hash_alg]) {
+            continue;
+        }
+        bool required = (hash_alg == S2N_HASH_MD5_SHA1) ? md5_sha1_required
+                                                        : s2n_handshake_is_hash_required(&conn->handshake, hash_alg);
+        if (!required) {
+            continue;
+        }
+        struct s2n_hash_state *hash_state = NULL;
+        POSIX_GUARD_RESULT(s2n_handshake_hashes_get_state(hashes, hash_alg, &hash_state));
+        POSIX_GUARD(s2n_hash_update(hash_state, data->data, data->size));
     }
 
-    if (s2n_handshake_is_hash_required(&conn->handshake, S2N_HASH_SHA512)) {
-        POSIX_GUARD(s2n_hash_update(&hashes->sha512, data->data, data->size));
-    }
+    POSIX_GUARD_RESULT(s2n_handshake_hashes_buffer(hashes, data));
 
     return S2N_SUCCESS;
 }
@@ -113,8 +107,12 @@ int s2n_server_hello_retry_recreate_transcript(struct s2n_connection *conn)
     POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, keys.hash_algorithm, client_hello1_hash));
     POSIX_GUARD(s2n_hash_digest(client_hello1_hash, client_hello1_digest_out, hash_digest_length));
 
-    /* Step 1: Reset the hash state */
+    /* Step 1: Reset the hash state.
+     * The recreated transcript is only valid for the negotiated hash algorithm,
+     * so the buffered transcript can't be used to set up any other hash.
+     */
     POSIX_GUARD_RESULT(s2n_handshake_reset_hash_state(conn, keys.hash_algorithm));
+    POSIX_GUARD_RESULT(s2n_handshake_hashes_release_transcript(hashes));
 
     /* Step 2: Update the transcript with the synthetic message */
     struct s2n_blob msg_blob = { 0 };
@@ -64,6 +64,7 @@ int s2n_key_update_recv(struct s2n_connection *conn, struct s2n_stuffer *request
         POSIX_GUARD_RESULT(s2n_ktls_key_update_process(conn));
     }
 
+    conn->stats.key_updates_received++;
     return S2N_SUCCESS;
 }
 
@@ -101,6 +102,7 @@ int s2n_key_update_send(struct s2n_connection *conn, s2n_blocked_status *blocked
 
         /* Update encryption key */
         POSIX_GUARD(s2n_update_application_traffic_keys(conn, conn->mode, SENDING));
+        conn->stats.key_updates_sent++;
 
         s2n_atomic_flag_clear(&conn->key_update_pending);
         POSIX_GUARD(s2n_flush(conn, blocked));
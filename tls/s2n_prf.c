@@ -196,9 +196,70 @@ static int s2n_hmac_p_hash_new(struct s2n_prf_working_space *ws)
     return s2n_hmac_init(&ws->p_hash.s2n_hmac, S2N_HMAC_NONE, NULL, 0);
 }
 
+S2N_RESULT s2n_prf_get_keyed_hmac(struct s2n_prf_working_space *ws, s2n_hmac_algorithm alg, const struct s2n_blob *secret,
+        struct s2n_hmac_state **hmac)
+{
+    RESULT_ENSURE_REF(ws);
+    RESULT_ENSURE_REF(secret);
+    RESULT_ENSURE_REF(hmac);
+    *hmac = &ws->p_hash.s2n_hmac;
+
+    /* If the hmac is already keyed with this secret, resetting it restores the
+     * precomputed inner and outer pad states without another key schedule.
+     */
+    if (ws->keyed_secret_size != 0 && ws->keyed_alg == alg && ws->keyed_secret_size == secret->size
+            && s2n_constant_time_equals(ws->keyed_secret, secret->data, secret->size)) {
+        RESULT_GUARD_POSIX(s2n_hmac_reset(&ws->p_hash.s2n_hmac));
+        return S2N_RESULT_OK;
+    }
+
+    ws->keyed_secret_size = 0;
+    RESULT_GUARD_POSIX(s2n_hmac_init(&ws->p_hash.s2n_hmac, alg, secret->data, secret->size));
+
+    /* Only remember secrets up to the size of a master secret: larger premaster secrets are only used once */
+    if (secret->size <= sizeof(ws->keyed_secret)) {
+        RESULT_CHECKED_MEMCPY(ws->keyed_secret, secret->data, secret->size);
+        ws->keyed_secret_size = secret->size;
+        ws->keyed_alg = alg;
+    }
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_prf_get_unkeyed_hmac(struct s2n_prf_working_space *ws, struct s2n_hmac_state **hmac)
+{
+    RESULT_ENSURE_REF(ws);
+    RESULT_ENSURE_REF(hmac);
+
+    /* The caller will key the hmac itself, so it no longer matches the remembered secret */
+    ws->keyed_secret_size = 0;
+    *hmac = &ws->p_hash.s2n_hmac;
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_prf_forget_keyed_hmac(struct s2n_prf_working_space *ws)
+{
+    RESULT_ENSURE_REF(ws);
+
+    /* Re-keying with an empty key replaces the pad states derived from the last secret */
+    struct s2n_hmac_state *hmac = &ws->p_hash.s2n_hmac;
+    if (hmac->alg != S2N_HMAC_NONE) {
+        uint8_t empty_key = 0;
+        RESULT_GUARD_POSIX(s2n_hmac_init(hmac, hmac->alg, &empty_key, 0));
+    }
+
+    ws->keyed_secret_size = 0;
+    ws->keyed_alg = S2N_HMAC_NONE;
+    RESULT_CHECKED_MEMSET(&ws->keyed_secret, 0, sizeof(ws->keyed_secret));
+    RESULT_CHECKED_MEMSET(&ws->digest0, 0, sizeof(ws->digest0));
+    RESULT_CHECKED_MEMSET(&ws->digest1, 0, sizeof(ws->digest1));
+    return S2N_RESULT_OK;
+}
+
 static int s2n_hmac_p_hash_init(struct s2n_prf_working_space *ws, s2n_hmac_algorithm alg, struct s2n_blob *secret)
 {
-    return s2n_hmac_init(&ws->p_hash.s2n_hmac, alg, secret->data, secret->size);
+    struct s2n_hmac_state *hmac = NULL;
+    POSIX_GUARD_RESULT(s2n_prf_get_keyed_hmac(ws, alg, secret, &hmac));
+    return S2N_SUCCESS;
 }
 
 static int s2n_hmac_p_hash_update(struct s2n_prf_working_space *ws, const void *data, uint32_t size)
@@ -346,6 +407,11 @@ S2N_RESULT s2n_prf_wipe(struct s2n_connection *conn)
     RESULT_ENSURE_REF(hmac_impl);
     RESULT_GUARD_POSIX(hmac_impl->reset(conn->prf_space));
 
+    /* Never let a wiped connection reuse the previous connection's keyed state */
+    conn->prf_space->keyed_secret_size = 0;
+    conn->prf_space->keyed_alg = S2N_HMAC_NONE;
+    RESULT_CHECKED_MEMSET(&conn->prf_space->keyed_secret, 0, sizeof(conn->prf_space->keyed_secret));
+
     return S2N_RESULT_OK;
 }
 
@@ -563,7 +629,7 @@ static int s2n_prf_sslv3_finished(struct s2n_connection *conn, uint8_t prefix[4]
     POSIX_GUARD_RESULT(s2n_handshake_set_finished_len(conn, MD5_DIGEST_LENGTH + SHA_DIGEST_LENGTH));
 
     struct s2n_hash_state *md5 = hash_workspace;
-    POSIX_GUARD(s2n_hash_copy(md5, &conn->handshake.hashes->md5));
+    POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, S2N_HASH_MD5, md5));
     POSIX_GUARD(s2n_hash_update(md5, prefix, 4));
     POSIX_GUARD(s2n_hash_update(md5, conn->secrets.version.tls12.master_secret, sizeof(conn->secrets.version.tls12.master_secret)));
     POSIX_GUARD(s2n_hash_update(md5, xorpad1, 48));
@@ -576,7 +642,7 @@ static int s2n_prf_sslv3_finished(struct s2n_connection *conn, uint8_t prefix[4]
     POSIX_GUARD(s2n_hash_reset(md5));
 
     struct s2n_hash_state *sha1 = hash_workspace;
-    POSIX_GUARD(s2n_hash_copy(sha1, &conn->handshake.hashes->sha1));
+    POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, S2N_HASH_SHA1, sha1));
     POSIX_GUARD(s2n_hash_update(sha1, prefix, 4));
     POSIX_GUARD(s2n_hash_update(sha1, conn->secrets.version.tls12.master_secret, sizeof(conn->secrets.version.tls12.master_secret)));
     POSIX_GUARD(s2n_hash_update(sha1, xorpad1, 40));
@@ -639,12 +705,12 @@ int s2n_prf_client_finished(struct s2n_connection *conn)
     if (conn->actual_protocol_version == S2N_TLS12) {
         switch (conn->secure->cipher_suite->prf_alg) {
             case S2N_HMAC_SHA256:
-                POSIX_GUARD(s2n_hash_copy(&conn->handshake.hashes->hash_workspace, &conn->handshake.hashes->sha256));
+                POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, S2N_HASH_SHA256, &conn->handshake.hashes->hash_workspace));
                 POSIX_GUARD(s2n_hash_digest(&conn->handshake.hashes->hash_workspace, sha_digest, SHA256_DIGEST_LENGTH));
                 sha.size = SHA256_DIGEST_LENGTH;
                 break;
             case S2N_HMAC_SHA384:
-                POSIX_GUARD(s2n_hash_copy(&conn->handshake.hashes->hash_workspace, &conn->handshake.hashes->sha384));
+                POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, S2N_HASH_SHA384, &conn->handshake.hashes->hash_workspace));
                 POSIX_GUARD(s2n_hash_digest(&conn->handshake.hashes->hash_workspace, sha_digest, SHA384_DIGEST_LENGTH));
                 sha.size = SHA384_DIGEST_LENGTH;
                 break;
@@ -656,12 +722,12 @@ int s2n_prf_client_finished(struct s2n_connection *conn)
         return s2n_prf(conn, &master_secret, &label, &sha, NULL, NULL, &client_finished);
     }
 
-    POSIX_GUARD(s2n_hash_copy(&conn->handshake.hashes->hash_workspace, &conn->handshake.hashes->md5));
+    POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, S2N_HASH_MD5, &conn->handshake.hashes->hash_workspace));
     POSIX_GUARD(s2n_hash_digest(&conn->handshake.hashes->hash_workspace, md5_digest, MD5_DIGEST_LENGTH));
     md5.data = md5_digest;
     md5.size = MD5_DIGEST_LENGTH;
 
-    POSIX_GUARD(s2n_hash_copy(&conn->handshake.hashes->hash_workspace, &conn->handshake.hashes->sha1));
+    POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, S2N_HASH_SHA1, &conn->handshake.hashes->hash_workspace));
     POSIX_GUARD(s2n_hash_digest(&conn->handshake.hashes->hash_workspace, sha_digest, SHA_DIGEST_LENGTH));
     sha.data = sha_digest;
     sha.size = SHA_DIGEST_LENGTH;
@@ -697,12 +763,12 @@ int s2n_prf_server_finished(struct s2n_connection *conn)
     if (conn->actual_protocol_version == S2N_TLS12) {
         switch (conn->secure->cipher_suite->prf_alg) {
             case S2N_HMAC_SHA256:
-                POSIX_GUARD(s2n_hash_copy(&conn->handshake.hashes->hash_workspace, &conn->handshake.hashes->sha256));
+                POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, S2N_HASH_SHA256, &conn->handshake.hashes->hash_workspace));
                 POSIX_GUARD(s2n_hash_digest(&conn->handshake.hashes->hash_workspace, sha_digest, SHA256_DIGEST_LENGTH));
                 sha.size = SHA256_DIGEST_LENGTH;
                 break;
             case S2N_HMAC_SHA384:
-                POSIX_GUARD(s2n_hash_copy(&conn->handshake.hashes->hash_workspace, &conn->handshake.hashes->sha384));
+                POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, S2N_HASH_SHA384, &conn->handshake.hashes->hash_workspace));
                 POSIX_GUARD(s2n_hash_digest(&conn->handshake.hashes->hash_workspace, sha_digest, SHA384_DIGEST_LENGTH));
                 sha.size = SHA384_DIGEST_LENGTH;
                 break;
@@ -714,12 +780,12 @@ int s2n_prf_server_finished(struct s2n_connection *conn)
         return s2n_prf(conn, &master_secret, &label, &sha, NULL, NULL, &server_finished);
     }
 
-    POSIX_GUARD(s2n_hash_copy(&conn->handshake.hashes->hash_workspace, &conn->handshake.hashes->md5));
+    POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, S2N_HASH_MD5, &conn->handshake.hashes->hash_workspace));
     POSIX_GUARD(s2n_hash_digest(&conn->handshake.hashes->hash_workspace, md5_digest, MD5_DIGEST_LENGTH));
     md5.data = md5_digest;
     md5.size = MD5_DIGEST_LENGTH;
 
-    POSIX_GUARD(s2n_hash_copy(&conn->handshake.hashes->hash_workspace, &conn->handshake.hashes->sha1));
+    POSIX_GUARD_RESULT(s2n_handshake_copy_hash_state(conn, S2N_HASH_SHA1, &conn->handshake.hashes->hash_workspace));
     POSIX_GUARD(s2n_hash_digest(&conn->handshake.hashes->hash_workspace, sha_digest, SHA_DIGEST_LENGTH));
     sha.data = sha_digest;
     sha.size = SHA_DIGEST_LENGTH;
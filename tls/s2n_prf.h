@@ -30,6 +30,14 @@ union p_hash_state {
 
 struct s2n_prf_working_space {
     union p_hash_state p_hash;
+    /* The secret that p_hash is currently keyed with. The TLS1.2 master secret keys
+     * the key expansion and both finished calculations, and each TLS1.3 extract secret
+     * keys both traffic secrets, so remembering it lets later derivations reuse the
+     * precomputed inner and outer pad states instead of re-keying.
+     */
+    s2n_hmac_algorithm keyed_alg;
+    uint8_t keyed_secret[S2N_TLS_SECRET_LEN];
+    uint8_t keyed_secret_size;
     uint8_t digest0[S2N_MAX_DIGEST_LEN];
     uint8_t digest1[S2N_MAX_DIGEST_LEN];
 };
@@ -60,6 +68,16 @@ S2N_RESULT s2n_prf_new(struct s2n_connection *conn);
 S2N_RESULT s2n_prf_wipe(struct s2n_connection *conn);
 S2N_RESULT s2n_prf_free(struct s2n_connection *conn);
 
+/* Returns the working space hmac keyed with the secret. The TLS1.3 key schedule shares this hmac
+ * with the TLS1.2 PRF, so a secret used for several derivations in a row is only keyed once.
+ */
+S2N_RESULT s2n_prf_get_keyed_hmac(struct s2n_prf_working_space *ws, s2n_hmac_algorithm alg, const struct s2n_blob *secret,
+        struct s2n_hmac_state **hmac);
+/* Returns the working space hmac for a caller that will key it directly */
+S2N_RESULT s2n_prf_get_unkeyed_hmac(struct s2n_prf_working_space *ws, struct s2n_hmac_state **hmac);
+/* Wipes the remembered secret and the hmac state keyed with it */
+S2N_RESULT s2n_prf_forget_keyed_hmac(struct s2n_prf_working_space *ws);
+
 int s2n_prf_calculate_master_secret(struct s2n_connection *conn, struct s2n_blob *premaster_secret);
 int s2n_prf_hybrid_master_secret(struct s2n_connection *conn, struct s2n_blob *premaster_secret);
 S2N_RESULT s2n_prf_generate_key_material(struct s2n_connection *conn, struct s2n_key_material *key_material);
@@ -18,6 +18,7 @@
 #include "crypto/s2n_tls13_keys.h"
 #include "tls/extensions/s2n_extension_type.h"
 #include "tls/s2n_handshake.h"
+#include "tls/s2n_psk_store.h"
 #include "tls/s2n_tls.h"
 #include "tls/s2n_tls13_handshake.h"
 #include "tls/s2n_tls13_secrets.h"
@@ -339,10 +340,16 @@ int s2n_offered_psk_list_choose_psk(struct s2n_offered_psk_list *psk_list, struc
 
     struct s2n_psk *chosen_psk = NULL;
     POSIX_GUARD_RESULT(s2n_match_psk_identity(&psk_params->psk_list, &psk->identity, &chosen_psk));
+    struct s2n_psk_store *store = psk_list->conn->config->psk_store;
+    if (chosen_psk == NULL && psk_params->type == S2N_PSK_TYPE_EXTERNAL && store) {
+        POSIX_GUARD_RESULT(s2n_psk_store_append_match(store, psk_list->conn, &psk->identity, &chosen_psk));
+    }
     POSIX_ENSURE_REF(chosen_psk);
     POSIX_GUARD_RESULT(s2n_validate_ticket_lifetime(psk_list->conn, psk->obfuscated_ticket_age, chosen_psk->ticket_age_add));
     psk_params->chosen_psk = chosen_psk;
     psk_params->chosen_psk_wire_index = psk->wire_index;
+    /* The uint32_t subtraction may wrap, resulting in the modulo 2^32 operation */
+    psk_params->chosen_psk_ticket_age_in_millis = psk->obfuscated_ticket_age - chosen_psk->ticket_age_add;
 
     return S2N_SUCCESS;
 }
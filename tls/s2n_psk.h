@@ -61,6 +61,9 @@ struct s2n_psk_parameters {
     uint16_t chosen_psk_wire_index;
     struct s2n_psk *chosen_psk;
     s2n_psk_key_exchange_mode psk_ke_mode;
+    /* Used by the early data anti-replay filter */
+    uint32_t chosen_psk_ticket_age_in_millis;
+    uint64_t chosen_psk_binder_hash;
 };
 S2N_RESULT s2n_psk_parameters_init(struct s2n_psk_parameters *params);
 S2N_RESULT s2n_psk_parameters_offered_psks_size(struct s2n_psk_parameters *params, uint32_t *size);
@@ -0,0 +1,364 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_psk_store.h"
+
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "utils/s2n_atomic.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_PSK_STORE_INITIAL_BUCKETS 16
+
+static S2N_RESULT s2n_psk_store_hash(struct s2n_psk_store *store, const uint8_t *identity, uint16_t identity_size,
+        uint64_t *hash)
+{
+    RESULT_ENSURE_REF(store);
+    RESULT_ENSURE_REF(hash);
+    *hash = s2n_siphash(&store->hash_key, identity, identity_size);
+    return S2N_RESULT_OK;
+}
+
+static bool s2n_psk_store_entry_matches(struct s2n_psk_store_entry *entry, uint64_t hash,
+        const uint8_t *identity, uint16_t identity_size)
+{
+    return entry->hash == hash
+            && entry->psk->identity.size == identity_size
+            && s2n_constant_time_equals(entry->psk->identity.data, identity, identity_size);
+}
+
+static S2N_RESULT s2n_psk_store_entry_new(struct s2n_psk *psk, uint64_t hash, struct s2n_psk_store_entry *next,
+        struct s2n_psk_store_entry **entry)
+{
+    RESULT_ENSURE_REF(entry);
+
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_psk_store_entry)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+
+    *entry = (struct s2n_psk_store_entry *) (void *) mem.data;
+    (*entry)->psk = psk;
+    (*entry)->hash = hash;
+    (*entry)->next = next;
+
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_psk_store_entry_free(struct s2n_psk_store_entry **entry, bool free_psk)
+{
+    RESULT_ENSURE_REF(entry);
+    if (*entry == NULL) {
+        return S2N_RESULT_OK;
+    }
+    if (free_psk) {
+        RESULT_GUARD_POSIX(s2n_psk_free(&(*entry)->psk));
+    }
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) entry, sizeof(struct s2n_psk_store_entry)));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_psk_store_table_free(struct s2n_psk_store_table **table, bool free_psks)
+{
+    RESULT_ENSURE_REF(table);
+    struct s2n_psk_store_table *to_free = *table;
+    if (to_free == NULL) {
+        return S2N_RESULT_OK;
+    }
+
+    if (to_free->buckets) {
+        for (size_t i = 0; i <= to_free->bucket_mask; i++) {
+            struct s2n_psk_store_entry *entry = to_free->buckets[i];
+            while (entry) {
+                struct s2n_psk_store_entry *next = entry->next;
+                RESULT_GUARD(s2n_psk_store_entry_free(&entry, free_psks));
+                entry = next;
+            }
+        }
+    }
+    RESULT_GUARD_POSIX(s2n_free(&to_free->buckets_mem));
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) table, sizeof(struct s2n_psk_store_table)));
+    return S2N_RESULT_OK;
+}
+
+static S2N_CLEANUP_RESULT s2n_psk_store_table_ptr_free(struct s2n_psk_store_table **table)
+{
+    /* Tables that were never published share their PSKs with the published table */
+    RESULT_GUARD(s2n_psk_store_table_free(table, false));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_psk_store_table_new(uint32_t bucket_count, struct s2n_psk_store_table **table)
+{
+    RESULT_ENSURE_REF(table);
+
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_psk_store_table)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+    struct s2n_psk_store_table *new_table = (struct s2n_psk_store_table *) (void *) mem.data;
+
+    RESULT_GUARD_POSIX(s2n_alloc(&new_table->buckets_mem, bucket_count * sizeof(struct s2n_psk_store_entry *)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&new_table->buckets_mem));
+    new_table->buckets = (struct s2n_psk_store_entry **) (void *) new_table->buckets_mem.data;
+    new_table->bucket_mask = bucket_count - 1;
+
+    *table = new_table;
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+    return S2N_RESULT_OK;
+}
+
+/* Waits until no lookup can still be reading anything that was unpublished before this call */
+static S2N_RESULT s2n_psk_store_synchronize(struct s2n_psk_store *store)
+{
+    RESULT_ENSURE_EQ(pthread_rwlock_wrlock(&store->read_lock), 0);
+    RESULT_ENSURE_EQ(pthread_rwlock_unlock(&store->read_lock), 0);
+    return S2N_RESULT_OK;
+}
+
+struct s2n_psk_store *s2n_psk_store_new(void)
+{
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    PTR_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_psk_store)));
+    PTR_GUARD_POSIX(s2n_blob_zero(&mem));
+    struct s2n_psk_store *store = (struct s2n_psk_store *) (void *) mem.data;
+
+    PTR_GUARD_RESULT(s2n_siphash_key_generate(&store->hash_key));
+    PTR_GUARD_RESULT(s2n_psk_store_table_new(S2N_PSK_STORE_INITIAL_BUCKETS, &store->table));
+    if (pthread_mutex_init(&store->write_lock, NULL) != 0) {
+        PTR_GUARD_RESULT(s2n_psk_store_table_free(&store->table, true));
+        PTR_BAIL(S2N_ERR_SAFETY);
+    }
+    if (pthread_rwlock_init(&store->read_lock, NULL) != 0) {
+        pthread_mutex_destroy(&store->write_lock);
+        PTR_GUARD_RESULT(s2n_psk_store_table_free(&store->table, true));
+        PTR_BAIL(S2N_ERR_SAFETY);
+    }
+
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+    return store;
+}
+
+int s2n_psk_store_free(struct s2n_psk_store **store)
+{
+    POSIX_ENSURE_REF(store);
+    struct s2n_psk_store *to_free = *store;
+    if (to_free == NULL) {
+        return S2N_SUCCESS;
+    }
+
+    POSIX_GUARD_RESULT(s2n_psk_store_table_free(&to_free->table, true));
+    POSIX_ENSURE_EQ(pthread_mutex_destroy(&to_free->write_lock), 0);
+    POSIX_ENSURE_EQ(pthread_rwlock_destroy(&to_free->read_lock), 0);
+    POSIX_GUARD(s2n_free_object((uint8_t **) store, sizeof(struct s2n_psk_store)));
+    return S2N_SUCCESS;
+}
+
+/* Doubles the number of buckets by building a new table from copies of the current entries,
+ * which are still being read by lookups.
+ */
+static S2N_RESULT s2n_psk_store_grow_locked(struct s2n_psk_store *store)
+{
+    struct s2n_psk_store_table *old_table = store->table;
+    uint32_t bucket_count = old_table->bucket_mask + 1;
+    RESULT_ENSURE(bucket_count <= UINT32_MAX / 2, S2N_ERR_INTEGER_OVERFLOW);
+
+    DEFER_CLEANUP(struct s2n_psk_store_table *new_table = NULL, s2n_psk_store_table_ptr_free);
+    RESULT_GUARD(s2n_psk_store_table_new(bucket_count * 2, &new_table));
+    for (size_t i = 0; i < bucket_count; i++) {
+        for (struct s2n_psk_store_entry *entry = old_table->buckets[i]; entry; entry = entry->next) {
+            struct s2n_psk_store_entry **bucket = &new_table->buckets[entry->hash & new_table->bucket_mask];
+            RESULT_GUARD(s2n_psk_store_entry_new(entry->psk, entry->hash, *bucket, bucket));
+        }
+    }
+
+    s2n_atomic_ptr_store((void **) &store->table, new_table);
+    new_table = NULL;
+
+    RESULT_GUARD(s2n_psk_store_synchronize(store));
+    RESULT_GUARD(s2n_psk_store_table_free(&old_table, false));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_psk_store_add_locked(struct s2n_psk_store *store, struct s2n_psk_store_entry *new_entry)
+{
+    struct s2n_psk *psk = new_entry->psk;
+    struct s2n_psk_store_entry **bucket = &store->table->buckets[new_entry->hash & store->table->bucket_mask];
+    for (struct s2n_psk_store_entry *entry = *bucket; entry; entry = entry->next) {
+        RESULT_ENSURE(!s2n_psk_store_entry_matches(entry, new_entry->hash, psk->identity.data, psk->identity.size),
+                S2N_ERR_DUPLICATE_PSK_IDENTITIES);
+    }
+
+    /* Keep an average of at most one PSK per bucket */
+    if (store->psk_count > store->table->bucket_mask) {
+        RESULT_GUARD(s2n_psk_store_grow_locked(store));
+        bucket = &store->table->buckets[new_entry->hash & store->table->bucket_mask];
+    }
+
+    new_entry->next = *bucket;
+    s2n_atomic_ptr_store((void **) bucket, new_entry);
+    store->psk_count++;
+    return S2N_RESULT_OK;
+}
+
+int s2n_psk_store_add(struct s2n_psk_store *store, struct s2n_psk *psk)
+{
+    POSIX_ENSURE_REF(store);
+    POSIX_ENSURE_REF(psk);
+    POSIX_ENSURE(psk->type == S2N_PSK_TYPE_EXTERNAL, S2N_ERR_INVALID_ARGUMENT);
+    POSIX_ENSURE(psk->identity.size > 0, S2N_ERR_INVALID_ARGUMENT);
+    POSIX_ENSURE(psk->secret.size > 0, S2N_ERR_INVALID_ARGUMENT);
+
+    DEFER_CLEANUP(struct s2n_psk *new_psk = s2n_external_psk_new(), s2n_psk_free);
+    POSIX_ENSURE_REF(new_psk);
+    POSIX_ENSURE(s2n_result_is_ok(s2n_psk_clone(new_psk, psk)), S2N_ERR_INVALID_ARGUMENT);
+
+    uint64_t hash = 0;
+    POSIX_GUARD_RESULT(s2n_psk_store_hash(store, psk->identity.data, psk->identity.size, &hash));
+
+    struct s2n_psk_store_entry *new_entry = NULL;
+    POSIX_GUARD_RESULT(s2n_psk_store_entry_new(new_psk, hash, NULL, &new_entry));
+
+    POSIX_ENSURE_EQ(pthread_mutex_lock(&store->write_lock), 0);
+    s2n_result result = s2n_psk_store_add_locked(store, new_entry);
+    POSIX_ENSURE_EQ(pthread_mutex_unlock(&store->write_lock), 0);
+
+    if (s2n_result_is_error(result)) {
+        POSIX_GUARD_RESULT(s2n_psk_store_entry_free(&new_entry, false));
+        POSIX_GUARD_RESULT(result);
+    }
+
+    /* The store now owns the PSK */
+    new_psk = NULL;
+    return S2N_SUCCESS;
+}
+
+/* Published entries can't be unlinked in place, because a lookup may be reading the entry before
+ * the removed entry. Instead, the entries before the removed entry are replaced by copies.
+ */
+static S2N_RESULT s2n_psk_store_remove_locked(struct s2n_psk_store *store, const uint8_t *identity,
+        uint16_t identity_size, uint64_t hash)
+{
+    struct s2n_psk_store_entry **bucket = &store->table->buckets[hash & store->table->bucket_mask];
+
+    struct s2n_psk_store_entry *removed = *bucket;
+    while (removed && !s2n_psk_store_entry_matches(removed, hash, identity, identity_size)) {
+        removed = removed->next;
+    }
+    RESULT_ENSURE(removed, S2N_ERR_INVALID_ARGUMENT);
+
+    /* Build the copies as a separate chain ending at the entry after the removed entry */
+    struct s2n_psk_store_entry *new_head = removed->next;
+    struct s2n_psk_store_entry **tail = &new_head;
+    s2n_result result = S2N_RESULT_OK;
+    for (struct s2n_psk_store_entry *entry = *bucket; entry != removed; entry = entry->next) {
+        struct s2n_psk_store_entry *copy = NULL;
+        result = s2n_psk_store_entry_new(entry->psk, entry->hash, *tail, &copy);
+        if (s2n_result_is_error(result)) {
+            break;
+        }
+        *tail = copy;
+        tail = &copy->next;
+    }
+    if (s2n_result_is_error(result)) {
+        for (struct s2n_psk_store_entry *copy = new_head; copy != removed->next;) {
+            struct s2n_psk_store_entry *next = copy->next;
+            RESULT_GUARD(s2n_psk_store_entry_free(&copy, false));
+            copy = next;
+        }
+        return result;
+    }
+
+    struct s2n_psk_store_entry *old_head = *bucket;
+    s2n_atomic_ptr_store((void **) bucket, new_head);
+    store->psk_count--;
+
+    RESULT_GUARD(s2n_psk_store_synchronize(store));
+    for (struct s2n_psk_store_entry *entry = old_head; entry != removed;) {
+        struct s2n_psk_store_entry *next = entry->next;
+        RESULT_GUARD(s2n_psk_store_entry_free(&entry, false));
+        entry = next;
+    }
+    RESULT_GUARD(s2n_psk_store_entry_free(&removed, true));
+    return S2N_RESULT_OK;
+}
+
+int s2n_psk_store_remove(struct s2n_psk_store *store, const uint8_t *identity, uint16_t identity_size)
+{
+    POSIX_ENSURE_REF(store);
+    POSIX_ENSURE_REF(identity);
+
+    uint64_t hash = 0;
+    POSIX_GUARD_RESULT(s2n_psk_store_hash(store, identity, identity_size, &hash));
+
+    POSIX_ENSURE_EQ(pthread_mutex_lock(&store->write_lock), 0);
+    s2n_result result = s2n_psk_store_remove_locked(store, identity, identity_size, hash);
+    POSIX_ENSURE_EQ(pthread_mutex_unlock(&store->write_lock), 0);
+    POSIX_GUARD_RESULT(result);
+    return S2N_SUCCESS;
+}
+
+static S2N_RESULT s2n_psk_store_append_match_locked(struct s2n_psk_store *store, struct s2n_connection *conn,
+        const struct s2n_blob *identity, uint64_t hash, struct s2n_psk **match)
+{
+    struct s2n_psk_store_table *table = s2n_atomic_ptr_load((void **) &store->table);
+    struct s2n_psk_store_entry *entry = s2n_atomic_ptr_load((void **) &table->buckets[hash & table->bucket_mask]);
+    while (entry && !s2n_psk_store_entry_matches(entry, hash, identity->data, identity->size)) {
+        entry = entry->next;
+    }
+    if (entry == NULL) {
+        return S2N_RESULT_OK;
+    }
+
+    /* The handshake derives secrets into the chosen PSK, so each connection needs its own copy */
+    struct s2n_array *psk_list = &conn->psk_params.psk_list;
+    DEFER_CLEANUP(struct s2n_psk new_psk = { 0 }, s2n_psk_wipe);
+    RESULT_GUARD(s2n_psk_init(&new_psk, S2N_PSK_TYPE_EXTERNAL));
+    RESULT_GUARD(s2n_psk_clone(&new_psk, entry->psk));
+    RESULT_GUARD(s2n_array_insert_and_copy(psk_list, psk_list->len, &new_psk));
+    ZERO_TO_DISABLE_DEFER_CLEANUP(new_psk);
+
+    RESULT_GUARD(s2n_array_get(psk_list, psk_list->len - 1, (void **) match));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_psk_store_append_match(struct s2n_psk_store *store, struct s2n_connection *conn,
+        const struct s2n_blob *identity, struct s2n_psk **match)
+{
+    RESULT_ENSURE_REF(store);
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(identity);
+    RESULT_ENSURE_REF(match);
+    RESULT_ENSURE_EQ(conn->psk_params.type, S2N_PSK_TYPE_EXTERNAL);
+    *match = NULL;
+
+    uint64_t hash = 0;
+    RESULT_GUARD(s2n_psk_store_hash(store, identity->data, identity->size, &hash));
+
+    RESULT_ENSURE_EQ(pthread_rwlock_rdlock(&store->read_lock), 0);
+    s2n_result result = s2n_psk_store_append_match_locked(store, conn, identity, hash, match);
+    RESULT_ENSURE_EQ(pthread_rwlock_unlock(&store->read_lock), 0);
+    return result;
+}
+
+int s2n_config_add_psk_store(struct s2n_config *config, struct s2n_psk_store *store)
+{
+    POSIX_ENSURE_REF(config);
+    POSIX_ENSURE_REF(store);
+    POSIX_ENSURE(config->psk_store == NULL, S2N_ERR_INVALID_STATE);
+    POSIX_GUARD(s2n_config_set_psk_mode(config, S2N_PSK_MODE_EXTERNAL));
+    config->psk_store = store;
+    return S2N_SUCCESS;
+}
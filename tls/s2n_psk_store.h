@@ -0,0 +1,62 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+#include "api/unstable/psk_store.h"
+#include "tls/s2n_psk.h"
+#include "utils/s2n_blob.h"
+#include "utils/s2n_result.h"
+#include "utils/s2n_siphash.h"
+
+/* A hash index of external PSKs shared by all connections using a config.
+ *
+ * Lookups never wait for updates, using read-copy-update:
+ * published entries and tables are never modified. Writers instead build
+ * new entries or tables, publish them with an atomic pointer store,
+ * and only free what they replaced once no lookup can still be using it.
+ *
+ * Lookups hold the read side of a rwlock. A writer waits for the lookups that
+ * started before it published by taking and immediately releasing the write side.
+ */
+
+struct s2n_connection;
+
+struct s2n_psk_store_entry {
+    struct s2n_psk_store_entry *next;
+    struct s2n_psk *psk;
+    uint64_t hash;
+};
+
+struct s2n_psk_store_table {
+    struct s2n_blob buckets_mem;
+    struct s2n_psk_store_entry **buckets;
+    uint32_t bucket_mask;
+};
+
+struct s2n_psk_store {
+    struct s2n_siphash_key hash_key;
+    struct s2n_psk_store_table *table;
+    uint32_t psk_count;
+    /* Serializes writers */
+    pthread_mutex_t write_lock;
+    /* Held for reading by lookups, and briefly for writing to wait for lookups to finish */
+    pthread_rwlock_t read_lock;
+};
+
+S2N_RESULT s2n_psk_store_append_match(struct s2n_psk_store *store, struct s2n_connection *conn,
+        const struct s2n_blob *identity, struct s2n_psk **match);
@@ -27,6 +27,7 @@
 #include "tls/s2n_crypto.h"
 #include "utils/s2n_blob.h"
 #include "utils/s2n_safety.h"
+#include "utils/s2n_usdt.h"
 
 int s2n_sslv2_record_header_parse(
         struct s2n_connection *conn,
@@ -202,6 +203,7 @@ int s2n_record_parse(struct s2n_connection *conn)
         POSIX_ENSURE(content_type != TLS_APPLICATION_DATA, S2N_ERR_DECRYPT);
     }
 
+    S2N_USDT_PROBE3(record_decrypt_start, conn, content_type, encrypted_length);
     switch (cipher_suite->record_alg->cipher->type) {
         case S2N_AEAD:
             POSIX_GUARD(s2n_record_parse_aead(cipher_suite, conn, content_type, encrypted_length, implicit_iv, mac, sequence_number, session_key));
@@ -219,6 +221,7 @@ int s2n_record_parse(struct s2n_connection *conn)
             POSIX_BAIL(S2N_ERR_CIPHER_TYPE);
             break;
     }
+    S2N_USDT_PROBE3(record_decrypt_done, conn, content_type, s2n_stuffer_data_available(&conn->in));
 
     return 0;
 }
@@ -29,6 +29,7 @@
 #include "utils/s2n_blob.h"
 #include "utils/s2n_random.h"
 #include "utils/s2n_safety.h"
+#include "utils/s2n_usdt.h"
 
 extern uint8_t s2n_unknown_protocol_version;
 
@@ -438,6 +439,7 @@ int s2n_record_writev(struct s2n_connection *conn, uint8_t content_type, const s
 
         uint32_t buffer_size = MAX(conn->config->send_buffer_size_override, max_wire_record_size);
         POSIX_GUARD(s2n_stuffer_growable_alloc(&conn->out, buffer_size));
+        conn->stats.buffer_resizes++;
     }
 
     /* A record only local stuffer used to avoid tainting the conn->out stuffer or overwriting
@@ -618,7 +620,9 @@ int s2n_record_writev(struct s2n_connection *conn, uint8_t content_type, const s
 
     /* Do the encryption */
     struct s2n_blob en = { .size = encrypted_length, .data = s2n_stuffer_raw_write(&record_stuffer, encrypted_length) };
+    S2N_USDT_PROBE3(record_encrypt_start, conn, content_type, data_bytes_to_take);
     POSIX_GUARD(s2n_record_encrypt(conn, cipher_suite, session_key, &iv, &aad, &en, implicit_iv, block_size));
+    S2N_USDT_PROBE3(record_encrypt_done, conn, content_type, encrypted_length);
 
     /* Sync the out stuffer write cursor with the record stuffer. */
     POSIX_GUARD(s2n_stuffer_skip_write(&conn->out, s2n_stuffer_data_available(&record_stuffer)));
@@ -628,6 +632,12 @@ int s2n_record_writev(struct s2n_connection *conn, uint8_t content_type, const s
         conn->server = current_server_crypto;
     }
 
+    conn->stats.records_sent++;
+    conn->stats.bytes_copied += data_bytes_to_take;
+    if (content_type == TLS_APPLICATION_DATA) {
+        conn->stats.plaintext_bytes_sent += data_bytes_to_take;
+    }
+
     return data_bytes_to_take;
 }
 
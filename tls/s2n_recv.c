@@ -35,6 +35,7 @@
 #include "utils/s2n_io.h"
 #include "utils/s2n_safety.h"
 #include "utils/s2n_socket.h"
+#include "utils/s2n_usdt.h"
 
 S2N_RESULT s2n_recv_in_init(struct s2n_connection *conn, uint32_t written, uint32_t total)
 {
@@ -67,7 +68,13 @@ S2N_RESULT s2n_read_in_bytes(struct s2n_connection *conn, struct s2n_stuffer *ou
         if (r == 0) {
             s2n_atomic_flag_set(&conn->read_closed);
         }
-        RESULT_GUARD(s2n_io_check_read_result(r));
+        conn->stats.read_calls++;
+        s2n_result result = s2n_io_check_read_result(r);
+        if (s2n_result_is_error(result) && s2n_errno == S2N_ERR_IO_BLOCKED) {
+            conn->stats.read_blocked++;
+            S2N_USDT_PROBE2(io_blocked, conn, S2N_BLOCKED_ON_READ);
+        }
+        RESULT_GUARD(result);
         conn->wire_bytes_in += r;
     }
 
@@ -76,11 +83,15 @@ S2N_RESULT s2n_read_in_bytes(struct s2n_connection *conn, struct s2n_stuffer *ou
 
 static S2N_RESULT s2n_recv_buffer_in(struct s2n_connection *conn, size_t min_size)
 {
-    RESULT_GUARD_POSIX(s2n_stuffer_resize_if_empty(&conn->buffer_in, S2N_LARGE_FRAGMENT_LENGTH));
+    if (conn->buffer_in.blob.data == NULL) {
+        RESULT_GUARD_POSIX(s2n_stuffer_resize_if_empty(&conn->buffer_in, S2N_LARGE_FRAGMENT_LENGTH));
+        conn->stats.buffer_resizes++;
+    }
     uint32_t buffer_in_available = s2n_stuffer_data_available(&conn->buffer_in);
     if (buffer_in_available < min_size) {
         uint32_t remaining = min_size - buffer_in_available;
         if (s2n_stuffer_space_remaining(&conn->buffer_in) < remaining) {
+            conn->stats.bytes_copied += buffer_in_available;
             RESULT_GUARD_POSIX(s2n_stuffer_shift(&conn->buffer_in));
         }
         RESULT_GUARD(s2n_read_in_bytes(conn, &conn->buffer_in, min_size));
@@ -111,6 +122,7 @@ int s2n_read_full_record(struct s2n_connection *conn, uint8_t *record_type, int
         s2n_result ret = s2n_recv_buffer_in(conn, header_remaining);
         uint32_t header_read = MIN(header_remaining, s2n_stuffer_data_available(&conn->buffer_in));
         POSIX_GUARD(s2n_stuffer_copy(&conn->buffer_in, &conn->header_in, header_read));
+        conn->stats.bytes_copied += header_read;
         POSIX_GUARD_RESULT(ret);
     }
 
@@ -133,6 +145,7 @@ int s2n_read_full_record(struct s2n_connection *conn, uint8_t *record_type, int
         POSIX_GUARD_RESULT(s2n_recv_in_init(conn, fragment_read, fragment_length));
         POSIX_GUARD_RESULT(ret);
     }
+    conn->stats.records_received++;
 
     if (*isSSLv2) {
         return 0;
@@ -262,6 +275,8 @@ ssize_t s2n_recv_impl(struct s2n_connection *conn, void *buf, ssize_t size_signe
 
         POSIX_GUARD(s2n_stuffer_erase_and_read(&conn->in, &out));
         bytes_read += out.size;
+        conn->stats.plaintext_bytes_received += out.size;
+        conn->stats.bytes_copied += out.size;
 
         out.data += out.size;
         size -= out.size;
@@ -100,6 +100,7 @@ int s2n_renegotiate_wipe(struct s2n_connection *conn)
      * This isn't strictly necessary, but potentially useful. */
     uint64_t wire_bytes_in = conn->wire_bytes_in;
     uint64_t wire_bytes_out = conn->wire_bytes_out;
+    struct s2n_connection_stats stats = conn->stats;
 
     /* Save io settings */
     bool send_managed = conn->managed_send_io;
@@ -150,6 +151,7 @@ int s2n_renegotiate_wipe(struct s2n_connection *conn)
     conn->client_protocol_version = client_protocol_version;
     conn->wire_bytes_in = wire_bytes_in;
     conn->wire_bytes_out = wire_bytes_out;
+    conn->stats = stats;
     conn->managed_send_io = send_managed;
     conn->send = send_fn;
     conn->send_io_context = send_ctx;
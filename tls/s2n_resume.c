@@ -23,10 +23,12 @@
 #include "tls/s2n_cipher_suites.h"
 #include "tls/s2n_connection.h"
 #include "tls/s2n_crypto.h"
+#include "tls/s2n_ticket_key_cache.h"
 #include "tls/s2n_tls.h"
 #include "utils/s2n_blob.h"
 #include "utils/s2n_random.h"
 #include "utils/s2n_safety.h"
+#include "utils/s2n_usdt.h"
 
 int s2n_allowed_to_cache_connection(struct s2n_connection *conn)
 {
@@ -469,6 +471,9 @@ int s2n_resume_from_cache(struct s2n_connection *conn)
     if (result == S2N_CALLBACK_BLOCKED) {
         POSIX_BAIL(S2N_ERR_ASYNC_BLOCKED);
     }
+    if (result < S2N_SUCCESS) {
+        S2N_USDT_PROBE1(session_cache_miss, conn);
+    }
     POSIX_ENSURE(result >= S2N_SUCCESS, S2N_ERR_CANCELLED);
 
     S2N_ERROR_IF(size != entry.size, S2N_ERR_SIZE_MISMATCH);
@@ -477,6 +482,7 @@ int s2n_resume_from_cache(struct s2n_connection *conn)
     POSIX_GUARD(s2n_stuffer_init(&from, &entry));
     POSIX_GUARD(s2n_stuffer_write(&from, &entry));
     POSIX_GUARD_RESULT(s2n_resume_decrypt_session(conn, &from));
+    S2N_USDT_PROBE1(session_cache_hit, conn);
 
     return 0;
 }
@@ -495,8 +501,10 @@ S2N_RESULT s2n_store_to_cache(struct s2n_connection *conn)
 
     RESULT_GUARD_POSIX(s2n_stuffer_init(&to, &entry));
 
-    struct s2n_ticket_key *key = s2n_get_ticket_encrypt_decrypt_key(conn->config);
-    RESULT_GUARD(s2n_resume_encrypt_session_ticket(conn, key, &to));
+    uint8_t key_name[S2N_TICKET_KEY_NAME_LEN] = { 0 };
+    uint64_t key_intro_timestamp = 0;
+    RESULT_GUARD(s2n_config_select_ticket_encrypt_key(conn->config, key_name, &key_intro_timestamp));
+    RESULT_GUARD(s2n_resume_encrypt_session_ticket(conn, key_name, &to));
 
     /* Store to the cache */
     conn->config->cache_store(conn, conn->config->cache_store_data, S2N_TLS_SESSION_CACHE_TTL, conn->session_id, conn->session_id_len, entry.data, entry.size);
@@ -626,134 +634,244 @@ int s2n_connection_is_ocsp_stapled(struct s2n_connection *conn)
     }
 }
 
-S2N_RESULT s2n_config_is_encrypt_key_available(struct s2n_config *config)
+static bool s2n_ticket_key_schedule_is_current(struct s2n_config *config, uint64_t now)
 {
-    RESULT_ENSURE_REF(config);
+    struct s2n_ticket_key_index *index = config->ticket_key_index;
+    return index->schedule_ready
+            && index->schedule_lifetime == config->encrypt_decrypt_key_lifetime_in_nanos
+            && index->schedule_start <= now && now < index->schedule_end;
+}
 
-    uint64_t now = 0;
-    struct s2n_ticket_key *ticket_key = NULL;
-    RESULT_GUARD(s2n_config_wall_clock(config, &now));
-    RESULT_ENSURE_REF(config->ticket_keys);
+/* Finds the keys in the encrypt-decrypt state, and the interval during which that set
+ * of keys doesn't change: the latest key introduction, peak or expiration before now,
+ * and the earliest one after now.
+ *
+ * A key's weight rises linearly from its introduction until halfway through its
+ * encrypt-decrypt lifetime, then falls linearly until it expires. No key passes its
+ * peak within the interval, so the cumulative weights are stored as their value at
+ * schedule_start and their rate of change.
+ */
+static S2N_RESULT s2n_ticket_key_schedule_update(struct s2n_config *config, uint64_t now)
+{
+    struct s2n_ticket_key_index *index = config->ticket_key_index;
+    index->schedule_ready = false;
+    index->encrypt_keys_len = 0;
+    index->schedule_start = 0;
+    index->schedule_end = UINT64_MAX;
 
     uint32_t ticket_keys_len = 0;
     RESULT_GUARD(s2n_array_num_elements(config->ticket_keys, &ticket_keys_len));
+    RESULT_ENSURE_LTE(ticket_keys_len, S2N_MAX_TICKET_KEYS);
 
+    const uint64_t half_lifetime = config->encrypt_decrypt_key_lifetime_in_nanos / 2;
     for (uint32_t i = ticket_keys_len; i > 0; i--) {
         uint32_t idx = i - 1;
+        struct s2n_ticket_key *ticket_key = NULL;
         RESULT_GUARD(s2n_array_get(config->ticket_keys, idx, (void **) &ticket_key));
         uint64_t key_intro_time = ticket_key->intro_timestamp;
+        uint64_t key_encryption_peak_time = key_intro_time + half_lifetime;
+        uint64_t key_encrypt_end_time = key_intro_time + config->encrypt_decrypt_key_lifetime_in_nanos;
 
-        if (key_intro_time <= now
-                && now < key_intro_time + config->encrypt_decrypt_key_lifetime_in_nanos) {
-            return S2N_RESULT_OK;
+        /* A key can be used at its intro time (<=) and it can be used up to (<)
+         * its expiration time.
+         */
+        if (key_intro_time <= now && now < key_encrypt_end_time) {
+            index->encrypt_keys[index->encrypt_keys_len] = idx;
+            index->encrypt_keys_len++;
         }
-    }
-
-    RESULT_BAIL(S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
-}
-
-/* This function is used in s2n_get_ticket_encrypt_decrypt_key to compute the weight
- * of the keys and to choose a single key from all of the encrypt-decrypt keys.
- * Higher the weight of the key, higher the probability of being picked.
- */
-int s2n_compute_weight_of_encrypt_decrypt_keys(struct s2n_config *config,
-        uint8_t *encrypt_decrypt_keys_index,
-        uint8_t num_encrypt_decrypt_keys,
-        uint64_t now)
-{
-    double total_weight = 0;
-    struct s2n_ticket_key_weight ticket_keys_weight[S2N_MAX_TICKET_KEYS];
-    struct s2n_ticket_key *ticket_key = NULL;
 
-    /* Compute weight of encrypt-decrypt keys */
-    for (int i = 0; i < num_encrypt_decrypt_keys; i++) {
-        POSIX_GUARD_RESULT(s2n_array_get(config->ticket_keys, encrypt_decrypt_keys_index[i], (void **) &ticket_key));
+        const uint64_t boundaries[] = { key_intro_time, key_encryption_peak_time, key_encrypt_end_time };
+        for (size_t j = 0; j < s2n_array_len(boundaries); j++) {
+            if (boundaries[j] <= now) {
+                index->schedule_start = MAX(index->schedule_start, boundaries[j]);
+            } else {
+                index->schedule_end = MIN(index->schedule_end, boundaries[j]);
+            }
+        }
+    }
 
+    double cumulative_weight = 0;
+    int16_t cumulative_slope = 0;
+    for (size_t i = 0; i < index->encrypt_keys_len; i++) {
+        struct s2n_ticket_key *ticket_key = NULL;
+        RESULT_GUARD(s2n_array_get(config->ticket_keys, index->encrypt_keys[i], (void **) &ticket_key));
         uint64_t key_intro_time = ticket_key->intro_timestamp;
-        uint64_t key_encryption_peak_time = key_intro_time + (config->encrypt_decrypt_key_lifetime_in_nanos / 2);
+        uint64_t key_encryption_peak_time = key_intro_time + half_lifetime;
 
         /* The % of encryption using this key is linearly increasing */
         if (now < key_encryption_peak_time) {
-            ticket_keys_weight[i].key_weight = now - key_intro_time;
+            cumulative_weight += index->schedule_start - key_intro_time;
+            cumulative_slope++;
         } else {
             /* The % of encryption using this key is linearly decreasing */
-            ticket_keys_weight[i].key_weight = (config->encrypt_decrypt_key_lifetime_in_nanos / 2) - (now - key_encryption_peak_time);
+            cumulative_weight += half_lifetime - (index->schedule_start - key_encryption_peak_time);
+            cumulative_slope--;
         }
-
-        ticket_keys_weight[i].key_index = encrypt_decrypt_keys_index[i];
-        total_weight += ticket_keys_weight[i].key_weight;
+        index->cumulative_weights[i] = cumulative_weight;
+        index->cumulative_slopes[i] = cumulative_slope;
     }
 
-    /* Pick a random number in [0, 1). Using 53 bits (IEEE 754 double-precision floats). */
-    uint64_t random_int = 0;
-    POSIX_GUARD_RESULT(s2n_public_random(pow(2, 53), &random_int));
-    double random = (double) random_int / (double) pow(2, 53);
+    index->schedule_lifetime = config->encrypt_decrypt_key_lifetime_in_nanos;
+    index->schedule_ready = true;
+    return S2N_RESULT_OK;
+}
 
-    /* Compute cumulative weight of encrypt-decrypt keys */
-    for (int i = 0; i < num_encrypt_decrypt_keys; i++) {
-        ticket_keys_weight[i].key_weight = ticket_keys_weight[i].key_weight / total_weight;
+static double s2n_ticket_key_cumulative_weight(struct s2n_ticket_key_index *index, size_t i, uint64_t now)
+{
+    return index->cumulative_weights[i] + (double) index->cumulative_slopes[i] * (double) (now - index->schedule_start);
+}
 
-        if (i > 0) {
-            ticket_keys_weight[i].key_weight += ticket_keys_weight[i - 1].key_weight;
-        }
+/* Chooses a single key from the encrypt-decrypt keys with one random draw.
+ * Higher the weight of the key, higher the probability of being picked.
+ * Only the key's name and introduction time are copied out, since the key may be removed once unlocked.
+ */
+static S2N_RESULT s2n_ticket_key_select_locked(struct s2n_config *config, uint64_t now,
+        uint8_t key_name[S2N_TICKET_KEY_NAME_LEN], uint64_t *intro_timestamp)
+{
+    struct s2n_ticket_key_index *index = config->ticket_key_index;
+    RESULT_ENSURE(index->encrypt_keys_len > 0, S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
+    if (key_name == NULL) {
+        return S2N_RESULT_OK;
+    }
 
-        if (ticket_keys_weight[i].key_weight > random) {
-            return ticket_keys_weight[i].key_index;
+    uint8_t idx = index->encrypt_keys[0];
+    if (index->encrypt_keys_len > 1) {
+        double total_weight = s2n_ticket_key_cumulative_weight(index, index->encrypt_keys_len - 1, now);
+        RESULT_ENSURE(total_weight > 0, S2N_ERR_ENCRYPT_DECRYPT_KEY_SELECTION_FAILED);
+
+        /* Pick a random number in [0, 1). Using 53 bits (IEEE 754 double-precision floats). */
+        uint64_t random_int = 0;
+        RESULT_GUARD(s2n_public_random(pow(2, 53), &random_int));
+        double random = ((double) random_int / (double) pow(2, 53)) * total_weight;
+
+        /* Find the first key whose cumulative weight exceeds the random number */
+        size_t low = 0;
+        size_t high = index->encrypt_keys_len - 1;
+        RESULT_ENSURE(s2n_ticket_key_cumulative_weight(index, high, now) > random,
+                S2N_ERR_ENCRYPT_DECRYPT_KEY_SELECTION_FAILED);
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (s2n_ticket_key_cumulative_weight(index, mid, now) > random) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
         }
+        idx = index->encrypt_keys[low];
     }
 
-    POSIX_BAIL(S2N_ERR_ENCRYPT_DECRYPT_KEY_SELECTION_FAILED);
+    struct s2n_ticket_key *key = NULL;
+    RESULT_GUARD(s2n_array_get(config->ticket_keys, idx, (void **) &key));
+    RESULT_CHECKED_MEMCPY(key_name, key->key_name, S2N_TICKET_KEY_NAME_LEN);
+    *intro_timestamp = key->intro_timestamp;
+    return S2N_RESULT_OK;
 }
 
-/* This function is used in s2n_resume_encrypt_session_ticket in order for s2n to
- * choose a key in encrypt-decrypt state from all of the keys added to config
+/* Chooses a key in the encrypt-decrypt state and copies its name and introduction time,
+ * or only checks that one exists if key_name is NULL.
+ *
+ * The set of encrypt-decrypt keys is cached, so a selection only considers the
+ * keys that can currently encrypt instead of every key added to the config.
+ *
+ * Keys can be removed by another thread as soon as the index lock is released, so no
+ * pointer to the key is returned: s2n_resume_encrypt_session_ticket finds it again by name.
  */
-struct s2n_ticket_key *s2n_get_ticket_encrypt_decrypt_key(struct s2n_config *config)
+S2N_RESULT s2n_config_select_ticket_encrypt_key(struct s2n_config *config, uint8_t key_name[S2N_TICKET_KEY_NAME_LEN],
+        uint64_t *intro_timestamp)
 {
-    uint8_t num_encrypt_decrypt_keys = 0;
-    uint8_t encrypt_decrypt_keys_index[S2N_MAX_TICKET_KEYS] = { 0 };
-    struct s2n_ticket_key *ticket_key = NULL;
+    RESULT_ENSURE_REF(config);
+    struct s2n_ticket_key_index *index = config->ticket_key_index;
+    RESULT_ENSURE(config->ticket_keys != NULL && index != NULL, S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
+    RESULT_ENSURE((key_name == NULL) == (intro_timestamp == NULL), S2N_ERR_SAFETY);
 
     uint64_t now = 0;
-    PTR_GUARD_RESULT(s2n_config_wall_clock(config, &now));
-    PTR_ENSURE_REF(config->ticket_keys);
-
-    uint32_t ticket_keys_len = 0;
-    PTR_GUARD_RESULT(s2n_array_num_elements(config->ticket_keys, &ticket_keys_len));
-
-    for (uint32_t i = ticket_keys_len; i > 0; i--) {
-        uint32_t idx = i - 1;
-        PTR_GUARD_RESULT(s2n_array_get(config->ticket_keys, idx, (void **) &ticket_key));
-        uint64_t key_intro_time = ticket_key->intro_timestamp;
+    RESULT_GUARD(s2n_config_wall_clock(config, &now));
 
-        /* A key can be used at its intro time (<=) and it can be used up to (<) 
-         * its expiration time.
-         */
-        if (key_intro_time <= now
-                && now < key_intro_time + config->encrypt_decrypt_key_lifetime_in_nanos) {
-            encrypt_decrypt_keys_index[num_encrypt_decrypt_keys] = idx;
-            num_encrypt_decrypt_keys++;
+    RESULT_ENSURE_EQ(pthread_rwlock_rdlock(&index->lock), 0);
+    if (!s2n_ticket_key_schedule_is_current(config, now)) {
+        RESULT_ENSURE_EQ(pthread_rwlock_unlock(&index->lock), 0);
+        RESULT_ENSURE_EQ(pthread_rwlock_wrlock(&index->lock), 0);
+        /* Another thread may have already updated the schedule */
+        if (!s2n_ticket_key_schedule_is_current(config, now)) {
+            s2n_result result = s2n_ticket_key_schedule_update(config, now);
+            if (s2n_result_is_error(result)) {
+                RESULT_ENSURE_EQ(pthread_rwlock_unlock(&index->lock), 0);
+                return result;
+            }
         }
     }
+    s2n_result result = s2n_ticket_key_select_locked(config, now, key_name, intro_timestamp);
+    RESULT_ENSURE_EQ(pthread_rwlock_unlock(&index->lock), 0);
+
+    return result;
+}
+
+S2N_RESULT s2n_config_is_encrypt_key_available(struct s2n_config *config)
+{
+    RESULT_GUARD(s2n_config_select_ticket_encrypt_key(config, NULL, NULL));
+    return S2N_RESULT_OK;
+}
 
-    if (num_encrypt_decrypt_keys == 0) {
-        PTR_BAIL(S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
+static S2N_RESULT s2n_ticket_key_find_locked(struct s2n_config *config, const uint8_t name[S2N_TICKET_KEY_NAME_LEN],
+        struct s2n_ticket_key **key)
+{
+    struct s2n_map *names = config->ticket_key_index->names;
+    if (names == NULL) {
+        return S2N_RESULT_OK;
     }
 
-    if (num_encrypt_decrypt_keys == 1) {
-        PTR_GUARD_RESULT(s2n_array_get(config->ticket_keys, encrypt_decrypt_keys_index[0], (void **) &ticket_key));
-        return ticket_key;
+    uint8_t name_data[S2N_TICKET_KEY_NAME_LEN] = { 0 };
+    RESULT_CHECKED_MEMCPY(name_data, name, sizeof(name_data));
+    struct s2n_blob name_blob = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&name_blob, name_data, sizeof(name_data)));
+    struct s2n_blob idx_blob = { 0 };
+    bool found = false;
+    RESULT_GUARD(s2n_map_lookup(names, &name_blob, &idx_blob, &found));
+    if (!found) {
+        return S2N_RESULT_OK;
     }
+    RESULT_ENSURE_EQ(idx_blob.size, sizeof(uint8_t));
 
-    int8_t idx = 0;
-    PTR_GUARD_POSIX(idx = s2n_compute_weight_of_encrypt_decrypt_keys(config, encrypt_decrypt_keys_index, num_encrypt_decrypt_keys, now));
+    struct s2n_ticket_key *ticket_key = NULL;
+    RESULT_GUARD(s2n_array_get(config->ticket_keys, idx_blob.data[0], (void **) &ticket_key));
+    RESULT_ENSURE(s2n_constant_time_equals(ticket_key->key_name, name, S2N_TICKET_KEY_NAME_LEN), S2N_ERR_SAFETY);
+    *key = ticket_key;
+    return S2N_RESULT_OK;
+}
 
-    PTR_GUARD_RESULT(s2n_array_get(config->ticket_keys, idx, (void **) &ticket_key));
-    return ticket_key;
+/* Finds a key that can still decrypt, or leaves key NULL if it was removed or has expired */
+static S2N_RESULT s2n_ticket_key_find_unexpired_locked(struct s2n_config *config,
+        const uint8_t name[S2N_TICKET_KEY_NAME_LEN], uint64_t now, struct s2n_ticket_key **key)
+{
+    struct s2n_ticket_key *ticket_key = NULL;
+    RESULT_GUARD(s2n_ticket_key_find_locked(config, name, &ticket_key));
+    if (ticket_key == NULL
+            || now >= ticket_key->intro_timestamp
+                            + config->encrypt_decrypt_key_lifetime_in_nanos
+                            + config->decrypt_key_lifetime_in_nanos) {
+        return S2N_RESULT_OK;
+    }
+    *key = ticket_key;
+    return S2N_RESULT_OK;
 }
 
-/* This function is used in s2n_resume_decrypt_session in order for s2n to
- * find the matching key that was used for encryption.
+/* Selects a key in the encrypt-decrypt state.
+ *
+ * The key is only valid until keys are next added to or removed from the config,
+ * so handshakes use s2n_config_select_ticket_encrypt_key instead.
+ */
+struct s2n_ticket_key *s2n_get_ticket_encrypt_decrypt_key(struct s2n_config *config)
+{
+    uint8_t key_name[S2N_TICKET_KEY_NAME_LEN] = { 0 };
+    uint64_t intro_timestamp = 0;
+    PTR_GUARD_RESULT(s2n_config_select_ticket_encrypt_key(config, key_name, &intro_timestamp));
+    return s2n_find_ticket_key(config, key_name);
+}
+
+/* Finds the key with the given name, unless it has expired.
+ *
+ * The key is only valid until keys are next added to or removed from the config,
+ * so s2n_resume_decrypt_session instead only uses the key while holding the index lock.
  */
 struct s2n_ticket_key *s2n_find_ticket_key(struct s2n_config *config, const uint8_t name[S2N_TICKET_KEY_NAME_LEN])
 {
@@ -761,33 +879,76 @@ struct s2n_ticket_key *s2n_find_ticket_key(struct s2n_config *config, const uint
     struct s2n_ticket_key *ticket_key = NULL;
     PTR_GUARD_RESULT(s2n_config_wall_clock(config, &now));
     PTR_ENSURE_REF(config->ticket_keys);
+    struct s2n_ticket_key_index *index = config->ticket_key_index;
+    PTR_ENSURE_REF(index);
+
+    PTR_ENSURE_EQ(pthread_rwlock_rdlock(&index->lock), 0);
+    s2n_result result = s2n_ticket_key_find_unexpired_locked(config, name, now, &ticket_key);
+    PTR_ENSURE_EQ(pthread_rwlock_unlock(&index->lock), 0);
+    PTR_GUARD_RESULT(result);
+
+    return ticket_key;
+}
+
+/* Must be called with the index write lock held whenever keys are added to or removed from config->ticket_keys */
+static S2N_RESULT s2n_ticket_key_index_rebuild_locked(struct s2n_config *config)
+{
+    struct s2n_ticket_key_index *index = config->ticket_key_index;
+    index->schedule_ready = false;
 
     uint32_t ticket_keys_len = 0;
-    PTR_GUARD_RESULT(s2n_array_num_elements(config->ticket_keys, &ticket_keys_len));
+    RESULT_GUARD(s2n_array_num_elements(config->ticket_keys, &ticket_keys_len));
+    RESULT_ENSURE_LTE(ticket_keys_len, S2N_MAX_TICKET_KEYS);
 
+    DEFER_CLEANUP(struct s2n_map *names = s2n_map_new(), s2n_map_free_pointer);
+    RESULT_ENSURE_REF(names);
     for (uint32_t i = 0; i < ticket_keys_len; i++) {
-        PTR_GUARD_RESULT(s2n_array_get(config->ticket_keys, i, (void **) &ticket_key));
+        struct s2n_ticket_key *ticket_key = NULL;
+        RESULT_GUARD(s2n_array_get(config->ticket_keys, i, (void **) &ticket_key));
+
+        struct s2n_blob name_blob = { 0 };
+        RESULT_GUARD_POSIX(s2n_blob_init(&name_blob, ticket_key->key_name, sizeof(ticket_key->key_name)));
+        uint8_t idx = i;
+        struct s2n_blob idx_blob = { 0 };
+        RESULT_GUARD_POSIX(s2n_blob_init(&idx_blob, &idx, sizeof(idx)));
+        RESULT_GUARD(s2n_map_add(names, &name_blob, &idx_blob));
+    }
+    RESULT_GUARD(s2n_map_complete(names));
 
-        if (s2n_constant_time_equals(ticket_key->key_name, name, S2N_TICKET_KEY_NAME_LEN)) {
-            /* Check to see if the key has expired */
-            if (now >= ticket_key->intro_timestamp
-                            + config->encrypt_decrypt_key_lifetime_in_nanos
-                            + config->decrypt_key_lifetime_in_nanos) {
-                return NULL;
-            }
+    struct s2n_map *old_names = index->names;
+    index->names = names;
+    names = old_names;
+    return S2N_RESULT_OK;
+}
 
-            return ticket_key;
-        }
-    }
+S2N_RESULT s2n_ticket_key_index_new(struct s2n_ticket_key_index **index)
+{
+    RESULT_ENSURE_REF(index);
+    RESULT_ENSURE(*index == NULL, S2N_ERR_SAFETY);
 
-    return NULL;
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_ticket_key_index)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+    struct s2n_ticket_key_index *new_index = (struct s2n_ticket_key_index *) (void *) mem.data;
+    RESULT_ENSURE_EQ(pthread_rwlock_init(&new_index->lock, NULL), 0);
+
+    *index = new_index;
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+    return S2N_RESULT_OK;
 }
 
-struct s2n_unique_ticket_key {
-    struct s2n_blob initial_key;
-    uint8_t info[S2N_AES256_KEY_LEN];
-    uint8_t output_key[S2N_AES256_KEY_LEN];
-};
+S2N_RESULT s2n_ticket_key_index_free(struct s2n_ticket_key_index **index)
+{
+    RESULT_ENSURE_REF(index);
+    if (*index == NULL) {
+        return S2N_RESULT_OK;
+    }
+
+    RESULT_GUARD(s2n_map_free_pointer(&(*index)->names));
+    RESULT_ENSURE_EQ(pthread_rwlock_destroy(&(*index)->lock), 0);
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) index, sizeof(struct s2n_ticket_key_index)));
+    return S2N_RESULT_OK;
+}
 
 /* Ensures that a session ticket encryption key is used only once per ticket.
  *
@@ -795,8 +956,11 @@ struct s2n_unique_ticket_key {
  * As the number of TLS connections increases per second, it becomes more probable that the same
  * random nonce will be generated twice and used with the same ticket key.
  * To avoid this we generate a unique session ticket encryption key for each ticket.
+ *
+ * If ticket key caching is enabled, the unique key is instead generated once per process
+ * and reused with counter nonces. See s2n_ticket_key_cache.c.
  **/
-static S2N_RESULT s2n_resume_generate_unique_ticket_key(struct s2n_unique_ticket_key *key)
+S2N_RESULT s2n_resume_generate_unique_ticket_key(struct s2n_unique_ticket_key *key)
 {
     RESULT_ENSURE_REF(key);
 
@@ -816,14 +980,9 @@ static S2N_RESULT s2n_resume_generate_unique_ticket_key(struct s2n_unique_ticket
     return S2N_RESULT_OK;
 }
 
-S2N_RESULT s2n_resume_encrypt_session_ticket(struct s2n_connection *conn,
-        struct s2n_ticket_key *key, struct s2n_stuffer *to)
+static S2N_RESULT s2n_resume_encrypt_with_unique_key(struct s2n_ticket_key *key, uint8_t info[S2N_TICKET_INFO_SIZE],
+        struct s2n_blob *iv, struct s2n_blob *aad, struct s2n_blob *state)
 {
-    RESULT_ENSURE_REF(conn);
-    RESULT_ENSURE_REF(to);
-
-    RESULT_ENSURE(key != NULL, S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
-
     /* Generate unique per-ticket encryption key */
     struct s2n_unique_ticket_key ticket_key = { 0 };
     RESULT_GUARD_POSIX(s2n_blob_init(&ticket_key.initial_key, key->aes_key, sizeof(key->aes_key)));
@@ -831,6 +990,7 @@ S2N_RESULT s2n_resume_encrypt_session_ticket(struct s2n_connection *conn,
     RESULT_GUARD_POSIX(s2n_blob_init(&info_blob, ticket_key.info, sizeof(ticket_key.info)));
     RESULT_GUARD(s2n_get_public_random_data(&info_blob));
     RESULT_GUARD(s2n_resume_generate_unique_ticket_key(&ticket_key));
+    RESULT_GUARD(s2n_get_public_random_data(iv));
 
     /* Initialize AES key */
     struct s2n_blob aes_key_blob = { 0 };
@@ -840,6 +1000,49 @@ S2N_RESULT s2n_resume_encrypt_session_ticket(struct s2n_connection *conn,
     RESULT_GUARD(s2n_aes256_gcm.init(&aes_ticket_key));
     RESULT_GUARD(s2n_aes256_gcm.set_encryption_key(&aes_ticket_key, &aes_key_blob));
 
+    RESULT_GUARD_POSIX(s2n_aes256_gcm.io.aead.encrypt(&aes_ticket_key, iv, aad, state, state));
+    RESULT_CHECKED_MEMCPY(info, ticket_key.info, S2N_TICKET_INFO_SIZE);
+
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_resume_decrypt_with_unique_key(struct s2n_ticket_key *key, const uint8_t info[S2N_TICKET_INFO_SIZE],
+        struct s2n_blob *iv, struct s2n_blob *aad, struct s2n_blob *state)
+{
+    struct s2n_unique_ticket_key ticket_key = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&ticket_key.initial_key, key->aes_key, sizeof(key->aes_key)));
+    RESULT_CHECKED_MEMCPY(ticket_key.info, info, sizeof(ticket_key.info));
+    RESULT_GUARD(s2n_resume_generate_unique_ticket_key(&ticket_key));
+
+    /* Initialize AES key */
+    struct s2n_blob aes_key_blob = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&aes_key_blob, ticket_key.output_key, sizeof(ticket_key.output_key)));
+    DEFER_CLEANUP(struct s2n_session_key aes_ticket_key = { 0 }, s2n_session_key_free);
+    RESULT_GUARD_POSIX(s2n_session_key_alloc(&aes_ticket_key));
+    RESULT_GUARD(s2n_aes256_gcm.init(&aes_ticket_key));
+    RESULT_GUARD(s2n_aes256_gcm.set_decryption_key(&aes_ticket_key, &aes_key_blob));
+
+    RESULT_GUARD_POSIX(s2n_aes256_gcm.io.aead.decrypt(&aes_ticket_key, iv, aad, state, state));
+
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_ticket_key_init_aad(struct s2n_ticket_key *key, struct s2n_blob *aad_blob)
+{
+    struct s2n_stuffer aad = { 0 };
+    RESULT_GUARD_POSIX(s2n_stuffer_init(&aad, aad_blob));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(&aad, key->implicit_aad, sizeof(key->implicit_aad)));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(&aad, key->key_name, sizeof(key->key_name)));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_ticket_key_encrypt_locked(struct s2n_config *config, const uint8_t key_name[S2N_TICKET_KEY_NAME_LEN],
+        uint8_t info[S2N_TICKET_INFO_SIZE], struct s2n_blob *iv, struct s2n_blob *state)
+{
+    struct s2n_ticket_key *key = NULL;
+    RESULT_GUARD(s2n_ticket_key_find_locked(config, key_name, &key));
+    RESULT_ENSURE(key != NULL, S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
+
     /* Ensure we never encrypt with a zero-filled key */
     uint8_t zero_block[S2N_AES256_KEY_LEN] = { 0 };
     RESULT_ENSURE(!s2n_constant_time_equals(key->aes_key, zero_block, S2N_AES256_KEY_LEN),
@@ -849,32 +1052,74 @@ S2N_RESULT s2n_resume_encrypt_session_ticket(struct s2n_connection *conn,
     uint8_t aad_data[S2N_TICKET_AAD_LEN] = { 0 };
     struct s2n_blob aad_blob = { 0 };
     RESULT_GUARD_POSIX(s2n_blob_init(&aad_blob, aad_data, sizeof(aad_data)));
-    struct s2n_stuffer aad = { 0 };
-    RESULT_GUARD_POSIX(s2n_stuffer_init(&aad, &aad_blob));
-    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(&aad, key->implicit_aad, sizeof(key->implicit_aad)));
-    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(&aad, key->key_name, sizeof(key->key_name)));
+    RESULT_GUARD(s2n_ticket_key_init_aad(key, &aad_blob));
+
+    if (config->cache_ticket_keys) {
+        RESULT_GUARD(s2n_ticket_key_cache_encrypt(key, info, iv, &aad_blob, state));
+    } else {
+        RESULT_GUARD(s2n_resume_encrypt_with_unique_key(key, info, iv, &aad_blob, state));
+    }
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_ticket_key_decrypt_locked(struct s2n_config *config, const uint8_t key_name[S2N_TICKET_KEY_NAME_LEN],
+        uint64_t now, const uint8_t info[S2N_TICKET_INFO_SIZE], struct s2n_blob *iv, struct s2n_blob *state)
+{
+    struct s2n_ticket_key *key = NULL;
+    RESULT_GUARD(s2n_ticket_key_find_unexpired_locked(config, key_name, now, &key));
+    /* Key has expired; do full handshake */
+    RESULT_ENSURE(key != NULL, S2N_ERR_KEY_USED_IN_SESSION_TICKET_NOT_FOUND);
+
+    /* Initialize Additional Authenticated Data */
+    uint8_t aad_data[S2N_TICKET_AAD_LEN] = { 0 };
+    struct s2n_blob aad_blob = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&aad_blob, aad_data, sizeof(aad_data)));
+    RESULT_GUARD(s2n_ticket_key_init_aad(key, &aad_blob));
+
+    if (config->cache_ticket_keys) {
+        RESULT_GUARD(s2n_ticket_key_cache_decrypt(key, info, iv, &aad_blob, state));
+    } else {
+        RESULT_GUARD(s2n_resume_decrypt_with_unique_key(key, info, iv, &aad_blob, state));
+    }
+    return S2N_RESULT_OK;
+}
+
+/* The ticket key is found by name and only used while holding the index lock,
+ * so that s2n_config_add_ticket_crypto_key can't remove it in the meantime.
+ */
+S2N_RESULT s2n_resume_encrypt_session_ticket(struct s2n_connection *conn,
+        const uint8_t key_name[S2N_TICKET_KEY_NAME_LEN], struct s2n_stuffer *to)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(conn->config);
+    RESULT_ENSURE_REF(to);
+
+    RESULT_ENSURE(key_name != NULL, S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
+    struct s2n_ticket_key_index *index = conn->config->ticket_key_index;
+    RESULT_ENSURE(index != NULL, S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
 
     /* Write version number */
     RESULT_GUARD_POSIX(s2n_stuffer_write_uint8(to, S2N_PRE_ENCRYPTED_STATE_V1));
 
     /* Write key name */
-    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(to, key->key_name, sizeof(key->key_name)));
-
-    /* Write parameter needed to generate unique ticket key */
-    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(to, ticket_key.info, sizeof(ticket_key.info)));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(to, key_name, S2N_TICKET_KEY_NAME_LEN));
 
-    /* Write IV */
-    uint8_t iv_data[S2N_TLS_GCM_IV_LEN] = { 0 };
-    struct s2n_blob iv = { 0 };
-    RESULT_GUARD_POSIX(s2n_blob_init(&iv, iv_data, sizeof(iv_data)));
-    RESULT_GUARD(s2n_get_public_random_data(&iv));
-    RESULT_GUARD_POSIX(s2n_stuffer_write(to, &iv));
+    /* Reserve space for the parameter needed to generate the unique ticket key and the IV.
+     * Both are only known once the state is encrypted.
+     */
+    uint32_t info_offset = to->write_cursor;
+    RESULT_GUARD_POSIX(s2n_stuffer_skip_write(to, S2N_TICKET_INFO_SIZE + S2N_TLS_GCM_IV_LEN));
 
     /* Write serialized session state */
     uint32_t plaintext_state_size = s2n_stuffer_data_available(to);
     RESULT_GUARD(s2n_serialize_resumption_state(conn, to));
     RESULT_GUARD_POSIX(s2n_stuffer_skip_write(to, S2N_TLS_GCM_TAG_LEN));
 
+    /* The stuffer may have been resized, so only take pointers into it now */
+    uint8_t *info = to->blob.data + info_offset;
+    struct s2n_blob iv = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&iv, info + S2N_TICKET_INFO_SIZE, S2N_TLS_GCM_IV_LEN));
+
     /* Initialize blob to be encrypted */
     struct s2n_blob state_blob = { 0 };
     struct s2n_stuffer copy_for_encryption = *to;
@@ -884,9 +1129,11 @@ S2N_RESULT s2n_resume_encrypt_session_ticket(struct s2n_connection *conn,
     RESULT_ENSURE_REF(state_blob_data);
     RESULT_GUARD_POSIX(s2n_blob_init(&state_blob, state_blob_data, state_blob_size));
 
-    RESULT_GUARD_POSIX(s2n_aes256_gcm.io.aead.encrypt(&aes_ticket_key, &iv, &aad_blob, &state_blob, &state_blob));
+    RESULT_ENSURE_EQ(pthread_rwlock_rdlock(&index->lock), 0);
+    s2n_result result = s2n_ticket_key_encrypt_locked(conn->config, key_name, info, &iv, &state_blob);
+    RESULT_ENSURE_EQ(pthread_rwlock_unlock(&index->lock), 0);
 
-    return S2N_RESULT_OK;
+    return result;
 }
 
 S2N_RESULT s2n_resume_decrypt_session(struct s2n_connection *conn, struct s2n_stuffer *from)
@@ -895,6 +1142,9 @@ S2N_RESULT s2n_resume_decrypt_session(struct s2n_connection *conn, struct s2n_st
     RESULT_ENSURE_REF(from);
     RESULT_ENSURE_REF(conn->config);
 
+    uint64_t now = 0;
+    RESULT_GUARD(s2n_config_wall_clock(conn->config, &now));
+
     /* Read version number */
     uint8_t version = 0;
     RESULT_GUARD_POSIX(s2n_stuffer_read_uint8(from, &version));
@@ -903,15 +1153,12 @@ S2N_RESULT s2n_resume_decrypt_session(struct s2n_connection *conn, struct s2n_st
     /* Read key name */
     uint8_t key_name[S2N_TICKET_KEY_NAME_LEN] = { 0 };
     RESULT_GUARD_POSIX(s2n_stuffer_read_bytes(from, key_name, sizeof(key_name)));
+    struct s2n_ticket_key_index *index = conn->config->ticket_key_index;
+    RESULT_ENSURE(index != NULL, S2N_ERR_KEY_USED_IN_SESSION_TICKET_NOT_FOUND);
 
-    struct s2n_ticket_key *key = s2n_find_ticket_key(conn->config, key_name);
-    /* Key has expired; do full handshake */
-    RESULT_ENSURE(key != NULL, S2N_ERR_KEY_USED_IN_SESSION_TICKET_NOT_FOUND);
-
-    struct s2n_unique_ticket_key ticket_key = { 0 };
-    RESULT_GUARD_POSIX(s2n_blob_init(&ticket_key.initial_key, key->aes_key, sizeof(key->aes_key)));
-    RESULT_GUARD_POSIX(s2n_stuffer_read_bytes(from, ticket_key.info, sizeof(ticket_key.info)));
-    RESULT_GUARD(s2n_resume_generate_unique_ticket_key(&ticket_key));
+    /* Read parameter needed to generate unique ticket key */
+    uint8_t info[S2N_TICKET_INFO_SIZE] = { 0 };
+    RESULT_GUARD_POSIX(s2n_stuffer_read_bytes(from, info, sizeof(info)));
 
     /* Read IV */
     uint8_t iv_data[S2N_TLS_GCM_IV_LEN] = { 0 };
@@ -919,23 +1166,6 @@ S2N_RESULT s2n_resume_decrypt_session(struct s2n_connection *conn, struct s2n_st
     RESULT_GUARD_POSIX(s2n_blob_init(&iv, iv_data, sizeof(iv_data)));
     RESULT_GUARD_POSIX(s2n_stuffer_read(from, &iv));
 
-    /* Initialize AES key */
-    struct s2n_blob aes_key_blob = { 0 };
-    RESULT_GUARD_POSIX(s2n_blob_init(&aes_key_blob, ticket_key.output_key, sizeof(ticket_key.output_key)));
-    DEFER_CLEANUP(struct s2n_session_key aes_ticket_key = { 0 }, s2n_session_key_free);
-    RESULT_GUARD_POSIX(s2n_session_key_alloc(&aes_ticket_key));
-    RESULT_GUARD(s2n_aes256_gcm.init(&aes_ticket_key));
-    RESULT_GUARD(s2n_aes256_gcm.set_decryption_key(&aes_ticket_key, &aes_key_blob));
-
-    /* Initialize Additional Authenticated Data */
-    uint8_t aad_data[S2N_TICKET_AAD_LEN] = { 0 };
-    struct s2n_blob aad_blob = { 0 };
-    RESULT_GUARD_POSIX(s2n_blob_init(&aad_blob, aad_data, sizeof(aad_data)));
-    struct s2n_stuffer aad = { 0 };
-    RESULT_GUARD_POSIX(s2n_stuffer_init(&aad, &aad_blob));
-    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(&aad, key->implicit_aad, sizeof(key->implicit_aad)));
-    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(&aad, key->key_name, sizeof(key->key_name)));
-
     /* Initialize blob to be decrypted */
     struct s2n_blob en_blob = { 0 };
     uint32_t en_blob_size = s2n_stuffer_data_available(from);
@@ -943,7 +1173,11 @@ S2N_RESULT s2n_resume_decrypt_session(struct s2n_connection *conn, struct s2n_st
     RESULT_ENSURE_REF(en_blob_data);
     RESULT_GUARD_POSIX(s2n_blob_init(&en_blob, en_blob_data, en_blob_size));
 
-    RESULT_GUARD_POSIX(s2n_aes256_gcm.io.aead.decrypt(&aes_ticket_key, &iv, &aad_blob, &en_blob, &en_blob));
+    /* The key is found and used while holding the index lock, so that it can't be removed in the meantime */
+    RESULT_ENSURE_EQ(pthread_rwlock_rdlock(&index->lock), 0);
+    s2n_result result = s2n_ticket_key_decrypt_locked(conn->config, key_name, now, info, &iv, &en_blob);
+    RESULT_ENSURE_EQ(pthread_rwlock_unlock(&index->lock), 0);
+    RESULT_GUARD(result);
 
     /* Parse decrypted state */
     struct s2n_blob state_blob = { 0 };
@@ -957,8 +1191,7 @@ S2N_RESULT s2n_resume_decrypt_session(struct s2n_connection *conn, struct s2n_st
     return S2N_RESULT_OK;
 }
 
-/* This function is used to remove all or just one expired key from server config */
-int s2n_config_wipe_expired_ticket_crypto_keys(struct s2n_config *config, int8_t expired_key_index)
+static S2N_RESULT s2n_config_wipe_expired_ticket_crypto_keys_locked(struct s2n_config *config, int8_t expired_key_index)
 {
     int num_of_expired_keys = 0;
     int expired_keys_index[S2N_MAX_TICKET_KEYS];
@@ -972,13 +1205,12 @@ int s2n_config_wipe_expired_ticket_crypto_keys(struct s2n_config *config, int8_t
     }
 
     uint64_t now = 0;
-    POSIX_GUARD_RESULT(s2n_config_wall_clock(config, &now));
-    POSIX_ENSURE_REF(config->ticket_keys);
+    RESULT_GUARD(s2n_config_wall_clock(config, &now));
 
     uint32_t ticket_keys_len = 0;
-    POSIX_GUARD_RESULT(s2n_array_num_elements(config->ticket_keys, &ticket_keys_len));
+    RESULT_GUARD(s2n_array_num_elements(config->ticket_keys, &ticket_keys_len));
     for (uint32_t i = 0; i < ticket_keys_len; i++) {
-        POSIX_GUARD_RESULT(s2n_array_get(config->ticket_keys, i, (void **) &ticket_key));
+        RESULT_GUARD(s2n_array_get(config->ticket_keys, i, (void **) &ticket_key));
         if (now >= ticket_key->intro_timestamp
                         + config->encrypt_decrypt_key_lifetime_in_nanos
                         + config->decrypt_key_lifetime_in_nanos) {
@@ -989,28 +1221,71 @@ int s2n_config_wipe_expired_ticket_crypto_keys(struct s2n_config *config, int8_t
 
 end:
     for (int j = 0; j < num_of_expired_keys; j++) {
-        POSIX_GUARD_RESULT(s2n_array_remove(config->ticket_keys, expired_keys_index[j] - j));
+        RESULT_GUARD(s2n_array_get(config->ticket_keys, expired_keys_index[j] - j, (void **) &ticket_key));
+        RESULT_GUARD(s2n_ticket_key_cache_free(ticket_key));
+        RESULT_GUARD(s2n_array_remove(config->ticket_keys, expired_keys_index[j] - j));
+    }
+
+    if (num_of_expired_keys > 0) {
+        RESULT_GUARD(s2n_ticket_key_index_rebuild_locked(config));
     }
 
+    return S2N_RESULT_OK;
+}
+
+/* This function is used to remove all or just one expired key from server config.
+ *
+ * Handshakes only use a key while holding the index read lock, so keys are removed
+ * and their caches freed while holding the write lock.
+ */
+int s2n_config_wipe_expired_ticket_crypto_keys(struct s2n_config *config, int8_t expired_key_index)
+{
+    POSIX_ENSURE_REF(config);
+    POSIX_ENSURE_REF(config->ticket_keys);
+    struct s2n_ticket_key_index *index = config->ticket_key_index;
+    POSIX_ENSURE_REF(index);
+
+    POSIX_ENSURE_EQ(pthread_rwlock_wrlock(&index->lock), 0);
+    s2n_result result = s2n_config_wipe_expired_ticket_crypto_keys_locked(config, expired_key_index);
+    POSIX_ENSURE_EQ(pthread_rwlock_unlock(&index->lock), 0);
+    POSIX_GUARD_RESULT(result);
+
     return 0;
 }
 
-int s2n_config_store_ticket_key(struct s2n_config *config, struct s2n_ticket_key *key)
+static S2N_RESULT s2n_config_store_ticket_key_locked(struct s2n_config *config, struct s2n_ticket_key *key)
 {
     uint32_t ticket_keys_len = 0;
-    POSIX_GUARD_RESULT(s2n_array_num_elements(config->ticket_keys, &ticket_keys_len));
+    RESULT_GUARD(s2n_array_num_elements(config->ticket_keys, &ticket_keys_len));
 
     /* The ticket key name and secret must both be unique. */
     for (uint32_t i = 0; i < ticket_keys_len; i++) {
         struct s2n_ticket_key *other_key = NULL;
-        POSIX_GUARD_RESULT(s2n_array_get(config->ticket_keys, i, (void **) &other_key));
-        POSIX_ENSURE(!s2n_constant_time_equals(key->key_name, other_key->key_name, s2n_array_len(key->key_name)),
+        RESULT_GUARD(s2n_array_get(config->ticket_keys, i, (void **) &other_key));
+        RESULT_ENSURE(!s2n_constant_time_equals(key->key_name, other_key->key_name, s2n_array_len(key->key_name)),
                 S2N_ERR_INVALID_TICKET_KEY_NAME_OR_NAME_LENGTH);
-        POSIX_ENSURE(!s2n_constant_time_equals(key->aes_key, other_key->aes_key, s2n_array_len(key->aes_key)),
+        RESULT_ENSURE(!s2n_constant_time_equals(key->aes_key, other_key->aes_key, s2n_array_len(key->aes_key)),
                 S2N_ERR_TICKET_KEY_NOT_UNIQUE);
     }
 
-    POSIX_GUARD_RESULT(s2n_array_insert_and_copy(config->ticket_keys, ticket_keys_len, key));
+    RESULT_GUARD(s2n_array_insert_and_copy(config->ticket_keys, ticket_keys_len, key));
+    RESULT_GUARD(s2n_ticket_key_index_rebuild_locked(config));
+    return S2N_RESULT_OK;
+}
+
+int s2n_config_store_ticket_key(struct s2n_config *config, struct s2n_ticket_key *key)
+{
+    POSIX_ENSURE_REF(config);
+    POSIX_ENSURE_REF(config->ticket_keys);
+    POSIX_ENSURE_REF(key);
+    struct s2n_ticket_key_index *index = config->ticket_key_index;
+    POSIX_ENSURE_REF(index);
+
+    POSIX_ENSURE_EQ(pthread_rwlock_wrlock(&index->lock), 0);
+    s2n_result result = s2n_config_store_ticket_key_locked(config, key);
+    POSIX_ENSURE_EQ(pthread_rwlock_unlock(&index->lock), 0);
+    POSIX_GUARD_RESULT(result);
+
     return S2N_SUCCESS;
 }
 
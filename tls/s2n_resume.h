@@ -53,17 +53,22 @@
 
 struct s2n_connection;
 struct s2n_config;
+struct s2n_ticket_key_cache;
+struct s2n_ticket_key_index;
 
 struct s2n_ticket_key {
     unsigned char key_name[S2N_TICKET_KEY_NAME_LEN];
     uint8_t aes_key[S2N_AES256_KEY_LEN];
     uint8_t implicit_aad[S2N_TICKET_AAD_IMPLICIT_LEN];
     uint64_t intro_timestamp;
+    /* Initialized AES-GCM contexts, if ticket key caching is enabled */
+    struct s2n_ticket_key_cache *cache;
 };
 
-struct s2n_ticket_key_weight {
-    double key_weight;
-    uint8_t key_index;
+struct s2n_unique_ticket_key {
+    struct s2n_blob initial_key;
+    uint8_t info[S2N_TICKET_INFO_SIZE];
+    uint8_t output_key[S2N_AES256_KEY_LEN];
 };
 
 struct s2n_ticket_fields {
@@ -78,12 +83,18 @@ struct s2n_session_ticket {
 
 struct s2n_ticket_key *s2n_find_ticket_key(struct s2n_config *config, const uint8_t name[S2N_TICKET_KEY_NAME_LEN]);
 struct s2n_ticket_key *s2n_get_ticket_encrypt_decrypt_key(struct s2n_config *config);
-S2N_RESULT s2n_resume_encrypt_session_ticket(struct s2n_connection *conn, struct s2n_ticket_key *key, struct s2n_stuffer *to);
+S2N_RESULT s2n_resume_generate_unique_ticket_key(struct s2n_unique_ticket_key *key);
+S2N_RESULT s2n_resume_encrypt_session_ticket(struct s2n_connection *conn, const uint8_t key_name[S2N_TICKET_KEY_NAME_LEN],
+        struct s2n_stuffer *to);
 S2N_RESULT s2n_resume_decrypt_session(struct s2n_connection *conn, struct s2n_stuffer *from);
+S2N_RESULT s2n_config_select_ticket_encrypt_key(struct s2n_config *config, uint8_t key_name[S2N_TICKET_KEY_NAME_LEN],
+        uint64_t *intro_timestamp);
 S2N_RESULT s2n_config_is_encrypt_key_available(struct s2n_config *config);
 int s2n_verify_unique_ticket_key(struct s2n_config *config, uint8_t *hash, uint16_t *insert_index);
 int s2n_config_wipe_expired_ticket_crypto_keys(struct s2n_config *config, int8_t expired_key_index);
 int s2n_config_store_ticket_key(struct s2n_config *config, struct s2n_ticket_key *key);
+S2N_RESULT s2n_ticket_key_index_new(struct s2n_ticket_key_index **index);
+S2N_RESULT s2n_ticket_key_index_free(struct s2n_ticket_key_index **index);
 
 typedef enum {
     S2N_STATE_WITH_SESSION_ID = 0,
@@ -15,7 +15,11 @@
 
 #include "tls/s2n_security_policies.h"
 
+#include <ctype.h>
+#include <strings.h>
+
 #include "api/s2n.h"
+#include "api/unstable/policy.h"
 #include "crypto/s2n_pq.h"
 #include "tls/s2n_certificate_keys.h"
 #include "tls/s2n_connection.h"
@@ -1631,11 +1635,109 @@ const char *deprecated_security_policies[] = {
 };
 const size_t deprecated_security_policies_len = s2n_array_len(deprecated_security_policies);
 
+/* Hash index over the names in security_policy_selection and deprecated_security_policies,
+ * so that resolving a name doesn't require comparing it against every policy name.
+ *
+ * Slots are probed linearly. A slot holds one more than an index into security_policy_selection,
+ * or into deprecated_security_policies if S2N_POLICY_INDEX_DEPRECATED is set. Zero marks an empty slot.
+ */
+#define S2N_POLICY_INDEX_DEPRECATED 0x8000
+/* security_policy_selection ends with an empty entry, which isn't indexed */
+#define S2N_POLICY_COUNT (s2n_array_len(security_policy_selection) - 1 + s2n_array_len(deprecated_security_policies))
+/* Keep the index at most half full so that probe sequences stay short */
+#define S2N_POLICY_INDEX_SIZE (S2N_POLICY_COUNT * 2)
+
+static uint16_t s2n_security_policy_index[S2N_POLICY_INDEX_SIZE] = { 0 };
+static bool s2n_security_policy_index_ready = false;
+
+/* Case-insensitive FNV-1a, since policy names are matched case-insensitively */
+static uint32_t s2n_security_policy_name_hash(const char *name)
+{
+    uint32_t hash = 2166136261u;
+    for (const char *c = name; *c != '\0'; c++) {
+        hash ^= (uint8_t) tolower((unsigned char) *c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static const char *s2n_security_policy_index_name(uint16_t entry)
+{
+    uint16_t i = (entry & ~S2N_POLICY_INDEX_DEPRECATED) - 1;
+    if (entry & S2N_POLICY_INDEX_DEPRECATED) {
+        return deprecated_security_policies[i];
+    }
+    return security_policy_selection[i].version;
+}
+
+static S2N_RESULT s2n_security_policy_index_add(const char *name, uint16_t entry)
+{
+    RESULT_ENSURE_REF(name);
+    uint32_t slot = s2n_security_policy_name_hash(name) % S2N_POLICY_INDEX_SIZE;
+    for (size_t probes = 0; probes < S2N_POLICY_INDEX_SIZE; probes++) {
+        uint16_t existing = s2n_security_policy_index[slot];
+        if (existing == 0) {
+            s2n_security_policy_index[slot] = entry;
+            return S2N_RESULT_OK;
+        }
+        /* Like a linear search, the first policy with a given name wins */
+        if (strcasecmp(name, s2n_security_policy_index_name(existing)) == 0) {
+            return S2N_RESULT_OK;
+        }
+        slot = (slot + 1) % S2N_POLICY_INDEX_SIZE;
+    }
+    RESULT_BAIL(S2N_ERR_SAFETY);
+}
+
+static S2N_RESULT s2n_security_policy_index_init(void)
+{
+    s2n_security_policy_index_ready = false;
+    memset(s2n_security_policy_index, 0, sizeof(s2n_security_policy_index));
+
+    const size_t selection_len = s2n_array_len(security_policy_selection) - 1;
+    RESULT_ENSURE_EQ(security_policy_selection[selection_len].version, NULL);
+    /* Every entry, and so every policy's position in either list, must fit below the deprecated flag */
+    RESULT_ENSURE_LT(S2N_POLICY_INDEX_SIZE, S2N_POLICY_INDEX_DEPRECATED);
+
+    for (size_t i = 0; i < selection_len; i++) {
+        RESULT_GUARD(s2n_security_policy_index_add(security_policy_selection[i].version, i + 1));
+    }
+    for (size_t i = 0; i < deprecated_security_policies_len; i++) {
+        RESULT_GUARD(s2n_security_policy_index_add(deprecated_security_policies[i],
+                S2N_POLICY_INDEX_DEPRECATED | (i + 1)));
+    }
+
+    s2n_security_policy_index_ready = true;
+    return S2N_RESULT_OK;
+}
+
+static int s2n_find_security_policy_from_index(const char *version, const struct s2n_security_policy **security_policy)
+{
+    uint32_t slot = s2n_security_policy_name_hash(version) % S2N_POLICY_INDEX_SIZE;
+    for (size_t probes = 0; probes < S2N_POLICY_INDEX_SIZE; probes++) {
+        uint16_t entry = s2n_security_policy_index[slot];
+        if (entry == 0) {
+            break;
+        }
+        if (strcasecmp(version, s2n_security_policy_index_name(entry)) == 0) {
+            POSIX_ENSURE(!(entry & S2N_POLICY_INDEX_DEPRECATED), S2N_ERR_DEPRECATED_SECURITY_POLICY);
+            *security_policy = security_policy_selection[entry - 1].security_policy;
+            return S2N_SUCCESS;
+        }
+        slot = (slot + 1) % S2N_POLICY_INDEX_SIZE;
+    }
+    POSIX_BAIL(S2N_ERR_INVALID_SECURITY_POLICY);
+}
+
 int s2n_find_security_policy_from_version(const char *version, const struct s2n_security_policy **security_policy)
 {
     POSIX_ENSURE_REF(version);
     POSIX_ENSURE_REF(security_policy);
 
+    if (s2n_security_policy_index_ready) {
+        return s2n_find_security_policy_from_index(version, security_policy);
+    }
+
     for (int i = 0; security_policy_selection[i].version != NULL; i++) {
         if (!strcasecmp(version, security_policy_selection[i].version)) {
             *security_policy = security_policy_selection[i].security_policy;
@@ -1776,6 +1878,8 @@ int s2n_security_policies_init()
             POSIX_ENSURE(!result.found_error, S2N_ERR_INVALID_SECURITY_POLICY);
         }
     }
+
+    POSIX_GUARD_RESULT(s2n_security_policy_index_init());
     return 0;
 }
 
@@ -31,6 +31,7 @@
 #include "utils/s2n_blob.h"
 #include "utils/s2n_io.h"
 #include "utils/s2n_safety.h"
+#include "utils/s2n_usdt.h"
 
 /*
  * Determine whether there is currently sufficient space in the send buffer to construct
@@ -86,12 +87,19 @@ int s2n_flush(struct s2n_connection *conn, s2n_blocked_status *blocked)
     POSIX_ENSURE_REF(conn);
     POSIX_ENSURE_REF(blocked);
     *blocked = S2N_BLOCKED_ON_WRITE;
+    conn->stats.flushes++;
 
     /* Write any data that's already pending */
     while (s2n_stuffer_data_available(&conn->out)) {
         errno = 0;
         int w = s2n_connection_send_stuffer(&conn->out, conn, s2n_stuffer_data_available(&conn->out));
-        POSIX_GUARD_RESULT(s2n_io_check_write_result(w));
+        conn->stats.write_calls++;
+        s2n_result result = s2n_io_check_write_result(w);
+        if (s2n_result_is_error(result) && s2n_errno == S2N_ERR_IO_BLOCKED) {
+            conn->stats.write_blocked++;
+            S2N_USDT_PROBE2(io_blocked, conn, S2N_BLOCKED_ON_WRITE);
+        }
+        POSIX_GUARD_RESULT(result);
         conn->wire_bytes_out += w;
     }
     POSIX_GUARD(s2n_stuffer_rewrite(&conn->out));
@@ -16,6 +16,7 @@
 #include "api/s2n.h"
 #include "error/s2n_errno.h"
 #include "tls/s2n_auth_selection.h"
+#include "tls/s2n_cert_compression.h"
 #include "tls/s2n_cipher_suites.h"
 #include "tls/s2n_tls.h"
 #include "utils/s2n_safety.h"
@@ -27,16 +28,26 @@ int s2n_server_cert_recv(struct s2n_connection *conn)
      */
     struct s2n_stuffer in = conn->handshake.io;
 
+    /* A CompressedCertificate message is parsed from the decompressed Certificate message.
+     * Decompression is repeated if the handler is re-entered.
+     */
+    DEFER_CLEANUP(struct s2n_stuffer decompressed = { 0 }, s2n_stuffer_free);
+    struct s2n_stuffer *certificate = &in;
+    if (conn->handshake.compressed_certificate) {
+        POSIX_GUARD_RESULT(s2n_compressed_cert_recv(conn, &in, &decompressed));
+        certificate = &decompressed;
+    }
+
     if (conn->actual_protocol_version == S2N_TLS13) {
         uint8_t certificate_request_context_len = 0;
-        POSIX_GUARD(s2n_stuffer_read_uint8(&in, &certificate_request_context_len));
+        POSIX_GUARD(s2n_stuffer_read_uint8(certificate, &certificate_request_context_len));
         S2N_ERROR_IF(certificate_request_context_len != 0, S2N_ERR_BAD_MESSAGE);
     }
 
     uint32_t size_of_all_certificates = 0;
-    POSIX_GUARD(s2n_stuffer_read_uint24(&in, &size_of_all_certificates));
+    POSIX_GUARD(s2n_stuffer_read_uint24(certificate, &size_of_all_certificates));
 
-    S2N_ERROR_IF(size_of_all_certificates > s2n_stuffer_data_available(&in) || size_of_all_certificates < 3,
+    S2N_ERROR_IF(size_of_all_certificates > s2n_stuffer_data_available(certificate) || size_of_all_certificates < 3,
             S2N_ERR_BAD_MESSAGE);
 
     s2n_cert_public_key public_key;
@@ -45,7 +56,7 @@ int s2n_server_cert_recv(struct s2n_connection *conn)
     s2n_pkey_type actual_cert_pkey_type;
     struct s2n_blob cert_chain = { 0 };
     cert_chain.size = size_of_all_certificates;
-    cert_chain.data = s2n_stuffer_raw_read(&in, size_of_all_certificates);
+    cert_chain.data = s2n_stuffer_raw_read(certificate, size_of_all_certificates);
     POSIX_ENSURE_REF(cert_chain.data);
 
     POSIX_GUARD_RESULT(s2n_x509_validator_validate_cert_chain(&conn->x509_validator, conn, cert_chain.data,
@@ -64,6 +75,11 @@ int s2n_server_cert_recv(struct s2n_connection *conn)
 int s2n_server_cert_send(struct s2n_connection *conn)
 {
     S2N_ERROR_IF(conn->handshake_params.our_chain_and_key == NULL, S2N_ERR_CERT_TYPE_UNSUPPORTED);
+    if (s2n_cert_compression_is_negotiated(conn)) {
+        POSIX_GUARD_RESULT(s2n_compressed_cert_send(conn, &conn->handshake.io));
+        return S2N_SUCCESS;
+    }
+
     if (conn->actual_protocol_version == S2N_TLS13) {
         /* server's certificate request context should always be of zero length */
         /* https://tools.ietf.org/html/rfc8446#section-4.4.2 */
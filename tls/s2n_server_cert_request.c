@@ -224,6 +224,9 @@ int s2n_cert_req_recv(struct s2n_connection *conn)
      */
     POSIX_GUARD(s2n_set_cert_chain_as_client(conn));
 
+    /* The hash for our CertificateVerify is known now. Minimize required handshake hash algs */
+    POSIX_GUARD(s2n_conn_update_required_handshake_hashes(conn));
+
     return 0;
 }
 
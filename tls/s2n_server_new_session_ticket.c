@@ -163,11 +163,12 @@ S2N_RESULT s2n_server_nst_write(struct s2n_connection *conn, uint32_t *lifetime_
     struct s2n_stuffer output = { 0 };
     RESULT_GUARD_POSIX(s2n_stuffer_init(&output, session_ticket));
 
-    struct s2n_ticket_key *key = s2n_get_ticket_encrypt_decrypt_key(conn->config);
-    RESULT_ENSURE(key != NULL, S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
+    uint8_t key_name[S2N_TICKET_KEY_NAME_LEN] = { 0 };
+    uint64_t key_intro_timestamp = 0;
+    RESULT_GUARD(s2n_config_select_ticket_encrypt_key(conn->config, key_name, &key_intro_timestamp));
 
-    RESULT_GUARD(s2n_generate_ticket_lifetime(conn, key->intro_timestamp, lifetime_hint_in_secs));
-    RESULT_GUARD(s2n_resume_encrypt_session_ticket(conn, key, &output));
+    RESULT_GUARD(s2n_generate_ticket_lifetime(conn, key_intro_timestamp, lifetime_hint_in_secs));
+    RESULT_GUARD(s2n_resume_encrypt_session_ticket(conn, key_name, &output));
 
     return S2N_RESULT_OK;
 }
@@ -303,8 +304,9 @@ S2N_RESULT s2n_tls13_server_nst_write(struct s2n_connection *conn, struct s2n_st
     RESULT_ENSURE_REF(conn);
     RESULT_ENSURE_REF(output);
 
-    struct s2n_ticket_key *key = s2n_get_ticket_encrypt_decrypt_key(conn->config);
-    RESULT_ENSURE(key != NULL, S2N_ERR_NO_TICKET_ENCRYPT_DECRYPT_KEY);
+    uint8_t key_name[S2N_TICKET_KEY_NAME_LEN] = { 0 };
+    uint64_t key_intro_timestamp = 0;
+    RESULT_GUARD(s2n_config_select_ticket_encrypt_key(conn->config, key_name, &key_intro_timestamp));
 
     struct s2n_ticket_fields *ticket_fields = &conn->tls13_ticket_fields;
 
@@ -315,7 +317,7 @@ S2N_RESULT s2n_tls13_server_nst_write(struct s2n_connection *conn, struct s2n_st
     RESULT_GUARD_POSIX(s2n_stuffer_reserve_uint24(output, &message_size));
 
     uint32_t ticket_lifetime_in_secs = 0;
-    RESULT_GUARD(s2n_generate_ticket_lifetime(conn, key->intro_timestamp, &ticket_lifetime_in_secs));
+    RESULT_GUARD(s2n_generate_ticket_lifetime(conn, key_intro_timestamp, &ticket_lifetime_in_secs));
 
     RESULT_ENSURE(ticket_lifetime_in_secs > 0, S2N_ERR_ZERO_LIFETIME_TICKET);
     RESULT_GUARD_POSIX(s2n_stuffer_write_uint32(output, ticket_lifetime_in_secs));
@@ -347,7 +349,7 @@ S2N_RESULT s2n_tls13_server_nst_write(struct s2n_connection *conn, struct s2n_st
     /* Write ticket */
     struct s2n_stuffer_reservation ticket_size = { 0 };
     RESULT_GUARD_POSIX(s2n_stuffer_reserve_uint16(output, &ticket_size));
-    RESULT_GUARD(s2n_resume_encrypt_session_ticket(conn, key, output));
+    RESULT_GUARD(s2n_resume_encrypt_session_ticket(conn, key_name, output));
     RESULT_GUARD_POSIX(s2n_stuffer_write_vector_size(&ticket_size));
 
     RESULT_GUARD_POSIX(s2n_extension_list_send(S2N_EXTENSION_LIST_NST, conn, output));
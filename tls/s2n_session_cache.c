@@ -0,0 +1,661 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* force the internal header to be included first, since it modifies _GNU_SOURCE/_POSIX_C_SOURCE */
+/* clang-format off */
+#include "utils/s2n_fork_detection_features.h"
+/* clang-format on */
+
+#include "tls/s2n_session_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "tls/s2n_config.h"
+#include "tls/s2n_connection.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_SESSION_CACHE_ALIGNMENT 64
+#define S2N_SESSION_CACHE_ALIGN(x)  (((x) + S2N_SESSION_CACHE_ALIGNMENT - 1) & ~((uint64_t) S2N_SESSION_CACHE_ALIGNMENT - 1))
+
+#if defined(O_CLOEXEC)
+    #define S2N_SESSION_CACHE_OPEN_FLAGS (O_RDWR | O_CREAT | O_CLOEXEC)
+#else
+    #define S2N_SESSION_CACHE_OPEN_FLAGS (O_RDWR | O_CREAT)
+#endif
+
+struct s2n_session_cache_layout {
+    uint64_t states_offset;
+    uint64_t state_size;
+    uint64_t entries_offset;
+    uint64_t buckets_offset;
+    uint64_t size;
+    uint32_t bucket_count;
+};
+
+static S2N_RESULT s2n_session_cache_layout(uint32_t capacity, uint32_t shard_count, struct s2n_session_cache_layout *layout)
+{
+    RESULT_ENSURE_REF(layout);
+    RESULT_ENSURE(capacity > 0, S2N_ERR_INVALID_ARGUMENT);
+    RESULT_ENSURE(shard_count > 0 && shard_count <= capacity, S2N_ERR_INVALID_ARGUMENT);
+
+    /* At least as many buckets as entries in the largest shard keeps the chains short */
+    uint32_t max_shard_capacity = capacity / shard_count + (capacity % shard_count ? 1 : 0);
+    uint32_t bucket_count = 1;
+    while (bucket_count < max_shard_capacity) {
+        bucket_count *= 2;
+    }
+
+    /* Every term is bounded by a 32-bit count times a small constant, so none of these overflow */
+    layout->bucket_count = bucket_count;
+    layout->states_offset = S2N_SESSION_CACHE_ALIGN(sizeof(struct s2n_session_cache_header));
+    layout->state_size = S2N_SESSION_CACHE_ALIGN(sizeof(struct s2n_session_cache_shard_state));
+    layout->entries_offset = layout->states_offset + layout->state_size * shard_count;
+    layout->buckets_offset = layout->entries_offset + (uint64_t) sizeof(struct s2n_session_cache_entry) * capacity;
+    layout->size = layout->buckets_offset + (uint64_t) sizeof(uint32_t) * bucket_count * shard_count;
+    return S2N_RESULT_OK;
+}
+
+/* Finds the largest capacity whose layout fits in a shared memory region of `size` bytes */
+static S2N_RESULT s2n_session_cache_shm_capacity(uint64_t size, uint32_t *capacity)
+{
+    RESULT_ENSURE_REF(capacity);
+
+    /* Rounding each shard's bucket count up to a power of two costs at most two buckets
+     * per entry plus two buckets per shard.
+     */
+    struct s2n_session_cache_layout minimal = { 0 };
+    RESULT_GUARD(s2n_session_cache_layout(S2N_SHM_SESSION_CACHE_SHARDS, S2N_SHM_SESSION_CACHE_SHARDS, &minimal));
+    uint64_t fixed_size = minimal.entries_offset + sizeof(uint32_t) * 2 * S2N_SHM_SESSION_CACHE_SHARDS;
+    uint64_t entry_size = sizeof(struct s2n_session_cache_entry) + sizeof(uint32_t) * 2;
+    RESULT_ENSURE(size > fixed_size, S2N_ERR_INVALID_ARGUMENT);
+
+    uint64_t estimate = MIN((size - fixed_size) / entry_size, UINT32_MAX);
+    RESULT_ENSURE(estimate >= S2N_SHM_SESSION_CACHE_SHARDS, S2N_ERR_INVALID_ARGUMENT);
+
+    struct s2n_session_cache_layout layout = { 0 };
+    RESULT_GUARD(s2n_session_cache_layout(estimate, S2N_SHM_SESSION_CACHE_SHARDS, &layout));
+    RESULT_ENSURE(layout.size <= size, S2N_ERR_SAFETY);
+
+    *capacity = estimate;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_session_cache_init_region(uint8_t *region, uint64_t size, uint32_t capacity,
+        uint32_t shard_count, bool shared)
+{
+    RESULT_ENSURE_REF(region);
+
+    struct s2n_session_cache_layout layout = { 0 };
+    RESULT_GUARD(s2n_session_cache_layout(capacity, shard_count, &layout));
+    RESULT_ENSURE(layout.size <= size, S2N_ERR_INVALID_ARGUMENT);
+    RESULT_CHECKED_MEMSET(region, 0, layout.size);
+
+    struct s2n_session_cache_header *header = (struct s2n_session_cache_header *) (void *) region;
+    header->version = S2N_SESSION_CACHE_VERSION;
+    header->entry_size = sizeof(struct s2n_session_cache_entry);
+    header->lock_size = sizeof(pthread_mutex_t);
+    header->size = size;
+    header->capacity = capacity;
+    header->shard_count = shard_count;
+    header->bucket_count = layout.bucket_count;
+    RESULT_GUARD(s2n_siphash_key_generate(&header->hash_key));
+
+    pthread_mutexattr_t attr = { 0 };
+    RESULT_ENSURE_EQ(pthread_mutexattr_init(&attr), 0);
+    int rc = 0;
+    if (shared) {
+        rc |= pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#if defined(S2N_ROBUST_MUTEX_SUPPORTED)
+        /* If a process dies while holding a shard lock, the next process to lock it recovers the shard */
+        rc |= pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    }
+    for (uint32_t i = 0; i < shard_count && rc == 0; i++) {
+        struct s2n_session_cache_shard_state *state =
+                (struct s2n_session_cache_shard_state *) (void *) (region + layout.states_offset + layout.state_size * i);
+        rc |= pthread_mutex_init(&state->lock, &attr);
+    }
+    pthread_mutexattr_destroy(&attr);
+    RESULT_ENSURE_EQ(rc, 0);
+
+    /* Only mark the region as a cache once it is fully initialized,
+     * so that a partially initialized file is initialized again instead of used.
+     */
+    header->magic = S2N_SESSION_CACHE_MAGIC;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_session_cache_attach(struct s2n_session_cache *cache, uint8_t *region, uint64_t size)
+{
+    RESULT_ENSURE_REF(cache);
+    RESULT_ENSURE_REF(region);
+    RESULT_ENSURE(size >= sizeof(struct s2n_session_cache_header), S2N_ERR_INVALID_ARGUMENT);
+
+    /* A shared region may have been written by another process, so validate it before use */
+    struct s2n_session_cache_header *header = (struct s2n_session_cache_header *) (void *) region;
+    RESULT_ENSURE(header->magic == S2N_SESSION_CACHE_MAGIC, S2N_ERR_INVALID_ARGUMENT);
+    RESULT_ENSURE(header->version == S2N_SESSION_CACHE_VERSION, S2N_ERR_INVALID_ARGUMENT);
+    RESULT_ENSURE(header->entry_size == sizeof(struct s2n_session_cache_entry), S2N_ERR_INVALID_ARGUMENT);
+    RESULT_ENSURE(header->lock_size == sizeof(pthread_mutex_t), S2N_ERR_INVALID_ARGUMENT);
+    RESULT_ENSURE(header->size == size, S2N_ERR_INVALID_ARGUMENT);
+    struct s2n_session_cache_layout layout = { 0 };
+    RESULT_GUARD(s2n_session_cache_layout(header->capacity, header->shard_count, &layout));
+    RESULT_ENSURE(layout.size <= size, S2N_ERR_INVALID_ARGUMENT);
+    RESULT_ENSURE(layout.bucket_count == header->bucket_count, S2N_ERR_INVALID_ARGUMENT);
+
+    uint32_t shards_size = 0;
+    RESULT_GUARD_POSIX(s2n_mul_overflow(header->shard_count, sizeof(struct s2n_session_cache_shard), &shards_size));
+    RESULT_GUARD_POSIX(s2n_alloc(&cache->shards_mem, shards_size));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&cache->shards_mem));
+    cache->shards = (struct s2n_session_cache_shard *) (void *) cache->shards_mem.data;
+    cache->shard_count = header->shard_count;
+    cache->header = header;
+
+    /* Spread the capacity across the shards, giving the remainder to the first shards */
+    uint32_t base_capacity = header->capacity / header->shard_count;
+    uint32_t remainder = header->capacity % header->shard_count;
+    uint64_t first_entry = 0;
+    for (uint32_t i = 0; i < header->shard_count; i++) {
+        struct s2n_session_cache_shard *shard = &cache->shards[i];
+        shard->capacity = base_capacity + (i < remainder ? 1 : 0);
+        shard->bucket_mask = header->bucket_count - 1;
+        shard->state = (struct s2n_session_cache_shard_state *) (void *) (region + layout.states_offset
+                + layout.state_size * i);
+        shard->entries = (struct s2n_session_cache_entry *) (void *) (region + layout.entries_offset)
+                + first_entry;
+        shard->buckets = (uint32_t *) (void *) (region + layout.buckets_offset) + (uint64_t) header->bucket_count * i;
+        first_entry += shard->capacity;
+    }
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_session_cache_alloc(struct s2n_session_cache **cache)
+{
+    RESULT_ENSURE_REF(cache);
+    RESULT_ENSURE(*cache == NULL, S2N_ERR_SAFETY);
+
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_session_cache)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+
+    *cache = (struct s2n_session_cache *) (void *) mem.data;
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_session_cache_new(uint32_t capacity, uint32_t shard_count, struct s2n_session_cache **cache)
+{
+    RESULT_ENSURE_REF(cache);
+
+    struct s2n_session_cache_layout layout = { 0 };
+    RESULT_GUARD(s2n_session_cache_layout(capacity, shard_count, &layout));
+    RESULT_ENSURE(layout.size <= UINT32_MAX, S2N_ERR_INVALID_ARGUMENT);
+
+    DEFER_CLEANUP(struct s2n_session_cache *new_cache = NULL, s2n_session_cache_ptr_free);
+    RESULT_GUARD(s2n_session_cache_alloc(&new_cache));
+    RESULT_GUARD_POSIX(s2n_alloc(&new_cache->region_mem, layout.size));
+    RESULT_GUARD(s2n_session_cache_init_region(new_cache->region_mem.data, layout.size, capacity, shard_count, false));
+    RESULT_GUARD(s2n_session_cache_attach(new_cache, new_cache->region_mem.data, layout.size));
+
+    *cache = new_cache;
+    new_cache = NULL;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_session_cache_map(const char *path, uint64_t size, void **region)
+{
+    if (path == NULL) {
+        /* Anonymous shared memory is inherited by forked children */
+        void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        RESULT_ENSURE(mapping != MAP_FAILED, S2N_ERR_ALLOC);
+        *region = mapping;
+        return S2N_RESULT_OK;
+    }
+
+    int fd = open(path, S2N_SESSION_CACHE_OPEN_FLAGS, S_IRUSR | S_IWUSR);
+    RESULT_ENSURE(fd >= 0, S2N_ERR_IO);
+
+    /* Processes opening the cache at the same time take turns initializing or validating it */
+    s2n_result result = S2N_RESULT_OK;
+    void *mapping = MAP_FAILED;
+    struct stat st = { 0 };
+    if (flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0) {
+        result = S2N_RESULT_ERROR;
+    } else if (st.st_size == 0 && ftruncate(fd, size) != 0) {
+        result = S2N_RESULT_ERROR;
+    } else if (st.st_size != 0 && (uint64_t) st.st_size != size) {
+        result = S2N_RESULT_ERROR;
+    } else if ((mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        result = S2N_RESULT_ERROR;
+    } else if (((struct s2n_session_cache_header *) mapping)->magic != S2N_SESSION_CACHE_MAGIC) {
+        uint32_t capacity = 0;
+        result = s2n_session_cache_shm_capacity(size, &capacity);
+        if (s2n_result_is_ok(result)) {
+            result = s2n_session_cache_init_region(mapping, size, capacity, S2N_SHM_SESSION_CACHE_SHARDS, true);
+        }
+    }
+    /* The mapping keeps the file description open, so closing the file doesn't release the lock */
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    if (s2n_result_is_error(result) && mapping != MAP_FAILED) {
+        munmap(mapping, size);
+    }
+    RESULT_ENSURE(s2n_result_is_ok(result), S2N_ERR_IO);
+    *region = mapping;
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_session_cache_shm_new(const char *path, uint64_t size, struct s2n_session_cache **cache)
+{
+    RESULT_ENSURE_REF(cache);
+    RESULT_ENSURE(size <= SIZE_MAX, S2N_ERR_INVALID_ARGUMENT);
+    uint32_t capacity = 0;
+    RESULT_GUARD(s2n_session_cache_shm_capacity(size, &capacity));
+
+    DEFER_CLEANUP(struct s2n_session_cache *new_cache = NULL, s2n_session_cache_ptr_free);
+    RESULT_GUARD(s2n_session_cache_alloc(&new_cache));
+    RESULT_GUARD(s2n_session_cache_map(path, size, &new_cache->shm));
+    new_cache->shm_size = size;
+    if (path == NULL) {
+        RESULT_GUARD(s2n_session_cache_init_region(new_cache->shm, size, capacity, S2N_SHM_SESSION_CACHE_SHARDS, true));
+    }
+    RESULT_GUARD(s2n_session_cache_attach(new_cache, new_cache->shm, size));
+
+    *cache = new_cache;
+    new_cache = NULL;
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_session_cache_free(struct s2n_session_cache **cache)
+{
+    RESULT_ENSURE_REF(cache);
+    struct s2n_session_cache *to_free = *cache;
+    if (to_free == NULL) {
+        return S2N_RESULT_OK;
+    }
+
+    if (to_free->shm) {
+        /* Other processes may still be using a shared region, so only unmap it */
+        RESULT_ENSURE(munmap(to_free->shm, to_free->shm_size) == 0, S2N_ERR_SAFETY);
+    } else if (to_free->header) {
+        for (uint32_t i = 0; i < to_free->shard_count; i++) {
+            RESULT_ENSURE_EQ(pthread_mutex_destroy(&to_free->shards[i].state->lock), 0);
+        }
+    }
+    /* s2n_free wipes the cached sessions of a private cache */
+    RESULT_GUARD_POSIX(s2n_free(&to_free->region_mem));
+    RESULT_GUARD_POSIX(s2n_free(&to_free->shards_mem));
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) cache, sizeof(struct s2n_session_cache)));
+    return S2N_RESULT_OK;
+}
+
+S2N_CLEANUP_RESULT s2n_session_cache_ptr_free(struct s2n_session_cache **cache)
+{
+    RESULT_GUARD(s2n_session_cache_free(cache));
+    return S2N_RESULT_OK;
+}
+
+/* Locks a shard. If the previous owner of a shared shard died while holding the lock,
+ * the shard may be half updated, so its sessions are dropped before the lock is used again.
+ */
+static S2N_RESULT s2n_session_cache_lock(struct s2n_session_cache_shard *shard)
+{
+    int rc = pthread_mutex_lock(&shard->state->lock);
+#if defined(S2N_ROBUST_MUTEX_SUPPORTED)
+    if (rc == EOWNERDEAD) {
+        memset(shard->entries, 0, sizeof(struct s2n_session_cache_entry) * shard->capacity);
+        memset(shard->buckets, 0, sizeof(uint32_t) * (shard->bucket_mask + 1));
+        shard->state->clock_hand = 0;
+        rc = pthread_mutex_consistent(&shard->state->lock);
+    }
+#endif
+    RESULT_ENSURE_EQ(rc, 0);
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_session_cache_unlock(struct s2n_session_cache_shard *shard)
+{
+    RESULT_ENSURE_EQ(pthread_mutex_unlock(&shard->state->lock), 0);
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_session_cache_locate(struct s2n_session_cache *cache, const uint8_t *id, uint8_t id_size,
+        struct s2n_session_cache_shard **shard, uint32_t *bucket)
+{
+    RESULT_ENSURE_REF(cache);
+    RESULT_ENSURE_REF(id);
+    RESULT_ENSURE(id_size > 0, S2N_ERR_SESSION_ID_TOO_SHORT);
+    RESULT_ENSURE(id_size <= S2N_TLS_SESSION_ID_MAX_LEN, S2N_ERR_SESSION_ID_TOO_LONG);
+
+    /* The high bits choose the shard and the low bits choose the bucket within the shard */
+    uint64_t hash = s2n_siphash(&cache->header->hash_key, id, id_size);
+    *shard = &cache->shards[(hash >> 32) % cache->shard_count];
+    *bucket = (uint32_t) hash & (*shard)->bucket_mask;
+    return S2N_RESULT_OK;
+}
+
+static struct s2n_session_cache_entry *s2n_session_cache_find_locked(struct s2n_session_cache_shard *shard,
+        uint32_t bucket, const uint8_t *id, uint8_t id_size)
+{
+    /* Session IDs are sent in the clear, so they don't need a constant time comparison */
+    for (uint32_t next = shard->buckets[bucket]; next != 0 && next <= shard->capacity;
+            next = shard->entries[next - 1].next) {
+        struct s2n_session_cache_entry *entry = &shard->entries[next - 1];
+        if (entry->id_size == id_size && memcmp(entry->id, id, id_size) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static S2N_RESULT s2n_session_cache_remove_locked(struct s2n_session_cache *cache,
+        struct s2n_session_cache_shard *shard, struct s2n_session_cache_entry *entry)
+{
+    RESULT_ENSURE(entry->in_use, S2N_ERR_SAFETY);
+
+    struct s2n_session_cache_shard *entry_shard = NULL;
+    uint32_t bucket = 0;
+    RESULT_GUARD(s2n_session_cache_locate(cache, entry->id, entry->id_size, &entry_shard, &bucket));
+    RESULT_ENSURE(entry_shard == shard, S2N_ERR_SAFETY);
+
+    uint32_t index = (uint32_t) (entry - shard->entries) + 1;
+    uint32_t *link = &shard->buckets[bucket];
+    while (*link != index) {
+        RESULT_ENSURE(*link != 0 && *link <= shard->capacity, S2N_ERR_SAFETY);
+        link = &shard->entries[*link - 1].next;
+    }
+    *link = entry->next;
+
+    /* Cached values hold encrypted session state, but the entry is wiped anyway
+     * so that nothing about an expired or evicted session stays in memory.
+     */
+    *entry = (struct s2n_session_cache_entry){ 0 };
+    return S2N_RESULT_OK;
+}
+
+/* Advances the clock hand until it finds an unused or expired entry, or an entry that
+ * has not been retrieved since the hand last passed it.
+ */
+static S2N_RESULT s2n_session_cache_claim_locked(struct s2n_session_cache *cache,
+        struct s2n_session_cache_shard *shard, uint64_t now, struct s2n_session_cache_entry **claimed)
+{
+    /* Every referenced entry is cleared on the first pass, so two passes always find an entry */
+    for (uint64_t i = 0; i < (uint64_t) shard->capacity * 2; i++) {
+        struct s2n_session_cache_entry *entry = &shard->entries[shard->state->clock_hand];
+        shard->state->clock_hand = (shard->state->clock_hand + 1) % shard->capacity;
+
+        if (!entry->in_use) {
+            *claimed = entry;
+            return S2N_RESULT_OK;
+        }
+        if (entry->expiration <= now) {
+            RESULT_GUARD(s2n_session_cache_remove_locked(cache, shard, entry));
+            *claimed = entry;
+            return S2N_RESULT_OK;
+        }
+        if (entry->referenced) {
+            entry->referenced = false;
+            continue;
+        }
+        RESULT_GUARD(s2n_session_cache_remove_locked(cache, shard, entry));
+        shard->state->evictions++;
+        *claimed = entry;
+        return S2N_RESULT_OK;
+    }
+    RESULT_BAIL(S2N_ERR_SAFETY);
+}
+
+static S2N_RESULT s2n_session_cache_store_locked(struct s2n_session_cache *cache,
+        struct s2n_session_cache_shard *shard, uint32_t bucket, uint64_t now, uint64_t ttl_in_nanos,
+        const uint8_t *id, uint8_t id_size, const uint8_t *value, uint64_t value_size)
+{
+    struct s2n_session_cache_entry *entry = s2n_session_cache_find_locked(shard, bucket, id, id_size);
+    if (entry) {
+        RESULT_GUARD(s2n_session_cache_remove_locked(cache, shard, entry));
+    } else {
+        RESULT_GUARD(s2n_session_cache_claim_locked(cache, shard, now, &entry));
+    }
+
+    RESULT_CHECKED_MEMCPY(entry->id, id, id_size);
+    RESULT_CHECKED_MEMCPY(entry->value, value, value_size);
+    entry->id_size = id_size;
+    entry->value_size = (uint16_t) value_size;
+    entry->expiration = (ttl_in_nanos > UINT64_MAX - now) ? UINT64_MAX : now + ttl_in_nanos;
+    /* New sessions start unreferenced, so sessions that are never resumed are replaced first */
+    entry->referenced = false;
+    entry->in_use = true;
+
+    entry->next = shard->buckets[bucket];
+    shard->buckets[bucket] = (uint32_t) (entry - shard->entries) + 1;
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_session_cache_store(struct s2n_session_cache *cache, uint64_t now, uint64_t ttl_in_nanos,
+        const uint8_t *id, uint8_t id_size, const uint8_t *value, uint64_t value_size)
+{
+    RESULT_ENSURE_REF(value);
+    RESULT_ENSURE(value_size <= S2N_TLS12_TICKET_SIZE_IN_BYTES, S2N_ERR_SIZE_MISMATCH);
+
+    struct s2n_session_cache_shard *shard = NULL;
+    uint32_t bucket = 0;
+    RESULT_GUARD(s2n_session_cache_locate(cache, id, id_size, &shard, &bucket));
+
+    RESULT_GUARD(s2n_session_cache_lock(shard));
+    s2n_result result = s2n_session_cache_store_locked(cache, shard, bucket, now, ttl_in_nanos,
+            id, id_size, value, value_size);
+    RESULT_GUARD(s2n_session_cache_unlock(shard));
+
+    return result;
+}
+
+static S2N_RESULT s2n_session_cache_retrieve_locked(struct s2n_session_cache *cache,
+        struct s2n_session_cache_shard *shard, uint32_t bucket, uint64_t now,
+        const uint8_t *id, uint8_t id_size, uint8_t *value, uint64_t *value_size)
+{
+    struct s2n_session_cache_entry *entry = s2n_session_cache_find_locked(shard, bucket, id, id_size);
+    if (entry && entry->expiration <= now) {
+        RESULT_GUARD(s2n_session_cache_remove_locked(cache, shard, entry));
+        entry = NULL;
+    }
+    if (entry == NULL) {
+        shard->state->misses++;
+        RESULT_BAIL(S2N_ERR_SESSION_ID_NOT_FOUND);
+    }
+
+    /* A shared entry may have been written by another process, so bound it before copying */
+    RESULT_ENSURE(entry->id_size <= sizeof(entry->id), S2N_ERR_SAFETY);
+    RESULT_ENSURE(entry->value_size <= sizeof(entry->value), S2N_ERR_SAFETY);
+    RESULT_ENSURE(*value_size >= entry->value_size, S2N_ERR_SIZE_MISMATCH);
+    RESULT_CHECKED_MEMCPY(value, entry->value, entry->value_size);
+    *value_size = entry->value_size;
+    entry->referenced = true;
+    shard->state->hits++;
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_session_cache_retrieve(struct s2n_session_cache *cache, uint64_t now,
+        const uint8_t *id, uint8_t id_size, uint8_t *value, uint64_t *value_size)
+{
+    RESULT_ENSURE_REF(value);
+    RESULT_ENSURE_REF(value_size);
+
+    struct s2n_session_cache_shard *shard = NULL;
+    uint32_t bucket = 0;
+    RESULT_GUARD(s2n_session_cache_locate(cache, id, id_size, &shard, &bucket));
+
+    RESULT_GUARD(s2n_session_cache_lock(shard));
+    s2n_result result = s2n_session_cache_retrieve_locked(cache, shard, bucket, now, id, id_size, value, value_size);
+    RESULT_GUARD(s2n_session_cache_unlock(shard));
+
+    return result;
+}
+
+static S2N_RESULT s2n_session_cache_delete_locked(struct s2n_session_cache *cache,
+        struct s2n_session_cache_shard *shard, uint32_t bucket, const uint8_t *id, uint8_t id_size)
+{
+    struct s2n_session_cache_entry *entry = s2n_session_cache_find_locked(shard, bucket, id, id_size);
+    if (entry) {
+        RESULT_GUARD(s2n_session_cache_remove_locked(cache, shard, entry));
+    }
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_session_cache_delete(struct s2n_session_cache *cache, const uint8_t *id, uint8_t id_size)
+{
+    struct s2n_session_cache_shard *shard = NULL;
+    uint32_t bucket = 0;
+    RESULT_GUARD(s2n_session_cache_locate(cache, id, id_size, &shard, &bucket));
+
+    RESULT_GUARD(s2n_session_cache_lock(shard));
+    s2n_result result = s2n_session_cache_delete_locked(cache, shard, bucket, id, id_size);
+    RESULT_GUARD(s2n_session_cache_unlock(shard));
+
+    return result;
+}
+
+int s2n_session_cache_store_cb(struct s2n_connection *conn, void *ctx, uint64_t ttl_in_seconds,
+        const void *key, uint64_t key_size, const void *value, uint64_t value_size)
+{
+    POSIX_ENSURE_REF(conn);
+    POSIX_ENSURE_REF(conn->config);
+    POSIX_ENSURE(key_size <= S2N_TLS_SESSION_ID_MAX_LEN, S2N_ERR_SESSION_ID_TOO_LONG);
+
+    uint64_t now = 0;
+    POSIX_GUARD_RESULT(s2n_config_wall_clock(conn->config, &now));
+
+    /* Sessions can't be resumed after the session state lifetime, so don't keep them any longer */
+    uint64_t ttl_in_nanos = conn->config->session_state_lifetime_in_nanos;
+    if (ttl_in_seconds < ttl_in_nanos / ONE_SEC_IN_NANOS) {
+        ttl_in_nanos = ttl_in_seconds * ONE_SEC_IN_NANOS;
+    }
+
+    POSIX_GUARD_RESULT(s2n_session_cache_store(ctx, now, ttl_in_nanos, key, (uint8_t) key_size, value, value_size));
+    return S2N_SUCCESS;
+}
+
+int s2n_session_cache_retrieve_cb(struct s2n_connection *conn, void *ctx,
+        const void *key, uint64_t key_size, void *value, uint64_t *value_size)
+{
+    POSIX_ENSURE_REF(conn);
+    POSIX_ENSURE_REF(conn->config);
+    POSIX_ENSURE(key_size <= S2N_TLS_SESSION_ID_MAX_LEN, S2N_ERR_SESSION_ID_TOO_LONG);
+
+    uint64_t now = 0;
+    POSIX_GUARD_RESULT(s2n_config_wall_clock(conn->config, &now));
+    POSIX_GUARD_RESULT(s2n_session_cache_retrieve(ctx, now, key, (uint8_t) key_size, value, value_size));
+    return S2N_SUCCESS;
+}
+
+int s2n_session_cache_delete_cb(struct s2n_connection *conn, void *ctx, const void *key, uint64_t key_size)
+{
+    POSIX_ENSURE(key_size <= S2N_TLS_SESSION_ID_MAX_LEN, S2N_ERR_SESSION_ID_TOO_LONG);
+    POSIX_GUARD_RESULT(s2n_session_cache_delete(ctx, key, (uint8_t) key_size));
+    return S2N_SUCCESS;
+}
+
+S2N_RESULT s2n_session_cache_get_stats(struct s2n_session_cache *cache, uint64_t *hits,
+        uint64_t *misses, uint64_t *evictions)
+{
+    RESULT_ENSURE_REF(cache);
+    RESULT_ENSURE_REF(hits);
+    RESULT_ENSURE_REF(misses);
+    RESULT_ENSURE_REF(evictions);
+
+    *hits = 0;
+    *misses = 0;
+    *evictions = 0;
+    for (uint32_t i = 0; i < cache->shard_count; i++) {
+        struct s2n_session_cache_shard *shard = &cache->shards[i];
+        RESULT_GUARD(s2n_session_cache_lock(shard));
+        *hits += shard->state->hits;
+        *misses += shard->state->misses;
+        *evictions += shard->state->evictions;
+        RESULT_GUARD(s2n_session_cache_unlock(shard));
+    }
+    return S2N_RESULT_OK;
+}
+
+static int s2n_config_set_session_cache(struct s2n_config *config, struct s2n_session_cache *cache)
+{
+    POSIX_GUARD(s2n_config_set_cache_store_callback(config, s2n_session_cache_store_cb, cache));
+    POSIX_GUARD(s2n_config_set_cache_retrieve_callback(config, s2n_session_cache_retrieve_cb, cache));
+    POSIX_GUARD(s2n_config_set_cache_delete_callback(config, s2n_session_cache_delete_cb, cache));
+    POSIX_GUARD(s2n_config_set_session_cache_onoff(config, 1));
+    return S2N_SUCCESS;
+}
+
+int s2n_config_enable_builtin_session_cache(struct s2n_config *config, uint32_t capacity, uint32_t shards)
+{
+    POSIX_ENSURE_REF(config);
+    POSIX_ENSURE(config->builtin_session_cache == NULL, S2N_ERR_INVALID_STATE);
+
+    POSIX_GUARD_RESULT(s2n_session_cache_new(capacity, shards, &config->builtin_session_cache));
+    POSIX_GUARD(s2n_config_set_session_cache(config, config->builtin_session_cache));
+    return S2N_SUCCESS;
+}
+
+int s2n_config_get_builtin_session_cache_stats(struct s2n_config *config, uint64_t *hits,
+        uint64_t *misses, uint64_t *evictions)
+{
+    POSIX_ENSURE_REF(config);
+    POSIX_ENSURE(config->builtin_session_cache, S2N_ERR_INVALID_STATE);
+    POSIX_GUARD_RESULT(s2n_session_cache_get_stats(config->builtin_session_cache, hits, misses, evictions));
+    return S2N_SUCCESS;
+}
+
+struct s2n_shm_session_cache *s2n_shm_session_cache_new(const char *path, uint64_t size)
+{
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    PTR_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_shm_session_cache)));
+    PTR_GUARD_POSIX(s2n_blob_zero(&mem));
+    struct s2n_shm_session_cache *shm_cache = (struct s2n_shm_session_cache *) (void *) mem.data;
+
+    PTR_GUARD_RESULT(s2n_session_cache_shm_new(path, size, &shm_cache->cache));
+
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+    return shm_cache;
+}
+
+int s2n_shm_session_cache_free(struct s2n_shm_session_cache **shm_cache)
+{
+    POSIX_ENSURE_REF(shm_cache);
+    if (*shm_cache == NULL) {
+        return S2N_SUCCESS;
+    }
+    POSIX_GUARD_RESULT(s2n_session_cache_free(&(*shm_cache)->cache));
+    POSIX_GUARD(s2n_free_object((uint8_t **) shm_cache, sizeof(struct s2n_shm_session_cache)));
+    return S2N_SUCCESS;
+}
+
+int s2n_shm_session_cache_get_stats(struct s2n_shm_session_cache *shm_cache, uint64_t *hits,
+        uint64_t *misses, uint64_t *evictions)
+{
+    POSIX_ENSURE_REF(shm_cache);
+    POSIX_GUARD_RESULT(s2n_session_cache_get_stats(shm_cache->cache, hits, misses, evictions));
+    return S2N_SUCCESS;
+}
+
+int s2n_config_set_shm_session_cache(struct s2n_config *config, struct s2n_shm_session_cache *shm_cache)
+{
+    POSIX_ENSURE_REF(config);
+    POSIX_ENSURE_REF(shm_cache);
+    POSIX_GUARD(s2n_config_set_session_cache(config, shm_cache->cache));
+    return S2N_SUCCESS;
+}
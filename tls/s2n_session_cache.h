@@ -0,0 +1,128 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+#include "api/unstable/session_cache.h"
+#include "tls/s2n_crypto_constants.h"
+#include "tls/s2n_resume.h"
+#include "utils/s2n_blob.h"
+#include "utils/s2n_result.h"
+#include "utils/s2n_siphash.h"
+
+/* A fixed-capacity session ID cache for TLS1.2 resumption.
+ *
+ * Entries are spread across independently locked shards by a keyed hash of the session ID,
+ * so concurrent handshakes only contend when they land on the same shard.
+ * Each shard preallocates its entries and replaces them with the CLOCK algorithm:
+ * a retrieved entry is marked as referenced and survives one pass of the clock hand.
+ *
+ * All cache state lives in one contiguous region addressed by offsets and indexes instead of pointers,
+ * so the same region can be heap memory private to a process or a mapping shared between processes:
+ *
+ *   header | shard states | entries | buckets
+ */
+
+#define S2N_SESSION_CACHE_MAGIC 0x73326e2d73636163 /* "s2n-scac" */
+
+/* Must be incremented whenever the layout of the region changes */
+#define S2N_SESSION_CACHE_VERSION 1
+
+/* The number of shards used by a shared memory cache */
+#define S2N_SHM_SESSION_CACHE_SHARDS 16
+
+/* A file-backed region may have been created by a different build of s2n,
+ * so the header records everything the layout depends on.
+ */
+struct s2n_session_cache_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t lock_size;
+    uint64_t size;
+    struct s2n_siphash_key hash_key;
+    uint32_t capacity;
+    uint32_t shard_count;
+    uint32_t bucket_count;
+};
+
+struct s2n_session_cache_entry {
+    uint8_t id[S2N_TLS_SESSION_ID_MAX_LEN];
+    uint8_t value[S2N_TLS12_TICKET_SIZE_IN_BYTES];
+    uint64_t expiration;
+    /* Index + 1 of the next entry in the same bucket, or 0 for the end of the chain */
+    uint32_t next;
+    uint16_t value_size;
+    uint8_t id_size;
+    bool in_use;
+    bool referenced;
+};
+
+/* Each shard state is padded to a cache line so that shards don't share lock cache lines */
+struct s2n_session_cache_shard_state {
+    pthread_mutex_t lock;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint32_t clock_hand;
+};
+
+/* A process-local view of one shard of the region */
+struct s2n_session_cache_shard {
+    struct s2n_session_cache_shard_state *state;
+    struct s2n_session_cache_entry *entries;
+    /* Index + 1 of the first entry in each bucket, or 0 for an empty bucket */
+    uint32_t *buckets;
+    uint32_t capacity;
+    uint32_t bucket_mask;
+};
+
+struct s2n_session_cache {
+    struct s2n_session_cache_header *header;
+    struct s2n_blob shards_mem;
+    struct s2n_session_cache_shard *shards;
+    uint32_t shard_count;
+    /* A private cache owns its region. A shared cache maps it. */
+    struct s2n_blob region_mem;
+    void *shm;
+    uint64_t shm_size;
+};
+
+/* The application-facing handle for a shared memory cache */
+struct s2n_shm_session_cache {
+    struct s2n_session_cache *cache;
+};
+
+S2N_RESULT s2n_session_cache_new(uint32_t capacity, uint32_t shard_count, struct s2n_session_cache **cache);
+S2N_RESULT s2n_session_cache_free(struct s2n_session_cache **cache);
+S2N_CLEANUP_RESULT s2n_session_cache_ptr_free(struct s2n_session_cache **cache);
+S2N_RESULT s2n_session_cache_shm_new(const char *path, uint64_t size, struct s2n_session_cache **cache);
+S2N_RESULT s2n_session_cache_get_stats(struct s2n_session_cache *cache, uint64_t *hits,
+        uint64_t *misses, uint64_t *evictions);
+
+S2N_RESULT s2n_session_cache_store(struct s2n_session_cache *cache, uint64_t now, uint64_t ttl_in_nanos,
+        const uint8_t *id, uint8_t id_size, const uint8_t *value, uint64_t value_size);
+S2N_RESULT s2n_session_cache_retrieve(struct s2n_session_cache *cache, uint64_t now,
+        const uint8_t *id, uint8_t id_size, uint8_t *value, uint64_t *value_size);
+S2N_RESULT s2n_session_cache_delete(struct s2n_session_cache *cache, const uint8_t *id, uint8_t id_size);
+
+/* Callbacks that plug the cache into the s2n_config session cache interface */
+int s2n_session_cache_store_cb(struct s2n_connection *conn, void *ctx, uint64_t ttl_in_seconds,
+        const void *key, uint64_t key_size, const void *value, uint64_t value_size);
+int s2n_session_cache_retrieve_cb(struct s2n_connection *conn, void *ctx,
+        const void *key, uint64_t key_size, void *value, uint64_t *value_size);
+int s2n_session_cache_delete_cb(struct s2n_connection *conn, void *ctx, const void *key, uint64_t key_size);
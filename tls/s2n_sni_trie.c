@@ -0,0 +1,472 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_sni_trie.h"
+
+#include <string.h>
+
+#include "utils/s2n_atomic.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_SNI_TRIE_INITIAL_CHILDREN 4
+
+struct s2n_sni_trie_children {
+    /* A power of two. Kept at most half full so that probing always finds an empty slot. */
+    uint32_t capacity;
+    uint32_t count;
+    struct s2n_sni_trie_children *retired_next;
+    struct s2n_sni_trie_node *slots[];
+};
+
+struct s2n_sni_trie_certs {
+    struct certs_by_type certs;
+    struct s2n_sni_trie_certs *retired_next;
+};
+
+struct s2n_sni_trie_node {
+    struct s2n_sni_trie_children *children;
+
+    /* Certificates for the name ending at this node */
+    struct s2n_sni_trie_certs *exact;
+    /* Certificates for "*." followed by the name ending at this node */
+    struct s2n_sni_trie_certs *wildcard;
+
+    uint64_t hash;
+    uint32_t label_len;
+    uint8_t label[];
+};
+
+static S2N_RESULT s2n_sni_trie_node_new(const struct s2n_sni_trie *trie, const uint8_t *label, uint32_t label_len,
+        struct s2n_sni_trie_node **node)
+{
+    struct s2n_blob mem = { 0 };
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_sni_trie_node) + label_len));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+
+    struct s2n_sni_trie_node *new_node = (struct s2n_sni_trie_node *) (void *) mem.data;
+    if (label_len > 0) {
+        RESULT_CHECKED_MEMCPY(new_node->label, label, label_len);
+    }
+    new_node->label_len = label_len;
+    /* The root has no label and is never stored in a child table */
+    if (label != NULL) {
+        new_node->hash = s2n_siphash(&trie->hash_key, label, label_len);
+    }
+
+    *node = new_node;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_sni_trie_children_new(uint32_t capacity, struct s2n_sni_trie_children **children)
+{
+    struct s2n_blob mem = { 0 };
+    RESULT_GUARD_POSIX(s2n_alloc(&mem,
+            sizeof(struct s2n_sni_trie_children) + (capacity * sizeof(struct s2n_sni_trie_node *))));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+
+    *children = (struct s2n_sni_trie_children *) (void *) mem.data;
+    (*children)->capacity = capacity;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_sni_trie_children_free(struct s2n_sni_trie_children *children)
+{
+    if (children == NULL) {
+        return S2N_RESULT_OK;
+    }
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) &children,
+            sizeof(struct s2n_sni_trie_children) + (children->capacity * sizeof(struct s2n_sni_trie_node *))));
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_sni_trie_certs_new(const struct certs_by_type *certs, struct s2n_sni_trie_certs **trie_certs)
+{
+    struct s2n_blob mem = { 0 };
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_sni_trie_certs)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+
+    *trie_certs = (struct s2n_sni_trie_certs *) (void *) mem.data;
+    (*trie_certs)->certs = *certs;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_sni_trie_certs_free(struct s2n_sni_trie_certs *trie_certs)
+{
+    if (trie_certs == NULL) {
+        return S2N_RESULT_OK;
+    }
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) &trie_certs, sizeof(struct s2n_sni_trie_certs)));
+    return S2N_RESULT_OK;
+}
+
+static struct s2n_sni_trie_node *s2n_sni_trie_find_child(const struct s2n_sni_trie *trie,
+        const struct s2n_sni_trie_node *node, const uint8_t *label, uint32_t label_len)
+{
+    const struct s2n_sni_trie_children *children = s2n_atomic_ptr_load((void *const *) &node->children);
+    if (children == NULL) {
+        return NULL;
+    }
+
+    const uint64_t hash = s2n_siphash(&trie->hash_key, label, label_len);
+    const uint32_t mask = children->capacity - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        struct s2n_sni_trie_node *child = s2n_atomic_ptr_load((void *const *) &children->slots[i]);
+        if (child == NULL) {
+            return NULL;
+        }
+        if (child->hash == hash && child->label_len == label_len
+                && (label_len == 0 || memcmp(child->label, label, label_len) == 0)) {
+            return child;
+        }
+    }
+}
+
+/* Only called by the writer, on a table that is either not yet published or has room for the child */
+static void s2n_sni_trie_children_place(struct s2n_sni_trie_children *children, struct s2n_sni_trie_node *child)
+{
+    const uint32_t mask = children->capacity - 1;
+    uint32_t i = child->hash & mask;
+    while (children->slots[i] != NULL) {
+        i = (i + 1) & mask;
+    }
+    s2n_atomic_ptr_store((void **) &children->slots[i], child);
+    children->count++;
+}
+
+static S2N_RESULT s2n_sni_trie_add_child(struct s2n_sni_trie *trie, struct s2n_sni_trie_node *node,
+        struct s2n_sni_trie_node *child)
+{
+    struct s2n_sni_trie_children *children = node->children;
+    if (children == NULL) {
+        RESULT_GUARD(s2n_sni_trie_children_new(S2N_SNI_TRIE_INITIAL_CHILDREN, &children));
+        s2n_sni_trie_children_place(children, child);
+        s2n_atomic_ptr_store((void **) &node->children, children);
+        return S2N_RESULT_OK;
+    }
+
+    if ((children->count + 1) * 2 <= children->capacity) {
+        s2n_sni_trie_children_place(children, child);
+        return S2N_RESULT_OK;
+    }
+
+    /* Build a larger table and publish it once complete.
+     * Readers may still be probing the old table, so retire it instead of freeing it.
+     */
+    RESULT_ENSURE(children->capacity <= UINT32_MAX / 4, S2N_ERR_INTEGER_OVERFLOW);
+    struct s2n_sni_trie_children *grown = NULL;
+    RESULT_GUARD(s2n_sni_trie_children_new(children->capacity * 2, &grown));
+    for (uint32_t i = 0; i < children->capacity; i++) {
+        if (children->slots[i]) {
+            s2n_sni_trie_children_place(grown, children->slots[i]);
+        }
+    }
+    s2n_sni_trie_children_place(grown, child);
+    s2n_atomic_ptr_store((void **) &node->children, grown);
+
+    children->retired_next = trie->retired_children;
+    trie->retired_children = children;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_sni_trie_node_free(struct s2n_sni_trie_node *node)
+{
+    if (node == NULL) {
+        return S2N_RESULT_OK;
+    }
+
+    struct s2n_sni_trie_children *children = node->children;
+    if (children) {
+        for (uint32_t i = 0; i < children->capacity; i++) {
+            RESULT_GUARD(s2n_sni_trie_node_free(children->slots[i]));
+        }
+        RESULT_GUARD(s2n_sni_trie_children_free(children));
+    }
+    RESULT_GUARD(s2n_sni_trie_certs_free(node->exact));
+    RESULT_GUARD(s2n_sni_trie_certs_free(node->wildcard));
+
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) &node, sizeof(struct s2n_sni_trie_node) + node->label_len));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_sni_trie_new(struct s2n_sni_trie **trie)
+{
+    RESULT_ENSURE_REF(trie);
+    RESULT_ENSURE(*trie == NULL, S2N_ERR_SAFETY);
+
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_sni_trie)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+    struct s2n_sni_trie *new_trie = (struct s2n_sni_trie *) (void *) mem.data;
+
+    RESULT_GUARD(s2n_sni_trie_node_new(new_trie, NULL, 0, &new_trie->root));
+
+    *trie = new_trie;
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_sni_trie_free(struct s2n_sni_trie **trie)
+{
+    RESULT_ENSURE_REF(trie);
+    if (*trie == NULL) {
+        return S2N_RESULT_OK;
+    }
+
+    RESULT_GUARD(s2n_sni_trie_node_free((*trie)->root));
+
+    struct s2n_sni_trie_children *retired_children = (*trie)->retired_children;
+    while (retired_children) {
+        struct s2n_sni_trie_children *next = retired_children->retired_next;
+        RESULT_GUARD(s2n_sni_trie_children_free(retired_children));
+        retired_children = next;
+    }
+
+    struct s2n_sni_trie_certs *retired_certs = (*trie)->retired_certs;
+    while (retired_certs) {
+        struct s2n_sni_trie_certs *next = retired_certs->retired_next;
+        RESULT_GUARD(s2n_sni_trie_certs_free(retired_certs));
+        retired_certs = next;
+    }
+
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) trie, sizeof(struct s2n_sni_trie)));
+    return S2N_RESULT_OK;
+}
+
+S2N_CLEANUP_RESULT s2n_sni_trie_ptr_free(struct s2n_sni_trie **trie)
+{
+    RESULT_GUARD(s2n_sni_trie_free(trie));
+    return S2N_RESULT_OK;
+}
+
+/* Finds the label that ends at `end`, the index just past the label's last byte */
+static uint32_t s2n_sni_trie_label_start(const uint8_t *name, uint32_t end)
+{
+    uint32_t start = end;
+    while (start > 0 && name[start - 1] != '.') {
+        start--;
+    }
+    return start;
+}
+
+static bool s2n_sni_trie_is_wildcard_label(const uint8_t *label, uint32_t label_len)
+{
+    return label_len == 1 && label[0] == '*';
+}
+
+/* Walks the trie for a name stored with s2n_sni_trie_set.
+ *
+ * Returns the node and which of its certificates hold the name. If `writable_trie` is set,
+ * missing nodes are created. Otherwise `node` is set to NULL if the name has no node.
+ */
+static S2N_RESULT s2n_sni_trie_find_name(const struct s2n_sni_trie *trie, struct s2n_sni_trie *writable_trie,
+        const struct s2n_blob *name, struct s2n_sni_trie_node **node, bool *is_wildcard)
+{
+    RESULT_ENSURE_REF(trie);
+    RESULT_ENSURE_REF(name);
+    RESULT_ENSURE(name->size > 0, S2N_ERR_INVALID_ARGUMENT);
+    RESULT_ENSURE_REF(name->data);
+
+    *node = NULL;
+    *is_wildcard = false;
+
+    struct s2n_sni_trie_node *current = trie->root;
+    uint32_t end = name->size;
+    while (true) {
+        uint32_t start = s2n_sni_trie_label_start(name->data, end);
+        const uint8_t *label = name->data + start;
+        uint32_t label_len = end - start;
+
+        /* A leftmost "*" label makes this a wildcard name for the rest of the name.
+         * A name of just "*" has no rest, so it is stored like any other label.
+         */
+        if (start == 0 && current != trie->root && s2n_sni_trie_is_wildcard_label(label, label_len)) {
+            *node = current;
+            *is_wildcard = true;
+            return S2N_RESULT_OK;
+        }
+
+        struct s2n_sni_trie_node *child = s2n_sni_trie_find_child(trie, current, label, label_len);
+        if (child == NULL) {
+            if (writable_trie == NULL) {
+                return S2N_RESULT_OK;
+            }
+            /* The hash key is only needed once the trie has nodes, so empty tries like
+             * those of the default configs never draw from the private DRBG.
+             * Readers can't hash anything until the first child table is published.
+             */
+            if (writable_trie->node_count == 0) {
+                RESULT_GUARD(s2n_siphash_key_generate(&writable_trie->hash_key));
+            }
+            RESULT_GUARD(s2n_sni_trie_node_new(writable_trie, label, label_len, &child));
+            RESULT_GUARD(s2n_sni_trie_add_child(writable_trie, current, child));
+            writable_trie->node_count++;
+        }
+        current = child;
+
+        if (start == 0) {
+            *node = current;
+            return S2N_RESULT_OK;
+        }
+        /* Skip the '.' separating the labels */
+        end = start - 1;
+    }
+}
+
+S2N_RESULT s2n_sni_trie_set(struct s2n_sni_trie *trie, const struct s2n_blob *name, const struct certs_by_type *certs)
+{
+    RESULT_ENSURE_REF(trie);
+    RESULT_ENSURE_REF(certs);
+
+    /* Build the new certificates before publishing them, so readers never see a partial update */
+    struct s2n_sni_trie_certs *new_certs = NULL;
+    RESULT_GUARD(s2n_sni_trie_certs_new(certs, &new_certs));
+
+    struct s2n_sni_trie_node *node = NULL;
+    bool is_wildcard = false;
+    s2n_result result = s2n_sni_trie_find_name(trie, trie, name, &node, &is_wildcard);
+    if (s2n_result_is_error(result)) {
+        RESULT_GUARD(s2n_sni_trie_certs_free(new_certs));
+        return result;
+    }
+    RESULT_ENSURE_REF(node);
+
+    struct s2n_sni_trie_certs **slot = is_wildcard ? &node->wildcard : &node->exact;
+    struct s2n_sni_trie_certs *old_certs = *slot;
+    s2n_atomic_ptr_store((void **) slot, new_certs);
+
+    if (old_certs) {
+        old_certs->retired_next = trie->retired_certs;
+        trie->retired_certs = old_certs;
+    } else {
+        trie->name_count++;
+    }
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_sni_trie_get(const struct s2n_sni_trie *trie, const struct s2n_blob *name, const struct certs_by_type **certs)
+{
+    RESULT_ENSURE_REF(certs);
+    *certs = NULL;
+
+    struct s2n_sni_trie_node *node = NULL;
+    bool is_wildcard = false;
+    RESULT_GUARD(s2n_sni_trie_find_name(trie, NULL, name, &node, &is_wildcard));
+    if (node == NULL) {
+        return S2N_RESULT_OK;
+    }
+
+    const struct s2n_sni_trie_certs *trie_certs = s2n_atomic_ptr_load(
+            (void *const *) (is_wildcard ? &node->wildcard : &node->exact));
+    if (trie_certs) {
+        *certs = &trie_certs->certs;
+    }
+    return S2N_RESULT_OK;
+}
+
+static bool s2n_sni_trie_load_certs(struct s2n_sni_trie_certs *const *src, struct certs_by_type *dest)
+{
+    const struct s2n_sni_trie_certs *trie_certs = s2n_atomic_ptr_load((void *const *) src);
+    if (trie_certs == NULL) {
+        return false;
+    }
+    *dest = trie_certs->certs;
+    return true;
+}
+
+S2N_RESULT s2n_sni_trie_lookup(const struct s2n_sni_trie *trie, const struct s2n_blob *name, struct s2n_sni_trie_match *match)
+{
+    RESULT_ENSURE_REF(trie);
+    RESULT_ENSURE_REF(name);
+    RESULT_ENSURE_REF(match);
+    *match = (struct s2n_sni_trie_match){ 0 };
+    if (name->size == 0) {
+        return S2N_RESULT_OK;
+    }
+    RESULT_ENSURE_REF(name->data);
+
+    const struct s2n_sni_trie_node *node = trie->root;
+    uint32_t end = name->size;
+    while (node) {
+        uint32_t start = s2n_sni_trie_label_start(name->data, end);
+        const uint8_t *label = name->data + start;
+        uint32_t label_len = end - start;
+
+        if (start == 0) {
+            /* All labels but the leftmost have been matched, so this node holds the wildcard match */
+            if (node != trie->root) {
+                match->wildcard_match_exists = s2n_sni_trie_load_certs(&node->wildcard, &match->wildcard);
+                if (s2n_sni_trie_is_wildcard_label(label, label_len)) {
+                    /* The name itself is the wildcard name */
+                    match->exact = match->wildcard;
+                    match->exact_match_exists = match->wildcard_match_exists;
+                    return S2N_RESULT_OK;
+                }
+            }
+
+            const struct s2n_sni_trie_node *child = s2n_sni_trie_find_child(trie, node, label, label_len);
+            if (child) {
+                match->exact_match_exists = s2n_sni_trie_load_certs(&child->exact, &match->exact);
+            }
+            return S2N_RESULT_OK;
+        }
+
+        node = s2n_sni_trie_find_child(trie, node, label, label_len);
+        end = start - 1;
+    }
+
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_sni_trie_visit_node(const struct s2n_sni_trie_node *node, s2n_sni_trie_visit_fn fn, void *ctx)
+{
+    const struct s2n_sni_trie_certs *exact = s2n_atomic_ptr_load((void *const *) &node->exact);
+    if (exact) {
+        RESULT_GUARD(fn(&exact->certs, ctx));
+    }
+    const struct s2n_sni_trie_certs *wildcard = s2n_atomic_ptr_load((void *const *) &node->wildcard);
+    if (wildcard) {
+        RESULT_GUARD(fn(&wildcard->certs, ctx));
+    }
+
+    const struct s2n_sni_trie_children *children = s2n_atomic_ptr_load((void *const *) &node->children);
+    if (children == NULL) {
+        return S2N_RESULT_OK;
+    }
+    for (uint32_t i = 0; i < children->capacity; i++) {
+        const struct s2n_sni_trie_node *child = s2n_atomic_ptr_load((void *const *) &children->slots[i]);
+        if (child) {
+            RESULT_GUARD(s2n_sni_trie_visit_node(child, fn, ctx));
+        }
+    }
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_sni_trie_visit(const struct s2n_sni_trie *trie, s2n_sni_trie_visit_fn fn, void *ctx)
+{
+    RESULT_ENSURE_REF(trie);
+    RESULT_ENSURE_REF(trie->root);
+    RESULT_ENSURE_REF(fn);
+    RESULT_GUARD(s2n_sni_trie_visit_node(trie->root, fn, ctx));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_sni_trie_size(const struct s2n_sni_trie *trie, uint32_t *size)
+{
+    RESULT_ENSURE_REF(trie);
+    RESULT_ENSURE_REF(size);
+    *size = trie->name_count;
+    return S2N_RESULT_OK;
+}
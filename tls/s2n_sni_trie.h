@@ -0,0 +1,81 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include "crypto/s2n_certificate.h"
+#include "utils/s2n_blob.h"
+#include "utils/s2n_result.h"
+#include "utils/s2n_siphash.h"
+
+/* A trie of DNS names, keyed by label from right to left, that maps each name to the
+ * certificates for it. Both the exact match ("www.example.com") and the wildcard match
+ * ("*.example.com") for a server name are found in a single walk.
+ *
+ * Wildcard names are stored on the node for the rest of the name, so
+ * "*.example.com" is stored on the "example.com" node.
+ *
+ * Lookups don't take locks and are safe while a single writer updates the trie.
+ * Nothing a reader can reach is ever modified after it is published:
+ * - A new node is fully initialized before it is stored in its parent's child table.
+ * - A child table that is full is replaced by a larger copy.
+ * - Certificates are copied into a new allocation that replaces the node's certificates pointer.
+ * Every publish is a single release store. Replaced tables and certificates may still be
+ * in use by readers, so they are retired and only freed with the trie.
+ */
+
+struct s2n_sni_trie_node;
+struct s2n_sni_trie_children;
+struct s2n_sni_trie_certs;
+
+struct s2n_sni_trie {
+    struct s2n_siphash_key hash_key;
+    struct s2n_sni_trie_node *root;
+    /* Child tables and certificates that were replaced, but may still be in use by readers */
+    struct s2n_sni_trie_children *retired_children;
+    struct s2n_sni_trie_certs *retired_certs;
+    uint32_t node_count;
+    uint32_t name_count;
+};
+
+struct s2n_sni_trie_match {
+    struct certs_by_type exact;
+    struct certs_by_type wildcard;
+    bool exact_match_exists;
+    bool wildcard_match_exists;
+};
+
+typedef S2N_RESULT (*s2n_sni_trie_visit_fn)(const struct certs_by_type *certs, void *ctx);
+
+S2N_RESULT s2n_sni_trie_new(struct s2n_sni_trie **trie);
+S2N_RESULT s2n_sni_trie_free(struct s2n_sni_trie **trie);
+S2N_CLEANUP_RESULT s2n_sni_trie_ptr_free(struct s2n_sni_trie **trie);
+
+/* Sets the certificates for a name, which may be a wildcard name. Replaces any existing certificates for the name. */
+S2N_RESULT s2n_sni_trie_set(struct s2n_sni_trie *trie, const struct s2n_blob *name, const struct certs_by_type *certs);
+
+/* Gets the certificates stored for exactly this name, which may be a wildcard name.
+ * Sets `certs` to NULL if the name has no certificates.
+ */
+S2N_RESULT s2n_sni_trie_get(const struct s2n_sni_trie *trie, const struct s2n_blob *name, const struct certs_by_type **certs);
+
+/* Finds the exact and wildcard matches for a lower case server name */
+S2N_RESULT s2n_sni_trie_lookup(const struct s2n_sni_trie *trie, const struct s2n_blob *name, struct s2n_sni_trie_match *match);
+
+/* Calls `fn` with the certificates of every name in the trie */
+S2N_RESULT s2n_sni_trie_visit(const struct s2n_sni_trie *trie, s2n_sni_trie_visit_fn fn, void *ctx);
+
+/* The number of names, including wildcard names, that have certificates */
+S2N_RESULT s2n_sni_trie_size(const struct s2n_sni_trie *trie, uint32_t *size);
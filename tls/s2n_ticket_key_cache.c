@@ -0,0 +1,215 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "tls/s2n_ticket_key_cache.h"
+
+#include "tls/s2n_crypto_constants.h"
+#include "utils/s2n_atomic.h"
+#include "utils/s2n_fork_detection.h"
+#include "utils/s2n_mem.h"
+#include "utils/s2n_random.h"
+#include "utils/s2n_safety.h"
+
+static S2N_RESULT s2n_ticket_key_cache_slot_set(struct s2n_ticket_key *key, struct s2n_ticket_key_cache_slot *slot,
+        bool encrypt)
+{
+    RESULT_ENSURE_REF(key);
+    RESULT_ENSURE_REF(slot);
+
+    struct s2n_unique_ticket_key ticket_key = { 0 };
+    /* Wipe the derived key on every exit path */
+    DEFER_CLEANUP(struct s2n_blob aes_key_blob = { 0 }, s2n_blob_zero);
+    RESULT_GUARD_POSIX(s2n_blob_init(&aes_key_blob, ticket_key.output_key, sizeof(ticket_key.output_key)));
+
+    RESULT_GUARD_POSIX(s2n_blob_init(&ticket_key.initial_key, key->aes_key, sizeof(key->aes_key)));
+    RESULT_CHECKED_MEMCPY(ticket_key.info, slot->info, sizeof(ticket_key.info));
+    RESULT_GUARD(s2n_resume_generate_unique_ticket_key(&ticket_key));
+
+    slot->ready = false;
+    if (slot->session_key.evp_cipher_ctx == NULL) {
+        RESULT_GUARD_POSIX(s2n_session_key_alloc(&slot->session_key));
+        RESULT_GUARD(s2n_aes256_gcm.init(&slot->session_key));
+    } else {
+        RESULT_GUARD(s2n_aes256_gcm.destroy_key(&slot->session_key));
+    }
+
+    if (encrypt) {
+        RESULT_GUARD(s2n_aes256_gcm.set_encryption_key(&slot->session_key, &aes_key_blob));
+    } else {
+        RESULT_GUARD(s2n_aes256_gcm.set_decryption_key(&slot->session_key, &aes_key_blob));
+    }
+    slot->ready = true;
+
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_ticket_key_cache_slot_free(struct s2n_ticket_key_cache_slot *slot)
+{
+    RESULT_ENSURE_REF(slot);
+    if (slot->session_key.evp_cipher_ctx != NULL) {
+        RESULT_GUARD(s2n_aes256_gcm.destroy_key(&slot->session_key));
+    }
+    RESULT_GUARD_POSIX(s2n_session_key_free(&slot->session_key));
+    slot->ready = false;
+    return S2N_RESULT_OK;
+}
+
+static S2N_RESULT s2n_ticket_key_cache_get(struct s2n_ticket_key *key, struct s2n_ticket_key_cache **cache_out)
+{
+    RESULT_ENSURE_REF(key);
+    RESULT_ENSURE_REF(cache_out);
+
+    /* Multiple connections may use the same ticket key concurrently,
+     * so the first one to need the cache publishes it.
+     */
+    struct s2n_ticket_key_cache *cache = s2n_atomic_ptr_load((void *const *) &key->cache);
+    if (cache != NULL) {
+        *cache_out = cache;
+        return S2N_RESULT_OK;
+    }
+
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
+    RESULT_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_ticket_key_cache)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
+    struct s2n_ticket_key_cache *new_cache = (struct s2n_ticket_key_cache *) (void *) mem.data;
+    RESULT_ENSURE_EQ(pthread_mutex_init(&new_cache->lock, NULL), 0);
+
+    if (s2n_atomic_ptr_compare_exchange((void **) &key->cache, NULL, new_cache)) {
+        ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
+        *cache_out = new_cache;
+    } else {
+        RESULT_ENSURE_EQ(pthread_mutex_destroy(&new_cache->lock), 0);
+        *cache_out = s2n_atomic_ptr_load((void *const *) &key->cache);
+    }
+    RESULT_ENSURE_REF(*cache_out);
+    return S2N_RESULT_OK;
+}
+
+/* Encryption reuses one key per ticket key and process, so nonces must never repeat under it.
+ * Instead of a random nonce, each nonce is a random prefix chosen with the key followed by an
+ * eight byte counter: the counter starts at a random value so that it doesn't reveal how many
+ * tickets were issued, and can't wrap before the key is replaced. The key is replaced after a
+ * fork, because the child would otherwise repeat the parent's counter values.
+ */
+static S2N_RESULT s2n_ticket_key_cache_encrypt_locked(struct s2n_ticket_key *key, struct s2n_ticket_key_cache *cache,
+        uint8_t info[S2N_TICKET_INFO_SIZE], struct s2n_blob *iv, struct s2n_blob *aad, struct s2n_blob *state)
+{
+    uint64_t fork_generation = 0;
+    RESULT_GUARD(s2n_get_fork_generation_number(&fork_generation));
+
+    if (!cache->encrypt.ready || cache->encrypt_fork_generation != fork_generation
+            || cache->encrypt_count >= S2N_TICKET_KEY_CACHE_MAX_ENCRYPTIONS) {
+        struct s2n_blob info_blob = { 0 };
+        RESULT_GUARD_POSIX(s2n_blob_init(&info_blob, cache->encrypt.info, sizeof(cache->encrypt.info)));
+        RESULT_GUARD(s2n_get_public_random_data(&info_blob));
+        struct s2n_blob nonce_prefix_blob = { 0 };
+        RESULT_GUARD_POSIX(s2n_blob_init(&nonce_prefix_blob, cache->encrypt.nonce_prefix,
+                sizeof(cache->encrypt.nonce_prefix)));
+        RESULT_GUARD(s2n_get_public_random_data(&nonce_prefix_blob));
+        RESULT_GUARD(s2n_ticket_key_cache_slot_set(key, &cache->encrypt, true));
+
+        RESULT_GUARD(s2n_public_random(INT64_MAX, &cache->next_nonce));
+        cache->encrypt_fork_generation = fork_generation;
+        cache->encrypt_count = 0;
+    }
+
+    struct s2n_stuffer iv_stuffer = { 0 };
+    RESULT_GUARD_POSIX(s2n_stuffer_init(&iv_stuffer, iv));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_bytes(&iv_stuffer, cache->encrypt.nonce_prefix,
+            sizeof(cache->encrypt.nonce_prefix)));
+    RESULT_GUARD_POSIX(s2n_stuffer_write_uint64(&iv_stuffer, cache->next_nonce));
+    RESULT_ENSURE_EQ(s2n_stuffer_space_remaining(&iv_stuffer), 0);
+
+    RESULT_GUARD_POSIX(s2n_aes256_gcm.io.aead.encrypt(&cache->encrypt.session_key, iv, aad, state, state));
+    RESULT_CHECKED_MEMCPY(info, cache->encrypt.info, S2N_TICKET_INFO_SIZE);
+    cache->next_nonce++;
+    cache->encrypt_count++;
+
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_ticket_key_cache_encrypt(struct s2n_ticket_key *key, uint8_t info[S2N_TICKET_INFO_SIZE],
+        struct s2n_blob *iv, struct s2n_blob *aad, struct s2n_blob *state)
+{
+    RESULT_ENSURE_REF(key);
+    RESULT_ENSURE_REF(info);
+    RESULT_ENSURE_REF(iv);
+    RESULT_ENSURE_EQ(iv->size, S2N_TLS_GCM_IV_LEN);
+
+    struct s2n_ticket_key_cache *cache = NULL;
+    RESULT_GUARD(s2n_ticket_key_cache_get(key, &cache));
+
+    RESULT_ENSURE_EQ(pthread_mutex_lock(&cache->lock), 0);
+    s2n_result result = s2n_ticket_key_cache_encrypt_locked(key, cache, info, iv, aad, state);
+    RESULT_ENSURE_EQ(pthread_mutex_unlock(&cache->lock), 0);
+
+    return result;
+}
+
+static S2N_RESULT s2n_ticket_key_cache_decrypt_locked(struct s2n_ticket_key *key, struct s2n_ticket_key_cache *cache,
+        const uint8_t info[S2N_TICKET_INFO_SIZE], struct s2n_blob *iv, struct s2n_blob *aad, struct s2n_blob *state)
+{
+    /* The info is sent in the clear, so it doesn't need a constant time comparison */
+    struct s2n_ticket_key_cache_slot *slot = NULL;
+    for (size_t i = 0; i < s2n_array_len(cache->decrypt); i++) {
+        if (cache->decrypt[i].ready && memcmp(cache->decrypt[i].info, info, S2N_TICKET_INFO_SIZE) == 0) {
+            slot = &cache->decrypt[i];
+            break;
+        }
+    }
+
+    if (slot == NULL) {
+        slot = &cache->decrypt[cache->next_decrypt_slot];
+        cache->next_decrypt_slot = (cache->next_decrypt_slot + 1) % s2n_array_len(cache->decrypt);
+        RESULT_CHECKED_MEMCPY(slot->info, info, S2N_TICKET_INFO_SIZE);
+        RESULT_GUARD(s2n_ticket_key_cache_slot_set(key, slot, false));
+    }
+
+    RESULT_GUARD_POSIX(s2n_aes256_gcm.io.aead.decrypt(&slot->session_key, iv, aad, state, state));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_ticket_key_cache_decrypt(struct s2n_ticket_key *key, const uint8_t info[S2N_TICKET_INFO_SIZE],
+        struct s2n_blob *iv, struct s2n_blob *aad, struct s2n_blob *state)
+{
+    RESULT_ENSURE_REF(key);
+    RESULT_ENSURE_REF(info);
+
+    struct s2n_ticket_key_cache *cache = NULL;
+    RESULT_GUARD(s2n_ticket_key_cache_get(key, &cache));
+
+    RESULT_ENSURE_EQ(pthread_mutex_lock(&cache->lock), 0);
+    s2n_result result = s2n_ticket_key_cache_decrypt_locked(key, cache, info, iv, aad, state);
+    RESULT_ENSURE_EQ(pthread_mutex_unlock(&cache->lock), 0);
+
+    return result;
+}
+
+S2N_RESULT s2n_ticket_key_cache_free(struct s2n_ticket_key *key)
+{
+    RESULT_ENSURE_REF(key);
+    struct s2n_ticket_key_cache *cache = key->cache;
+    if (cache == NULL) {
+        return S2N_RESULT_OK;
+    }
+
+    RESULT_GUARD(s2n_ticket_key_cache_slot_free(&cache->encrypt));
+    for (size_t i = 0; i < s2n_array_len(cache->decrypt); i++) {
+        RESULT_GUARD(s2n_ticket_key_cache_slot_free(&cache->decrypt[i]));
+    }
+    RESULT_ENSURE_EQ(pthread_mutex_destroy(&cache->lock), 0);
+    RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) &key->cache, sizeof(struct s2n_ticket_key_cache)));
+    return S2N_RESULT_OK;
+}
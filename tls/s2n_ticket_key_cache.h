@@ -0,0 +1,62 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+#include "crypto/s2n_cipher.h"
+#include "tls/s2n_crypto_constants.h"
+#include "tls/s2n_resume.h"
+#include "utils/s2n_result.h"
+
+/* Decryption contexts kept per ticket key. Each server process derives its own
+ * encryption key, so a fleet sharing a ticket key needs one slot per recently seen server.
+ */
+#define S2N_TICKET_KEY_CACHE_DECRYPT_SLOTS 8
+
+/* A cached encryption key is replaced after this many tickets, well below the
+ * 2^32 invocations that NIST SP 800-38D allows for a single AES-GCM key.
+ */
+#define S2N_TICKET_KEY_CACHE_MAX_ENCRYPTIONS (1 << 24)
+
+/* Encryption nonces are a random prefix followed by a 64-bit counter */
+#define S2N_TICKET_KEY_CACHE_NONCE_PREFIX_LEN (S2N_TLS_GCM_IV_LEN - sizeof(uint64_t))
+
+struct s2n_ticket_key_cache_slot {
+    uint8_t info[S2N_TICKET_INFO_SIZE];
+    /* Only used by the encryption slot, and chosen whenever it is rekeyed */
+    uint8_t nonce_prefix[S2N_TICKET_KEY_CACHE_NONCE_PREFIX_LEN];
+    struct s2n_session_key session_key;
+    bool ready;
+};
+
+struct s2n_ticket_key_cache {
+    pthread_mutex_t lock;
+
+    struct s2n_ticket_key_cache_slot encrypt;
+    uint64_t encrypt_fork_generation;
+    uint64_t encrypt_count;
+    uint64_t next_nonce;
+
+    struct s2n_ticket_key_cache_slot decrypt[S2N_TICKET_KEY_CACHE_DECRYPT_SLOTS];
+    uint32_t next_decrypt_slot;
+};
+
+S2N_RESULT s2n_ticket_key_cache_encrypt(struct s2n_ticket_key *key, uint8_t info[S2N_TICKET_INFO_SIZE],
+        struct s2n_blob *iv, struct s2n_blob *aad, struct s2n_blob *state);
+S2N_RESULT s2n_ticket_key_cache_decrypt(struct s2n_ticket_key *key, const uint8_t info[S2N_TICKET_INFO_SIZE],
+        struct s2n_blob *iv, struct s2n_blob *aad, struct s2n_blob *state);
+S2N_RESULT s2n_ticket_key_cache_free(struct s2n_ticket_key *key);
@@ -17,6 +17,7 @@
 
 #include "tls/s2n_connection.h"
 #include "tls/s2n_key_log.h"
+#include "tls/s2n_prf.h"
 #include "tls/s2n_tls13_handshake.h"
 #include "utils/s2n_bitmap.h"
 
@@ -121,15 +122,22 @@ static S2N_RESULT s2n_calculate_transcript_digest(struct s2n_connection *conn)
     return S2N_RESULT_OK;
 }
 
-static S2N_RESULT s2n_extract_secret(s2n_hmac_algorithm hmac_alg,
+/*
+ * The connection's PRF working space provides a reusable hmac. Secrets derived
+ * without a connection, or after the working space is freed, use a temporary hmac.
+ */
+static S2N_RESULT s2n_extract_secret(struct s2n_prf_working_space *ws, s2n_hmac_algorithm hmac_alg,
         const struct s2n_blob *previous_secret_material, const struct s2n_blob *new_secret_material,
         struct s2n_blob *output)
 {
-    /*
-     * TODO: We should be able to reuse the prf_work_space rather
-     * than allocating a new HMAC every time.
-     * https://github.com/aws/s2n-tls/issues/3206
-     */
+    if (ws) {
+        struct s2n_hmac_state *hmac = NULL;
+        RESULT_GUARD(s2n_prf_get_unkeyed_hmac(ws, &hmac));
+        RESULT_GUARD_POSIX(s2n_hkdf_extract(hmac, hmac_alg,
+                previous_secret_material, new_secret_material, output));
+        return S2N_RESULT_OK;
+    }
+
     DEFER_CLEANUP(struct s2n_hmac_state hmac_state = { 0 }, s2n_hmac_free);
     RESULT_GUARD_POSIX(s2n_hmac_new(&hmac_state));
 
@@ -144,24 +152,74 @@ static S2N_RESULT s2n_extract_secret(s2n_hmac_algorithm hmac_alg,
  *#      HKDF-Expand-Label(Secret, Label,
  *#                        Transcript-Hash(Messages), Hash.length)
  */
-static S2N_RESULT s2n_derive_secret(s2n_hmac_algorithm hmac_alg,
+static S2N_RESULT s2n_derive_secret(struct s2n_prf_working_space *ws, s2n_hmac_algorithm hmac_alg,
         const struct s2n_blob *previous_secret_material, const struct s2n_blob *label, const struct s2n_blob *context,
         struct s2n_blob *output)
 {
-    /*
-     * TODO: We should be able to reuse the prf_work_space rather
-     * than allocating a new HMAC every time.
-     * https://github.com/aws/s2n-tls/issues/3206
-     */
+    output->size = s2n_get_hash_len(hmac_alg);
+
+    /* Consecutive derivations from the same secret reuse the keyed hmac */
+    if (ws && s2n_hkdf_supports_keyed_hmac()) {
+        struct s2n_hmac_state *hmac = NULL;
+        RESULT_GUARD(s2n_prf_get_keyed_hmac(ws, hmac_alg, previous_secret_material, &hmac));
+        RESULT_GUARD_POSIX(s2n_hkdf_expand_label_with_keyed_hmac(hmac, hmac_alg, label, context, output));
+        return S2N_RESULT_OK;
+    }
+
     DEFER_CLEANUP(struct s2n_hmac_state hmac_state = { 0 }, s2n_hmac_free);
     RESULT_GUARD_POSIX(s2n_hmac_new(&hmac_state));
 
-    output->size = s2n_get_hash_len(hmac_alg);
     RESULT_GUARD_POSIX(s2n_hkdf_expand_label(&hmac_state, hmac_alg,
             previous_secret_material, label, context, output));
     return S2N_RESULT_OK;
 }
 
+/*
+ * Without a PSK, the early secret and the "derived" secret expanded from it
+ * only depend on the hash algorithm, so they are calculated once.
+ */
+struct s2n_zero_psk_secrets {
+    uint8_t early_secret[S2N_MAX_HASHLEN];
+    uint8_t derived_secret[S2N_MAX_HASHLEN];
+};
+static struct s2n_zero_psk_secrets sha256_zero_psk_secrets = { 0 };
+static struct s2n_zero_psk_secrets sha384_zero_psk_secrets = { 0 };
+
+static S2N_RESULT s2n_get_zero_psk_secrets(s2n_hmac_algorithm hmac_alg, struct s2n_zero_psk_secrets **secrets)
+{
+    RESULT_ENSURE_REF(secrets);
+    switch (hmac_alg) {
+        case S2N_HMAC_SHA256:
+            *secrets = &sha256_zero_psk_secrets;
+            return S2N_RESULT_OK;
+        case S2N_HMAC_SHA384:
+            *secrets = &sha384_zero_psk_secrets;
+            return S2N_RESULT_OK;
+        default:
+            RESULT_BAIL(S2N_ERR_HMAC_INVALID_ALGORITHM);
+    }
+}
+
+S2N_RESULT s2n_tls13_zero_psk_secrets_init()
+{
+    for (size_t i = 0; i < s2n_array_len(supported_hmacs); i++) {
+        s2n_hmac_algorithm hmac_alg = supported_hmacs[i];
+        struct s2n_zero_psk_secrets *secrets = NULL;
+        RESULT_GUARD(s2n_get_zero_psk_secrets(hmac_alg, &secrets));
+
+        struct s2n_blob early_secret = { 0 };
+        RESULT_GUARD_POSIX(s2n_blob_init(&early_secret, secrets->early_secret, s2n_get_hash_len(hmac_alg)));
+        struct s2n_blob derived_secret = { 0 };
+        RESULT_GUARD_POSIX(s2n_blob_init(&derived_secret, secrets->derived_secret, s2n_get_hash_len(hmac_alg)));
+
+        RESULT_GUARD(s2n_extract_secret(NULL, hmac_alg, &ZERO_VALUE(hmac_alg), &ZERO_VALUE(hmac_alg), &early_secret));
+        RESULT_GUARD(s2n_derive_secret(NULL, hmac_alg, &early_secret, &s2n_tls13_label_derived_secret,
+                &EMPTY_CONTEXT(hmac_alg), &derived_secret));
+    }
+
+    return S2N_RESULT_OK;
+}
+
 static S2N_RESULT s2n_derive_secret_with_context(struct s2n_connection *conn,
         s2n_extract_secret_type_t input_secret_type, const struct s2n_blob *label, message_type_t transcript_end_msg,
         struct s2n_blob *output)
@@ -172,11 +230,29 @@ static S2N_RESULT s2n_derive_secret_with_context(struct s2n_connection *conn,
 
     RESULT_ENSURE(conn->secrets.extract_secret_type == input_secret_type, S2N_ERR_SECRET_SCHEDULE_STATE);
     RESULT_ENSURE(s2n_conn_get_current_message_type(conn) == transcript_end_msg, S2N_ERR_SECRET_SCHEDULE_STATE);
-    RESULT_GUARD(s2n_derive_secret(CONN_HMAC_ALG(conn), &CONN_SECRET(conn, extract_secret),
+    RESULT_GUARD(s2n_derive_secret(conn->prf_space, CONN_HMAC_ALG(conn), &CONN_SECRET(conn, extract_secret),
             label, &CONN_HASH(conn, transcript_hash_digest), output));
     return S2N_RESULT_OK;
 }
 
+/* Returns the PSK that the early secret is extracted from, or NULL for the zero PSK */
+static S2N_RESULT s2n_tls13_schedule_psk(struct s2n_connection *conn, struct s2n_psk **psk)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(psk);
+    *psk = conn->psk_params.chosen_psk;
+
+    /*
+     * If the client is sending early data, then the PSK is always assumed
+     * to be the first PSK offered.
+     */
+    if (conn->mode == S2N_CLIENT && conn->early_data_state == S2N_EARLY_DATA_REQUESTED) {
+        RESULT_GUARD(s2n_array_get(&conn->psk_params.psk_list, 0, (void **) psk));
+        RESULT_ENSURE_REF(*psk);
+    }
+    return S2N_RESULT_OK;
+}
+
 static S2N_RESULT s2n_derive_secret_without_context(struct s2n_connection *conn,
         s2n_extract_secret_type_t input_secret_type, struct s2n_blob *output)
 {
@@ -184,8 +260,24 @@ static S2N_RESULT s2n_derive_secret_without_context(struct s2n_connection *conn,
     RESULT_ENSURE_REF(output);
 
     RESULT_ENSURE(conn->secrets.extract_secret_type == input_secret_type, S2N_ERR_SECRET_SCHEDULE_STATE);
-    RESULT_GUARD(s2n_derive_secret(CONN_HMAC_ALG(conn), &CONN_SECRET(conn, extract_secret),
-            &s2n_tls13_label_derived_secret, &EMPTY_CONTEXT(CONN_HMAC_ALG(conn)), output));
+
+    s2n_hmac_algorithm hmac_alg = CONN_HMAC_ALG(conn);
+    struct s2n_blob extract_secret = CONN_SECRET(conn, extract_secret);
+    /* Without a PSK, the "derived" secret was already calculated during s2n_init */
+    if (input_secret_type == S2N_EARLY_SECRET) {
+        struct s2n_psk *psk = NULL;
+        RESULT_GUARD(s2n_tls13_schedule_psk(conn, &psk));
+        if (psk == NULL) {
+            struct s2n_zero_psk_secrets *zero_psk_secrets = NULL;
+            RESULT_GUARD(s2n_get_zero_psk_secrets(hmac_alg, &zero_psk_secrets));
+            output->size = extract_secret.size;
+            RESULT_CHECKED_MEMCPY(output->data, zero_psk_secrets->derived_secret, output->size);
+            return S2N_RESULT_OK;
+        }
+    }
+
+    RESULT_GUARD(s2n_derive_secret(conn->prf_space, hmac_alg, &extract_secret,
+            &s2n_tls13_label_derived_secret, &EMPTY_CONTEXT(hmac_alg), output));
     return S2N_RESULT_OK;
 }
 
@@ -207,14 +299,7 @@ static S2N_RESULT s2n_tls13_compute_finished_key(struct s2n_connection *conn,
 
     RESULT_GUARD(s2n_handshake_set_finished_len(conn, output->size));
 
-    /*
-     * TODO: We should be able to reuse the prf_work_space rather
-     * than allocating a new HMAC every time.
-     */
-    DEFER_CLEANUP(struct s2n_hmac_state hmac_state = { 0 }, s2n_hmac_free);
-    RESULT_GUARD_POSIX(s2n_hmac_new(&hmac_state));
-
-    RESULT_GUARD_POSIX(s2n_hkdf_expand_label(&hmac_state, CONN_HMAC_ALG(conn),
+    RESULT_GUARD(s2n_derive_secret(conn->prf_space, CONN_HMAC_ALG(conn),
             base_key, &s2n_tls13_label_finished, &(struct s2n_blob){ 0 }, output));
     return S2N_RESULT_OK;
 }
@@ -266,7 +351,7 @@ S2N_RESULT s2n_extract_early_secret(struct s2n_psk *psk)
 {
     RESULT_ENSURE_REF(psk);
     RESULT_GUARD_POSIX(s2n_realloc(&psk->early_secret, s2n_get_hash_len(psk->hmac_alg)));
-    RESULT_GUARD(s2n_extract_secret(psk->hmac_alg,
+    RESULT_GUARD(s2n_extract_secret(NULL, psk->hmac_alg,
             &ZERO_VALUE(psk->hmac_alg),
             &psk->secret,
             &psk->early_secret));
@@ -282,28 +367,19 @@ static S2N_RESULT s2n_extract_early_secret_for_schedule(struct s2n_connection *c
 {
     RESULT_ENSURE_REF(conn);
 
-    struct s2n_psk *psk = conn->psk_params.chosen_psk;
+    struct s2n_psk *psk = NULL;
+    RESULT_GUARD(s2n_tls13_schedule_psk(conn, &psk));
     s2n_hmac_algorithm hmac_alg = CONN_HMAC_ALG(conn);
 
-    /*
-     * If the client is sending early data, then the PSK is always assumed
-     * to be the first PSK offered.
-     */
-    if (conn->mode == S2N_CLIENT && conn->early_data_state == S2N_EARLY_DATA_REQUESTED) {
-        RESULT_GUARD(s2n_array_get(&conn->psk_params.psk_list, 0, (void **) &psk));
-        RESULT_ENSURE_REF(psk);
-    }
-
     /**
      *= https://www.rfc-editor.org/rfc/rfc8446#section-7.1
      *# if no PSK is selected, it will then need
      *# to compute the Early Secret corresponding to the zero PSK.
      */
     if (psk == NULL) {
-        RESULT_GUARD(s2n_extract_secret(hmac_alg,
-                &ZERO_VALUE(hmac_alg),
-                &ZERO_VALUE(hmac_alg),
-                &CONN_SECRET(conn, extract_secret)));
+        struct s2n_zero_psk_secrets *zero_psk_secrets = NULL;
+        RESULT_GUARD(s2n_get_zero_psk_secrets(hmac_alg, &zero_psk_secrets));
+        RESULT_CHECKED_MEMCPY(CONN_SECRETS(conn).extract_secret, zero_psk_secrets->early_secret, s2n_get_hash_len(hmac_alg));
         return S2N_RESULT_OK;
     }
 
@@ -333,7 +409,7 @@ S2N_RESULT s2n_derive_binder_key(struct s2n_psk *psk, struct s2n_blob *output)
         label = &s2n_tls13_label_external_psk_binder_key;
     }
     RESULT_GUARD(s2n_extract_early_secret(psk));
-    RESULT_GUARD(s2n_derive_secret(psk->hmac_alg,
+    RESULT_GUARD(s2n_derive_secret(NULL, psk->hmac_alg,
             &psk->early_secret,
             label,
             &EMPTY_CONTEXT(psk->hmac_alg),
@@ -378,7 +454,7 @@ static S2N_RESULT s2n_extract_handshake_secret(struct s2n_connection *conn)
     DEFER_CLEANUP(struct s2n_blob shared_secret = { 0 }, s2n_free_or_wipe);
     RESULT_GUARD_POSIX(s2n_tls13_compute_shared_secret(conn, &shared_secret));
 
-    RESULT_GUARD(s2n_extract_secret(CONN_HMAC_ALG(conn),
+    RESULT_GUARD(s2n_extract_secret(conn->prf_space, CONN_HMAC_ALG(conn),
             &derived_secret,
             &shared_secret,
             &CONN_SECRET(conn, extract_secret)));
@@ -403,18 +479,6 @@ static S2N_RESULT s2n_derive_client_handshake_traffic_secret(struct s2n_connecti
             &s2n_tls13_label_client_handshake_traffic_secret,
             SERVER_HELLO,
             output));
-
-    /*
-     * The client finished key needs to be calculated using the
-     * same connection state as the client handshake secret.
-     *
-     *= https://www.rfc-editor.org/rfc/rfc8446#section-4.4.4
-     *# The key used to compute the Finished message is computed from the
-     *# Base Key defined in Section 4.4 using HKDF (see Section 7.1).
-     */
-    RESULT_GUARD(s2n_tls13_compute_finished_key(conn,
-            output, &CONN_FINISHED(conn, client)));
-
     return S2N_RESULT_OK;
 }
 
@@ -435,18 +499,6 @@ static S2N_RESULT s2n_derive_server_handshake_traffic_secret(struct s2n_connecti
             &s2n_tls13_label_server_handshake_traffic_secret,
             SERVER_HELLO,
             output));
-
-    /*
-     * The server finished key needs to be calculated using the
-     * same connection state as the server handshake secret.
-     *
-     *= https://www.rfc-editor.org/rfc/rfc8446#section-4.4.4
-     *# The key used to compute the Finished message is computed from the
-     *# Base Key defined in Section 4.4 using HKDF (see Section 7.1).
-     */
-    RESULT_GUARD(s2n_tls13_compute_finished_key(conn,
-            output, &CONN_FINISHED(conn, server)));
-
     return S2N_RESULT_OK;
 }
 
@@ -467,7 +519,7 @@ static S2N_RESULT s2n_extract_master_secret(struct s2n_connection *conn)
     RESULT_GUARD_POSIX(s2n_blob_init(&derived_secret, derived_secret_bytes, S2N_TLS13_SECRET_MAX_LEN));
     RESULT_GUARD(s2n_derive_secret_without_context(conn, S2N_HANDSHAKE_SECRET, &derived_secret));
 
-    RESULT_GUARD(s2n_extract_secret(CONN_HMAC_ALG(conn),
+    RESULT_GUARD(s2n_extract_secret(conn->prf_space, CONN_HMAC_ALG(conn),
             &derived_secret,
             &ZERO_VALUE(CONN_HMAC_ALG(conn)),
             &CONN_SECRET(conn, extract_secret)));
@@ -588,6 +640,39 @@ static s2n_result (*derive_methods[][2])(struct s2n_connection *conn, struct s2n
     [S2N_MASTER_SECRET] = { &s2n_derive_server_application_traffic_secret, &s2n_derive_client_application_traffic_secret },
 };
 
+static S2N_RESULT s2n_tls13_derive_traffic_secret(struct s2n_connection *conn, s2n_extract_secret_type_t secret_type,
+        s2n_mode mode, struct s2n_blob *secret)
+{
+    RESULT_ENSURE_GTE(secret_type, 0);
+    RESULT_ENSURE_LT(secret_type, s2n_array_len(derive_methods));
+    RESULT_ENSURE_REF(derive_methods[secret_type][mode]);
+    RESULT_GUARD(derive_methods[secret_type][mode](conn, secret));
+    return S2N_RESULT_OK;
+}
+
+/*
+ * The finished keys need to be calculated using the
+ * same connection state as the handshake secrets.
+ *
+ *= https://www.rfc-editor.org/rfc/rfc8446#section-4.4.4
+ *# The key used to compute the Finished message is computed from the
+ *# Base Key defined in Section 4.4 using HKDF (see Section 7.1).
+ */
+static S2N_RESULT s2n_tls13_derive_handshake_finished_key(struct s2n_connection *conn, s2n_extract_secret_type_t secret_type,
+        s2n_mode mode, struct s2n_blob *secret)
+{
+    if (secret_type != S2N_HANDSHAKE_SECRET) {
+        return S2N_RESULT_OK;
+    }
+
+    if (mode == S2N_CLIENT) {
+        RESULT_GUARD(s2n_tls13_compute_finished_key(conn, secret, &CONN_FINISHED(conn, client)));
+    } else {
+        RESULT_GUARD(s2n_tls13_compute_finished_key(conn, secret, &CONN_FINISHED(conn, server)));
+    }
+    return S2N_RESULT_OK;
+}
+
 S2N_RESULT s2n_tls13_derive_secret(struct s2n_connection *conn, s2n_extract_secret_type_t secret_type,
         s2n_mode mode, struct s2n_blob *secret)
 {
@@ -599,16 +684,40 @@ S2N_RESULT s2n_tls13_derive_secret(struct s2n_connection *conn, s2n_extract_secr
     RESULT_ENSURE_NE(secret_type, S2N_NONE_SECRET);
 
     RESULT_GUARD(s2n_tls13_extract_secret(conn, secret_type));
-
-    RESULT_ENSURE_GTE(secret_type, 0);
-    RESULT_ENSURE_LT(secret_type, s2n_array_len(derive_methods));
-    RESULT_ENSURE_REF(derive_methods[secret_type][mode]);
-    RESULT_GUARD(derive_methods[secret_type][mode](conn, secret));
+    RESULT_GUARD(s2n_tls13_derive_traffic_secret(conn, secret_type, mode, secret));
+    RESULT_GUARD(s2n_tls13_derive_handshake_finished_key(conn, secret_type, mode, secret));
 
     RESULT_GUARD(s2n_trigger_secret_callbacks(conn, secret, secret_type, mode));
     return S2N_RESULT_OK;
 }
 
+/*
+ * The client and server traffic secrets are both expanded from the same extract secret
+ * and transcript. Deriving them back to back, before the finished keys re-key the hmac,
+ * means that the extract secret only needs to key the hmac once.
+ */
+static S2N_RESULT s2n_tls13_derive_traffic_secrets(struct s2n_connection *conn, s2n_extract_secret_type_t secret_type,
+        struct s2n_blob *client_secret, struct s2n_blob *server_secret)
+{
+    RESULT_ENSURE_REF(conn);
+    RESULT_ENSURE_REF(client_secret);
+    RESULT_ENSURE_REF(server_secret);
+    RESULT_ENSURE_REF(conn->secure);
+    RESULT_ENSURE_REF(conn->secure->cipher_suite);
+    RESULT_ENSURE_REF(conn->handshake.hashes);
+    RESULT_ENSURE_NE(secret_type, S2N_NONE_SECRET);
+
+    RESULT_GUARD(s2n_tls13_extract_secret(conn, secret_type));
+    RESULT_GUARD(s2n_tls13_derive_traffic_secret(conn, secret_type, S2N_CLIENT, client_secret));
+    RESULT_GUARD(s2n_tls13_derive_traffic_secret(conn, secret_type, S2N_SERVER, server_secret));
+    RESULT_GUARD(s2n_tls13_derive_handshake_finished_key(conn, secret_type, S2N_CLIENT, client_secret));
+    RESULT_GUARD(s2n_tls13_derive_handshake_finished_key(conn, secret_type, S2N_SERVER, server_secret));
+
+    RESULT_GUARD(s2n_trigger_secret_callbacks(conn, client_secret, secret_type, S2N_CLIENT));
+    RESULT_GUARD(s2n_trigger_secret_callbacks(conn, server_secret, secret_type, S2N_SERVER));
+    return S2N_RESULT_OK;
+}
+
 S2N_RESULT s2n_tls13_secrets_clean(struct s2n_connection *conn)
 {
     RESULT_ENSURE_REF(conn);
@@ -628,6 +737,10 @@ S2N_RESULT s2n_tls13_secrets_clean(struct s2n_connection *conn)
      */
     RESULT_GUARD_POSIX(s2n_blob_zero(&CONN_SECRET(conn, extract_secret)));
     conn->secrets.extract_secret_type = S2N_NONE_SECRET;
+    /* The key schedule hmac is still keyed with the last extract secret */
+    if (conn->prf_space) {
+        RESULT_GUARD(s2n_prf_forget_keyed_hmac(conn->prf_space));
+    }
 
     /* Wipe other secrets no longer needed */
     RESULT_GUARD_POSIX(s2n_blob_zero(&CONN_SECRET(conn, client_early_secret)));
@@ -660,17 +773,13 @@ S2N_RESULT s2n_tls13_secrets_update(struct s2n_connection *conn)
             break;
         case SERVER_HELLO:
             RESULT_GUARD(s2n_calculate_transcript_digest(conn));
-            RESULT_GUARD(s2n_tls13_derive_secret(conn, S2N_HANDSHAKE_SECRET,
-                    S2N_CLIENT, &CONN_SECRET(conn, client_handshake_secret)));
-            RESULT_GUARD(s2n_tls13_derive_secret(conn, S2N_HANDSHAKE_SECRET,
-                    S2N_SERVER, &CONN_SECRET(conn, server_handshake_secret)));
+            RESULT_GUARD(s2n_tls13_derive_traffic_secrets(conn, S2N_HANDSHAKE_SECRET,
+                    &CONN_SECRET(conn, client_handshake_secret), &CONN_SECRET(conn, server_handshake_secret)));
             break;
         case SERVER_FINISHED:
             RESULT_GUARD(s2n_calculate_transcript_digest(conn));
-            RESULT_GUARD(s2n_tls13_derive_secret(conn, S2N_MASTER_SECRET,
-                    S2N_CLIENT, &CONN_SECRET(conn, client_app_secret)));
-            RESULT_GUARD(s2n_tls13_derive_secret(conn, S2N_MASTER_SECRET,
-                    S2N_SERVER, &CONN_SECRET(conn, server_app_secret)));
+            RESULT_GUARD(s2n_tls13_derive_traffic_secrets(conn, S2N_MASTER_SECRET,
+                    &CONN_SECRET(conn, client_app_secret), &CONN_SECRET(conn, server_app_secret)));
             RESULT_GUARD(s2n_derive_exporter_master_secret(conn,
                     &CONN_SECRET(conn, exporter_master_secret)));
             break;
@@ -748,7 +857,7 @@ int s2n_connection_tls_exporter(struct s2n_connection *conn,
     POSIX_ENSURE_LTE(s2n_get_hash_len(CONN_HMAC_ALG(conn)), S2N_MAX_DIGEST_LEN);
     POSIX_GUARD(s2n_blob_init(&derived_secret,
             derived_secret_bytes, s2n_get_hash_len(CONN_HMAC_ALG(conn))));
-    POSIX_GUARD_RESULT(s2n_derive_secret(hmac_alg, &CONN_SECRET(conn, exporter_master_secret),
+    POSIX_GUARD_RESULT(s2n_derive_secret(conn->prf_space, hmac_alg, &CONN_SECRET(conn, exporter_master_secret),
             &label, &EMPTY_CONTEXT(hmac_alg), &derived_secret));
 
     DEFER_CLEANUP(struct s2n_hmac_state hmac_state = { 0 }, s2n_hmac_free);
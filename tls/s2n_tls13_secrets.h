@@ -46,6 +46,7 @@ struct s2n_tls13_secrets {
 };
 
 S2N_RESULT s2n_tls13_empty_transcripts_init();
+S2N_RESULT s2n_tls13_zero_psk_secrets_init();
 
 S2N_RESULT s2n_tls13_secrets_update(struct s2n_connection *conn);
 S2N_RESULT s2n_tls13_secrets_get(struct s2n_connection *conn, s2n_extract_secret_type_t secret_type,
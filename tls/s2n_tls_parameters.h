@@ -100,6 +100,7 @@
 #define TLS_EXTENSION_ALPN                 16
 #define TLS_EXTENSION_SCT_LIST             18
 #define TLS_EXTENSION_EMS                  23
+#define TLS_EXTENSION_COMPRESS_CERTIFICATE 27
 #define TLS_EXTENSION_SESSION_TICKET       35
 #define TLS_EXTENSION_PRE_SHARED_KEY       41
 #define TLS_EXTENSION_CERT_AUTHORITIES     47
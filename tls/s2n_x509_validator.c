@@ -851,6 +851,7 @@ S2N_RESULT s2n_x509_validator_validate_cert_chain(struct s2n_x509_validator *val
         uint8_t *cert_chain_in, uint32_t cert_chain_len, s2n_pkey_type *pkey_type, struct s2n_pkey *public_key_out)
 {
     RESULT_ENSURE_REF(validator);
+    RESULT_GUARD(s2n_handshake_timings_begin(conn, S2N_HANDSHAKE_TIMING_CERT_VALIDATION));
 
     if (validator->cert_validation_cb_invoked) {
         RESULT_GUARD(s2n_x509_validator_handle_cert_validation_callback_result(validator));
@@ -877,6 +878,7 @@ S2N_RESULT s2n_x509_validator_validate_cert_chain(struct s2n_x509_validator *val
     /* Reset the old struct, so we don't clean up public_key_out */
     ZERO_TO_DISABLE_DEFER_CLEANUP(public_key);
 
+    RESULT_GUARD(s2n_handshake_timings_end(conn, S2N_HANDSHAKE_TIMING_CERT_VALIDATION));
     return S2N_RESULT_OK;
 }
 
@@ -58,3 +58,34 @@ bool s2n_atomic_flag_test(s2n_atomic_flag *var)
     return var->val;
 #endif
 }
+
+void *s2n_atomic_ptr_load(void *const *ptr)
+{
+#if S2N_ATOMIC_SUPPORTED
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#else
+    return *ptr;
+#endif
+}
+
+void s2n_atomic_ptr_store(void **ptr, void *val)
+{
+#if S2N_ATOMIC_SUPPORTED
+    __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+#else
+    *ptr = val;
+#endif
+}
+
+bool s2n_atomic_ptr_compare_exchange(void **ptr, void *expected, void *desired)
+{
+#if S2N_ATOMIC_SUPPORTED
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#else
+    if (*ptr != expected) {
+        return false;
+    }
+    *ptr = desired;
+    return true;
+#endif
+}
@@ -40,3 +40,11 @@ S2N_RESULT s2n_atomic_init();
 void s2n_atomic_flag_set(s2n_atomic_flag *var);
 void s2n_atomic_flag_clear(s2n_atomic_flag *var);
 bool s2n_atomic_flag_test(s2n_atomic_flag *var);
+
+/* Pointers that are published once and then read without a lock.
+ * Loads have acquire semantics and stores / exchanges have release semantics,
+ * so a reader that sees the pointer also sees everything written before it was published.
+ */
+void *s2n_atomic_ptr_load(void *const *ptr);
+void s2n_atomic_ptr_store(void **ptr, void *val);
+bool s2n_atomic_ptr_compare_exchange(void **ptr, void *expected, void *desired);
@@ -56,7 +56,11 @@ struct FGN_STATE {
      */
     bool is_fork_detection_enabled;
 
-    /* Sentinel that signals a fork event has occurred */
+    /* Sentinel that signals a fork event has occurred. Written with release
+     * semantics after the fork generation number when a fork is handled, so a
+     * reader that sees no fork event with acquire semantics also sees the fork
+     * generation number that goes with it.
+     */
     volatile char *zero_on_fork_addr;
 
     pthread_once_t fork_detection_once;
@@ -74,6 +78,24 @@ static struct FGN_STATE fgn_state = {
     .fork_detection_rw_lock = PTHREAD_RWLOCK_INITIALIZER,
 };
 
+static char s2n_fork_detection_sentinel_load(void)
+{
+#if S2N_ATOMIC_SUPPORTED
+    return __atomic_load_n(fgn_state.zero_on_fork_addr, __ATOMIC_ACQUIRE);
+#else
+    return *fgn_state.zero_on_fork_addr;
+#endif
+}
+
+static void s2n_fork_detection_sentinel_store(char value)
+{
+#if S2N_ATOMIC_SUPPORTED
+    __atomic_store_n(fgn_state.zero_on_fork_addr, value, __ATOMIC_RELEASE);
+#else
+    *fgn_state.zero_on_fork_addr = value;
+#endif
+}
+
 /* Can currently never fail. See initialise_fork_detection_methods() for
  * motivation.
  */
@@ -240,6 +262,18 @@ S2N_RESULT s2n_get_fork_generation_number(uint64_t *return_fork_generation_numbe
 
     RESULT_ENSURE(fgn_state.is_fork_detection_enabled == true, S2N_ERR_FORK_DETECTION_INIT);
 
+#if S2N_ATOMIC_SUPPORTED
+    /* In most cases, we would not need to increment the fork generation number.
+     * Every random number request reaches this check, so avoid the read lock:
+     * the fork generation number only changes while the sentinel signals a fork
+     * event, and is written before the sentinel is reset. Once a thread sees no
+     * fork event, the fork generation number can be read without a lock.
+     */
+    if (s2n_fork_detection_sentinel_load() != S2N_FORK_EVENT) {
+        *return_fork_generation_number = fgn_state.current_fork_generation_number;
+        return S2N_RESULT_OK;
+    }
+#else
     /* In most cases, we would not need to increment the fork generation number.
      * So, it is cheaper, in the expected case, to take an optimistic read lock
      * and later aquire a write lock if needed.
@@ -258,6 +292,7 @@ S2N_RESULT s2n_get_fork_generation_number(uint64_t *return_fork_generation_numbe
         return S2N_RESULT_OK;
     }
     RESULT_ENSURE(pthread_rwlock_unlock(&fgn_state.fork_detection_rw_lock) == 0, S2N_ERR_RETRIEVE_FORK_GENERATION_NUMBER);
+#endif
 
     /* We are mutating the process-global, cached fork generation number. Need
      * to acquire the write lock for that. Set returned fgn before checking the
@@ -265,13 +300,14 @@ S2N_RESULT s2n_get_fork_generation_number(uint64_t *return_fork_generation_numbe
      */
     RESULT_ENSURE(pthread_rwlock_wrlock(&fgn_state.fork_detection_rw_lock) == 0, S2N_ERR_RETRIEVE_FORK_GENERATION_NUMBER);
     *return_fork_generation_number = fgn_state.current_fork_generation_number;
-    if (*fgn_state.zero_on_fork_addr == S2N_FORK_EVENT) {
-        /* Fork event has been detected; reset sentinel, increment cached fork
-         * generation number (which is now "current" in this child process), and
+    if (s2n_fork_detection_sentinel_load() == S2N_FORK_EVENT) {
+        /* Fork event has been detected; increment cached fork generation number
+         * (which is now "current" in this child process), reset sentinel, and
          * write incremented fork generation number to the output parameter.
+         * The sentinel must be reset last, for threads that don't take the lock.
          */
-        *fgn_state.zero_on_fork_addr = S2N_NO_FORK_EVENT;
         fgn_state.current_fork_generation_number = fgn_state.current_fork_generation_number + 1;
+        s2n_fork_detection_sentinel_store(S2N_NO_FORK_EVENT);
         *return_fork_generation_number = fgn_state.current_fork_generation_number;
     }
     RESULT_ENSURE(pthread_rwlock_unlock(&fgn_state.fork_detection_rw_lock) == 0, S2N_ERR_RETRIEVE_FORK_GENERATION_NUMBER);
@@ -82,6 +82,7 @@ int s2n_init(void)
     POSIX_GUARD(s2n_config_defaults_init());
     POSIX_GUARD(s2n_extension_type_init());
     POSIX_GUARD_RESULT(s2n_tls13_empty_transcripts_init());
+    POSIX_GUARD_RESULT(s2n_tls13_zero_psk_secrets_init());
     POSIX_GUARD_RESULT(s2n_atomic_init());
 
     if (atexit_cleanup) {
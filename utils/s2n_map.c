@@ -19,32 +19,50 @@
 #include <string.h>
 
 #include "api/s2n.h"
-#include "crypto/s2n_hash.h"
 #include "error/s2n_errno.h"
 #include "utils/s2n_blob.h"
 #include "utils/s2n_map_internal.h"
 #include "utils/s2n_mem.h"
 #include "utils/s2n_result.h"
 #include "utils/s2n_safety.h"
+#include "utils/s2n_siphash.h"
 
 #define S2N_INITIAL_TABLE_SIZE 1024
 
-static S2N_RESULT s2n_map_slot(const struct s2n_map *map, struct s2n_blob *key, uint32_t *slot)
+/* Find the slot for a key by linear probing from its home slot.
+ *
+ * Sets `slot` to either the slot holding the key or the first empty slot found.
+ * If the table is full and doesn't contain the key, `slot` is left at a used slot.
+ * The cached hash of each entry is compared before the key itself, so most
+ * colliding entries are skipped without touching the key data.
+ */
+static S2N_RESULT s2n_map_find_slot(const struct s2n_map *map, const struct s2n_blob *key, uint64_t hash,
+        uint32_t *slot, bool *key_found)
 {
     RESULT_ENSURE_REF(map);
+    RESULT_ENSURE_REF(key);
     RESULT_ENSURE(map->capacity != 0, S2N_ERR_SAFETY);
-    union {
-        uint8_t u8[32];
-        uint32_t u32[8];
-    } digest;
-
-    DEFER_CLEANUP(struct s2n_hash_state sha256 = { 0 }, s2n_hash_free);
-    RESULT_GUARD_POSIX(s2n_hash_new(&sha256));
-    RESULT_GUARD_POSIX(s2n_hash_init(&sha256, S2N_HASH_SHA256));
-    RESULT_GUARD_POSIX(s2n_hash_update(&sha256, key->data, key->size));
-    RESULT_GUARD_POSIX(s2n_hash_digest(&sha256, digest.u8, sizeof(digest)));
-
-    *slot = digest.u32[0] % map->capacity;
+
+    *key_found = false;
+    const uint32_t initial_slot = hash % map->capacity;
+    uint32_t current = initial_slot;
+
+    while (map->table[current].key.size) {
+        const struct s2n_map_entry *entry = &map->table[current];
+        if (entry->hash == hash && entry->key.size == key->size
+                && memcmp(entry->key.data, key->data, key->size) == 0) {
+            *key_found = true;
+            break;
+        }
+
+        current = (current + 1) % map->capacity;
+        /* We went over all the slots but found no match */
+        if (current == initial_slot) {
+            break;
+        }
+    }
+
+    *slot = current;
     return S2N_RESULT_OK;
 }
 
@@ -55,6 +73,7 @@ static S2N_RESULT s2n_map_embiggen(struct s2n_map *map, uint32_t capacity)
     struct s2n_map tmp = { 0 };
 
     RESULT_ENSURE(!map->immutable, S2N_ERR_MAP_IMMUTABLE);
+    RESULT_ENSURE(capacity > map->size, S2N_ERR_MAP_INVALID_MAP_SIZE);
 
     RESULT_GUARD_POSIX(s2n_alloc(&mem, (capacity * sizeof(struct s2n_map_entry))));
     RESULT_GUARD_POSIX(s2n_blob_zero(&mem));
@@ -64,11 +83,18 @@ static S2N_RESULT s2n_map_embiggen(struct s2n_map *map, uint32_t capacity)
     tmp.table = (void *) mem.data;
     tmp.immutable = 0;
 
+    /* Entries keep their cached hash and their allocated key and value,
+     * so growing the table only moves entries without copying or rehashing.
+     */
     for (size_t i = 0; i < map->capacity; i++) {
         if (map->table[i].key.size) {
-            RESULT_GUARD(s2n_map_add(&tmp, &map->table[i].key, &map->table[i].value));
-            RESULT_GUARD_POSIX(s2n_free(&map->table[i].key));
-            RESULT_GUARD_POSIX(s2n_free(&map->table[i].value));
+            uint32_t slot = 0;
+            bool key_found = false;
+            RESULT_GUARD(s2n_map_find_slot(&tmp, &map->table[i].key, map->table[i].hash, &slot, &key_found));
+            RESULT_ENSURE(!key_found, S2N_ERR_MAP_DUPLICATE);
+            RESULT_ENSURE(tmp.table[slot].key.size == 0, S2N_ERR_MAP_INVALID_MAP_SIZE);
+            tmp.table[slot] = map->table[i];
+            tmp.size++;
         }
     }
     RESULT_GUARD_POSIX(s2n_free_object((uint8_t **) &map->table, map->capacity * sizeof(struct s2n_map_entry)));
@@ -90,10 +116,11 @@ struct s2n_map *s2n_map_new()
 struct s2n_map *s2n_map_new_with_initial_capacity(uint32_t capacity)
 {
     PTR_ENSURE(capacity != 0, S2N_ERR_MAP_INVALID_MAP_SIZE);
-    struct s2n_blob mem = { 0 };
+    DEFER_CLEANUP(struct s2n_blob mem = { 0 }, s2n_free);
     struct s2n_map *map = NULL;
 
     PTR_GUARD_POSIX(s2n_alloc(&mem, sizeof(struct s2n_map)));
+    PTR_GUARD_POSIX(s2n_blob_zero(&mem));
 
     map = (void *) mem.data;
     map->capacity = 0;
@@ -103,76 +130,71 @@ struct s2n_map *s2n_map_new_with_initial_capacity(uint32_t capacity)
 
     PTR_GUARD_RESULT(s2n_map_embiggen(map, capacity));
 
+    ZERO_TO_DISABLE_DEFER_CLEANUP(mem);
     return map;
 }
 
-S2N_RESULT s2n_map_add(struct s2n_map *map, struct s2n_blob *key, struct s2n_blob *value)
+static S2N_RESULT s2n_map_store(struct s2n_map *map, struct s2n_blob *key, struct s2n_blob *value, bool overwrite)
 {
     RESULT_ENSURE_REF(map);
+    RESULT_ENSURE_REF(key);
+    RESULT_ENSURE_REF(value);
     RESULT_ENSURE(!map->immutable, S2N_ERR_MAP_IMMUTABLE);
+    RESULT_ENSURE(key->size != 0, S2N_ERR_MAP_INVALID_MAP_SIZE);
 
-    if (map->capacity < (map->size * 2)) {
+    /* Keep the load factor at or below 1/2 after this insert, so that probe sequences stay short */
+    if (map->capacity < ((map->size + 1) * 2)) {
         /* Embiggen the map */
         RESULT_GUARD(s2n_map_embiggen(map, map->capacity * 2));
     }
 
-    uint32_t slot = 0;
-    RESULT_GUARD(s2n_map_slot(map, key, &slot));
-
-    /* Linear probing until we find an empty slot */
-    while (map->table[slot].key.size) {
-        if (key->size != map->table[slot].key.size || memcmp(key->data, map->table[slot].key.data, key->size)) {
-            slot++;
-            slot %= map->capacity;
-            continue;
-        }
-
-        /* We found a duplicate key */
-        RESULT_BAIL(S2N_ERR_MAP_DUPLICATE);
+    /* Each map uses its own random key, so slot positions can't be predicted
+     * and keys that collide in one map are unlikely to collide in another.
+     * The key is only needed once the map has entries, so empty maps like those
+     * of the default configs never draw from the private DRBG.
+     */
+    if (map->size == 0) {
+        RESULT_GUARD(s2n_siphash_key_generate(&map->hash_key));
     }
 
-    RESULT_GUARD_POSIX(s2n_dup(key, &map->table[slot].key));
-    RESULT_GUARD_POSIX(s2n_dup(value, &map->table[slot].value));
-    map->size++;
-
-    return S2N_RESULT_OK;
-}
-
-S2N_RESULT s2n_map_put(struct s2n_map *map, struct s2n_blob *key, struct s2n_blob *value)
-{
-    RESULT_ENSURE_REF(map);
-    RESULT_ENSURE(!map->immutable, S2N_ERR_MAP_IMMUTABLE);
-
-    if (map->capacity < (map->size * 2)) {
-        /* Embiggen the map */
-        RESULT_GUARD(s2n_map_embiggen(map, map->capacity * 2));
-    }
+    const uint64_t hash = s2n_siphash(&map->hash_key, key->data, key->size);
 
     uint32_t slot = 0;
-    RESULT_GUARD(s2n_map_slot(map, key, &slot));
-
-    /* Linear probing until we find an empty slot */
-    while (map->table[slot].key.size) {
-        if (key->size != map->table[slot].key.size || memcmp(key->data, map->table[slot].key.data, key->size)) {
-            slot++;
-            slot %= map->capacity;
-            continue;
-        }
+    bool key_found = false;
+    RESULT_GUARD(s2n_map_find_slot(map, key, hash, &slot, &key_found));
+    struct s2n_map_entry *entry = &map->table[slot];
+
+    if (key_found) {
+        RESULT_ENSURE(overwrite, S2N_ERR_MAP_DUPLICATE);
 
         /* We found a duplicate key that will be overwritten */
-        RESULT_GUARD_POSIX(s2n_free(&map->table[slot].key));
-        RESULT_GUARD_POSIX(s2n_free(&map->table[slot].value));
+        RESULT_GUARD_POSIX(s2n_free(&entry->key));
+        RESULT_GUARD_POSIX(s2n_free(&entry->value));
         map->size--;
-        break;
+    } else {
+        RESULT_ENSURE(entry->key.size == 0, S2N_ERR_MAP_INVALID_MAP_SIZE);
     }
 
-    RESULT_GUARD_POSIX(s2n_dup(key, &map->table[slot].key));
-    RESULT_GUARD_POSIX(s2n_dup(value, &map->table[slot].value));
+    RESULT_GUARD_POSIX(s2n_dup(key, &entry->key));
+    RESULT_GUARD_POSIX(s2n_dup(value, &entry->value));
+    entry->hash = hash;
     map->size++;
 
     return S2N_RESULT_OK;
 }
 
+S2N_RESULT s2n_map_add(struct s2n_map *map, struct s2n_blob *key, struct s2n_blob *value)
+{
+    RESULT_GUARD(s2n_map_store(map, key, value, false));
+    return S2N_RESULT_OK;
+}
+
+S2N_RESULT s2n_map_put(struct s2n_map *map, struct s2n_blob *key, struct s2n_blob *value)
+{
+    RESULT_GUARD(s2n_map_store(map, key, value, true));
+    return S2N_RESULT_OK;
+}
+
 S2N_RESULT s2n_map_complete(struct s2n_map *map)
 {
     RESULT_ENSURE_REF(map);
@@ -192,33 +214,28 @@ S2N_RESULT s2n_map_unlock(struct s2n_map *map)
 S2N_RESULT s2n_map_lookup(const struct s2n_map *map, struct s2n_blob *key, struct s2n_blob *value, bool *key_found)
 {
     RESULT_ENSURE_REF(map);
+    RESULT_ENSURE_REF(key);
+    RESULT_ENSURE_REF(key_found);
     RESULT_ENSURE(map->immutable, S2N_ERR_MAP_MUTABLE);
 
-    uint32_t slot = 0;
-    RESULT_GUARD(s2n_map_slot(map, key, &slot));
-    const uint32_t initial_slot = slot;
-
-    while (map->table[slot].key.size) {
-        if (key->size != map->table[slot].key.size || memcmp(key->data, map->table[slot].key.data, key->size)) {
-            slot++;
-            slot %= map->capacity;
-            /* We went over all the slots but found no match */
-            if (slot == initial_slot) {
-                break;
-            }
-            continue;
-        }
-
-        /* We found a match */
-        struct s2n_blob entry_value = map->table[slot].value;
-        RESULT_GUARD_POSIX(s2n_blob_init(value, entry_value.data, entry_value.size));
-
-        *key_found = true;
+    *key_found = false;
+    if (map->size == 0) {
+        return S2N_RESULT_OK;
+    }
 
+    const uint64_t hash = s2n_siphash(&map->hash_key, key->data, key->size);
+    uint32_t slot = 0;
+    bool found = false;
+    RESULT_GUARD(s2n_map_find_slot(map, key, hash, &slot, &found));
+    if (!found) {
         return S2N_RESULT_OK;
     }
 
-    *key_found = false;
+    /* We found a match */
+    struct s2n_blob entry_value = map->table[slot].value;
+    RESULT_GUARD_POSIX(s2n_blob_init(value, entry_value.data, entry_value.size));
+
+    *key_found = true;
 
     return S2N_RESULT_OK;
 }
@@ -248,6 +265,14 @@ S2N_RESULT s2n_map_free(struct s2n_map *map)
     return S2N_RESULT_OK;
 }
 
+S2N_CLEANUP_RESULT s2n_map_free_pointer(struct s2n_map **map)
+{
+    RESULT_ENSURE_REF(map);
+    RESULT_GUARD(s2n_map_free(*map));
+    *map = NULL;
+    return S2N_RESULT_OK;
+}
+
 S2N_RESULT s2n_map_size(struct s2n_map *map, uint32_t *size)
 {
     RESULT_ENSURE_REF(map);
@@ -15,10 +15,13 @@
 #pragma once
 
 #include "utils/s2n_map.h"
+#include "utils/s2n_siphash.h"
 
 struct s2n_map_entry {
     struct s2n_blob key;
     struct s2n_blob value;
+    /* The keyed hash of the key, cached so that probing and resizing don't rehash keys */
+    uint64_t hash;
 };
 
 struct s2n_map {
@@ -31,6 +34,9 @@ struct s2n_map {
     /* Once a map has been looked up, it is considered immutable */
     int immutable;
 
+    /* Random per-map key for the slot hash */
+    struct s2n_siphash_key hash_key;
+
     /* Pointer to the hash-table, should be capacity * sizeof(struct s2n_map_entry) */
     struct s2n_map_entry *table;
 };
@@ -109,6 +109,11 @@ struct s2n_rand_state {
     struct s2n_drbg public_drbg;
     struct s2n_drbg private_drbg;
     bool drbgs_initialized;
+    /* Output of the public DRBG that has not been handed out yet. The unused
+     * bytes are at the end of the pool, and bytes are zeroed once handed out.
+     */
+    uint8_t public_pool[S2N_PUBLIC_RANDOM_POOL_SIZE];
+    uint32_t public_pool_available;
 };
 
 /* Key which will control per-thread freeing of drbg memory */
@@ -122,7 +127,9 @@ static __thread struct s2n_rand_state s2n_per_thread_rand_state = {
     .cached_fork_generation_number = 0,
     .public_drbg = { 0 },
     .private_drbg = { 0 },
-    .drbgs_initialized = false
+    .drbgs_initialized = false,
+    .public_pool = { 0 },
+    .public_pool_available = 0,
 };
 
 static int s2n_rand_init_cb_impl(void);
@@ -265,9 +272,9 @@ static S2N_RESULT s2n_ensure_uniqueness(void)
 
     if (returned_fork_generation_number != s2n_per_thread_rand_state.cached_fork_generation_number) {
         /* This assumes that s2n_rand_cleanup_thread() doesn't mutate any other
-         * state than the drbg states and it resets the drbg initialization
-         * boolean to false. s2n_ensure_initialized_drbgs() will cache the new
-         * fork generation number in the per thread state.
+         * state than the drbg states and the public pool, and it resets the drbg
+         * initialization boolean to false. s2n_ensure_initialized_drbgs() will
+         * cache the new fork generation number in the per thread state.
          */
         RESULT_GUARD(s2n_rand_cleanup_thread());
         RESULT_GUARD(s2n_ensure_initialized_drbgs());
@@ -319,10 +326,44 @@ static S2N_RESULT s2n_get_custom_random_data(struct s2n_blob *out_blob, struct s
     return S2N_RESULT_OK;
 }
 
+/* Public random data is sent in the clear, like explicit IVs, session IDs and
+ * ServerHello randoms, so it doesn't need to be generated at the time of the request.
+ * Generating it in bulk makes small requests a copy, instead of a DRBG generate call
+ * that mixes in new entropy. Fork detection still runs for every request, and a fork
+ * wipes the pool with the rest of the per thread state.
+ */
+static S2N_RESULT s2n_get_public_random_data_from_pool(struct s2n_blob *out_blob)
+{
+    RESULT_GUARD_PTR(out_blob);
+    RESULT_ENSURE_LTE(out_blob->size, S2N_PUBLIC_RANDOM_POOL_MAX_REQUEST);
+
+    RESULT_ENSURE(!s2n_is_in_fips_mode(), S2N_ERR_DRBG);
+    RESULT_GUARD(s2n_ensure_initialized_drbgs());
+    RESULT_GUARD(s2n_ensure_uniqueness());
+
+    struct s2n_rand_state *state = &s2n_per_thread_rand_state;
+    if (state->public_pool_available < out_blob->size) {
+        struct s2n_blob pool = { 0 };
+        RESULT_GUARD_POSIX(s2n_blob_init(&pool, state->public_pool, sizeof(state->public_pool)));
+        RESULT_GUARD(s2n_drbg_generate(&state->public_drbg, &pool));
+        state->public_pool_available = sizeof(state->public_pool);
+    }
+
+    uint8_t *next = state->public_pool + (sizeof(state->public_pool) - state->public_pool_available);
+    RESULT_CHECKED_MEMCPY(out_blob->data, next, out_blob->size);
+    RESULT_CHECKED_MEMSET(next, 0, out_blob->size);
+    state->public_pool_available -= out_blob->size;
+
+    return S2N_RESULT_OK;
+}
+
 S2N_RESULT s2n_get_public_random_data(struct s2n_blob *blob)
 {
+    RESULT_GUARD_PTR(blob);
     if (s2n_is_in_fips_mode()) {
         RESULT_GUARD(s2n_get_libcrypto_random_data(blob));
+    } else if (blob->size <= S2N_PUBLIC_RANDOM_POOL_MAX_REQUEST) {
+        RESULT_GUARD(s2n_get_public_random_data_from_pool(blob));
     } else {
         RESULT_GUARD(s2n_get_custom_random_data(blob, &s2n_per_thread_rand_state.public_drbg));
     }
@@ -646,10 +687,15 @@ S2N_RESULT s2n_rand_cleanup(void)
 S2N_RESULT s2n_rand_cleanup_thread(void)
 {
     /* Currently, it is only safe for this function to mutate the drbg states
-     * in the per thread rand state. See s2n_ensure_uniqueness().
+     * and the public pool in the per thread rand state. See s2n_ensure_uniqueness().
      */
     RESULT_GUARD(s2n_drbg_wipe(&s2n_per_thread_rand_state.private_drbg));
     RESULT_GUARD(s2n_drbg_wipe(&s2n_per_thread_rand_state.public_drbg));
+    struct s2n_blob public_pool = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&public_pool, s2n_per_thread_rand_state.public_pool,
+            sizeof(s2n_per_thread_rand_state.public_pool)));
+    RESULT_GUARD_POSIX(s2n_blob_zero(&public_pool));
+    s2n_per_thread_rand_state.public_pool_available = 0;
 
     s2n_per_thread_rand_state.drbgs_initialized = false;
 
@@ -19,6 +19,12 @@
 #include "utils/s2n_blob.h"
 #include "utils/s2n_result.h"
 
+/* Small public random requests are served from a per-thread pool of DRBG output,
+ * so that they don't each pay for a DRBG generate call and its entropy mix.
+ */
+#define S2N_PUBLIC_RANDOM_POOL_SIZE        4096
+#define S2N_PUBLIC_RANDOM_POOL_MAX_REQUEST 64
+
 struct s2n_rand_device {
     const char *source;
     int fd;
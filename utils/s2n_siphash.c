@@ -0,0 +1,99 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "utils/s2n_siphash.h"
+
+#include "utils/s2n_blob.h"
+#include "utils/s2n_random.h"
+#include "utils/s2n_safety.h"
+
+#define S2N_SIPHASH_ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define S2N_SIPHASH_ROUND(v0, v1, v2, v3) \
+    do {                                  \
+        v0 += v1;                         \
+        v1 = S2N_SIPHASH_ROTL(v1, 13);    \
+        v1 ^= v0;                         \
+        v0 = S2N_SIPHASH_ROTL(v0, 32);    \
+        v2 += v3;                         \
+        v3 = S2N_SIPHASH_ROTL(v3, 16);    \
+        v3 ^= v2;                         \
+        v0 += v3;                         \
+        v3 = S2N_SIPHASH_ROTL(v3, 21);    \
+        v3 ^= v0;                         \
+        v2 += v1;                         \
+        v1 = S2N_SIPHASH_ROTL(v1, 17);    \
+        v1 ^= v2;                         \
+        v2 = S2N_SIPHASH_ROTL(v2, 32);    \
+    } while (0)
+
+/* Reads up to 8 bytes as a little-endian integer, regardless of host byte order */
+static uint64_t s2n_siphash_read_le(const uint8_t *data, uint32_t size)
+{
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < size; i++) {
+        value |= ((uint64_t) data[i]) << (8 * i);
+    }
+    return value;
+}
+
+S2N_RESULT s2n_siphash_key_generate(struct s2n_siphash_key *key)
+{
+    RESULT_ENSURE_REF(key);
+    uint8_t key_bytes[16] = { 0 };
+    struct s2n_blob key_blob = { 0 };
+    RESULT_GUARD_POSIX(s2n_blob_init(&key_blob, key_bytes, sizeof(key_bytes)));
+    /* The key must stay secret from peers to prevent hash flooding */
+    RESULT_GUARD(s2n_get_private_random_data(&key_blob));
+    key->k0 = s2n_siphash_read_le(key_bytes, 8);
+    key->k1 = s2n_siphash_read_le(key_bytes + 8, 8);
+    RESULT_GUARD_POSIX(s2n_blob_zero(&key_blob));
+    return S2N_RESULT_OK;
+}
+
+uint64_t s2n_siphash(const struct s2n_siphash_key *key, const uint8_t *data, uint32_t size)
+{
+    uint64_t v0 = key->k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key->k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key->k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key->k1 ^ 0x7465646279746573ULL;
+
+    const uint32_t full_blocks_size = size - (size % 8);
+    for (uint32_t i = 0; i < full_blocks_size; i += 8) {
+        uint64_t m = s2n_siphash_read_le(data + i, 8);
+        v3 ^= m;
+        S2N_SIPHASH_ROUND(v0, v1, v2, v3);
+        S2N_SIPHASH_ROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    /* The final block holds the remaining bytes and the low byte of the input length */
+    uint64_t b = ((uint64_t) (size & 0xff)) << 56;
+    if (size > full_blocks_size) {
+        b |= s2n_siphash_read_le(data + full_blocks_size, size - full_blocks_size);
+    }
+    v3 ^= b;
+    S2N_SIPHASH_ROUND(v0, v1, v2, v3);
+    S2N_SIPHASH_ROUND(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    S2N_SIPHASH_ROUND(v0, v1, v2, v3);
+    S2N_SIPHASH_ROUND(v0, v1, v2, v3);
+    S2N_SIPHASH_ROUND(v0, v1, v2, v3);
+    S2N_SIPHASH_ROUND(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
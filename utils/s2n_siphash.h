@@ -0,0 +1,36 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "utils/s2n_result.h"
+
+/* SipHash-2-4, a fast keyed hash for hash tables.
+ * https://www.aumasson.jp/siphash/siphash.pdf
+ *
+ * SipHash is not a replacement for a cryptographic hash like SHA-256,
+ * but with a secret random key it prevents an attacker from choosing inputs
+ * that all collide in the same hash table slot.
+ */
+
+struct s2n_siphash_key {
+    uint64_t k0;
+    uint64_t k1;
+};
+
+S2N_RESULT s2n_siphash_key_generate(struct s2n_siphash_key *key);
+uint64_t s2n_siphash(const struct s2n_siphash_key *key, const uint8_t *data, uint32_t size);
@@ -0,0 +1,39 @@
+/*
+ * Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+/* Static tracepoints (USDT probes) for tools like bpftrace and perf.
+ *
+ * Probes are only compiled in when s2n-tls is built with -DS2N_USDT=ON and <sys/sdt.h>
+ * is available. A compiled-in probe is a single nop instruction until a tracer attaches,
+ * and when probes are compiled out their arguments are never evaluated.
+ *
+ * All probes belong to the "s2n" provider and take the connection as their first argument.
+ * Tracers timestamp probes as they fire, so timestamps aren't passed as arguments.
+ */
+#if defined(S2N_USDT)
+    #include <sys/sdt.h>
+
+    #define S2N_USDT_PROBE1(name, a1)                 DTRACE_PROBE1(s2n, name, a1)
+    #define S2N_USDT_PROBE2(name, a1, a2)             DTRACE_PROBE2(s2n, name, a1, a2)
+    #define S2N_USDT_PROBE3(name, a1, a2, a3)         DTRACE_PROBE3(s2n, name, a1, a2, a3)
+    #define S2N_USDT_PROBE4(name, a1, a2, a3, a4)     DTRACE_PROBE4(s2n, name, a1, a2, a3, a4)
+#else
+    #define S2N_USDT_PROBE1(name, a1)
+    #define S2N_USDT_PROBE2(name, a1, a2)
+    #define S2N_USDT_PROBE3(name, a1, a2, a3)
+    #define S2N_USDT_PROBE4(name, a1, a2, a3, a4)
+#endif